@@ -17,6 +17,7 @@
 
 #include "storage/storage.h"
 
+#include "include/pika_client_tracking.h"
 #include "include/pika_command.h"
 
 /*
@@ -111,6 +112,25 @@ class CompactCmd : public Cmd {
   std::set<std::string> compact_dbs_;
 };
 
+/*
+ * BULKLOAD path ingests the sst files built by an SstBuilder into every slot
+ * of the db, from path or, for a db of many slots, from path/<slot id>. The
+ * files bypass the write path and are not replicated.
+ */
+class BulkloadCmd : public Cmd {
+ public:
+  BulkloadCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override{};
+  void Merge() override{};
+  Cmd* Clone() override { return new BulkloadCmd(*this); }
+
+ private:
+  void DoInitial() override;
+  void Clear() override { path_.clear(); }
+  std::string path_;
+};
+
 class PurgelogstoCmd : public Cmd {
  public:
   PurgelogstoCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
@@ -191,6 +211,9 @@ class ClientCmd : public Cmd {
 
  private:
   std::string operation_, info_;
+  // CLIENT TRACKING on|off and its options
+  bool tracking_on_ = false;
+  PikaClientTracking::Options tracking_options_;
   void DoInitial() override;
 };
 
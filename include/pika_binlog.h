@@ -65,6 +65,12 @@ class Binlog : public pstd::noncopyable {
 
   uint64_t file_size() { return file_size_; }
 
+  // The size of the binlog files on disk, O(1)
+  uint64_t DiskSize();
+  // Sum the size of the files before the one written again, after files
+  // were purged or truncated
+  void UpdateArchivedSize();
+
   std::string filename() { return filename_; }
 
   bool IsBinlogIoError() { return binlog_io_error_; }
@@ -118,6 +124,8 @@ class Binlog : public pstd::noncopyable {
   std::string filename_;
 
   std::atomic<bool> binlog_io_error_;
+  // the size of the files before the one written, see UpdateArchivedSize()
+  std::atomic<uint64_t> archived_size_ = 0;
   // Not use
   // int32_t retry_;
 };
@@ -123,6 +123,11 @@ class BitPosCmd : public Cmd {
 class BitOpCmd : public Cmd {
  public:
   BitOpCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag){};
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res = src_keys_;
+    res.push_back(dest_key_);
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -0,0 +1,91 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_BLOCKED_CLIENTS_H_
+#define PIKA_BLOCKED_CLIENTS_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "net/include/net_thread.h"
+#include "pstd/include/pstd_mutex.h"
+
+class BlockingPopCmd;
+class PikaClientConn;
+
+/*
+ * PikaBlockedClients parks the clients of BLPOP, BRPOP and BRPOPLPUSH whose
+ * keys are all empty. A parked client holds no worker: its connection just
+ * gets no reply, and reads nothing more, until the command is answered.
+ *
+ * A push only marks the key ready, by the list push listener of the storage.
+ * The ready keys are served by ServeReadyKeys, which the client connections
+ * call after their commands so a push is answered after the clients it woke,
+ * and by the thread below for the pushes with no client, like the applied
+ * binlogs. The thread also times the clients out.
+ *
+ * The worker of a parked connection watches only its close, and drops its
+ * clients by UnblockConn when it goes away. The worker also keeps it off the
+ * keepalive timeout, a blocked client is not idle.
+ */
+class PikaBlockedClients : public net::Thread {
+ public:
+  PikaBlockedClients();
+  ~PikaBlockedClients() override;
+
+  void Block(const std::shared_ptr<BlockingPopCmd>& cmd, const std::shared_ptr<PikaClientConn>& conn,
+             const std::shared_ptr<std::string>& resp);
+  // Drop the clients of a closed connection, without a reply
+  void UnblockConn(int fd, const std::string& ip_port);
+
+  void SignalKeyReady(const std::string& db_name, std::string_view key);
+  bool HasReadyKeys() const { return has_ready_keys_.load(); }
+  void ServeReadyKeys();
+
+  size_t BlockedNum() const { return num_blocked_.load(); }
+
+ private:
+  struct BlockedClient {
+    std::shared_ptr<BlockingPopCmd> cmd;
+    std::shared_ptr<PikaClientConn> conn;
+    std::shared_ptr<std::string> resp;
+    std::vector<std::string> db_keys;
+    // 0 blocks forever
+    uint64_t deadline_us = 0;
+    std::atomic<bool> done{false};
+  };
+
+  void* ThreadMain() override;
+  // Retry the clients blocked on db_key in the order they came
+  void ServeKey(const std::string& db_key);
+  void CheckBlockedClients();
+  void Unregister(const std::shared_ptr<BlockedClient>& client);
+  void Reply(const std::shared_ptr<BlockedClient>& client);
+
+  // protect clients_, keys_ and the ready keys
+  std::mutex mu_;
+  std::list<std::shared_ptr<BlockedClient>> clients_;
+  std::unordered_map<std::string, std::list<std::shared_ptr<BlockedClient>>> keys_;
+  std::vector<std::string> ready_keys_;
+  std::unordered_set<std::string> ready_set_;
+  std::atomic<bool> has_ready_keys_ = false;
+  std::atomic<size_t> num_blocked_ = 0;
+
+  // only one thread retries the blocked commands at a time, and the clients
+  // of a closed connection are not dropped while they are
+  std::mutex serve_mu_;
+
+  pstd::Mutex cron_mu_;
+  pstd::CondVar cron_cv_;
+};
+
+#endif
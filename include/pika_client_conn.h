@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "include/pika_command.h"
+#include "include/pika_watched_keys.h"
 
 class PikaClientConn : public net::RedisConn {
  public:
@@ -42,7 +43,7 @@ class PikaClientConn : public net::RedisConn {
 
   PikaClientConn(int fd, const std::string& ip_port, net::Thread* server_thread, net::NetMultiplexer* mpx,
                  const net::HandleType& handle_type, int max_conn_rbuf_size);
-  ~PikaClientConn() override = default;
+  ~PikaClientConn() override;
 
   void ProcessRedisCmds(const std::vector<net::RedisCmdArgsType>& argvs, bool async,
                                 std::string* response) override;
@@ -61,6 +62,29 @@ class PikaClientConn : public net::RedisConn {
 
   AuthStat& auth_stat() { return auth_stat_; }
 
+  // Write the replies once every command of the batch is answered
+  void TryWriteResp();
+
+  // Transaction related, the commands of a connection run one at a time
+  bool InMulti() const { return in_multi_; }
+  void StartMulti();
+  // End the transaction, *cmds gets the queued commands. It returns false
+  // and leaves *cmds empty if a command failed to be queued
+  bool EndMulti(std::vector<std::shared_ptr<Cmd>>* cmds);
+  void WatchKeys(const std::string& db_name, const std::vector<std::string>& keys);
+  void UnwatchKeys();
+  // db name and key of the watched keys
+  const std::vector<std::pair<std::string, std::string>>& watched_keys() const { return watched_keys_; }
+  // set by a write to any of the watched keys, null if nothing is watched
+  PikaWatchedKeys::Flag watch_flag() const { return watch_flag_; }
+
+  // Client tracking related, the id is unique in the server and never 0
+  uint64_t id() const { return id_; }
+  bool tracking() const { return tracking_; }
+  void SetTracking(bool tracking) { tracking_ = tracking; }
+  // known to the client tracking, to be removed from it when closed
+  void SetRegistered() { registered_ = true; }
+
   std::atomic<int> resp_num;
   std::vector<std::shared_ptr<std::string>> resp_array;
 
@@ -70,6 +94,18 @@ class PikaClientConn : public net::RedisConn {
   WriteCompleteCallback write_completed_cb_;
   bool is_pubsub_ = false;
 
+  bool in_multi_ = false;
+  // a command failed to be queued, EXEC aborts
+  bool multi_dirty_ = false;
+  std::vector<std::shared_ptr<Cmd>> multi_cmds_;
+  std::vector<std::pair<std::string, std::string>> watched_keys_;
+  PikaWatchedKeys::Flag watch_flag_;
+
+  static std::atomic<uint64_t> next_id_;
+  const uint64_t id_;
+  bool tracking_ = false;
+  bool registered_ = false;
+
   std::shared_ptr<Cmd> DoCmd(const PikaCmdArgsType& argv, const std::string& opt,
                              const std::shared_ptr<std::string>& resp_ptr);
 
@@ -77,7 +113,8 @@ class PikaClientConn : public net::RedisConn {
   void ProcessMonitor(const PikaCmdArgsType& argv);
 
   void ExecRedisCmd(const PikaCmdArgsType& argv, const std::shared_ptr<std::string>& resp_ptr);
-  void TryWriteResp();
+  // Queue c_ptr into the transaction, false if it is refused
+  bool QueueMultiCmd(const std::shared_ptr<Cmd>& c_ptr);
 
   AuthStat auth_stat_;
 };
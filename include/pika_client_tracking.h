@@ -0,0 +1,116 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_CLIENT_TRACKING_H_
+#define PIKA_CLIENT_TRACKING_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class PikaClientConn;
+
+/*
+ * PikaClientTracking keeps the keys read by the clients with CLIENT TRACKING
+ * on, to tell them when one of the keys is written so they drop it from
+ * their caches. A key is told once, the client reads it again to track it
+ * again. A client in the BCAST mode tracks no key, it is told of every key
+ * written that starts with one of its prefixes, or of every key without
+ * prefixes. A FLUSHDB or FLUSHALL tells every client to drop all its keys.
+ *
+ * The keys are tracked before they are read and told after they are written
+ * under their record locks, so a write racing a read is told, not missed.
+ * The table of the keys is split in shards of their own locks, so the reads
+ * and writes of different keys do not wait on each other. A client that stops
+ * tracking leaves its id on its keys, skipped when they are told, so a client
+ * tracking again may be told of a key it read before it stopped. Past the
+ * most keys the table may hold, keys of the shards in turn are told as if
+ * written and dropped.
+ * The message is a RESP3 push on the connection of the client, or a message
+ * of the __redis__:invalidate channel to the connection it redirects to,
+ * known by the id it got with CLIENT ID, which has to speak RESP3 or be
+ * subscribed. It is queued on that connection by the thread of the write,
+ * and sent by the thread of the connection once its running commands end.
+ */
+class PikaClientTracking {
+ public:
+  struct Options {
+    bool bcast = false;
+    // the writes of the client are not told to itself
+    bool noloop = false;
+    // the id of the connection to tell instead, 0 for its own
+    uint64_t redirect = 0;
+    std::vector<std::string> prefixes;
+  };
+
+  // A connection that may be redirected to
+  void Register(uint64_t id, const std::shared_ptr<PikaClientConn>& conn);
+  void Enable(uint64_t id, const std::shared_ptr<PikaClientConn>& conn, const Options& options);
+  // Stop tracking, and forget the connection
+  void Disable(uint64_t id);
+  void Remove(uint64_t id);
+  bool IsRegistered(uint64_t id);
+
+  // Before keys of db_name are read by the client id
+  void Track(uint64_t id, const std::string& db_name, const std::vector<std::string>& keys);
+  // After keys of db_name are written by the client writer_id, 0 for none
+  void Invalidate(const std::string& db_name, const std::vector<std::string>& keys, uint64_t writer_id);
+  // After every key of db_name, or of every db if db_name is empty, is deleted
+  void InvalidateAll(const std::string& db_name);
+  // The most keys tracked at once, 0 for no limit, keys past it are told
+  void SetMaxKeys(size_t max_keys);
+  size_t NumKeys() const { return num_keys_.load(); }
+
+  static std::string InvalidateMessage(const std::string* key, int resp_version, bool redirected);
+
+ private:
+  struct Client {
+    std::weak_ptr<PikaClientConn> conn;
+    bool tracking = false;
+    Options options;
+  };
+  // the db keys tracked, to the ids of the clients tracking them
+  struct KeyShard {
+    std::mutex mu;
+    std::unordered_map<std::string, std::vector<uint64_t>> keys;
+  };
+  static constexpr size_t kKeyShards = 16;
+  // keys told, with the ids of the clients that tracked them
+  using ToldKeys = std::vector<std::pair<std::string, std::vector<uint64_t>>>;
+  using Messages = std::vector<std::pair<std::shared_ptr<PikaClientConn>, std::string>>;
+
+  static std::string DBKey(const std::string& db_name, const std::string& key);
+  KeyShard& ShardOf(const std::string& db_key) { return key_shards_[std::hash<std::string>{}(db_key) % kKeyShards]; }
+  // The message to client telling key, or every key if null, nothing if it
+  // has no connection to tell, need mu_
+  void AddMessage(const Client& client, const std::string* key, Messages* messages);
+  // The messages to the clients still tracking the keys told, need mu_
+  void AddTrackedMessages(const ToldKeys& told, uint64_t writer_id, Messages* messages);
+  // Drop the keys past max_keys_ and tell their clients
+  void EvictKeys();
+  static void SendMessages(const Messages& messages);
+
+  // guards clients_ and bcast_ids_, taken before no shard lock
+  std::shared_mutex mu_;
+  std::unordered_map<uint64_t, Client> clients_;
+  // the clients in the BCAST mode, told of every key written
+  std::vector<uint64_t> bcast_ids_;
+  std::array<KeyShard, kKeyShards> key_shards_;
+  std::atomic<size_t> num_keys_ = 0;
+  std::atomic<size_t> max_keys_ = 0;
+  // the shard the next key is evicted from
+  std::atomic<size_t> evict_shard_ = 0;
+  // lets the writes skip the locks while no client tracks
+  std::atomic<size_t> num_tracking_ = 0;
+};
+
+#endif
@@ -27,6 +27,7 @@ const std::string kCmdNameDbSlaveof = "dbslaveof";
 const std::string kCmdNameAuth = "auth";
 const std::string kCmdNameBgsave = "bgsave";
 const std::string kCmdNameCompact = "compact";
+const std::string kCmdNameBulkload = "bulkload";
 const std::string kCmdNamePurgelogsto = "purgelogsto";
 const std::string kCmdNamePing = "ping";
 const std::string kCmdNameSelect = "select";
@@ -126,6 +127,10 @@ const std::string kCmdNameHScan = "hscan";
 const std::string kCmdNameHScanx = "hscanx";
 const std::string kCmdNamePKHScanRange = "pkhscanrange";
 const std::string kCmdNamePKHRScanRange = "pkhrscanrange";
+const std::string kCmdNameHExpire = "hexpire";
+const std::string kCmdNameHExpireat = "hexpireat";
+const std::string kCmdNameHTtl = "httl";
+const std::string kCmdNameHPersist = "hpersist";
 
 // List
 const std::string kCmdNameLIndex = "lindex";
@@ -142,6 +147,9 @@ const std::string kCmdNameRPop = "rpop";
 const std::string kCmdNameRPopLPush = "rpoplpush";
 const std::string kCmdNameRPush = "rpush";
 const std::string kCmdNameRPushx = "rpushx";
+const std::string kCmdNameBLPop = "blpop";
+const std::string kCmdNameBRPop = "brpop";
+const std::string kCmdNameBRPopLPush = "brpoplpush";
 
 // BitMap
 const std::string kCmdNameBitSet = "setbit";
@@ -213,6 +221,18 @@ const std::string kCmdNamePubSub = "pubsub";
 const std::string kCmdNamePSubscribe = "psubscribe";
 const std::string kCmdNamePUnSubscribe = "punsubscribe";
 
+// Transaction
+const std::string kCmdNameMulti = "multi";
+const std::string kCmdNameExec = "exec";
+const std::string kCmdNameDiscard = "discard";
+const std::string kCmdNameWatch = "watch";
+const std::string kCmdNameUnWatch = "unwatch";
+
+// Script
+const std::string kCmdNameEval = "eval";
+const std::string kCmdNameEvalSha = "evalsha";
+const std::string kCmdNameScript = "script";
+
 const std::string kClusterPrefix = "pkcluster";
 using PikaCmdArgsType = net::RedisCmdArgsType;
 static const int RAW_ARGS_LEN = 1024 * 1024;
@@ -289,6 +309,8 @@ class CmdRes {
     kInconsistentHashTag,
     kErrOther,
     KIncrByOverFlow,
+    kExecAbort,
+    kNoScript,
   };
 
   CmdRes() = default;
@@ -370,16 +392,58 @@ class CmdRes {
         result.append(message_);
         result.append(kNewLine);
         break;
+      case kExecAbort:
+        return "-EXECABORT Transaction discarded because of previous errors.\r\n";
+      case kNoScript:
+        return "-NOSCRIPT No matching script. Please use EVAL.\r\n";
       default:
         break;
     }
     return result;
   }
 
-  // Inline functions for Create Redis protocol
-  void AppendStringLen(int64_t ori) { RedisAppendLen(message_, ori, "$"); }
-  void AppendArrayLen(int64_t ori) { RedisAppendLen(message_, ori, "*"); }
+  // The protocol of the reply, 2 or 3 as chosen by HELLO on the connection,
+  // kept by clear()
+  void SetRespVersion(int resp_version) { resp_version_ = resp_version; }
+  int resp_version() const { return resp_version_; }
+
+  // Inline functions for Create Redis protocol, a length of -1 is the null
+  void AppendStringLen(int64_t ori) {
+    if (ori < 0 && resp_version_ == 3) {
+      message_.append("_\r\n");
+      return;
+    }
+    RedisAppendLen(message_, ori, "$");
+  }
+  void AppendArrayLen(int64_t ori) {
+    if (ori < 0 && resp_version_ == 3) {
+      message_.append("_\r\n");
+      return;
+    }
+    RedisAppendLen(message_, ori, "*");
+  }
   void AppendInteger(int64_t ori) { RedisAppendLen(message_, ori, ":"); }
+  // The typed replies of RESP3, their RESP2 forms are the flat arrays and the
+  // bulk strings the clients parse themselves
+  void AppendMapLen(int64_t ori) {
+    if (resp_version_ == 3) {
+      RedisAppendLen(message_, ori, "%");
+      return;
+    }
+    RedisAppendLen(message_, ori * 2, "*");
+  }
+  void AppendSetLen(int64_t ori) { RedisAppendLen(message_, ori, resp_version_ == 3 ? "~" : "*"); }
+  void AppendPushLen(int64_t ori) { RedisAppendLen(message_, ori, resp_version_ == 3 ? ">" : "*"); }
+  // value as formatted by pstd::d2string, or any text of a double
+  void AppendDouble(const std::string& value) {
+    if (resp_version_ == 3) {
+      message_.append(",");
+      message_.append(value);
+      message_.append(kNewLine);
+      return;
+    }
+    AppendString(value);
+  }
   void AppendContent(const std::string& value) { RedisAppendContent(message_, value); }
   void AppendString(const std::string& value) {
     AppendStringLen(value.size());
@@ -396,6 +460,7 @@ class CmdRes {
  private:
   std::string message_;
   CmdRet ret_ = kNone;
+  int resp_version_ = 2;
 };
 
 class Cmd : public std::enable_shared_from_this<Cmd> {
@@ -419,6 +484,14 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
     std::shared_ptr<SyncMasterSlot> sync_slot;
     HintKeys hint_keys;
   };
+  // While alive, the binlogs of the commands run by this thread are kept in
+  // binlogs, with the binlog header stripped, instead of proposed. Used by
+  // EXEC to write the commands it runs as one binlog
+  class BinlogCapture {
+   public:
+    explicit BinlogCapture(std::vector<std::string>* binlogs);
+    ~BinlogCapture();
+  };
   Cmd(std::string name, int arity, uint16_t flag) : name_(std::move(name)), arity_(arity), flag_(flag) {}
   virtual ~Cmd() = default;
 
@@ -434,6 +507,12 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
   // used for execute multikey command into different slots
   virtual void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) = 0;
   virtual void Merge() = 0;
+  // Whether the keys of this command may be on different slots, run on each
+  // of them by Split and answered by Merge
+  virtual bool IsSplittable() const { return false; }
+  // The argv of the part of a write run by Split, written to the binlog of
+  // the slot of the keys
+  virtual PikaCmdArgsType SplitArgv(const HintKeys& hint_keys) const;
 
   void Initial(const PikaCmdArgsType& argv, const std::string& db_name);
 
@@ -444,7 +523,11 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
   bool is_admin_require() const;
   bool is_single_slot() const;
   bool is_multi_slot() const;
+  bool is_admin() const;
+  bool is_pubsub() const;
   bool HashtagIsConsistent(const std::string& lhs, const std::string& rhs) const;
+  // Whether num arguments, the name included, fit the arity of the command
+  bool CheckArg(int num) const;
   uint64_t GetDoDuration() const { return do_duration_; };
 
   std::string name() const;
@@ -462,8 +545,13 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
   std::shared_ptr<std::string> GetResp();
 
   void SetStage(CmdStage stage);
+  // A blocking command whose keys are all empty, parked instead of answered
+  virtual bool is_blocked() const { return false; }
 
   virtual void DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot);
+  // Fail the EXEC of the clients watching the keys of this write, and tell
+  // the clients tracking them
+  virtual void TouchWatchedKeys();
 
  protected:
   // enable copy, used default copy
@@ -472,8 +560,9 @@ class Cmd : public std::enable_shared_from_this<Cmd> {
                       const HintKeys& hint_key = HintKeys());
   void InternalProcessCommand(const std::shared_ptr<Slot>& slot, const std::shared_ptr<SyncMasterSlot>& sync_slot,
                               const HintKeys& hint_key);
+  // Runs the command on the slot, the caller holds its db_rwlock_ shared
+  // unless the command is a suspend one
   void DoCommand(const std::shared_ptr<Slot>& slot, const HintKeys& hint_key);
-  bool CheckArg(int num) const;
   void LogCommand() const;
 
   std::string name_;
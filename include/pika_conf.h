@@ -54,6 +54,14 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return thread_pool_size_;
   }
+  std::string io_multiplexer() {
+    std::shared_lock l(rwlock_);
+    return io_multiplexer_;
+  }
+  bool reuse_port() {
+    std::shared_lock l(rwlock_);
+    return reuse_port_;
+  }
   int sync_thread_num() {
     std::shared_lock l(rwlock_);
     return sync_thread_num_;
@@ -98,6 +106,10 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return thread_migrate_keys_num_;
   }
+  int64_t slotmigrate_pipeline_window() {
+    std::shared_lock l(rwlock_);
+    return slotmigrate_pipeline_window_;
+  }
   int64_t max_write_buffer_size() {
     std::shared_lock l(rwlock_);
     return max_write_buffer_size_;
@@ -110,6 +122,10 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return max_client_response_size_;
   }
+  int64_t tracking_table_max_keys() {
+    std::shared_lock l(rwlock_);
+    return tracking_table_max_keys_;
+  }
   int timeout() {
     std::shared_lock l(rwlock_);
     return timeout_;
@@ -146,6 +162,14 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return expire_dump_days_;
   }
+  bool bgsave_pin_sequence() {
+    std::shared_lock l(rwlock_);
+    return bgsave_pin_sequence_;
+  }
+  bool bgsave_incremental() {
+    std::shared_lock l(rwlock_);
+    return bgsave_incremental_;
+  }
   std::string bgsave_prefix() {
     std::shared_lock l(rwlock_);
     return bgsave_prefix_;
@@ -167,6 +191,10 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return databases_;
   }
+  int db_shard_num() {
+    std::shared_lock l(rwlock_);
+    return db_shard_num_;
+  }
   int default_slot_num() {
     std::shared_lock l(rwlock_);
     return default_slot_num_;
@@ -195,6 +223,18 @@ class PikaConf : public pstd::BaseConf {
     std::shared_lock l(rwlock_);
     return small_compaction_threshold_;
   }
+  int active_expire_cpu_percent() {
+    std::shared_lock l(rwlock_);
+    return active_expire_cpu_percent_;
+  }
+  int hash_max_inline_fields() {
+    std::shared_lock l(rwlock_);
+    return hash_max_inline_fields_;
+  }
+  int hash_max_inline_value() {
+    std::shared_lock l(rwlock_);
+    return hash_max_inline_value_;
+  }
   int max_background_flushes() {
     std::shared_lock l(rwlock_);
     return max_background_flushes_;
@@ -269,6 +309,7 @@ class PikaConf : public pstd::BaseConf {
   }
   bool slowlog_write_errorlog() { return slowlog_write_errorlog_.load(); }
   int slowlog_slower_than() { return slowlog_log_slower_than_.load(); }
+  int lua_time_limit() { return lua_time_limit_.load(); }
   int slowlog_max_len() {
     std::shared_lock l(rwlock_);
     return slowlog_max_len_;
@@ -359,11 +400,21 @@ class PikaConf : public pstd::BaseConf {
     TryPushDiffCommands("small-compaction-threshold", std::to_string(value));
     small_compaction_threshold_ = value;
   }
+  void SetActiveExpireCpuPercent(const int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("active-expire-cpu-percent", std::to_string(value));
+    active_expire_cpu_percent_ = value;
+  }
   void SetMaxClientResponseSize(const int value) {
     std::lock_guard l(rwlock_);
     TryPushDiffCommands("max-client-response-size", std::to_string(value));
     max_client_response_size_ = value;
   }
+  void SetTrackingTableMaxKeys(const int64_t value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("tracking-table-max-keys", std::to_string(value));
+    tracking_table_max_keys_ = value;
+  }
   void SetBgsavePath(const std::string& value) {
     std::lock_guard l(rwlock_);
     bgsave_path_ = value;
@@ -376,6 +427,16 @@ class PikaConf : public pstd::BaseConf {
     TryPushDiffCommands("dump-expire", std::to_string(value));
     expire_dump_days_ = value;
   }
+  void SetBgsavePinSequence(const std::string& value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("dump-pin-sequence", value);
+    bgsave_pin_sequence_ = value == "yes";
+  }
+  void SetBgsaveIncremental(const std::string& value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("dump-incremental", value);
+    bgsave_incremental_ = value == "yes";
+  }
   void SetBgsavePrefix(const std::string& value) {
     std::lock_guard l(rwlock_);
     TryPushDiffCommands("dump-prefix", value);
@@ -438,6 +499,11 @@ class PikaConf : public pstd::BaseConf {
     TryPushDiffCommands("slowlog-log-slower-than", std::to_string(value));
     slowlog_log_slower_than_.store(value);
   }
+  void SetLuaTimeLimit(const int value) {
+    std::lock_guard l(rwlock_);
+    TryPushDiffCommands("lua-time-limit", std::to_string(value));
+    lua_time_limit_.store(value);
+  }
   void SetSlowlogMaxLen(const int value) {
     std::lock_guard l(rwlock_);
     TryPushDiffCommands("slowlog-max-len", std::to_string(value));
@@ -512,11 +578,15 @@ class PikaConf : public pstd::BaseConf {
   int slave_priority_ = 0;
   int thread_num_ = 0;
   int thread_pool_size_ = 0;
+  std::string io_multiplexer_;
+  bool reuse_port_ = false;
   int sync_thread_num_ = 0;
   std::string log_path_;
   std::string db_path_;
   std::string db_sync_path_;
   int expire_dump_days_ = 3;
+  bool bgsave_pin_sequence_ = false;
+  bool bgsave_incremental_ = false;
   int db_sync_speed_ = 0;
   std::string compact_cron_;
   std::string compact_interval_;
@@ -524,9 +594,11 @@ class PikaConf : public pstd::BaseConf {
   int64_t arena_block_size_ = 0;
   int64_t slotmigrate_thread_num_ = 0;
   int64_t thread_migrate_keys_num_ = 0;
+  int64_t slotmigrate_pipeline_window_ = 0;
   int64_t max_write_buffer_size_ = 0;
   int max_write_buffer_num_ = 0;
   int64_t max_client_response_size_ = 0;
+  int64_t tracking_table_max_keys_ = 1000000;
   bool daemonize_ = false;
   int timeout_ = 0;
   std::string server_id_;
@@ -537,6 +609,7 @@ class PikaConf : public pstd::BaseConf {
   std::vector<std::string> user_blacklist_;
   std::atomic<bool> classic_mode_;
   int databases_ = 0;
+  int db_shard_num_ = 1;
   int default_slot_num_ = 0;
   std::vector<DBStruct> db_structs_;
   std::string default_db_;
@@ -550,6 +623,7 @@ class PikaConf : public pstd::BaseConf {
   int root_connection_num_ = 0;
   std::atomic<bool> slowlog_write_errorlog_;
   std::atomic<int> slowlog_log_slower_than_;
+  std::atomic<int> lua_time_limit_ = 5000;
   std::atomic<bool> slotmigrate_;
   std::atomic<int> binlog_writer_num_;
   int slowlog_max_len_ = 0;
@@ -560,6 +634,9 @@ class PikaConf : public pstd::BaseConf {
 
   int max_cache_statistic_keys_ = 0;
   int small_compaction_threshold_ = 0;
+  int active_expire_cpu_percent_ = 25;
+  int hash_max_inline_fields_ = 0;
+  int hash_max_inline_value_ = 64;
   int max_background_flushes_ = 0;
   int max_background_compactions_ = 0;
   int max_cache_files_ = 0;
@@ -0,0 +1,105 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_DBSYNC_H_
+#define PIKA_DBSYNC_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pstd/include/pstd_mutex.h"
+#include "pstd/include/pstd_status.h"
+
+#include "include/pika_define.h"
+#include "pika_inner_message.pb.h"
+
+/*
+ * Full sync transfers the bgsave snapshot of a slot over the repl port.
+ *
+ * Master side: the snapshot directory produced by Slot::BgSaveSlot is
+ * published as a file list identified by a snapshot uuid, and every file is
+ * served in chunks with a crc32 checksum.
+ *
+ * Slave side: DBSyncReceiver pulls the chunks of several files in parallel,
+ * limited by db-sync-speed, and writes them into db-sync-path. Files already
+ * pulled for the same snapshot are kept, so a transfer interrupted by a lost
+ * connection resumes where it stopped.
+ */
+
+struct DBSyncFileInfo {
+  std::string name;
+  uint64_t size = 0;
+};
+
+// Master side helpers
+std::string DBSyncSnapshotUuid(const std::string& s_start_time, const LogOffset& offset);
+pstd::Status DBSyncListFiles(const std::string& snapshot_path, std::vector<DBSyncFileInfo>* files);
+pstd::Status DBSyncReadChunk(const std::string& snapshot_path, const std::string& filename, uint64_t offset,
+                             uint64_t count, std::string* data, bool* eof);
+uint32_t DBSyncChecksum(const std::string& data);
+
+class DBSyncReceiver {
+ public:
+  DBSyncReceiver(std::string db_name, uint32_t slot_id, std::string dbsync_path);
+
+  // Start a new full sync round, files already on disk are kept
+  void Reset();
+  // Drive the transfer, return true once every file was pulled
+  // and the info file was written into dbsync path
+  bool Tick();
+
+  void HandleMetaResponse(const InnerMessage::InnerResponse::DBSyncMeta& meta);
+  void HandleFileResponse(const InnerMessage::InnerResponse::DBSyncFile& file);
+
+  // For display
+  std::string ProgressString();
+
+ private:
+  enum State {
+    kRequestMeta = 0,
+    kWaitMeta = 1,
+    kPulling = 2,
+    kFinished = 3,
+  };
+
+  struct FileState {
+    uint64_t size = 0;
+    uint64_t offset = 0;  // bytes verified and written
+    bool inflight = false;
+    uint64_t request_time = 0;
+  };
+
+  // invoker need to hold mu_
+  void PrepareLocalFiles(const std::vector<DBSyncFileInfo>& files);
+  void RefillTokens(uint64_t now);
+  void IssueFileRequests(uint64_t now);
+  bool WriteInfoFile();
+
+  std::string db_name_;
+  uint32_t slot_id_ = 0;
+  std::string dbsync_path_;
+
+  pstd::Mutex mu_;
+  State state_ = kRequestMeta;
+  uint64_t meta_request_time_ = 0;
+  std::string snapshot_uuid_;
+  LogOffset snapshot_offset_;
+
+  std::deque<DBSyncFileInfo> pending_files_;
+  std::map<std::string, FileState> active_files_;
+  size_t total_files_ = 0;
+  size_t done_files_ = 0;
+  uint64_t total_bytes_ = 0;
+  uint64_t received_bytes_ = 0;
+
+  // throttle by db-sync-speed
+  int64_t tokens_ = 0;
+  uint64_t last_refill_time_ = 0;
+  uint64_t start_time_ = 0;
+};
+
+#endif  // PIKA_DBSYNC_H_
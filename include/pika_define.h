@@ -32,12 +32,9 @@
 class PikaServer;
 
 /* Port shift */
-const int kPortShiftRSync = 1000;
 const int kPortShiftReplServer = 2000;
 
 const std::string kPikaPidFile = "pika.pid";
-const std::string kPikaSecretFile = "rsync.secret";
-const std::string kDefaultRsyncAuth = "default";
 
 struct DBStruct {
   DBStruct(std::string tn, const uint32_t pn, std::set<uint32_t> pi)
@@ -156,18 +153,6 @@ struct LogOffset {
   LogicOffset l_offset;
 };
 
-// dbsync arg
-struct DBSyncArg {
-  PikaServer* p;
-  std::string ip;
-  int port;
-  std::string db_name;
-  uint32_t slot_id;
-  DBSyncArg(PikaServer* const _p, std::string _ip, int _port, std::string _db_name,
-            uint32_t _slot_id)
-      : p(_p), ip(std::move(_ip)), port(_port), db_name(std::move(_db_name)), slot_id(_slot_id) {}
-};
-
 // rm define
 enum SlaveState {
   kSlaveNotSync = 0,
@@ -386,7 +371,12 @@ const int kMaxBitOpInputBit = 21;
  * db sync
  */
 const uint32_t kDBSyncMaxGap = 50;
-const std::string kDBSyncModule = "document";
+const uint64_t kDBSyncChunkSize = 4 << 20;  // 4MB
+const size_t kDBSyncMaxParallelFiles = 8;
+// unit microseconds
+const uint64_t kDBSyncRequestTimeout = 10 * 1000000;
+const uint64_t kDBSyncSessionTimeout = 60 * 1000000;
+const std::string kDBSyncSnapshotFile = "snapshot_uuid";
 
 const std::string kBgsaveInfoFile = "info";
 #endif
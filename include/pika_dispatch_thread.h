@@ -41,6 +41,7 @@ class PikaDispatchThread {
     using net::ServerHandle::AccessHandle;
     bool AccessHandle(std::string& ip) const override;
     void CronHandle() const override;
+    void FdClosedHandle(int fd, const std::string& ip_port) const override;
 
    private:
     PikaDispatchThread* pika_disptcher_ = nullptr;
@@ -126,6 +126,13 @@ class GeoHashCmd : public Cmd {
 class GeoRadiusCmd : public Cmd {
  public:
   GeoRadiusCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res{key_};
+    if (range_.store || range_.storedist) {
+      res.push_back(range_.storekey);
+    }
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -151,6 +158,13 @@ class GeoRadiusCmd : public Cmd {
 class GeoRadiusByMemberCmd : public Cmd {
  public:
   GeoRadiusByMemberCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res{key_};
+    if (range_.store || range_.storedist) {
+      res.push_back(range_.storekey);
+    }
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
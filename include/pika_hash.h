@@ -369,4 +369,84 @@ class PKHRScanRangeCmd : public Cmd {
     limit_ = 10;
   }
 };
+
+class HExpireCmd : public Cmd {
+ public:
+  HExpireCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    res.push_back(key_);
+    return res;
+  }
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new HExpireCmd(*this); }
+
+ private:
+  std::string key_;
+  int64_t sec_ = 0;
+  std::vector<std::string> fields_;
+  void DoInitial() override;
+  std::string ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
+                       uint64_t offset) override;
+};
+
+class HExpireatCmd : public Cmd {
+ public:
+  HExpireatCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    res.push_back(key_);
+    return res;
+  }
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new HExpireatCmd(*this); }
+
+ private:
+  std::string key_;
+  int64_t time_stamp_ = 0;
+  std::vector<std::string> fields_;
+  void DoInitial() override;
+};
+
+class HTtlCmd : public Cmd {
+ public:
+  HTtlCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    res.push_back(key_);
+    return res;
+  }
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new HTtlCmd(*this); }
+
+ private:
+  std::string key_;
+  std::vector<std::string> fields_;
+  void DoInitial() override;
+};
+
+class HPersistCmd : public Cmd {
+ public:
+  HPersistCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    res.push_back(key_);
+    return res;
+  }
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new HPersistCmd(*this); }
+
+ private:
+  std::string key_;
+  std::vector<std::string> fields_;
+  void DoInitial() override;
+};
 #endif
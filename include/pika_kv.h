@@ -70,6 +70,7 @@ class DelCmd : public Cmd {
   std::vector<std::string> current_key() const override { return keys_; }
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override;
   void Merge() override;
+  bool IsSplittable() const override { return true; }
   Cmd* Clone() override { return new DelCmd(*this); }
 
  private:
@@ -218,6 +219,7 @@ class MgetCmd : public Cmd {
   std::vector<std::string> current_key() const override { return keys_; }
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override;
   void Merge() override;
+  bool IsSplittable() const override { return true; }
   Cmd* Clone() override { return new MgetCmd(*this); }
 
  private:
@@ -340,6 +342,8 @@ class MsetCmd : public Cmd {
   }
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override;
   void Merge() override;
+  bool IsSplittable() const override { return true; }
+  PikaCmdArgsType SplitArgv(const HintKeys& hint_keys) const override;
   Cmd* Clone() override { return new MsetCmd(*this); }
 
  private:
@@ -350,6 +354,13 @@ class MsetCmd : public Cmd {
 class MsetnxCmd : public Cmd {
  public:
   MsetnxCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res;
+    for (const auto& kv : kvs_) {
+      res.push_back(kv.key);
+    }
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -426,6 +437,7 @@ class ExistsCmd : public Cmd {
   std::vector<std::string> current_key() const override { return keys_; }
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override;
   void Merge() override;
+  bool IsSplittable() const override { return true; }
   Cmd* Clone() override { return new ExistsCmd(*this); }
 
  private:
@@ -303,4 +303,112 @@ class RPushxCmd : public Cmd {
   std::vector<std::string> values_;
   virtual void DoInitial() override;
 };
+
+/*
+ * BlockingPopCmd is the base of BLPOP, BRPOP and BRPOPLPUSH. When every key is
+ * empty Do leaves the command blocked without a reply, the client connection
+ * parks it in PikaBlockedClients, which runs it again by Retry when one of the
+ * keys is pushed, or answers ReplyTimeout when it times out.
+ */
+class BlockingPopCmd : public Cmd {
+ public:
+  BlockingPopCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag){};
+  std::vector<std::string> current_key() const override { return keys_; }
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override{};
+  void Merge() override{};
+  bool is_blocked() const override { return blocked_; }
+
+  // keys waited for, in the order they are tried
+  const std::vector<std::string>& blocking_keys() const { return keys_; }
+  // 0 blocks forever
+  uint64_t timeout_us() const { return timeout_us_; }
+  void Retry();
+  virtual void ReplyTimeout() = 0;
+
+ protected:
+  // Pop from key, return false if key is empty and nothing is replied
+  virtual bool TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) = 0;
+  // Parse the keys in argv_[1, keys_end) and the timeout in the last argument
+  void InitialKeysAndTimeout(size_t keys_end);
+
+  std::vector<std::string> keys_;
+  uint64_t timeout_us_ = 0;
+  bool blocked_ = false;
+  std::string popped_key_;
+  std::string value_poped_;
+
+ private:
+  void Clear() override {
+    blocked_ = false;
+    popped_key_.clear();
+    value_poped_.clear();
+  }
+};
+
+class BLPopCmd : public BlockingPopCmd {
+ public:
+  BLPopCmd(const std::string& name, int arity, uint16_t flag) : BlockingPopCmd(name, arity, flag) {
+    lpop_cmd_ = std::make_shared<LPopCmd>(kCmdNameLPop, 2, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  };
+  BLPopCmd(const BLPopCmd& other) : BlockingPopCmd(other) {
+    lpop_cmd_ = std::make_shared<LPopCmd>(kCmdNameLPop, 2, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  }
+  Cmd* Clone() override { return new BLPopCmd(*this); }
+  void DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) override;
+  void ReplyTimeout() override;
+
+ private:
+  // used for write binlog
+  std::shared_ptr<Cmd> lpop_cmd_;
+  bool TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) override;
+  void DoInitial() override;
+};
+
+class BRPopCmd : public BlockingPopCmd {
+ public:
+  BRPopCmd(const std::string& name, int arity, uint16_t flag) : BlockingPopCmd(name, arity, flag) {
+    rpop_cmd_ = std::make_shared<RPopCmd>(kCmdNameRPop, 2, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  };
+  BRPopCmd(const BRPopCmd& other) : BlockingPopCmd(other) {
+    rpop_cmd_ = std::make_shared<RPopCmd>(kCmdNameRPop, 2, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  }
+  Cmd* Clone() override { return new BRPopCmd(*this); }
+  void DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) override;
+  void ReplyTimeout() override;
+
+ private:
+  // used for write binlog
+  std::shared_ptr<Cmd> rpop_cmd_;
+  bool TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) override;
+  void DoInitial() override;
+};
+
+class BRPopLPushCmd : public BlockingPopCmd {
+ public:
+  BRPopLPushCmd(const std::string& name, int arity, uint16_t flag) : BlockingPopCmd(name, arity, flag) {
+    rpop_cmd_ = std::make_shared<RPopCmd>(kCmdNameRPop, 2, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+    lpush_cmd_ = std::make_shared<LPushCmd>(kCmdNameLPush, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  };
+  BRPopLPushCmd(const BRPopLPushCmd& other) : BlockingPopCmd(other), receiver_(other.receiver_) {
+    rpop_cmd_ = std::make_shared<RPopCmd>(kCmdNameRPop, 2, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+    lpush_cmd_ = std::make_shared<LPushCmd>(kCmdNameLPush, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  }
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res = keys_;
+    res.push_back(receiver_);
+    return res;
+  }
+  Cmd* Clone() override { return new BRPopLPushCmd(*this); }
+  void DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) override;
+  void ReplyTimeout() override;
+
+ private:
+  std::string receiver_;
+  // used for write binlog
+  std::shared_ptr<Cmd> rpop_cmd_;
+  std::shared_ptr<Cmd> lpush_cmd_;
+  bool TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) override;
+  void DoInitial() override;
+};
 #endif
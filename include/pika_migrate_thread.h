@@ -4,6 +4,7 @@
 #include "include/pika_client_conn.h"
 #include "include/pika_command.h"
 #include "include/pika_slot.h"
+#include "include/pika_slot_command.h"
 #include "net/include/net_cli.h"
 #include "net/include/net_thread.h"
 #include "pika_client_conn.h"
@@ -23,9 +24,8 @@ class PikaParseSendThread : public net::Thread {
   void ExitThread(void);
 
  private:
-  int MigrateOneKey(net::NetCli *cli, const std::string key, const char key_type, bool async);
+  int MigrateOneKey(MigratePipeline *pipeline, const std::string key, const char key_type, bool async);
   void DelKeysAndWriteBinlog(std::deque<std::pair<const char, std::string>> &send_keys, const std::shared_ptr<Slot>& slot);
-  bool CheckMigrateRecv(int64_t need_receive_num);
   virtual void *ThreadMain();
 
  private:
@@ -54,6 +54,9 @@ class PikaMigrateThread : public net::Thread {
   void DecWorkingThreadNum(void);
   void OnTaskFailed(void);
   void AddResponseNum(int32_t response_num);
+  void AddSentBytes(int64_t bytes);
+  // The bytes sent to the target and the time spent since the migration started
+  void GetMigrateThroughput(int64_t *bytes, int64_t *elapsed_ms);
 
  private:
   void ResetThread(void);
@@ -78,6 +81,8 @@ class PikaMigrateThread : public net::Thread {
   std::atomic<int32_t> send_num_;
   std::atomic<int32_t> response_num_;
   std::atomic<int64_t> moved_num_;
+  std::atomic<int64_t> sent_bytes_;
+  uint64_t start_micros_ = 0;
   std::shared_ptr<Slot> slot;
 
   bool request_migrate_ = false;
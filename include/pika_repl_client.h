@@ -77,6 +77,11 @@ class PikaReplClient {
   pstd::Status SendMetaSync();
   pstd::Status SendSlotDBSync(const std::string& ip, uint32_t port, const std::string& db_name, uint32_t slot_id,
                              const BinlogOffset& boffset, const std::string& local_ip);
+  pstd::Status SendDBSyncMeta(const std::string& ip, uint32_t port, const std::string& db_name, uint32_t slot_id,
+                              const std::string& local_ip, int32_t session_id);
+  pstd::Status SendDBSyncFile(const std::string& ip, uint32_t port, const std::string& db_name, uint32_t slot_id,
+                              const std::string& local_ip, const std::string& snapshot_uuid,
+                              const std::string& filename, uint64_t offset, uint64_t count, int32_t session_id);
   pstd::Status SendSlotTrySync(const std::string& ip, uint32_t port, const std::string& db_name,
                               uint32_t slot_id, const BinlogOffset& boffset, const std::string& local_ip);
   pstd::Status SendSlotBinlogSync(const std::string& ip, uint32_t port, const std::string& db_name,
@@ -25,6 +25,8 @@ class PikaReplClientConn : public net::PbConn {
 
   static void HandleMetaSyncResponse(void* arg);
   static void HandleDBSyncResponse(void* arg);
+  static void HandleDBSyncMetaResponse(void* arg);
+  static void HandleDBSyncFileResponse(void* arg);
   static void HandleTrySyncResponse(void* arg);
   static void HandleRemoveSlaveNodeResponse(void* arg);
 
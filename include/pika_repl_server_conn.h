@@ -40,6 +40,8 @@ class PikaReplServerConn : public net::PbConn {
                                  InnerMessage::InnerResponse* response);
 
   static void HandleDBSyncRequest(void* arg);
+  static void HandleDBSyncMetaRequest(void* arg);
+  static void HandleDBSyncFileRequest(void* arg);
   static void HandleBinlogSyncRequest(void* arg);
   static void HandleRemoveSlaveNodeRequest(void* arg);
 
@@ -190,6 +190,9 @@ class PikaReplicaManager {
   pstd::Status SendRemoveSlaveNodeRequest(const std::string& table, uint32_t slot_id);
   pstd::Status SendSlotTrySyncRequest(const std::string& db_name, size_t slot_id);
   pstd::Status SendSlotDBSyncRequest(const std::string& db_name, size_t slot_id);
+  pstd::Status SendDBSyncMetaRequest(const std::string& db_name, uint32_t slot_id);
+  pstd::Status SendDBSyncFileRequest(const std::string& db_name, uint32_t slot_id, const std::string& snapshot_uuid,
+                                     const std::string& filename, uint64_t offset, uint64_t count);
   pstd::Status SendSlotBinlogSyncAckRequest(const std::string& table, uint32_t slot_id, const LogOffset& ack_start,
                                            const LogOffset& ack_end, bool is_first_send = false);
   pstd::Status CloseReplClientConn(const std::string& ip, int32_t port);
@@ -0,0 +1,88 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_SCRIPT_H_
+#define PIKA_SCRIPT_H_
+
+#include "include/pika_command.h"
+
+struct lua_State;
+
+/*
+ * script
+ *
+ * EVAL runs a lua script in the lua state of the worker thread, under the
+ * record locks of the KEYS of the script. redis.call() runs the commands in
+ * process, in one storage::BatchWriteScope like EXEC, and a command may only
+ * touch the KEYS. The script is replicated by its effects: the writes are
+ * logged as the binlog of an EXEC of them. A script that fails writes nothing.
+ */
+class EvalCmd : public Cmd {
+ public:
+  EvalCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override;
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new EvalCmd(*this); }
+  std::string ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
+                       uint64_t offset) override;
+  void DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) override;
+
+  // redis.call() and redis.pcall(), push the reply, return false if it is an error
+  bool LuaCall(lua_State* lua);
+
+ protected:
+  void TouchWatchedKeys() override;
+  // Parse the numkeys, keys and args after the script
+  void InitialKeysAndArgs();
+
+  std::string sha_;
+  std::string body_;
+  std::vector<std::string> keys_;
+  std::vector<std::string> args_;
+
+ private:
+  std::shared_ptr<Slot> slot_;
+  // the writes run by the script, and their binlogs, see Cmd::BinlogCapture
+  std::vector<std::shared_ptr<Cmd>> writes_;
+  std::vector<std::string> binlogs_;
+
+  void DoInitial() override;
+  void Clear() override {
+    sha_.clear();
+    body_.clear();
+    keys_.clear();
+    args_.clear();
+    slot_.reset();
+    writes_.clear();
+    binlogs_.clear();
+  }
+};
+
+class EvalShaCmd : public EvalCmd {
+ public:
+  EvalShaCmd(const std::string& name, int arity, uint16_t flag) : EvalCmd(name, arity, flag) {}
+  Cmd* Clone() override { return new EvalShaCmd(*this); }
+
+ private:
+  void DoInitial() override;
+};
+
+class ScriptCmd : public Cmd {
+ public:
+  ScriptCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new ScriptCmd(*this); }
+
+ private:
+  std::string subcommand_;
+  void DoInitial() override;
+  void Clear() override { subcommand_.clear(); }
+};
+
+#endif
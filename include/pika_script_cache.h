@@ -0,0 +1,40 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_SCRIPT_CACHE_H_
+#define PIKA_SCRIPT_CACHE_H_
+
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * PikaScriptCache keeps the body of the scripts run by EVAL or loaded by
+ * SCRIPT LOAD, keyed by the sha1 of the body, for EVALSHA. Every worker
+ * thread compiles the scripts into its own lua state on first use, and
+ * throws the state away when the generation changes, after SCRIPT FLUSH.
+ */
+class PikaScriptCache {
+ public:
+  // Return the sha1 of body
+  std::string Add(const std::string& body);
+  void Add(const std::string& sha, const std::string& body);
+  bool Get(const std::string& sha, std::string* body);
+  bool Exists(const std::string& sha);
+  void Flush();
+  uint64_t generation() const { return generation_.load(); }
+  // The memory of the lua states of all the threads, for INFO
+  void AddLuaMemory(int64_t delta) { lua_memory_ += delta; }
+  int64_t lua_memory() const { return lua_memory_.load(); }
+
+ private:
+  std::shared_mutex mu_;
+  std::unordered_map<std::string, std::string> scripts_;
+  std::atomic<uint64_t> generation_ = 0;
+  std::atomic<int64_t> lua_memory_ = 0;
+};
+
+#endif
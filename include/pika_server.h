@@ -27,6 +27,7 @@
 
 #include "include/pika_auxiliary_thread.h"
 #include "include/pika_binlog.h"
+#include "include/pika_blocked_clients.h"
 #include "include/pika_client_processor.h"
 #include "include/pika_conf.h"
 #include "include/pika_db.h"
@@ -34,8 +35,10 @@
 #include "include/pika_dispatch_thread.h"
 #include "include/pika_repl_client.h"
 #include "include/pika_repl_server.h"
-#include "include/pika_rsync_service.h"
 #include "include/pika_statistic.h"
+#include "include/pika_script_cache.h"
+#include "include/pika_watched_keys.h"
+#include "include/pika_client_tracking.h"
 #include "include/pika_slot_command.h"
 #include "include/pika_migrate_thread.h"
 
@@ -170,6 +173,8 @@ class PikaServer : public pstd::noncopyable {
   std::shared_ptr<DB> GetDB(const std::string& db_name);
   std::set<uint32_t> GetDBSlotIds(const std::string& db_name);
   bool IsBgSaving();
+  // the stall of the last bgsave of every slot, summed
+  void BgSaveStall(uint64_t* stall_us, uint64_t* avoided_stall_us);
   bool IsKeyScaning();
   bool IsCompacting();
   bool IsDBExist(const std::string& db_name);
@@ -184,6 +189,7 @@ class PikaServer : public pstd::noncopyable {
   void PrepareSlotTrySync();
   void SlotSetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys);
   void SlotSetSmallCompactionThreshold(uint32_t small_compaction_threshold);
+  void SlotSetActiveExpireCpuPercent(int active_expire_cpu_percent);
   bool GetDBSlotBinlogOffset(const std::string& db_name, uint32_t slot_id, BinlogOffset* boffset);
   std::shared_ptr<Slot> GetSlotByDBName(const std::string& db_name);
   std::shared_ptr<Slot> GetDBSlotById(const std::string& db_name, uint32_t slot_id);
@@ -257,9 +263,8 @@ class PikaServer : public pstd::noncopyable {
   /*
    * DBSync used
    */
-  void DBSync(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id);
   void TryDBSync(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id, int32_t top);
-  void DbSyncSendFile(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id);
+  void DBSyncSlaveActive(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id);
   std::string DbSyncTaskIndex(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id);
 
   /*
@@ -281,6 +286,35 @@ class PikaServer : public pstd::noncopyable {
   void AddMonitorMessage(const std::string& monitor_message);
   void AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr);
 
+  /*
+   * Blocking list used
+   */
+  PikaBlockedClients* blocked_clients() { return pika_blocked_clients_.get(); }
+
+  /*
+   * Transaction used
+   */
+  PikaWatchedKeys* watched_keys() { return &watched_keys_; }
+
+  /*
+   * Client tracking used
+   */
+  PikaClientTracking* client_tracking() { return &client_tracking_; }
+  // After keys of db_name are written, by the connection writer if any
+  void TouchKeys(const std::string& db_name, const std::vector<std::string>& keys,
+                 const std::shared_ptr<net::NetConn>& writer = nullptr);
+  // After every key of db_name, or of every db if db_name is empty, is written
+  void TouchAllKeys(const std::string& db_name);
+  // Before every key of db_name, or of every db if db_name is empty, is
+  // deleted: only the watched keys that exist are touched, a key written in
+  // between is touched by its write. The tracking clients are told after
+  void TouchKeysBeforeFlush(const std::string& db_name);
+
+  /*
+   * Script used
+   */
+  PikaScriptCache* script_cache() { return &script_cache_; }
+
   /*
    * Slowlog used
    */
@@ -334,6 +368,7 @@ class PikaServer : public pstd::noncopyable {
   int SlotsMigrateOne(const std::string &key, std::shared_ptr<Slot>slot);
   bool SlotsMigrateBatch(const std::string &ip, int64_t port, int64_t time_out, int64_t slots, int64_t keys_num, std::shared_ptr<Slot>slot);
   void GetSlotsMgrtSenderStatus(std::string *ip, int64_t *port, int64_t *slot, bool *migrating, int64_t *moved, int64_t *remained);
+  void GetSlotsMgrtSenderThroughput(int64_t *bytes, int64_t *elapsed_ms);
   bool SlotsMigrateAsyncCancel();
 
   std::shared_mutex bgsave_protector_;
@@ -468,7 +503,6 @@ class PikaServer : public pstd::noncopyable {
   void AutoCompactRange();
   void AutoPurge();
   void AutoDeleteExpiredDump();
-  void AutoKeepAliveRSync();
 
   std::string host_;
   int port_ = 0;
@@ -529,7 +563,8 @@ class PikaServer : public pstd::noncopyable {
    * DBSync used
    */
   pstd::Mutex db_sync_protector_;
-  std::unordered_set<std::string> db_sync_slaves_;
+  // task index -> last time the slave pulled the snapshot
+  std::unordered_map<std::string, uint64_t> db_sync_slaves_;
 
   /*
    * Keyscan used
@@ -543,14 +578,29 @@ class PikaServer : public pstd::noncopyable {
   std::set<std::weak_ptr<PikaClientConn>, std::owner_less<std::weak_ptr<PikaClientConn>>> pika_monitor_clients_;
 
   /*
-   * Rsync used
+   * Pubsub used
    */
-  std::unique_ptr<PikaRsyncService> pika_rsync_service_;
+  std::unique_ptr<net::PubSubThread> pika_pubsub_thread_;
 
   /*
-   * Pubsub used
+   * Blocking list used
    */
-  std::unique_ptr<net::PubSubThread> pika_pubsub_thread_;
+  std::unique_ptr<PikaBlockedClients> pika_blocked_clients_;
+
+  /*
+   * Transaction used
+   */
+  PikaWatchedKeys watched_keys_;
+
+  /*
+   * Client tracking used
+   */
+  PikaClientTracking client_tracking_;
+
+  /*
+   * Script used
+   */
+  PikaScriptCache script_cache_;
 
   /*
    * Communication used
@@ -132,6 +132,7 @@ class SRemCmd : public Cmd {
 class SUnionCmd : public Cmd {
  public:
   SUnionCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override { return keys_; }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -145,6 +146,11 @@ class SUnionCmd : public Cmd {
 class SUnionstoreCmd : public Cmd {
  public:
   SUnionstoreCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res = keys_;
+    res.push_back(dest_key_);
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -159,6 +165,7 @@ class SUnionstoreCmd : public Cmd {
 class SInterCmd : public Cmd {
  public:
   SInterCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override { return keys_; }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -172,6 +179,11 @@ class SInterCmd : public Cmd {
 class SInterstoreCmd : public Cmd {
  public:
   SInterstoreCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res = keys_;
+    res.push_back(dest_key_);
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -204,6 +216,7 @@ class SIsmemberCmd : public Cmd {
 class SDiffCmd : public Cmd {
  public:
   SDiffCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override { return keys_; }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -217,6 +230,11 @@ class SDiffCmd : public Cmd {
 class SDiffstoreCmd : public Cmd {
  public:
   SDiffstoreCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res = keys_;
+    res.push_back(dest_key_);
+    return res;
+  }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
@@ -231,6 +249,7 @@ class SDiffstoreCmd : public Cmd {
 class SMoveCmd : public Cmd {
  public:
   SMoveCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override { return {src_key_, dest_key_}; }
   void Do(std::shared_ptr<Slot> slot = nullptr) override;
   void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
   void Merge() override {};
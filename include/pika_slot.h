@@ -8,14 +8,17 @@
 
 #include <shared_mutex>
 
+#include "pstd/include/pstd_mutex.h"
 #include "pstd/include/scope_record_lock.h"
 
 #include "storage/backupable.h"
 #include "storage/storage.h"
 
 #include "include/pika_binlog.h"
+#include "include/pika_dbsync.h"
 
 class Cmd;
+class SyncMasterSlot;
 
 /*
  *Keyscan used
@@ -37,12 +40,21 @@ struct BgSaveInfo {
   time_t start_time = 0;
   std::string s_start_time;
   std::string path;
+  // the dump the incremental bgsave is based on, empty for none
+  std::string base_path;
   LogOffset offset;
+  // how long the commands were held to start the bgsave, and how long more
+  // they would have been without pinning it at the sequence numbers
+  uint64_t stall_us = 0;
+  uint64_t avoided_stall_us = 0;
   BgSaveInfo() = default;
   void Clear() {
     bgsaving = false;
     path.clear();
+    base_path.clear();
     offset = LogOffset();
+    stall_us = 0;
+    avoided_stall_us = 0;
   }
 };
 
@@ -57,15 +69,19 @@ class Slot : public std::enable_shared_from_this<Slot>,public pstd::noncopyable
   std::shared_ptr<storage::Storage> db() const;
 
   void Compact(const storage::DataType& type);
+  // Ingest the sst files built by a storage::SstBuilder under path
+  rocksdb::Status IngestExternalFiles(const std::string& path);
 
   void DbRWLockWriter();
+  void DbRWUnLockWriter();
   void DbRWLockReader();
-  void DbRWUnLock();
+  void DbRWUnLockReader();
 
   std::shared_ptr<pstd::lock::LockMgr> LockMgr();
 
-  void PrepareRsync();
+  void PrepareDBSync();
   bool TryUpdateMasterOffset();
+  std::shared_ptr<DBSyncReceiver> GetDBSyncReceiver();
   bool ChangeDb(const std::string& new_path);
 
   void Leave();
@@ -101,12 +117,14 @@ class Slot : public std::enable_shared_from_this<Slot>,public pstd::noncopyable
 
   bool opened_ = false;
 
-  std::shared_mutex db_rwlock_;
+  // taken shared by every command, exclusively by db swap and flush
+  pstd::ShardedRWMutex db_rwlock_;
   // class may be shared, using shared_ptr would be a better choice
   std::shared_ptr<pstd::lock::LockMgr> lock_mgr_;
   std::shared_ptr<storage::Storage> db_;
 
   bool full_sync_ = false;
+  std::shared_ptr<DBSyncReceiver> dbsync_receiver_;
 
   pstd::Mutex key_info_protector_;
   KeyScanInfo key_scan_info_;
@@ -117,7 +135,10 @@ class Slot : public std::enable_shared_from_this<Slot>,public pstd::noncopyable
   static void DoBgSave(void* arg);
   bool RunBgsaveEngine();
   bool InitBgsaveEnv();
+  std::string FindBgsaveBase(const std::string& time_sub_path);
   bool InitBgsaveEngine();
+  bool InitBgsaveEnginePinned(const std::shared_ptr<SyncMasterSlot>& slot);
+  void GetBgsaveOffset(const std::shared_ptr<SyncMasterSlot>& slot, LogOffset* bgsave_offset);
   void ClearBgsave();
   void FinishBgsave();
   BgSaveInfo bgsave_info_;
@@ -12,6 +12,8 @@
 const std::string SlotKeyPrefix = "_internal:slotkey:4migrate:";
 const std::string SlotTagPrefix = "_internal:slottag:4migrate:";
 const size_t MaxKeySendSize = 10 * 1024;
+// the bytes of commands put into one write to the migration target
+const size_t MigrateSendBufSize = 1024 * 1024;
 
 extern uint32_t crc32tab[256];
 
@@ -34,6 +36,41 @@ int GetSlotsID(const std::string &str, uint32_t *pcrc, int *phastag);
 void RemSlotKeyByType(const std::string &type, const std::string &key, const std::shared_ptr<Slot>& slot);
 void WriteSAddToBinlog(const std::string &key, const std::string &value, const std::shared_ptr<Slot>& slot);
 
+/*
+ * MigratePipeline streams the commands that rebuild the migrated keys over one
+ * connection to the target. The commands are batched into writes of up to
+ * MigrateSendBufSize bytes and the replies are read only when window commands
+ * are in flight, so many keys share one round trip and a big key never sits
+ * in memory as a whole.
+ */
+class MigratePipeline {
+ public:
+  MigratePipeline(net::NetCli *cli, int64_t window) : cli_(cli), window_(window > 0 ? window : 1) {}
+
+  bool Append(const net::RedisCmdArgsType &argv);
+  bool Append(const std::string &cmd);
+  // Send what is buffered and wait for every reply
+  bool Drain();
+
+  int64_t commands() const { return commands_; }
+  int64_t bytes_sent() const { return bytes_sent_; }
+  const std::string &error() const { return error_; }
+
+ private:
+  bool Flush();
+  bool Recv(int64_t num);
+
+  net::NetCli *cli_ = nullptr;
+  int64_t window_ = 1;
+  std::string buf_;
+  // the commands in buf_ and the ones sent without a reply yet
+  int64_t buffered_ = 0;
+  int64_t in_flight_ = 0;
+  int64_t commands_ = 0;
+  int64_t bytes_sent_ = 0;
+  std::string error_;
+};
+
 class PikaMigrate {
  public:
   PikaMigrate();
@@ -61,18 +98,14 @@ class PikaMigrate {
   void KillMigrateClient(net::NetCli *migrate_cli);
   void KillAllMigrateClient();
 
-  int MigrateSend(net::NetCli *migrate_cli, const std::string &key, const char type, std::string &detail,
-                  const std::shared_ptr<Slot>& slot);
-  bool MigrateRecv(net::NetCli *migrate_cli, int need_receive, std::string &detail);
-
-  int ParseKey(const std::string &key, const char type, std::string &wbuf_str, const std::shared_ptr<Slot>& slot);
+  int ParseKey(const std::string &key, const char type, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot);
   int64_t TTLByType(const char key_type, const std::string &key, const std::shared_ptr<Slot>& slot);
-  int ParseKKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot);
-  int ParseZKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot);
-  int ParseSKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot);
-  int ParseHKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot);
-  int ParseLKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot);
-  bool SetTTL(const std::string &key, std::string &wbuf_str, int64_t ttl);
+  int ParseKKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot);
+  int ParseZKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot);
+  int ParseSKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot);
+  int ParseHKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot);
+  int ParseLKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot);
+  bool SetTTL(const std::string &key, MigratePipeline *pipeline, int64_t ttl);
 };
 
 class SlotsMgrtTagSlotCmd : public Cmd {
@@ -0,0 +1,110 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_TRANSACTION_H_
+#define PIKA_TRANSACTION_H_
+
+#include "include/pika_command.h"
+#include "include/pika_watched_keys.h"
+
+/*
+ * transaction
+ */
+class MultiCmd : public Cmd {
+ public:
+  MultiCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new MultiCmd(*this); }
+
+ private:
+  void DoInitial() override;
+};
+
+/*
+ * EXEC runs the queued commands under the record locks of all their keys, and
+ * of the watched ones, in one storage::BatchWriteScope, so the writes to each
+ * type db land in one WriteBatch. The writes are logged as one binlog:
+ * exec <binlog of write 1> <binlog of write 2> ..., which a slave applies
+ * the same way.
+ */
+class ExecCmd : public Cmd {
+ public:
+  ExecCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  std::vector<std::string> current_key() const override;
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new ExecCmd(*this); }
+  std::string ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
+                       uint64_t offset) override;
+  void DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) override;
+  // The binlog of an EXEC of the writes captured in binlogs
+  static std::string ExecBinlog(const std::vector<std::string>& binlogs, uint32_t exec_time, uint32_t term_id,
+                                uint64_t logic_id, uint32_t filenum, uint64_t offset);
+
+ protected:
+  void TouchWatchedKeys() override;
+
+ private:
+  std::vector<std::shared_ptr<Cmd>> cmds_;
+  std::vector<std::string> watched_keys_;
+  PikaWatchedKeys::Flag watch_flag_;
+  // the binlogs of the writes of cmds_, see Cmd::BinlogCapture
+  std::vector<std::string> binlogs_;
+  // applying the binlog of an EXEC
+  bool replay_ = false;
+
+  void DoInitial() override;
+  void InitialReplay();
+  void Clear() override {
+    cmds_.clear();
+    watched_keys_.clear();
+    watch_flag_.reset();
+    binlogs_.clear();
+    replay_ = false;
+  }
+};
+
+class DiscardCmd : public Cmd {
+ public:
+  DiscardCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new DiscardCmd(*this); }
+
+ private:
+  void DoInitial() override;
+};
+
+class WatchCmd : public Cmd {
+ public:
+  WatchCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new WatchCmd(*this); }
+
+ private:
+  std::vector<std::string> keys_;
+  void DoInitial() override;
+  void Clear() override { keys_.clear(); }
+};
+
+class UnWatchCmd : public Cmd {
+ public:
+  UnWatchCmd(const std::string& name, int arity, uint16_t flag) : Cmd(name, arity, flag) {}
+  void Do(std::shared_ptr<Slot> slot = nullptr) override;
+  void Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) override {};
+  void Merge() override {};
+  Cmd* Clone() override { return new UnWatchCmd(*this); }
+
+ private:
+  void DoInitial() override;
+};
+
+#endif
@@ -0,0 +1,47 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_WATCHED_KEYS_H_
+#define PIKA_WATCHED_KEYS_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * PikaWatchedKeys maps the keys WATCHed by the clients to the flags of the
+ * clients. A write sets the flag of every client watching one of its keys,
+ * which fails the next EXEC of the client. Writes touch the keys under their
+ * record locks, and EXEC checks the flag under the locks of the watched keys,
+ * so no write is missed in between.
+ */
+class PikaWatchedKeys {
+ public:
+  using Flag = std::shared_ptr<std::atomic<bool>>;
+
+  void Watch(const std::string& db_name, const std::string& key, const Flag& flag);
+  void Unwatch(const std::string& db_name, const std::string& key, const Flag& flag);
+
+  void Touch(const std::string& db_name, const std::vector<std::string>& keys);
+  // Touch every key of db_name, or of every db if db_name is empty
+  void TouchAll(const std::string& db_name);
+  // The db and the key of the keys watched in db_name, or in every db if
+  // db_name is empty
+  std::vector<std::pair<std::string, std::string>> WatchedKeys(const std::string& db_name);
+
+ private:
+  static std::string DBKey(const std::string& db_name, const std::string& key);
+
+  std::mutex mu_;
+  std::unordered_map<std::string, std::vector<Flag>> keys_;
+  // lets the writes skip the mutex while nothing is watched
+  std::atomic<size_t> num_watched_ = 0;
+};
+
+#endif
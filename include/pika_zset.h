@@ -241,6 +241,11 @@ class ZsetUIstoreParentCmd : public Cmd {
  public:
   ZsetUIstoreParentCmd(const std::string& name, int arity, uint16_t flag)
       : Cmd(name, arity, flag), aggregate_(storage::SUM) {}
+  std::vector<std::string> current_key() const override {
+    std::vector<std::string> res = keys_;
+    res.push_back(dest_key_);
+    return res;
+  }
 
  protected:
   std::string dest_key_;
@@ -7,6 +7,7 @@
 #define NET_INCLUDE_NET_CONN_H_
 
 #include <sys/time.h>
+#include <atomic>
 #include <sstream>
 #include <string>
 
@@ -46,6 +47,9 @@ class NetConn : public std::enable_shared_from_this<NetConn>, public pstd::nonco
   virtual ReadStatus GetRequest() = 0;
   virtual WriteStatus SendReply() = 0;
   virtual int WriteResp(const std::string& resp) { return 0; }
+  // Move the messages other threads queued for the conn to its replies, on
+  // the thread of the conn, false if there are none or its commands run
+  virtual bool TakePushes() { return false; }
 
   virtual void TryResizeBuffer() {}
 
@@ -70,6 +74,11 @@ class NetConn : public std::enable_shared_from_this<NetConn>, public pstd::nonco
   std::string name() { return name_; }
   void set_name(std::string name) { name_ = std::move(name); }
 
+  // The protocol of the replies, 2 or 3 as chosen by HELLO, read by the
+  // pubsub thread too
+  int resp_version() const { return resp_version_.load(); }
+  void set_resp_version(int resp_version) { resp_version_.store(resp_version); }
+
   bool IsClose() { return close_; }
   void SetClose(bool close);
 
@@ -104,6 +113,7 @@ class NetConn : public std::enable_shared_from_this<NetConn>, public pstd::nonco
   struct timeval last_interaction_;
   int flags_ = 0;
   std::string name_;
+  std::atomic<int> resp_version_{2};
 
 #ifdef __ENABLE_SSL
   SSL* ssl_;
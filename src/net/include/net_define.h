@@ -40,8 +40,11 @@ enum NotifyType {
   kNotiEpollout = 2,
   kNotiEpollin = 3,
   kNotiEpolloutAndEpollin = 4,
+  // written to by another thread, see RedisConn::WritePush
   kNotiWrite = 5,
   kNotiWait = 6,
+  // wait for the reply with nothing to read, only the close of the peer is watched
+  kNotiWaitClose = 7,
 };
 
 enum EventStatus {
@@ -49,6 +52,16 @@ enum EventStatus {
   kReadable = 0x1,
   kWritable = 0x1 << 1,
   kErrorEvent = 0x1 << 2,
+  // watch the close of the peer only, fired as kErrorEvent, not watched by kqueue
+  kPeerClosed = 0x1 << 3,
+};
+
+/*
+ * The multiplexer used by the worker threads
+ */
+enum MultiplexerType {
+  kMultiplexerEpoll = 0,
+  kMultiplexerIoUring = 1,
 };
 
 enum ConnStatus {
@@ -93,6 +106,7 @@ enum RetCode {
 #define DEFAULT_WBUF_SIZE 262144         // 256KB
 #define REDIS_INLINE_MAXLEN (1024 * 64)  // 64KB
 #define REDIS_IOBUF_LEN 16384            // 16KB
+#define REDIS_MAX_IOVCNT 128             // iovecs per writev
 #define REDIS_REQ_INLINE 1
 #define REDIS_REQ_MULTIBULK 2
 
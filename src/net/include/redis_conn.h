@@ -6,7 +6,10 @@
 #ifndef NET_INCLUDE_REDIS_CONN_H_
 #define NET_INCLUDE_REDIS_CONN_H_
 
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -30,6 +33,12 @@ class RedisConn : public NetConn {
   ReadStatus GetRequest() override;
   WriteStatus SendReply() override;
   int WriteResp(const std::string& resp) override;
+  // Queue the reply without copying it, resp must not be modified afterwards
+  int WriteResp(std::shared_ptr<std::string> resp);
+  // Queue a message from another thread, the thread of the conn sends it
+  // once no batch of the commands of the conn runs
+  void WritePush(const std::string& message);
+  bool TakePushes() override;
 
   void TryResizeBuffer() override;
   void SetHandleType(const HandleType& handle_type);
@@ -37,6 +46,9 @@ class RedisConn : public NetConn {
 
   virtual void ProcessRedisCmds(const std::vector<RedisCmdArgsType>& argvs, bool async, std::string* response);
   void NotifyEpoll(bool success);
+  // The reply is waited for with nothing more to read, only the close of the
+  // peer is watched by the worker until NotifyEpoll
+  void NotifyWaitClose();
 
   virtual int DealMessage(const RedisCmdArgsType& argv, std::string* response) = 0;
 
@@ -44,6 +56,11 @@ class RedisConn : public NetConn {
   static int ParserDealMessageCb(RedisParser* parser, const RedisCmdArgsType& argv);
   static int ParserCompleteCb(RedisParser* parser, const std::vector<RedisCmdArgsType>& argvs);
   ReadStatus ParseRedisParserStatus(RedisParserStatus status);
+  // Move the replies appended into response_ to the tail of wqueue_
+  void SealResponse();
+  // Move the messages of WritePush to the tail of wqueue_, false if there
+  // are none or a batch runs
+  bool SealPushes();
 
   HandleType handle_type_ = kSynchronous;
 
@@ -53,9 +70,19 @@ class RedisConn : public NetConn {
   int msg_peak_ = 0;
   int command_len_ = 0;
 
-  uint32_t wbuf_pos_ = 0;
+  // Replies waiting to be sent, they are sent in order by writev
+  std::deque<std::shared_ptr<std::string>> wqueue_;
+  size_t wqueue_pos_ = 0;  // sent bytes of the front reply
   std::string response_;
 
+  // The messages of WritePush. A batch of commands owns the replies from
+  // ProcessRedisCmds to NotifyEpoll, the messages wait for its end
+  std::mutex push_mu_;
+  std::string pushes_;
+  bool in_batch_ = false;
+  // the thread of the conn is told of the messages
+  bool push_notified_ = false;
+
   // For Redis Protocol parser
   int last_read_pos_ = -1;
   RedisParser redis_parser_;
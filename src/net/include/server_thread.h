@@ -127,6 +127,14 @@ class ServerThread : public Thread {
 
   int SetTcpNoDelay(int connfd);
 
+  /*
+   * Every worker listens on the port with SO_REUSEPORT and accepts its own
+   * connections, set before StartThread, default: false
+   * Just DispatchThread has supported for now.
+   */
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+  bool reuse_port() const { return reuse_port_; }
+
   /*
    * StartThread will return the error code as pthread_create
    * Return 0 if success
@@ -187,11 +195,14 @@ class ServerThread : public Thread {
    * The tcp server port and address
    */
   int port_ = -1;
+  bool reuse_port_ = false;
   std::set<std::string> ips_;
   std::vector<std::shared_ptr<ServerSocket>> server_sockets_;
   std::set<int32_t> server_fds_;
 
   virtual int InitHandle();
+  // Accept a connection on listen_fd, return the connfd or -1
+  int AcceptConn(int listen_fd, std::string* ip_port);
   void* ThreadMain() override;
   /*
    * The server event handle
@@ -212,6 +223,12 @@ extern ServerThread* NewHolyThread(const std::set<std::string>& bind_ips, int po
 extern ServerThread* NewHolyThread(const std::set<std::string>& bind_ips, int port, ConnFactory* conn_factory,
                                    bool async, int cron_interval = 0, const ServerHandle* handle = nullptr);
 
+/**
+ * Select the multiplexer of the worker threads created afterwards,
+ * epoll is used by default
+ */
+extern void SetWorkerMultiplexerType(MultiplexerType type);
+
 /**
  * This type Dispatch thread just get Connection and then Dispatch the fd to
  * worker thread
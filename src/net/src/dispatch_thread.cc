@@ -3,6 +3,7 @@
 // LICENSE file in the root directory of this source tree. An additional grant
 // of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
 #include <vector>
 
 #include <glog/logging.h>
@@ -53,12 +54,23 @@ DispatchThread::DispatchThread(const std::set<std::string>& ips, int port, int w
 DispatchThread::~DispatchThread() = default;
 
 int DispatchThread::StartThread() {
+  if (reuse_port_ && ips_.find("0.0.0.0") != ips_.end()) {
+    ips_.clear();
+    ips_.insert("0.0.0.0");
+  }
   for (int i = 0; i < work_num_; i++) {
     int ret = handle_->CreateWorkerSpecificData(&(worker_thread_[i]->private_data_));
     if (ret) {
       return ret;
     }
 
+    if (reuse_port_) {
+      ret = worker_thread_[i]->ListenReusePort(ips_, port_);
+      if (ret != kSuccess) {
+        return ret;
+      }
+    }
+
     if (!thread_name().empty()) {
       worker_thread_[i]->set_thread_name("WorkerThread");
     }
@@ -70,6 +82,13 @@ int DispatchThread::StartThread() {
   return ServerThread::StartThread();
 }
 
+int DispatchThread::InitHandle() {
+  if (reuse_port_) {
+    return kSuccess;
+  }
+  return ServerThread::InitHandle();
+}
+
 int DispatchThread::StopThread() {
   for (int i = 0; i < work_num_; i++) {
     worker_thread_[i]->set_should_stop();
@@ -124,14 +143,32 @@ std::shared_ptr<NetConn> DispatchThread::MoveConnOut(int fd) {
 }
 
 void DispatchThread::MoveConnIn(std::shared_ptr<NetConn> conn, const NotifyType& type) {
-  std::unique_ptr<WorkerThread>& worker_thread = worker_thread_[last_thread_];
+  int next_thread = WorkersByLoad().front();
+  std::unique_ptr<WorkerThread>& worker_thread = worker_thread_[next_thread];
   bool success = worker_thread->MoveConnIn(conn, type, true);
   if (success) {
-    last_thread_ = (last_thread_ + 1) % work_num_;
+    last_thread_ = next_thread;
     conn->set_net_multiplexer(worker_thread->net_multiplexer());
   }
 }
 
+std::vector<int> DispatchThread::WorkersByLoad() const {
+  std::vector<std::pair<int, int>> loads;
+  loads.reserve(work_num_);
+  for (int cnt = 1; cnt <= work_num_; cnt++) {
+    int idx = (last_thread_ + cnt) % work_num_;
+    loads.emplace_back(worker_thread_[idx]->load(), idx);
+  }
+  std::stable_sort(loads.begin(), loads.end(),
+                   [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+  std::vector<int> workers;
+  workers.reserve(work_num_);
+  for (const auto& load : loads) {
+    workers.push_back(load.second);
+  }
+  return workers;
+}
+
 bool DispatchThread::KillConn(const std::string& ip_port) {
   bool result = false;
   for (int i = 0; i < work_num_; ++i) {
@@ -144,20 +181,18 @@ void DispatchThread::KillAllConns() { KillConn(kKillAllConnsTask); }
 
 void DispatchThread::HandleNewConn(const int connfd, const std::string& ip_port) {
   // Slow workers may consume many fds.
-  // We simply loop to find next legal worker.
+  // Try the least loaded worker first, then the others.
   NetItem ti(connfd, ip_port);
   LOG(INFO) << "accept new conn " << ti.String();
-  int next_thread = last_thread_;
   bool find = false;
-  for (int cnt = 0; cnt < work_num_; cnt++) {
+  for (int next_thread : WorkersByLoad()) {
     std::unique_ptr<WorkerThread>& worker_thread = worker_thread_[next_thread];
     find = worker_thread->MoveConnIn(ti, false);
     if (find) {
-      last_thread_ = (next_thread + 1) % work_num_;
-      LOG(INFO) << "find worker(" << next_thread << "), refresh the last_thread_ to " << last_thread_;
+      last_thread_ = next_thread;
+      LOG(INFO) << "find worker(" << next_thread << "), load " << worker_thread->load();
       break;
     }
-    next_thread = (next_thread + 1) % work_num_;
   }
 
   if (!find) {
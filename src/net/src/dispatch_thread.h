@@ -57,8 +57,8 @@ class DispatchThread : public ServerThread {
 
  private:
   /*
-   * Here we used auto poll to find the next work thread,
-   * last_thread_ is the last work thread
+   * New connections go to the least loaded worker, ties are broken
+   * by auto poll, last_thread_ is the last work thread
    */
   int last_thread_;
   int work_num_;
@@ -69,6 +69,12 @@ class DispatchThread : public ServerThread {
   int queue_limit_;
   std::map<WorkerThread*, void*> localdata_;
 
+  // Workers ordered by load, starting after last_thread_ among equals
+  std::vector<int> WorkersByLoad() const;
+
+  // Workers listen on the port themselves if reuse_port is enabled
+  int InitHandle() override;
+
   void HandleConnEvent(NetFiredEvent* pfe) override { UNUSED(pfe); }
 
 };  // class DispatchThread
@@ -4,6 +4,7 @@
 // of patent rights can be found in the PATENTS file in the same directory.
 
 #include "net/src/net_epoll.h"
+#include "net/src/net_uring.h"
 
 #include <fcntl.h>
 #include <linux/version.h>
@@ -18,6 +19,16 @@ namespace net {
 
 NetMultiplexer* CreateNetMultiplexer(int limit) { return new NetEpoll(limit); }
 
+NetMultiplexer* CreateNetMultiplexer(MultiplexerType type, int limit) {
+  if (type == kMultiplexerIoUring) {
+    if (NetMultiplexer* uring = NetUring::Create(limit)) {
+      return uring;
+    }
+    LOG(WARNING) << "io_uring is not available, fall back to epoll";
+  }
+  return new NetEpoll(limit);
+}
+
 NetEpoll::NetEpoll(int queue_limit) : NetMultiplexer(queue_limit) {
 #if defined(EPOLL_CLOEXEC)
   multiplexer_ = epoll_create1(EPOLL_CLOEXEC);
@@ -46,6 +57,9 @@ int NetEpoll::NetAddEvent(int fd, int mask) {
   if (mask & kWritable) {
     ee.events |= EPOLLOUT;
     }
+  if (mask & kPeerClosed) {
+    ee.events |= EPOLLRDHUP;
+  }
 
   return epoll_ctl(multiplexer_, EPOLL_CTL_ADD, fd, &ee);
 }
@@ -62,6 +76,9 @@ int NetEpoll::NetModEvent(int fd, int old_mask, int mask) {
   if ((old_mask | mask) & kWritable) {
     ee.events |= EPOLLOUT;
   }
+  if ((old_mask | mask) & kPeerClosed) {
+    ee.events |= EPOLLRDHUP;
+  }
   return epoll_ctl(multiplexer_, EPOLL_CTL_MOD, fd, &ee);
 }
 
@@ -93,7 +110,7 @@ int NetEpoll::NetPoll(int timeout) {
       ev.mask |= kWritable;
     }
 
-    if (events_[i].events & (EPOLLERR | EPOLLHUP)) {
+    if (events_[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
       ev.mask |= kErrorEvent;
     }
   }
@@ -18,6 +18,8 @@ namespace net {
 
 NetMultiplexer* CreateNetMultiplexer(int limit) { return new NetKqueue(limit); }
 
+NetMultiplexer* CreateNetMultiplexer([[maybe_unused]] MultiplexerType type, int limit) { return new NetKqueue(limit); }
+
 NetKqueue::NetKqueue(int queue_limit) : NetMultiplexer(queue_limit) {
   multiplexer_ = ::kqueue();
   LOG(INFO) << "create kqueue";
@@ -7,14 +7,22 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <atomic>
 #include <cstdlib>
 
 #include <glog/logging.h>
 
+#include "net/include/server_thread.h"
 #include "pstd/include/xdebug.h"
 
 namespace net {
 
+static std::atomic<MultiplexerType> worker_multiplexer_type{kMultiplexerEpoll};
+
+void SetWorkerMultiplexerType(MultiplexerType type) { worker_multiplexer_type.store(type); }
+
+MultiplexerType WorkerMultiplexerType() { return worker_multiplexer_type.load(); }
+
 NetMultiplexer::NetMultiplexer(int queue_limit) : queue_limit_(queue_limit), fired_events_(NET_MAX_CLIENTS) {
   int fds[2];
   if (pipe(fds) != 0) {
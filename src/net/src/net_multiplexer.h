@@ -8,6 +8,7 @@
 #include <queue>
 #include <vector>
 
+#include "net/include/net_define.h"
 #include "net/src/net_item.h"
 #include "pstd/include/pstd_mutex.h"
 
@@ -60,6 +61,10 @@ class NetMultiplexer {
 };
 
 NetMultiplexer* CreateNetMultiplexer(int queue_limit = NetMultiplexer::kUnlimitedQueue);
+// Fall back to the default multiplexer if type is not supported
+NetMultiplexer* CreateNetMultiplexer(MultiplexerType type, int queue_limit = NetMultiplexer::kUnlimitedQueue);
+
+MultiplexerType WorkerMultiplexerType();
 
 }  // namespace net
 #endif  // NET_SRC_NET_EPOLL_H_
@@ -14,13 +14,15 @@
 
 namespace net {
 
+// A push message to a RESP3 connection
 static std::string ConstructPublishResp(const std::string& subscribe_channel, const std::string& publish_channel,
-                                        const std::string& msg, const bool pattern) {
+                                        const std::string& msg, const bool pattern, int resp_version) {
   std::stringstream resp;
   std::string common_msg = "message";
   std::string pattern_msg = "pmessage";
+  const char* array = resp_version == 3 ? ">" : "*";
   if (pattern) {
-    resp << "*4\r\n"
+    resp << array << "4\r\n"
          << "$" << pattern_msg.length() << "\r\n"
          << pattern_msg << "\r\n"
          << "$" << subscribe_channel.length() << "\r\n"
@@ -30,7 +32,7 @@ static std::string ConstructPublishResp(const std::string& subscribe_channel, co
          << "$" << msg.length() << "\r\n"
          << msg << "\r\n";
   } else {
-    resp << "*3\r\n"
+    resp << array << "3\r\n"
          << "$" << common_msg.length() << "\r\n"
          << common_msg << "\r\n"
          << "$" << publish_channel.length() << "\r\n"
@@ -357,6 +359,17 @@ void* PubSubThread::ThreadMain() {
             } else if (ti.notify_type() == kNotiWait) {
               // do not register events
               net_multiplexer_->NetAddEvent(ti.fd(), 0);
+            } else if (ti.notify_type() == kNotiWrite) {
+              std::shared_ptr<NetConn> conn;
+              {
+                std::shared_lock l(rwlock_);
+                if (auto iter = conns_.find(ti.fd()); iter != conns_.end()) {
+                  conn = iter->second->conn;
+                }
+              }
+              if (conn && conn->TakePushes()) {
+                net_multiplexer_->NetModEvent(ti.fd(), 0, kWritable | kReadable);
+              }
             }
           }
           continue;
@@ -381,7 +394,7 @@ void* PubSubThread::ThreadMain() {
               if (!IsReady(it->second[i]->fd())) {
                 continue;
               }
-              std::string resp = ConstructPublishResp(it->first, channel, msg, false);
+              std::string resp = ConstructPublishResp(it->first, channel, msg, false, it->second[i]->resp_version());
               it->second[i]->WriteResp(resp);
               WriteStatus write_status = it->second[i]->SendReply();
               if (write_status == kWriteHalf) {
@@ -408,7 +421,7 @@ void* PubSubThread::ThreadMain() {
                 if (!IsReady(it.second[i]->fd())) {
                   continue;
                 }
-                std::string resp = ConstructPublishResp(it.first, channel, msg, true);
+                std::string resp = ConstructPublishResp(it.first, channel, msg, true, it.second[i]->resp_version());
                 it.second[i]->WriteResp(resp);
                 WriteStatus write_status = it.second[i]->SendReply();
                 if (write_status == kWriteHalf) {
@@ -0,0 +1,327 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "net/src/net_uring.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "net/include/net_define.h"
+
+namespace net {
+
+static const unsigned kUringSqEntries = 1024;
+static const unsigned kUringCqEntries = 4 * NET_MAX_CLIENTS;
+// user data of poll remove requests, never a valid poll user data
+static const uint64_t kUringCancelData = ~0ULL;
+
+static inline uint64_t PollUserData(int fd, uint32_t gen) {
+  return (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd);
+}
+
+static inline unsigned LoadAcquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+static inline void StoreRelease(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+NetUring* NetUring::Create(int queue_limit) {
+  auto* uring = new NetUring(queue_limit);
+  if (!uring->Setup()) {
+    delete uring;
+    return nullptr;
+  }
+  return uring;
+}
+
+NetUring::NetUring(int queue_limit) : NetMultiplexer(queue_limit) {}
+
+NetUring::~NetUring() {
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+}
+
+bool NetUring::Setup() {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE;
+  p.cq_entries = kUringCqEntries;
+
+  multiplexer_ = static_cast<int>(syscall(__NR_io_uring_setup, kUringSqEntries, &p));
+  if (multiplexer_ < 0) {
+    LOG(WARNING) << "io_uring setup fail: " << strerror(errno);
+    return false;
+  }
+  fcntl(multiplexer_, F_SETFD, fcntl(multiplexer_, F_GETFD) | FD_CLOEXEC);
+
+  // The timeout of NetPoll is passed by IORING_ENTER_EXT_ARG, and completions
+  // must not be dropped when the completion queue is full
+  if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) {
+    LOG(WARNING) << "io_uring lacks required features, kernel 5.11 or later is needed";
+    return false;
+  }
+
+  sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  void* ptr = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, multiplexer_,
+                   IORING_OFF_SQ_RING);
+  if (ptr == MAP_FAILED) {
+    LOG(WARNING) << "io_uring mmap sq ring fail: " << strerror(errno);
+    return false;
+  }
+  sq_ring_ = ptr;
+
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    ptr = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, multiplexer_,
+               IORING_OFF_CQ_RING);
+    if (ptr == MAP_FAILED) {
+      LOG(WARNING) << "io_uring mmap cq ring fail: " << strerror(errno);
+      return false;
+    }
+    cq_ring_ = ptr;
+  }
+
+  sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+  ptr = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, multiplexer_, IORING_OFF_SQES);
+  if (ptr == MAP_FAILED) {
+    LOG(WARNING) << "io_uring mmap sqes fail: " << strerror(errno);
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(ptr);
+
+  auto* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  sq_local_tail_ = *sq_tail_;
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  sq_entries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+  // sqes are always used in ring order, so the index array is the identity
+  auto* sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; i++) {
+    sq_array[i] = i;
+  }
+
+  auto* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+  return true;
+}
+
+void NetUring::MarkDirty(int fd, FdState* st) {
+  if (!st->dirty) {
+    st->dirty = true;
+    dirty_fds_.push_back(fd);
+  }
+}
+
+void NetUring::Rearm(int fd, FdState* st, int mask) {
+  if (st->armed) {
+    cancels_.push_back(PollUserData(fd, st->gen));
+    st->armed = false;
+  }
+  // a generation of the ring rather than of the fd, whose state is erased
+  // with NetDelEvent while a completion of it may still be on the way
+  st->gen = ++next_gen_;
+  st->mask = mask;
+  MarkDirty(fd, st);
+}
+
+int NetUring::NetAddEvent(int fd, int mask) {
+  std::lock_guard l(mu_);
+  Rearm(fd, &fds_[fd], mask);
+  return 0;
+}
+
+int NetUring::NetModEvent(int fd, int old_mask, int mask) {
+  std::lock_guard l(mu_);
+  auto iter = fds_.find(fd);
+  if (iter == fds_.end()) {
+    errno = ENOENT;
+    return -1;
+  }
+  Rearm(fd, &iter->second, old_mask | mask);
+  return 0;
+}
+
+int NetUring::NetDelEvent(int fd, [[maybe_unused]] int mask) {
+  std::lock_guard l(mu_);
+  auto iter = fds_.find(fd);
+  if (iter == fds_.end()) {
+    errno = ENOENT;
+    return -1;
+  }
+  if (iter->second.armed) {
+    cancels_.push_back(PollUserData(fd, iter->second.gen));
+  }
+  fds_.erase(iter);
+  return 0;
+}
+
+io_uring_sqe* NetUring::GetSqe() {
+  if (sq_local_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+    // submission queue is full, hand the queued entries to the kernel first
+    if (Enter(0, 0) < 0 || sq_local_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+      return nullptr;
+    }
+  }
+  struct io_uring_sqe* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_local_tail_++;
+  return sqe;
+}
+
+int NetUring::Enter(unsigned min_complete, int timeout) {
+  unsigned flags = 0;
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  memset(&arg, 0, sizeof(arg));
+  if (min_complete > 0) {
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    if (timeout >= 0) {
+      ts.tv_sec = timeout / 1000;
+      ts.tv_nsec = static_cast<long long>(timeout % 1000) * 1000000;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+  }
+
+  // publish the sqes filled since the last enter
+  StoreRelease(sq_tail_, sq_local_tail_);
+  unsigned to_submit = sq_local_tail_ - LoadAcquire(sq_head_);
+  if (to_submit == 0 && min_complete == 0) {
+    return 0;
+  }
+
+  int ret = static_cast<int>(syscall(__NR_io_uring_enter, multiplexer_, to_submit, min_complete, flags,
+                                     (flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr,
+                                     (flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0));
+  if (ret >= 0 || errno == ETIME || errno == EINTR) {
+    return 0;
+  }
+  return -1;
+}
+
+int NetUring::NetPoll(int timeout) {
+  {
+    std::lock_guard l(mu_);
+    // the removes go first, the kernel never sees a new poll of an fd before
+    // the remove of its old one
+    for (uint64_t data : cancels_) {
+      struct io_uring_sqe* sqe = GetSqe();
+      if (!sqe) {
+        break;
+      }
+      sqe->opcode = IORING_OP_POLL_REMOVE;
+      sqe->fd = -1;
+      sqe->addr = data;
+      sqe->user_data = kUringCancelData;
+    }
+    cancels_.clear();
+
+    for (int fd : dirty_fds_) {
+      auto iter = fds_.find(fd);
+      if (iter == fds_.end()) {
+        continue;
+      }
+      FdState& st = iter->second;
+      st.dirty = false;
+      if (st.armed) {
+        continue;
+      }
+      struct io_uring_sqe* sqe = GetSqe();
+      if (!sqe) {
+        LOG(ERROR) << "io_uring submission queue is full, fd " << fd << " not armed";
+        continue;
+      }
+      unsigned events = 0;
+      if (st.mask & kReadable) {
+        events |= POLLIN;
+      }
+      if (st.mask & kWritable) {
+        events |= POLLOUT;
+      }
+      if (st.mask & kPeerClosed) {
+        events |= POLLRDHUP;
+      }
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->fd = fd;
+      sqe->poll32_events = events;
+      sqe->user_data = PollUserData(fd, st.gen);
+      st.armed = true;
+    }
+    dirty_fds_.clear();
+  }
+
+  bool ready = LoadAcquire(cq_tail_) != *cq_head_;
+  if (Enter(ready || timeout == 0 ? 0 : 1, timeout) < 0) {
+    LOG(WARNING) << "io_uring enter fail: " << strerror(errno);
+    return 0;
+  }
+
+  std::lock_guard l(mu_);
+  int num_events = 0;
+  unsigned head = *cq_head_;
+  unsigned tail = LoadAcquire(cq_tail_);
+  for (; head != tail && num_events < NET_MAX_CLIENTS; head++) {
+    const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+    if (cqe->user_data == kUringCancelData || cqe->res == -ECANCELED) {
+      continue;
+    }
+    int fd = static_cast<int>(cqe->user_data & 0xffffffff);
+    auto gen = static_cast<uint32_t>(cqe->user_data >> 32);
+    auto iter = fds_.find(fd);
+    if (iter == fds_.end() || iter->second.gen != gen) {
+      // stale completion of a removed or modified poll
+      continue;
+    }
+    FdState& st = iter->second;
+    st.armed = false;
+    MarkDirty(fd, &st);
+
+    NetFiredEvent& ev = fired_events_[num_events++];
+    ev.fd = fd;
+    ev.mask = 0;
+    if (cqe->res < 0) {
+      ev.mask |= kErrorEvent;
+      continue;
+    }
+    if (cqe->res & POLLIN) {
+      ev.mask |= kReadable;
+    }
+    if (cqe->res & POLLOUT) {
+      ev.mask |= kWritable;
+    }
+    if (cqe->res & (POLLERR | POLLHUP | POLLNVAL | POLLRDHUP)) {
+      ev.mask |= kErrorEvent;
+    }
+  }
+  StoreRelease(cq_head_, head);
+
+  return num_events;
+}
+
+}  // namespace net
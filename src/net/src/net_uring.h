@@ -0,0 +1,98 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef NET_SRC_NET_URING_H_
+#define NET_SRC_NET_URING_H_
+#include <unordered_map>
+#include <vector>
+
+#include "net/src/net_multiplexer.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace net {
+
+/*
+ * NetUring drives the worker threads with io_uring instead of epoll.
+ *
+ * Every fd owns one single shot poll request, which is re-armed with the
+ * current mask after it fired, so the semantics stay level triggered like
+ * NetEpoll. Adding, modifying and removing events only queues submission
+ * entries, all of them are submitted together with the wait for completions
+ * in NetPoll, which takes one io_uring_enter per loop instead of an
+ * epoll_wait plus one epoll_ctl for every mask change.
+ *
+ * Only the readiness is taken from the ring, the connections still read and
+ * write their own buffers with read and writev, so a request costs the same
+ * syscalls as with epoll but the epoll_ctl of its mask changes. Multishot
+ * receives, registered buffers and replies batched into the ring are not
+ * used, they would need the connections to give up their own buffers.
+ *
+ * Each poll request carries a generation taken from one counter of the ring,
+ * never reused for another request, so a late completion of a poll that was
+ * removed or replaced is told apart even when its fd was closed and opened
+ * again in between.
+ */
+class NetUring final : public NetMultiplexer {
+ public:
+  // Return nullptr if io_uring is not available on this kernel
+  static NetUring* Create(int queue_limit = kUnlimitedQueue);
+  ~NetUring() override;
+
+  int NetAddEvent(int fd, int mask) override;
+  int NetDelEvent(int fd, [[maybe_unused]] int mask) override;
+  int NetModEvent(int fd, int old_mask, int mask) override;
+
+  int NetPoll(int timeout) override;
+
+ private:
+  explicit NetUring(int queue_limit);
+  bool Setup();
+
+  struct FdState {
+    int mask = 0;
+    // generation of the last poll request of the fd
+    uint32_t gen = 0;
+    bool armed = false;
+    bool dirty = false;
+  };
+
+  // invoker need to hold mu_
+  void MarkDirty(int fd, FdState* st);
+  // invoker need to hold mu_
+  void Rearm(int fd, FdState* st, int mask);
+  io_uring_sqe* GetSqe();
+  int Enter(unsigned min_complete, int timeout);
+
+  pstd::Mutex mu_;
+  std::unordered_map<int, FdState> fds_;
+  std::vector<int> dirty_fds_;
+  std::vector<uint64_t> cancels_;
+  uint32_t next_gen_ = 0;
+
+  // ring mappings
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  // tail of the sqes filled but not published to the kernel yet
+  unsigned sq_local_tail_ = 0;
+};
+
+}  // namespace net
+#endif  // NET_SRC_NET_URING_H_
@@ -5,6 +5,7 @@
 
 #include "net/include/redis_conn.h"
 
+#include <sys/uio.h>
 #include <climits>
 #include <cstdlib>
 
@@ -118,47 +119,92 @@ ReadStatus RedisConn::GetRequest() {
     last_read_pos_ = -1;
     bulk_len_ = redis_parser_.get_bulk_len();
   }
-  if (!response_.empty()) {
+  if (!response_.empty() || !wqueue_.empty()) {
     set_is_reply(true);
   }
   return read_status;  // OK || HALF || FULL_ERROR || PARSE_ERROR
 }
 
 WriteStatus RedisConn::SendReply() {
-  ssize_t nwritten = 0;
-  size_t wbuf_len = response_.size();
-  while (wbuf_len > 0) {
-    nwritten = write(fd(), response_.data() + wbuf_pos_, wbuf_len - wbuf_pos_);
-    if (nwritten <= 0) {
-      break;
+  SealResponse();
+  SealPushes();
+  while (!wqueue_.empty()) {
+    struct iovec iov[REDIS_MAX_IOVCNT];
+    int iovcnt = 0;
+    for (auto iter = wqueue_.begin(); iter != wqueue_.end() && iovcnt < REDIS_MAX_IOVCNT; ++iter) {
+      size_t offset = iovcnt == 0 ? wqueue_pos_ : 0;
+      iov[iovcnt].iov_base = const_cast<char*>((*iter)->data()) + offset;
+      iov[iovcnt].iov_len = (*iter)->size() - offset;
+      iovcnt++;
     }
-    wbuf_pos_ += nwritten;
-    if (wbuf_pos_ == wbuf_len) {
-      // Have sended all response data
-      if (wbuf_len > DEFAULT_WBUF_SIZE) {
-        std::string buf;
-        buf.reserve(DEFAULT_WBUF_SIZE);
-        response_.swap(buf);
+
+    ssize_t nwritten = writev(fd(), iov, iovcnt);
+    if (nwritten == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return kWriteHalf;
+      } else {
+        // Here we should close the connection
+        return kWriteError;
       }
-      response_.clear();
+    }
+    if (nwritten == 0) {
+      return kWriteHalf;
+    }
 
-      wbuf_len = 0;
-      wbuf_pos_ = 0;
+    // Release the replies have been sent completely
+    auto remain = static_cast<size_t>(nwritten);
+    while (remain > 0) {
+      size_t front_left = wqueue_.front()->size() - wqueue_pos_;
+      if (remain < front_left) {
+        wqueue_pos_ += remain;
+        break;
+      }
+      remain -= front_left;
+      wqueue_.pop_front();
+      wqueue_pos_ = 0;
     }
   }
-  if (nwritten == -1) {
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-      return kWriteHalf;
-    } else {
-      // Here we should close the connection
-      return kWriteError;
+  return kWriteAll;
+}
+
+void RedisConn::SealResponse() {
+  if (response_.empty()) {
+    return;
+  }
+  wqueue_.push_back(std::make_shared<std::string>(std::move(response_)));
+  response_.clear();
+}
+
+bool RedisConn::SealPushes() {
+  std::lock_guard l(push_mu_);
+  push_notified_ = false;
+  if (in_batch_ || pushes_.empty()) {
+    return false;
+  }
+  wqueue_.push_back(std::make_shared<std::string>(std::move(pushes_)));
+  pushes_.clear();
+  return true;
+}
+
+void RedisConn::WritePush(const std::string& message) {
+  {
+    std::lock_guard l(push_mu_);
+    pushes_.append(message);
+    if (in_batch_ || push_notified_) {
+      return;
     }
+    push_notified_ = true;
   }
-  if (wbuf_len == 0) {
-    return kWriteAll;
-  } else {
-    return kWriteHalf;
+  NetItem ti(fd(), ip_port(), kNotiWrite);
+  net_multiplexer()->Register(ti, true);
+}
+
+bool RedisConn::TakePushes() {
+  if (!SealPushes()) {
+    return false;
   }
+  set_is_reply(true);
+  return true;
 }
 
 int RedisConn::WriteResp(const std::string& resp) {
@@ -167,6 +213,16 @@ int RedisConn::WriteResp(const std::string& resp) {
   return 0;
 }
 
+int RedisConn::WriteResp(std::shared_ptr<std::string> resp) {
+  if (resp && !resp->empty()) {
+    // keep the order with the replies appended before
+    SealResponse();
+    wqueue_.push_back(std::move(resp));
+  }
+  set_is_reply(true);
+  return 0;
+}
+
 void RedisConn::TryResizeBuffer() {
   struct timeval now;
   gettimeofday(&now, nullptr);
@@ -189,10 +245,20 @@ HandleType RedisConn::GetHandleType() { return handle_type_; }
 void RedisConn::ProcessRedisCmds(const std::vector<RedisCmdArgsType>& argvs, bool async, std::string* response) {}
 
 void RedisConn::NotifyEpoll(bool success) {
+  {
+    // the batch is over, the messages queued meanwhile go with its replies
+    std::lock_guard l(push_mu_);
+    in_batch_ = false;
+  }
   NetItem ti(fd(), ip_port(), success ? kNotiEpolloutAndEpollin : kNotiClose);
   net_multiplexer()->Register(ti, true);
 }
 
+void RedisConn::NotifyWaitClose() {
+  NetItem ti(fd(), ip_port(), kNotiWaitClose);
+  net_multiplexer()->Register(ti, true);
+}
+
 int RedisConn::ParserDealMessageCb(RedisParser* parser, const RedisCmdArgsType& argv) {
   auto conn = reinterpret_cast<RedisConn*>(parser->data);
   if (conn->GetHandleType() == HandleType::kSynchronous) {
@@ -205,6 +271,10 @@ int RedisConn::ParserDealMessageCb(RedisParser* parser, const RedisCmdArgsType&
 int RedisConn::ParserCompleteCb(RedisParser* parser, const std::vector<RedisCmdArgsType>& argvs) {
   auto conn = reinterpret_cast<RedisConn*>(parser->data);
   bool async = conn->GetHandleType() == HandleType::kAsynchronous;
+  {
+    std::lock_guard l(conn->push_mu_);
+    conn->in_batch_ = true;
+  }
   conn->ProcessRedisCmds(argvs, async, &(conn->response_));
   return 0;
 }
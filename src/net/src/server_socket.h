@@ -37,6 +37,9 @@ class ServerSocket : public pstd::noncopyable {
 
   int port() { return port_; }
 
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+  bool reuse_port() const { return reuse_port_; }
+
   void set_keep_alive(bool keep_alive) { keep_alive_ = keep_alive; }
   bool keep_alive() const { return keep_alive_; }
 
@@ -65,6 +68,7 @@ class ServerSocket : public pstd::noncopyable {
   int tcp_send_buffer_;
   int tcp_recv_buffer_;
   bool keep_alive_;
+  bool reuse_port_;
   bool listening_;
   bool is_block_;
 
@@ -12,6 +12,7 @@
 
 #include "net/include/net_conn.h"
 #include "net/src/net_item.h"
+#include "net/src/server_socket.h"
 
 namespace net {
 
@@ -24,7 +25,7 @@ WorkerThread::WorkerThread(ConnFactory* conn_factory, ServerThread* server_threa
   /*
    * install the protobuf handler here
    */
-  net_multiplexer_.reset(CreateNetMultiplexer(queue_limit));
+  net_multiplexer_.reset(CreateNetMultiplexer(WorkerMultiplexerType(), queue_limit));
   net_multiplexer_->Initialize();
 }
 
@@ -68,7 +69,69 @@ bool WorkerThread::MoveConnIn(const std::shared_ptr<NetConn>& conn, const Notify
   return success;
 }
 
-bool WorkerThread::MoveConnIn(const NetItem& it, bool force) { return net_multiplexer_->Register(it, force); }
+bool WorkerThread::MoveConnIn(const NetItem& it, bool force) {
+  bool is_new_conn = it.notify_type() == kNotiConnect;
+  if (is_new_conn) {
+    pending_conns_++;
+  }
+  bool success = net_multiplexer_->Register(it, force);
+  if (!success && is_new_conn) {
+    pending_conns_--;
+  }
+  return success;
+}
+
+int WorkerThread::ListenReusePort(const std::set<std::string>& ips, int port) {
+  for (const auto& ip : ips) {
+    auto socket_p = std::make_shared<ServerSocket>(port);
+    socket_p->set_reuse_port(true);
+    int ret = socket_p->Listen(ip);
+    if (ret != kSuccess) {
+      return ret;
+    }
+    server_sockets_.push_back(socket_p);
+    server_fds_.insert(socket_p->sockfd());
+    net_multiplexer_->NetAddEvent(socket_p->sockfd(), kReadable);
+  }
+  return kSuccess;
+}
+
+bool WorkerThread::AddNewConn(int connfd, const std::string& ip_port) {
+  std::shared_ptr<NetConn> tc =
+      conn_factory_->NewNetConn(connfd, ip_port, server_thread_, private_data_, net_multiplexer_.get());
+  if (!tc || !tc->SetNonblock()) {
+    return false;
+  }
+
+#ifdef __ENABLE_SSL
+  // Create SSL failed
+  if (server_thread_->security() && !tc->CreateSSL(server_thread_->ssl_ctx())) {
+    CloseFd(tc);
+    return true;
+  }
+#endif
+
+  {
+    std::lock_guard lock(rwlock_);
+    conns_[connfd] = tc;
+  }
+  net_multiplexer_->NetAddEvent(connfd, kReadable);
+  return true;
+}
+
+void WorkerThread::AcceptNewConns(int listen_fd) {
+  // Drain a bounded batch, the rest is picked up by the next poll
+  std::string ip_port;
+  for (int i = 0; i < kMaxAcceptPerPoll; i++) {
+    int connfd = server_thread_->AcceptConn(listen_fd, &ip_port);
+    if (connfd == -1) {
+      break;
+    }
+    if (!AddNewConn(connfd, ip_port)) {
+      close(connfd);
+    }
+  }
+}
 
 void* WorkerThread::ThreadMain() {
   int nfds;
@@ -116,26 +179,26 @@ void* WorkerThread::ThreadMain() {
           } else {
             for (int32_t idx = 0; idx < nread; ++idx) {
               NetItem ti = net_multiplexer_->NotifyQueuePop();
-              if (ti.notify_type() == kNotiConnect) {
-                std::shared_ptr<NetConn> tc = conn_factory_->NewNetConn(ti.fd(), ti.ip_port(), server_thread_,
-                                                                        private_data_, net_multiplexer_.get());
-                if (!tc || !tc->SetNonblock()) {
-                  continue;
-                }
-
-#ifdef __ENABLE_SSL
-                // Create SSL failed
-                if (server_thread_->security() && !tc->CreateSSL(server_thread_->ssl_ctx())) {
-                  CloseFd(tc);
-                  continue;
-                }
-#endif
-
+              if (ti.notify_type() == kNotiWrite) {
+                // messages from other threads, while a batch of the conn runs
+                // they wait for its end, which rearms the events
+                std::shared_ptr<NetConn> conn;
                 {
-                  std::lock_guard lock(rwlock_);
-                  conns_[ti.fd()] = tc;
+                  std::shared_lock lock(rwlock_);
+                  auto iter = conns_.find(ti.fd());
+                  if (iter != conns_.end() && iter->second->ip_port() == ti.ip_port()) {
+                    conn = iter->second;
+                  }
                 }
-                net_multiplexer_->NetAddEvent(ti.fd(), kReadable);
+                if (conn && conn->TakePushes()) {
+                  net_multiplexer_->NetModEvent(ti.fd(), 0, kReadable | kWritable);
+                }
+                continue;
+              }
+              wait_close_fds_.erase(ti.fd());
+              if (ti.notify_type() == kNotiConnect) {
+                pending_conns_--;
+                AddNewConn(ti.fd(), ti.ip_port());
               } else if (ti.notify_type() == kNotiClose) {
                 // should close?
               } else if (ti.notify_type() == kNotiEpollout) {
@@ -147,12 +210,23 @@ void* WorkerThread::ThreadMain() {
               } else if (ti.notify_type() == kNotiWait) {
                 // do not register events
                 net_multiplexer_->NetAddEvent(ti.fd(), 0);
+              } else if (ti.notify_type() == kNotiWaitClose) {
+                // the conn may be closed and its fd reused since
+                std::shared_lock lock(rwlock_);
+                if (auto iter = conns_.find(ti.fd()); iter != conns_.end() && iter->second->ip_port() == ti.ip_port()) {
+                  net_multiplexer_->NetModEvent(ti.fd(), 0, kPeerClosed);
+                  wait_close_fds_.insert(ti.fd());
+                }
               }
             }
           }
         } else {
           continue;
         }
+      } else if (server_fds_.find(pfe->fd) != server_fds_.end()) {
+        if ((pfe->mask & kReadable) != 0) {
+          AcceptNewConns(pfe->fd);
+        }
       } else {
         in_conn = nullptr;
         int should_close = 0;
@@ -212,6 +286,8 @@ void* WorkerThread::ThreadMain() {
     }    // for (int i = 0; i < nfds; i++)
   }      // while (!should_stop())
 
+  server_sockets_.clear();
+  server_fds_.clear();
   Cleanup();
   return nullptr;
 }
@@ -248,7 +324,8 @@ void WorkerThread::DoCronTask() {
       }
 
       // Check keepalive timeout connection
-      if (keepalive_timeout_ > 0 && (now.tv_sec - conn->last_interaction().tv_sec > keepalive_timeout_)) {
+      if (keepalive_timeout_ > 0 && wait_close_fds_.count(conn->fd()) == 0 &&
+          (now.tv_sec - conn->last_interaction().tv_sec > keepalive_timeout_)) {
         to_timeout.push_back(conn);
         iter = conns_.erase(iter);
         LOG(INFO) << "connection " << conn->String() << " keepalive timeout, the keepalive_timeout_ is " << keepalive_timeout_.load();
@@ -290,6 +367,7 @@ bool WorkerThread::TryKillConn(const std::string& ip_port) {
 }
 
 void WorkerThread::CloseFd(const std::shared_ptr<NetConn>& conn) {
+  wait_close_fds_.erase(conn->fd());
   close(conn->fd());
   server_thread_->handle_->FdClosedHandle(conn->fd(), conn->ip_port());
 }
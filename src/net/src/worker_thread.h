@@ -23,10 +23,14 @@
 
 namespace net {
 
+// connections accepted by one worker in a loop before serving others
+const int kMaxAcceptPerPoll = 64;
+
 class NetItem;
 class NetFiredEvent;
 class NetConn;
 class ConnFactory;
+class ServerSocket;
 
 class WorkerThread : public Thread {
  public:
@@ -49,6 +53,13 @@ class WorkerThread : public Thread {
   NetMultiplexer* net_multiplexer() { return net_multiplexer_.get(); }
   bool TryKillConn(const std::string& ip_port);
 
+  // Connections served and waiting to be served, used to pick the least loaded worker
+  int load() const { return conn_num() + pending_conns_.load(std::memory_order_relaxed); }
+
+  // Listen on the server port with SO_REUSEPORT and accept new connections in
+  // this thread, should be called before StartThread
+  int ListenReusePort(const std::set<std::string>& ips, int port);
+
   mutable pstd::RWMutex rwlock_; /* For external statistics */
   std::map<int, std::shared_ptr<NetConn>> conns_;
 
@@ -66,12 +77,26 @@ class WorkerThread : public Thread {
 
   std::atomic<int> keepalive_timeout_;  // keepalive second
 
+  // new connections dispatched to this worker but not added yet
+  std::atomic<int> pending_conns_{0};
+
+  // SO_REUSEPORT listeners owned by this worker
+  std::vector<std::shared_ptr<ServerSocket>> server_sockets_;
+  std::set<int> server_fds_;
+
   void* ThreadMain() override;
   void DoCronTask();
 
   pstd::Mutex killer_mutex_;
   std::set<std::string> deleting_conn_ipport_;
 
+  // the conns waiting for a reply with only their close watched, they are
+  // not idle, so kept off the keepalive timeout
+  std::set<int> wait_close_fds_;
+
+  bool AddNewConn(int connfd, const std::string& ip_port);
+  void AcceptNewConns(int listen_fd);
+
   // clean conns
   void CloseFd(const std::shared_ptr<NetConn>& conn);
   void Cleanup();
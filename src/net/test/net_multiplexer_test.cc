@@ -0,0 +1,174 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "net/src/net_multiplexer.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#if defined(__linux__)
+#include "net/src/net_uring.h"
+#endif
+
+using net::NetMultiplexer;
+
+class NetMultiplexerTest : public ::testing::TestWithParam<net::MultiplexerType> {
+ protected:
+  void SetUp() override {
+    mpx_.reset(net::CreateNetMultiplexer(GetParam()));
+#if defined(__linux__)
+    // not the fallback to epoll, which is tested on its own
+    if (GetParam() == net::kMultiplexerIoUring && dynamic_cast<net::NetUring*>(mpx_.get()) == nullptr) {
+      GTEST_SKIP() << "io_uring is not available";
+    }
+#endif
+    mpx_->Initialize();
+    ASSERT_EQ(0, pipe(fds_));
+  }
+
+  void TearDown() override {
+    if (fds_[0] != -1) {
+      close(fds_[0]);
+      close(fds_[1]);
+    }
+  }
+
+  int FiredMask(int n, int fd) {
+    for (int i = 0; i < n; i++) {
+      if (mpx_->FiredEvents()[i].fd == fd) {
+        return mpx_->FiredEvents()[i].mask;
+      }
+    }
+    return -1;
+  }
+
+  std::unique_ptr<NetMultiplexer> mpx_;
+  int fds_[2] = {-1, -1};
+};
+
+TEST_P(NetMultiplexerTest, LevelTriggered) {
+  ASSERT_EQ(0, mpx_->NetAddEvent(fds_[0], net::kReadable));
+  EXPECT_EQ(0, mpx_->NetPoll(10));
+
+  ASSERT_EQ(1, write(fds_[1], "a", 1));
+  int n = mpx_->NetPoll(100);
+  EXPECT_EQ(net::kReadable, FiredMask(n, fds_[0]) & net::kReadable);
+
+  // not consumed yet, fired again
+  n = mpx_->NetPoll(100);
+  EXPECT_EQ(net::kReadable, FiredMask(n, fds_[0]) & net::kReadable);
+
+  char c;
+  ASSERT_EQ(1, read(fds_[0], &c, 1));
+  EXPECT_EQ(0, mpx_->NetPoll(10));
+}
+
+TEST_P(NetMultiplexerTest, ModAndDel) {
+  ASSERT_EQ(0, mpx_->NetAddEvent(fds_[0], net::kReadable));
+  ASSERT_EQ(0, mpx_->NetModEvent(fds_[0], 0, 0));
+  ASSERT_EQ(1, write(fds_[1], "a", 1));
+  EXPECT_EQ(-1, FiredMask(mpx_->NetPoll(10), fds_[0]));
+
+  ASSERT_EQ(0, mpx_->NetModEvent(fds_[0], 0, net::kReadable));
+  EXPECT_EQ(net::kReadable, FiredMask(mpx_->NetPoll(100), fds_[0]) & net::kReadable);
+
+  ASSERT_EQ(0, mpx_->NetDelEvent(fds_[0], 0));
+  EXPECT_EQ(-1, FiredMask(mpx_->NetPoll(10), fds_[0]));
+
+  ASSERT_EQ(0, mpx_->NetAddEvent(fds_[1], net::kWritable));
+  EXPECT_EQ(net::kWritable, FiredMask(mpx_->NetPoll(100), fds_[1]) & net::kWritable);
+}
+
+TEST_P(NetMultiplexerTest, Notify) {
+  EXPECT_TRUE(mpx_->Register(net::NetItem(), true));
+  EXPECT_EQ(net::kReadable, FiredMask(mpx_->NetPoll(-1), mpx_->NotifyReceiveFd()) & net::kReadable);
+}
+
+TEST_P(NetMultiplexerTest, ModWhileArmed) {
+  ASSERT_EQ(0, mpx_->NetAddEvent(fds_[0], net::kReadable));
+  // armed with the readable mask, then changed before it fires
+  EXPECT_EQ(0, mpx_->NetPoll(10));
+  ASSERT_EQ(0, mpx_->NetModEvent(fds_[0], 0, 0));
+  ASSERT_EQ(1, write(fds_[1], "a", 1));
+  EXPECT_EQ(-1, FiredMask(mpx_->NetPoll(10), fds_[0]));
+  ASSERT_EQ(0, mpx_->NetModEvent(fds_[0], 0, net::kReadable));
+  int n = mpx_->NetPoll(100);
+  int fired = 0;
+  for (int i = 0; i < n; i++) {
+    fired += mpx_->FiredEvents()[i].fd == fds_[0] ? 1 : 0;
+  }
+  EXPECT_EQ(1, fired);
+}
+
+TEST_P(NetMultiplexerTest, FdReusedAfterDel) {
+  ASSERT_EQ(0, mpx_->NetAddEvent(fds_[0], net::kReadable));
+  EXPECT_EQ(0, mpx_->NetPoll(10));
+  // removed while armed, the same fd number is then watched again
+  ASSERT_EQ(0, mpx_->NetDelEvent(fds_[0], 0));
+  int old_fd = fds_[0];
+  close(fds_[0]);
+  close(fds_[1]);
+  ASSERT_EQ(0, pipe(fds_));
+  ASSERT_EQ(old_fd, fds_[0]);
+  ASSERT_EQ(0, mpx_->NetAddEvent(fds_[0], net::kReadable));
+  EXPECT_EQ(-1, FiredMask(mpx_->NetPoll(10), fds_[0]));
+
+  ASSERT_EQ(1, write(fds_[1], "a", 1));
+  EXPECT_EQ(net::kReadable, FiredMask(mpx_->NetPoll(100), fds_[0]) & net::kReadable);
+}
+
+#if defined(__linux__)
+TEST_P(NetMultiplexerTest, PeerClosed) {
+  int sv[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+  ASSERT_EQ(0, mpx_->NetAddEvent(sv[0], net::kReadable));
+  ASSERT_EQ(0, mpx_->NetModEvent(sv[0], 0, net::kPeerClosed));
+  // data to read is not watched
+  ASSERT_EQ(1, write(sv[1], "a", 1));
+  EXPECT_EQ(-1, FiredMask(mpx_->NetPoll(10), sv[0]));
+  close(sv[1]);
+  EXPECT_EQ(net::kErrorEvent, FiredMask(mpx_->NetPoll(100), sv[0]) & net::kErrorEvent);
+  ASSERT_EQ(0, mpx_->NetDelEvent(sv[0], 0));
+  close(sv[0]);
+}
+#endif
+
+TEST_P(NetMultiplexerTest, ManyFds) {
+  std::vector<int> pipes(128);
+  for (size_t i = 0; i < pipes.size(); i += 2) {
+    ASSERT_EQ(0, pipe(&pipes[i]));
+    ASSERT_EQ(0, mpx_->NetAddEvent(pipes[i], net::kReadable));
+    ASSERT_EQ(1, write(pipes[i + 1], "a", 1));
+  }
+  int n = mpx_->NetPoll(100);
+  EXPECT_EQ(static_cast<int>(pipes.size() / 2), n);
+  for (size_t i = 0; i < pipes.size(); i += 2) {
+    EXPECT_EQ(net::kReadable, FiredMask(n, pipes[i]) & net::kReadable);
+    ASSERT_EQ(0, mpx_->NetDelEvent(pipes[i], 0));
+    close(pipes[i]);
+    close(pipes[i + 1]);
+  }
+  EXPECT_EQ(0, mpx_->NetPoll(10));
+}
+
+#if defined(__linux__)
+TEST(NetUringTest, Create) {
+  std::unique_ptr<net::NetUring> uring(net::NetUring::Create());
+  if (!uring) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  uring->Initialize();
+  EXPECT_TRUE(uring->Register(net::NetItem(), true));
+  EXPECT_EQ(1, uring->NetPoll(100));
+  EXPECT_EQ(uring->NotifyReceiveFd(), uring->FiredEvents()[0].fd);
+}
+#endif
+
+INSTANTIATE_TEST_SUITE_P(Multiplexers, NetMultiplexerTest,
+                         ::testing::Values(net::kMultiplexerEpoll, net::kMultiplexerIoUring));
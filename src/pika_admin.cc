@@ -19,7 +19,6 @@
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
 #include "include/pika_version.h"
-#include "pstd/include/rsync.h"
 
 using pstd::Status;
 
@@ -347,6 +346,41 @@ void CompactCmd::Do(std::shared_ptr<Slot> slot) {
   res_.SetRes(CmdRes::kOk);
 }
 
+void BulkloadCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameBulkload);
+    return;
+  }
+  path_ = argv_[1];
+  if (!pstd::FileExists(path_)) {
+    res_.SetRes(CmdRes::kErrOther, "No such directory " + path_);
+    return;
+  }
+}
+
+void BulkloadCmd::Do(std::shared_ptr<Slot> slot) {
+  std::shared_ptr<DB> db = g_pika_server->GetDB(db_name_);
+  if (!db) {
+    res_.SetRes(CmdRes::kInvalidDB);
+    return;
+  }
+  LogCommand();
+  for (uint32_t slot_id : db->GetSlotIDs()) {
+    std::shared_ptr<Slot> db_slot = db->GetSlotById(slot_id);
+    std::string path = db->SlotNum() > 1 ? path_ + "/" + std::to_string(slot_id) : path_;
+    if (!db_slot || !pstd::FileExists(path)) {
+      continue;
+    }
+    rocksdb::Status s = db_slot->IngestExternalFiles(path);
+    if (!s.ok()) {
+      res_.SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+  }
+  g_pika_server->TouchAllKeys(db_name_);
+  res_.SetRes(CmdRes::kOk);
+}
+
 void PurgelogstoCmd::DoInitial() {
   if (!CheckArg(argv_.size()) || argv_.size() > 3) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNamePurgelogsto);
@@ -373,13 +407,21 @@ void PurgelogstoCmd::DoInitial() {
 }
 
 void PurgelogstoCmd::Do(std::shared_ptr<Slot> slot) {
-  std::shared_ptr<SyncMasterSlot> sync_slot = g_pika_rm->GetSyncMasterSlotByName(SlotInfo(db_, 0));
-  if (!sync_slot) {
-    res_.SetRes(CmdRes::kErrOther, "Slot not found");
-  } else {
+  std::shared_ptr<DB> db = g_pika_server->GetDB(db_);
+  if (!db) {
+    res_.SetRes(CmdRes::kInvalidDB, db_);
+    return;
+  }
+  // every shard has its own binlog, each one is purged up to the number
+  for (uint32_t slot_id : db->GetSlotIDs()) {
+    std::shared_ptr<SyncMasterSlot> sync_slot = g_pika_rm->GetSyncMasterSlotByName(SlotInfo(db_, slot_id));
+    if (!sync_slot) {
+      res_.SetRes(CmdRes::kErrOther, "Slot not found");
+      return;
+    }
     sync_slot->StableLogger()->PurgeStableLogs(num_, true);
-    res_.SetRes(CmdRes::kOk);
   }
+  res_.SetRes(CmdRes::kOk);
 }
 
 void PingCmd::DoInitial() {
@@ -524,6 +566,58 @@ void ClientCmd::DoInitial() {
     return;
   }
 
+  if ((strcasecmp(argv_[1].data(), "id") == 0) && argv_.size() == 2) {
+    operation_ = argv_[1];
+    return;
+  }
+
+  if (strcasecmp(argv_[1].data(), "tracking") == 0) {
+    if (argv_.size() < 3) {
+      res_.SetRes(CmdRes::kErrOther,
+                  "Syntax error, try CLIENT TRACKING on|off [REDIRECT id] [BCAST] [PREFIX prefix ...] [NOLOOP]");
+      return;
+    }
+    if (strcasecmp(argv_[2].data(), "on") == 0) {
+      tracking_on_ = true;
+    } else if (strcasecmp(argv_[2].data(), "off") == 0) {
+      tracking_on_ = false;
+    } else {
+      res_.SetRes(CmdRes::kSyntaxErr);
+      return;
+    }
+    tracking_options_ = PikaClientTracking::Options();
+    for (size_t i = 3; i < argv_.size(); i++) {
+      if (strcasecmp(argv_[i].data(), "redirect") == 0 && i + 1 < argv_.size()) {
+        int64_t id = 0;
+        if (pstd::string2int(argv_[i + 1].data(), argv_[i + 1].size(), &id) == 0 || id <= 0) {
+          res_.SetRes(CmdRes::kErrOther, "Invalid client ID");
+          return;
+        }
+        tracking_options_.redirect = static_cast<uint64_t>(id);
+        i++;
+      } else if (strcasecmp(argv_[i].data(), "bcast") == 0) {
+        tracking_options_.bcast = true;
+      } else if (strcasecmp(argv_[i].data(), "prefix") == 0 && i + 1 < argv_.size()) {
+        tracking_options_.prefixes.push_back(argv_[i + 1]);
+        i++;
+      } else if (strcasecmp(argv_[i].data(), "noloop") == 0) {
+        tracking_options_.noloop = true;
+      } else if (strcasecmp(argv_[i].data(), "optin") == 0 || strcasecmp(argv_[i].data(), "optout") == 0) {
+        res_.SetRes(CmdRes::kErrOther, "OPTIN and OPTOUT are not supported");
+        return;
+      } else {
+        res_.SetRes(CmdRes::kSyntaxErr);
+        return;
+      }
+    }
+    if (!tracking_options_.prefixes.empty() && !tracking_options_.bcast) {
+      res_.SetRes(CmdRes::kErrOther, "PREFIX option requires BCAST mode to be enabled");
+      return;
+    }
+    operation_ = argv_[1];
+    return;
+  }
+
   if ((strcasecmp(argv_[1].data(), "list") == 0) && argv_.size() == 2) {
     // nothing
   } else if ((strcasecmp(argv_[1].data(), "list") == 0) && argv_.size() == 5) {
@@ -536,7 +630,8 @@ void ClientCmd::DoInitial() {
   } else if ((strcasecmp(argv_[1].data(), "kill") == 0) && argv_.size() == 3) {
     info_ = argv_[2];
   } else {
-    res_.SetRes(CmdRes::kErrOther, "Syntax error, try CLIENT (LIST [order by [addr|idle]| KILL ip:port)");
+    res_.SetRes(CmdRes::kErrOther,
+                "Syntax error, try CLIENT (LIST [order by [addr|idle]| KILL ip:port| ID| TRACKING on|off)");
     return;
   }
   operation_ = argv_[1];
@@ -561,6 +656,44 @@ void ClientCmd::Do(std::shared_ptr<Slot> slot) {
     return;
   }
 
+  if (strcasecmp(operation_.data(), "id") == 0) {
+    std::shared_ptr<PikaClientConn> client = std::dynamic_pointer_cast<PikaClientConn>(conn);
+    if (!client) {
+      res_.SetRes(CmdRes::kErrOther, kCmdNameClient);
+      return;
+    }
+    // a connection others may redirect their invalidations to
+    g_pika_server->client_tracking()->Register(client->id(), client);
+    client->SetRegistered();
+    res_.AppendInteger(static_cast<int64_t>(client->id()));
+    return;
+  }
+
+  if (strcasecmp(operation_.data(), "tracking") == 0) {
+    std::shared_ptr<PikaClientConn> client = std::dynamic_pointer_cast<PikaClientConn>(conn);
+    if (!client) {
+      res_.SetRes(CmdRes::kErrOther, kCmdNameClient);
+      return;
+    }
+    PikaClientTracking* tracking = g_pika_server->client_tracking();
+    if (!tracking_on_) {
+      tracking->Disable(client->id());
+      client->SetTracking(false);
+      res_.SetRes(CmdRes::kOk);
+      return;
+    }
+    if (tracking_options_.redirect != 0 && tracking_options_.redirect != client->id() &&
+        !tracking->IsRegistered(tracking_options_.redirect)) {
+      res_.SetRes(CmdRes::kErrOther, "The client ID you want redirect to does not exist");
+      return;
+    }
+    tracking->Enable(client->id(), client, tracking_options_);
+    client->SetTracking(true);
+    client->SetRegistered();
+    res_.SetRes(CmdRes::kOk);
+    return;
+  }
+
   if (strcasecmp(operation_.data(), "list") == 0) {
     struct timeval now;
     gettimeofday(&now, nullptr);
@@ -822,6 +955,7 @@ void InfoCmd::InfoClients(std::string& info) {
   tmp_stream << "# Clients"
              << "\r\n";
   tmp_stream << "connected_clients:" << g_pika_server->ClientList() << "\r\n";
+  tmp_stream << "blocked_clients:" << g_pika_server->blocked_clients()->BlockedNum() << "\r\n";
 
   info.append(tmp_stream.str());
 }
@@ -834,6 +968,11 @@ void InfoCmd::InfoStats(std::string& info) {
   tmp_stream << "instantaneous_ops_per_sec:" << g_pika_server->ServerCurrentQps() << "\r\n";
   tmp_stream << "total_commands_processed:" << g_pika_server->ServerQueryNum() << "\r\n";
   tmp_stream << "is_bgsaving:" << (g_pika_server->IsBgSaving() ? "Yes" : "No") << "\r\n";
+  uint64_t bgsave_stall_us = 0;
+  uint64_t bgsave_avoided_stall_us = 0;
+  g_pika_server->BgSaveStall(&bgsave_stall_us, &bgsave_avoided_stall_us);
+  tmp_stream << "last_bgsave_stall_us:" << bgsave_stall_us << "\r\n";
+  tmp_stream << "last_bgsave_avoided_stall_us:" << bgsave_avoided_stall_us << "\r\n";
   tmp_stream << "is_scaning_keyspace:" << (g_pika_server->IsKeyScaning() ? "Yes" : "No") << "\r\n";
   tmp_stream << "is_compact:" << (g_pika_server->IsCompacting() ? "Yes" : "No") << "\r\n";
   tmp_stream << "compact_cron:" << g_pika_conf->compact_cron() << "\r\n";
@@ -956,7 +1095,7 @@ void InfoCmd::InfoReplication(std::string& info) {
         if (slave_slot->State() == ReplState::kNoConnect) {
           out_of_sync << "NoConnect)";
         } else if (slave_slot->State() == ReplState::kWaitDBSync) {
-          out_of_sync << "WaitDBSync)";
+          out_of_sync << "WaitDBSync, " << slot_item.second->GetDBSyncReceiver()->ProgressString() << ")";
         } else if (slave_slot->State() == ReplState::kError) {
           out_of_sync << "Error)";
         } else if (slave_slot->State() == ReplState::kWaitReply) {
@@ -1119,15 +1258,12 @@ void InfoCmd::InfoData(std::string& info) {
   std::stringstream tmp_stream;
   std::stringstream db_fatal_msg_stream;
 
-  int64_t db_size = pstd::Du(g_pika_conf->db_path());
-  tmp_stream << "# Data"
-             << "\r\n";
-  tmp_stream << "db_size:" << db_size << "\r\n";
-  tmp_stream << "db_size_human:" << (db_size >> 20) << "M\r\n";
-  int64_t log_size = pstd::Du(g_pika_conf->log_path());
-  tmp_stream << "log_size:" << log_size << "\r\n";
-  tmp_stream << "log_size_human:" << (log_size >> 20) << "M\r\n";
-  tmp_stream << "compression:" << g_pika_conf->compression() << "\r\n";
+  // the sizes are kept as the files are written and deleted, nothing is
+  // listed or stat'ed here
+  uint64_t db_size = 0;
+  uint64_t log_size = 0;
+  std::map<std::string, storage::SstFilesSize> sst_sizes;
+  std::map<std::string, storage::SstFilesSize> slot_sst_sizes;
 
   // rocksdb related memory usage
   std::map<std::string, uint64_t> background_errors;
@@ -1149,7 +1285,18 @@ void InfoCmd::InfoData(std::string& info) {
       slot_item.second->db()->GetUsage(storage::PROPERTY_TYPE_ROCKSDB_CUR_SIZE_ALL_MEM_TABLES, &memtable_usage);
       slot_item.second->db()->GetUsage(storage::PROPERTY_TYPE_ROCKSDB_ESTIMATE_TABLE_READER_MEM, &table_reader_usage);
       slot_item.second->db()->GetUsage(storage::PROPERTY_TYPE_ROCKSDB_BACKGROUND_ERRORS, &background_errors);
-      slot_item.second->DbRWUnLock();
+      db_size += slot_item.second->db()->GetTotalSstFilesSize();
+      slot_item.second->db()->GetSstFilesSize(&slot_sst_sizes);
+      slot_item.second->DbRWUnLockReader();
+      for (const auto& [name, size] : slot_sst_sizes) {
+        sst_sizes[name].live += size.live;
+        sst_sizes[name].total += size.total;
+      }
+      std::shared_ptr<SyncMasterSlot> master_slot = g_pika_rm->GetSyncMasterSlotByName(
+          SlotInfo(slot_item.second->GetDBName(), slot_item.second->GetSlotID()));
+      if (master_slot && master_slot->Logger()) {
+        log_size += master_slot->Logger()->DiskSize();
+      }
       total_memtable_usage += memtable_usage;
       total_table_reader_usage += table_reader_usage;
       for (const auto& item : background_errors) {
@@ -1162,8 +1309,19 @@ void InfoCmd::InfoData(std::string& info) {
     }
   }
 
+  tmp_stream << "# Data"
+             << "\r\n";
+  tmp_stream << "db_size:" << db_size << "\r\n";
+  tmp_stream << "db_size_human:" << (db_size >> 20) << "M\r\n";
+  tmp_stream << "log_size:" << log_size << "\r\n";
+  tmp_stream << "log_size_human:" << (log_size >> 20) << "M\r\n";
+  for (const auto& [name, size] : sst_sizes) {
+    tmp_stream << "sst_size_" << name << ":live=" << size.live << ",total=" << size.total << "\r\n";
+  }
+  tmp_stream << "compression:" << g_pika_conf->compression() << "\r\n";
   tmp_stream << "used_memory:" << (total_memtable_usage + total_table_reader_usage) << "\r\n";
   tmp_stream << "used_memory_human:" << ((total_memtable_usage + total_table_reader_usage) >> 20) << "M\r\n";
+  tmp_stream << "used_memory_lua:" << g_pika_server->script_cache()->lua_memory() << "\r\n";
   tmp_stream << "db_memtable_usage:" << total_memtable_usage << "\r\n";
   tmp_stream << "db_tablereader_usage:" << total_table_reader_usage << "\r\n";
   tmp_stream << "db_fatal:" << (total_background_errors != 0 ? "1" : "0") << "\r\n";
@@ -1188,7 +1346,7 @@ void InfoCmd::InfoRocksDB(std::string& info) {
       std::string rocksdb_info;
       slot_item.second->DbRWLockReader();
       slot_item.second->db()->GetRocksDBInfo(rocksdb_info);
-      slot_item.second->DbRWUnLock();
+      slot_item.second->DbRWUnLockReader();
       tmp_stream << rocksdb_info;
     }
   }
@@ -1311,6 +1469,18 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeInt32(&config_body, g_pika_conf->thread_pool_size());
   }
 
+  if (pstd::stringmatch(pattern.data(), "io-multiplexer", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "io-multiplexer");
+    EncodeString(&config_body, g_pika_conf->io_multiplexer());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "reuse-port", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "reuse-port");
+    EncodeString(&config_body, g_pika_conf->reuse_port() ? "yes" : "no");
+  }
+
   if (pstd::stringmatch(pattern.data(), "sync-thread-num", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "sync-thread-num");
@@ -1395,6 +1565,12 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeInt32(&config_body, g_pika_conf->databases());
   }
 
+  if (pstd::stringmatch(pattern.data(), "db-shard-num", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "db-shard-num");
+    EncodeInt32(&config_body, g_pika_conf->db_shard_num());
+  }
+
   if (pstd::stringmatch(pattern.data(), "daemonize", 1)) {
     elements += 2;
     EncodeString(&config_body, "daemonize");
@@ -1419,6 +1595,18 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeInt32(&config_body, g_pika_conf->expire_dump_days());
   }
 
+  if (pstd::stringmatch(pattern.data(), "dump-pin-sequence", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "dump-pin-sequence");
+    EncodeString(&config_body, g_pika_conf->bgsave_pin_sequence() ? "yes" : "no");
+  }
+
+  if (pstd::stringmatch(pattern.data(), "dump-incremental", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "dump-incremental");
+    EncodeString(&config_body, g_pika_conf->bgsave_incremental() ? "yes" : "no");
+  }
+
   if (pstd::stringmatch(pattern.data(), "dump-prefix", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "dump-prefix");
@@ -1455,6 +1643,24 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeInt32(&config_body, g_pika_conf->small_compaction_threshold());
   }
 
+  if (pstd::stringmatch(pattern.data(), "active-expire-cpu-percent", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "active-expire-cpu-percent");
+    EncodeInt32(&config_body, g_pika_conf->active_expire_cpu_percent());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "hash-max-inline-fields", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "hash-max-inline-fields");
+    EncodeInt32(&config_body, g_pika_conf->hash_max_inline_fields());
+  }
+
+  if (pstd::stringmatch(pattern.data(), "hash-max-inline-value", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "hash-max-inline-value");
+    EncodeInt32(&config_body, g_pika_conf->hash_max_inline_value());
+  }
+
   if (pstd::stringmatch(pattern.data(), "max-background-flushes", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "max-background-flushes");
@@ -1545,6 +1751,12 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeInt32(&config_body, g_pika_conf->slowlog_slower_than());
   }
 
+  if (pstd::stringmatch(pattern.data(), "lua-time-limit", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "lua-time-limit");
+    EncodeInt32(&config_body, g_pika_conf->lua_time_limit());
+  }
+
   if (pstd::stringmatch(pattern.data(), "slowlog-max-len", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "slowlog-max-len");
@@ -1575,6 +1787,12 @@ void ConfigCmd::ConfigGet(std::string& ret) {
     EncodeInt64(&config_body, g_pika_conf->max_client_response_size());
   }
 
+  if (pstd::stringmatch(pattern.data(), "tracking-table-max-keys", 1) != 0) {
+    elements += 2;
+    EncodeString(&config_body, "tracking-table-max-keys");
+    EncodeInt64(&config_body, g_pika_conf->tracking_table_max_keys());
+  }
+
   if (pstd::stringmatch(pattern.data(), "compression", 1) != 0) {
     elements += 2;
     EncodeString(&config_body, "compression");
@@ -1702,16 +1920,21 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     EncodeString(&ret, "dump-prefix");
     EncodeString(&ret, "maxclients");
     EncodeString(&ret, "dump-expire");
+    EncodeString(&ret, "dump-pin-sequence");
+    EncodeString(&ret, "dump-incremental");
     EncodeString(&ret, "expire-logs-days");
     EncodeString(&ret, "expire-logs-nums");
     EncodeString(&ret, "root-connection-num");
     EncodeString(&ret, "slowlog-write-errorlog");
     EncodeString(&ret, "slowlog-log-slower-than");
+    EncodeString(&ret, "lua-time-limit");
     EncodeString(&ret, "slowlog-max-len");
     EncodeString(&ret, "write-binlog");
     EncodeString(&ret, "max-cache-statistic-keys");
     EncodeString(&ret, "small-compaction-threshold");
+    EncodeString(&ret, "active-expire-cpu-percent");
     EncodeString(&ret, "max-client-response-size");
+    EncodeString(&ret, "tracking-table-max-keys");
     EncodeString(&ret, "db-sync-speed");
     EncodeString(&ret, "compact-cron");
     EncodeString(&ret, "compact-interval");
@@ -1769,6 +1992,20 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     }
     g_pika_conf->SetExpireDumpDays(ival);
     ret = "+OK\r\n";
+  } else if (set_item == "dump-pin-sequence") {
+    if (value != "yes" && value != "no") {
+      ret = "-ERR invalid dump-pin-sequence (yes or no)\r\n";
+      return;
+    }
+    g_pika_conf->SetBgsavePinSequence(value);
+    ret = "+OK\r\n";
+  } else if (set_item == "dump-incremental") {
+    if (value != "yes" && value != "no") {
+      ret = "-ERR invalid dump-incremental (yes or no)\r\n";
+      return;
+    }
+    g_pika_conf->SetBgsaveIncremental(value);
+    ret = "+OK\r\n";
   } else if (set_item == "slave-priority") {
     if (pstd::string2int(value.data(), value.size(), &ival) == 0) {
       ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'slave-priority'\r\n";
@@ -1816,6 +2053,13 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     }
     g_pika_conf->SetSlowlogSlowerThan(ival);
     ret = "+OK\r\n";
+  } else if (set_item == "lua-time-limit") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'lua-time-limit'\r\n";
+      return;
+    }
+    g_pika_conf->SetLuaTimeLimit(static_cast<int>(ival));
+    ret = "+OK\r\n";
   } else if (set_item == "slowlog-max-len") {
     if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0) {
       ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'slowlog-max-len'\r\n";
@@ -1840,6 +2084,14 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     g_pika_conf->SetSmallCompactionThreshold(ival);
     g_pika_server->SlotSetSmallCompactionThreshold(ival);
     ret = "+OK\r\n";
+  } else if (set_item == "active-expire-cpu-percent") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0 || ival > 100) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'active-expire-cpu-percent'\r\n";
+      return;
+    }
+    g_pika_conf->SetActiveExpireCpuPercent(static_cast<int>(ival));
+    g_pika_server->SlotSetActiveExpireCpuPercent(static_cast<int>(ival));
+    ret = "+OK\r\n";
   } else if (set_item == "max-client-response-size") {
     if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0) {
       ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'max-client-response-size'\r\n";
@@ -1847,6 +2099,14 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     }
     g_pika_conf->SetMaxClientResponseSize(ival);
     ret = "+OK\r\n";
+  } else if (set_item == "tracking-table-max-keys") {
+    if ((pstd::string2int(value.data(), value.size(), &ival) == 0) || ival < 0) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'tracking-table-max-keys'\r\n";
+      return;
+    }
+    g_pika_conf->SetTrackingTableMaxKeys(ival);
+    g_pika_server->client_tracking()->SetMaxKeys(static_cast<size_t>(ival));
+    ret = "+OK\r\n";
   } else if (set_item == "write-binlog") {
     int role = g_pika_server->role();
     if (role == PIKA_ROLE_SLAVE) {
@@ -2266,13 +2526,31 @@ void PKPatternMatchDelCmd::DoInitial() {
 }
 
 void PKPatternMatchDelCmd::Do(std::shared_ptr<Slot> slot) {
-  int ret = 0;
-  rocksdb::Status s = slot->db()->PKPatternMatchDel(type_, pattern_, &ret);
-  if (s.ok()) {
-    res_.AppendInteger(ret);
-  } else {
-    res_.SetRes(CmdRes::kErrOther, s.ToString());
+  // the command has no key, it runs on the first shard and deletes the
+  // matching keys of all of them
+  std::vector<std::shared_ptr<Slot>> shards{slot};
+  std::shared_ptr<DB> db = g_pika_server->GetDB(db_name_);
+  if (db && db->SlotNum() > 1) {
+    shards.clear();
+    for (uint32_t slot_id = 0; slot_id < db->SlotNum(); slot_id++) {
+      std::shared_ptr<Slot> shard = db->GetSlotById(slot_id);
+      if (shard) {
+        shards.push_back(shard);
+      }
+    }
   }
+
+  int total = 0;
+  for (const auto& shard : shards) {
+    int ret = 0;
+    rocksdb::Status s = shard->db()->PKPatternMatchDel(type_, pattern_, &ret);
+    if (!s.ok()) {
+      res_.SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+    total += ret;
+  }
+  res_.AppendInteger(total);
 }
 
 void DummyCmd::DoInitial() {}
@@ -2354,12 +2632,17 @@ void HelloCmd::Do(std::shared_ptr<Slot> slot) {
     }
   }
 
+  // the replies from this one on, this reply too
+  if (ver != 0) {
+    conn->set_resp_version(static_cast<int>(ver));
+    res_.SetRespVersion(static_cast<int>(ver));
+  }
+
   std::string raw;
   std::vector<storage::FieldValue> fvs{
       {"server", "redis"},
   };
-  // just for redis resp2 protocol
-  fvs.push_back({"proto", "2"});
+  fvs.push_back({"proto", std::to_string(conn->resp_version())});
   fvs.push_back({"mode", "classic"});
   int host_role = g_pika_server->role();
   switch (host_role) {
@@ -2389,7 +2672,7 @@ void HelloCmd::Do(std::shared_ptr<Slot> slot) {
     RedisAppendLen(raw, fv.value.size(), "$");
     RedisAppendContent(raw, fv.value);
   }
-  res_.AppendArrayLen(fvs.size() * 2);
+  res_.AppendMapLen(fvs.size());
   res_.AppendStringRaw(raw);
 }
 
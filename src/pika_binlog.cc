@@ -7,11 +7,13 @@
 
 #include <fcntl.h>
 #include <glog/logging.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include <utility>
 
 #include "include/pika_binlog_transverter.h"
+#include "pstd/include/pstd_string.h"
 #include "pstd_status.h"
 
 using pstd::Status;
@@ -70,7 +72,7 @@ Binlog::Binlog(std::string  binlog_path, const int file_size)
 
   Status s;
 
-  pstd::CreateDir(binlog_path_);
+  pstd::CreatePath(binlog_path_);
 
   filename_ = binlog_path_ + kBinlogPrefix;
   const std::string manifest = binlog_path_ + kManifest;
@@ -121,6 +123,7 @@ Binlog::Binlog(std::string  binlog_path, const int file_size)
   }
 
   InitLogFile();
+  UpdateArchivedSize();
 }
 
 Binlog::~Binlog() {
@@ -144,6 +147,37 @@ void Binlog::InitLogFile() {
   opened_.store(true);
 }
 
+uint64_t Binlog::DiskSize() {
+  std::shared_lock l(version_->rwlock_);
+  return archived_size_.load() + version_->pro_offset_;
+}
+
+void Binlog::UpdateArchivedSize() {
+  uint32_t pro_num = 0;
+  {
+    std::shared_lock l(version_->rwlock_);
+    pro_num = version_->pro_num_;
+  }
+  std::vector<std::string> children;
+  if (pstd::GetChildren(binlog_path_, children) != 0) {
+    return;
+  }
+  uint64_t size = 0;
+  for (const auto& child : children) {
+    unsigned long filenum = 0;
+    if (child.compare(0, kBinlogPrefixLen, kBinlogPrefix) != 0 ||
+        pstd::string2int(child.data() + kBinlogPrefixLen, child.size() - kBinlogPrefixLen, &filenum) == 0 ||
+        filenum >= pro_num) {
+      continue;
+    }
+    struct stat file_stat;
+    if (stat((binlog_path_ + child).c_str(), &file_stat) == 0) {
+      size += file_stat.st_size;
+    }
+  }
+  archived_size_ = size;
+}
+
 Status Binlog::GetProducerStatus(uint32_t* filenum, uint64_t* pro_offset, uint32_t* term, uint64_t* logic_id) {
   if (!opened_.load()) {
     return Status::Busy("Binlog is not open yet");
@@ -192,6 +226,7 @@ Status Binlog::Put(const char* item, int len) {
     queue_.reset();
     queue_ = std::move(queue);
     pro_num_++;
+    archived_size_ += filesize;
 
     {
       std::lock_guard l(version_->rwlock_);
@@ -376,6 +411,7 @@ Status Binlog::SetProducerStatus(uint32_t pro_num, uint64_t pro_offset, uint32_t
   }
 
   InitLogFile();
+  UpdateArchivedSize();
   return Status::OK();
 }
 
@@ -406,6 +442,7 @@ Status Binlog::Truncate(uint32_t pro_num, uint64_t pro_offset, uint64_t index) {
   }
 
   InitLogFile();
+  UpdateArchivedSize();
 
   return Status::OK();
 }
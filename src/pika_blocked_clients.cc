@@ -0,0 +1,207 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_blocked_clients.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "include/pika_client_conn.h"
+#include "include/pika_list.h"
+#include "pstd/include/env.h"
+
+using namespace std::chrono_literals;
+
+static std::string DBKey(const std::string& db_name, std::string_view key) {
+  std::string db_key;
+  db_key.reserve(db_name.size() + 1 + key.size());
+  db_key.append(db_name);
+  db_key.push_back('\0');
+  db_key.append(key.data(), key.size());
+  return db_key;
+}
+
+PikaBlockedClients::PikaBlockedClients() { set_thread_name("BlockedClients"); }
+
+PikaBlockedClients::~PikaBlockedClients() {
+  StopThread();
+  LOG(INFO) << "PikaBlockedClients thread " << thread_id() << " exit!!!";
+}
+
+void PikaBlockedClients::Block(const std::shared_ptr<BlockingPopCmd>& cmd, const std::shared_ptr<PikaClientConn>& conn,
+                               const std::shared_ptr<std::string>& resp) {
+  auto client = std::make_shared<BlockedClient>();
+  client->cmd = cmd;
+  client->conn = conn;
+  client->resp = resp;
+  if (cmd->timeout_us() != 0) {
+    client->deadline_us = pstd::NowMicros() + cmd->timeout_us();
+  }
+  for (const auto& key : cmd->blocking_keys()) {
+    std::string db_key = DBKey(cmd->db_name(), key);
+    if (std::find(client->db_keys.begin(), client->db_keys.end(), db_key) == client->db_keys.end()) {
+      client->db_keys.push_back(std::move(db_key));
+    }
+  }
+
+  std::lock_guard l(mu_);
+  clients_.push_back(client);
+  for (const auto& db_key : client->db_keys) {
+    keys_[db_key].push_back(client);
+    // a push may come between the failed pop and here, so try once more
+    if (ready_set_.insert(db_key).second) {
+      ready_keys_.push_back(db_key);
+    }
+  }
+  num_blocked_++;
+  has_ready_keys_ = true;
+}
+
+void PikaBlockedClients::UnblockConn(int fd, const std::string& ip_port) {
+  if (num_blocked_.load() == 0) {
+    return;
+  }
+  // a client being served has popped its element already, it is answered
+  // before it is dropped, or the element is lost
+  std::lock_guard serve_lock(serve_mu_);
+  std::vector<std::shared_ptr<BlockedClient>> closed;
+  {
+    std::lock_guard l(mu_);
+    for (const auto& client : clients_) {
+      if (client->conn->fd() == fd && client->conn->ip_port() == ip_port) {
+        closed.push_back(client);
+      }
+    }
+  }
+  for (const auto& client : closed) {
+    if (!client->done.exchange(true)) {
+      Unregister(client);
+    }
+  }
+}
+
+void PikaBlockedClients::SignalKeyReady(const std::string& db_name, std::string_view key) {
+  if (num_blocked_.load() == 0) {
+    return;
+  }
+  std::string db_key = DBKey(db_name, key);
+  std::lock_guard l(mu_);
+  if (keys_.find(db_key) == keys_.end()) {
+    return;
+  }
+  if (ready_set_.insert(db_key).second) {
+    ready_keys_.push_back(std::move(db_key));
+  }
+  has_ready_keys_ = true;
+}
+
+void PikaBlockedClients::ServeReadyKeys() {
+  std::lock_guard serve_lock(serve_mu_);
+  while (true) {
+    std::vector<std::string> ready_keys;
+    {
+      std::lock_guard l(mu_);
+      ready_keys.swap(ready_keys_);
+      ready_set_.clear();
+      has_ready_keys_ = false;
+    }
+    if (ready_keys.empty()) {
+      return;
+    }
+    // serving a key may push to other ones, like BRPOPLPUSH does, they are
+    // served in the next round
+    for (const auto& db_key : ready_keys) {
+      ServeKey(db_key);
+    }
+  }
+}
+
+void PikaBlockedClients::ServeKey(const std::string& db_key) {
+  std::vector<std::shared_ptr<BlockedClient>> clients;
+  {
+    std::lock_guard l(mu_);
+    auto iter = keys_.find(db_key);
+    if (iter == keys_.end()) {
+      return;
+    }
+    clients.assign(iter->second.begin(), iter->second.end());
+  }
+  for (const auto& client : clients) {
+    if (client->done.load()) {
+      continue;
+    }
+    client->cmd->Retry();
+    if (client->cmd->is_blocked()) {
+      // the key is empty again, the clients behind wait for the next push
+      break;
+    }
+    Reply(client);
+  }
+}
+
+void PikaBlockedClients::CheckBlockedClients() {
+  if (num_blocked_.load() == 0) {
+    return;
+  }
+  std::lock_guard serve_lock(serve_mu_);
+  std::vector<std::shared_ptr<BlockedClient>> clients;
+  {
+    std::lock_guard l(mu_);
+    clients.assign(clients_.begin(), clients_.end());
+  }
+
+  uint64_t now_us = pstd::NowMicros();
+  for (const auto& client : clients) {
+    if (client->done.load()) {
+      continue;
+    }
+    if (client->deadline_us != 0 && now_us >= client->deadline_us) {
+      client->cmd->ReplyTimeout();
+      Reply(client);
+    }
+  }
+}
+
+void PikaBlockedClients::Unregister(const std::shared_ptr<BlockedClient>& client) {
+  std::lock_guard l(mu_);
+  clients_.remove(client);
+  for (const auto& db_key : client->db_keys) {
+    auto iter = keys_.find(db_key);
+    if (iter == keys_.end()) {
+      continue;
+    }
+    iter->second.remove(client);
+    if (iter->second.empty()) {
+      keys_.erase(iter);
+    }
+  }
+  num_blocked_--;
+}
+
+void PikaBlockedClients::Reply(const std::shared_ptr<BlockedClient>& client) {
+  if (client->done.exchange(true)) {
+    return;
+  }
+  Unregister(client);
+  *client->resp = client->cmd->res().message();
+  // last step to update resp_num, see PikaClientConn::DoExecTask
+  client->conn->resp_num--;
+  client->conn->TryWriteResp();
+}
+
+void* PikaBlockedClients::ThreadMain() {
+  while (!should_stop()) {
+    {
+      std::unique_lock l(cron_mu_);
+      cron_cv_.wait_for(l, 100ms);
+    }
+    CheckBlockedClients();
+    if (HasReadyKeys()) {
+      ServeReadyKeys();
+    }
+  }
+  return nullptr;
+}
@@ -12,8 +12,10 @@
 #include <glog/logging.h>
 
 #include "include/pika_admin.h"
+#include "include/pika_blocked_clients.h"
 #include "include/pika_cmd_table_manager.h"
 #include "include/pika_conf.h"
+#include "include/pika_list.h"
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
 
@@ -26,10 +28,20 @@ PikaClientConn::PikaClientConn(int fd, const std::string& ip_port, net::Thread*
                                const net::HandleType& handle_type, int max_conn_rbuf_size)
     : RedisConn(fd, ip_port, thread, mpx, handle_type, max_conn_rbuf_size),
       server_thread_(reinterpret_cast<net::ServerThread*>(thread)),
-      current_db_(g_pika_conf->default_db()) {
+      current_db_(g_pika_conf->default_db()),
+      id_(next_id_.fetch_add(1) + 1) {
   auth_stat_.Init();
 }
 
+PikaClientConn::~PikaClientConn() {
+  UnwatchKeys();
+  if (registered_) {
+    g_pika_server->client_tracking()->Remove(id_);
+  }
+}
+
+std::atomic<uint64_t> PikaClientConn::next_id_ = 0;
+
 std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const std::string& opt,
                                            const std::shared_ptr<std::string>& resp_ptr) {
   // Get command info
@@ -37,15 +49,23 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
   if (!c_ptr) {
     std::shared_ptr<Cmd> tmp_ptr = std::make_shared<DummyCmd>(DummyCmd());
     tmp_ptr->res().SetRes(CmdRes::kErrOther, "unknown command \"" + opt + "\"");
+    if (in_multi_) {
+      multi_dirty_ = true;
+    }
     return tmp_ptr;
   }
   c_ptr->SetConn(shared_from_this());
   c_ptr->SetResp(resp_ptr);
+  c_ptr->res().SetRespVersion(resp_version());
+  // a command refused while queueing fails the EXEC that follows
+  bool queueing =
+      in_multi_ && opt != kCmdNameExec && opt != kCmdNameDiscard && opt != kCmdNameMulti && opt != kCmdNameWatch;
 
   // Check authed
   // AuthCmd will set stat_
   if (!auth_stat_.IsAuthed(c_ptr)) {
     c_ptr->res().SetRes(CmdRes::kErrOther, "NOAUTH Authentication required.");
+    multi_dirty_ = multi_dirty_ || queueing;
     return c_ptr;
   }
 
@@ -62,6 +82,9 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
   // Initial
   c_ptr->Initial(argv, current_db_);
   if (!c_ptr->res().ok()) {
+    if (in_multi_) {
+      multi_dirty_ = true;
+    }
     return c_ptr;
   }
 
@@ -74,6 +97,7 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
         opt != kCmdNamePUnSubscribe) {
       c_ptr->res().SetRes(CmdRes::kErrOther,
                           "only (P)SUBSCRIBE / (P)UNSUBSCRIBE / PING / QUIT allowed in this context");
+      multi_dirty_ = multi_dirty_ || queueing;
       return c_ptr;
     }
   }
@@ -83,17 +107,28 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
   }
   if (!g_pika_server->IsCommandSupport(opt)) {
     c_ptr->res().SetRes(CmdRes::kErrOther, "This command is not supported in current configuration");
+    multi_dirty_ = multi_dirty_ || queueing;
     return c_ptr;
   }
 
   // reject all the request before new master sync finished
   if (g_pika_server->leader_protected_mode()) {
     c_ptr->res().SetRes(CmdRes::kErrOther, "Cannot process command before new leader sync finished");
+    multi_dirty_ = multi_dirty_ || queueing;
     return c_ptr;
   }
 
   if (!g_pika_server->IsDBExist(current_db_)) {
     c_ptr->res().SetRes(CmdRes::kErrOther, "DB not found");
+    multi_dirty_ = multi_dirty_ || queueing;
+    return c_ptr;
+  }
+
+  // the commands of a transaction run at EXEC, checked there as a whole
+  if (queueing) {
+    if (QueueMultiCmd(c_ptr)) {
+      c_ptr->res().SetRes(CmdRes::kNone, "+QUEUED\r\n");
+    }
     return c_ptr;
   }
 
@@ -116,6 +151,11 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
     }
   }
 
+  // tracked before the read, a write racing it is told rather than missed
+  if (tracking_ && !c_ptr->is_write() && !c_ptr->is_admin() && !c_ptr->is_pubsub()) {
+    g_pika_server->client_tracking()->Track(id_, current_db_, c_ptr->current_key());
+  }
+
   // Process Command
   c_ptr->Execute();
 
@@ -129,6 +169,61 @@ std::shared_ptr<Cmd> PikaClientConn::DoCmd(const PikaCmdArgsType& argv, const st
   return c_ptr;
 }
 
+bool PikaClientConn::QueueMultiCmd(const std::shared_ptr<Cmd>& c_ptr) {
+  // EXEC runs the commands on the keys of its slot, the other ones act on the
+  // server or the connection, out of any transaction
+  bool allowed = !c_ptr->is_admin() || c_ptr->name() == kCmdNamePing || c_ptr->name() == kCmdNameEcho;
+  if (!allowed || c_ptr->is_pubsub()) {
+    c_ptr->res().SetRes(CmdRes::kErrOther, "Command not allowed inside a transaction");
+    multi_dirty_ = true;
+    return false;
+  }
+  multi_cmds_.push_back(c_ptr);
+  return true;
+}
+
+void PikaClientConn::StartMulti() {
+  in_multi_ = true;
+  multi_dirty_ = false;
+  multi_cmds_.clear();
+}
+
+bool PikaClientConn::EndMulti(std::vector<std::shared_ptr<Cmd>>* cmds) {
+  bool dirty = multi_dirty_;
+  if (!dirty) {
+    cmds->swap(multi_cmds_);
+  }
+  in_multi_ = false;
+  multi_dirty_ = false;
+  multi_cmds_.clear();
+  return !dirty;
+}
+
+void PikaClientConn::WatchKeys(const std::string& db_name, const std::vector<std::string>& keys) {
+  if (!watch_flag_) {
+    watch_flag_ = std::make_shared<std::atomic<bool>>(false);
+  }
+  for (const auto& key : keys) {
+    auto db_key = std::make_pair(db_name, key);
+    if (std::find(watched_keys_.begin(), watched_keys_.end(), db_key) != watched_keys_.end()) {
+      continue;
+    }
+    g_pika_server->watched_keys()->Watch(db_name, key, watch_flag_);
+    watched_keys_.push_back(std::move(db_key));
+  }
+}
+
+void PikaClientConn::UnwatchKeys() {
+  if (!watch_flag_) {
+    return;
+  }
+  for (const auto& [db_name, key] : watched_keys_) {
+    g_pika_server->watched_keys()->Unwatch(db_name, key, watch_flag_);
+  }
+  watched_keys_.clear();
+  watch_flag_.reset();
+}
+
 void PikaClientConn::ProcessSlowlog(const PikaCmdArgsType& argv, uint64_t start_us, uint64_t do_duration) {
   int32_t start_time = start_us / 1000000;
   int64_t duration = pstd::NowMicros() - start_us;
@@ -242,6 +337,10 @@ void PikaClientConn::BatchExecRedisCmd(const std::vector<net::RedisCmdArgsType>&
     resp_array.push_back(resp_ptr);
     ExecRedisCmd(argv, resp_ptr);
   }
+  // wake the clients blocked on the lists pushed above before answering
+  if (g_pika_server->blocked_clients()->HasReadyKeys()) {
+    g_pika_server->blocked_clients()->ServeReadyKeys();
+  }
   TryWriteResp();
 }
 
@@ -249,7 +348,7 @@ void PikaClientConn::TryWriteResp() {
   int expected = 0;
   if (resp_num.compare_exchange_strong(expected, -1)) {
     for (auto& resp : resp_array) {
-      WriteResp(*resp);
+      WriteResp(std::move(resp));
     }
     if (write_completed_cb_) {
       write_completed_cb_();
@@ -272,6 +371,14 @@ void PikaClientConn::ExecRedisCmd(const PikaCmdArgsType& argv, const std::shared
   }
 
   std::shared_ptr<Cmd> cmd_ptr = DoCmd(argv, opt, resp_ptr);
+  if (cmd_ptr->is_blocked()) {
+    // answered by PikaBlockedClients when a key is pushed or it times out,
+    // the worker is told before any reply can be
+    NotifyWaitClose();
+    g_pika_server->blocked_clients()->Block(std::static_pointer_cast<BlockingPopCmd>(cmd_ptr),
+                                            std::dynamic_pointer_cast<PikaClientConn>(shared_from_this()), resp_ptr);
+    return;
+  }
   // level == 0 or (cmd error) or (is_read)
   if (g_pika_conf->consensus_level() == 0 || !cmd_ptr->res().ok() || !cmd_ptr->is_write()) {
     *resp_ptr = std::move(cmd_ptr->res().message());
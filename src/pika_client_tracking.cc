@@ -0,0 +1,264 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_client_tracking.h"
+
+#include <algorithm>
+
+#include "include/pika_client_conn.h"
+
+static const std::string kInvalidateChannel = "__redis__:invalidate";
+
+std::string PikaClientTracking::DBKey(const std::string& db_name, const std::string& key) {
+  std::string db_key;
+  db_key.reserve(db_name.size() + 1 + key.size());
+  db_key.append(db_name);
+  db_key.push_back('\0');
+  db_key.append(key);
+  return db_key;
+}
+
+std::string PikaClientTracking::InvalidateMessage(const std::string* key, int resp_version, bool redirected) {
+  std::string message;
+  if (redirected) {
+    message.append(resp_version >= 3 ? ">3\r\n" : "*3\r\n");
+    message.append("$7\r\nmessage\r\n");
+    message.append("$" + std::to_string(kInvalidateChannel.size()) + "\r\n" + kInvalidateChannel + "\r\n");
+  } else {
+    message.append(">2\r\n$10\r\ninvalidate\r\n");
+  }
+  if (key == nullptr) {
+    message.append(resp_version >= 3 ? "_\r\n" : "*-1\r\n");
+  } else {
+    message.append("*1\r\n$" + std::to_string(key->size()) + "\r\n");
+    message.append(*key);
+    message.append("\r\n");
+  }
+  return message;
+}
+
+void PikaClientTracking::Register(uint64_t id, const std::shared_ptr<PikaClientConn>& conn) {
+  std::lock_guard l(mu_);
+  clients_[id].conn = conn;
+}
+
+void PikaClientTracking::Enable(uint64_t id, const std::shared_ptr<PikaClientConn>& conn, const Options& options) {
+  std::lock_guard l(mu_);
+  Client& client = clients_[id];
+  client.conn = conn;
+  if (!client.tracking) {
+    client.tracking = true;
+    num_tracking_++;
+  }
+  if (client.options.bcast != options.bcast) {
+    if (options.bcast) {
+      bcast_ids_.push_back(id);
+    } else {
+      bcast_ids_.erase(std::remove(bcast_ids_.begin(), bcast_ids_.end(), id), bcast_ids_.end());
+    }
+  }
+  client.options = options;
+}
+
+void PikaClientTracking::Disable(uint64_t id) {
+  std::lock_guard l(mu_);
+  auto iter = clients_.find(id);
+  if (iter == clients_.end() || !iter->second.tracking) {
+    return;
+  }
+  // its keys are left in the table, skipped when told
+  if (iter->second.options.bcast) {
+    bcast_ids_.erase(std::remove(bcast_ids_.begin(), bcast_ids_.end(), id), bcast_ids_.end());
+  }
+  iter->second.tracking = false;
+  iter->second.options = Options();
+  num_tracking_--;
+}
+
+void PikaClientTracking::Remove(uint64_t id) {
+  Disable(id);
+  std::lock_guard l(mu_);
+  clients_.erase(id);
+}
+
+bool PikaClientTracking::IsRegistered(uint64_t id) {
+  std::shared_lock l(mu_);
+  auto iter = clients_.find(id);
+  return iter != clients_.end() && !iter->second.conn.expired();
+}
+
+void PikaClientTracking::SetMaxKeys(size_t max_keys) {
+  max_keys_ = max_keys;
+  EvictKeys();
+}
+
+void PikaClientTracking::Track(uint64_t id, const std::string& db_name, const std::vector<std::string>& keys) {
+  {
+    std::shared_lock l(mu_);
+    auto iter = clients_.find(id);
+    if (iter == clients_.end() || !iter->second.tracking || iter->second.options.bcast) {
+      return;
+    }
+  }
+  for (const auto& key : keys) {
+    std::string db_key = DBKey(db_name, key);
+    KeyShard& shard = ShardOf(db_key);
+    std::lock_guard l(shard.mu);
+    auto [key_iter, inserted] = shard.keys.try_emplace(std::move(db_key));
+    auto& ids = key_iter->second;
+    if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+      ids.push_back(id);
+    }
+    if (inserted) {
+      num_keys_++;
+    }
+  }
+  size_t max_keys = max_keys_.load();
+  if (max_keys != 0 && num_keys_.load() > max_keys) {
+    EvictKeys();
+  }
+}
+
+void PikaClientTracking::AddMessage(const Client& client, const std::string* key, Messages* messages) {
+  if (client.options.redirect == 0) {
+    std::shared_ptr<PikaClientConn> conn = client.conn.lock();
+    if (conn && conn->resp_version() >= 3) {
+      messages->emplace_back(conn, InvalidateMessage(key, 3, false));
+    }
+    return;
+  }
+  auto iter = clients_.find(client.options.redirect);
+  if (iter == clients_.end()) {
+    return;
+  }
+  std::shared_ptr<PikaClientConn> conn = iter->second.conn.lock();
+  if (!conn) {
+    return;
+  }
+  int resp_version = conn->resp_version();
+  // a RESP2 connection reads the message only once subscribed
+  if (resp_version >= 3 || conn->IsPubSub()) {
+    messages->emplace_back(conn, InvalidateMessage(key, resp_version, true));
+  }
+}
+
+void PikaClientTracking::AddTrackedMessages(const ToldKeys& told, uint64_t writer_id, Messages* messages) {
+  for (const auto& [key, ids] : told) {
+    for (uint64_t id : ids) {
+      auto iter = clients_.find(id);
+      // left by a client that stopped tracking
+      if (iter == clients_.end() || !iter->second.tracking || iter->second.options.bcast) {
+        continue;
+      }
+      if (iter->second.options.noloop && id == writer_id) {
+        continue;
+      }
+      AddMessage(iter->second, &key, messages);
+    }
+  }
+}
+
+void PikaClientTracking::SendMessages(const Messages& messages) {
+  for (const auto& [conn, message] : messages) {
+    conn->WritePush(message);
+  }
+}
+
+void PikaClientTracking::EvictKeys() {
+  size_t max_keys = max_keys_.load();
+  if (max_keys == 0) {
+    return;
+  }
+  ToldKeys told;
+  while (num_keys_.load() > max_keys) {
+    KeyShard& shard = key_shards_[evict_shard_++ % kKeyShards];
+    std::lock_guard l(shard.mu);
+    if (shard.keys.empty()) {
+      continue;
+    }
+    auto key_iter = shard.keys.begin();
+    // told without its db, as the writes tell it
+    told.emplace_back(key_iter->first.substr(key_iter->first.find('\0') + 1), std::move(key_iter->second));
+    shard.keys.erase(key_iter);
+    num_keys_--;
+  }
+  if (told.empty()) {
+    return;
+  }
+  Messages messages;
+  {
+    std::shared_lock l(mu_);
+    AddTrackedMessages(told, 0, &messages);
+  }
+  SendMessages(messages);
+}
+
+void PikaClientTracking::Invalidate(const std::string& db_name, const std::vector<std::string>& keys,
+                                    uint64_t writer_id) {
+  if (num_tracking_.load() == 0) {
+    return;
+  }
+  // told once, read again to track again
+  ToldKeys told;
+  for (const auto& key : keys) {
+    std::string db_key = DBKey(db_name, key);
+    KeyShard& shard = ShardOf(db_key);
+    std::lock_guard l(shard.mu);
+    auto key_iter = shard.keys.find(db_key);
+    if (key_iter != shard.keys.end()) {
+      told.emplace_back(key, std::move(key_iter->second));
+      shard.keys.erase(key_iter);
+      num_keys_--;
+    }
+  }
+
+  Messages messages;
+  std::shared_lock l(mu_);
+  AddTrackedMessages(told, writer_id, &messages);
+  for (uint64_t id : bcast_ids_) {
+    auto iter = clients_.find(id);
+    if (iter == clients_.end() || (iter->second.options.noloop && id == writer_id)) {
+      continue;
+    }
+    const auto& prefixes = iter->second.options.prefixes;
+    for (const auto& key : keys) {
+      if (prefixes.empty() || std::any_of(prefixes.begin(), prefixes.end(), [&key](const std::string& prefix) {
+            return key.compare(0, prefix.size(), prefix) == 0;
+          })) {
+        AddMessage(iter->second, &key, &messages);
+      }
+    }
+  }
+  l.unlock();  // WritePush without lock
+  SendMessages(messages);
+}
+
+void PikaClientTracking::InvalidateAll(const std::string& db_name) {
+  if (num_tracking_.load() == 0) {
+    return;
+  }
+  std::string prefix = db_name.empty() ? "" : DBKey(db_name, "");
+  for (auto& shard : key_shards_) {
+    std::lock_guard l(shard.mu);
+    for (auto key_iter = shard.keys.begin(); key_iter != shard.keys.end();) {
+      if (key_iter->first.compare(0, prefix.size(), prefix) != 0) {
+        ++key_iter;
+        continue;
+      }
+      key_iter = shard.keys.erase(key_iter);
+      num_keys_--;
+    }
+  }
+  // every tracking client drops its cache, the keys of the other dbs too
+  Messages messages;
+  std::shared_lock l(mu_);
+  for (const auto& [id, client] : clients_) {
+    if (client.tracking) {
+      AddMessage(client, nullptr, &messages);
+    }
+  }
+  l.unlock();  // WritePush without lock
+  SendMessages(messages);
+}
@@ -17,9 +17,11 @@
 #include "include/pika_list.h"
 #include "include/pika_pubsub.h"
 #include "include/pika_rm.h"
+#include "include/pika_script.h"
 #include "include/pika_server.h"
 #include "include/pika_set.h"
 #include "include/pika_slot_command.h"
+#include "include/pika_transaction.h"
 #include "include/pika_zset.h"
 
 using pstd::Status;
@@ -28,6 +30,9 @@ extern PikaServer* g_pika_server;
 extern std::unique_ptr<PikaReplicaManager> g_pika_rm;
 extern std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
 
+// see Cmd::BinlogCapture
+static thread_local std::vector<std::string>* binlog_capture = nullptr;
+
 void InitCmdTable(CmdTable* cmd_table) {
   // Admin
   ////Slaveof
@@ -43,6 +48,9 @@ void InitCmdTable(CmdTable* cmd_table) {
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameBgsave, std::move(bgsaveptr)));
   std::unique_ptr<Cmd> compactptr = std::make_unique<CompactCmd>(kCmdNameCompact, -1, kCmdFlagsRead | kCmdFlagsAdmin);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameCompact, std::move(compactptr)));
+  std::unique_ptr<Cmd> bulkloadptr =
+      std::make_unique<BulkloadCmd>(kCmdNameBulkload, 2, kCmdFlagsRead | kCmdFlagsAdmin | kCmdFlagsSuspend);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameBulkload, std::move(bulkloadptr)));
   std::unique_ptr<Cmd> purgelogsto =
       std::make_unique<PurgelogstoCmd>(kCmdNamePurgelogsto, -2, kCmdFlagsRead | kCmdFlagsAdmin);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNamePurgelogsto, std::move(purgelogsto)));
@@ -377,6 +385,22 @@ void InitCmdTable(CmdTable* cmd_table) {
   std::unique_ptr<Cmd> pkhrscanrangeptr = std::make_unique<PKHRScanRangeCmd>(
       kCmdNamePKHRScanRange, -4, kCmdFlagsRead | kCmdFlagsSingleSlot | kCmdFlagsHash);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNamePKHRScanRange, std::move(pkhrscanrangeptr)));
+  ////HExpireCmd
+  std::unique_ptr<Cmd> hexpireptr =
+      std::make_unique<HExpireCmd>(kCmdNameHExpire, -6, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsHash);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameHExpire, std::move(hexpireptr)));
+  ////HExpireatCmd
+  std::unique_ptr<Cmd> hexpireatptr =
+      std::make_unique<HExpireatCmd>(kCmdNameHExpireat, -6, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsHash);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameHExpireat, std::move(hexpireatptr)));
+  ////HTtlCmd
+  std::unique_ptr<Cmd> httlptr =
+      std::make_unique<HTtlCmd>(kCmdNameHTtl, -5, kCmdFlagsRead | kCmdFlagsSingleSlot | kCmdFlagsHash);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameHTtl, std::move(httlptr)));
+  ////HPersistCmd
+  std::unique_ptr<Cmd> hpersistptr =
+      std::make_unique<HPersistCmd>(kCmdNameHPersist, -5, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsHash);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameHPersist, std::move(hpersistptr)));
 
   // List
   std::unique_ptr<Cmd> lindexptr =
@@ -417,6 +441,15 @@ void InitCmdTable(CmdTable* cmd_table) {
   std::unique_ptr<Cmd> rpoplpushptr =
       std::make_unique<RPopLPushCmd>(kCmdNameRPopLPush, 3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameRPopLPush, std::move(rpoplpushptr)));
+  std::unique_ptr<Cmd> blpopptr =
+      std::make_unique<BLPopCmd>(kCmdNameBLPop, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameBLPop, std::move(blpopptr)));
+  std::unique_ptr<Cmd> brpopptr =
+      std::make_unique<BRPopCmd>(kCmdNameBRPop, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameBRPop, std::move(brpopptr)));
+  std::unique_ptr<Cmd> brpoplpushptr =
+      std::make_unique<BRPopLPushCmd>(kCmdNameBRPopLPush, 4, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameBRPopLPush, std::move(brpoplpushptr)));
   std::unique_ptr<Cmd> rpushptr =
       std::make_unique<RPushCmd>(kCmdNameRPush, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsList);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameRPush, std::move(rpushptr)));
@@ -670,6 +703,37 @@ void InitCmdTable(CmdTable* cmd_table) {
   ////PubSub
   std::unique_ptr<Cmd> pubsubptr = std::make_unique<PubSubCmd>(kCmdNamePubSub, -2, kCmdFlagsRead | kCmdFlagsPubSub);
   cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNamePubSub, std::move(pubsubptr)));
+
+  // Transaction
+  ////Multi
+  std::unique_ptr<Cmd> multiptr = std::make_unique<MultiCmd>(kCmdNameMulti, 1, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameMulti, std::move(multiptr)));
+  ////Exec
+  std::unique_ptr<Cmd> execptr =
+      std::make_unique<ExecCmd>(kCmdNameExec, -1, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameExec, std::move(execptr)));
+  ////Discard
+  std::unique_ptr<Cmd> discardptr = std::make_unique<DiscardCmd>(kCmdNameDiscard, 1, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameDiscard, std::move(discardptr)));
+  ////Watch
+  std::unique_ptr<Cmd> watchptr = std::make_unique<WatchCmd>(kCmdNameWatch, -2, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameWatch, std::move(watchptr)));
+  ////UnWatch
+  std::unique_ptr<Cmd> unwatchptr = std::make_unique<UnWatchCmd>(kCmdNameUnWatch, 1, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameUnWatch, std::move(unwatchptr)));
+
+  // Script
+  ////Eval
+  std::unique_ptr<Cmd> evalptr =
+      std::make_unique<EvalCmd>(kCmdNameEval, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameEval, std::move(evalptr)));
+  ////EvalSha
+  std::unique_ptr<Cmd> evalshaptr =
+      std::make_unique<EvalShaCmd>(kCmdNameEvalSha, -3, kCmdFlagsWrite | kCmdFlagsSingleSlot | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameEvalSha, std::move(evalshaptr)));
+  ////Script
+  std::unique_ptr<Cmd> scriptptr = std::make_unique<ScriptCmd>(kCmdNameScript, -2, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, std::unique_ptr<Cmd>>(kCmdNameScript, std::move(scriptptr)));
 }
 
 Cmd* GetCmdFromDB(const std::string& opt, const CmdTable& cmd_table) {
@@ -714,6 +778,7 @@ void Cmd::ProcessFlushDBCmd() {
     if (db->IsKeyScaning()) {
       res_.SetRes(CmdRes::kErrOther, "The keyscan operation is executing, Try again later");
     } else {
+      g_pika_server->TouchKeysBeforeFlush(db_name_);
       std::lock_guard l_prw(db->slots_rw_);
       std::lock_guard s_prw(g_pika_rm->slots_rw_);
       for (const auto& slot_item : db->slots_) {
@@ -725,12 +790,15 @@ void Cmd::ProcessFlushDBCmd() {
         }
         ProcessCommand(slot, g_pika_rm->sync_master_slots_[p_info]);
       }
+      g_pika_server->client_tracking()->InvalidateAll(db_name_);
       res_.SetRes(CmdRes::kOk);
     }
   }
 }
 
 void Cmd::ProcessFlushAllCmd() {
+  // before the lock of the dbs, which the existence checks take too
+  g_pika_server->TouchKeysBeforeFlush("");
   std::lock_guard l_trw(g_pika_server->dbs_rw_);
   for (const auto& db_item : g_pika_server->dbs_) {
     if (db_item.second->IsKeyScaning()) {
@@ -752,13 +820,40 @@ void Cmd::ProcessFlushAllCmd() {
       ProcessCommand(slot, g_pika_rm->sync_master_slots_[p_info]);
     }
   }
+  g_pika_server->client_tracking()->InvalidateAll("");
   res_.SetRes(CmdRes::kOk);
 }
 
 void Cmd::ProcessSingleSlotCmd() {
-  std::shared_ptr<Slot> slot;
-  slot = g_pika_server->GetSlotByDBName(db_name_);
-
+  std::shared_ptr<DB> db = g_pika_server->GetDB(db_name_);
+  if (!db) {
+    res_.SetRes(CmdRes::kErrOther, "Slot not found");
+    return;
+  }
+  // a db split into shards runs the command on the shard of its keys, a
+  // command without keys on the first one
+  uint32_t slot_id = 0;
+  if (db->SlotNum() > 1) {
+    bool routed = false;
+    for (const auto& key : current_key()) {
+      if (key.empty()) {
+        continue;
+      }
+      uint32_t key_slot_id = g_pika_cmd_table_manager->DistributeKey(key, db->SlotNum());
+      if (!routed) {
+        slot_id = key_slot_id;
+        routed = true;
+      } else if (key_slot_id != slot_id) {
+        if (IsSplittable()) {
+          ProcessMultiSlotCmd();
+        } else {
+          res_.SetRes(CmdRes::kErrOther, "CROSSSLOT Keys in request don't hash to the same shard");
+        }
+        return;
+      }
+    }
+  }
+  std::shared_ptr<Slot> slot = db->GetSlotById(slot_id);
   if (!slot) {
     res_.SetRes(CmdRes::kErrOther, "Slot not found");
     return;
@@ -781,16 +876,31 @@ void Cmd::ProcessCommand(const std::shared_ptr<Slot>& slot, const std::shared_pt
     if (stage_ == kBinlogStage) {
       DoBinlog(sync_slot);
     } else if (stage_ == kExecuteStage) {
+      if (!is_suspend()) {
+        slot->DbRWLockReader();
+      }
       DoCommand(slot, hint_keys);
+      if (!is_suspend()) {
+        slot->DbRWUnLockReader();
+      }
     }
   }
 }
 
 void Cmd::InternalProcessCommand(const std::shared_ptr<Slot>& slot, const std::shared_ptr<SyncMasterSlot>& sync_slot,
                                  const HintKeys& hint_keys) {
+  // the keys are locked once here, the storage layer below shares the lock
+  // manager and passes through the stripes this thread already holds
   pstd::lock::MultiRecordLock record_lock(slot->LockMgr());
   if (is_write()) {
-    record_lock.Lock(current_key());
+    record_lock.Lock(hint_keys.empty() ? current_key() : hint_keys.keys);
+  }
+
+  // db_rwlock_ is held shared from the write to the dbs to the write to the
+  // binlog, a bgsave holding it takes the binlog offset and the sequence
+  // numbers of the dbs at the same point
+  if (!is_suspend()) {
+    slot->DbRWLockReader();
   }
 
   uint64_t start_us = 0;
@@ -802,27 +912,56 @@ void Cmd::InternalProcessCommand(const std::shared_ptr<Slot>& slot, const std::s
     do_duration_ += pstd::NowMicros() - start_us;
   }
 
-  DoBinlog(sync_slot);
+  if (is_write() && res().ok() && !is_blocked()) {
+    TouchWatchedKeys();
+  }
 
-  if (is_write()) {
-    record_lock.Unlock(current_key());
+  if (hint_keys.empty()) {
+    DoBinlog(sync_slot);
+  } else {
+    // the binlog of each slot only has the keys of that slot, the binlog is
+    // encoded before DoBinlog returns
+    PikaCmdArgsType argv = SplitArgv(hint_keys);
+    argv_.swap(argv);
+    DoBinlog(sync_slot);
+    argv_.swap(argv);
   }
-}
 
-void Cmd::DoCommand(const std::shared_ptr<Slot>& slot, const HintKeys& hint_keys) {
   if (!is_suspend()) {
-    slot->DbRWLockReader();
+    slot->DbRWUnLockReader();
   }
 
-  Do(slot);
+  if (is_write()) {
+    record_lock.Unlock();
+  }
+}
 
-  if (!is_suspend()) {
-    slot->DbRWUnLock();
+void Cmd::DoCommand(const std::shared_ptr<Slot>& slot, const HintKeys& hint_keys) {
+  if (hint_keys.empty()) {
+    Do(slot);
+  } else {
+    Split(slot, hint_keys);
   }
 }
 
+PikaCmdArgsType Cmd::SplitArgv(const HintKeys& hint_keys) const {
+  PikaCmdArgsType argv{argv_[0]};
+  argv.insert(argv.end(), hint_keys.keys.begin(), hint_keys.keys.end());
+  return argv;
+}
+
+void Cmd::TouchWatchedKeys() { g_pika_server->TouchKeys(db_name_, current_key(), GetConn()); }
+
+Cmd::BinlogCapture::BinlogCapture(std::vector<std::string>* binlogs) { binlog_capture = binlogs; }
+
+Cmd::BinlogCapture::~BinlogCapture() { binlog_capture = nullptr; }
+
 void Cmd::DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) {
   if (res().ok() && is_write() && g_pika_conf->write_binlog()) {
+    if (binlog_capture != nullptr) {
+      binlog_capture->push_back(ToBinlog(0, 0, 0, 0, 0).substr(BINLOG_ENCODE_LEN));
+      return;
+    }
     std::shared_ptr<net::NetConn> conn_ptr = GetConn();
     std::shared_ptr<std::string> resp_ptr = GetResp();
     // Consider that dummy cmd appended by system, both conn and resp are null.
@@ -913,6 +1052,8 @@ bool Cmd::is_suspend() const { return ((flag_ & kCmdFlagsMaskSuspend) == kCmdFla
 bool Cmd::is_admin_require() const { return ((flag_ & kCmdFlagsMaskAdminRequire) == kCmdFlagsAdminRequire); }
 bool Cmd::is_single_slot() const { return ((flag_ & kCmdFlagsMaskSlot) == kCmdFlagsSingleSlot); }
 bool Cmd::is_multi_slot() const { return ((flag_ & kCmdFlagsMaskSlot) == kCmdFlagsMultiSlot); }
+bool Cmd::is_admin() const { return ((flag_ & kCmdFlagsMaskType) == kCmdFlagsAdmin); }
+bool Cmd::is_pubsub() const { return ((flag_ & kCmdFlagsMaskType) == kCmdFlagsPubSub); }
 
 bool Cmd::HashtagIsConsistent(const std::string& lhs, const std::string& rhs) const { return true; }
 
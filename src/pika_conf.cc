@@ -189,6 +189,10 @@ int PikaConf::Load() {
   GetConfInt("slowlog-log-slower-than", &tmp_slowlog_log_slower_than);
   slowlog_log_slower_than_.store(tmp_slowlog_log_slower_than);
 
+  int tmp_lua_time_limit = 5000;
+  GetConfInt("lua-time-limit", &tmp_lua_time_limit);
+  lua_time_limit_.store(tmp_lua_time_limit < 0 ? 0 : tmp_lua_time_limit);
+
   GetConfInt("slowlog-max-len", &slowlog_max_len_);
   if (slowlog_max_len_ == 0) {
     slowlog_max_len_ = 128;
@@ -213,6 +217,12 @@ int PikaConf::Load() {
   if (expire_dump_days_ < 0) {
     expire_dump_days_ = 0;
   }
+  std::string pin_sequence;
+  GetConfStr("dump-pin-sequence", &pin_sequence);
+  bgsave_pin_sequence_ = pin_sequence == "yes";
+  std::string incremental;
+  GetConfStr("dump-incremental", &incremental);
+  bgsave_incremental_ = incremental == "yes";
   GetConfStr("dump-prefix", &bgsave_prefix_);
 
   GetConfInt("expire-logs-nums", &expire_logs_nums_);
@@ -257,6 +267,15 @@ int PikaConf::Load() {
   if (thread_pool_size_ > 100) {
     thread_pool_size_ = 100;
   }
+  GetConfStr("io-multiplexer", &io_multiplexer_);
+  if (io_multiplexer_ != "io_uring") {
+    io_multiplexer_ = "epoll";
+  }
+
+  std::string reuse_port;
+  GetConfStr("reuse-port", &reuse_port);
+  reuse_port_ = reuse_port == "yes";
+
   GetConfInt("sync-thread-num", &sync_thread_num_);
   if (sync_thread_num_ <= 0) {
     sync_thread_num_ = 3;
@@ -274,8 +293,17 @@ int PikaConf::Load() {
     if (databases_ < 1 || databases_ > 8) {
       LOG(FATAL) << "config databases error, limit [1 ~ 8], the actual is: " << databases_;
     }
+    db_shard_num_ = 1;
+    GetConfInt("db-shard-num", &db_shard_num_);
+    if (db_shard_num_ < 1 || db_shard_num_ > 64) {
+      LOG(FATAL) << "config db-shard-num error, limit [1 ~ 64], the actual is: " << db_shard_num_;
+    }
+    std::set<uint32_t> shard_ids;
+    for (int idx = 0; idx < db_shard_num_; ++idx) {
+      shard_ids.insert(idx);
+    }
     for (int idx = 0; idx < databases_; ++idx) {
-      db_structs_.push_back({"db" + std::to_string(idx), 1, {0}});
+      db_structs_.push_back({"db" + std::to_string(idx), static_cast<uint32_t>(db_shard_num_), shard_ids});
     }
   }
   default_db_ = db_structs_[0].db_name;
@@ -375,6 +403,11 @@ int PikaConf::Load() {
     thread_migrate_keys_num_ = 64;  // 1/8 of the write_buffer_size_
   }
 
+  GetConfInt64("slotmigrate-pipeline-window", &slotmigrate_pipeline_window_);
+  if (slotmigrate_pipeline_window_ <= 0) {
+    slotmigrate_pipeline_window_ = 1024;
+  }
+
   // max_write_buffer_size
   GetConfInt64Human("max-write-buffer-size", &max_write_buffer_size_);
   if (max_write_buffer_size_ <= 0) {
@@ -416,6 +449,13 @@ int PikaConf::Load() {
     max_client_response_size_ = 1073741824;  // 1Gb
   }
 
+  // the keys tracked for CLIENT TRACKING, 0 for no limit
+  tracking_table_max_keys_ = 1000000;
+  GetConfInt64("tracking-table-max-keys", &tracking_table_max_keys_);
+  if (tracking_table_max_keys_ < 0) {
+    tracking_table_max_keys_ = 1000000;
+  }
+
   // target_file_size_base
   GetConfIntHuman("target-file-size-base", &target_file_size_base_);
   if (target_file_size_base_ <= 0) {
@@ -434,6 +474,24 @@ int PikaConf::Load() {
     small_compaction_threshold_ = 5000;
   }
 
+  active_expire_cpu_percent_ = 25;
+  GetConfInt("active-expire-cpu-percent", &active_expire_cpu_percent_);
+  if (active_expire_cpu_percent_ < 0 || active_expire_cpu_percent_ > 100) {
+    active_expire_cpu_percent_ = 25;
+  }
+
+  hash_max_inline_fields_ = 0;
+  GetConfInt("hash-max-inline-fields", &hash_max_inline_fields_);
+  if (hash_max_inline_fields_ < 0 || hash_max_inline_fields_ > 512) {
+    hash_max_inline_fields_ = 0;
+  }
+
+  hash_max_inline_value_ = 64;
+  GetConfInt("hash-max-inline-value", &hash_max_inline_value_);
+  if (hash_max_inline_value_ <= 0 || hash_max_inline_value_ > 4096) {
+    hash_max_inline_value_ = 64;
+  }
+
   max_background_flushes_ = 1;
   GetConfInt("max-background-flushes", &max_background_flushes_);
   if (max_background_flushes_ <= 0) {
@@ -596,16 +654,21 @@ int PikaConf::ConfigRewrite() {
   SetConfStr("dump-prefix", bgsave_prefix_);
   SetConfInt("maxclients", maxclients_);
   SetConfInt("dump-expire", expire_dump_days_);
+  SetConfStr("dump-pin-sequence", bgsave_pin_sequence_ ? "yes" : "no");
+  SetConfStr("dump-incremental", bgsave_incremental_ ? "yes" : "no");
   SetConfInt("expire-logs-days", expire_logs_days_);
   SetConfInt("expire-logs-nums", expire_logs_nums_);
   SetConfInt("root-connection-num", root_connection_num_);
   SetConfStr("slowlog-write-errorlog", slowlog_write_errorlog_.load() ? "yes" : "no");
   SetConfInt("slowlog-log-slower-than", slowlog_log_slower_than_.load());
+  SetConfInt("lua-time-limit", lua_time_limit_.load());
   SetConfInt("slowlog-max-len", slowlog_max_len_);
   SetConfStr("write-binlog", write_binlog_ ? "yes" : "no");
   SetConfInt("max-cache-statistic-keys", max_cache_statistic_keys_);
   SetConfInt("small-compaction-threshold", small_compaction_threshold_);
+  SetConfInt("active-expire-cpu-percent", active_expire_cpu_percent_);
   SetConfInt("max-client-response-size", max_client_response_size_);
+  SetConfInt64("tracking-table-max-keys", tracking_table_max_keys_);
   SetConfInt("db-sync-speed", db_sync_speed_);
   SetConfStr("compact-cron", compact_cron_);
   SetConfStr("compact-interval", compact_interval_);
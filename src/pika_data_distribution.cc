@@ -13,7 +13,8 @@ const std::string kTagEnd = "}";
 void HashModulo::Init() {}
 
 uint32_t HashModulo::Distribute(const std::string& str, uint32_t slot_num) {
-  return std::hash<std::string>()(str) % slot_num;
+  // the keys with the same hash tag go to the same slot
+  return std::hash<std::string>()(GetHashkey(str)) % slot_num;
 }
 
 void Crc32::Init() { Crc32TableInit(IEEE_POLY); }
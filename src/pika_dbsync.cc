@@ -0,0 +1,393 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_dbsync.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#include "pstd/include/env.h"
+
+#include "include/pika_conf.h"
+#include "include/pika_rm.h"
+#include "include/pika_server.h"
+
+using pstd::Status;
+
+extern PikaServer* g_pika_server;
+extern std::unique_ptr<PikaReplicaManager> g_pika_rm;
+
+std::string DBSyncSnapshotUuid(const std::string& s_start_time, const LogOffset& offset) {
+  return s_start_time + "_" + std::to_string(offset.b_offset.filenum) + "_" + std::to_string(offset.b_offset.offset);
+}
+
+Status DBSyncListFiles(const std::string& snapshot_path, std::vector<DBSyncFileInfo>* files) {
+  std::error_code ec;
+  std::filesystem::path root(snapshot_path);
+  for (auto iter = std::filesystem::recursive_directory_iterator(root, ec);
+       !ec && iter != std::filesystem::recursive_directory_iterator(); iter.increment(ec)) {
+    if (!iter->is_regular_file(ec)) {
+      continue;
+    }
+    std::string name = iter->path().lexically_relative(root).string();
+    if (name == kBgsaveInfoFile || name == storage::BACKUP_MANIFEST) {
+      continue;
+    }
+    DBSyncFileInfo info;
+    info.name = name;
+    info.size = iter->file_size(ec);
+    if (ec) {
+      break;
+    }
+    files->push_back(info);
+  }
+  if (ec) {
+    return Status::IOError(snapshot_path, ec.message());
+  }
+  return Status::OK();
+}
+
+Status DBSyncReadChunk(const std::string& snapshot_path, const std::string& filename, uint64_t offset,
+                       uint64_t count, std::string* data, bool* eof) {
+  // The file name comes from the slave, never leave the snapshot directory
+  if (filename.empty() || filename[0] == '/' || filename.find("..") != std::string::npos) {
+    return Status::InvalidArgument("invalid file name " + filename);
+  }
+  std::string path = snapshot_path + "/" + filename;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return Status::IOError(path, strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return Status::IOError(path, strerror(errno));
+  }
+  auto file_size = static_cast<uint64_t>(st.st_size);
+  if (offset > file_size) {
+    close(fd);
+    return Status::InvalidArgument("offset beyond the end of " + filename);
+  }
+
+  count = std::min(count, std::min(kDBSyncChunkSize, file_size - offset));
+  data->resize(count);
+  size_t done = 0;
+  while (done < count) {
+    ssize_t n = pread(fd, data->data() + done, count - done, static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(fd);
+      return Status::IOError(path, n == 0 ? "unexpected end of file" : strerror(errno));
+    }
+    done += n;
+  }
+  close(fd);
+  *eof = offset + count == file_size;
+  return Status::OK();
+}
+
+uint32_t DBSyncChecksum(const std::string& data) {
+  uLong crc = crc32(0L, Z_NULL, 0);
+  return static_cast<uint32_t>(crc32(crc, reinterpret_cast<const Bytef*>(data.data()), data.size()));
+}
+
+DBSyncReceiver::DBSyncReceiver(std::string db_name, uint32_t slot_id, std::string dbsync_path)
+    : db_name_(std::move(db_name)), slot_id_(slot_id), dbsync_path_(std::move(dbsync_path)) {}
+
+void DBSyncReceiver::Reset() {
+  std::lock_guard l(mu_);
+  state_ = kRequestMeta;
+  snapshot_uuid_.clear();
+  snapshot_offset_ = LogOffset();
+  pending_files_.clear();
+  active_files_.clear();
+  total_files_ = 0;
+  done_files_ = 0;
+  total_bytes_ = 0;
+  received_bytes_ = 0;
+  tokens_ = 0;
+  last_refill_time_ = pstd::NowMicros();
+  start_time_ = last_refill_time_;
+}
+
+bool DBSyncReceiver::Tick() {
+  std::lock_guard l(mu_);
+  uint64_t now = pstd::NowMicros();
+  switch (state_) {
+    case kRequestMeta: {
+      Status s = g_pika_rm->SendDBSyncMetaRequest(db_name_, slot_id_);
+      if (!s.ok()) {
+        LOG(WARNING) << "Slot: " << db_name_ << ":" << slot_id_ << " Send DBSync Meta Request failed, "
+                     << s.ToString();
+        return false;
+      }
+      meta_request_time_ = now;
+      state_ = kWaitMeta;
+      return false;
+    }
+    case kWaitMeta:
+      // Master is still doing bgsave or the reply was lost
+      if (meta_request_time_ + kDBSyncRequestTimeout < now) {
+        state_ = kRequestMeta;
+      }
+      return false;
+    case kPulling:
+      IssueFileRequests(now);
+      if (pending_files_.empty() && active_files_.empty()) {
+        if (!WriteInfoFile()) {
+          return false;
+        }
+        uint64_t cost_sec = std::max<uint64_t>((now - start_time_) / 1000000, 1);
+        LOG(INFO) << "Slot: " << db_name_ << ":" << slot_id_ << " DBSync pulled " << total_files_ << " files, "
+                  << received_bytes_ << " bytes in " << cost_sec << "s, " << received_bytes_ / cost_sec << " bytes/s";
+        state_ = kFinished;
+      }
+      return state_ == kFinished;
+    case kFinished:
+      return true;
+  }
+  return false;
+}
+
+void DBSyncReceiver::HandleMetaResponse(const InnerMessage::InnerResponse::DBSyncMeta& meta) {
+  std::lock_guard l(mu_);
+  if (state_ != kWaitMeta) {
+    return;
+  }
+  if (!meta.ready()) {
+    // Poll again when the request times out, bgsave usually takes a while
+    return;
+  }
+
+  std::vector<DBSyncFileInfo> files;
+  for (int i = 0; i < meta.files_size(); ++i) {
+    DBSyncFileInfo info;
+    info.name = meta.files(i).name();
+    info.size = meta.files(i).size();
+    files.push_back(info);
+  }
+  snapshot_uuid_ = meta.snapshot_uuid();
+  const InnerMessage::BinlogOffset& boffset = meta.binlog_offset();
+  snapshot_offset_ =
+      LogOffset(BinlogOffset(boffset.filenum(), boffset.offset()), LogicOffset(boffset.term(), boffset.index()));
+  PrepareLocalFiles(files);
+
+  LOG(INFO) << "Slot: " << db_name_ << ":" << slot_id_ << " DBSync snapshot " << snapshot_uuid_ << ", "
+            << total_files_ << " files, " << total_bytes_ << " bytes, " << received_bytes_ << " bytes already pulled";
+  state_ = kPulling;
+  IssueFileRequests(pstd::NowMicros());
+}
+
+void DBSyncReceiver::HandleFileResponse(const InnerMessage::InnerResponse::DBSyncFile& file) {
+  bool checksum_ok = DBSyncChecksum(file.data()) == file.checksum();
+  std::string path;
+  {
+    std::lock_guard l(mu_);
+    if (state_ != kPulling || file.snapshot_uuid() != snapshot_uuid_) {
+      return;
+    }
+    auto iter = active_files_.find(file.filename());
+    if (iter == active_files_.end() || !iter->second.inflight || iter->second.offset != file.offset()) {
+      // Stale or duplicated reply
+      return;
+    }
+    if (!checksum_ok || file.offset() + file.data().size() > iter->second.size) {
+      LOG(WARNING) << "Slot: " << db_name_ << ":" << slot_id_ << " DBSync chunk of " << file.filename()
+                   << " at " << file.offset() << " corrupted, pull it again";
+      iter->second.inflight = false;
+      IssueFileRequests(pstd::NowMicros());
+      return;
+    }
+    path = dbsync_path_ + file.filename();
+  }
+
+  // Only one chunk of a file is in flight, write it without holding mu_
+  // so that the files are written in parallel
+  bool written = false;
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (fd >= 0) {
+    const std::string& data = file.data();
+    size_t done = 0;
+    while (done < data.size()) {
+      ssize_t n = pwrite(fd, data.data() + done, data.size() - done, static_cast<off_t>(file.offset() + done));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      done += n;
+    }
+    written = done == data.size();
+    close(fd);
+  }
+  if (!written) {
+    LOG(WARNING) << "Slot: " << db_name_ << ":" << slot_id_ << " DBSync write " << path
+                 << " failed, error: " << strerror(errno);
+  }
+
+  std::lock_guard l(mu_);
+  auto iter = active_files_.find(file.filename());
+  if (state_ != kPulling || file.snapshot_uuid() != snapshot_uuid_ || iter == active_files_.end() ||
+      iter->second.offset != file.offset()) {
+    return;
+  }
+  iter->second.inflight = false;
+  if (written) {
+    iter->second.offset += file.data().size();
+    received_bytes_ += file.data().size();
+    if (iter->second.offset == iter->second.size) {
+      active_files_.erase(iter);
+      done_files_++;
+    }
+  }
+  IssueFileRequests(pstd::NowMicros());
+}
+
+std::string DBSyncReceiver::ProgressString() {
+  std::lock_guard l(mu_);
+  if (state_ == kRequestMeta || state_ == kWaitMeta) {
+    return "wait snapshot";
+  }
+  return std::to_string(done_files_) + "/" + std::to_string(total_files_) + " files, " +
+         std::to_string(received_bytes_) + "/" + std::to_string(total_bytes_) + " bytes";
+}
+
+void DBSyncReceiver::PrepareLocalFiles(const std::vector<DBSyncFileInfo>& files) {
+  // Files on disk belong to another snapshot, start over
+  std::string uuid_path = dbsync_path_ + kDBSyncSnapshotFile;
+  std::string local_uuid;
+  std::ifstream is(uuid_path);
+  if (is) {
+    std::getline(is, local_uuid);
+    is.close();
+  }
+  if (local_uuid != snapshot_uuid_) {
+    pstd::DeleteDirIfExist(dbsync_path_);
+    pstd::CreatePath(dbsync_path_);
+    std::ofstream os(uuid_path, std::ios::trunc);
+    os << snapshot_uuid_ << "\n";
+    os.close();
+  }
+
+  pending_files_.clear();
+  active_files_.clear();
+  total_files_ = files.size();
+  done_files_ = 0;
+  total_bytes_ = 0;
+  received_bytes_ = 0;
+  for (const auto& file : files) {
+    total_bytes_ += file.size;
+    std::string path = dbsync_path_ + file.name;
+    pstd::CreatePath(path.substr(0, path.rfind('/')));
+
+    // Only whole chunks are written after verification, a partial tail
+    // can only be left by an interrupted write, pull it again
+    struct stat st;
+    uint64_t local_size = stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    uint64_t offset = local_size >= file.size ? file.size : local_size / kDBSyncChunkSize * kDBSyncChunkSize;
+    if (local_size != offset && truncate(path.c_str(), static_cast<off_t>(offset)) != 0) {
+      offset = 0;
+      pstd::DeleteFile(path);
+    }
+    received_bytes_ += offset;
+    if (file.size != 0 && offset == file.size) {
+      done_files_++;
+      continue;
+    }
+    pending_files_.push_back(file);
+  }
+}
+
+void DBSyncReceiver::RefillTokens(uint64_t now) {
+  // db-sync-speed is MB/s
+  int64_t speed = static_cast<int64_t>(g_pika_conf->db_sync_speed()) * 1024 * 1024;
+  if (speed <= 0) {
+    speed = 1024LL * 1024 * 1024;
+  }
+  if (now > last_refill_time_) {
+    tokens_ += static_cast<int64_t>((now - last_refill_time_) * speed / 1000000);
+    last_refill_time_ = now;
+  }
+  // Do not accumulate a burst while idle
+  tokens_ = std::min(tokens_, static_cast<int64_t>(kDBSyncChunkSize * kDBSyncMaxParallelFiles));
+}
+
+void DBSyncReceiver::IssueFileRequests(uint64_t now) {
+  RefillTokens(now);
+  while (active_files_.size() < kDBSyncMaxParallelFiles && !pending_files_.empty()) {
+    DBSyncFileInfo file = pending_files_.front();
+    pending_files_.pop_front();
+    std::string path = dbsync_path_ + file.name;
+    if (file.size == 0) {
+      // Nothing to pull, just create it
+      std::ofstream os(path, std::ios::trunc);
+      os.close();
+      done_files_++;
+      continue;
+    }
+    FileState state;
+    state.size = file.size;
+    struct stat st;
+    state.offset = stat(path.c_str(), &st) == 0 ? std::min<uint64_t>(st.st_size, file.size) : 0;
+    active_files_[file.name] = state;
+  }
+
+  for (auto& item : active_files_) {
+    FileState& state = item.second;
+    if (state.inflight && state.request_time + kDBSyncRequestTimeout >= now) {
+      continue;
+    }
+    if (tokens_ <= 0) {
+      break;
+    }
+    uint64_t count = std::min(kDBSyncChunkSize, state.size - state.offset);
+    Status s = g_pika_rm->SendDBSyncFileRequest(db_name_, slot_id_, snapshot_uuid_, item.first, state.offset, count);
+    if (!s.ok()) {
+      LOG(WARNING) << "Slot: " << db_name_ << ":" << slot_id_ << " Send DBSync File Request failed, "
+                   << s.ToString();
+      break;
+    }
+    state.inflight = true;
+    state.request_time = now;
+    tokens_ -= static_cast<int64_t>(count);
+  }
+}
+
+bool DBSyncReceiver::WriteInfoFile() {
+  std::shared_ptr<SyncSlaveSlot> slave_slot = g_pika_rm->GetSyncSlaveSlotByName(SlotInfo(db_name_, slot_id_));
+  if (!slave_slot) {
+    LOG(WARNING) << "Slave Slot: " << db_name_ << ":" << slot_id_ << " not exist";
+    return false;
+  }
+  pstd::DeleteFile(dbsync_path_ + kDBSyncSnapshotFile);
+
+  // Same format as the info file written by bgsave, Slot::TryUpdateMasterOffset
+  // checks the master ip port against the current master
+  std::ofstream out(dbsync_path_ + kBgsaveInfoFile, std::ios::trunc);
+  if (!out.is_open()) {
+    LOG(WARNING) << "Slot: " << db_name_ << ":" << slot_id_ << " Failed to write dbsync info file";
+    return false;
+  }
+  out << (pstd::NowMicros() - start_time_) / 1000000 << "s\n"
+      << slave_slot->MasterIp() << "\n"
+      << slave_slot->MasterPort() << "\n"
+      << snapshot_offset_.b_offset.filenum << "\n"
+      << snapshot_offset_.b_offset.offset << "\n";
+  if (g_pika_conf->consensus_level() != 0) {
+    out << snapshot_offset_.l_offset.term << "\n" << snapshot_offset_.l_offset.index << "\n";
+  }
+  out.close();
+  return true;
+}
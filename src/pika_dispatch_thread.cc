@@ -18,6 +18,7 @@ PikaDispatchThread::PikaDispatchThread(std::set<std::string>& ips, int port, int
     : conn_factory_(max_conn_rbuf_size), handles_(this) {
   thread_rep_ = net::NewDispatchThread(ips, port, work_num, &conn_factory_, cron_interval, queue_limit, &handles_);
   thread_rep_->set_thread_name("Dispatcher");
+  thread_rep_->set_reuse_port(g_pika_conf->reuse_port());
 }
 
 PikaDispatchThread::~PikaDispatchThread() {
@@ -64,3 +65,7 @@ bool PikaDispatchThread::Handles::AccessHandle(std::string& ip) const {
 void PikaDispatchThread::Handles::CronHandle() const {
   pika_disptcher_->thread_rep_->set_keepalive_timeout(g_pika_conf->timeout());
 }
+
+void PikaDispatchThread::Handles::FdClosedHandle(int fd, const std::string& ip_port) const {
+  g_pika_server->blocked_clients()->UnblockConn(fd, ip_port);
+}
@@ -185,8 +185,7 @@ void GeoDistCmd::Do(std::shared_ptr<Slot> slot) {
   distance = length_converter(distance, unit_);
   char buf[32];
   sprintf(buf, "%.4f", distance);
-  res_.AppendStringLen(strlen(buf));
-  res_.AppendContent(buf);
+  res_.AppendDouble(buf);
 }
 
 void GeoHashCmd::DoInitial() {
@@ -279,46 +278,56 @@ static void GetAllNeighbors(const std::shared_ptr<Slot>& slot, std::string& key,
   neighbors[7] = georadius.neighbors.south_east;
   neighbors[8] = georadius.neighbors.south_west;
 
-  // For each neighbor, get all the matching
-  // members and add them to the potential result list.
-  std::vector<NeighborPoint> result;
-  int last_processed = 0;
-  for (size_t i = 0; i < sizeof(neighbors) / sizeof(*neighbors); i++) {
-    GeoHashFix52Bits min;
-    GeoHashFix52Bits max;
-    if (HASHISZERO(neighbors[i])) {
+  // The score ranges of the 9 areas, merged and scanned in one pass by the
+  // storage. When a huge Radius (in the 5000 km range or more) is used,
+  // adjacent neighbors can be the same, the merge removes them too.
+  std::vector<std::pair<double, double>> ranges;
+  for (auto & neighbor : neighbors) {
+    if (HASHISZERO(neighbor)) {
       continue;
     }
-    min = geohashAlign52Bits(neighbors[i]);
-    neighbors[i].bits++;
-    max = geohashAlign52Bits(neighbors[i]);
-    // When a huge Radius (in the 5000 km range or more) is used,
-    // adjacent neighbors can be the same, so need to remove duplicated elements
-    if ((last_processed != 0) && neighbors[i].bits == neighbors[last_processed].bits &&
-        neighbors[i].step == neighbors[last_processed].step) {
-      continue;
+    GeoHashFix52Bits min = geohashAlign52Bits(neighbor);
+    neighbor.bits++;
+    GeoHashFix52Bits max = geohashAlign52Bits(neighbor);
+    ranges.emplace_back(static_cast<double>(min), static_cast<double>(max));
+  }
+
+  // Only the points within the search area are kept. With COUNT, an unsorted
+  // search stops at the count-th point, a sorted one keeps the nearest (or
+  // farthest) points in a heap of count points.
+  std::vector<NeighborPoint> result;
+  size_t limit = range.count ? static_cast<size_t>(std::max(range.count_limit, 0)) : 0;
+  auto heap_cmp = range.sort == Desc ? sort_distance_desc : sort_distance_asc;
+  auto visitor = [&](double score, const storage::Slice& member) {
+    double xy[2];
+    double real_distance;
+    GeoHashBits hash = {.bits = static_cast<uint64_t>(score), .step = GEO_STEP_MAX};
+    geohashDecodeToLongLatWGS84(hash, xy);
+    if (geohashGetDistanceIfInRadiusWGS84(longitude, latitude, xy[0], xy[1], distance, &real_distance) == 0) {
+      return true;
     }
-    std::vector<storage::ScoreMember> score_members;
-    s = slot->db()->ZRangebyscore(key, static_cast<double>(min), static_cast<double>(max), true, true, &score_members);
+    if (range.count && range.sort == Unsort) {
+      if (result.size() < limit) {
+        result.push_back({member.ToString(), score, real_distance});
+      }
+      return result.size() < limit;
+    }
+    result.push_back({member.ToString(), score, real_distance});
+    if (range.count) {
+      std::push_heap(result.begin(), result.end(), heap_cmp);
+      if (result.size() > limit) {
+        std::pop_heap(result.begin(), result.end(), heap_cmp);
+        result.pop_back();
+      }
+    }
+    return true;
+  };
+  if (!ranges.empty()) {
+    s = slot->db()->ZScanScoreRanges(key, std::move(ranges), visitor);
     if (!s.ok() && !s.IsNotFound()) {
       res.SetRes(CmdRes::kErrOther, s.ToString());
       return;
     }
-    // Insert into result only if the point is within the search area.
-    for (auto & score_member : score_members) {
-      double xy[2];
-      double real_distance;
-      GeoHashBits hash = {.bits = static_cast<uint64_t>(score_member.score), .step = GEO_STEP_MAX};
-      geohashDecodeToLongLatWGS84(hash, xy);
-      if (geohashGetDistanceIfInRadiusWGS84(longitude, latitude, xy[0], xy[1], distance, &real_distance) != 0) {
-        NeighborPoint item;
-        item.member = score_member.member;
-        item.score = score_member.score;
-        item.distance = real_distance;
-        result.push_back(item);
-      }
-    }
-    last_processed = i;
   }
 
   // If using the count opiton
@@ -372,8 +381,7 @@ static void GetAllNeighbors(const std::shared_ptr<Slot>& slot, std::string& key,
         distance = length_converter(distance, range.unit);
         char buf[32];
         sprintf(buf, "%.4f", distance);
-        res.AppendStringLen(strlen(buf));
-        res.AppendContent(buf);
+        res.AppendDouble(buf);
       }
       // If using withhash option
       if (range.withhash) {
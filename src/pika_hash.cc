@@ -7,11 +7,25 @@
 
 #include "pstd/include/pstd_string.h"
 
+#include "include/pika_binlog_transverter.h"
 #include "include/pika_conf.h"
 #include "include/pika_slot_command.h"
 
 extern std::unique_ptr<PikaConf> g_pika_conf;
 
+// Parses the FIELDS numfields field ... arguments of the field expire
+// commands from argv[index]
+static bool ParseHashFieldsArgs(const PikaCmdArgsType& argv, size_t index, std::vector<std::string>* fields) {
+  int64_t num_fields = 0;
+  if (index + 2 > argv.size() || strcasecmp(argv[index].data(), "fields") != 0 ||
+      pstd::string2int(argv[index + 1].data(), argv[index + 1].size(), &num_fields) == 0 || num_fields <= 0 ||
+      static_cast<size_t>(num_fields) != argv.size() - index - 2) {
+    return false;
+  }
+  fields->assign(argv.begin() + static_cast<int64_t>(index) + 2, argv.end());
+  return true;
+}
+
 void HDelCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameHDel);
@@ -71,7 +85,7 @@ void HGetCmd::Do(std::shared_ptr<Slot> slot) {
     res_.AppendStringLen(value.size());
     res_.AppendContent(value);
   } else if (s.IsNotFound()) {
-    res_.AppendContent("$-1");
+    res_.AppendStringLen(-1);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
@@ -118,7 +132,7 @@ void HGetallCmd::Do(std::shared_ptr<Slot> slot) {
   } while (cursor != 0);
 
   if (s.ok() || s.IsNotFound()) {
-    res_.AppendArrayLen(total_fv * 2);
+    res_.AppendMapLen(total_fv);
     res_.AppendStringRaw(raw);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
@@ -260,7 +274,7 @@ void HMgetCmd::Do(std::shared_ptr<Slot> slot) {
         res_.AppendStringLen(vs.value.size());
         res_.AppendContent(vs.value);
       } else {
-        res_.AppendContent("$-1");
+        res_.AppendStringLen(-1);
       }
     }
   } else {
@@ -580,3 +594,149 @@ void PKHRScanRangeCmd::Do(std::shared_ptr<Slot> slot) {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
 }
+
+void HExpireCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameHExpire);
+    return;
+  }
+  key_ = argv_[1];
+  if (pstd::string2int(argv_[2].data(), argv_[2].size(), &sec_) == 0) {
+    res_.SetRes(CmdRes::kInvalidInt);
+    return;
+  }
+  if (sec_ < 0 || sec_ > INT32_MAX) {
+    res_.SetRes(CmdRes::kErrOther, "invalid expire time in 'hexpire' command");
+    return;
+  }
+  if (!ParseHashFieldsArgs(argv_, 3, &fields_)) {
+    res_.SetRes(CmdRes::kSyntaxErr);
+    return;
+  }
+}
+
+void HExpireCmd::Do(std::shared_ptr<Slot> slot) {
+  std::vector<int32_t> rets;
+  rocksdb::Status s = slot->db()->HExpire(key_, static_cast<int32_t>(sec_), fields_, &rets);
+  if (s.ok() || s.IsNotFound()) {
+    res_.AppendArrayLen(rets.size());
+    for (const auto& ret : rets) {
+      res_.AppendInteger(ret);
+    }
+  } else {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
+std::string HExpireCmd::ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
+                                 uint64_t offset) {
+  std::string content;
+  content.reserve(RAW_ARGS_LEN);
+  RedisAppendLen(content, argv_.size(), "*");
+
+  // to hexpireat cmd
+  std::string hexpireat_cmd("hexpireat");
+  RedisAppendLen(content, hexpireat_cmd.size(), "$");
+  RedisAppendContent(content, hexpireat_cmd);
+  // key
+  RedisAppendLen(content, key_.size(), "$");
+  RedisAppendContent(content, key_);
+  // sec
+  char buf[100];
+  int64_t expireat = time(nullptr) + sec_;
+  pstd::ll2string(buf, 100, expireat);
+  std::string at(buf);
+  RedisAppendLen(content, at.size(), "$");
+  RedisAppendContent(content, at);
+  // FIELDS numfields field ...
+  for (size_t idx = 3; idx < argv_.size(); ++idx) {
+    RedisAppendLen(content, argv_[idx].size(), "$");
+    RedisAppendContent(content, argv_[idx]);
+  }
+
+  return PikaBinlogTransverter::BinlogEncode(BinlogType::TypeFirst, exec_time, term_id, logic_id, filenum, offset,
+                                             content, {});
+}
+
+void HExpireatCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameHExpireat);
+    return;
+  }
+  key_ = argv_[1];
+  if (pstd::string2int(argv_[2].data(), argv_[2].size(), &time_stamp_) == 0) {
+    res_.SetRes(CmdRes::kInvalidInt);
+    return;
+  }
+  if (time_stamp_ < 0 || time_stamp_ > INT32_MAX) {
+    res_.SetRes(CmdRes::kErrOther, "invalid expire time in 'hexpireat' command");
+    return;
+  }
+  if (!ParseHashFieldsArgs(argv_, 3, &fields_)) {
+    res_.SetRes(CmdRes::kSyntaxErr);
+    return;
+  }
+}
+
+void HExpireatCmd::Do(std::shared_ptr<Slot> slot) {
+  std::vector<int32_t> rets;
+  rocksdb::Status s = slot->db()->HExpireat(key_, static_cast<int32_t>(time_stamp_), fields_, &rets);
+  if (s.ok() || s.IsNotFound()) {
+    res_.AppendArrayLen(rets.size());
+    for (const auto& ret : rets) {
+      res_.AppendInteger(ret);
+    }
+  } else {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
+void HTtlCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameHTtl);
+    return;
+  }
+  key_ = argv_[1];
+  if (!ParseHashFieldsArgs(argv_, 2, &fields_)) {
+    res_.SetRes(CmdRes::kSyntaxErr);
+    return;
+  }
+}
+
+void HTtlCmd::Do(std::shared_ptr<Slot> slot) {
+  std::vector<int64_t> ttls;
+  rocksdb::Status s = slot->db()->HTTL(key_, fields_, &ttls);
+  if (s.ok() || s.IsNotFound()) {
+    res_.AppendArrayLen(ttls.size());
+    for (const auto& ttl : ttls) {
+      res_.AppendInteger(ttl);
+    }
+  } else {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
+
+void HPersistCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameHPersist);
+    return;
+  }
+  key_ = argv_[1];
+  if (!ParseHashFieldsArgs(argv_, 2, &fields_)) {
+    res_.SetRes(CmdRes::kSyntaxErr);
+    return;
+  }
+}
+
+void HPersistCmd::Do(std::shared_ptr<Slot> slot) {
+  std::vector<int32_t> rets;
+  rocksdb::Status s = slot->db()->HPersist(key_, fields_, &rets);
+  if (s.ok() || s.IsNotFound()) {
+    res_.AppendArrayLen(rets.size());
+    for (const auto& ret : rets) {
+      res_.AppendInteger(ret);
+    }
+  } else {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+  }
+}
@@ -9,9 +9,28 @@
 
 #include "include/pika_binlog_transverter.h"
 #include "include/pika_conf.h"
+#include "include/pika_server.h"
 #include "include/pika_slot_command.h"
 
 extern std::unique_ptr<PikaConf> g_pika_conf;
+extern PikaServer* g_pika_server;
+
+// The shards of the db of a command, in the order of their ids, or the slot
+// it runs on when the db is not split
+static std::vector<std::shared_ptr<Slot>> DBShards(const std::string& db_name, const std::shared_ptr<Slot>& slot) {
+  std::shared_ptr<DB> db = g_pika_server->GetDB(db_name);
+  if (!db || db->SlotNum() <= 1) {
+    return {slot};
+  }
+  std::vector<std::shared_ptr<Slot>> shards;
+  for (uint32_t slot_id = 0; slot_id < db->SlotNum(); slot_id++) {
+    std::shared_ptr<Slot> shard = db->GetSlotById(slot_id);
+    if (shard) {
+      shards.push_back(shard);
+    }
+  }
+  return shards;
+}
 
 /* SET key value [NX] [XX] [EX <seconds>] [PX <milliseconds>] */
 void SetCmd::DoInitial() {
@@ -158,6 +177,7 @@ void DelCmd::DoInitial() {
   }
   auto iter = argv_.begin();
   keys_.assign(++iter, argv_.end());
+  split_res_ = 0;
 }
 
 void DelCmd::Do(std::shared_ptr<Slot> slot) {
@@ -179,6 +199,9 @@ void DelCmd::Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) {
   int64_t count = slot->db()->Del(hint_keys.keys, &type_status);
   if (count >= 0) {
     split_res_ += count;
+    for (const auto& key : hint_keys.keys) {
+      RemSlotKey(key, slot);
+    }
   } else {
     res_.SetRes(CmdRes::kErrOther, "delete error");
   }
@@ -322,7 +345,7 @@ void GetsetCmd::Do(std::shared_ptr<Slot> slot) {
   rocksdb::Status s = slot->db()->GetSet(key_, new_value_, &old_value);
   if (s.ok()) {
     if (old_value.empty()) {
-      res_.AppendContent("$-1");
+      res_.AppendStringLen(-1);
     } else {
       res_.AppendStringLen(old_value.size());
       res_.AppendContent(old_value);
@@ -373,7 +396,7 @@ void MgetCmd::Do(std::shared_ptr<Slot> slot) {
         res_.AppendStringLen(vs.value.size());
         res_.AppendContent(vs.value);
       } else {
-        res_.AppendContent("$-1");
+        res_.AppendStringLen(-1);
       }
     }
   } else {
@@ -405,7 +428,7 @@ void MgetCmd::Merge() {
       res_.AppendStringLen(vs.value.size());
       res_.AppendContent(vs.value);
     } else {
-      res_.AppendContent("$-1");
+      res_.AppendStringLen(-1);
     }
   }
 }
@@ -442,19 +465,22 @@ void KeysCmd::Do(std::shared_ptr<Slot> slot) {
   size_t raw_limit = g_pika_conf->max_client_response_size();
   std::string raw;
   std::vector<std::string> keys;
-  do {
-    keys.clear();
-    cursor = slot->db()->Scan(type_, cursor, pattern_, PIKA_SCAN_STEP_LENGTH, &keys);
-    for (const auto& key : keys) {
-      RedisAppendLen(raw, key.size(), "$");
-      RedisAppendContent(raw, key);
-    }
-    if (raw.size() >= raw_limit) {
-      res_.SetRes(CmdRes::kErrOther, "Response exceeds the max-client-response-size limit");
-      return;
-    }
-    total_key += keys.size();
-  } while (cursor != 0);
+  for (const auto& shard : DBShards(db_name_, slot)) {
+    cursor = 0;
+    do {
+      keys.clear();
+      cursor = shard->db()->Scan(type_, cursor, pattern_, PIKA_SCAN_STEP_LENGTH, &keys);
+      for (const auto& key : keys) {
+        RedisAppendLen(raw, key.size(), "$");
+        RedisAppendContent(raw, key);
+      }
+      if (raw.size() >= raw_limit) {
+        res_.SetRes(CmdRes::kErrOther, "Response exceeds the max-client-response-size limit");
+        return;
+      }
+      total_key += keys.size();
+    } while (cursor != 0);
+  }
 
   res_.AppendArrayLen(total_key);
   res_.AppendStringRaw(raw);
@@ -666,6 +692,9 @@ void MsetCmd::Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) {
   storage::Status s = slot->db()->MSet(kvs);
   if (s.ok()) {
     res_.SetRes(CmdRes::kOk);
+    for (const auto& kv : kvs) {
+      AddSlotKey("k", kv.key, slot);
+    }
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
     return;
@@ -674,6 +703,15 @@ void MsetCmd::Split(std::shared_ptr<Slot> slot, const HintKeys& hint_keys) {
 
 void MsetCmd::Merge() {}
 
+PikaCmdArgsType MsetCmd::SplitArgv(const HintKeys& hint_keys) const {
+  PikaCmdArgsType argv{argv_[0]};
+  for (int hint : hint_keys.hints) {
+    argv.push_back(kvs_[hint].key);
+    argv.push_back(kvs_[hint].value);
+  }
+  return argv;
+}
+
 void MsetnxCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameMsetnx);
@@ -780,6 +818,7 @@ void ExistsCmd::DoInitial() {
   }
   keys_ = argv_;
   keys_.erase(keys_.begin());
+  split_res_ = 0;
 }
 
 void ExistsCmd::Do(std::shared_ptr<Slot> slot) {
@@ -1167,10 +1206,20 @@ void ScanCmd::DoInitial() {
 }
 
 void ScanCmd::Do(std::shared_ptr<Slot> slot) {
+  // the cursor of a db split into shards is the cursor in a shard times the
+  // number of shards plus the shard id, the shards are scanned one by one
+  std::vector<std::shared_ptr<Slot>> shards = DBShards(db_name_, slot);
+  auto shard_num = static_cast<int64_t>(shards.size());
+  int64_t shard_id = cursor_ % shard_num;
+  if (shard_id < 0) {
+    shard_id = 0;
+  }
+  slot = shards[shard_id];
+
   int64_t total_key = 0;
   int64_t batch_count = 0;
   int64_t left = count_;
-  int64_t cursor_ret = cursor_;
+  int64_t cursor_ret = cursor_ / shard_num;
   size_t raw_limit = g_pika_conf->max_client_response_size();
   std::string raw;
   std::vector<std::string> keys;
@@ -1191,6 +1240,13 @@ void ScanCmd::Do(std::shared_ptr<Slot> slot) {
     total_key += keys.size();
   } while (cursor_ret != 0 && (left != 0));
 
+  if (cursor_ret != 0) {
+    cursor_ret = cursor_ret * shard_num + shard_id;
+  } else if (shard_id + 1 < shard_num) {
+    // the next shard from its start
+    cursor_ret = shard_id + 1;
+  }
+
   res_.AppendArrayLen(2);
 
   char buf[32];
@@ -1207,6 +1263,11 @@ void ScanxCmd::DoInitial() {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameScanx);
     return;
   }
+  // the keys are ordered within a shard only
+  if (g_pika_conf->db_shard_num() > 1) {
+    res_.SetRes(CmdRes::kErrOther, name_ + " is not supported when the db is sharded");
+    return;
+  }
   if (strcasecmp(argv_[1].data(), "string") == 0) {
     type_ = storage::kStrings;
   } else if (strcasecmp(argv_[1].data(), "hash") == 0) {
@@ -1294,6 +1355,11 @@ void PKScanRangeCmd::DoInitial() {
     res_.SetRes(CmdRes::kWrongNum, kCmdNamePKScanRange);
     return;
   }
+  // the keys are ordered within a shard only
+  if (g_pika_conf->db_shard_num() > 1) {
+    res_.SetRes(CmdRes::kErrOther, name_ + " is not supported when the db is sharded");
+    return;
+  }
   if (strcasecmp(argv_[1].data(), "string_with_value") == 0) {
     type_ = storage::kStrings;
     string_with_value = true;
@@ -1378,6 +1444,11 @@ void PKRScanRangeCmd::DoInitial() {
     res_.SetRes(CmdRes::kWrongNum, kCmdNamePKRScanRange);
     return;
   }
+  // the keys are ordered within a shard only
+  if (g_pika_conf->db_shard_num() > 1) {
+    res_.SetRes(CmdRes::kErrOther, name_ + " is not supported when the db is sharded");
+    return;
+  }
   if (strcasecmp(argv_[1].data(), "string_with_value") == 0) {
     type_ = storage::kStrings;
     string_with_value = true;
@@ -4,10 +4,13 @@
 // of patent rights can be found in the PATENTS file in the same directory.
 
 #include "include/pika_list.h"
+#include "include/pika_conf.h"
 #include "include/pika_data_distribution.h"
 #include "pstd/include/pstd_string.h"
 #include "include/pika_slot_command.h"
 
+extern std::unique_ptr<PikaConf> g_pika_conf;
+
 void LIndexCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameLIndex);
@@ -361,3 +364,192 @@ void RPushxCmd::Do(std::shared_ptr<Slot> slot) {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
 }
+
+void BlockingPopCmd::InitialKeysAndTimeout(size_t keys_end) {
+  if (g_pika_conf->consensus_level() != 0) {
+    res_.SetRes(CmdRes::kErrOther, name_ + " is not supported when consensus is on");
+    return;
+  }
+  long long timeout = 0;
+  const std::string& timeout_arg = argv_.back();
+  if (pstd::string2int(timeout_arg.data(), timeout_arg.size(), &timeout) == 0) {
+    res_.SetRes(CmdRes::kErrOther, "timeout is not an integer or out of range");
+    return;
+  }
+  if (timeout < 0) {
+    res_.SetRes(CmdRes::kErrOther, "timeout is negative");
+    return;
+  }
+  timeout_us_ = static_cast<uint64_t>(timeout) * 1000000;
+  keys_.clear();
+  for (size_t pos = 1; pos < keys_end; pos++) {
+    if (!HashtagIsConsistent(argv_[1], argv_[pos])) {
+      res_.SetRes(CmdRes::kInconsistentHashTag);
+      return;
+    }
+    keys_.push_back(argv_[pos]);
+  }
+}
+
+void BlockingPopCmd::Do(std::shared_ptr<Slot> slot) {
+  for (const auto& key : keys_) {
+    if (TryPop(slot, key)) {
+      return;
+    }
+  }
+  // every key is empty, the caller parks the client without a reply
+  blocked_ = true;
+}
+
+void BlockingPopCmd::Retry() {
+  res_.clear();
+  Clear();
+  Execute();
+}
+
+void BLPopCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameBLPop);
+    return;
+  }
+  InitialKeysAndTimeout(argv_.size() - 1);
+}
+
+bool BLPopCmd::TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) {
+  std::string value;
+  rocksdb::Status s = slot->db()->LPop(key, &value);
+  if (s.ok()) {
+    res_.AppendArrayLen(2);
+    res_.AppendString(key);
+    res_.AppendString(value);
+    popped_key_ = key;
+    return true;
+  } else if (!s.IsNotFound()) {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    return true;
+  }
+  return false;
+}
+
+void BLPopCmd::ReplyTimeout() {
+  res_.clear();
+  res_.AppendArrayLen(-1);
+}
+
+void BLPopCmd::DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) {
+  // nothing is written while the client is blocked
+  if (popped_key_.empty()) {
+    return;
+  }
+  PikaCmdArgsType lpop_args;
+  lpop_args.push_back("LPOP");
+  lpop_args.push_back(popped_key_);
+  lpop_cmd_->Initial(std::move(lpop_args), db_name_);
+
+  lpop_cmd_->SetConn(GetConn());
+  lpop_cmd_->SetResp(resp_.lock());
+  lpop_cmd_->DoBinlog(slot);
+}
+
+void BRPopCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameBRPop);
+    return;
+  }
+  InitialKeysAndTimeout(argv_.size() - 1);
+}
+
+bool BRPopCmd::TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) {
+  std::string value;
+  rocksdb::Status s = slot->db()->RPop(key, &value);
+  if (s.ok()) {
+    res_.AppendArrayLen(2);
+    res_.AppendString(key);
+    res_.AppendString(value);
+    popped_key_ = key;
+    return true;
+  } else if (!s.IsNotFound()) {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    return true;
+  }
+  return false;
+}
+
+void BRPopCmd::ReplyTimeout() {
+  res_.clear();
+  res_.AppendArrayLen(-1);
+}
+
+void BRPopCmd::DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) {
+  // nothing is written while the client is blocked
+  if (popped_key_.empty()) {
+    return;
+  }
+  PikaCmdArgsType rpop_args;
+  rpop_args.push_back("RPOP");
+  rpop_args.push_back(popped_key_);
+  rpop_cmd_->Initial(std::move(rpop_args), db_name_);
+
+  rpop_cmd_->SetConn(GetConn());
+  rpop_cmd_->SetResp(resp_.lock());
+  rpop_cmd_->DoBinlog(slot);
+}
+
+void BRPopLPushCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameBRPopLPush);
+    return;
+  }
+  receiver_ = argv_[2];
+  if (!HashtagIsConsistent(argv_[1], receiver_)) {
+    res_.SetRes(CmdRes::kInconsistentHashTag);
+    return;
+  }
+  InitialKeysAndTimeout(2);
+}
+
+bool BRPopLPushCmd::TryPop(const std::shared_ptr<Slot>& slot, const std::string& key) {
+  std::string value;
+  rocksdb::Status s = slot->db()->RPoplpush(key, receiver_, &value);
+  if (s.ok()) {
+    AddSlotKey("k", receiver_, slot);
+    res_.AppendString(value);
+    popped_key_ = key;
+    value_poped_ = value;
+    return true;
+  } else if (!s.IsNotFound()) {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    return true;
+  }
+  return false;
+}
+
+void BRPopLPushCmd::ReplyTimeout() {
+  res_.clear();
+  res_.AppendStringLen(-1);
+}
+
+void BRPopLPushCmd::DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) {
+  // nothing is written while the client is blocked
+  if (popped_key_.empty()) {
+    return;
+  }
+  PikaCmdArgsType rpop_args;
+  rpop_args.push_back("RPOP");
+  rpop_args.push_back(popped_key_);
+  rpop_cmd_->Initial(std::move(rpop_args), db_name_);
+
+  PikaCmdArgsType lpush_args;
+  lpush_args.push_back("LPUSH");
+  lpush_args.push_back(receiver_);
+  lpush_args.push_back(value_poped_);
+  lpush_cmd_->Initial(std::move(lpush_args), db_name_);
+
+  rpop_cmd_->SetConn(GetConn());
+  rpop_cmd_->SetResp(resp_.lock());
+  lpush_cmd_->SetConn(GetConn());
+  lpush_cmd_->SetResp(resp_.lock());
+
+  rpop_cmd_->DoBinlog(slot);
+  lpush_cmd_->DoBinlog(slot);
+}
@@ -1,5 +1,7 @@
 #include <glog/logging.h>
 
+#include <algorithm>
+
 #include "include/pika_command.h"
 #include "include/pika_conf.h"
 #include "include/pika_define.h"
@@ -10,6 +12,7 @@
 #include "include/pika_admin.h"
 #include "include/pika_cmd_table_manager.h"
 #include "include/pika_rm.h"
+#include "pstd/include/env.h"
 
 #define min(a, b) (((a) > (b)) ? (b) : (a))
 
@@ -21,17 +24,6 @@ extern std::unique_ptr<PikaConf> g_pika_conf;
 extern std::unique_ptr<PikaReplicaManager> g_pika_rm;
 extern std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
 
-// do migrate key to dest pika server
-static int doMigrate(net::NetCli *cli, std::string send_str) {
-  pstd::Status s;
-  s = cli->Send(&send_str);
-  if (!s.ok()) {
-    LOG(WARNING) << "Slot Migrate Send error: " << s.ToString();
-    return -1;
-  }
-  return 1;
-}
-
 // do migrate cli auth
 static int doAuth(net::NetCli *cli) {
   net::RedisCmdArgsType argv;
@@ -82,7 +74,7 @@ static int kvGet(const std::string key, std::string &value, const std::shared_pt
   return 0;
 }
 
-static int migrateKeyTTl(net::NetCli *cli, const std::string key, storage::DataType data_type,
+static int migrateKeyTTl(MigratePipeline *pipeline, const std::string key, storage::DataType data_type,
                          const std::shared_ptr<Slot>& slot) {
   net::RedisCmdArgsType argv;
   std::string send_str;
@@ -103,7 +95,7 @@ static int migrateKeyTTl(net::NetCli *cli, const std::string key, storage::DataT
     return 0;
   }
 
-  if (doMigrate(cli, send_str) < 0) {
+  if (!pipeline->Append(send_str)) {
     return -1;
   }
 
@@ -125,7 +117,7 @@ static int setGetall(const std::string key, std::vector<std::string> *members, c
   return 1;
 }
 
-static int MigrateKv(net::NetCli *cli, const std::string key, const std::shared_ptr<Slot>& slot) {
+static int MigrateKv(MigratePipeline *pipeline, const std::string key, const std::shared_ptr<Slot>& slot) {
   std::string value;
   rocksdb::Status s = slot->db()->Get(key, &value);
   if (!s.ok()) {
@@ -146,14 +138,14 @@ static int MigrateKv(net::NetCli *cli, const std::string key, const std::shared_
   net::SerializeRedisCommand(argv, &send_str);
 
   int send_num = 0;
-  if (doMigrate(cli, send_str) < 0) {
+  if (!pipeline->Append(send_str)) {
     return -1;
   } else {
     ++send_num;
   }
 
   int r;
-  if (0 > (r = migrateKeyTTl(cli, key, storage::kStrings, slot))) {
+  if (0 > (r = migrateKeyTTl(pipeline, key, storage::kStrings, slot))) {
     return -1;
   } else {
     send_num += r;
@@ -162,7 +154,47 @@ static int MigrateKv(net::NetCli *cli, const std::string key, const std::shared_
   return send_num;
 }
 
-static int MigrateHash(net::NetCli *cli, const std::string key, const std::shared_ptr<Slot>& slot) {
+// send the expires of the fields, by HEXPIREAT as the replicas are sent
+static int migrateFieldsTTl(MigratePipeline *pipeline, const std::string key,
+                            const std::vector<storage::FieldValue> &field_values, const std::shared_ptr<Slot>& slot) {
+  std::vector<std::string> fields;
+  for (const auto &field_value : field_values) {
+    fields.push_back(field_value.field);
+  }
+  std::vector<int64_t> ttls;
+  rocksdb::Status s = slot->db()->HTTL(key, fields, &ttls);
+  if (!s.ok() && !s.IsNotFound()) {
+    LOG(WARNING) << "Hash get key: " << key << " field ttls error: " << s.ToString();
+    return -1;
+  }
+
+  std::map<int64_t, std::vector<std::string>> timestamp_fields;
+  int64_t now = time(nullptr);
+  for (size_t idx = 0; idx < ttls.size(); ++idx) {
+    if (0 < ttls[idx]) {
+      timestamp_fields[now + ttls[idx]].push_back(fields[idx]);
+    }
+  }
+  int send_num = 0;
+  for (const auto &iter : timestamp_fields) {
+    net::RedisCmdArgsType argv;
+    std::string send_str;
+    argv.push_back("HEXPIREAT");
+    argv.push_back(key);
+    argv.push_back(std::to_string(iter.first));
+    argv.push_back("FIELDS");
+    argv.push_back(std::to_string(iter.second.size()));
+    argv.insert(argv.end(), iter.second.begin(), iter.second.end());
+    net::SerializeRedisCommand(argv, &send_str);
+    if (!pipeline->Append(send_str)) {
+      return -1;
+    }
+    ++send_num;
+  }
+  return send_num;
+}
+
+static int MigrateHash(MigratePipeline *pipeline, const std::string key, const std::shared_ptr<Slot>& slot) {
   int send_num = 0;
   int64_t cursor = 0;
   std::vector<storage::FieldValue> field_values;
@@ -180,17 +212,24 @@ static int MigrateHash(net::NetCli *cli, const std::string key, const std::share
         argv.push_back(field_value.value);
       }
       net::SerializeRedisCommand(argv, &send_str);
-      if (doMigrate(cli, send_str) < 0) {
+      if (!pipeline->Append(send_str)) {
         return -1;
       } else {
         ++send_num;
       }
+
+      int r;
+      if ((r = migrateFieldsTTl(pipeline, key, field_values, slot)) < 0) {
+        return -1;
+      } else {
+        send_num += r;
+      }
     }
   } while (cursor != 0 && s.ok());
 
   if (send_num > 0) {
     int r;
-    if ((r = migrateKeyTTl(cli, key, storage::kHashes, slot)) < 0) {
+    if ((r = migrateKeyTTl(pipeline, key, storage::kHashes, slot)) < 0) {
       return -1;
     } else {
       send_num += r;
@@ -200,7 +239,7 @@ static int MigrateHash(net::NetCli *cli, const std::string key, const std::share
   return send_num;
 }
 
-static int MigrateList(net::NetCli *cli, const std::string key, const std::shared_ptr<Slot>& slot) {
+static int MigrateList(MigratePipeline *pipeline, const std::string key, const std::shared_ptr<Slot>& slot) {
   // del old key, before migrate list; prevent redo when failed
   int send_num = 0;
   net::RedisCmdArgsType argv;
@@ -208,39 +247,40 @@ static int MigrateList(net::NetCli *cli, const std::string key, const std::share
   argv.push_back("DEL");
   argv.push_back(key);
   net::SerializeRedisCommand(argv, &send_str);
-  if (doMigrate(cli, send_str) < 0) {
+  if (!pipeline->Append(send_str)) {
     return -1;
   } else {
     ++send_num;
   }
 
+  // read the list a chunk at a time, a big list is never loaded as a whole
+  int64_t left = 0;
   std::vector<std::string> values;
-  rocksdb::Status s = slot->db()->LRange(key, 0, -1, &values);
-  if (s.ok()) {
-    auto iter = values.begin();
-    while (iter != values.end()) {
+  rocksdb::Status s;
+  do {
+    values.clear();
+    s = slot->db()->LRange(key, left, left + MAX_MEMBERS_NUM - 1, &values);
+    if (s.ok() && !values.empty()) {
       net::RedisCmdArgsType argv;
       std::string send_str;
       argv.push_back("RPUSH");
       argv.push_back(key);
-
-      for (int i = 0; iter != values.end() && i < MAX_MEMBERS_NUM; ++iter, ++i) {
-        argv.push_back(*iter);
-      }
+      argv.insert(argv.end(), values.begin(), values.end());
 
       net::SerializeRedisCommand(argv, &send_str);
-      if (doMigrate(cli, send_str) < 0) {
+      if (!pipeline->Append(send_str)) {
         return -1;
       } else {
         ++send_num;
       }
+      left += MAX_MEMBERS_NUM;
     }
-  }
+  } while (s.ok() && values.size() == static_cast<size_t>(MAX_MEMBERS_NUM));
 
   // has send del key command
   if (send_num > 1) {
     int r;
-    if (0 > (r = migrateKeyTTl(cli, key, storage::kLists, slot))) {
+    if (0 > (r = migrateKeyTTl(pipeline, key, storage::kLists, slot))) {
       return -1;
     } else {
       send_num += r;
@@ -250,7 +290,7 @@ static int MigrateList(net::NetCli *cli, const std::string key, const std::share
   return send_num;
 }
 
-static int MigrateSet(net::NetCli *cli, const std::string key, const std::shared_ptr<Slot>& slot) {
+static int MigrateSet(MigratePipeline *pipeline, const std::string key, const std::shared_ptr<Slot>& slot) {
   int send_num = 0;
   int64_t cursor = 0;
   std::vector<std::string> members;
@@ -268,7 +308,7 @@ static int MigrateSet(net::NetCli *cli, const std::string key, const std::shared
         argv.push_back(member);
       }
       net::SerializeRedisCommand(argv, &send_str);
-      if (doMigrate(cli, send_str) < 0) {
+      if (!pipeline->Append(send_str)) {
         return -1;
       } else {
         ++send_num;
@@ -278,7 +318,7 @@ static int MigrateSet(net::NetCli *cli, const std::string key, const std::shared
 
   if (0 < send_num) {
     int r;
-    if (0 > (r = migrateKeyTTl(cli, key, storage::kSets, slot))) {
+    if (0 > (r = migrateKeyTTl(pipeline, key, storage::kSets, slot))) {
       return -1;
     } else {
       send_num += r;
@@ -288,7 +328,7 @@ static int MigrateSet(net::NetCli *cli, const std::string key, const std::shared
   return send_num;
 }
 
-static int MigrateZset(net::NetCli *cli, const std::string key, const std::shared_ptr<Slot>& slot) {
+static int MigrateZset(MigratePipeline *pipeline, const std::string key, const std::shared_ptr<Slot>& slot) {
   int send_num = 0;
   int64_t cursor = 0;
   std::vector<storage::ScoreMember> score_members;
@@ -303,11 +343,13 @@ static int MigrateZset(net::NetCli *cli, const std::string key, const std::share
       argv.push_back(key);
 
       for (const auto &score_member : score_members) {
-        argv.push_back(std::to_string(score_member.score));
+        char buf[32];
+        int len = pstd::d2string(buf, sizeof(buf), score_member.score);
+        argv.emplace_back(buf, len);
         argv.push_back(score_member.member);
       }
       net::SerializeRedisCommand(argv, &send_str);
-      if (doMigrate(cli, send_str) < 0) {
+      if (!pipeline->Append(send_str)) {
         return -1;
       } else {
         ++send_num;
@@ -317,7 +359,7 @@ static int MigrateZset(net::NetCli *cli, const std::string key, const std::share
 
   if (send_num > 0) {
     int r;
-    if ((r = migrateKeyTTl(cli, key, storage::kZSets, slot)) < 0) {
+    if ((r = migrateKeyTTl(pipeline, key, storage::kZSets, slot)) < 0) {
       return -1;
     } else {
       send_num += r;
@@ -327,67 +369,6 @@ static int MigrateZset(net::NetCli *cli, const std::string key, const std::share
   return send_num;
 }
 
-// get list key all values
-static int listGetall(const std::string key, std::vector<std::string> *values, const std::shared_ptr<Slot>& slot) {
-  rocksdb::Status s = slot->db()->LRange(key, 0, -1, values);
-  if (!s.ok()) {
-    if (s.IsNotFound()) {
-      LOG(WARNING) << "List get key: " << key << " value not found ";
-      return 0;
-    } else {
-      LOG(WARNING) << "List get key: " << key << " value error: " << s.ToString();
-      return -1;
-    }
-  }
-  return 1;
-}
-
-// migrate one list key
-static int migrateList(net::NetCli *cli, const std::string key, bool async, const std::shared_ptr<Slot>& slot) {
-  int r, ret = 0;
-  std::vector<std::string> values;
-  if (listGetall(key, &values, slot) < 0) {
-    return -1;
-  }
-  size_t keySize = values.size();
-  if (keySize == 0) {
-    return 0;
-  }
-
-  net::RedisCmdArgsType argv;
-  std::string send_str;
-  for (size_t i = 0; i <= keySize / MaxKeySendSize; ++i) {
-    if (i > 0) {
-      LOG(WARNING) << "Migrate big key: " << key << " size: " << keySize
-                   << " migrated value: " << min((i + 1) * MaxKeySendSize, keySize);
-    }
-    argv.clear();
-    send_str = "";
-    argv.push_back("lpush");
-    argv.push_back(key);
-    for (size_t j = i * MaxKeySendSize; j < (i + 1) * MaxKeySendSize && j < keySize; ++j) {
-      argv.push_back(values[j]);
-    }
-    net::SerializeRedisCommand(argv, &send_str);
-    if (doMigrate(cli, send_str) < 0) {
-      return -1;
-    } else {
-      ret++;
-    }
-  }
-
-  if ((r = migrateKeyTTl(cli, key, storage::kLists, slot)) < 0) {
-    return -1;
-  } else {
-    ret += r;
-  }
-
-  if (!async) {
-    DeleteKey(key, 'l', slot);  // key already been migrated successfully, del error doesn't matter
-  }
-  return ret;
-}
-
 PikaParseSendThread::PikaParseSendThread(PikaMigrateThread *migrate_thread, const std::shared_ptr<Slot>& slot)
     : dest_ip_("none"),
       dest_port_(-1),
@@ -440,31 +421,32 @@ bool PikaParseSendThread::Init(const std::string &ip, int64_t port, int64_t time
 
 void PikaParseSendThread::ExitThread(void) { should_exit_ = true; }
 
-int PikaParseSendThread::MigrateOneKey(net::NetCli *cli, const std::string key, const char key_type, bool async) {
+int PikaParseSendThread::MigrateOneKey(MigratePipeline *pipeline, const std::string key, const char key_type,
+                                       bool async) {
   int send_num;
   switch (key_type) {
     case 'k':
-      if (0 > (send_num = MigrateKv(cli_, key, slot_))) {
+      if (0 > (send_num = MigrateKv(pipeline, key, slot_))) {
         return -1;
       }
       break;
     case 'h':
-      if (0 > (send_num = MigrateHash(cli_, key, slot_))) {
+      if (0 > (send_num = MigrateHash(pipeline, key, slot_))) {
         return -1;
       }
       break;
     case 'l':
-      if (0 > (send_num = MigrateList(cli_, key, slot_))) {
+      if (0 > (send_num = MigrateList(pipeline, key, slot_))) {
         return -1;
       }
       break;
     case 's':
-      if (0 > (send_num = MigrateSet(cli_, key, slot_))) {
+      if (0 > (send_num = MigrateSet(pipeline, key, slot_))) {
         return -1;
       }
       break;
     case 'z':
-      if (0 > (send_num = MigrateZset(cli_, key, slot_))) {
+      if (0 > (send_num = MigrateZset(pipeline, key, slot_))) {
         return -1;
       }
       break;
@@ -499,35 +481,6 @@ void WriteDelKeyToBinlog(const std::string &key, const std::shared_ptr<Slot>& sl
   }
 }
 
-bool PikaParseSendThread::CheckMigrateRecv(int64_t need_receive_num) {
-  net::RedisCmdArgsType argv;
-  for (int64_t i = 0; i < need_receive_num; ++i) {
-    pstd::Status s;
-    s = cli_->Recv(&argv);
-    if (!s.ok()) {
-      LOG(ERROR) << "PikaParseSendThread::CheckMigrateRecv Recv error: " << s.ToString();
-      return false;
-    }
-
-    // set   return ok
-    // zadd  return number
-    // hset  return 0 or 1
-    // hmset return ok
-    // sadd  return number
-    // rpush return length
-    std::string reply = argv[0];
-    int64_t ret;
-    if (1 == argv.size() &&
-        (kInnerReplOk == pstd::StringToLower(reply) || pstd::string2int(reply.data(), reply.size(), &ret))) {
-      continue;
-    } else {
-      LOG(ERROR) << "PikaParseSendThread::CheckMigrateRecv reply error: " << reply;
-      return false;
-    }
-  }
-  return true;
-}
-
 void *PikaParseSendThread::ThreadMain() {
   while (!should_exit_) {
     std::deque<std::pair<const char, std::string>> send_keys;
@@ -552,24 +505,23 @@ void *PikaParseSendThread::ThreadMain() {
       }
     }
 
-    int64_t send_num = 0;
-    int64_t need_receive_num = 0;
+    // the keys of the batch are pipelined, and deleted once all of them are acked
+    MigratePipeline pipeline(cli_, g_pika_conf->slotmigrate_pipeline_window());
     int32_t migrate_keys_num = 0;
     for (auto iter = send_keys.begin(); iter != send_keys.end(); ++iter) {
-      if (0 > (send_num = MigrateOneKey(cli_, iter->second, iter->first, false))) {
+      if (0 > MigrateOneKey(&pipeline, iter->second, iter->first, false)) {
         LOG(WARNING) << "PikaParseSendThread::ThreadMain MigrateOneKey: " << iter->second << " failed !!!";
         migrate_thread_->OnTaskFailed();
         migrate_thread_->DecWorkingThreadNum();
         return NULL;
       } else {
-        need_receive_num += send_num;
         ++migrate_keys_num;
       }
     }
 
     // check response
-    if (!CheckMigrateRecv(need_receive_num)) {
-      LOG(INFO) << "PikaMigrateThread::ThreadMain CheckMigrateRecv failed !!!";
+    if (!pipeline.Drain()) {
+      LOG(INFO) << "PikaMigrateThread::ThreadMain migrate failed, " << pipeline.error();
       migrate_thread_->OnTaskFailed();
       migrate_thread_->DecWorkingThreadNum();
       return NULL;
@@ -577,6 +529,7 @@ void *PikaParseSendThread::ThreadMain() {
       DelKeysAndWriteBinlog(send_keys, slot_);
     }
 
+    migrate_thread_->AddSentBytes(pipeline.bytes_sent());
     migrate_thread_->AddResponseNum(migrate_keys_num);
     migrate_thread_->DecWorkingThreadNum();
   }
@@ -597,6 +550,7 @@ PikaMigrateThread::PikaMigrateThread()
       send_num_(0),
       response_num_(0),
       moved_num_(0),
+      sent_bytes_(0),
       request_migrate_(false),
       workers_num_(8),
       working_thread_num_(0),
@@ -638,6 +592,7 @@ bool PikaMigrateThread::ReqMigrateBatch(const std::string &ip, int64_t port, int
       keys_num_ = keys_num;
       should_exit_ = false;
       slot_ = slot;
+      start_micros_ = pstd::NowMicros();
 
       ResetThread();
       int ret = StartThread();
@@ -699,6 +654,7 @@ int PikaMigrateThread::ReqMigrateOne(const std::string &key, const std::shared_p
 
   // if the migrate thread exit, start it
   if (!is_migrating_) {
+    start_micros_ = pstd::NowMicros();
     ResetThread();
     int ret = StartThread();
     if (0 != ret) {
@@ -779,6 +735,14 @@ void PikaMigrateThread::OnTaskFailed() {
 
 void PikaMigrateThread::AddResponseNum(int32_t response_num) { response_num_ += response_num; }
 
+void PikaMigrateThread::AddSentBytes(int64_t bytes) { sent_bytes_ += bytes; }
+
+void PikaMigrateThread::GetMigrateThroughput(int64_t *bytes, int64_t *elapsed_ms) {
+  std::unique_lock lm(migrator_mutex_);
+  *bytes = sent_bytes_;
+  *elapsed_ms = is_migrating_ ? static_cast<int64_t>((pstd::NowMicros() - start_micros_) / 1000) : 0;
+}
+
 void PikaMigrateThread::ResetThread(void) {
   if (0 != thread_id()) {
     JoinThread();
@@ -807,6 +771,7 @@ void PikaMigrateThread::DestroyThread(bool is_self_exit) {
   is_migrating_ = false;
   is_task_success_ = true;
   moved_num_ = 0;
+  sent_bytes_ = 0;
 }
 
 void PikaMigrateThread::NotifyRequestMigrate(void) {
@@ -988,6 +953,10 @@ void *PikaMigrateThread::ThreadMain() {
       return NULL;
     } else {
       moved_num_ += response_num_;
+      int64_t elapsed_ms = std::max<int64_t>(static_cast<int64_t>((pstd::NowMicros() - start_micros_) / 1000), 1);
+      LOG(INFO) << "PikaMigrateThread::ThreadMain slot[" << slot_id_ << "] moved " << moved_num_ << " keys, "
+                << sent_bytes_ << " bytes in " << elapsed_ms << " ms, " << moved_num_ * 1000 / elapsed_ms
+                << " keys/s, " << sent_bytes_ / elapsed_ms << " KB/s";
 
       std::unique_lock lm(mgrtkeys_map_mutex_);
       std::map<std::pair<const char, std::string>, std::string>().swap(mgrtkeys_map_);
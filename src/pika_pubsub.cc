@@ -9,17 +9,20 @@
 
 extern PikaServer* g_pika_server;
 
-static std::string ConstructPubSubResp(const std::string& cmd, const std::vector<std::pair<std::string, int>>& result) {
+// Push messages to a RESP3 connection
+static std::string ConstructPubSubResp(const std::string& cmd, const std::vector<std::pair<std::string, int>>& result,
+                                       int resp_version) {
   std::stringstream resp;
+  const char* array = resp_version == 3 ? ">" : "*";
   if (result.empty()) {
-    resp << "*3\r\n"
+    resp << array << "3\r\n"
          << "$" << cmd.length() << "\r\n"
          << cmd << "\r\n"
          << "$" << -1 << "\r\n"
          << ":" << 0 << "\r\n";
   }
   for (const auto & it : result) {
-    resp << "*3\r\n"
+    resp << array << "3\r\n"
          << "$" << cmd.length() << "\r\n"
          << cmd << "\r\n"
          << "$" << it.first.length() << "\r\n"
@@ -76,7 +79,7 @@ void SubscribeCmd::Do(std::shared_ptr<Slot> slot) {
   }
   std::vector<std::pair<std::string, int>> result;
   g_pika_server->Subscribe(conn, channels, name_ == kCmdNamePSubscribe, &result);
-  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result));
+  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result, conn->resp_version()));
 }
 
 void UnSubscribeCmd::DoInitial() {
@@ -117,7 +120,7 @@ void UnSubscribeCmd::Do(std::shared_ptr<Slot> slot) {
       cli_conn->server_thread()->MoveConnIn(conn, net::NotifyType::kNotiWait);
     });
   }
-  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result));
+  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result, conn->resp_version()));
 }
 
 void PSubscribeCmd::DoInitial() {
@@ -153,7 +156,7 @@ void PSubscribeCmd::Do(std::shared_ptr<Slot> slot) {
   }
   std::vector<std::pair<std::string, int>> result;
   g_pika_server->Subscribe(conn, channels, name_ == kCmdNamePSubscribe, &result);
-  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result));
+  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result, conn->resp_version()));
 }
 
 void PUnSubscribeCmd::DoInitial() {
@@ -194,7 +197,7 @@ void PUnSubscribeCmd::Do(std::shared_ptr<Slot> slot) {
       cli_conn->server_thread()->MoveConnIn(conn, net::NotifyType::kNotiWait);
     });
   }
-  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result));
+  return res_.SetRes(CmdRes::kNone, ConstructPubSubResp(name_, result, conn->resp_version()));
 }
 
 void PubSubCmd::DoInitial() {
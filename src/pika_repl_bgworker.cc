@@ -260,10 +260,23 @@ void PikaReplBgWorker::HandleBGWorkerWriteDB(void* arg) {
     slot->DbRWLockReader();
   }
 
+  if (c_ptr->name() == kCmdNameFlushall || c_ptr->name() == kCmdNameFlushdb) {
+    g_pika_server->TouchKeysBeforeFlush(c_ptr->name() == kCmdNameFlushall ? "" : db_name);
+  }
   c_ptr->Do(slot);
+  // the clients watching or tracking the keys on this replica are told too
+  if (c_ptr->res().ok() && c_ptr->is_write()) {
+    if (c_ptr->name() == kCmdNameFlushall) {
+      g_pika_server->client_tracking()->InvalidateAll("");
+    } else if (c_ptr->name() == kCmdNameFlushdb) {
+      g_pika_server->client_tracking()->InvalidateAll(db_name);
+    } else {
+      c_ptr->TouchWatchedKeys();
+    }
+  }
 
   if (!c_ptr->is_suspend()) {
-    slot->DbRWUnLock();
+    slot->DbRWUnLockReader();
   }
 
   if (g_pika_conf->slowlog_slower_than() >= 0) {
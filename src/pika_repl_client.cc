@@ -164,6 +164,54 @@ Status PikaReplClient::SendSlotDBSync(const std::string& ip, uint32_t port, cons
   return client_thread_->Write(ip, port + kPortShiftReplServer, to_send);
 }
 
+Status PikaReplClient::SendDBSyncMeta(const std::string& ip, uint32_t port, const std::string& db_name,
+                                      uint32_t slot_id, const std::string& local_ip, int32_t session_id) {
+  InnerMessage::InnerRequest request;
+  request.set_type(InnerMessage::kDBSyncMeta);
+  InnerMessage::InnerRequest::DBSyncMeta* db_sync_meta = request.mutable_db_sync_meta();
+  InnerMessage::Node* node = db_sync_meta->mutable_node();
+  node->set_ip(local_ip);
+  node->set_port(g_pika_server->port());
+  InnerMessage::Slot* slot = db_sync_meta->mutable_slot();
+  slot->set_db_name(db_name);
+  slot->set_slot_id(slot_id);
+  db_sync_meta->set_session_id(session_id);
+
+  std::string to_send;
+  if (!request.SerializeToString(&to_send)) {
+    LOG(WARNING) << "Serialize Slot DBSync Meta Request Failed, to Master (" << ip << ":" << port << ")";
+    return Status::Corruption("Serialize Failed");
+  }
+  return client_thread_->Write(ip, port + kPortShiftReplServer, to_send);
+}
+
+Status PikaReplClient::SendDBSyncFile(const std::string& ip, uint32_t port, const std::string& db_name,
+                                      uint32_t slot_id, const std::string& local_ip, const std::string& snapshot_uuid,
+                                      const std::string& filename, uint64_t offset, uint64_t count,
+                                      int32_t session_id) {
+  InnerMessage::InnerRequest request;
+  request.set_type(InnerMessage::kDBSyncFile);
+  InnerMessage::InnerRequest::DBSyncFile* db_sync_file = request.mutable_db_sync_file();
+  InnerMessage::Node* node = db_sync_file->mutable_node();
+  node->set_ip(local_ip);
+  node->set_port(g_pika_server->port());
+  InnerMessage::Slot* slot = db_sync_file->mutable_slot();
+  slot->set_db_name(db_name);
+  slot->set_slot_id(slot_id);
+  db_sync_file->set_snapshot_uuid(snapshot_uuid);
+  db_sync_file->set_filename(filename);
+  db_sync_file->set_offset(offset);
+  db_sync_file->set_count(count);
+  db_sync_file->set_session_id(session_id);
+
+  std::string to_send;
+  if (!request.SerializeToString(&to_send)) {
+    LOG(WARNING) << "Serialize Slot DBSync File Request Failed, to Master (" << ip << ":" << port << ")";
+    return Status::Corruption("Serialize Failed");
+  }
+  return client_thread_->Write(ip, port + kPortShiftReplServer, to_send);
+}
+
 Status PikaReplClient::SendSlotTrySync(const std::string& ip, uint32_t port, const std::string& db_name,
                                             uint32_t slot_id, const BinlogOffset& boffset,
                                             const std::string& local_ip) {
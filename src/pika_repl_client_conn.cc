@@ -9,6 +9,7 @@
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <sys/time.h>
 
+#include "include/pika_dbsync.h"
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
 #include "pstd/include/pstd_string.h"
@@ -78,6 +79,18 @@ int PikaReplClientConn::DealMessage() {
                                           static_cast<void*>(task_arg));
       break;
     }
+    case InnerMessage::kDBSyncMeta: {
+      auto task_arg =
+          new ReplClientTaskArg(response, std::dynamic_pointer_cast<PikaReplClientConn>(shared_from_this()));
+      g_pika_rm->ScheduleReplClientBGTask(&PikaReplClientConn::HandleDBSyncMetaResponse, static_cast<void*>(task_arg));
+      break;
+    }
+    case InnerMessage::kDBSyncFile: {
+      auto task_arg =
+          new ReplClientTaskArg(response, std::dynamic_pointer_cast<PikaReplClientConn>(shared_from_this()));
+      g_pika_rm->ScheduleReplClientBGTask(&PikaReplClientConn::HandleDBSyncFileResponse, static_cast<void*>(task_arg));
+      break;
+    }
     default:
       break;
   }
@@ -109,7 +122,11 @@ void PikaReplClientConn::HandleMetaSyncResponse(void* arg) {
   std::vector<DBStruct> master_db_structs;
   for (int idx = 0; idx < meta_sync.dbs_info_size(); ++idx) {
     const InnerMessage::InnerResponse_MetaSync_DBInfo& db_info = meta_sync.dbs_info(idx);
-    master_db_structs.push_back({db_info.db_name(), static_cast<uint32_t>(db_info.slot_num()), {0}});
+    std::set<uint32_t> slot_ids;
+    for (int32_t id = 0; id < db_info.slot_num(); ++id) {
+      slot_ids.insert(id);
+    }
+    master_db_structs.push_back({db_info.db_name(), static_cast<uint32_t>(db_info.slot_num()), slot_ids});
   }
 
   std::vector<DBStruct> self_db_structs = g_pika_conf->db_structs();
@@ -160,6 +177,62 @@ void PikaReplClientConn::HandleDBSyncResponse(void* arg) {
   LOG(INFO) << "Slot: " << slot_name << " Need Wait To Sync";
 }
 
+void PikaReplClientConn::HandleDBSyncMetaResponse(void* arg) {
+  std::unique_ptr<ReplClientTaskArg> task_arg(static_cast<ReplClientTaskArg*>(arg));
+  std::shared_ptr<InnerMessage::InnerResponse> response = task_arg->res;
+
+  const InnerMessage::InnerResponse::DBSyncMeta& meta = response->db_sync_meta();
+  const std::string& db_name = meta.slot().db_name();
+  uint32_t slot_id = meta.slot().slot_id();
+  std::shared_ptr<SyncSlaveSlot> slave_slot = g_pika_rm->GetSyncSlaveSlotByName(SlotInfo(db_name, slot_id));
+  std::shared_ptr<Slot> slot = g_pika_server->GetDBSlotById(db_name, slot_id);
+  if (!slave_slot || !slot) {
+    LOG(WARNING) << "Slave Slot: " << db_name << ":" << slot_id << " Not Found";
+    return;
+  }
+  if (slave_slot->State() != ReplState::kWaitDBSync) {
+    return;
+  }
+  slave_slot->SetLastRecvTime(pstd::NowMicros());
+
+  if (response->code() != InnerMessage::kOk) {
+    // Let the master prepare a new snapshot
+    std::string reply = response->has_reply() ? response->reply() : "";
+    LOG(WARNING) << "Slot: " << slave_slot->SlotName() << " DBSync Meta Failed: " << reply;
+    slave_slot->SetReplState(ReplState::kTryDBSync);
+    return;
+  }
+  slot->GetDBSyncReceiver()->HandleMetaResponse(meta);
+}
+
+void PikaReplClientConn::HandleDBSyncFileResponse(void* arg) {
+  std::unique_ptr<ReplClientTaskArg> task_arg(static_cast<ReplClientTaskArg*>(arg));
+  std::shared_ptr<InnerMessage::InnerResponse> response = task_arg->res;
+
+  const InnerMessage::InnerResponse::DBSyncFile& file = response->db_sync_file();
+  const std::string& db_name = file.slot().db_name();
+  uint32_t slot_id = file.slot().slot_id();
+  std::shared_ptr<SyncSlaveSlot> slave_slot = g_pika_rm->GetSyncSlaveSlotByName(SlotInfo(db_name, slot_id));
+  std::shared_ptr<Slot> slot = g_pika_server->GetDBSlotById(db_name, slot_id);
+  if (!slave_slot || !slot) {
+    LOG(WARNING) << "Slave Slot: " << db_name << ":" << slot_id << " Not Found";
+    return;
+  }
+  if (slave_slot->State() != ReplState::kWaitDBSync) {
+    return;
+  }
+  slave_slot->SetLastRecvTime(pstd::NowMicros());
+
+  if (response->code() != InnerMessage::kOk) {
+    // The snapshot was replaced or is unreadable, start over with a new one
+    std::string reply = response->has_reply() ? response->reply() : "";
+    LOG(WARNING) << "Slot: " << slave_slot->SlotName() << " DBSync File " << file.filename() << " Failed: " << reply;
+    slave_slot->SetReplState(ReplState::kTryDBSync);
+    return;
+  }
+  slot->GetDBSyncReceiver()->HandleFileResponse(file);
+}
+
 void PikaReplClientConn::HandleTrySyncResponse(void* arg) {
   std::unique_ptr<ReplClientTaskArg> task_arg(static_cast<ReplClientTaskArg*>(arg));
   std::shared_ptr<net::PbConn> conn = task_arg->conn;
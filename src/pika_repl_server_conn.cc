@@ -7,6 +7,7 @@
 
 #include <glog/logging.h>
 
+#include "include/pika_dbsync.h"
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
 
@@ -341,7 +342,7 @@ void PikaReplServerConn::HandleDBSyncRequest(void* arg) {
     }
   }
 
-  g_pika_server->TryDBSync(node.ip(), node.port() + kPortShiftRSync, db_name, slot_id, slave_boffset.filenum());
+  g_pika_server->TryDBSync(node.ip(), node.port(), db_name, slot_id, slave_boffset.filenum());
 
   std::string reply_str;
   if (!response.SerializeToString(&reply_str) || (conn->WriteResp(reply_str) != 0)) {
@@ -352,6 +353,139 @@ void PikaReplServerConn::HandleDBSyncRequest(void* arg) {
   conn->NotifyWrite();
 }
 
+void PikaReplServerConn::HandleDBSyncMetaRequest(void* arg) {
+  std::unique_ptr<ReplServerTaskArg> task_arg(static_cast<ReplServerTaskArg*>(arg));
+  const std::shared_ptr<InnerMessage::InnerRequest> req = task_arg->req;
+  std::shared_ptr<net::PbConn> conn = task_arg->conn;
+  if (!req->has_db_sync_meta()) {
+    LOG(WARNING) << "Pb parse error";
+    conn->NotifyClose();
+    return;
+  }
+  const InnerMessage::InnerRequest::DBSyncMeta& meta_req = req->db_sync_meta();
+  const InnerMessage::Node& node = meta_req.node();
+  const std::string& db_name = meta_req.slot().db_name();
+  uint32_t slot_id = meta_req.slot().slot_id();
+
+  InnerMessage::InnerResponse response;
+  response.set_type(InnerMessage::kDBSyncMeta);
+  response.set_code(InnerMessage::kOk);
+  InnerMessage::InnerResponse::DBSyncMeta* meta_response = response.mutable_db_sync_meta();
+  InnerMessage::Slot* slot_response = meta_response->mutable_slot();
+  slot_response->set_db_name(db_name);
+  slot_response->set_slot_id(slot_id);
+  meta_response->set_ready(false);
+
+  std::shared_ptr<Slot> slot = g_pika_server->GetDBSlotById(db_name, slot_id);
+  std::shared_ptr<SyncMasterSlot> master_slot = g_pika_rm->GetSyncMasterSlotByName(SlotInfo(db_name, slot_id));
+  if (!slot || !master_slot ||
+      !master_slot->CheckSessionId(node.ip(), node.port(), db_name, slot_id, meta_req.session_id())) {
+    LOG(WARNING) << "Slot: " << db_name << ":" << slot_id << " DBSync Meta from " << node.ip() << ":"
+                 << node.port() << " rejected, slot or slave node not found";
+    response.set_code(InnerMessage::kError);
+    response.set_reply("slot or slave node not found");
+  } else if (!slot->IsBgSaving()) {
+    BgSaveInfo bgsave_info = slot->bgsave_info();
+    std::vector<DBSyncFileInfo> files;
+    Status s = DBSyncListFiles(bgsave_info.path, &files);
+    if (!s.ok()) {
+      LOG(WARNING) << "Slot: " << slot->GetSlotName() << " list bgsave files failed, " << s.ToString();
+      response.set_code(InnerMessage::kError);
+      response.set_reply(s.ToString());
+    } else {
+      meta_response->set_ready(true);
+      meta_response->set_snapshot_uuid(DBSyncSnapshotUuid(bgsave_info.s_start_time, bgsave_info.offset));
+      InnerMessage::BinlogOffset* boffset = meta_response->mutable_binlog_offset();
+      boffset->set_filenum(bgsave_info.offset.b_offset.filenum);
+      boffset->set_offset(bgsave_info.offset.b_offset.offset);
+      boffset->set_term(bgsave_info.offset.l_offset.term);
+      boffset->set_index(bgsave_info.offset.l_offset.index);
+      for (const auto& file : files) {
+        InnerMessage::InnerResponse::DBSyncMeta::FileInfo* file_info = meta_response->add_files();
+        file_info->set_name(file.name);
+        file_info->set_size(file.size);
+      }
+      g_pika_server->DBSyncSlaveActive(node.ip(), node.port(), db_name, slot_id);
+      LOG(INFO) << "Slot: " << slot->GetSlotName() << " DBSync Meta to " << node.ip() << ":" << node.port()
+                << ", snapshot: " << meta_response->snapshot_uuid() << ", files: " << files.size();
+    }
+  }
+
+  std::string reply_str;
+  if (!response.SerializeToString(&reply_str) || (conn->WriteResp(reply_str) != 0)) {
+    LOG(WARNING) << "Handle DBSync Meta Failed";
+    conn->NotifyClose();
+    return;
+  }
+  conn->NotifyWrite();
+}
+
+void PikaReplServerConn::HandleDBSyncFileRequest(void* arg) {
+  std::unique_ptr<ReplServerTaskArg> task_arg(static_cast<ReplServerTaskArg*>(arg));
+  const std::shared_ptr<InnerMessage::InnerRequest> req = task_arg->req;
+  std::shared_ptr<net::PbConn> conn = task_arg->conn;
+  if (!req->has_db_sync_file()) {
+    LOG(WARNING) << "Pb parse error";
+    conn->NotifyClose();
+    return;
+  }
+  const InnerMessage::InnerRequest::DBSyncFile& file_req = req->db_sync_file();
+  const InnerMessage::Node& node = file_req.node();
+  const std::string& db_name = file_req.slot().db_name();
+  uint32_t slot_id = file_req.slot().slot_id();
+
+  InnerMessage::InnerResponse response;
+  response.set_type(InnerMessage::kDBSyncFile);
+  response.set_code(InnerMessage::kOk);
+  InnerMessage::InnerResponse::DBSyncFile* file_response = response.mutable_db_sync_file();
+  InnerMessage::Slot* slot_response = file_response->mutable_slot();
+  slot_response->set_db_name(db_name);
+  slot_response->set_slot_id(slot_id);
+  file_response->set_snapshot_uuid(file_req.snapshot_uuid());
+  file_response->set_filename(file_req.filename());
+  file_response->set_offset(file_req.offset());
+
+  std::string data;
+  bool eof = false;
+  Status s;
+  std::shared_ptr<Slot> slot = g_pika_server->GetDBSlotById(db_name, slot_id);
+  std::shared_ptr<SyncMasterSlot> master_slot = g_pika_rm->GetSyncMasterSlotByName(SlotInfo(db_name, slot_id));
+  if (!slot || !master_slot) {
+    s = Status::NotFound("slot " + db_name + ":" + std::to_string(slot_id));
+  } else if (!master_slot->CheckSessionId(node.ip(), node.port(), db_name, slot_id, file_req.session_id())) {
+    // only a slave in the middle of its DBSync may read the dump
+    s = Status::NotFound("slave node " + node.ip() + ":" + std::to_string(node.port()));
+  } else {
+    // A new bgsave replaced the snapshot, the slave has to start over
+    BgSaveInfo bgsave_info = slot->bgsave_info();
+    if (slot->IsBgSaving() ||
+        DBSyncSnapshotUuid(bgsave_info.s_start_time, bgsave_info.offset) != file_req.snapshot_uuid()) {
+      s = Status::Incomplete("snapshot changed");
+    } else {
+      s = DBSyncReadChunk(bgsave_info.path, file_req.filename(), file_req.offset(), file_req.count(), &data, &eof);
+    }
+  }
+  if (!s.ok()) {
+    LOG(WARNING) << "Slot: " << db_name << ":" << slot_id << " DBSync File " << file_req.filename() << " to "
+                 << node.ip() << ":" << node.port() << " failed, " << s.ToString();
+    response.set_code(InnerMessage::kError);
+    response.set_reply(s.ToString());
+  } else {
+    g_pika_server->DBSyncSlaveActive(node.ip(), node.port(), db_name, slot_id);
+  }
+  file_response->set_checksum(DBSyncChecksum(data));
+  file_response->set_eof(eof);
+  file_response->set_data(std::move(data));
+
+  std::string reply_str;
+  if (!response.SerializeToString(&reply_str) || (conn->WriteResp(reply_str) != 0)) {
+    LOG(WARNING) << "Handle DBSync File Failed";
+    conn->NotifyClose();
+    return;
+  }
+  conn->NotifyWrite();
+}
+
 void PikaReplServerConn::HandleBinlogSyncRequest(void* arg) {
   std::unique_ptr<ReplServerTaskArg> task_arg(static_cast<ReplServerTaskArg*>(arg));
   const std::shared_ptr<InnerMessage::InnerRequest> req = task_arg->req;
@@ -526,6 +660,18 @@ int PikaReplServerConn::DealMessage() {
       g_pika_rm->ScheduleReplServerBGTask(&PikaReplServerConn::HandleRemoveSlaveNodeRequest, task_arg);
       break;
     }
+    case InnerMessage::kDBSyncMeta: {
+      auto task_arg =
+          new ReplServerTaskArg(req, std::dynamic_pointer_cast<PikaReplServerConn>(shared_from_this()));
+      g_pika_rm->ScheduleReplServerBGTask(&PikaReplServerConn::HandleDBSyncMetaRequest, task_arg);
+      break;
+    }
+    case InnerMessage::kDBSyncFile: {
+      auto task_arg =
+          new ReplServerTaskArg(req, std::dynamic_pointer_cast<PikaReplServerConn>(shared_from_this()));
+      g_pika_rm->ScheduleReplServerBGTask(&PikaReplServerConn::HandleDBSyncFileRequest, task_arg);
+      break;
+    }
     default:
       break;
   }
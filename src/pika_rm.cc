@@ -1064,7 +1064,7 @@ Status PikaReplicaManager::SendSlotDBSyncRequest(const std::string& db_name, siz
     LOG(WARNING) << "Slot: " << db_name << ":" << slot_id << ", NotFound";
     return Status::Corruption("Slot not found");
   }
-  slot->PrepareRsync();
+  slot->PrepareDBSync();
 
   std::shared_ptr<SyncSlaveSlot> slave_slot =
       GetSyncSlaveSlotByName(SlotInfo(db_name, slot_id));
@@ -1089,6 +1089,29 @@ Status PikaReplicaManager::SendSlotDBSyncRequest(const std::string& db_name, siz
   return status;
 }
 
+Status PikaReplicaManager::SendDBSyncMetaRequest(const std::string& db_name, uint32_t slot_id) {
+  std::shared_ptr<SyncSlaveSlot> slave_slot = GetSyncSlaveSlotByName(SlotInfo(db_name, slot_id));
+  if (!slave_slot) {
+    LOG(WARNING) << "Slave Slot: " << db_name << ":" << slot_id << ", NotFound";
+    return Status::Corruption("Slave Slot not found");
+  }
+  return pika_repl_client_->SendDBSyncMeta(slave_slot->MasterIp(), slave_slot->MasterPort(), db_name, slot_id,
+                                           slave_slot->LocalIp(), slave_slot->MasterSessionId());
+}
+
+Status PikaReplicaManager::SendDBSyncFileRequest(const std::string& db_name, uint32_t slot_id,
+                                                 const std::string& snapshot_uuid, const std::string& filename,
+                                                 uint64_t offset, uint64_t count) {
+  std::shared_ptr<SyncSlaveSlot> slave_slot = GetSyncSlaveSlotByName(SlotInfo(db_name, slot_id));
+  if (!slave_slot) {
+    LOG(WARNING) << "Slave Slot: " << db_name << ":" << slot_id << ", NotFound";
+    return Status::Corruption("Slave Slot not found");
+  }
+  return pika_repl_client_->SendDBSyncFile(slave_slot->MasterIp(), slave_slot->MasterPort(), db_name, slot_id,
+                                           slave_slot->LocalIp(), snapshot_uuid, filename, offset, count,
+                                           slave_slot->MasterSessionId());
+}
+
 Status PikaReplicaManager::SendSlotBinlogSyncAckRequest(const std::string& db, uint32_t slot_id,
                                                              const LogOffset& ack_start, const LogOffset& ack_end,
                                                              bool is_first_send) {
@@ -0,0 +1,821 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_script.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+#include <glog/logging.h>
+#include <lua.hpp>
+
+#include "include/pika_cmd_table_manager.h"
+#include "include/pika_conf.h"
+#include "include/pika_list.h"
+#include "include/pika_server.h"
+#include "include/pika_transaction.h"
+#include "pstd/include/env.h"
+#include "pstd/include/pstd_hash.h"
+
+extern PikaServer* g_pika_server;
+extern std::unique_ptr<PikaConf> g_pika_conf;
+extern std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
+
+// the script run by this thread, for redis.call()
+static thread_local EvalCmd* running_script = nullptr;
+
+// the hook checks the time of a script every this many instructions
+static const int kLuaHookInstructions = 100000;
+
+/*
+ * A script being run, for SCRIPT KILL. It may be killed once it has run for
+ * lua-time-limit, if it wrote nothing yet, and the hook raises an error in
+ * it until it ends.
+ */
+struct RunningScript {
+  uint64_t start_us = 0;
+  std::atomic<bool> timedout = false;
+  std::atomic<bool> wrote = false;
+  std::atomic<bool> killed = false;
+};
+
+static std::mutex running_scripts_mu;
+static std::unordered_set<RunningScript*> running_scripts;
+static thread_local RunningScript* running_state = nullptr;
+
+static void LuaMaskCountHook(lua_State* lua, lua_Debug* ar) {
+  RunningScript* script = running_state;
+  if (script == nullptr) {
+    return;
+  }
+  int time_limit = g_pika_conf->lua_time_limit();
+  if (!script->timedout.load() && time_limit > 0 &&
+      pstd::NowMicros() - script->start_us >= static_cast<uint64_t>(time_limit) * 1000) {
+    script->timedout = true;
+    LOG(WARNING) << "Lua slow script detected: still in execution after " << time_limit
+                 << " milliseconds. You can try killing the script using the SCRIPT KILL command.";
+  }
+  if (script->killed.load()) {
+    lua_pushstring(lua, "Script killed by user with SCRIPT KILL...");
+    lua_error(lua);
+  }
+}
+
+/*
+ * The lua functions below raise errors with lua_error, which longjmps over
+ * the frames of its caller, so they keep no C++ object alive when they call it
+ */
+static int LuaRedisCall(lua_State* lua) {
+  if (running_script == nullptr) {
+    lua_pushstring(lua, "redis.call() is only allowed while the script runs");
+    return lua_error(lua);
+  }
+  if (!running_script->LuaCall(lua)) {
+    return lua_error(lua);
+  }
+  return 1;
+}
+
+static int LuaRedisPCall(lua_State* lua) {
+  if (running_script == nullptr) {
+    lua_pushstring(lua, "redis.pcall() is only allowed while the script runs");
+    return lua_error(lua);
+  }
+  running_script->LuaCall(lua);
+  return 1;
+}
+
+static int LuaRedisSha1Hex(lua_State* lua) {
+  if (lua_gettop(lua) != 1 || lua_type(lua, 1) != LUA_TSTRING) {
+    lua_pushstring(lua, "wrong number of arguments");
+    return lua_error(lua);
+  }
+  size_t len = 0;
+  const char* body = lua_tolstring(lua, 1, &len);
+  std::string sha = pstd::sha1(std::string(body, len));
+  lua_pushlstring(lua, sha.data(), sha.size());
+  return 1;
+}
+
+static int LuaRedisReturnTable(lua_State* lua, const char* field) {
+  if (lua_gettop(lua) != 1 || lua_type(lua, 1) != LUA_TSTRING) {
+    lua_pushstring(lua, "wrong number or type of arguments");
+    return lua_error(lua);
+  }
+  lua_newtable(lua);
+  lua_pushstring(lua, field);
+  lua_pushvalue(lua, 1);
+  lua_rawset(lua, -3);
+  return 1;
+}
+
+static int LuaRedisErrorReply(lua_State* lua) { return LuaRedisReturnTable(lua, "err"); }
+
+static int LuaRedisStatusReply(lua_State* lua) { return LuaRedisReturnTable(lua, "ok"); }
+
+// The rand48 of math.random in this thread, seeded again before every
+// script, so that a script gets the same numbers wherever it runs
+static thread_local uint64_t lua_rand_state = 0;
+static const int32_t kLuaRandMax = 0x7fffffff;
+
+static void LuaRandSeed(int32_t seed) {
+  lua_rand_state = (static_cast<uint64_t>(static_cast<uint32_t>(seed)) << 16) | 0x330E;
+}
+
+static int32_t LuaRand() {
+  lua_rand_state = (0x5DEECE66DULL * lua_rand_state + 0xB) & ((1ULL << 48) - 1);
+  return static_cast<int32_t>(lua_rand_state >> 17);
+}
+
+// math.random as lua 5.1 has it, on LuaRand
+static int LuaMathRandom(lua_State* lua) {
+  lua_Number r = static_cast<lua_Number>(LuaRand() % kLuaRandMax) / static_cast<lua_Number>(kLuaRandMax);
+  switch (lua_gettop(lua)) {
+    case 0:
+      lua_pushnumber(lua, r);
+      break;
+    case 1: {
+      int upper = luaL_checkint(lua, 1);
+      luaL_argcheck(lua, 1 <= upper, 1, "interval is empty");
+      lua_pushnumber(lua, floor(r * upper) + 1);
+      break;
+    }
+    case 2: {
+      int lower = luaL_checkint(lua, 1);
+      int upper = luaL_checkint(lua, 2);
+      luaL_argcheck(lua, lower <= upper, 2, "interval is empty");
+      lua_pushnumber(lua, floor(r * (upper - lower + 1)) + lower);
+      break;
+    }
+    default:
+      return luaL_error(lua, "wrong number of arguments");
+  }
+  return 1;
+}
+
+static int LuaMathRandomSeed(lua_State* lua) {
+  LuaRandSeed(luaL_checkint(lua, 1));
+  return 0;
+}
+
+// The argument as 32 bits, wrapped the way the bit library of LuaBitOp does
+static uint32_t LuaBitArg(lua_State* lua, int arg) {
+  double num = luaL_checknumber(lua, arg) + 6755399441055744.0;
+  uint64_t bits = 0;
+  memcpy(&bits, &num, sizeof(bits));
+  return static_cast<uint32_t>(bits);
+}
+
+static int LuaBitReturn(lua_State* lua, uint32_t bits) {
+  lua_pushnumber(lua, static_cast<lua_Number>(static_cast<int32_t>(bits)));
+  return 1;
+}
+
+static int LuaBitToBit(lua_State* lua) { return LuaBitReturn(lua, LuaBitArg(lua, 1)); }
+
+static int LuaBitNot(lua_State* lua) { return LuaBitReturn(lua, ~LuaBitArg(lua, 1)); }
+
+static int LuaBitAnd(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  for (int i = lua_gettop(lua); i > 1; i--) {
+    bits &= LuaBitArg(lua, i);
+  }
+  return LuaBitReturn(lua, bits);
+}
+
+static int LuaBitOr(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  for (int i = lua_gettop(lua); i > 1; i--) {
+    bits |= LuaBitArg(lua, i);
+  }
+  return LuaBitReturn(lua, bits);
+}
+
+static int LuaBitXor(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  for (int i = lua_gettop(lua); i > 1; i--) {
+    bits ^= LuaBitArg(lua, i);
+  }
+  return LuaBitReturn(lua, bits);
+}
+
+static int LuaBitLShift(lua_State* lua) { return LuaBitReturn(lua, LuaBitArg(lua, 1) << (LuaBitArg(lua, 2) & 31)); }
+
+static int LuaBitRShift(lua_State* lua) { return LuaBitReturn(lua, LuaBitArg(lua, 1) >> (LuaBitArg(lua, 2) & 31)); }
+
+static int LuaBitARShift(lua_State* lua) {
+  int32_t bits = static_cast<int32_t>(LuaBitArg(lua, 1));
+  return LuaBitReturn(lua, static_cast<uint32_t>(bits >> (LuaBitArg(lua, 2) & 31)));
+}
+
+static int LuaBitRol(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  uint32_t n = LuaBitArg(lua, 2) & 31;
+  return LuaBitReturn(lua, n == 0 ? bits : (bits << n) | (bits >> (32 - n)));
+}
+
+static int LuaBitRor(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  uint32_t n = LuaBitArg(lua, 2) & 31;
+  return LuaBitReturn(lua, n == 0 ? bits : (bits >> n) | (bits << (32 - n)));
+}
+
+static int LuaBitSwap(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  bits = (bits >> 24) | ((bits >> 8) & 0xff00) | ((bits & 0xff00) << 8) | (bits << 24);
+  return LuaBitReturn(lua, bits);
+}
+
+static int LuaBitToHex(lua_State* lua) {
+  uint32_t bits = LuaBitArg(lua, 1);
+  int32_t n = lua_isnone(lua, 2) ? 8 : static_cast<int32_t>(LuaBitArg(lua, 2));
+  const char* digits = "0123456789abcdef";
+  if (n < 0) {
+    n = -n;
+    digits = "0123456789ABCDEF";
+  }
+  if (n > 8) {
+    n = 8;
+  }
+  char hex[8];
+  for (int i = n - 1; i >= 0; i--) {
+    hex[i] = digits[bits & 15];
+    bits >>= 4;
+  }
+  lua_pushlstring(lua, hex, n);
+  return 1;
+}
+
+/*
+ * A script may not read or create a global, except the functions defined by
+ * the main chunk, which is how LoadScript defines the scripts. Then a script
+ * can not leave state behind for the next scripts run by this thread.
+ */
+static const char kLuaGlobalsProtection[] =
+    "local dbg = debug\n"
+    "local mt = {}\n"
+    "setmetatable(_G, mt)\n"
+    "mt.__newindex = function (t, n, v)\n"
+    "  if dbg.getinfo(2) then\n"
+    "    local w = dbg.getinfo(2, \"S\").what\n"
+    "    if w ~= \"main\" and w ~= \"C\" then\n"
+    "      error(\"Script attempted to create global variable '\"..tostring(n)..\"'\", 2)\n"
+    "    end\n"
+    "  end\n"
+    "  rawset(t, n, v)\n"
+    "end\n"
+    "mt.__index = function (t, n)\n"
+    "  if dbg.getinfo(2) and dbg.getinfo(2, \"S\").what ~= \"C\" then\n"
+    "    error(\"Script attempted to access unexisting global variable '\"..tostring(n)..\"'\", 2)\n"
+    "  end\n"
+    "  return rawget(t, n)\n"
+    "end\n"
+    "debug = nil\n";
+
+// Set the functions as the fields of the global table name
+static void SetGlobalFuncs(lua_State* lua, const char* name, const luaL_Reg* funcs) {
+  lua_newtable(lua);
+  for (const luaL_Reg* func = funcs; func->func != nullptr; func++) {
+    lua_pushstring(lua, func->name);
+    lua_pushcfunction(lua, func->func);
+    lua_rawset(lua, -3);
+  }
+  lua_setglobal(lua, name);
+}
+
+static lua_State* NewLuaState() {
+  lua_State* lua = luaL_newstate();
+  // no io, os or package, a script only reaches the data through redis.call(),
+  // and debug is only kept by the globals protection
+  static const luaL_Reg libs[] = {{"", luaopen_base},
+                                  {LUA_TABLIBNAME, luaopen_table},
+                                  {LUA_STRLIBNAME, luaopen_string},
+                                  {LUA_MATHLIBNAME, luaopen_math},
+                                  {LUA_DBLIBNAME, luaopen_debug},
+                                  {nullptr, nullptr}};
+  for (const luaL_Reg* lib = libs; lib->func != nullptr; lib++) {
+    lua_pushcfunction(lua, lib->func);
+    lua_pushstring(lua, lib->name);
+    lua_call(lua, 1, 0);
+  }
+  for (const char* name : {"loadfile", "dofile"}) {
+    lua_pushnil(lua);
+    lua_setglobal(lua, name);
+  }
+
+  lua_getglobal(lua, LUA_MATHLIBNAME);
+  lua_pushstring(lua, "random");
+  lua_pushcfunction(lua, LuaMathRandom);
+  lua_rawset(lua, -3);
+  lua_pushstring(lua, "randomseed");
+  lua_pushcfunction(lua, LuaMathRandomSeed);
+  lua_rawset(lua, -3);
+  lua_pop(lua, 1);
+
+  static const luaL_Reg bit_funcs[] = {{"tobit", LuaBitToBit},   {"bnot", LuaBitNot},       {"band", LuaBitAnd},
+                                       {"bor", LuaBitOr},        {"bxor", LuaBitXor},       {"lshift", LuaBitLShift},
+                                       {"rshift", LuaBitRShift}, {"arshift", LuaBitARShift}, {"rol", LuaBitRol},
+                                       {"ror", LuaBitRor},       {"bswap", LuaBitSwap},     {"tohex", LuaBitToHex},
+                                       {nullptr, nullptr}};
+  SetGlobalFuncs(lua, "bit", bit_funcs);
+
+  static const luaL_Reg redis_funcs[] = {{"call", LuaRedisCall},
+                                         {"pcall", LuaRedisPCall},
+                                         {"sha1hex", LuaRedisSha1Hex},
+                                         {"error_reply", LuaRedisErrorReply},
+                                         {"status_reply", LuaRedisStatusReply},
+                                         {nullptr, nullptr}};
+  SetGlobalFuncs(lua, "redis", redis_funcs);
+
+  if (luaL_loadbuffer(lua, kLuaGlobalsProtection, sizeof(kLuaGlobalsProtection) - 1, "@globals_protection") != 0 ||
+      lua_pcall(lua, 0, 0, 0) != 0) {
+    LOG(FATAL) << "Failed to protect the lua globals: " << lua_tostring(lua, -1);
+  }
+  lua_sethook(lua, LuaMaskCountHook, LUA_MASKCOUNT, kLuaHookInstructions);
+  return lua;
+}
+
+// The lua state of this thread, made again after SCRIPT FLUSH
+struct LuaEnv {
+  lua_State* lua = nullptr;
+  uint64_t generation = 0;
+  // the memory of lua counted in used_memory_lua for this thread
+  int64_t memory = 0;
+  ~LuaEnv() {
+    if (lua != nullptr) {
+      lua_close(lua);
+    }
+  }
+};
+static thread_local LuaEnv lua_env;
+
+// Count the memory of the lua state of this thread as it is now
+static void UpdateLuaMemory() {
+  int64_t memory = 0;
+  if (lua_env.lua != nullptr) {
+    memory = static_cast<int64_t>(lua_gc(lua_env.lua, LUA_GCCOUNT, 0)) * 1024 + lua_gc(lua_env.lua, LUA_GCCOUNTB, 0);
+  }
+  g_pika_server->script_cache()->AddLuaMemory(memory - lua_env.memory);
+  lua_env.memory = memory;
+}
+
+static lua_State* ThreadLuaState() {
+  uint64_t generation = g_pika_server->script_cache()->generation();
+  if (lua_env.lua != nullptr && lua_env.generation != generation) {
+    lua_close(lua_env.lua);
+    lua_env.lua = nullptr;
+    UpdateLuaMemory();
+  }
+  if (lua_env.lua == nullptr) {
+    lua_env.lua = NewLuaState();
+    lua_env.generation = generation;
+    UpdateLuaMemory();
+  }
+  return lua_env.lua;
+}
+
+static std::string ScriptFuncName(const std::string& sha) { return "f_" + sha; }
+
+// Define the function of the script in lua, if this thread has not yet
+static bool LoadScript(lua_State* lua, const std::string& sha, const std::string& body, std::string* err) {
+  std::string func_name = ScriptFuncName(sha);
+  lua_pushstring(lua, func_name.c_str());
+  lua_rawget(lua, LUA_GLOBALSINDEX);
+  bool loaded = lua_isfunction(lua, -1);
+  lua_pop(lua, 1);
+  if (loaded) {
+    return true;
+  }
+
+  std::string code = "function " + func_name + "() " + body + "\nend";
+  if (luaL_loadbuffer(lua, code.data(), code.size(), "@user_script") != 0 || lua_pcall(lua, 0, 0, 0) != 0) {
+    const char* msg = lua_tostring(lua, -1);
+    *err = "Error compiling script (new function): " + std::string(msg != nullptr ? msg : "unknown error");
+    lua_pop(lua, 1);
+    return false;
+  }
+  return true;
+}
+
+// Push a RESP reply onto the lua stack, errors and status as {err=...} and {ok=...}
+static bool PushReply(lua_State* lua, const std::string& reply, size_t* pos) {
+  size_t line_end = reply.find("\r\n", *pos);
+  if (*pos >= reply.size() || line_end == std::string::npos || !lua_checkstack(lua, 3)) {
+    return false;
+  }
+  char type = reply[*pos];
+  std::string line = reply.substr(*pos + 1, line_end - *pos - 1);
+  *pos = line_end + 2;
+  long long num = 0;
+  switch (type) {
+    case '+':
+    case '-':
+      lua_newtable(lua);
+      lua_pushstring(lua, type == '+' ? "ok" : "err");
+      lua_pushlstring(lua, line.data(), line.size());
+      lua_rawset(lua, -3);
+      return true;
+    case ':':
+      if (pstd::string2int(line.data(), line.size(), &num) == 0) {
+        return false;
+      }
+      lua_pushnumber(lua, static_cast<lua_Number>(num));
+      return true;
+    case '$':
+      if (pstd::string2int(line.data(), line.size(), &num) == 0) {
+        return false;
+      }
+      if (num < 0) {
+        lua_pushboolean(lua, 0);
+        return true;
+      }
+      if (*pos + static_cast<size_t>(num) + 2 > reply.size()) {
+        return false;
+      }
+      lua_pushlstring(lua, reply.data() + *pos, num);
+      *pos += num + 2;
+      return true;
+    case '*':
+      if (pstd::string2int(line.data(), line.size(), &num) == 0) {
+        return false;
+      }
+      if (num < 0) {
+        lua_pushboolean(lua, 0);
+        return true;
+      }
+      lua_newtable(lua);
+      for (long long i = 1; i <= num; i++) {
+        if (!PushReply(lua, reply, pos)) {
+          return false;
+        }
+        lua_rawseti(lua, -2, static_cast<int>(i));
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The string field of the table on the top of the stack
+static bool TableField(lua_State* lua, const char* field, std::string* value) {
+  lua_pushstring(lua, field);
+  lua_rawget(lua, -2);
+  bool found = lua_type(lua, -1) == LUA_TSTRING;
+  if (found) {
+    size_t len = 0;
+    const char* str = lua_tolstring(lua, -1, &len);
+    value->assign(str, len);
+  }
+  lua_pop(lua, 1);
+  return found;
+}
+
+// Append the value on the top of the stack to reply, as RESP
+static void AppendLuaValue(lua_State* lua, std::string* reply) {
+  size_t len = 0;
+  const char* str = nullptr;
+  std::string field;
+  switch (lua_type(lua, -1)) {
+    case LUA_TSTRING:
+      str = lua_tolstring(lua, -1, &len);
+      RedisAppendLen(*reply, static_cast<int64_t>(len), "$");
+      RedisAppendContent(*reply, std::string(str, len));
+      return;
+    case LUA_TNUMBER:
+      RedisAppendLen(*reply, static_cast<int64_t>(lua_tonumber(lua, -1)), ":");
+      return;
+    case LUA_TBOOLEAN:
+      reply->append(lua_toboolean(lua, -1) != 0 ? ":1\r\n" : "$-1\r\n");
+      return;
+    case LUA_TTABLE: {
+      if (TableField(lua, "err", &field)) {
+        reply->append("-" + field + kNewLine);
+        return;
+      }
+      if (TableField(lua, "ok", &field)) {
+        reply->append("+" + field + kNewLine);
+        return;
+      }
+      // an array, up to the first nil
+      std::string elements;
+      int64_t num = 0;
+      lua_checkstack(lua, 2);
+      while (true) {
+        lua_rawgeti(lua, -1, static_cast<int>(num + 1));
+        if (lua_isnil(lua, -1)) {
+          lua_pop(lua, 1);
+          break;
+        }
+        AppendLuaValue(lua, &elements);
+        lua_pop(lua, 1);
+        num++;
+      }
+      RedisAppendLen(*reply, num, "*");
+      reply->append(elements);
+      return;
+    }
+    default:
+      reply->append("$-1\r\n");
+      return;
+  }
+}
+
+static void SetGlobalArray(lua_State* lua, const char* name, const std::vector<std::string>& values) {
+  lua_pushstring(lua, name);
+  lua_newtable(lua);
+  for (size_t i = 0; i < values.size(); i++) {
+    lua_pushlstring(lua, values[i].data(), values[i].size());
+    lua_rawseti(lua, -2, static_cast<int>(i + 1));
+  }
+  lua_rawset(lua, LUA_GLOBALSINDEX);
+}
+
+void EvalCmd::InitialKeysAndArgs() {
+  long long numkeys = 0;
+  if (pstd::string2int(argv_[2].data(), argv_[2].size(), &numkeys) == 0) {
+    res_.SetRes(CmdRes::kInvalidInt);
+    return;
+  }
+  if (numkeys < 0) {
+    res_.SetRes(CmdRes::kErrOther, "Number of keys can't be negative");
+    return;
+  }
+  if (numkeys > static_cast<long long>(argv_.size()) - 3) {
+    res_.SetRes(CmdRes::kErrOther, "Number of keys can't be greater than number of args");
+    return;
+  }
+  keys_.assign(argv_.begin() + 3, argv_.begin() + 3 + numkeys);
+  args_.assign(argv_.begin() + 3 + numkeys, argv_.end());
+}
+
+void EvalCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameEval);
+    return;
+  }
+  body_ = argv_[1];
+  sha_ = pstd::sha1(body_);
+  InitialKeysAndArgs();
+}
+
+void EvalShaCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameEvalSha);
+    return;
+  }
+  sha_ = argv_[1];
+  pstd::StringToLower(sha_);
+  if (!g_pika_server->script_cache()->Get(sha_, &body_)) {
+    res_.SetRes(CmdRes::kNoScript);
+    return;
+  }
+  InitialKeysAndArgs();
+}
+
+std::vector<std::string> EvalCmd::current_key() const {
+  if (keys_.empty()) {
+    return {""};
+  }
+  return keys_;
+}
+
+void EvalCmd::Do(std::shared_ptr<Slot> slot) {
+  lua_State* lua = ThreadLuaState();
+  std::string err;
+  if (!LoadScript(lua, sha_, body_, &err)) {
+    res_.SetRes(CmdRes::kErrOther, err);
+    return;
+  }
+  g_pika_server->script_cache()->Add(sha_, body_);
+
+  std::string reply;
+  storage::BatchWriteScope scope;
+  RunningScript state;
+  state.start_us = pstd::NowMicros();
+  {
+    std::lock_guard l(running_scripts_mu);
+    running_scripts.insert(&state);
+  }
+  {
+    Cmd::BinlogCapture capture(&binlogs_);
+    slot_ = slot;
+    running_script = this;
+    running_state = &state;
+    LuaRandSeed(0);
+    SetGlobalArray(lua, "KEYS", keys_);
+    SetGlobalArray(lua, "ARGV", args_);
+    lua_getglobal(lua, ScriptFuncName(sha_).c_str());
+    if (lua_pcall(lua, 0, 1, 0) != 0) {
+      // a {err=...} raised by redis.call() is replied as it is
+      if (!lua_istable(lua, -1) || !TableField(lua, "err", &err)) {
+        const char* msg = lua_tostring(lua, -1);
+        err = "ERR Error running script (call to " + ScriptFuncName(sha_) +
+              "): " + std::string(msg != nullptr ? msg : "unknown error");
+      }
+    } else {
+      AppendLuaValue(lua, &reply);
+    }
+    lua_pop(lua, 1);
+    UpdateLuaMemory();
+    running_script = nullptr;
+    running_state = nullptr;
+    slot_.reset();
+  }
+  {
+    std::lock_guard l(running_scripts_mu);
+    running_scripts.erase(&state);
+  }
+
+  if (!err.empty()) {
+    // nothing of the script is committed, touched or logged
+    writes_.clear();
+    binlogs_.clear();
+    res_.AppendStringRaw("-" + err + kNewLine);
+    return;
+  }
+  rocksdb::Status s = scope.Commit();
+  if (!s.ok()) {
+    writes_.clear();
+    binlogs_.clear();
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    return;
+  }
+  res_.AppendStringRaw(reply);
+}
+
+bool EvalCmd::LuaCall(lua_State* lua) {
+  std::string reply;
+  int argc = lua_gettop(lua);
+  PikaCmdArgsType argv;
+  for (int i = 1; i <= argc; i++) {
+    int type = lua_type(lua, i);
+    if (type != LUA_TSTRING && type != LUA_TNUMBER) {
+      argv.clear();
+      break;
+    }
+    if (type == LUA_TNUMBER) {
+      // lua would print it with 14 digits only
+      char num[64];
+      int len = snprintf(num, sizeof(num), "%.17g", static_cast<double>(lua_tonumber(lua, i)));
+      argv.emplace_back(num, len);
+      continue;
+    }
+    size_t len = 0;
+    const char* arg = lua_tolstring(lua, i, &len);
+    argv.emplace_back(arg, len);
+  }
+
+  std::shared_ptr<Cmd> cmd;
+  if (argc == 0) {
+    reply = "-ERR Please specify at least one argument for redis.call()\r\n";
+  } else if (argv.empty()) {
+    reply = "-ERR Lua redis() command arguments must be strings or integers\r\n";
+  } else {
+    std::string opt = argv[0];
+    cmd = g_pika_cmd_table_manager->GetCmd(pstd::StringToLower(opt));
+    if (!cmd) {
+      reply = "-ERR Unknown Redis command called from Lua script\r\n";
+    } else if ((cmd->is_admin() && cmd->name() != kCmdNamePing && cmd->name() != kCmdNameEcho) || cmd->is_pubsub()) {
+      // the admin commands act on the server or the connection, see QueueMultiCmd
+      reply = "-ERR This Redis command is not allowed from scripts\r\n";
+      cmd.reset();
+    } else if (!cmd->CheckArg(static_cast<int>(argv.size()))) {
+      reply = "-ERR Wrong number of args calling Redis command From Lua script\r\n";
+      cmd.reset();
+    } else {
+      cmd->Initial(argv, db_name_);
+      if (!cmd->res().ok()) {
+        reply = cmd->res().message();
+        cmd.reset();
+      }
+    }
+  }
+
+  if (cmd) {
+    // only the KEYS are locked, and only their shard is the one of the script,
+    // a read with no key at all runs anyway
+    for (const auto& key : cmd->current_key()) {
+      if ((cmd->is_write() || !key.empty()) && std::find(keys_.begin(), keys_.end(), key) == keys_.end()) {
+        reply = "-ERR Commands in scripts may only access the keys passed as KEYS\r\n";
+        cmd.reset();
+        break;
+      }
+    }
+  }
+
+  if (cmd) {
+    cmd->res().clear();
+    cmd->Do(slot_);
+    if (cmd->is_blocked()) {
+      // there is no waiting inside a script
+      std::static_pointer_cast<BlockingPopCmd>(cmd)->ReplyTimeout();
+    }
+    if (cmd->is_write() && cmd->res().ok()) {
+      cmd->DoBinlog(nullptr);
+      writes_.push_back(cmd);
+      running_state->wrote = true;
+    }
+    reply = cmd->res().message();
+  }
+
+  lua_settop(lua, 0);
+  size_t pos = 0;
+  if (reply.empty() || !PushReply(lua, reply, &pos)) {
+    lua_settop(lua, 0);
+    lua_pushstring(lua, "invalid reply of the command called from Lua script");
+    return false;
+  }
+  return reply[0] != '-';
+}
+
+void EvalCmd::TouchWatchedKeys() {
+  for (const auto& cmd : writes_) {
+    g_pika_server->TouchKeys(db_name_, cmd->current_key(), GetConn());
+  }
+}
+
+void EvalCmd::DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) {
+  // a read only script, or nothing written
+  if (binlogs_.empty()) {
+    return;
+  }
+  Cmd::DoBinlog(slot);
+}
+
+std::string EvalCmd::ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
+                              uint64_t offset) {
+  return ExecCmd::ExecBinlog(binlogs_, exec_time, term_id, logic_id, filenum, offset);
+}
+
+void ScriptCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameScript);
+    return;
+  }
+  subcommand_ = argv_[1];
+  pstd::StringToLower(subcommand_);
+  if ((subcommand_ == "load" && argv_.size() != 3) || (subcommand_ == "flush" && argv_.size() != 2) ||
+      (subcommand_ == "exists" && argv_.size() < 3) || (subcommand_ == "kill" && argv_.size() != 2)) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameScript + " " + subcommand_);
+    return;
+  }
+  if (subcommand_ != "load" && subcommand_ != "flush" && subcommand_ != "exists" && subcommand_ != "kill") {
+    res_.SetRes(CmdRes::kErrOther, "Unknown SCRIPT subcommand or wrong # of args.");
+    return;
+  }
+}
+
+void ScriptCmd::Do(std::shared_ptr<Slot> slot) {
+  PikaScriptCache* cache = g_pika_server->script_cache();
+  if (subcommand_ == "load") {
+    std::string sha = pstd::sha1(argv_[2]);
+    std::string err;
+    if (!LoadScript(ThreadLuaState(), sha, argv_[2], &err)) {
+      res_.SetRes(CmdRes::kErrOther, err);
+      return;
+    }
+    cache->Add(sha, argv_[2]);
+    res_.AppendString(sha);
+  } else if (subcommand_ == "exists") {
+    res_.AppendArrayLen(static_cast<int64_t>(argv_.size()) - 2);
+    for (size_t i = 2; i < argv_.size(); i++) {
+      std::string sha = argv_[i];
+      res_.AppendInteger(cache->Exists(pstd::StringToLower(sha)) ? 1 : 0);
+    }
+  } else if (subcommand_ == "kill") {
+    // the scripts run past lua-time-limit, the ones that wrote are left to
+    // finish, like redis does
+    bool timedout = false;
+    bool killed = false;
+    std::lock_guard l(running_scripts_mu);
+    for (RunningScript* script : running_scripts) {
+      if (!script->timedout.load()) {
+        continue;
+      }
+      timedout = true;
+      if (!script->wrote.load()) {
+        script->killed = true;
+        killed = true;
+      }
+    }
+    if (killed) {
+      res_.SetRes(CmdRes::kOk);
+    } else if (timedout) {
+      res_.AppendStringRaw(
+          "-UNKILLABLE Sorry the script already executed write commands against the dataset. You can either wait the "
+          "script termination or kill the server in a hard way using the SHUTDOWN NOSAVE command.\r\n");
+    } else {
+      res_.AppendStringRaw("-NOTBUSY No scripts in execution right now.\r\n");
+    }
+  } else {
+    cache->Flush();
+    res_.SetRes(CmdRes::kOk);
+  }
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_script_cache.h"
+
+#include <mutex>
+
+#include "pstd/include/pstd_hash.h"
+
+std::string PikaScriptCache::Add(const std::string& body) {
+  std::string sha = pstd::sha1(body);
+  Add(sha, body);
+  return sha;
+}
+
+void PikaScriptCache::Add(const std::string& sha, const std::string& body) {
+  std::lock_guard l(mu_);
+  scripts_.emplace(sha, body);
+}
+
+bool PikaScriptCache::Get(const std::string& sha, std::string* body) {
+  std::shared_lock l(mu_);
+  auto iter = scripts_.find(sha);
+  if (iter == scripts_.end()) {
+    return false;
+  }
+  *body = iter->second;
+  return true;
+}
+
+bool PikaScriptCache::Exists(const std::string& sha) {
+  std::shared_lock l(mu_);
+  return scripts_.find(sha) != scripts_.end();
+}
+
+void PikaScriptCache::Flush() {
+  std::lock_guard l(mu_);
+  scripts_.clear();
+  generation_++;
+}
@@ -19,7 +19,6 @@
 #include "net/include/net_interfaces.h"
 #include "net/include/redis_cli.h"
 #include "pstd/include/env.h"
-#include "pstd/include/rsync.h"
 
 #include "include/pika_cmd_table_manager.h"
 #include "include/pika_dispatch_thread.h"
@@ -37,12 +36,6 @@ void DoPurgeDir(void* arg) {
   LOG(INFO) << "Delete dir: " << *path << " done";
 }
 
-void DoDBSync(void* arg) {
-  std::unique_ptr<DBSyncArg> dbsa(static_cast<DBSyncArg*>(arg));
-  PikaServer* const ps = dbsa->p;
-  ps->DbSyncSendFile(dbsa->ip, dbsa->port, dbsa->db_name, dbsa->slot_id);
-}
-
 PikaServer::PikaServer()
     : exit_(false),
       slot_state_(INFREE),
@@ -69,15 +62,19 @@ PikaServer::PikaServer()
   // We estimate the queue size
   int worker_queue_limit = g_pika_conf->maxclients() / worker_num_ + 100;
   LOG(INFO) << "Worker queue limit is " << worker_queue_limit;
+  if (g_pika_conf->io_multiplexer() == "io_uring") {
+    net::SetWorkerMultiplexerType(net::kMultiplexerIoUring);
+  }
   pika_dispatch_thread_ =
       std::make_unique<PikaDispatchThread>(ips, port_, worker_num_, 3000, worker_queue_limit, g_pika_conf->max_conn_rbuf_size());
-  pika_rsync_service_ = std::make_unique<PikaRsyncService>(g_pika_conf->db_sync_path(), g_pika_conf->port() + kPortShiftRSync);
   pika_pubsub_thread_ = std::make_unique<net::PubSubThread>();
+  pika_blocked_clients_ = std::make_unique<PikaBlockedClients>();
   pika_auxiliary_thread_ = std::make_unique<PikaAuxiliaryThread>();
   pika_migrate_ = std::make_unique<PikaMigrate>();
   pika_migrate_thread_ = std::make_unique<PikaMigrateThread>();
 
   pika_client_processor_ = std::make_unique<PikaClientProcessor>(g_pika_conf->thread_pool_size(), 100000);
+  client_tracking_.SetMaxKeys(static_cast<size_t>(g_pika_conf->tracking_table_max_keys()));
   exit_mutex_.lock();
 }
 
@@ -96,6 +93,7 @@ PikaServer::~PikaServer() {
   }
   bgsave_thread_.StopThread();
   key_scan_thread_.StopThread();
+  pika_blocked_clients_->StopThread();
   pika_migrate_thread_->StopThread();
 
   dbs_.clear();
@@ -127,14 +125,6 @@ bool PikaServer::ServerInit() {
 
 void PikaServer::Start() {
   int ret = 0;
-  // start rsync first, rocksdb opened fd will not appear in this fork
-  ret = pika_rsync_service_->StartRsync();
-  if (0 != ret) {
-    dbs_.clear();
-    LOG(FATAL) << "Start Rsync Error: bind port " + std::to_string(pika_rsync_service_->ListenPort()) + " failed"
-               << ", Listen on this port to receive Master FullSync Data";
-  }
-
   // We Init DB Struct Before Start The following thread
   InitDBStruct();
 
@@ -157,6 +147,13 @@ void PikaServer::Start() {
     LOG(FATAL) << "Start Pubsub Error: " << ret << (ret == net::kBindError ? ": bind port conflict" : ": other error");
   }
 
+  ret = pika_blocked_clients_->StartThread();
+  if (ret != net::kSuccess) {
+    dbs_.clear();
+    LOG(FATAL) << "Start BlockedClients Thread Error: " << ret
+               << (ret == net::kCreateThreadError ? ": create thread error " : ": other error");
+  }
+
   ret = pika_auxiliary_thread_->StartThread();
   if (ret != net::kSuccess) {
     dbs_.clear();
@@ -377,6 +374,20 @@ bool PikaServer::IsBgSaving() {
   return false;
 }
 
+void PikaServer::BgSaveStall(uint64_t* stall_us, uint64_t* avoided_stall_us) {
+  *stall_us = 0;
+  *avoided_stall_us = 0;
+  std::shared_lock l(dbs_rw_);
+  for (const auto& db_item : dbs_) {
+    std::shared_lock slot_rwl(db_item.second->slots_rw_);
+    for (const auto& slot_item : db_item.second->slots_) {
+      BgSaveInfo info = slot_item.second->bgsave_info();
+      *stall_us += info.stall_us;
+      *avoided_stall_us += info.avoided_stall_us;
+    }
+  }
+}
+
 bool PikaServer::IsKeyScaning() {
   std::shared_lock l(dbs_rw_);
   for (const auto& db_item : dbs_) {
@@ -394,7 +405,7 @@ bool PikaServer::IsCompacting() {
     for (const auto& slot_item : db_item.second->slots_) {
       slot_item.second->DbRWLockReader();
       std::string task_type = slot_item.second->db()->GetCurrentTaskType();
-      slot_item.second->DbRWUnLock();
+      slot_item.second->DbRWUnLockReader();
       if (strcasecmp(task_type.data(), "no") != 0) {
         return true;
       }
@@ -499,7 +510,7 @@ void PikaServer::SlotSetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys)
     for (const auto& slot_item : db_item.second->slots_) {
       slot_item.second->DbRWLockReader();
       slot_item.second->db()->SetMaxCacheStatisticKeys(max_cache_statistic_keys);
-      slot_item.second->DbRWUnLock();
+      slot_item.second->DbRWUnLockReader();
     }
   }
 }
@@ -510,7 +521,18 @@ void PikaServer::SlotSetSmallCompactionThreshold(uint32_t small_compaction_thres
     for (const auto& slot_item : db_item.second->slots_) {
       slot_item.second->DbRWLockReader();
       slot_item.second->db()->SetSmallCompactionThreshold(small_compaction_threshold);
-      slot_item.second->DbRWUnLock();
+      slot_item.second->DbRWUnLockReader();
+    }
+  }
+}
+
+void PikaServer::SlotSetActiveExpireCpuPercent(int active_expire_cpu_percent) {
+  std::shared_lock rwl(dbs_rw_);
+  for (const auto& db_item : dbs_) {
+    for (const auto& slot_item : db_item.second->slots_) {
+      slot_item.second->DbRWLockReader();
+      slot_item.second->db()->SetActiveExpireCpuPercent(active_expire_cpu_percent);
+      slot_item.second->DbRWUnLockReader();
     }
   }
 }
@@ -625,6 +647,15 @@ void PikaServer::DeleteSlave(int fd) {
 
 int32_t PikaServer::CountSyncSlaves() {
   std::lock_guard ldb(db_sync_protector_);
+  // A slave pulling the snapshot keeps sending requests, drop the ones gone silent
+  uint64_t now = pstd::NowMicros();
+  for (auto iter = db_sync_slaves_.begin(); iter != db_sync_slaves_.end();) {
+    if (iter->second + kDBSyncSessionTimeout < now) {
+      iter = db_sync_slaves_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
   return db_sync_slaves_.size();
 }
 
@@ -878,22 +909,6 @@ void PikaServer::PurgeDirTaskSchedule(void (*function)(void*), void* arg) {
   purge_thread_.Schedule(function, arg);
 }
 
-void PikaServer::DBSync(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id) {
-  {
-    std::string task_index = DbSyncTaskIndex(ip, port, db_name, slot_id);
-    std::lock_guard ml(db_sync_protector_);
-    if (db_sync_slaves_.find(task_index) != db_sync_slaves_.end()) {
-      return;
-    }
-    db_sync_slaves_.insert(task_index);
-  }
-  // Reuse the bgsave_thread_
-  // Since we expect BgSave and DBSync execute serially
-  bgsave_thread_.StartThread();
-  auto arg = new DBSyncArg(this, ip, port, db_name, slot_id);
-  bgsave_thread_.Schedule(&DoDBSync, reinterpret_cast<void*>(arg));
-}
-
 void PikaServer::TryDBSync(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id,
                            int32_t top) {
   std::shared_ptr<Slot> slot = GetDBSlotById(db_name, slot_id);
@@ -917,124 +932,13 @@ void PikaServer::TryDBSync(const std::string& ip, int port, const std::string& d
     // Need Bgsave first
     slot->BgSaveSlot();
   }
-  DBSync(ip, port, db_name, slot_id);
+  DBSyncSlaveActive(ip, port, db_name, slot_id);
 }
 
-void PikaServer::DbSyncSendFile(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id) {
-  std::shared_ptr<Slot> slot = GetDBSlotById(db_name, slot_id);
-  if (!slot) {
-    LOG(WARNING) << "can not find Slot whose id is " << slot_id << " in db " << db_name
-                 << ", DbSync send file Failed";
-    return;
-  }
-
-  BgSaveInfo bgsave_info = slot->bgsave_info();
-  std::string bg_path = bgsave_info.path;
-  uint32_t binlog_filenum = bgsave_info.offset.b_offset.filenum;
-  uint64_t binlog_offset = bgsave_info.offset.b_offset.offset;
-  uint32_t term = bgsave_info.offset.l_offset.term;
-  uint64_t index = bgsave_info.offset.l_offset.index;
-
-  // Get all files need to send
-  std::vector<std::string> descendant;
-  int ret = 0;
-  LOG(INFO) << "Slot: " << slot->GetSlotName() << " Start Send files in " << bg_path << " to " << ip;
-  ret = pstd::GetChildren(bg_path, descendant);
-  if (ret) {
-    std::string ip_port = pstd::IpPortString(ip, port);
-    std::lock_guard ldb(db_sync_protector_);
-    db_sync_slaves_.erase(ip_port);
-    LOG(WARNING) << "Slot: " << slot->GetSlotName()
-                 << " Get child directory when try to do sync failed, error: " << strerror(ret);
-    return;
-  }
-
-  std::string local_path;
-  std::string target_path;
-  const std::string& remote_path = db_name;
-  auto iter = descendant.begin();
-  pstd::RsyncRemote remote(ip, port, kDBSyncModule, g_pika_conf->db_sync_speed() * 1024);
-  std::string secret_file_path = g_pika_conf->db_sync_path();
-  if (g_pika_conf->db_sync_path().back() != '/') {
-    secret_file_path += "/";
-  }
-  secret_file_path += pstd::kRsyncSubDir + "/" + kPikaSecretFile;
-
-  for (; iter != descendant.end(); ++iter) {
-    local_path = bg_path + "/" + *iter;
-    target_path = remote_path + "/" + *iter;
-
-    if (*iter == kBgsaveInfoFile) {
-      continue;
-    }
-
-    if (pstd::IsDir(local_path) == 0 && local_path.back() != '/') {
-      local_path.push_back('/');
-      target_path.push_back('/');
-    }
-
-    // We need specify the speed limit for every single file
-    ret = pstd::RsyncSendFile(local_path, target_path, secret_file_path, remote);
-    if (0 != ret) {
-      LOG(WARNING) << "Slot: " << slot->GetSlotName() << " RSync send file failed! From: " << *iter
-                   << ", To: " << target_path << ", At: " << ip << ":" << port << ", Error: " << ret;
-      break;
-    }
-  }
-  // Clear target path
-  pstd::RsyncSendClearTarget(bg_path + "/strings", remote_path + "/strings", secret_file_path, remote);
-  pstd::RsyncSendClearTarget(bg_path + "/hashes", remote_path + "/hashes", secret_file_path, remote);
-  pstd::RsyncSendClearTarget(bg_path + "/lists", remote_path + "/lists", secret_file_path, remote);
-  pstd::RsyncSendClearTarget(bg_path + "/sets", remote_path + "/sets", secret_file_path, remote);
-  pstd::RsyncSendClearTarget(bg_path + "/zsets", remote_path + "/zsets", secret_file_path, remote);
-
-  std::unique_ptr<net::NetCli> cli(net::NewRedisCli());
-  std::string lip(host_);
-  if (cli->Connect(ip, port, "").ok()) {
-    struct sockaddr_in laddr;
-    socklen_t llen = sizeof(laddr);
-    getsockname(cli->fd(), reinterpret_cast<struct sockaddr*>(&laddr), &llen);
-    lip = inet_ntoa(laddr.sin_addr);
-    cli->Close();
-  } else {
-    LOG(WARNING) << "Rsync try connect slave rsync service error"
-                 << ", slave rsync service(" << ip << ":" << port << ")";
-  }
-
-  // Send info file at last
-  if (0 == ret) {
-    // need to modify the IP addr in the info file
-    if (lip != host_) {
-      std::ofstream fix;
-      std::string fn = bg_path + "/" + kBgsaveInfoFile + "." + std::to_string(time(nullptr));
-      fix.open(fn, std::ios::in | std::ios::trunc);
-      if (fix.is_open()) {
-        fix << "0s\n" << lip << "\n" << port_ << "\n" << binlog_filenum << "\n" << binlog_offset << "\n";
-        if (g_pika_conf->consensus_level() != 0) {
-          fix << term << "\n" << index << "\n";
-        }
-        fix.close();
-      }
-      ret = pstd::RsyncSendFile(fn, remote_path + "/" + kBgsaveInfoFile, secret_file_path, remote);
-      pstd::DeleteFile(fn);
-      if (ret) {
-        LOG(WARNING) << "Slot: " << slot->GetSlotName() << " Send Modified Info File Failed";
-      }
-    } else if (0 != (ret = pstd::RsyncSendFile(bg_path + "/" + kBgsaveInfoFile, remote_path + "/" + kBgsaveInfoFile,
-                                               secret_file_path, remote))) {
-      LOG(WARNING) << "Slot: " << slot->GetSlotName() << " Send Info File Failed";
-    }
-  }
-  // remove slave
-  {
-    std::string task_index = DbSyncTaskIndex(ip, port, db_name, slot_id);
-    std::lock_guard ml(db_sync_protector_);
-    db_sync_slaves_.erase(task_index);
-  }
-
-  if (0 == ret) {
-    LOG(INFO) << "Slot: " << slot->GetSlotName() << " RSync Send Files Success";
-  }
+void PikaServer::DBSyncSlaveActive(const std::string& ip, int port, const std::string& db_name, uint32_t slot_id) {
+  std::string task_index = DbSyncTaskIndex(ip, port, db_name, slot_id);
+  std::lock_guard ml(db_sync_protector_);
+  db_sync_slaves_[task_index] = pstd::NowMicros();
 }
 
 std::string PikaServer::DbSyncTaskIndex(const std::string& ip, int port, const std::string& db_name,
@@ -1101,6 +1005,28 @@ void PikaServer::AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr) {
   }
 }
 
+void PikaServer::TouchKeys(const std::string& db_name, const std::vector<std::string>& keys,
+                           const std::shared_ptr<net::NetConn>& writer) {
+  watched_keys_.Touch(db_name, keys);
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(writer);
+  client_tracking_.Invalidate(db_name, keys, conn ? conn->id() : 0);
+}
+
+void PikaServer::TouchAllKeys(const std::string& db_name) {
+  watched_keys_.TouchAll(db_name);
+  client_tracking_.InvalidateAll(db_name);
+}
+
+void PikaServer::TouchKeysBeforeFlush(const std::string& db_name) {
+  for (const auto& [db, key] : watched_keys_.WatchedKeys(db_name)) {
+    std::shared_ptr<Slot> slot = GetDBSlotByKey(db, key);
+    std::map<storage::DataType, rocksdb::Status> type_status;
+    if (slot && slot->db()->Exists({key}, &type_status) != 0) {
+      watched_keys_.Touch(db, {key});
+    }
+  }
+}
+
 void PikaServer::SlowlogTrim() {
   std::lock_guard l(slowlog_protector_);
   while (slowlog_list_.size() > static_cast<uint32_t>(g_pika_conf->slowlog_max_len())) {
@@ -1247,8 +1173,6 @@ void PikaServer::DoTimingTask() {
   AutoPurge();
   // Delete expired dump
   AutoDeleteExpiredDump();
-  // Cheek Rsync Status
-  AutoKeepAliveRSync();
   // Reset server qps
   ResetLastSecQuerynum();
 }
@@ -1424,13 +1348,6 @@ void PikaServer::AutoDeleteExpiredDump() {
   }
 }
 
-void PikaServer::AutoKeepAliveRSync() {
-  if (!pika_rsync_service_->CheckRsyncAlive()) {
-    LOG(WARNING) << "The Rsync service is down, Try to restart";
-    pika_rsync_service_->StartRsync();
-  }
-}
-
 void PikaServer::InitStorageOptions() {
   std::lock_guard rwl(storage_options_rw_);
 
@@ -1494,6 +1411,13 @@ void PikaServer::InitStorageOptions() {
   storage_options_.statistics_max_size = g_pika_conf->max_cache_statistic_keys();
   storage_options_.small_compaction_threshold = g_pika_conf->small_compaction_threshold();
 
+  // For Storage expire reaper
+  storage_options_.active_expire_cpu_percent = g_pika_conf->active_expire_cpu_percent();
+
+  // For Storage inline hashes
+  storage_options_.hash_max_inline_fields = g_pika_conf->hash_max_inline_fields();
+  storage_options_.hash_max_inline_value = g_pika_conf->hash_max_inline_value();
+
   // rocksdb blob
   if (g_pika_conf->enable_blob_files()) {
     storage_options_.options.enable_blob_files = g_pika_conf->enable_blob_files();
@@ -1519,7 +1443,7 @@ storage::Status PikaServer::RewriteStorageOptions(const storage::OptionType& opt
     for (const auto& slot_item : db_item.second->slots_) {
       slot_item.second->DbRWLockWriter();
       s = slot_item.second->db()->SetOptions(option_type, storage::ALL_DB, options_map);
-      slot_item.second->DbRWUnLock();
+      slot_item.second->DbRWUnLockWriter();
       if (!s.ok()) {
         return s;
       }
@@ -1553,6 +1477,10 @@ void PikaServer:: GetSlotsMgrtSenderStatus(std::string *ip, int64_t *port, int64
   return pika_migrate_thread_->GetMigrateStatus(ip, port, slot, migrating, moved, remained);
 }
 
+void PikaServer::GetSlotsMgrtSenderThroughput(int64_t *bytes, int64_t *elapsed_ms) {
+  pika_migrate_thread_->GetMigrateThroughput(bytes, elapsed_ms);
+}
+
 int PikaServer:: SlotsMigrateOne(const std::string &key, std::shared_ptr<Slot>slot) {
   return pika_migrate_thread_->ReqMigrateOne(key, slot);
 }
@@ -64,7 +64,7 @@ void SPopCmd::Do(std::shared_ptr<Slot> slot) {
       res_.AppendContent(member);
     }
   } else if (s.IsNotFound()) {
-    res_.AppendContent("$-1");
+    res_.AppendStringLen(-1);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
@@ -100,7 +100,7 @@ void SMembersCmd::Do(std::shared_ptr<Slot> slot) {
   std::vector<std::string> members;
   rocksdb::Status s = slot->db()->SMembers(key_, &members);
   if (s.ok() || s.IsNotFound()) {
-    res_.AppendArrayLen(members.size());
+    res_.AppendSetLen(members.size());
     for (const auto& member : members) {
       res_.AppendStringLen(member.size());
       res_.AppendContent(member);
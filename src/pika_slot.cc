@@ -12,7 +12,6 @@
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
 
-#include "pstd/include/mutex_impl.h"
 
 using pstd::Status;
 
@@ -41,22 +40,44 @@ std::string BgsaveSubPath(const std::string& db_name, uint32_t slot_id) {
 std::string DbSyncPath(const std::string& sync_path, const std::string& db_name, const uint32_t slot_id) {
   char buf[256];
   std::string slot_id_str = std::to_string(slot_id);
-  snprintf(buf, sizeof(buf), "%s/", db_name.data());
+  snprintf(buf, sizeof(buf), "%s/%s/", db_name.data(), slot_id_str.data());
   return sync_path + buf;
 }
 
+// The storage wakes the clients blocked on its lists when they are pushed,
+// and tells the tracking clients of the keys its expire reaper removes
+static std::shared_ptr<storage::Storage> NewSlotStorage(const std::string& db_name,
+                                                        const std::shared_ptr<pstd::lock::LockMgr>& lock_mgr) {
+  auto db = std::make_shared<storage::Storage>(lock_mgr);
+  db->SetListPushListener([db_name](const storage::Slice& key) {
+    g_pika_server->blocked_clients()->SignalKeyReady(db_name, std::string_view(key.data(), key.size()));
+  });
+  db->SetKeyReapedListener([db_name](const storage::Slice& key) {
+    g_pika_server->client_tracking()->Invalidate(db_name, {key.ToString()}, 0);
+  });
+  return db;
+}
+
 Slot::Slot(const std::string& db_name, uint32_t slot_id, const std::string& table_db_path)
     : db_name_(db_name), slot_id_(slot_id), bgsave_engine_(nullptr) {
-  db_path_ = table_db_path;
-  bgsave_sub_path_ = db_name;
-  dbsync_path_ = DbSyncPath(g_pika_conf->db_sync_path(), db_name, slot_id_);
-  slot_name_ = db_name;
+  // a db of one slot keeps the layout it had before it could be sharded
+  if (g_pika_conf->db_shard_num() > 1) {
+    db_path_ = SlotPath(table_db_path, slot_id_);
+    bgsave_sub_path_ = BgsaveSubPath(db_name, slot_id_);
+    dbsync_path_ = DbSyncPath(g_pika_conf->db_sync_path(), db_name, slot_id_);
+    slot_name_ = SlotName(db_name, slot_id_);
+  } else {
+    db_path_ = table_db_path;
+    bgsave_sub_path_ = db_name;
+    dbsync_path_ = g_pika_conf->db_sync_path() + db_name + "/";
+    slot_name_ = db_name;
+  }
+  dbsync_receiver_ = std::make_shared<DBSyncReceiver>(db_name_, slot_id_, dbsync_path_);
 
-  db_ = std::make_shared<storage::Storage>();
+  lock_mgr_ = std::make_shared<pstd::lock::LockMgr>();
+  db_ = NewSlotStorage(db_name_, lock_mgr_);
   rocksdb::Status s = db_->Open(g_pika_server->storage_options(), db_path_);
 
-  lock_mgr_ = std::make_shared<pstd::lock::LockMgr>(1000, 0, std::make_shared<pstd::lock::MutexFactoryImpl>());
-
   opened_ = s.ok();
   assert(db_);
   assert(s.ok());
@@ -117,30 +138,49 @@ void Slot::Compact(const storage::DataType& type) {
   db_->Compact(type);
 }
 
+rocksdb::Status Slot::IngestExternalFiles(const std::string& path) {
+  std::shared_lock rwl(db_rwlock_);
+  if (!opened_) {
+    return rocksdb::Status::Incomplete(slot_name_ + " is not opened");
+  }
+  LOG(INFO) << slot_name_ << " Ingest sst files from " << path;
+  return db_->IngestExternalFiles(path);
+}
+
 void Slot::DbRWLockWriter() { db_rwlock_.lock(); }
 
+void Slot::DbRWUnLockWriter() { db_rwlock_.unlock(); }
+
 void Slot::DbRWLockReader() { db_rwlock_.lock_shared(); }
 
-void Slot::DbRWUnLock() { db_rwlock_.unlock(); }
+void Slot::DbRWUnLockReader() { db_rwlock_.unlock_shared(); }
 
 std::shared_ptr<pstd::lock::LockMgr> Slot::LockMgr() { return lock_mgr_; }
 
-void Slot::PrepareRsync() {
-  pstd::DeleteDirIfExist(dbsync_path_);
+// Files pulled before are kept in dbsync path, the receiver
+// resumes from them if the master still serves the same snapshot
+void Slot::PrepareDBSync() {
+  pstd::DeleteFile(dbsync_path_ + kBgsaveInfoFile);
   pstd::CreatePath(dbsync_path_ + "strings");
   pstd::CreatePath(dbsync_path_ + "hashes");
   pstd::CreatePath(dbsync_path_ + "lists");
   pstd::CreatePath(dbsync_path_ + "sets");
   pstd::CreatePath(dbsync_path_ + "zsets");
+  dbsync_receiver_->Reset();
 }
 
+std::shared_ptr<DBSyncReceiver> Slot::GetDBSyncReceiver() { return dbsync_receiver_; }
+
 // Try to update master offset
 // This may happend when dbsync from master finished
 // Here we do:
-// 1, Check dbsync finished, got the new binlog offset
+// 1, Pull the snapshot files from master, got the new binlog offset
 // 2, Replace the old db
 // 3, Update master offset, and the PikaAuxiliaryThread cron will connect and do slaveof task with master
 bool Slot::TryUpdateMasterOffset() {
+  if (!dbsync_receiver_->Tick()) {
+    return false;
+  }
   std::string info_path = dbsync_path_ + kBgsaveInfoFile;
   if (!pstd::FileExists(info_path)) {
     return false;
@@ -265,7 +305,7 @@ bool Slot::ChangeDb(const std::string& new_path) {
     return false;
   }
 
-  db_ = std::make_shared<storage::Storage>();
+  db_ = NewSlotStorage(db_name_, lock_mgr_);
   rocksdb::Status s = db_->Open(g_pika_server->storage_options(), db_path_);
   assert(db_);
   assert(s.ok());
@@ -334,16 +374,33 @@ bool Slot::RunBgsaveEngine() {
 
   BgSaveInfo info = bgsave_info();
   LOG(INFO) << slot_name_ << " bgsave_info: path=" << info.path << ",  filenum=" << info.offset.b_offset.filenum
-            << ", offset=" << info.offset.b_offset.offset;
+            << ", offset=" << info.offset.b_offset.offset << ", stall_us=" << info.stall_us
+            << ", avoided_stall_us=" << info.avoided_stall_us;
+
+  rocksdb::Status s;
+  if (!info.base_path.empty()) {
+    s = bgsave_engine_->SetBaseBackup(info.base_path);
+    LOG(INFO) << slot_name_ << " bgsave based on " << info.base_path << ": " << s.ToString();
+  }
+  bgsave_engine_->SetBackupMeta("binlog_filenum", std::to_string(info.offset.b_offset.filenum));
+  bgsave_engine_->SetBackupMeta("binlog_offset", std::to_string(info.offset.b_offset.offset));
+  if (g_pika_conf->consensus_level() != 0) {
+    bgsave_engine_->SetBackupMeta("term", std::to_string(info.offset.l_offset.term));
+    bgsave_engine_->SetBackupMeta("index", std::to_string(info.offset.l_offset.index));
+  }
 
   // Backup to tmp dir
-  rocksdb::Status s = bgsave_engine_->CreateNewBackup(info.path);
+  s = bgsave_engine_->CreateNewBackup(info.path);
 
   if (!s.ok()) {
     LOG(WARNING) << slot_name_ << " create new backup failed :" << s.ToString();
     return false;
   }
   LOG(INFO) << slot_name_ << " create new backup finished.";
+  // the dump of the same day it replaces is not needed any more
+  if (info.base_path == info.path + "_BASE") {
+    pstd::DeleteDirIfExist(info.base_path);
+  }
 
   return true;
 }
@@ -358,6 +415,10 @@ bool Slot::InitBgsaveEnv() {
   bgsave_info_.s_start_time.assign(s_time, len);
   std::string time_sub_path = g_pika_conf->bgsave_prefix() + std::string(s_time, 8);
   bgsave_info_.path = g_pika_conf->bgsave_path() + time_sub_path + "/" + bgsave_sub_path_;
+  bgsave_info_.base_path.clear();
+  if (g_pika_conf->bgsave_incremental()) {
+    bgsave_info_.base_path = FindBgsaveBase(time_sub_path);
+  }
   if (!pstd::DeleteDirIfExist(bgsave_info_.path)) {
     LOG(WARNING) << slot_name_ << " remove exist bgsave dir failed";
     return false;
@@ -371,6 +432,35 @@ bool Slot::InitBgsaveEnv() {
   return true;
 }
 
+// The dump of the same day is kept aside to be the base, or else the latest
+// dump of the days before with a manifest, need bgsave_protector protect
+std::string Slot::FindBgsaveBase(const std::string& time_sub_path) {
+  std::string base_path = bgsave_info_.path + "_BASE";
+  pstd::DeleteDirIfExist(base_path);
+  if (pstd::FileExists(bgsave_info_.path + "/" + storage::BACKUP_MANIFEST) &&
+      pstd::RenameFile(bgsave_info_.path, base_path) == 0) {
+    return base_path;
+  }
+
+  std::string bgsave_prefix = g_pika_conf->bgsave_prefix();
+  std::vector<std::string> dump_dirs;
+  if (pstd::GetChildren(g_pika_conf->bgsave_path(), dump_dirs) != 0) {
+    return "";
+  }
+  std::string latest;
+  for (const auto& dump_dir : dump_dirs) {
+    if (dump_dir.size() != bgsave_prefix.size() + 8 || dump_dir.compare(0, bgsave_prefix.size(), bgsave_prefix) != 0 ||
+        dump_dir >= time_sub_path) {
+      continue;
+    }
+    std::string path = g_pika_conf->bgsave_path() + dump_dir + "/" + bgsave_sub_path_;
+    if (dump_dir > latest && pstd::FileExists(path + "/" + storage::BACKUP_MANIFEST)) {
+      latest = dump_dir;
+    }
+  }
+  return latest.empty() ? "" : g_pika_conf->bgsave_path() + latest + "/" + bgsave_sub_path_;
+}
+
 // Prepare bgsave env, need bgsave_protector protect
 bool Slot::InitBgsaveEngine() {
   bgsave_engine_.reset();
@@ -387,26 +477,71 @@ bool Slot::InitBgsaveEngine() {
     return false;
   }
 
+  if (g_pika_conf->bgsave_pin_sequence() && InitBgsaveEnginePinned(slot)) {
+    return true;
+  }
+
   {
+    uint64_t start_us = pstd::NowMicros();
     std::lock_guard lock(db_rwlock_);
     LogOffset bgsave_offset;
-    if (g_pika_conf->consensus_level() != 0) {
-      bgsave_offset = slot->ConsensusAppliedIndex();
-    } else {
-      // term, index are 0
-      slot->Logger()->GetProducerStatus(&(bgsave_offset.b_offset.filenum), &(bgsave_offset.b_offset.offset));
+    GetBgsaveOffset(slot, &bgsave_offset);
+    s = bgsave_engine_->SetBackupContent();
+    if (!s.ok()) {
+      LOG(WARNING) << slot_name_ << " set backup content failed " << s.ToString();
+      return false;
     }
     {
       std::lock_guard l(bgsave_protector_);
       bgsave_info_.offset = bgsave_offset;
+      bgsave_info_.stall_us = pstd::NowMicros() - start_us;
+      bgsave_info_.avoided_stall_us = 0;
     }
-    s = bgsave_engine_->SetBackupContent();
-    if (!s.ok()) {
-      LOG(WARNING) << slot_name_ << " set backup content failed " << s.ToString();
+  }
+  return true;
+}
+
+// The commands hold db_rwlock_ shared from the write to the dbs to the write
+// to the binlog, so with it held the binlog offset and the sequence numbers
+// of the dbs are of the same point. Only they are taken under it, the files
+// are listed after, without flushing the memtables. A flush between the two
+// makes them to be taken again, false when it goes on
+bool Slot::InitBgsaveEnginePinned(const std::shared_ptr<SyncMasterSlot>& slot) {
+  const int kMaxPinRetries = 3;
+  for (int retry = 0; retry < kMaxPinRetries; retry++) {
+    uint64_t start_us = pstd::NowMicros();
+    LogOffset bgsave_offset;
+    std::map<std::string, uint64_t> sequence_numbers;
+    {
+      std::lock_guard lock(db_rwlock_);
+      GetBgsaveOffset(slot, &bgsave_offset);
+      sequence_numbers = bgsave_engine_->LatestSequenceNumbers();
+    }
+    uint64_t pinned_us = pstd::NowMicros();
+    rocksdb::Status s = bgsave_engine_->SetBackupContentAt(sequence_numbers);
+    if (s.ok()) {
+      std::lock_guard l(bgsave_protector_);
+      bgsave_info_.offset = bgsave_offset;
+      bgsave_info_.stall_us = pinned_us - start_us;
+      bgsave_info_.avoided_stall_us = pstd::NowMicros() - pinned_us;
+      return true;
+    }
+    if (!s.IsBusy()) {
+      LOG(WARNING) << slot_name_ << " set pinned backup content failed " << s.ToString();
       return false;
     }
   }
-  return true;
+  LOG(INFO) << slot_name_ << " flushed while pinning the bgsave, save it with the commands held";
+  return false;
+}
+
+void Slot::GetBgsaveOffset(const std::shared_ptr<SyncMasterSlot>& slot, LogOffset* bgsave_offset) {
+  if (g_pika_conf->consensus_level() != 0) {
+    *bgsave_offset = slot->ConsensusAppliedIndex();
+  } else {
+    // term, index are 0
+    slot->Logger()->GetProducerStatus(&(bgsave_offset->b_offset.filenum), &(bgsave_offset->b_offset.offset));
+  }
 }
 
 void Slot::ClearBgsave() {
@@ -436,7 +571,7 @@ bool Slot::FlushDB() {
   dbpath.append("_deleting/");
   pstd::RenameFile(db_path_, dbpath);
 
-  db_ = std::make_shared<storage::Storage>();
+  db_ = NewSlotStorage(db_name_, lock_mgr_);
   rocksdb::Status s = db_->Open(g_pika_server->storage_options(), db_path_);
   assert(db_);
   assert(s.ok());
@@ -464,7 +599,7 @@ bool Slot::FlushSubDB(const std::string& db_name) {
   std::string del_dbpath = dbpath + db_name + "_deleting";
   pstd::RenameFile(sub_dbpath, del_dbpath);
 
-  db_ = std::make_shared<storage::Storage>();
+  db_ = NewSlotStorage(db_name_, lock_mgr_);
   rocksdb::Status s = db_->Open(g_pika_server->storage_options(), db_path_);
   assert(db_);
   assert(s.ok());
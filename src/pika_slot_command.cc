@@ -5,6 +5,7 @@
 
 #include "include/pika_slot_command.h"
 #include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 #include "include/pika_command.h"
@@ -191,89 +192,55 @@ void PikaMigrate::KillAllMigrateClient() {
   }
 }
 
-/* *
- * do migrate a key-value for slotsmgrt/slotsmgrtone commands
- * return value:
- *    -1 - error happens
- *   >=0 - # of success migration (0 or 1)
- * */
-int PikaMigrate::MigrateKey(const std::string &host, const int port, int timeout, const std::string &key,
-                            const char type, std::string &detail, std::shared_ptr<Slot> slot) {
-  int send_command_num = -1;
-
-  net::NetCli *migrate_cli = GetMigrateClient(host, port, timeout);
-  if (!migrate_cli) {
-    detail = "IOERR error or timeout connecting to the client";
-    LOG(INFO) << "GetMigrateClient failed, key: " << key;
-    return -1;
-  }
+bool MigratePipeline::Append(const net::RedisCmdArgsType &argv) {
+  std::string cmd;
+  net::SerializeRedisCommand(argv, &cmd);
+  return Append(cmd);
+}
 
-  send_command_num = MigrateSend(migrate_cli, key, type, detail, slot);
-  if (send_command_num <= 0) {
-    return send_command_num;
+bool MigratePipeline::Append(const std::string &cmd) {
+  buf_.append(cmd);
+  buffered_++;
+  commands_++;
+  if (buf_.size() < MigrateSendBufSize && buffered_ + in_flight_ < window_) {
+    return true;
   }
-
-  if (MigrateRecv(migrate_cli, send_command_num, detail)) {
-    return send_command_num;
+  if (!Flush()) {
+    return false;
   }
-
-  return -1;
+  // read back to half of the window, the next writes overlap the rest
+  return in_flight_ < window_ || Recv(in_flight_ - window_ / 2);
 }
 
-int PikaMigrate::MigrateSend(net::NetCli *migrate_cli, const std::string &key, const char type, std::string &detail,
-                             const std::shared_ptr<Slot>& slot) {
-  std::string wbuf_str;
-  pstd::Status s;
-  int command_num = -1;
-
-  // chech the client is alive
-  if (!migrate_cli) {
-    return -1;
-  }
-
-  command_num = ParseKey(key, type, wbuf_str, slot);
-  if (command_num < 0) {
-    detail = "ParseKey failed";
-    return command_num;
-  }
+bool MigratePipeline::Drain() { return Flush() && Recv(in_flight_); }
 
-  // don't need seed data, key is not exists
-  if (command_num == 0 || wbuf_str.empty()) {
-    return 0;
+bool MigratePipeline::Flush() {
+  if (buf_.empty()) {
+    return true;
   }
-
-  s = migrate_cli->Send(&wbuf_str);
+  bytes_sent_ += static_cast<int64_t>(buf_.size());
+  pstd::Status s = cli_->Send(&buf_);
   if (!s.ok()) {
     LOG(ERROR) << "Connect slots target, Send error: " << s.ToString();
-    detail = "Connect slots target, Send error: " + s.ToString();
-    KillMigrateClient(migrate_cli);
-    return -1;
-  }
-
-  return command_num;
-}
-
-bool PikaMigrate::MigrateRecv(net::NetCli *migrate_cli, int need_receive, std::string &detail) {
-  pstd::Status s;
-  std::string reply;
-  int64_t ret;
-
-  if (NULL == migrate_cli || need_receive < 0) {
+    error_ = "Connect slots target, Send error: " + s.ToString();
     return false;
   }
+  buf_.clear();
+  in_flight_ += buffered_;
+  buffered_ = 0;
+  return true;
+}
 
+bool MigratePipeline::Recv(int64_t num) {
   net::RedisCmdArgsType argv;
-  while (need_receive) {
-    s = migrate_cli->Recv(&argv);
+  for (; num > 0; num--) {
+    pstd::Status s = cli_->Recv(&argv);
     if (!s.ok()) {
       LOG(ERROR) << "Connect slots target, Recv error: " << s.ToString();
-      detail = "Connect slots target, Recv error: " + s.ToString();
-      KillMigrateClient(migrate_cli);
+      error_ = "Connect slots target, Recv error: " + s.ToString();
       return false;
     }
-
-    reply = argv[0];
-    need_receive--;
+    in_flight_--;
 
     // set   return ok
     // zadd  return number
@@ -281,47 +248,74 @@ bool PikaMigrate::MigrateRecv(net::NetCli *migrate_cli, int need_receive, std::s
     // hmset return ok
     // sadd  return number
     // rpush return length
-    if (argv.size() == 1 &&
-        (kInnerReplOk == pstd::StringToLower(reply) || pstd::string2int(reply.data(), reply.size(), &ret))) {
-      // continue reiceve response
-      if (need_receive > 0) {
-        continue;
-      }
-
-      // has got all responses
-      break;
+    // del and expire return number
+    // hexpireat return a number for each field
+    std::string reply = argv.empty() ? "" : argv[0];
+    int64_t ret;
+    bool numbers = !argv.empty() && std::all_of(argv.begin(), argv.end(), [&ret](const std::string &arg) {
+      return pstd::string2int(arg.data(), arg.size(), &ret) != 0;
+    });
+    if (!numbers && (argv.size() != 1 || kInnerReplOk != pstd::StringToLower(reply))) {
+      error_ = "something wrong with slots migrate, reply: " + reply;
+      LOG(ERROR) << "something wrong with slots migrate, reply:" << reply;
+      return false;
     }
+  }
+  return true;
+}
 
-    // failed
-    detail = "something wrong with slots migrate, reply: " + reply;
-    LOG(ERROR) << "something wrong with slots migrate, reply:" << reply;
-    return false;
+/* *
+ * do migrate a key-value for slotsmgrt/slotsmgrtone commands
+ * return value:
+ *    -1 - error happens
+ *   >=0 - # of success migration (0 or 1)
+ * */
+int PikaMigrate::MigrateKey(const std::string &host, const int port, int timeout, const std::string &key,
+                            const char type, std::string &detail, std::shared_ptr<Slot> slot) {
+  int send_command_num = -1;
+
+  net::NetCli *migrate_cli = GetMigrateClient(host, port, timeout);
+  if (!migrate_cli) {
+    detail = "IOERR error or timeout connecting to the client";
+    LOG(INFO) << "GetMigrateClient failed, key: " << key;
+    return -1;
   }
 
-  return true;
+  MigratePipeline pipeline(migrate_cli, g_pika_conf->slotmigrate_pipeline_window());
+  send_command_num = ParseKey(key, type, &pipeline, slot);
+  // the commands of a key gone in the middle are undone by a DEL, wait for it too
+  if (send_command_num >= 0 && pipeline.Drain()) {
+    return send_command_num;
+  }
+
+  // the replies of what was sent are not read, the connection can't be reused
+  detail = pipeline.error().empty() ? "ParseKey failed" : pipeline.error();
+  KillMigrateClient(migrate_cli);
+  return -1;
 }
 
 // return -1 is error; 0 don't migrate; >0 the number of commond
-int PikaMigrate::ParseKey(const std::string &key, const char type, std::string &wbuf_str, const std::shared_ptr<Slot>& slot) {
+int PikaMigrate::ParseKey(const std::string &key, const char type, MigratePipeline *pipeline,
+                          const std::shared_ptr<Slot>& slot) {
   int command_num = -1;
   int64_t ttl = 0;
   rocksdb::Status s;
 
   switch (type) {
     case 'k':
-      command_num = ParseKKey(key, wbuf_str, slot);
+      command_num = ParseKKey(key, pipeline, slot);
       break;
     case 'h':
-      command_num = ParseHKey(key, wbuf_str, slot);
+      command_num = ParseHKey(key, pipeline, slot);
       break;
     case 'l':
-      command_num = ParseLKey(key, wbuf_str, slot);
+      command_num = ParseLKey(key, pipeline, slot);
       break;
     case 'z':
-      command_num = ParseZKey(key, wbuf_str, slot);
+      command_num = ParseZKey(key, pipeline, slot);
       break;
     case 's':
-      command_num = ParseSKey(key, wbuf_str, slot);
+      command_num = ParseSKey(key, pipeline, slot);
       break;
     default:
       LOG(INFO) << "ParseKey key[" << key << "], the type[" << type << "] is not support.";
@@ -348,26 +342,19 @@ int PikaMigrate::ParseKey(const std::string &key, const char type, std::string &
     return command_num;
   }
 
-  // key is expired or not exist, don't migrate
+  // key is expired or not exist, drop what has been sent
   if (ttl == 0 or ttl == -2) {
-    wbuf_str.clear();
-    return 0;
+    return pipeline->Append(net::RedisCmdArgsType{"DEL", key}) ? 0 : -1;
   }
 
   // no kv, because kv cmd: SET key value ttl
-  if (SetTTL(key, wbuf_str, ttl)) {
-    command_num += 1;
+  if (!SetTTL(key, pipeline, ttl)) {
+    return -1;
   }
-
-  return command_num;
+  return command_num + 1;
 }
 
-bool PikaMigrate::SetTTL(const std::string &key, std::string &wbuf_str, int64_t ttl) {
-  //-1 indicates the key is valid forever
-  if (ttl == -1) {
-    return false;
-  }
-
+bool PikaMigrate::SetTTL(const std::string &key, MigratePipeline *pipeline, int64_t ttl) {
   // if ttl = -2 indicates, the key is not existed
   if (ttl < 0) {
     LOG(INFO) << "SetTTL key[" << key << "], ttl is " << ttl;
@@ -375,22 +362,15 @@ bool PikaMigrate::SetTTL(const std::string &key, std::string &wbuf_str, int64_t
   }
 
   net::RedisCmdArgsType argv;
-  std::string cmd;
-
   argv.push_back("EXPIRE");
   argv.push_back(key);
   argv.push_back(std::to_string(ttl));
-
-  net::SerializeRedisCommand(argv, &cmd);
-  wbuf_str.append(cmd);
-
-  return true;
+  return pipeline->Append(argv);
 }
 
 // return -1 is error; 0 don't migrate; >0 the number of commond
-int PikaMigrate::ParseKKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot) {
+int PikaMigrate::ParseKKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot) {
   net::RedisCmdArgsType argv;
-  std::string cmd;
   std::string value;
   int64_t ttl = 0;
   rocksdb::Status s;
@@ -416,7 +396,6 @@ int PikaMigrate::ParseKKey(const std::string &key, std::string &wbuf_str, const
   // key is expired or not exist, dont migrate
   // todo check ttl
   if (ttl == 0 || ttl == -2) {
-    wbuf_str.clear();
     return 0;
   }
 
@@ -424,9 +403,7 @@ int PikaMigrate::ParseKKey(const std::string &key, std::string &wbuf_str, const
     argv.push_back("EX");
     argv.push_back(std::to_string(ttl));
   }
-  net::SerializeRedisCommand(argv, &cmd);
-  wbuf_str.append(cmd);
-  return 1;
+  return pipeline->Append(argv) ? 1 : -1;
 }
 
 int64_t PikaMigrate::TTLByType(const char key_type, const std::string &key, const std::shared_ptr<Slot>& slot) {
@@ -455,7 +432,48 @@ int64_t PikaMigrate::TTLByType(const char key_type, const std::string &key, cons
   }
 }
 
-int PikaMigrate::ParseZKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot) {
+// The key is gone after command_num of its commands were sent, the partial
+// key on the target is deleted
+static int DropPartialKey(const std::string &key, int command_num, MigratePipeline *pipeline) {
+  if (command_num == 0) {
+    return 0;
+  }
+  return pipeline->Append(net::RedisCmdArgsType{"DEL", key}) ? 0 : -1;
+}
+
+// The expires of the fields are sent by HEXPIREAT, as to the replicas,
+// returns the number of commands sent, -1 on error
+static int AppendFieldExpires(const std::string &key, const std::vector<storage::FieldValue> &field_values,
+                              MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot) {
+  std::vector<std::string> fields;
+  for (const auto &field_value : field_values) {
+    fields.push_back(field_value.field);
+  }
+  std::vector<int64_t> ttls;
+  rocksdb::Status s = slot->db()->HTTL(key, fields, &ttls);
+  if (!s.ok() && !s.IsNotFound()) {
+    return -1;
+  }
+
+  std::map<int64_t, std::vector<std::string>> timestamp_fields;
+  int64_t now = time(nullptr);
+  for (size_t idx = 0; idx < ttls.size(); ++idx) {
+    if (ttls[idx] > 0) {
+      timestamp_fields[now + ttls[idx]].push_back(fields[idx]);
+    }
+  }
+  for (const auto &[timestamp, expire_fields] : timestamp_fields) {
+    net::RedisCmdArgsType argv{"HEXPIREAT", key, std::to_string(timestamp), "FIELDS",
+                               std::to_string(expire_fields.size())};
+    argv.insert(argv.end(), expire_fields.begin(), expire_fields.end());
+    if (!pipeline->Append(argv)) {
+      return -1;
+    }
+  }
+  return static_cast<int>(timestamp_fields.size());
+}
+
+int PikaMigrate::ParseZKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot) {
   int command_num = 0;
 
   int64_t next_cursor = 0;
@@ -469,23 +487,23 @@ int PikaMigrate::ParseZKey(const std::string &key, std::string &wbuf_str, const
       }
 
       net::RedisCmdArgsType argv;
-      std::string cmd;
       argv.push_back("ZADD");
       argv.push_back(key);
 
       for (const auto &score_member : score_members) {
-        argv.push_back(std::to_string(score_member.score));
+        char buf[32];
+        int len = pstd::d2string(buf, sizeof(buf), score_member.score);
+        argv.emplace_back(buf, len);
         argv.push_back(score_member.member);
       }
 
-      net::SerializeRedisCommand(argv, &cmd);
-      wbuf_str.append(cmd);
+      if (!pipeline->Append(argv)) {
+        return -1;
+      }
       command_num++;
     } else if (s.IsNotFound()) {
-      wbuf_str.clear();
-      return 0;
+      return DropPartialKey(key, command_num, pipeline);
     } else {
-      wbuf_str.clear();
       return -1;
     }
   } while (next_cursor > 0);
@@ -494,7 +512,7 @@ int PikaMigrate::ParseZKey(const std::string &key, std::string &wbuf_str, const
 }
 
 // return -1 is error; 0 don't migrate; >0 the number of commond
-int PikaMigrate::ParseHKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot) {
+int PikaMigrate::ParseHKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot) {
   int64_t next_cursor = 0;
   int command_num = 0;
   std::vector<storage::FieldValue> field_values;
@@ -507,7 +525,6 @@ int PikaMigrate::ParseHKey(const std::string &key, std::string &wbuf_str, const
       }
 
       net::RedisCmdArgsType argv;
-      std::string cmd;
       argv.push_back("HMSET");
       argv.push_back(key);
 
@@ -516,14 +533,19 @@ int PikaMigrate::ParseHKey(const std::string &key, std::string &wbuf_str, const
         argv.push_back(field_value.value);
       }
 
-      net::SerializeRedisCommand(argv, &cmd);
-      wbuf_str.append(cmd);
+      if (!pipeline->Append(argv)) {
+        return -1;
+      }
       command_num++;
+
+      int expire_num = AppendFieldExpires(key, field_values, pipeline, slot);
+      if (expire_num < 0) {
+        return -1;
+      }
+      command_num += expire_num;
     } else if (s.IsNotFound()) {
-      wbuf_str.clear();
-      return 0;
+      return DropPartialKey(key, command_num, pipeline);
     } else {
-      wbuf_str.clear();
       return -1;
     }
   } while (next_cursor > 0);
@@ -532,7 +554,7 @@ int PikaMigrate::ParseHKey(const std::string &key, std::string &wbuf_str, const
 }
 
 // return -1 is error; 0 don't migrate; >0 the number of commond
-int PikaMigrate::ParseSKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot) {
+int PikaMigrate::ParseSKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot) {
   int command_num = 0;
   int64_t next_cursor = 0;
   std::vector<std::string> members;
@@ -547,7 +569,6 @@ int PikaMigrate::ParseSKey(const std::string &key, std::string &wbuf_str, const
       }
 
       net::RedisCmdArgsType argv;
-      std::string cmd;
       argv.push_back("SADD");
       argv.push_back(key);
 
@@ -555,14 +576,13 @@ int PikaMigrate::ParseSKey(const std::string &key, std::string &wbuf_str, const
         argv.push_back(member);
       }
 
-      net::SerializeRedisCommand(argv, &cmd);
-      wbuf_str.append(cmd);
+      if (!pipeline->Append(argv)) {
+        return -1;
+      }
       command_num++;
     } else if (s.IsNotFound()) {
-      wbuf_str.clear();
-      return 0;
+      return DropPartialKey(key, command_num, pipeline);
     } else {
-      wbuf_str.clear();
       return -1;
     }
   } while (next_cursor > 0);
@@ -571,21 +591,11 @@ int PikaMigrate::ParseSKey(const std::string &key, std::string &wbuf_str, const
 }
 
 // return -1 is error; 0 don't migrate; >0 the number of commond
-int PikaMigrate::ParseLKey(const std::string &key, std::string &wbuf_str, const std::shared_ptr<Slot>& slot) {
+int PikaMigrate::ParseLKey(const std::string &key, MigratePipeline *pipeline, const std::shared_ptr<Slot>& slot) {
   int64_t left = 0;
   int command_num = 0;
   std::vector<std::string> values;
 
-  net::RedisCmdArgsType argv;
-  std::string cmd;
-
-  // del old key, before migrate list; prevent redo when failed
-  argv.push_back("DEL");
-  argv.push_back(key);
-  net::SerializeRedisCommand(argv, &cmd);
-  wbuf_str.append(cmd);
-  command_num++;
-
   do {
     values.clear();
     rocksdb::Status s = slot->db()->LRange(key, left, left + (MAX_MEMBERS_NUM - 1), &values);
@@ -594,9 +604,15 @@ int PikaMigrate::ParseLKey(const std::string &key, std::string &wbuf_str, const
         break;
       }
 
-      net::RedisCmdArgsType argv;
-      std::string cmd;
+      // del old key, before migrate list; prevent redo when failed
+      if (command_num == 0) {
+        if (!pipeline->Append(net::RedisCmdArgsType{"DEL", key})) {
+          return -1;
+        }
+        command_num++;
+      }
 
+      net::RedisCmdArgsType argv;
       argv.push_back("RPUSH");
       argv.push_back(key);
 
@@ -604,25 +620,19 @@ int PikaMigrate::ParseLKey(const std::string &key, std::string &wbuf_str, const
         argv.push_back(value);
       }
 
-      net::SerializeRedisCommand(argv, &cmd);
-      wbuf_str.append(cmd);
+      if (!pipeline->Append(argv)) {
+        return -1;
+      }
       command_num++;
 
       left += MAX_MEMBERS_NUM;
     } else if (s.IsNotFound()) {
-      wbuf_str.clear();
-      return 0;
+      return DropPartialKey(key, command_num, pipeline);
     } else {
-      wbuf_str.clear();
       return -1;
     }
   } while (!values.empty());
 
-  if (command_num == 1) {
-    wbuf_str.clear();
-    command_num = 0;
-  }
-
   return command_num;
 }
 
@@ -1433,8 +1443,10 @@ void SlotsMgrtAsyncStatusCmd::Do(std::shared_ptr<Slot> slot) {
   int64_t port = -1, slots = -1, moved = -1, remained = -1;
   bool migrating;
   g_pika_server->GetSlotsMgrtSenderStatus(&ip, &port, &slots, &migrating, &moved, &remained);
+  int64_t bytes = 0, elapsed_ms = 0;
+  g_pika_server->GetSlotsMgrtSenderThroughput(&bytes, &elapsed_ms);
   std::string mstatus = migrating ? "yes" : "no";
-  res_.AppendArrayLen(5);
+  res_.AppendArrayLen(7);
   status = "dest server: " + ip + ":" + std::to_string(port);
   res_.AppendStringLen(status.size());
   res_.AppendContent(status);
@@ -1450,6 +1462,14 @@ void SlotsMgrtAsyncStatusCmd::Do(std::shared_ptr<Slot> slot) {
   status = "remain keys: " + std::to_string(remained);
   res_.AppendStringLen(status.size());
   res_.AppendContent(status);
+  status = "sent bytes : " + std::to_string(bytes);
+  res_.AppendStringLen(status.size());
+  res_.AppendContent(status);
+  int64_t elapsed = std::max<int64_t>(elapsed_ms, 1);
+  status = "throughput : " + std::to_string(std::max<int64_t>(moved, 0) * 1000 / elapsed) + " keys/s, " + std::to_string(bytes / elapsed) +
+           " KB/s";
+  res_.AppendStringLen(status.size());
+  res_.AppendContent(status);
 
   return;
 }
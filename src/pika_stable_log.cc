@@ -124,6 +124,7 @@ bool StableLog::PurgeFiles(uint32_t to, bool manual) {
     }
   }
   if (delete_num != 0) {
+    stable_logger_->UpdateArchivedSize();
     std::map<uint32_t, std::string> binlogs;
     if (!GetBinlogFiles(&binlogs)) {
       LOG(WARNING) << log_path_ << " Could not get binlog files!";
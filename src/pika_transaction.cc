@@ -0,0 +1,270 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_transaction.h"
+
+#include <glog/logging.h>
+
+#include "include/pika_binlog_transverter.h"
+#include "include/pika_client_conn.h"
+#include "include/pika_cmd_table_manager.h"
+#include "include/pika_conf.h"
+#include "include/pika_list.h"
+#include "include/pika_server.h"
+#include "net/include/redis_parser.h"
+
+extern std::unique_ptr<PikaConf> g_pika_conf;
+extern PikaServer* g_pika_server;
+extern std::unique_ptr<PikaCmdTableManager> g_pika_cmd_table_manager;
+
+void MultiCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameMulti);
+    return;
+  }
+  // the commands would be logged before EXEC runs them
+  if (g_pika_conf->consensus_level() != 0) {
+    res_.SetRes(CmdRes::kErrOther, name_ + " is not supported when consensus is on");
+    return;
+  }
+}
+
+void MultiCmd::Do(std::shared_ptr<Slot> slot) {
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (!conn) {
+    res_.SetRes(CmdRes::kErrOther, kCmdNameMulti);
+    LOG(WARNING) << name_ << " weak ptr is empty";
+    return;
+  }
+  if (conn->InMulti()) {
+    res_.SetRes(CmdRes::kErrOther, "MULTI calls can not be nested");
+    return;
+  }
+  conn->StartMulti();
+  res_.SetRes(CmdRes::kOk);
+}
+
+void ExecCmd::DoInitial() {
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (!conn) {
+    InitialReplay();
+    return;
+  }
+  if (argv_.size() != 1) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameExec);
+    return;
+  }
+  if (!conn->InMulti()) {
+    res_.SetRes(CmdRes::kErrOther, "EXEC without MULTI");
+    return;
+  }
+  if (!conn->EndMulti(&cmds_)) {
+    conn->UnwatchKeys();
+    res_.SetRes(CmdRes::kExecAbort);
+    return;
+  }
+  watch_flag_ = conn->watch_flag();
+  for (const auto& [db_name, key] : conn->watched_keys()) {
+    if (db_name == db_name_) {
+      watched_keys_.push_back(key);
+    }
+  }
+}
+
+static int CollectArgv(net::RedisParser* parser, const net::RedisCmdArgsType& argv) {
+  static_cast<std::vector<PikaCmdArgsType>*>(parser->data)->push_back(argv);
+  return 0;
+}
+
+void ExecCmd::InitialReplay() {
+  std::vector<PikaCmdArgsType> argvs;
+  net::RedisParserSettings settings;
+  settings.DealMessage = &CollectArgv;
+  net::RedisParser parser;
+  parser.RedisParserInit(REDIS_PARSER_REQUEST, settings);
+  parser.data = &argvs;
+  for (size_t i = 1; i < argv_.size(); i++) {
+    int processed_len = 0;
+    net::RedisParserStatus ret =
+        parser.ProcessInputBuffer(argv_[i].data(), static_cast<int>(argv_[i].size()), &processed_len);
+    if (ret != net::kRedisParserDone) {
+      res_.SetRes(CmdRes::kErrOther, "invalid command in the binlog of exec");
+      return;
+    }
+    binlogs_.push_back(argv_[i]);
+  }
+
+  for (const auto& argv : argvs) {
+    std::string opt = argv[0];
+    std::shared_ptr<Cmd> cmd = g_pika_cmd_table_manager->GetCmd(pstd::StringToLower(opt));
+    if (!cmd) {
+      res_.SetRes(CmdRes::kErrOther, "unknown command " + argv[0] + " in the binlog of exec");
+      return;
+    }
+    cmd->Initial(argv, db_name_);
+    if (!cmd->res().ok()) {
+      res_.SetRes(CmdRes::kErrOther, "invalid " + argv[0] + " in the binlog of exec");
+      return;
+    }
+    cmds_.push_back(cmd);
+  }
+  replay_ = true;
+}
+
+std::vector<std::string> ExecCmd::current_key() const {
+  // a write to a watched key waits until EXEC is done, or is seen by it
+  std::vector<std::string> keys = watched_keys_;
+  for (const auto& cmd : cmds_) {
+    std::vector<std::string> cmd_keys = cmd->current_key();
+    keys.insert(keys.end(), cmd_keys.begin(), cmd_keys.end());
+  }
+  if (keys.empty()) {
+    keys.emplace_back("");
+  }
+  return keys;
+}
+
+void ExecCmd::Do(std::shared_ptr<Slot> slot) {
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (watch_flag_ && watch_flag_->load()) {
+    // a watched key was written after WATCH, nothing is run
+    res_.AppendArrayLen(-1);
+    if (conn) {
+      conn->UnwatchKeys();
+    }
+    return;
+  }
+
+  storage::BatchWriteScope scope;
+  {
+    Cmd::BinlogCapture capture(&binlogs_);
+    for (const auto& cmd : cmds_) {
+      cmd->res().clear();
+      cmd->Do(slot);
+      if (cmd->is_blocked()) {
+        // there is no waiting inside a transaction
+        std::static_pointer_cast<BlockingPopCmd>(cmd)->ReplyTimeout();
+      }
+      if (!replay_) {
+        cmd->DoBinlog(nullptr);
+      }
+    }
+  }
+  rocksdb::Status s = scope.Commit();
+  if (!s.ok()) {
+    // nothing was written, a commit failing half way aborts the process
+    binlogs_.clear();
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+  } else {
+    res_.AppendArrayLen(static_cast<int64_t>(cmds_.size()));
+    for (const auto& cmd : cmds_) {
+      res_.AppendStringRaw(cmd->res().message());
+    }
+  }
+  if (conn) {
+    conn->UnwatchKeys();
+  }
+}
+
+void ExecCmd::TouchWatchedKeys() {
+  for (const auto& cmd : cmds_) {
+    if (cmd->is_write() && cmd->res().ok()) {
+      g_pika_server->TouchKeys(db_name_, cmd->current_key(), GetConn());
+    }
+  }
+}
+
+void ExecCmd::DoBinlog(const std::shared_ptr<SyncMasterSlot>& slot) {
+  // nothing was written
+  if (binlogs_.empty()) {
+    return;
+  }
+  Cmd::DoBinlog(slot);
+}
+
+std::string ExecCmd::ToBinlog(uint32_t exec_time, uint32_t term_id, uint64_t logic_id, uint32_t filenum,
+                              uint64_t offset) {
+  return ExecBinlog(binlogs_, exec_time, term_id, logic_id, filenum, offset);
+}
+
+std::string ExecCmd::ExecBinlog(const std::vector<std::string>& binlogs, uint32_t exec_time, uint32_t term_id,
+                                uint64_t logic_id, uint32_t filenum, uint64_t offset) {
+  std::string content;
+  content.reserve(RAW_ARGS_LEN);
+  RedisAppendLen(content, static_cast<int64_t>(binlogs.size()) + 1, "*");
+  RedisAppendLen(content, kCmdNameExec.size(), "$");
+  RedisAppendContent(content, kCmdNameExec);
+  for (const auto& binlog : binlogs) {
+    RedisAppendLen(content, binlog.size(), "$");
+    RedisAppendContent(content, binlog);
+  }
+  return PikaBinlogTransverter::BinlogEncode(BinlogType::TypeFirst, exec_time, term_id, logic_id, filenum, offset,
+                                             content, {});
+}
+
+void DiscardCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameDiscard);
+    return;
+  }
+}
+
+void DiscardCmd::Do(std::shared_ptr<Slot> slot) {
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (!conn) {
+    res_.SetRes(CmdRes::kErrOther, kCmdNameDiscard);
+    LOG(WARNING) << name_ << " weak ptr is empty";
+    return;
+  }
+  if (!conn->InMulti()) {
+    res_.SetRes(CmdRes::kErrOther, "DISCARD without MULTI");
+    return;
+  }
+  std::vector<std::shared_ptr<Cmd>> cmds;
+  conn->EndMulti(&cmds);
+  conn->UnwatchKeys();
+  res_.SetRes(CmdRes::kOk);
+}
+
+void WatchCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameWatch);
+    return;
+  }
+  keys_.assign(argv_.begin() + 1, argv_.end());
+}
+
+void WatchCmd::Do(std::shared_ptr<Slot> slot) {
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (!conn) {
+    res_.SetRes(CmdRes::kErrOther, kCmdNameWatch);
+    LOG(WARNING) << name_ << " weak ptr is empty";
+    return;
+  }
+  if (conn->InMulti()) {
+    res_.SetRes(CmdRes::kErrOther, "WATCH inside MULTI is not allowed");
+    return;
+  }
+  conn->WatchKeys(db_name_, keys_);
+  res_.SetRes(CmdRes::kOk);
+}
+
+void UnWatchCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameUnWatch);
+    return;
+  }
+}
+
+void UnWatchCmd::Do(std::shared_ptr<Slot> slot) {
+  std::shared_ptr<PikaClientConn> conn = std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (!conn) {
+    res_.SetRes(CmdRes::kErrOther, kCmdNameUnWatch);
+    LOG(WARNING) << name_ << " weak ptr is empty";
+    return;
+  }
+  conn->UnwatchKeys();
+  res_.SetRes(CmdRes::kOk);
+}
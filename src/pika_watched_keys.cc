@@ -0,0 +1,93 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_watched_keys.h"
+
+#include <algorithm>
+
+std::string PikaWatchedKeys::DBKey(const std::string& db_name, const std::string& key) {
+  std::string db_key;
+  db_key.reserve(db_name.size() + 1 + key.size());
+  db_key.append(db_name);
+  db_key.push_back('\0');
+  db_key.append(key);
+  return db_key;
+}
+
+void PikaWatchedKeys::Watch(const std::string& db_name, const std::string& key, const Flag& flag) {
+  std::lock_guard l(mu_);
+  std::vector<Flag>& flags = keys_[DBKey(db_name, key)];
+  if (std::find(flags.begin(), flags.end(), flag) != flags.end()) {
+    return;
+  }
+  flags.push_back(flag);
+  num_watched_++;
+}
+
+void PikaWatchedKeys::Unwatch(const std::string& db_name, const std::string& key, const Flag& flag) {
+  std::lock_guard l(mu_);
+  auto iter = keys_.find(DBKey(db_name, key));
+  if (iter == keys_.end()) {
+    return;
+  }
+  auto flag_iter = std::find(iter->second.begin(), iter->second.end(), flag);
+  if (flag_iter == iter->second.end()) {
+    return;
+  }
+  iter->second.erase(flag_iter);
+  if (iter->second.empty()) {
+    keys_.erase(iter);
+  }
+  num_watched_--;
+}
+
+void PikaWatchedKeys::Touch(const std::string& db_name, const std::vector<std::string>& keys) {
+  if (num_watched_.load() == 0) {
+    return;
+  }
+  std::lock_guard l(mu_);
+  for (const auto& key : keys) {
+    auto iter = keys_.find(DBKey(db_name, key));
+    if (iter == keys_.end()) {
+      continue;
+    }
+    for (const auto& flag : iter->second) {
+      flag->store(true);
+    }
+  }
+}
+
+void PikaWatchedKeys::TouchAll(const std::string& db_name) {
+  if (num_watched_.load() == 0) {
+    return;
+  }
+  std::string prefix = db_name.empty() ? "" : DBKey(db_name, "");
+  std::lock_guard l(mu_);
+  for (const auto& [db_key, flags] : keys_) {
+    if (db_key.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    for (const auto& flag : flags) {
+      flag->store(true);
+    }
+  }
+}
+
+std::vector<std::pair<std::string, std::string>> PikaWatchedKeys::WatchedKeys(const std::string& db_name) {
+  std::vector<std::pair<std::string, std::string>> watched;
+  if (num_watched_.load() == 0) {
+    return watched;
+  }
+  std::string prefix = db_name.empty() ? "" : DBKey(db_name, "");
+  std::lock_guard l(mu_);
+  for (const auto& [db_key, flags] : keys_) {
+    if (db_key.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    size_t pos = db_key.find('\0');
+    watched.emplace_back(db_key.substr(0, pos), db_key.substr(pos + 1));
+  }
+  return watched;
+}
@@ -10,6 +10,22 @@
 
 #include "pstd/include/pstd_string.h"
 
+// The length of a WITHSCORES reply of count members, RESP3 has a pair of
+// the member and its score for each
+static void AppendScoreMembersLen(CmdRes& res, int64_t count) {
+  res.AppendArrayLen(res.resp_version() == 3 ? count : count * 2);
+}
+
+static void AppendScoreMember(CmdRes& res, const storage::ScoreMember& sm) {
+  char buf[32];
+  int64_t len = pstd::d2string(buf, sizeof(buf), sm.score);
+  if (res.resp_version() == 3) {
+    res.AppendArrayLen(2);
+  }
+  res.AppendString(sm.member);
+  res.AppendDouble(std::string(buf, len));
+}
+
 void ZAddCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameZAdd);
@@ -143,8 +159,7 @@ void ZIncrbyCmd::Do(std::shared_ptr<Slot> slot) {
   if (s.ok()) {
     char buf[32];
     int64_t len = pstd::d2string(buf, sizeof(buf), score);
-    res_.AppendStringLen(len);
-    res_.AppendContent(buf);
+    res_.AppendDouble(std::string(buf, len));
     AddSlotKey("z", key_, slot);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
@@ -182,15 +197,9 @@ void ZRangeCmd::Do(std::shared_ptr<Slot> slot) {
   rocksdb::Status s = slot->db()->ZRange(key_, start_, stop_, &score_members);
   if (s.ok() || s.IsNotFound()) {
     if (is_ws_) {
-      char buf[32];
-      int64_t len;
-      res_.AppendArrayLen(score_members.size() * 2);
+      AppendScoreMembersLen(res_, score_members.size());
       for (const auto& sm : score_members) {
-        res_.AppendStringLen(sm.member.size());
-        res_.AppendContent(sm.member);
-        len = pstd::d2string(buf, sizeof(buf), sm.score);
-        res_.AppendStringLen(len);
-        res_.AppendContent(buf);
+        AppendScoreMember(res_, sm);
       }
     } else {
       res_.AppendArrayLen(score_members.size());
@@ -217,15 +226,9 @@ void ZRevrangeCmd::Do(std::shared_ptr<Slot> slot) {
   rocksdb::Status s = slot->db()->ZRevrange(key_, start_, stop_, &score_members);
   if (s.ok() || s.IsNotFound()) {
     if (is_ws_) {
-      char buf[32];
-      int64_t len;
-      res_.AppendArrayLen(score_members.size() * 2);
+      AppendScoreMembersLen(res_, score_members.size());
       for (const auto& sm : score_members) {
-        res_.AppendStringLen(sm.member.size());
-        res_.AppendContent(sm.member);
-        len = pstd::d2string(buf, sizeof(buf), sm.score);
-        res_.AppendStringLen(len);
-        res_.AppendContent(buf);
+        AppendScoreMember(res_, sm);
       }
     } else {
       res_.AppendArrayLen(score_members.size());
@@ -335,15 +338,9 @@ void ZRangebyscoreCmd::Do(std::shared_ptr<Slot> slot) {
   size_t index = offset_;
   size_t end = offset_ + count_;
   if (with_scores_) {
-    char buf[32];
-    int64_t len;
-    res_.AppendArrayLen(count_ * 2);
+    AppendScoreMembersLen(res_, count_);
     for (; index < end; index++) {
-      res_.AppendStringLen(score_members[index].member.size());
-      res_.AppendContent(score_members[index].member);
-      len = pstd::d2string(buf, sizeof(buf), score_members[index].score);
-      res_.AppendStringLen(len);
-      res_.AppendContent(buf);
+      AppendScoreMember(res_, score_members[index]);
     }
   } else {
     res_.AppendArrayLen(count_);
@@ -387,15 +384,9 @@ void ZRevrangebyscoreCmd::Do(std::shared_ptr<Slot> slot) {
   int64_t index = offset_;
   int64_t end = offset_ + count_;
   if (with_scores_) {
-    char buf[32];
-    int64_t len;
-    res_.AppendArrayLen(count_ * 2);
+    AppendScoreMembersLen(res_, count_);
     for (; index < end; index++) {
-      res_.AppendStringLen(score_members[index].member.size());
-      res_.AppendContent(score_members[index].member);
-      len = pstd::d2string(buf, sizeof(buf), score_members[index].score);
-      res_.AppendStringLen(len);
-      res_.AppendContent(buf);
+      AppendScoreMember(res_, score_members[index]);
     }
   } else {
     res_.AppendArrayLen(count_);
@@ -569,7 +560,7 @@ void ZRankCmd::Do(std::shared_ptr<Slot> slot) {
   if (s.ok()) {
     res_.AppendInteger(rank);
   } else if (s.IsNotFound()) {
-    res_.AppendContent("$-1");
+    res_.AppendStringLen(-1);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
@@ -589,7 +580,7 @@ void ZRevrankCmd::Do(std::shared_ptr<Slot> slot) {
   if (s.ok()) {
     res_.AppendInteger(revrank);
   } else if (s.IsNotFound()) {
-    res_.AppendContent("$-1");
+    res_.AppendStringLen(-1);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
@@ -610,10 +601,9 @@ void ZScoreCmd::Do(std::shared_ptr<Slot> slot) {
   if (s.ok()) {
     char buf[32];
     int64_t len = pstd::d2string(buf, sizeof(buf), score);
-    res_.AppendStringLen(len);
-    res_.AppendContent(buf);
+    res_.AppendDouble(std::string(buf, len));
   } else if (s.IsNotFound()) {
-    res_.AppendContent("$-1");
+    res_.AppendStringLen(-1);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
@@ -882,8 +872,7 @@ void ZPopmaxCmd::Do(std::shared_ptr<Slot> slot) {
     for (const auto& sm : score_members) {
       res_.AppendString(sm.member);
       len = pstd::d2string(buf, sizeof(buf), sm.score);
-      res_.AppendStringLen(len);
-      res_.AppendContent(buf);
+      res_.AppendDouble(std::string(buf, len));
     }
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
@@ -916,8 +905,7 @@ void ZPopminCmd::Do(std::shared_ptr<Slot> slot) {
     for (const auto& sm : score_members) {
       res_.AppendString(sm.member);
       len = pstd::d2string(buf, sizeof(buf), sm.score);
-      res_.AppendStringLen(len);
-      res_.AppendContent(buf);
+      res_.AppendDouble(std::string(buf, len));
     }
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
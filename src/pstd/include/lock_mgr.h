@@ -6,8 +6,11 @@
 #ifndef __SRC_LOCK_MGR_H__
 #define __SRC_LOCK_MGR_H__
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
-#include <string>
+#include <mutex>
+#include <string_view>
 
 #include "pstd/include/mutex.h"
 #include "pstd/include/noncopyable.h"
@@ -15,41 +18,58 @@
 namespace pstd {
 
 namespace lock {
-struct LockMap;
-struct LockMapStripe;
 
+/*
+ * LockMgr locks keys by the stripe they hash to, no key is copied or stored,
+ * so locking never allocates. Two keys sharing a stripe are serialized.
+ *
+ * A stripe is owned by one thread and is reentrant: a thread locking a stripe
+ * it already holds only bumps the depth. This lets the command layer lock the
+ * keys of a write once and the storage layer lock the same keys again below
+ * it for free, as long as both share the LockMgr.
+ *
+ * Waiters spin a few rounds first and park on the stripe condvar after that.
+ * Locks of several stripes must be taken in ascending stripe order, see
+ * MultiRecordLock.
+ */
 class LockMgr : public pstd::noncopyable {
  public:
-  LockMgr(size_t default_num_stripes, int64_t max_num_locks, const std::shared_ptr<MutexFactory>& factory);
+  static const size_t kDefaultNumStripes = 1024;
+  static const int kDefaultSpinRounds = 64;
+
+  // num_stripes is rounded up to a power of two
+  explicit LockMgr(size_t num_stripes = kDefaultNumStripes, int spin_rounds = kDefaultSpinRounds);
 
   ~LockMgr();
 
-  // Attempt to lock key.  If OK status is returned, the caller is responsible
-  // for calling UnLock() on this key.
-  Status TryLock(const std::string& key);
+  // Lock key, wait until it is available. If OK status is returned, the
+  // caller is responsible for calling UnLock() on this key.
+  Status TryLock(std::string_view key);
 
   // Unlock a key locked by TryLock().
-  void UnLock(const std::string& key);
-
- private:
-  // Default number of lock map stripes
-  const size_t default_num_stripes_[[maybe_unused]];
-
-  // Limit on number of keys locked per column family
-  const int64_t max_num_locks_;
-
-  // Used to allocate mutexes/condvars to use when locking keys
-  std::shared_ptr<MutexFactory> mutex_factory_;
+  void UnLock(std::string_view key);
 
-  // Map to locked key info
-  std::shared_ptr<LockMap> lock_map_;
-
-  Status Acquire(std::shared_ptr<LockMapStripe> stripe, const std::string& key);
-
-  Status AcquireLocked(std::shared_ptr<LockMapStripe> stripe, const std::string& key);
-
-  void UnLockKey(const std::string& key, std::shared_ptr<LockMapStripe> stripe);
+  size_t GetStripe(std::string_view key) const;
+  void LockStripe(size_t stripe);
+  // Lock the stripe if it is free or this thread holds it, false if another
+  // thread does. A thread holding other stripes may take one out of order so
+  bool TryLockStripe(size_t stripe);
+  void UnLockStripe(size_t stripe);
 
+ private:
+  struct alignas(64) Stripe {
+    // token of the owner thread, 0 if free
+    std::atomic<uint64_t> owner{0};
+    // only touched by the owner thread
+    uint32_t depth = 0;
+    std::atomic<uint32_t> waiters{0};
+    std::mutex mu;
+    std::condition_variable cv;
+  };
+
+  const size_t stripe_mask_;
+  const int spin_rounds_;
+  std::unique_ptr<Stripe[]> stripes_;
 };
 
 }  //  namespace lock
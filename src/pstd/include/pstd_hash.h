@@ -82,6 +82,7 @@ namespace pstd {
 
 std::string md5(const std::string& str, bool raw = false);
 std::string sha256(const std::string& input, bool raw = false);
+std::string sha1(const std::string& input, bool raw = false);
 
 } // namespace pstd
 
@@ -2,6 +2,7 @@
 #define __PSTD_MUTEXLOCK_H__
 
 #include <pthread.h>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
@@ -60,6 +61,43 @@ class RecordMutex : public pstd::noncopyable {
   std::unordered_map<std::string, RefMutex*> records_;
 };
 
+/*
+ * Reader-writer lock for read mostly paths with rare writers.
+ *
+ * Readers only touch a counter on their own cache line, picked by thread,
+ * so concurrent readers do not bounce a shared cache line. A writer sets
+ * the writer flag and waits until every reader counter drains, readers
+ * arriving meanwhile back off and wait for the writer to finish.
+ *
+ * lock_shared and unlock_shared must be called by the same thread.
+ */
+class ShardedRWMutex : public pstd::noncopyable {
+ public:
+  ShardedRWMutex() = default;
+
+  void lock();
+  void unlock();
+  void lock_shared();
+  void unlock_shared();
+
+  static const int kShards = 64;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> readers{0};
+  };
+
+  static int ThreadShard();
+
+  Shard shards_[kShards];
+  std::atomic<bool> writer_{false};
+  // serialize writers
+  Mutex writer_mu_;
+  // readers wait here while a writer holds the lock
+  Mutex wait_mu_;
+  CondVar wait_cv_;
+};
+
 class RecordLock : public pstd::noncopyable {
  public:
   RecordLock(RecordMutex* mu, std::string  key) : mu_(mu), key_(std::move(key)) { mu_->Lock(key_); }
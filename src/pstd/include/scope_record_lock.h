@@ -7,6 +7,7 @@
 #define __SRC_SCOPE_RECORD_LOCK_H__
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -20,35 +21,85 @@ using Slice = rocksdb::Slice;
 
 class ScopeRecordLock final : public pstd::noncopyable {
  public:
-  ScopeRecordLock(std::shared_ptr<LockMgr> lock_mgr, const Slice& key) : lock_mgr_(lock_mgr), key_(key) {
-    lock_mgr_->TryLock(key_.ToString());
+  ScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const Slice& key)
+      : lock_mgr_(lock_mgr.get()), stripe_(lock_mgr_->GetStripe(std::string_view(key.data(), key.size()))) {
+    lock_mgr_->LockStripe(stripe_);
   }
-  ~ScopeRecordLock() { lock_mgr_->UnLock(key_.ToString()); }
+  ~ScopeRecordLock() { lock_mgr_->UnLockStripe(stripe_); }
 
  private:
-  std::shared_ptr<LockMgr> const lock_mgr_;
-  Slice key_;
+  LockMgr* const lock_mgr_;
+  const size_t stripe_;
+};
+
+// Locks the key only if no other thread holds its stripe, for the work that
+// may be skipped rather than wait out of the stripe order
+class TryScopeRecordLock final : public pstd::noncopyable {
+ public:
+  TryScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const Slice& key)
+      : lock_mgr_(lock_mgr.get()),
+        stripe_(lock_mgr_->GetStripe(std::string_view(key.data(), key.size()))),
+        locked_(lock_mgr_->TryLockStripe(stripe_)) {}
+  ~TryScopeRecordLock() {
+    if (locked_) {
+      lock_mgr_->UnLockStripe(stripe_);
+    }
+  }
+
+  bool locked() const { return locked_; }
+
+ private:
+  LockMgr* const lock_mgr_;
+  const size_t stripe_;
+  const bool locked_;
+};
+
+/*
+ * Stripes of a group of keys in ascending order, which is the order they
+ * must be locked in. Held inline unless there are many keys.
+ */
+class StripeSet final : public pstd::noncopyable {
+ public:
+  StripeSet() = default;
+
+  void Reset(const LockMgr& lock_mgr, const std::vector<std::string>& keys);
+  void Clear() {
+    heap_.clear();
+    size_ = 0;
+  }
+
+  const size_t* begin() const { return size_ <= kInlineStripes ? inline_ : heap_.data(); }
+  const size_t* end() const { return begin() + size_; }
+
+ private:
+  static const size_t kInlineStripes = 8;
+
+  size_t inline_[kInlineStripes];
+  std::vector<size_t> heap_;
+  size_t size_ = 0;
 };
 
 class MultiScopeRecordLock final : public pstd::noncopyable {
  public:
-  MultiScopeRecordLock(std::shared_ptr<LockMgr> lock_mgr, const std::vector<std::string>& keys);
+  MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr, const std::vector<std::string>& keys);
   ~MultiScopeRecordLock();
 
  private:
-  std::shared_ptr<LockMgr> const lock_mgr_;
-  std::vector<std::string> keys_;
+  LockMgr* const lock_mgr_;
+  StripeSet stripes_;
 };
 
 class MultiRecordLock : public noncopyable {
  public:
-  explicit MultiRecordLock(std::shared_ptr<LockMgr> lock_mgr) : lock_mgr_(lock_mgr) {}
+  explicit MultiRecordLock(std::shared_ptr<LockMgr> lock_mgr) : lock_mgr_(std::move(lock_mgr)) {}
   ~MultiRecordLock() = default;
 
   void Lock(const std::vector<std::string>& keys);
-  void Unlock(const std::vector<std::string>& keys);
+  // Unlock the keys of the last Lock()
+  void Unlock();
  private:
   std::shared_ptr<LockMgr> const lock_mgr_;
+  StripeSet stripes_;
 };
 
 }  // namespace pstd::lock
@@ -9,169 +9,117 @@
 
 #include "pstd/include/lock_mgr.h"
 
-#include <atomic>
+#include <cassert>
 #include <functional>
-#include <memory>
-#include <unordered_set>
-#include <vector>
-
-#include "pstd/include/mutex.h"
+#include <thread>
 
 namespace pstd::lock {
 
-struct LockMapStripe {
-  explicit LockMapStripe(const std::shared_ptr<MutexFactory>& factory) {
-    stripe_mutex = factory->AllocateMutex();
-    stripe_cv = factory->AllocateCondVar();
-    assert(stripe_mutex);
-    assert(stripe_cv);
-  }
-
-  // Mutex must be held before modifying keys map
-  std::shared_ptr<Mutex> stripe_mutex;
-
-  // Condition Variable per stripe for waiting on a lock
-  std::shared_ptr<CondVar> stripe_cv;
+static inline uint64_t ThreadToken() {
+  static std::atomic<uint64_t> next_token{1};
+  thread_local uint64_t token = next_token.fetch_add(1, std::memory_order_relaxed);
+  return token;
+}
 
-  // Locked keys
-  std::unordered_set<std::string> keys;
-};
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  std::this_thread::yield();
+#endif
+}
 
-// Map of #num_stripes LockMapStripes
-struct LockMap {
-  explicit LockMap(size_t num_stripes, const std::shared_ptr<MutexFactory>& factory) : num_stripes_(num_stripes) {
-    lock_map_stripes_.reserve(num_stripes);
-    for (size_t i = 0; i < num_stripes; i++) {
-      auto stripe = std::make_shared<LockMapStripe>(factory);
-      lock_map_stripes_.push_back(stripe);
-    }
+static size_t RoundUpPowerOfTwo(size_t n) {
+  size_t size = 1;
+  while (size < n) {
+    size <<= 1;
   }
-
-  ~LockMap() = default;
-
-  // Number of sepearate LockMapStripes to create, each with their own Mutex
-  const size_t num_stripes_;
-
-  // Count of keys that are currently locked.
-  // (Only maintained if LockMgr::max_num_locks_ is positive.)
-  std::atomic<int64_t> lock_cnt{0};
-
-  std::vector<std::shared_ptr<LockMapStripe>> lock_map_stripes_;
-
-  size_t GetStripe(const std::string& key) const;
-};
-
-size_t LockMap::GetStripe(const std::string& key) const {
-  assert(num_stripes_ > 0);
-  size_t stripe = std::hash<std::string>{}(key) % num_stripes_;
-  return stripe;
+  return size;
 }
 
-LockMgr::LockMgr(size_t default_num_stripes, int64_t max_num_locks, const std::shared_ptr<MutexFactory>& mutex_factory)
-    : default_num_stripes_(default_num_stripes),
-      max_num_locks_(max_num_locks),
-      mutex_factory_(mutex_factory),
-      lock_map_(std::make_shared<LockMap>(default_num_stripes, mutex_factory)) {}
+LockMgr::LockMgr(size_t num_stripes, int spin_rounds)
+    : stripe_mask_(RoundUpPowerOfTwo(num_stripes == 0 ? 1 : num_stripes) - 1),
+      spin_rounds_(spin_rounds),
+      stripes_(new Stripe[stripe_mask_ + 1]) {}
 
 LockMgr::~LockMgr() = default;
 
-Status LockMgr::TryLock(const std::string& key) {
-#ifdef LOCKLESS
-  return Status::OK();
-#else
-  size_t stripe_num = lock_map_->GetStripe(key);
-  assert(lock_map_->lock_map_stripes_.size() > stripe_num);
-  auto stripe = lock_map_->lock_map_stripes_.at(stripe_num);
-
-  return Acquire(stripe, key);
-#endif
-}
-
-// Helper function for TryLock().
-Status LockMgr::Acquire(std::shared_ptr<LockMapStripe> stripe, const std::string& key) {
-  Status result;
+size_t LockMgr::GetStripe(std::string_view key) const { return std::hash<std::string_view>{}(key) & stripe_mask_; }
 
-  // we wait indefinitely to acquire the lock
-  result = stripe->stripe_mutex->Lock();
-
-  if (!result.ok()) {
-    // failed to acquire mutex
-    return result;
+void LockMgr::LockStripe(size_t stripe) {
+#ifndef LOCKLESS
+  assert(stripe <= stripe_mask_);
+  Stripe& s = stripes_[stripe];
+  uint64_t self = ThreadToken();
+  if (s.owner.load(std::memory_order_relaxed) == self) {
+    s.depth++;
+    return;
   }
 
-  // Acquire lock if we are able to
-  result = AcquireLocked(stripe, key);
-
-  if (!result.ok()) {
-    // If we weren't able to acquire the lock, we will keep retrying
-    do {
-      result = stripe->stripe_cv->Wait(stripe->stripe_mutex);
-      if (result.ok()) {
-        result = AcquireLocked(stripe, key);
-      }
-    } while (!result.ok());
+  uint64_t expected = 0;
+  for (int i = 0; i < spin_rounds_; i++) {
+    if (s.owner.load(std::memory_order_relaxed) == 0 && s.owner.compare_exchange_weak(expected, self)) {
+      s.depth = 1;
+      return;
+    }
+    expected = 0;
+    CpuRelax();
   }
 
-  stripe->stripe_mutex->UnLock();
-
-  return result;
+  // Park. The waiter is counted before the last try under mu, so an UnLock
+  // either sees it and notifies, or the try below sees the stripe free
+  std::unique_lock l(s.mu);
+  s.waiters.fetch_add(1);
+  while (!s.owner.compare_exchange_strong(expected, self)) {
+    expected = 0;
+    s.cv.wait(l);
+  }
+  s.waiters.fetch_sub(1);
+  s.depth = 1;
+#endif
 }
 
-// Try to lock this key after we have acquired the mutex.
-// REQUIRED:  Stripe mutex must be held.
-Status LockMgr::AcquireLocked(std::shared_ptr<LockMapStripe> stripe, const std::string& key) {
-  Status result;
-  // Check if this key is already locked
-  if (stripe->keys.find(key) != stripe->keys.end()) {
-    // Lock already held
-    result = Status::Busy("LockTimeout");
-  } else {  // Lock not held.
-    // Check lock limit
-    if (max_num_locks_ > 0 && lock_map_->lock_cnt.load(std::memory_order_acquire) >= max_num_locks_) {
-      result = Status::Busy("LockLimit");
-    } else {
-      // acquire lock
-      stripe->keys.insert(key);
-
-      // Maintain lock count if there is a limit on the number of locks
-      if (max_num_locks_ != 0) {
-        lock_map_->lock_cnt++;
-      }
-    }
+bool LockMgr::TryLockStripe(size_t stripe) {
+#ifndef LOCKLESS
+  assert(stripe <= stripe_mask_);
+  Stripe& s = stripes_[stripe];
+  uint64_t self = ThreadToken();
+  if (s.owner.load(std::memory_order_relaxed) == self) {
+    s.depth++;
+    return true;
   }
-
-  return result;
+  uint64_t expected = 0;
+  if (!s.owner.compare_exchange_strong(expected, self)) {
+    return false;
+  }
+  s.depth = 1;
+#endif
+  return true;
 }
 
-void LockMgr::UnLockKey(const std::string& key, std::shared_ptr<LockMapStripe> stripe) {
-#ifdef LOCKLESS
-#else
-  auto stripe_iter = stripe->keys.find(key);
-  if (stripe_iter != stripe->keys.end()) {
-    // Found the key locked.  unlock it.
-    stripe->keys.erase(stripe_iter);
-    if (max_num_locks_ > 0) {
-      // Maintain lock count if there is a limit on the number of locks.
-      assert(lock_map_->lock_cnt.load(std::memory_order_relaxed) > 0);
-      lock_map_->lock_cnt--;
-    }
-  } else {
-    // This key is either not locked or locked by someone else.
+void LockMgr::UnLockStripe(size_t stripe) {
+#ifndef LOCKLESS
+  assert(stripe <= stripe_mask_);
+  Stripe& s = stripes_[stripe];
+  assert(s.owner.load(std::memory_order_relaxed) == ThreadToken());
+  if (--s.depth > 0) {
+    return;
+  }
+  s.owner.store(0);
+  if (s.waiters.load() > 0) {
+    std::lock_guard l(s.mu);
+    s.cv.notify_one();
   }
 #endif
 }
 
-void LockMgr::UnLock(const std::string& key) {
-  // Lock the mutex for the stripe that this key hashes to
-  size_t stripe_num = lock_map_->GetStripe(key);
-  assert(lock_map_->lock_map_stripes_.size() > stripe_num);
-  auto stripe = lock_map_->lock_map_stripes_.at(stripe_num);
+Status LockMgr::TryLock(std::string_view key) {
+  LockStripe(GetStripe(key));
+  return Status::OK();
+}
 
-  stripe->stripe_mutex->Lock();
-  UnLockKey(key, stripe);
-  stripe->stripe_mutex->UnLock();
+void LockMgr::UnLock(std::string_view key) { UnLockStripe(GetStripe(key)); }
 
-  // Signal waiting threads to retry locking
-  stripe->stripe_cv->NotifyAll();
-}
 }  // namespace pstd::lock
@@ -300,6 +300,92 @@ std::string sha256(const std::string& input, bool raw) {
   return {buf};
 }
 
+// SHA1 hash function, the digest of the scripts in the script cache
+
+static inline uint32_t Sha1Rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+static void Sha1Transform(uint32_t state[5], const unsigned char* block) {
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+           (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+  }
+  for (int i = 16; i < 80; i++) {
+    w[i] = Sha1Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  uint32_t e = state[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f;
+    uint32_t k;
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    uint32_t temp = Sha1Rotl(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = Sha1Rotl(b, 30);
+    b = a;
+    a = temp;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+std::string sha1(const std::string& input, bool raw) {
+  uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  const auto* data = reinterpret_cast<const unsigned char*>(input.data());
+  size_t len = input.size();
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    Sha1Transform(state, data + i);
+  }
+
+  // the tail, the 0x80 end mark and the bit length, in one or two blocks
+  unsigned char tail[128];
+  memset(tail, 0, sizeof(tail));
+  size_t rest = len - i;
+  memcpy(tail, data + i, rest);
+  tail[rest] = 0x80;
+  size_t tail_len = rest + 1 + 8 <= 64 ? 64 : 128;
+  uint64_t bits = static_cast<uint64_t>(len) * 8;
+  for (int j = 0; j < 8; j++) {
+    tail[tail_len - 1 - j] = static_cast<unsigned char>(bits >> (j * 8));
+  }
+  for (size_t j = 0; j < tail_len; j += 64) {
+    Sha1Transform(state, tail + j);
+  }
+
+  unsigned char digest[20];
+  for (int j = 0; j < 20; j++) {
+    digest[j] = static_cast<unsigned char>(state[j / 4] >> ((3 - j % 4) * 8));
+  }
+  if (raw) {
+    return {reinterpret_cast<char*>(digest), sizeof(digest)};
+  }
+  char buf[41];
+  for (int j = 0; j < 20; j++) {
+    snprintf(buf + j * 2, 3, "%02x", digest[j]);
+  }
+  return {buf, 40};
+}
+
 // MD5 hash function
 
 // Constants for MD5Transform routine.
@@ -5,6 +5,7 @@
 #include <ctime>
 
 #include <algorithm>
+#include <thread>
 
 #include <glog/logging.h>
 
@@ -19,6 +20,48 @@ void RefMutex::Unref() {
   }
 }
 
+int ShardedRWMutex::ThreadShard() {
+  static std::atomic<int> next_shard{0};
+  thread_local int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shard;
+}
+
+void ShardedRWMutex::lock_shared() {
+  Shard& shard = shards_[ThreadShard()];
+  while (true) {
+    // Pairs with the writer flag store in lock(), one of both sides
+    // is guaranteed to observe the other
+    shard.readers.fetch_add(1);
+    if (!writer_.load()) {
+      return;
+    }
+    shard.readers.fetch_sub(1);
+    std::unique_lock l(wait_mu_);
+    wait_cv_.wait(l, [this] { return !writer_.load(); });
+  }
+}
+
+void ShardedRWMutex::unlock_shared() { shards_[ThreadShard()].readers.fetch_sub(1, std::memory_order_release); }
+
+void ShardedRWMutex::lock() {
+  writer_mu_.lock();
+  writer_.store(true);
+  for (auto& shard : shards_) {
+    while (shard.readers.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ShardedRWMutex::unlock() {
+  {
+    std::lock_guard l(wait_mu_);
+    writer_.store(false);
+  }
+  wait_cv_.notify_all();
+  writer_mu_.unlock();
+}
+
 void RefMutex::Lock() { mu_.lock(); }
 
 void RefMutex::Unlock() { mu_.unlock(); }
@@ -9,68 +9,49 @@
 
 namespace pstd::lock {
 
-MultiScopeRecordLock::MultiScopeRecordLock(std::shared_ptr<LockMgr> lock_mgr, const std::vector<std::string>& keys)
-    : lock_mgr_(lock_mgr), keys_(keys) {
-  std::string pre_key;
-  std::sort(keys_.begin(), keys_.end());
-  if (!keys_.empty() && keys_[0].empty()) {
-    lock_mgr_->TryLock(pre_key);
+void StripeSet::Reset(const LockMgr& lock_mgr, const std::vector<std::string>& keys) {
+  size_t* stripes = inline_;
+  if (keys.size() > kInlineStripes) {
+    heap_.resize(keys.size());
+    stripes = heap_.data();
   }
-
-  for (const auto& key : keys_) {
-    if (pre_key != key) {
-      lock_mgr_->TryLock(key);
-      pre_key = key;
-    }
+  for (size_t i = 0; i < keys.size(); i++) {
+    stripes[i] = lock_mgr.GetStripe(keys[i]);
   }
-}
-MultiScopeRecordLock::~MultiScopeRecordLock() {
-  std::string pre_key;
-  if (!keys_.empty() && keys_[0].empty()) {
-    lock_mgr_->UnLock(pre_key);
-  }
-
-  for (const auto& key : keys_) {
-    if (pre_key != key) {
-      lock_mgr_->UnLock(key);
-      pre_key = key;
-    }
+  std::sort(stripes, stripes + keys.size());
+  // keys sharing a stripe lock it once
+  size_ = std::unique(stripes, stripes + keys.size()) - stripes;
+  if (size_ <= kInlineStripes && stripes != inline_) {
+    std::copy(stripes, stripes + size_, inline_);
   }
 }
 
-void MultiRecordLock::Lock(const std::vector<std::string>& keys) {
-  std::vector<std::string> internal_keys = keys;
-  std::sort(internal_keys.begin(), internal_keys.end());
-  // init to be ""
-  std::string pre_key;
-  // consider internal_keys "" "" "a"
-  if (!internal_keys.empty()) {
-    lock_mgr_->TryLock(internal_keys.front());
-    pre_key = internal_keys.front();
+MultiScopeRecordLock::MultiScopeRecordLock(const std::shared_ptr<LockMgr>& lock_mgr,
+                                           const std::vector<std::string>& keys)
+    : lock_mgr_(lock_mgr.get()) {
+  stripes_.Reset(*lock_mgr_, keys);
+  for (size_t stripe : stripes_) {
+    lock_mgr_->LockStripe(stripe);
   }
+}
 
-  for (const auto& key : internal_keys) {
-    if (pre_key != key) {
-      lock_mgr_->TryLock(key);
-      pre_key = key;
-    }
+MultiScopeRecordLock::~MultiScopeRecordLock() {
+  for (size_t stripe : stripes_) {
+    lock_mgr_->UnLockStripe(stripe);
   }
 }
 
-void MultiRecordLock::Unlock(const std::vector<std::string>& keys) {
-  std::vector<std::string> internal_keys = keys;
-  std::sort(internal_keys.begin(), internal_keys.end());
-  std::string pre_key;
-  if (!internal_keys.empty()) {
-    lock_mgr_->UnLock(internal_keys.front());
-    pre_key = internal_keys.front();
+void MultiRecordLock::Lock(const std::vector<std::string>& keys) {
+  stripes_.Reset(*lock_mgr_, keys);
+  for (size_t stripe : stripes_) {
+    lock_mgr_->LockStripe(stripe);
   }
+}
 
-  for (const auto& key : internal_keys) {
-    if (pre_key != key) {
-      lock_mgr_->UnLock(key);
-      pre_key = key;
-    }
+void MultiRecordLock::Unlock() {
+  for (size_t stripe : stripes_) {
+    lock_mgr_->UnLockStripe(stripe);
   }
+  stripes_.Clear();
 }
 }  // namespace pstd::lock
@@ -0,0 +1,106 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pstd/include/lock_mgr.h"
+#include "pstd/include/scope_record_lock.h"
+
+namespace pstd::lock {
+
+class LockMgrTest : public ::testing::Test {};
+
+TEST_F(LockMgrTest, MutualExclusion) {
+  // few stripes and no spinning, so waiters collide and park
+  LockMgr mgr(4, 0);
+  std::vector<int64_t> counters(8, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20000; i++) {
+        std::string key = "key_" + std::to_string((i + t) % 8);
+        mgr.TryLock(key);
+        counters[(i + t) % 8]++;
+        mgr.UnLock(key);
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  int64_t total = 0;
+  for (int64_t c : counters) {
+    total += c;
+  }
+  EXPECT_EQ(8 * 20000, total);
+}
+
+TEST_F(LockMgrTest, Reentrant) {
+  auto mgr = std::make_shared<LockMgr>();
+  MultiRecordLock record_lock(mgr);
+  record_lock.Lock({"a", "b", "a", ""});
+  {
+    // the storage layer relocks keys the command layer holds
+    ScopeRecordLock l(mgr, "a");
+    MultiScopeRecordLock ml(mgr, {"b", "a"});
+  }
+
+  std::atomic<bool> locked{false};
+  std::thread other([&] {
+    ScopeRecordLock l(mgr, "b");
+    locked = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(locked.load());
+  record_lock.Unlock();
+  other.join();
+  EXPECT_TRUE(locked.load());
+}
+
+TEST_F(LockMgrTest, TryLock) {
+  auto mgr = std::make_shared<LockMgr>();
+  ScopeRecordLock l(mgr, "a");
+  {
+    // held by this thread
+    TryScopeRecordLock tl(mgr, "a");
+    EXPECT_TRUE(tl.locked());
+  }
+  std::thread other([&] {
+    TryScopeRecordLock tl(mgr, "a");
+    EXPECT_FALSE(tl.locked());
+    TryScopeRecordLock free_lock(mgr, "b");
+    EXPECT_TRUE(free_lock.locked() || mgr->GetStripe("a") == mgr->GetStripe("b"));
+  });
+  other.join();
+}
+
+TEST_F(LockMgrTest, ManyKeys) {
+  auto mgr = std::make_shared<LockMgr>(16);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 100; i++) {
+    keys.push_back("key_" + std::to_string(i));
+  }
+  std::vector<std::thread> threads;
+  std::atomic<int> done{0};
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; i++) {
+        MultiScopeRecordLock ml(mgr, keys);
+      }
+      done++;
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  EXPECT_EQ(4, done.load());
+}
+
+}  // namespace pstd::lock
@@ -0,0 +1,82 @@
+// Copyright (c) 2015-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pstd/include/pstd_mutex.h"
+
+namespace pstd {
+
+class ShardedRWMutexTest : public ::testing::Test {};
+
+TEST_F(ShardedRWMutexTest, WriterExcludesReaders) {
+  ShardedRWMutex mu;
+  std::atomic<bool> stop{false};
+  std::atomic<int> in_writer{0};
+  std::atomic<int> violations{0};
+  int64_t value = 0;
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; i++) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        std::shared_lock l(mu);
+        if (in_writer.load() != 0) {
+          violations++;
+        }
+        int64_t v1 = value;
+        std::this_thread::yield();
+        if (value != v1) {
+          violations++;
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    std::lock_guard l(mu);
+    in_writer++;
+    value++;
+    in_writer--;
+  }
+  stop.store(true);
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  ASSERT_EQ(0, violations.load());
+  ASSERT_EQ(1000, value);
+}
+
+TEST_F(ShardedRWMutexTest, ReadersShare) {
+  ShardedRWMutex mu;
+  std::atomic<int> holding{0};
+  std::atomic<int> max_holding{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      std::shared_lock l(mu);
+      int now = ++holding;
+      int prev = max_holding.load();
+      while (now > prev && !max_holding.compare_exchange_weak(prev, now)) {
+      }
+      while (max_holding.load() < 4) {
+        std::this_thread::yield();
+      }
+      holding--;
+    });
+  }
+  for (auto& t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(4, max_holding.load());
+}
+
+}  // namespace pstd
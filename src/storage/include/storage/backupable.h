@@ -18,6 +18,8 @@ namespace storage {
 
 inline const std::string DEFAULT_BK_PATH = "dump";  // Default backup root dir
 inline const std::string DEFAULT_RS_PATH = "db";    // Default restore root dir
+// The files of a backup, where they come from and the meta of the backup
+inline const std::string BACKUP_MANIFEST = "BACKUP_MANIFEST";
 
 // Arguments which will used by BackupSave Thread
 // p_engine for BackupEngine handler
@@ -38,6 +40,9 @@ struct BackupContent {
   rocksdb::VectorLogPtr live_wal_files;
   uint64_t manifest_file_size = 0;
   uint64_t sequence_number = 0;
+  // set by SetBackupContentAt(), the last wal file is cut at last_wal_size
+  bool pinned = false;
+  uint64_t last_wal_size = 0;
 };
 
 class BackupEngine {
@@ -47,6 +52,25 @@ class BackupEngine {
 
   Status SetBackupContent();
 
+  // The latest sequence number of every type db, taken with no write in
+  // flight they are a consistent point of the dbs
+  std::map<std::string, uint64_t> LatestSequenceNumbers();
+
+  // Set the backup content to the dbs as of the sequence numbers got by
+  // LatestSequenceNumbers(), without flushing the memtables nor blocking the
+  // writes. Busy if a db was flushed since, the sequence numbers are to be
+  // taken again
+  Status SetBackupContentAt(const std::map<std::string, uint64_t>& sequence_numbers);
+
+  // Make the next backup incremental to base_dir, a backup of the same dbs
+  // with its manifest: the sst files it shares with it are hard linked to it
+  // when they can not be to the dbs. Every backup is whole, any one of a
+  // chain of them restores alone and is deleted without the others
+  Status SetBaseBackup(const std::string& base_dir);
+
+  // A line of the manifest of the next backup, as the binlog offset it is at
+  void SetBackupMeta(const std::string& name, const std::string& value);
+
   Status CreateNewBackup(const std::string& dir);
 
   void StopBackup();
@@ -56,9 +80,12 @@ class BackupEngine {
  private:
   BackupEngine() = default;
 
+  std::map<std::string, rocksdb::DB*> dbs_;
   std::map<std::string, std::unique_ptr<rocksdb::DBCheckpoint>> engines_;
   std::map<std::string, BackupContent> backup_content_;
   std::map<std::string, pthread_t> backup_pthread_ts_;
+  std::string base_dir_;
+  std::vector<std::pair<std::string, std::string>> backup_meta_;
 
   Status NewCheckpoint(rocksdb::DB* rocksdb_db, const std::string& type);
   std::string GetSaveDirByType(const std::string& _dir, const std::string& _type) const {
@@ -66,6 +93,8 @@ class BackupEngine {
     return backup_dir + ((backup_dir.back() != '/') ? "/" : "") + _type;
   }
   Status WaitBackupPthread();
+  void ReleaseBackupContent();
+  Status WriteBackupManifest(const std::string& dir);
 };
 
 }  //  namespace storage
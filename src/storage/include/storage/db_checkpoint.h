@@ -7,6 +7,7 @@
 
 #ifndef ROCKSDB_LITE
 
+#  include <string>
 #  include <vector>
 #  include "rocksdb/status.h"
 #  include "rocksdb/transaction_log.h"
@@ -15,6 +16,15 @@ namespace rocksdb {
 
 class DB;
 
+// A file of a checkpoint and where it comes from
+struct CheckpointFile {
+  enum Source { kLinkedDB, kLinkedBase, kCopied };
+  // prefixed with "/"
+  std::string name;
+  uint64_t size = 0;
+  Source source = kCopied;
+};
+
 class DBCheckpoint {
  public:
   // Creates a Checkpoint object to be used for creating openable sbapshots
@@ -36,6 +46,32 @@ class DBCheckpoint {
                                            VectorLogPtr& live_wal_files, uint64_t manifest_file_size,
                                            uint64_t sequence_number) = 0;
 
+  // Gets the files of the db as of sequence_number, a sequence number taken
+  // before with no write in flight, without flushing the memtables: the live
+  // sst files and the alive wal files up to the one of sequence_number, whose
+  // writes up to sequence_number end at last_wal_size. Busy if a flush since
+  // sequence_number wrote newer writes to an sst file, to be taken again
+  virtual Status GetCheckpointFilesAt(uint64_t sequence_number, std::vector<std::string>& live_files,
+                                      VectorLogPtr& live_wal_files, uint64_t& manifest_file_size,
+                                      uint64_t& last_wal_size) = 0;
+
+  virtual Status CreateCheckpointWithFilesAt(const std::string& checkpoint_dir, std::vector<std::string>& live_files,
+                                             VectorLogPtr& live_wal_files, uint64_t manifest_file_size,
+                                             uint64_t sequence_number, uint64_t last_wal_size) = 0;
+
+  // Gives up the files got by GetCheckpointFiles() or GetCheckpointFilesAt()
+  // without creating the checkpoint
+  virtual void ReleaseCheckpointFiles() = 0;
+
+  // The sst files that can not be hard linked to the db, the checkpoint being
+  // on another filesystem, are hard linked to the same files of base_dir, a
+  // checkpoint of this db on the filesystem of the checkpoint, instead of
+  // being copied. Empty for none
+  virtual void SetBaseCheckpoint(const std::string& base_dir) = 0;
+
+  // The files of the last checkpoint created
+  virtual std::vector<CheckpointFile> LastCheckpointFiles() = 0;
+
   virtual ~DBCheckpoint() = default;
 };
 
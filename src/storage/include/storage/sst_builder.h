@@ -0,0 +1,78 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef INCLUDE_STORAGE_SST_BUILDER_H_
+#define INCLUDE_STORAGE_SST_BUILDER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+
+#include "storage.h"
+
+namespace storage {
+
+/*
+ * SstBuilder converts a dump into the sst files of the type dbs of one
+ * Storage, in their internal formats, to be loaded by
+ * Storage::IngestExternalFiles() without going through the write path.
+ *
+ * Every key is added once, as a whole, with a ttl in seconds or 0 for none.
+ * The records are buffered and, every buffer_size bytes, sorted into a run
+ * file of each column family. Finish() merges the runs of each column family
+ * into the files to ingest, laid out as the type dbs:
+ *   <path>/<strings|hashes|lists|sets|zsets>/<column family>/<number>.sst
+ * A string set twice keeps the last value. An SstBuilder is not thread safe,
+ * the builders of different Storages may run in parallel.
+ */
+class SstBuilder {
+ public:
+  SstBuilder(const StorageOptions& storage_options, std::string path, size_t buffer_size = 64 << 20);
+  ~SstBuilder();
+
+  Status Set(const Slice& key, const Slice& value, int32_t ttl = 0);
+  Status HMSet(const Slice& key, const std::vector<FieldValue>& fvs, int32_t ttl = 0);
+  Status RPush(const Slice& key, const std::vector<std::string>& values, int32_t ttl = 0);
+  Status SAdd(const Slice& key, const std::vector<std::string>& members, int32_t ttl = 0);
+  Status ZAdd(const Slice& key, const std::vector<ScoreMember>& score_members, int32_t ttl = 0);
+
+  // Write what is buffered, merge the runs, nothing can be added after
+  Status Finish();
+
+  uint64_t keys() const { return keys_; }
+
+ private:
+  struct Buffer {
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::vector<std::string> runs;
+  };
+
+  Status Add(size_t target, std::string key, std::string value);
+  Status AddExpireIndex(size_t target, const Slice& key, int32_t timestamp);
+  // Sort the buffered entries of every column family into run files
+  Status FlushRuns();
+  Status WriteRun(size_t target, Buffer* buffer);
+  Status MergeRuns(size_t target, Buffer* buffer);
+  rocksdb::Options TargetOptions(size_t target) const;
+
+  rocksdb::Options options_;
+  rocksdb::BlockBasedTableOptions table_options_;
+  std::string path_;
+  size_t buffer_size_ = 0;
+  size_t buffered_ = 0;
+  // the version of every key of the build
+  int32_t version_ = 0;
+  uint64_t keys_ = 0;
+  uint64_t next_file_number_ = 0;
+  bool finished_ = false;
+  std::vector<Buffer> buffers_;
+};
+
+}  //  namespace storage
+#endif  //  INCLUDE_STORAGE_SST_BUILDER_H_
@@ -7,10 +7,13 @@
 #define INCLUDE_STORAGE_STORAGE_H_
 
 #include <unistd.h>
+#include <condition_variable>
+#include <functional>
 #include <list>
 #include <map>
 #include <queue>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -22,6 +25,7 @@
 #include "rocksdb/status.h"
 #include "rocksdb/table.h"
 
+#include "pstd/include/lock_mgr.h"
 #include "pstd/include/pstd_mutex.h"
 
 namespace storage {
@@ -54,10 +58,10 @@ class RedisSets;
 class RedisLists;
 class RedisZSets;
 class HyperLogLog;
+struct BatchWriteBuffers;
 enum class OptionType;
 
-template <typename T1, typename T2>
-class LRUCache;
+class ScanCursorStore;
 
 struct StorageOptions {
   rocksdb::Options options;
@@ -66,6 +70,12 @@ struct StorageOptions {
   bool share_block_cache = false;
   size_t statistics_max_size = 0;
   size_t small_compaction_threshold = 5000;
+  // Hashes of at most this many fields, each of at most hash_max_inline_value
+  // bytes, keep them in their meta value rather than in data keys, 0 for none
+  size_t hash_max_inline_fields = 0;
+  size_t hash_max_inline_value = 64;
+  // Percent of each expire cycle the expire reaper may run for, 0 disables it
+  int active_expire_cpu_percent = 0;
   Status ResetOptions(const OptionType& option_type, const std::unordered_map<std::string, std::string>& options_map);
 };
 
@@ -83,6 +93,12 @@ struct KeyInfo {
   uint64_t invaild_keys;
 };
 
+struct SstFilesSize {
+  // the files of the current version, and all the files on disk
+  uint64_t live = 0;
+  uint64_t total = 0;
+};
+
 struct ValueStatus {
   std::string value;
   Status status;
@@ -107,6 +123,10 @@ struct ScoreMember {
   bool operator==(const ScoreMember& sm) const { return (sm.score == score && sm.member == member); }
 };
 
+// Called with every member found by a scan of scores, the scan stops when it
+// returns false
+using ScoreMemberVisitor = std::function<bool(double score, const Slice& member)>;
+
 enum BeforeOrAfter { Before, After };
 
 enum DataType { kAll, kStrings, kHashes, kLists, kZSets, kSets };
@@ -135,16 +155,68 @@ struct BGTask {
       : type(_type), operation(_opeation), argv(std::move(_argv)) {}
 };
 
+/*
+ * While a BatchWriteScope is alive, the writes of its thread to any Storage
+ * are buffered instead of written, and the reads of the thread see them.
+ * Commit writes the buffer of each data type db with one WriteBatch, nothing
+ * is written if the scope ends without Commit. The data type dbs are written
+ * one after another, so only the writes to the same type are atomic together.
+ * If a type fails after another was written, the process is aborted rather
+ * than go on serving and replicating half of the scope. Scopes do not nest
+ */
+class BatchWriteScope {
+ public:
+  BatchWriteScope();
+  ~BatchWriteScope();
+
+  BatchWriteScope(const BatchWriteScope&) = delete;
+  BatchWriteScope& operator=(const BatchWriteScope&) = delete;
+
+  Status Commit();
+
+  // Run callback after the commit of the scope of the calling thread, it
+  // returns false if the thread has no scope
+  static bool RunAtCommit(std::function<void()> callback);
+
+ private:
+  std::unique_ptr<BatchWriteBuffers> buffers_;
+};
+
 class Storage {
  public:
   Storage();
+  // Share the record locks with the caller, a key locked by the caller is not
+  // locked again by the write commands below
+  explicit Storage(std::shared_ptr<pstd::lock::LockMgr> lock_mgr);
   ~Storage();
 
+  std::shared_ptr<pstd::lock::LockMgr> GetLockMgr() const { return lock_mgr_; }
+
+  // Called with the key after elements are pushed into a list, by every push
+  // path of the lists. It runs with the key locked, so it must be cheap and
+  // must not call back into the storage. Set it before the storage is used
+  using ListPushListener = std::function<void(const Slice& key)>;
+  void SetListPushListener(ListPushListener listener) { list_push_listener_ = std::move(listener); }
+  // In a BatchWriteScope the listener is called at the commit of it
+  void NotifyListPush(const Slice& key) const;
+  // Called with the key after the expire reaper removed it or its expired
+  // hash fields, with the key locked like the ListPushListener. Set it before
+  // the storage is used
+  using KeyReapedListener = std::function<void(const Slice& key)>;
+  void SetKeyReapedListener(KeyReapedListener listener) { key_reaped_listener_ = std::move(listener); }
+  void NotifyKeyReaped(const Slice& key) const {
+    if (key_reaped_listener_) {
+      key_reaped_listener_(key);
+    }
+  }
+
   Status Open(const StorageOptions& storage_options, const std::string& db_path);
 
-  Status GetStartKey(const DataType& dtype, int64_t cursor, std::string* start_key);
+  // The point the scan of dtype in scope resumes at with cursor
+  Status GetStartKey(const DataType& dtype, int64_t cursor, const std::string& scope, std::string* start_key);
 
-  Status StoreCursorStartKey(const DataType& dtype, int64_t cursor, const std::string& next_key);
+  Status StoreCursorStartKey(const DataType& dtype, int64_t cursor, const std::string& scope,
+                             const std::string& next_key);
 
   // Strings Commands
 
@@ -353,6 +425,26 @@ class Storage {
   Status PKHRScanRange(const Slice& key, const Slice& field_start, const std::string& field_end, const Slice& pattern,
                        int32_t limit, std::vector<FieldValue>* field_values, std::string* next_field);
 
+  // Set a timeout on the fields of the hash stored at key, ttl seconds from
+  // now. rets has for each field -2 if it does not exist, 1 if it was set,
+  // 2 if it was deleted since the ttl is not positive. An expired field of a
+  // hash of data keys is counted by HLen until the reaper drops it.
+  Status HExpire(const Slice& key, int32_t ttl, const std::vector<std::string>& fields, std::vector<int32_t>* rets);
+
+  // Set the unix time the fields of the hash stored at key expire at, as
+  // HExpire does
+  Status HExpireat(const Slice& key, int32_t timestamp, const std::vector<std::string>& fields,
+                   std::vector<int32_t>* rets);
+
+  // Returns for each field of the hash stored at key its remaining time to
+  // live in seconds, -1 if it has none, -2 if it does not exist
+  Status HTTL(const Slice& key, const std::vector<std::string>& fields, std::vector<int64_t>* ttls);
+
+  // Remove the timeout of the fields of the hash stored at key. rets has for
+  // each field -2 if it does not exist, -1 if it had no timeout, 1 if it was
+  // removed
+  Status HPersist(const Slice& key, const std::vector<std::string>& fields, std::vector<int32_t>* rets);
+
   // Sets Commands
 
   // Add the specified members to the set stored at key. Specified members that
@@ -725,6 +817,13 @@ class Storage {
   Status ZRangebyscore(const Slice& key, double min, double max, bool left_close, bool right_close, int64_t count,
                        int64_t offset, std::vector<ScoreMember>* score_members);
 
+  // Visit the elements of the sorted set at key with a score in any of the
+  // closed intervals of ranges, each once, on one snapshot. The ranges are
+  // sorted and the overlapping or adjacent ones merged, so the elements are
+  // visited in the order of their scores with a seek per merged range.
+  Status ZScanScoreRanges(const Slice& key, std::vector<std::pair<double, double>> ranges,
+                          const ScoreMemberVisitor& visitor);
+
   // Returns the rank of member in the sorted set stored at key, with the scores
   // ordered from low to high. The rank (or index) is 0-based, which means that
   // the member with the lowest score has rank 0.
@@ -967,6 +1066,9 @@ class Storage {
   // return > 0 TTL in seconds
   std::map<DataType, int64_t> TTL(const Slice& key, std::map<DataType, Status>* type_status);
 
+  // The remaining time to live of key in the db of data_type only, as TTL()
+  Status TTL(const DataType& data_type, const Slice& key, int64_t* ttl);
+
   // Reutrns the data all type of the key
   // if single is true, the query will return the first one
   Status GetType(const std::string& key, bool single, std::vector<std::string>& types);
@@ -1009,11 +1111,25 @@ class Storage {
 
   Status SetMaxCacheStatisticKeys(uint32_t max_cache_statistic_keys);
   Status SetSmallCompactionThreshold(uint32_t small_compaction_threshold);
+  Status SetActiveExpireCpuPercent(int active_expire_cpu_percent);
+
+  // Run one cycle of the expire reaper for at most budget_us, return the
+  // number of expire index entries handled
+  int64_t ReapExpiredKeys(uint64_t budget_us);
 
   std::string GetCurrentTaskType();
   Status GetUsage(const std::string& property, uint64_t* result);
   Status GetUsage(const std::string& property, std::map<std::string, uint64_t>* type_result);
   uint64_t GetProperty(const std::string& db_type, const std::string& property);
+  // The size of the sst files on disk of all the type dbs, kept by the
+  // listeners of the dbs, so it is O(1)
+  uint64_t GetTotalSstFilesSize();
+  // The sst files size of every column family of every type db, keyed by
+  // "<type>_<column family>"
+  void GetSstFilesSize(std::map<std::string, SstFilesSize>* sizes);
+  // Ingest the sst files built by an SstBuilder under path into the type
+  // dbs, bypassing the write path. The keys replace the ones that exist
+  Status IngestExternalFiles(const std::string& path);
 
   Status GetKeyNum(std::vector<KeyInfo>* key_infos);
   Status StopScanKeyNum();
@@ -1025,6 +1141,9 @@ class Storage {
   void GetRocksDBInfo(std::string& info);
 
  private:
+  std::shared_ptr<pstd::lock::LockMgr> lock_mgr_;
+  ListPushListener list_push_listener_;
+  KeyReapedListener key_reaped_listener_;
   std::unique_ptr<RedisStrings> strings_db_;
   std::unique_ptr<RedisHashes> hashes_db_;
   std::unique_ptr<RedisSets> sets_db_;
@@ -1032,7 +1151,7 @@ class Storage {
   std::unique_ptr<RedisLists> lists_db_;
   std::atomic<bool> is_opened_ = false;
 
-  std::unique_ptr<LRUCache<std::string, std::string>> cursors_store_;
+  std::unique_ptr<ScanCursorStore> cursors_store_;
 
   // Storage start the background thread for compaction task
   pthread_t bg_tasks_thread_id_ = 0;
@@ -1045,6 +1164,15 @@ class Storage {
 
   // For scan keys in data base
   std::atomic<bool> scan_keynum_exit_ = false;
+
+  // Expire reaper, removes the keys whose ttl are due by the expire index
+  void RunExpireReaper();
+  std::thread expire_reaper_;
+  std::mutex expire_reaper_mutex_;
+  std::condition_variable expire_reaper_cv_;
+  std::atomic<int> active_expire_cpu_percent_ = 0;
+  // the type db the next reaper cycle starts from
+  size_t expire_reaper_next_ = 0;
 };
 
 }  //  namespace storage
@@ -4,6 +4,8 @@
 //  of patent rights can be found in the PATENTS file in the same directory.
 //
 #include <dirent.h>
+#include <fstream>
+#include <sstream>
 #include <utility>
 
 #include "storage/backupable.h"
@@ -22,6 +24,7 @@ Status BackupEngine::NewCheckpoint(rocksdb::DB* rocksdb_db, const std::string& t
   if (!s.ok()) {
     return s;
   }
+  dbs_.insert(std::make_pair(type, rocksdb_db));
   engines_.insert(std::make_pair(type, std::unique_ptr<rocksdb::DBCheckpoint>(checkpoint)));
   return s;
 }
@@ -69,6 +72,121 @@ Status BackupEngine::SetBackupContent() {
   return s;
 }
 
+std::map<std::string, uint64_t> BackupEngine::LatestSequenceNumbers() {
+  std::map<std::string, uint64_t> sequence_numbers;
+  for (const auto& db : dbs_) {
+    sequence_numbers[db.first] = db.second->GetLatestSequenceNumber();
+  }
+  return sequence_numbers;
+}
+
+Status BackupEngine::SetBackupContentAt(const std::map<std::string, uint64_t>& sequence_numbers) {
+  Status s;
+  // the content of the last backup, its files are given up already
+  backup_content_.clear();
+  for (const auto& engine : engines_) {
+    auto iter = sequence_numbers.find(engine.first);
+    if (iter == sequence_numbers.end()) {
+      s = Status::InvalidArgument("No sequence number of " + engine.first);
+      break;
+    }
+    BackupContent bcontent;
+    bcontent.pinned = true;
+    bcontent.sequence_number = iter->second;
+    s = engine.second->GetCheckpointFilesAt(bcontent.sequence_number, bcontent.live_files, bcontent.live_wal_files,
+                                            bcontent.manifest_file_size, bcontent.last_wal_size);
+    if (!s.ok()) {
+      break;
+    }
+    backup_content_[engine.first] = std::move(bcontent);
+  }
+  if (!s.ok()) {
+    // the files of the dbs done are not to be kept for a backup not made
+    ReleaseBackupContent();
+  }
+  return s;
+}
+
+void BackupEngine::ReleaseBackupContent() {
+  for (const auto& content : backup_content_) {
+    auto iter = engines_.find(content.first);
+    if (iter != engines_.end()) {
+      iter->second->ReleaseCheckpointFiles();
+    }
+  }
+  backup_content_.clear();
+}
+
+Status BackupEngine::SetBaseBackup(const std::string& base_dir) {
+  std::ifstream in(GetSaveDirByType(base_dir, BACKUP_MANIFEST));
+  if (!in.is_open()) {
+    return Status::NotFound("No manifest in " + base_dir);
+  }
+  // only the dbs the base was made of have their files in it
+  std::map<std::string, std::string> identities;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string tag;
+    std::string type;
+    std::string identity;
+    if ((fields >> tag >> type >> identity) && tag == "db") {
+      identities[type] = identity;
+    }
+  }
+  base_dir_ = base_dir;
+  for (const auto& engine : engines_) {
+    std::string identity;
+    auto iter = identities.find(engine.first);
+    if (iter != identities.end() && dbs_[engine.first]->GetDbIdentity(identity).ok() && identity == iter->second) {
+      engine.second->SetBaseCheckpoint(GetSaveDirByType(base_dir, engine.first));
+    } else {
+      engine.second->SetBaseCheckpoint("");
+    }
+  }
+  return Status::OK();
+}
+
+void BackupEngine::SetBackupMeta(const std::string& name, const std::string& value) {
+  backup_meta_.emplace_back(name, value);
+}
+
+// A line a field, "meta <name> <value>", "base <dir>", "db <type> <identity>",
+// "file <type> <name> <size> <db|base|copy>" and "copied_bytes <bytes>"
+Status BackupEngine::WriteBackupManifest(const std::string& dir) {
+  std::string manifest = GetSaveDirByType(dir, BACKUP_MANIFEST);
+  std::ofstream out(manifest, std::ios::trunc);
+  if (!out.is_open()) {
+    return Status::IOError("Open " + manifest + " failed");
+  }
+  for (const auto& meta : backup_meta_) {
+    out << "meta " << meta.first << " " << meta.second << "\n";
+  }
+  if (!base_dir_.empty()) {
+    out << "base " << base_dir_ << "\n";
+  }
+  uint64_t copied_bytes = 0;
+  for (const auto& engine : engines_) {
+    std::string identity;
+    if (dbs_[engine.first]->GetDbIdentity(identity).ok()) {
+      out << "db " << engine.first << " " << identity << "\n";
+    }
+    for (const auto& file : engine.second->LastCheckpointFiles()) {
+      out << "file " << engine.first << " " << file.name << " " << file.size << " "
+          << (file.source == rocksdb::CheckpointFile::kLinkedDB
+                  ? "db"
+                  : (file.source == rocksdb::CheckpointFile::kLinkedBase ? "base" : "copy"))
+          << "\n";
+      if (file.source == rocksdb::CheckpointFile::kCopied) {
+        copied_bytes += file.size;
+      }
+    }
+  }
+  out << "copied_bytes " << copied_bytes << "\n";
+  out.close();
+  return out.fail() ? Status::IOError("Write " + manifest + " failed") : Status::OK();
+}
+
 Status BackupEngine::CreateNewBackupSpecify(const std::string& backup_dir, const std::string& type) {
   auto it_engine = engines_.find(type);
   auto it_content = backup_content_.find(type);
@@ -76,9 +194,16 @@ Status BackupEngine::CreateNewBackupSpecify(const std::string& backup_dir, const
   delete_dir(dir.c_str());
 
   if (it_content != backup_content_.end() && it_engine != engines_.end()) {
-    Status s = it_engine->second->CreateCheckpointWithFiles(
-        dir, it_content->second.live_files, it_content->second.live_wal_files, it_content->second.manifest_file_size,
-        it_content->second.sequence_number);
+    Status s;
+    if (it_content->second.pinned) {
+      s = it_engine->second->CreateCheckpointWithFilesAt(
+          dir, it_content->second.live_files, it_content->second.live_wal_files, it_content->second.manifest_file_size,
+          it_content->second.sequence_number, it_content->second.last_wal_size);
+    } else {
+      s = it_engine->second->CreateCheckpointWithFiles(
+          dir, it_content->second.live_files, it_content->second.live_wal_files, it_content->second.manifest_file_size,
+          it_content->second.sequence_number);
+    }
     if (!s.ok()) {
       //    type.c_str(), s.ToString().c_str());
       return s;
@@ -138,6 +263,9 @@ Status BackupEngine::CreateNewBackup(const std::string& dir) {
   }
   s = WaitBackupPthread();
 
+  if (s.ok()) {
+    s = WriteBackupManifest(dir);
+  }
   return s;
 }
 
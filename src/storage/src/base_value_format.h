@@ -25,6 +25,7 @@ class InternalValue {
     }
   }
   void set_timestamp(int32_t timestamp = 0) { timestamp_ = timestamp; }
+  int32_t timestamp() const { return timestamp_; }
   Status SetRelativeTimestamp(int32_t ttl) {
     int64_t unix_time;
     rocksdb::Env::Default()->GetCurrentTime(&unix_time);
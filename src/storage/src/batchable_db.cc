@@ -0,0 +1,200 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/batchable_db.h"
+
+#include <cassert>
+
+#include <glog/logging.h>
+
+#include "rocksdb/comparator.h"
+
+#include "storage/storage.h"
+
+namespace storage {
+
+static thread_local BatchWriteBuffers* scope_buffers = nullptr;
+
+// Replay a WriteBatch of the data types into a buffer
+class BufferHandler : public rocksdb::WriteBatch::Handler {
+ public:
+  BufferHandler(const BatchableDB* db, rocksdb::WriteBatchWithIndex* buffer,
+                std::vector<BatchRangeDeletion>* range_deletions)
+      : db_(db), buffer_(buffer), range_deletions_(range_deletions) {}
+
+  Status PutCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+    rocksdb::ColumnFamilyHandle* handle = db_->GetHandle(column_family_id);
+    if (handle == nullptr) {
+      return Status::InvalidArgument("unknown column family");
+    }
+    return buffer_->Put(handle, key, value);
+  }
+
+  Status DeleteCF(uint32_t column_family_id, const Slice& key) override {
+    rocksdb::ColumnFamilyHandle* handle = db_->GetHandle(column_family_id);
+    if (handle == nullptr) {
+      return Status::InvalidArgument("unknown column family");
+    }
+    return buffer_->Delete(handle, key);
+  }
+
+  Status SingleDeleteCF(uint32_t column_family_id, const Slice& key) override {
+    rocksdb::ColumnFamilyHandle* handle = db_->GetHandle(column_family_id);
+    if (handle == nullptr) {
+      return Status::InvalidArgument("unknown column family");
+    }
+    return buffer_->SingleDelete(handle, key);
+  }
+
+  Status DeleteRangeCF(uint32_t column_family_id, const Slice& begin_key, const Slice& end_key) override {
+    rocksdb::ColumnFamilyHandle* handle = db_->GetHandle(column_family_id);
+    if (handle == nullptr) {
+      return Status::InvalidArgument("unknown column family");
+    }
+    range_deletions_->push_back({handle, begin_key.ToString(), end_key.ToString()});
+    return Status::OK();
+  }
+
+  void LogData(const Slice& blob) override { buffer_->PutLogData(blob); }
+
+ private:
+  const BatchableDB* db_;
+  rocksdb::WriteBatchWithIndex* buffer_;
+  std::vector<BatchRangeDeletion>* range_deletions_;
+};
+
+BatchableDB::BatchableDB(rocksdb::DB* db, const std::vector<rocksdb::ColumnFamilyHandle*>& handles)
+    : rocksdb::StackableDB(db) {
+  for (auto handle : handles) {
+    handles_[handle->GetID()] = handle;
+  }
+}
+
+rocksdb::ColumnFamilyHandle* BatchableDB::GetHandle(uint32_t column_family_id) const {
+  auto iter = handles_.find(column_family_id);
+  return iter == handles_.end() ? nullptr : iter->second;
+}
+
+rocksdb::WriteBatchWithIndex* BatchableDB::ScopeBuffer(bool create) {
+  if (scope_buffers == nullptr) {
+    return nullptr;
+  }
+  for (auto& [db, buffer] : scope_buffers->dbs) {
+    if (db == this) {
+      return buffer.get();
+    }
+  }
+  if (!create) {
+    return nullptr;
+  }
+  // overwrite_key makes a read of the buffer see the last write of a key
+  scope_buffers->dbs.emplace_back(this,
+                                  std::make_unique<rocksdb::WriteBatchWithIndex>(rocksdb::BytewiseComparator(), 0, true));
+  return scope_buffers->dbs.back().second.get();
+}
+
+std::vector<BatchRangeDeletion>* BatchableDB::ScopeRangeDeletions() {
+  return scope_buffers == nullptr ? nullptr : &scope_buffers->range_deletions[this];
+}
+
+Status BatchableDB::Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                        const Slice& key, rocksdb::PinnableSlice* value) {
+  rocksdb::WriteBatchWithIndex* buffer = ScopeBuffer(false);
+  if (buffer == nullptr) {
+    return db_->Get(options, column_family, key, value);
+  }
+  return buffer->GetFromBatchAndDB(db_, options, column_family, key, value);
+}
+
+rocksdb::Iterator* BatchableDB::NewIterator(const rocksdb::ReadOptions& options,
+                                            rocksdb::ColumnFamilyHandle* column_family) {
+  rocksdb::WriteBatchWithIndex* buffer = ScopeBuffer(false);
+  rocksdb::Iterator* iter = db_->NewIterator(options, column_family);
+  if (buffer == nullptr) {
+    return iter;
+  }
+  return buffer->NewIteratorWithBase(column_family, iter, &options);
+}
+
+Status BatchableDB::Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                        const Slice& key, const Slice& value) {
+  rocksdb::WriteBatchWithIndex* buffer = ScopeBuffer(true);
+  if (buffer == nullptr) {
+    return db_->Put(options, column_family, key, value);
+  }
+  return buffer->Put(column_family, key, value);
+}
+
+Status BatchableDB::Delete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                           const Slice& key) {
+  rocksdb::WriteBatchWithIndex* buffer = ScopeBuffer(true);
+  if (buffer == nullptr) {
+    return db_->Delete(options, column_family, key);
+  }
+  return buffer->Delete(column_family, key);
+}
+
+Status BatchableDB::Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) {
+  rocksdb::WriteBatchWithIndex* buffer = ScopeBuffer(true);
+  if (buffer == nullptr) {
+    return db_->Write(options, updates);
+  }
+  BufferHandler handler(this, buffer, ScopeRangeDeletions());
+  return updates->Iterate(&handler);
+}
+
+BatchWriteScope::BatchWriteScope() : buffers_(std::make_unique<BatchWriteBuffers>()) {
+  assert(scope_buffers == nullptr);
+  scope_buffers = buffers_.get();
+}
+
+BatchWriteScope::~BatchWriteScope() { scope_buffers = nullptr; }
+
+Status BatchWriteScope::Commit() {
+  Status s;
+  bool written = false;
+  for (auto& [db, buffer] : buffers_->dbs) {
+    rocksdb::WriteBatch* updates = buffer->GetWriteBatch();
+    rocksdb::WriteBatch with_ranges;
+    auto ranges = buffers_->range_deletions.find(db);
+    if (ranges != buffers_->range_deletions.end() && !ranges->second.empty()) {
+      with_ranges = *updates;
+      for (const auto& range : ranges->second) {
+        with_ranges.DeleteRange(range.column_family, range.begin_key, range.end_key);
+      }
+      updates = &with_ranges;
+    }
+    if (updates->Count() == 0) {
+      continue;
+    }
+    s = db->GetBaseDB()->Write(rocksdb::WriteOptions(), updates);
+    if (!s.ok()) {
+      // the types written before can not be taken back, and the caller
+      // neither replies nor logs a scope that failed
+      LOG_IF(FATAL, written) << "BatchWriteScope committed in part, " << s.ToString();
+      break;
+    }
+    written = true;
+  }
+  buffers_->dbs.clear();
+  buffers_->range_deletions.clear();
+  if (s.ok()) {
+    for (const auto& callback : buffers_->on_commit) {
+      callback();
+    }
+  }
+  buffers_->on_commit.clear();
+  return s;
+}
+
+bool BatchWriteScope::RunAtCommit(std::function<void()> callback) {
+  if (scope_buffers == nullptr) {
+    return false;
+  }
+  scope_buffers->on_commit.push_back(std::move(callback));
+  return true;
+}
+
+}  //  namespace storage
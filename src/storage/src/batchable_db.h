@@ -0,0 +1,82 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_BATCHABLE_DB_H_
+#define SRC_BATCHABLE_DB_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/utilities/stackable_db.h"
+#include "rocksdb/utilities/write_batch_with_index.h"
+
+namespace storage {
+
+class BatchableDB;
+
+struct BatchRangeDeletion {
+  rocksdb::ColumnFamilyHandle* column_family;
+  std::string begin_key;
+  std::string end_key;
+};
+
+// The buffers of the BatchWriteScope of a thread, one per db written
+struct BatchWriteBuffers {
+  std::vector<std::pair<BatchableDB*, std::unique_ptr<rocksdb::WriteBatchWithIndex>>> dbs;
+  // the range deletions of each db, written after its buffer at the commit.
+  // The index can not serve their reads, so the reads of the scope do not see
+  // them, they are for the data no reader reaches, like a dropped version
+  std::unordered_map<BatchableDB*, std::vector<BatchRangeDeletion>> range_deletions;
+  // run once the buffers are written
+  std::vector<std::function<void()>> on_commit;
+};
+
+/*
+ * BatchableDB is the db of every data type. Out of a BatchWriteScope it only
+ * passes the calls through. In a scope, the writes of the thread go into the
+ * buffer of this db instead, and the reads and iterators of the thread see the
+ * buffer merged over the db, so the data types work unchanged on top of it
+ */
+class BatchableDB : public rocksdb::StackableDB {
+ public:
+  // handles are the column families of db, the buffered writes are indexed
+  // with the comparators of them
+  BatchableDB(rocksdb::DB* db, const std::vector<rocksdb::ColumnFamilyHandle*>& handles);
+
+  using rocksdb::StackableDB::Get;
+  rocksdb::Status Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                      const rocksdb::Slice& key, rocksdb::PinnableSlice* value) override;
+
+  using rocksdb::StackableDB::NewIterator;
+  rocksdb::Iterator* NewIterator(const rocksdb::ReadOptions& options,
+                                 rocksdb::ColumnFamilyHandle* column_family) override;
+
+  using rocksdb::StackableDB::Put;
+  rocksdb::Status Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                      const rocksdb::Slice& key, const rocksdb::Slice& value) override;
+
+  using rocksdb::StackableDB::Delete;
+  rocksdb::Status Delete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+                         const rocksdb::Slice& key) override;
+
+  rocksdb::Status Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) override;
+
+  rocksdb::ColumnFamilyHandle* GetHandle(uint32_t column_family_id) const;
+
+ private:
+  // The buffer of this db in the scope of the calling thread, nullptr out of
+  // a scope, or if create is false and nothing was written yet
+  rocksdb::WriteBatchWithIndex* ScopeBuffer(bool create);
+  std::vector<BatchRangeDeletion>* ScopeRangeDeletions();
+
+  std::unordered_map<uint32_t, rocksdb::ColumnFamilyHandle*> handles_;
+};
+
+}  //  namespace storage
+#endif  //  SRC_BATCHABLE_DB_H_
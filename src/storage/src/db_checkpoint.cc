@@ -16,10 +16,14 @@
 #  endif
 
 #  include <cinttypes>
+#  include <unordered_map>
 
 #include <glog/logging.h>
+#  include "db/log_reader.h"
 #  include "file/file_util.h"
+#  include "file/sequential_file_reader.h"
 #  include "rocksdb/db.h"
+#  include "util/coding.h"
 // #include "file/filename.h"
 
 namespace rocksdb {
@@ -48,8 +52,48 @@ class DBCheckpointImpl : public DBCheckpoint {
                                    VectorLogPtr& live_wal_files, uint64_t manifest_file_size,
                                    uint64_t sequence_number) override;
 
+  using DBCheckpoint::GetCheckpointFilesAt;
+  Status GetCheckpointFilesAt(uint64_t sequence_number, std::vector<std::string>& live_files,
+                              VectorLogPtr& live_wal_files, uint64_t& manifest_file_size,
+                              uint64_t& last_wal_size) override;
+
+  using DBCheckpoint::CreateCheckpointWithFilesAt;
+  Status CreateCheckpointWithFilesAt(const std::string& checkpoint_dir, std::vector<std::string>& live_files,
+                                     VectorLogPtr& live_wal_files, uint64_t manifest_file_size,
+                                     uint64_t sequence_number, uint64_t last_wal_size) override;
+
+  void ReleaseCheckpointFiles() override;
+
+  void SetBaseCheckpoint(const std::string& base_dir) override { base_dir_ = base_dir; }
+
+  std::vector<CheckpointFile> LastCheckpointFiles() override { return files_; }
+
  private:
+  std::string WalDir();
+  // The end of the last record of the wal file with writes up to sequence_number
+  Status WalSizeAt(const LogFile& wal_file, uint64_t sequence_number, uint64_t* size);
+  // last_wal_size is the size of the last wal file to copy when pinned, all
+  // the wal files given are copied then
+  Status CreateCheckpointImpl(const std::string& checkpoint_dir, std::vector<std::string>& live_files,
+                              VectorLogPtr& live_wal_files, uint64_t manifest_file_size, uint64_t sequence_number,
+                              bool pinned, uint64_t last_wal_size);
+  // Link the sst file to the same one of the base checkpoint, false if there is none
+  bool LinkBaseFile(const std::string& fname, const std::string& dst_dir);
+  void TrackFile(const std::string& fname, const std::string& dst_dir, CheckpointFile::Source source);
+
   DB* db_;
+  std::string base_dir_;
+  std::vector<CheckpointFile> files_;
+};
+
+// Collects the first corruption met reading a wal file
+struct WalReporter : public log::Reader::Reporter {
+  Status status;
+  void Corruption(size_t /*bytes*/, const Status& s) override {
+    if (status.ok()) {
+      status = s;
+    }
+  }
 };
 
 Status DBCheckpoint::Create(DB* db, DBCheckpoint** checkpoint_ptr) {
@@ -95,10 +139,153 @@ Status DBCheckpointImpl::GetCheckpointFiles(std::vector<std::string>& live_files
   return s;
 }
 
+Status DBCheckpointImpl::GetCheckpointFilesAt(uint64_t sequence_number, std::vector<std::string>& live_files,
+                                              VectorLogPtr& live_wal_files, uint64_t& manifest_file_size,
+                                              uint64_t& last_wal_size) {
+  Status s = db_->DisableFileDeletions();
+  if (s.ok()) {
+    // the memtables are left as they are, their writes are in the wal files
+    s = db_->GetLiveFiles(live_files, &manifest_file_size, false);
+  }
+
+  // every sst file listed must hold no write after sequence_number
+  if (s.ok()) {
+    std::vector<LiveFileMetaData> metadata;
+    db_->GetLiveFilesMetaData(&metadata);
+    std::unordered_map<uint64_t, SequenceNumber> largest_seqnos;
+    for (const auto& file : metadata) {
+      uint64_t number;
+      FileType type;
+      if (ParseFileName(file.name, &number, &type)) {
+        largest_seqnos[number] = file.largest_seqno;
+      }
+    }
+    for (const auto& live_file : live_files) {
+      uint64_t number;
+      FileType type;
+      if (!ParseFileName(live_file, &number, &type) || type != kTableFile) {
+        continue;
+      }
+      auto iter = largest_seqnos.find(number);
+      if (iter == largest_seqnos.end() || iter->second > sequence_number) {
+        s = Status::Busy("Flushed after the sequence number");
+        break;
+      }
+    }
+  }
+
+  VectorLogPtr wal_files;
+  if (s.ok()) {
+    s = db_->GetSortedWalFiles(wal_files);
+  }
+  if (s.ok()) {
+    // an empty wal file, of start sequence 0, has no write up to sequence_number,
+    // of the files left only the last one may have writes after it
+    live_wal_files.clear();
+    for (auto& wal_file : wal_files) {
+      if (wal_file->Type() == kAliveLogFile && wal_file->StartSequence() != 0 &&
+          wal_file->StartSequence() <= sequence_number) {
+        live_wal_files.push_back(std::move(wal_file));
+      }
+    }
+    last_wal_size = 0;
+    if (!live_wal_files.empty()) {
+      s = WalSizeAt(*live_wal_files.back(), sequence_number, &last_wal_size);
+    }
+  }
+
+  if (!s.ok()) {
+    db_->EnableFileDeletions(false);
+  }
+  return s;
+}
+
+Status DBCheckpointImpl::WalSizeAt(const LogFile& wal_file, uint64_t sequence_number, uint64_t* size) {
+  std::string fname = WalDir() + wal_file.PathName();
+  std::unique_ptr<FSSequentialFile> file;
+  IOStatus io_s = db_->GetFileSystem()->NewSequentialFile(fname, FileOptions(db_->GetDBOptions()), &file, nullptr);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  std::unique_ptr<SequentialFileReader> file_reader(new SequentialFileReader(std::move(file), fname));
+  WalReporter reporter;
+  log::Reader reader(nullptr, std::move(file_reader), &reporter, true, wal_file.LogNumber());
+
+  // a record is a write batch, led by its sequence number, the writes of a
+  // batch are made visible together so a batch is either all in or all out
+  Slice record;
+  std::string scratch;
+  *size = 0;
+  while (reader.ReadRecord(&record, &scratch)) {
+    if (record.size() < sizeof(uint64_t) || DecodeFixed64(record.data()) > sequence_number) {
+      break;
+    }
+    *size = reader.LastRecordEnd();
+  }
+  // a record being written at the tail is seen as corrupted, it is after
+  // sequence_number anyway, but the file starts at or before sequence_number
+  if (*size == 0) {
+    return reporter.status.ok() ? Status::Corruption("No write up to the sequence number", fname) : reporter.status;
+  }
+  return Status::OK();
+}
+
+void DBCheckpointImpl::ReleaseCheckpointFiles() { db_->EnableFileDeletions(false); }
+
+bool DBCheckpointImpl::LinkBaseFile(const std::string& fname, const std::string& dst_dir) {
+  if (base_dir_.empty()) {
+    return false;
+  }
+  // the file numbers are not reused by a db, the same name and size is the same file
+  uint64_t db_size = 0;
+  uint64_t base_size = 0;
+  if (!db_->GetEnv()->GetFileSize(db_->GetName() + fname, &db_size).ok() ||
+      !db_->GetEnv()->GetFileSize(base_dir_ + fname, &base_size).ok() || db_size != base_size) {
+    return false;
+  }
+  Log(db_->GetOptions().info_log, "Hard Linking %s of the base checkpoint", fname.c_str());
+  return db_->GetEnv()->LinkFile(base_dir_ + fname, dst_dir + fname).ok();
+}
+
+void DBCheckpointImpl::TrackFile(const std::string& fname, const std::string& dst_dir,
+                                 CheckpointFile::Source source) {
+  CheckpointFile file;
+  file.name = fname;
+  file.source = source;
+  db_->GetEnv()->GetFileSize(dst_dir + fname, &file.size);
+  files_.push_back(std::move(file));
+}
+
+std::string DBCheckpointImpl::WalDir() {
+  // if wal_dir eq db path, rocksdb will clear it when opening
+  // make wal_dir valid in that case
+  std::string wal_dir = db_->GetOptions().wal_dir;
+  if (wal_dir.empty()) {
+    wal_dir = db_->GetOptions().db_paths[0].path;
+  }
+  return wal_dir;
+}
+
 Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint_dir,
                                                    std::vector<std::string>& live_files, VectorLogPtr& live_wal_files,
                                                    uint64_t manifest_file_size, uint64_t sequence_number) {
+  return CreateCheckpointImpl(checkpoint_dir, live_files, live_wal_files, manifest_file_size, sequence_number, false,
+                              0);
+}
+
+Status DBCheckpointImpl::CreateCheckpointWithFilesAt(const std::string& checkpoint_dir,
+                                                     std::vector<std::string>& live_files,
+                                                     VectorLogPtr& live_wal_files, uint64_t manifest_file_size,
+                                                     uint64_t sequence_number, uint64_t last_wal_size) {
+  return CreateCheckpointImpl(checkpoint_dir, live_files, live_wal_files, manifest_file_size, sequence_number, true,
+                              last_wal_size);
+}
+
+Status DBCheckpointImpl::CreateCheckpointImpl(const std::string& checkpoint_dir, std::vector<std::string>& live_files,
+                                              VectorLogPtr& live_wal_files, uint64_t manifest_file_size,
+                                              uint64_t sequence_number, bool pinned, uint64_t last_wal_size) {
   bool same_fs = true;
+  files_.clear();
 
   Status s = db_->GetEnv()->FileExists(checkpoint_dir);
   if (s.ok()) {
@@ -108,12 +295,7 @@ Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint
     return s;
   }
 
-  // if wal_dir eq db path, rocksdb will clear it when opening
-  // make wal_dir valid in that case
-  std::string wal_dir = db_->GetOptions().wal_dir;
-  if (wal_dir.empty()) {
-    wal_dir = db_->GetOptions().db_paths[0].path;
-  }
+  std::string wal_dir = WalDir();
 
   size_t wal_size = live_wal_files.size();
   Log(db_->GetOptions().info_log, "Started the snapshot process -- creating snapshot in directory %s",
@@ -153,15 +335,20 @@ Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint
     // * if it's kTableFile, then it's shared
     // * if it's kDescriptorFile, limit the size to manifest_file_size
     // * always copy if cross-device link
+    // * if cross-device, link the sst file of the base checkpoint if it has it
     if ((type == kTableFile) && same_fs) {
       Log(db_->GetOptions().info_log, "Hard Linking %s", src_fname.c_str());
       s = db_->GetEnv()->LinkFile(db_->GetName() + src_fname, full_private_path + src_fname);
       if (s.IsNotSupported()) {
         same_fs = false;
         s = Status::OK();
+      } else if (s.ok()) {
+        TrackFile(src_fname, full_private_path, CheckpointFile::kLinkedDB);
       }
     }
-    if ((type != kTableFile) || (!same_fs)) {
+    if ((type == kTableFile) && !same_fs && LinkBaseFile(src_fname, full_private_path)) {
+      TrackFile(src_fname, full_private_path, CheckpointFile::kLinkedBase);
+    } else if ((type != kTableFile) || (!same_fs)) {
       Log(db_->GetOptions().info_log, "Copying %s", src_fname.c_str());
 #  if (ROCKSDB_MAJOR < 5 || (ROCKSDB_MAJOR == 5 && ROCKSDB_MINOR < 3))
       s = CopyFile(db_->GetEnv(), db_->GetName() + src_fname, full_private_path + src_fname,
@@ -170,6 +357,9 @@ Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint
       s = CopyFile(db_->GetFileSystem(), db_->GetName() + src_fname, full_private_path + src_fname,
                    (type == kDescriptorFile) ? manifest_file_size : 0, false, nullptr, Temperature::kUnknown);
 #  endif
+      if (s.ok()) {
+        TrackFile(src_fname, full_private_path, CheckpointFile::kCopied);
+      }
     }
   }
   if (s.ok() && !current_fname.empty() && !manifest_fname.empty()) {
@@ -184,19 +374,25 @@ Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint
   //    "Number of log files %" ROCKSDB_PRIszt, live_wal_files.size());
 
   // Link WAL files. Copy exact size of last one because it is the only one
-  // that has changes after the last flush.
+  // that has changes after the last flush. When pinned the WAL files are the
+  // ones to keep, the last one cut at the pinned sequence number.
   for (size_t i = 0; s.ok() && i < wal_size; ++i) {
-    if ((live_wal_files[i]->Type() == kAliveLogFile) && (live_wal_files[i]->StartSequence() >= sequence_number)) {
+    if ((live_wal_files[i]->Type() == kAliveLogFile) &&
+        (pinned || live_wal_files[i]->StartSequence() >= sequence_number)) {
       if (i + 1 == wal_size) {
+        uint64_t copy_size = pinned ? last_wal_size : live_wal_files[i]->SizeFileBytes();
         Log(db_->GetOptions().info_log, "Copying %s", live_wal_files[i]->PathName().c_str());
 #  if (ROCKSDB_MAJOR < 5 || (ROCKSDB_MAJOR == 5 && ROCKSDB_MINOR < 3))
         s = CopyFile(db_->GetEnv(), wal_dir + live_wal_files[i]->PathName(),
-                     full_private_path + live_wal_files[i]->PathName(), live_wal_files[i]->SizeFileBytes());
+                     full_private_path + live_wal_files[i]->PathName(), copy_size);
 #  else
         s = CopyFile(db_->GetFileSystem(), wal_dir + live_wal_files[i]->PathName(),
-                     full_private_path + live_wal_files[i]->PathName(), live_wal_files[i]->SizeFileBytes(), false,
-                     nullptr, Temperature::kUnknown);
+                     full_private_path + live_wal_files[i]->PathName(), copy_size, false, nullptr,
+                     Temperature::kUnknown);
 #  endif
+        if (s.ok()) {
+          TrackFile(live_wal_files[i]->PathName(), full_private_path, CheckpointFile::kCopied);
+        }
         break;
       }
       if (same_fs) {
@@ -207,6 +403,8 @@ Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint
         if (s.IsNotSupported()) {
           same_fs = false;
           s = Status::OK();
+        } else if (s.ok()) {
+          TrackFile(live_wal_files[i]->PathName(), full_private_path, CheckpointFile::kLinkedDB);
         }
       }
       if (!same_fs) {
@@ -218,6 +416,9 @@ Status DBCheckpointImpl::CreateCheckpointWithFiles(const std::string& checkpoint
         s = CopyFile(db_->GetFileSystem(), wal_dir + live_wal_files[i]->PathName(),
                      full_private_path + live_wal_files[i]->PathName(), 0, false, nullptr, Temperature::kUnknown);
 #  endif
+        if (s.ok()) {
+          TrackFile(live_wal_files[i]->PathName(), full_private_path, CheckpointFile::kCopied);
+        }
       }
     }
   }
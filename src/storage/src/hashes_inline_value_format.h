@@ -0,0 +1,172 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_HASHES_INLINE_VALUE_FORMAT_H_
+#define SRC_HASHES_INLINE_VALUE_FORMAT_H_
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pstd/include/pstd_coding.h"
+#include "src/coding.h"
+#include "storage/storage.h"
+
+namespace storage {
+
+/*
+ * A small hash keeps its fields in the user value of its meta value, with
+ * no data key, as
+ *
+ *   | count | kInlineHashFormat | field_size | field | value_size | value | expire | ... |
+ *
+ * the count of 4 bytes first like in every meta value, then one byte telling
+ * the fields follow, each with its sizes and expire as varint32, the expire
+ * being the unix time the field lives until, 0 for ever. The fields are in
+ * the order of their data keys, and the count includes the expired fields
+ * until a write or the reaper drops them.
+ */
+const char kInlineHashFormat = 1;
+
+struct InlineHashField {
+  std::string field;
+  std::string value;
+  int32_t expire = 0;
+  bool IsExpired(int32_t now) const { return expire != 0 && expire < now; }
+};
+
+inline bool IsInlineHashMeta(const Slice& user_value) {
+  return user_value.size() > sizeof(int32_t) && user_value[sizeof(int32_t)] == kInlineHashFormat;
+}
+
+// The user value of the meta value of an inline hash
+inline std::string EncodeInlineHash(const std::vector<InlineHashField>& fields) {
+  std::string user_value(sizeof(int32_t), '\0');
+  EncodeFixed32(user_value.data(), fields.size());
+  user_value.push_back(kInlineHashFormat);
+  for (const auto& field : fields) {
+    pstd::PutVarint32(&user_value, field.field.size());
+    user_value.append(field.field);
+    pstd::PutVarint32(&user_value, field.value.size());
+    user_value.append(field.value);
+    pstd::PutVarint32(&user_value, static_cast<uint32_t>(field.expire));
+  }
+  return user_value;
+}
+
+// The fields of an inline hash alive at now, all of them if now is 0
+inline Status DecodeInlineHash(const Slice& user_value, int32_t now, std::vector<InlineHashField>* fields) {
+  fields->clear();
+  const char* p = user_value.data() + sizeof(int32_t) + 1;
+  const char* limit = user_value.data() + user_value.size();
+  while (p < limit) {
+    InlineHashField field;
+    uint32_t size = 0;
+    uint32_t expire = 0;
+    if ((p = pstd::GetVarint32Ptr(p, limit, &size)) == nullptr || size > static_cast<size_t>(limit - p)) {
+      return Status::Corruption("inline hash field");
+    }
+    field.field.assign(p, size);
+    p += size;
+    if ((p = pstd::GetVarint32Ptr(p, limit, &size)) == nullptr || size > static_cast<size_t>(limit - p)) {
+      return Status::Corruption("inline hash value");
+    }
+    field.value.assign(p, size);
+    p += size;
+    if ((p = pstd::GetVarint32Ptr(p, limit, &expire)) == nullptr) {
+      return Status::Corruption("inline hash expire");
+    }
+    field.expire = static_cast<int32_t>(expire);
+    if (now == 0 || !field.IsExpired(now)) {
+      fields->push_back(std::move(field));
+    }
+  }
+  return Status::OK();
+}
+
+// The position of field in fields, or of the first field after it
+inline std::vector<InlineHashField>::iterator LowerBoundInlineField(std::vector<InlineHashField>* fields,
+                                                                    const Slice& field) {
+  return std::lower_bound(fields->begin(), fields->end(), field, [](const InlineHashField& f, const Slice& target) {
+    return Slice(f.field).compare(target) < 0;
+  });
+}
+
+inline InlineHashField* FindInlineField(std::vector<InlineHashField>* fields, const Slice& field) {
+  auto iter = LowerBoundInlineField(fields, field);
+  return iter != fields->end() && Slice(iter->field) == field ? &*iter : nullptr;
+}
+
+// The earliest expire of the fields, 0 if none expires
+inline int32_t EarliestInlineFieldExpire(const std::vector<InlineHashField>& fields) {
+  int32_t earliest = 0;
+  for (const auto& field : fields) {
+    if (field.expire != 0 && (earliest == 0 || field.expire < earliest)) {
+      earliest = field.expire;
+    }
+  }
+  return earliest;
+}
+
+/*
+ * A hash of data keys some of whose fields expire has kExpiringHashFormat
+ * after the count of its meta value, and every data value of it carries the
+ * expire of its field, as
+ *
+ *   | value | expire |
+ *
+ * the expire as fixed32, 0 for ever. The count includes the expired fields
+ * until a write or the reaper drops them, the reaper being indexed at every
+ * expire of the fields.
+ */
+const char kExpiringHashFormat = 2;
+
+inline bool IsExpiringHashMeta(const Slice& user_value) {
+  return user_value.size() > sizeof(int32_t) && user_value[sizeof(int32_t)] == kExpiringHashFormat;
+}
+
+// The user value of the meta value of an expiring hash of count fields
+inline std::string ExpiringHashUserValue(int32_t count) {
+  std::string user_value(sizeof(int32_t), '\0');
+  EncodeFixed32(user_value.data(), count);
+  user_value.push_back(kExpiringHashFormat);
+  return user_value;
+}
+
+inline std::string EncodeExpiringValue(const Slice& value, int32_t expire) {
+  std::string data_value;
+  data_value.reserve(value.size() + sizeof(int32_t));
+  data_value.append(value.data(), value.size());
+  char buf[sizeof(int32_t)];
+  EncodeFixed32(buf, static_cast<uint32_t>(expire));
+  data_value.append(buf, sizeof(int32_t));
+  return data_value;
+}
+
+inline Status DecodeExpiringValue(const Slice& data_value, Slice* value, int32_t* expire) {
+  if (data_value.size() < sizeof(int32_t)) {
+    return Status::Corruption("expiring hash value");
+  }
+  *value = Slice(data_value.data(), data_value.size() - sizeof(int32_t));
+  *expire = static_cast<int32_t>(DecodeFixed32(data_value.data() + value->size()));
+  return Status::OK();
+}
+
+inline bool FieldExpired(int32_t expire, int32_t now) { return expire != 0 && expire < now; }
+
+// The value of data_value of a hash of data keys, false if its field expired
+// at now
+inline bool AliveDataValue(const Slice& data_value, bool expiring, int32_t now, Slice* value) {
+  if (!expiring) {
+    *value = data_value;
+    return true;
+  }
+  int32_t expire = 0;
+  return DecodeExpiringValue(data_value, value, &expire).ok() && !FieldExpired(expire, now);
+}
+
+}  //  namespace storage
+#endif  // SRC_HASHES_INLINE_VALUE_FORMAT_H_
@@ -4,18 +4,58 @@
 //  of patent rights can be found in the PATENTS file in the same directory.
 
 #include "src/redis.h"
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
+#include "rocksdb/env.h"
+#include "rocksdb/utilities/table_properties_collectors.h"
+
+#include "src/base_data_key_format.h"
+#include "src/batchable_db.h"
+#include "src/scope_record_lock.h"
+#include "src/zsets_data_key_format.h"
+
 namespace storage {
 
+// The index is consumed from its head like a queue, compact the files which
+// are dense with the tombstones it leaves behind
+static const size_t kExpireIndexDeletionWindow = 1024;
+static const size_t kExpireIndexDeletionTrigger = 512;
+// check the deadline of ReapExpiredKeys every this many keys
+static const int64_t kReapDeadlineCheckInterval = 16;
+// the cursors kept for the scans of the members of the keys, in all
+static const size_t kScanCursorCapacity = 16 * 1024;
+
+// Expire index key: | timestamp (4 bytes, big endian) | user key |
+// big endian makes the bytewise order the order of the expire time
+std::string EncodeExpireIndexKey(const Slice& key, int32_t timestamp) {
+  std::string index_key;
+  index_key.reserve(sizeof(int32_t) + key.size());
+  auto ts = static_cast<uint32_t>(timestamp);
+  index_key.push_back(static_cast<char>(ts >> 24));
+  index_key.push_back(static_cast<char>(ts >> 16));
+  index_key.push_back(static_cast<char>(ts >> 8));
+  index_key.push_back(static_cast<char>(ts));
+  index_key.append(key.data(), key.size());
+  return index_key;
+}
+
+static void DecodeExpireIndexKey(const Slice& index_key, int32_t* timestamp, Slice* key) {
+  const auto* p = reinterpret_cast<const unsigned char*>(index_key.data());
+  *timestamp = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                                    (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]));
+  *key = Slice(index_key.data() + sizeof(int32_t), index_key.size() - sizeof(int32_t));
+}
+
 Redis::Redis(Storage* const s, const DataType& type)
     : storage_(s),
       type_(type),
-      lock_mgr_(std::make_shared<LockMgr>(1000, 0, std::make_shared<MutexFactoryImpl>())),
+      lock_mgr_(s->GetLockMgr()),
+      sst_size_tracker_(std::make_shared<SstSizeTracker>()),
       small_compaction_threshold_(5000) {
   statistics_store_ = std::make_unique<LRUCache<std::string, size_t>>();
-  scan_cursors_store_ = std::make_unique<LRUCache<std::string, std::string>>();
-  scan_cursors_store_->SetCapacity(5000);
+  scan_cursors_store_ = std::make_unique<ScanCursorStore>(kScanCursorCapacity);
   default_compact_range_options_.exclusive_manual_compaction = false;
   default_compact_range_options_.change_level = true;
   handles_.clear();
@@ -30,6 +70,61 @@ Redis::~Redis() {
   delete db_;
 }
 
+Status Redis::OpenDB(const rocksdb::DBOptions& db_options, const std::string& db_path,
+                     const std::vector<rocksdb::ColumnFamilyDescriptor>& column_families) {
+  db_ = nullptr;
+  rocksdb::DB* db = nullptr;
+  rocksdb::DBOptions ops(db_options);
+  ops.listeners.push_back(sst_size_tracker_);
+  Status s = rocksdb::DB::Open(ops, db_path, column_families, &handles_, &db);
+  if (!s.ok()) {
+    return s;
+  }
+  sst_size_tracker_->Seed(db);
+  db_ = new BatchableDB(db, handles_);
+  return s;
+}
+
+void Redis::GetSstFilesSize(std::map<std::string, SstFilesSize>* sizes) {
+  std::map<std::string, uint64_t> total;
+  sst_size_tracker_->GetColumnFamilySize(&total);
+  for (auto handle : handles_) {
+    SstFilesSize& size = (*sizes)[handle->GetName()];
+    db_->GetIntProperty(handle, rocksdb::DB::Properties::kLiveSstFilesSize, &size.live);
+    size.total = total[handle->GetName()];
+  }
+}
+
+Status Redis::IngestExternalFiles(const std::string& path) {
+  rocksdb::Env* env = rocksdb::Env::Default();
+  std::vector<rocksdb::IngestExternalFileArg> args;
+  for (auto handle : handles_) {
+    std::string dir = path + "/" + handle->GetName();
+    std::vector<std::string> children;
+    if (!env->GetChildren(dir, &children).ok()) {
+      continue;
+    }
+    rocksdb::IngestExternalFileArg arg;
+    arg.column_family = handle;
+    for (const auto& child : children) {
+      if (child.size() > 4 && child.compare(child.size() - 4, 4, ".sst") == 0) {
+        arg.external_files.push_back(dir + "/" + child);
+      }
+    }
+    if (arg.external_files.empty()) {
+      continue;
+    }
+    std::sort(arg.external_files.begin(), arg.external_files.end());
+    // the files are linked into the db instead of copied when they can be
+    arg.options.move_files = true;
+    args.push_back(std::move(arg));
+  }
+  if (args.empty()) {
+    return Status::OK();
+  }
+  return db_->IngestExternalFiles(args);
+}
+
 Status Redis::GetScanStartPoint(const Slice& key, const Slice& pattern, int64_t cursor, std::string* start_point) {
   std::string index_key = key.ToString() + "_" + pattern.ToString() + "_" + std::to_string(cursor);
   return scan_cursors_store_->Lookup(index_key, start_point);
@@ -41,6 +136,108 @@ Status Redis::StoreScanNextPoint(const Slice& key, const Slice& pattern, int64_t
   return scan_cursors_store_->Insert(index_key, next_point);
 }
 
+rocksdb::ColumnFamilyOptions Redis::ExpireIndexCfOptions(const StorageOptions& storage_options) {
+  rocksdb::ColumnFamilyOptions ops(storage_options.options);
+  ops.compaction_filter_factory = nullptr;
+  ops.table_properties_collector_factories.push_back(
+      rocksdb::NewCompactOnDeletionCollectorFactory(kExpireIndexDeletionWindow, kExpireIndexDeletionTrigger));
+  return ops;
+}
+
+void Redis::AddExpireIndex(rocksdb::WriteBatch* batch, const Slice& key, int32_t timestamp) {
+  if (timestamp > 0) {
+    batch->Put(ExpireIndexCf(), EncodeExpireIndexKey(key, timestamp), Slice());
+  }
+}
+
+Status Redis::PutWithExpireIndex(rocksdb::ColumnFamilyHandle* cf, const Slice& key, const Slice& value,
+                                 int32_t timestamp) {
+  rocksdb::WriteBatch batch;
+  batch.Put(cf, key, value);
+  AddExpireIndex(&batch, key, timestamp);
+  return db_->Write(default_write_options_, &batch);
+}
+
+void Redis::DeleteDataRange(rocksdb::WriteBatch* batch, rocksdb::ColumnFamilyHandle* cf, const Slice& key,
+                            int32_t version, DataKeyOrder order) {
+  std::string begin;
+  std::string end;
+  if (order == DataKeyOrder::kListsIndex) {
+    // the comparator orders the version as a number
+    begin = BaseDataKey(key, version, Slice()).Encode().ToString();
+    end = BaseDataKey(key, version + 1, Slice()).Encode().ToString();
+  } else if (order == DataKeyOrder::kZSetsScore) {
+    // the comparator orders the key and version bytewise, then the score as
+    // a number, and needs the score in every key. The end is the next key
+    // and version of the same size, so no other key sorts in between
+    double lowest = -std::numeric_limits<double>::infinity();
+    begin = ZSetsScoreKey(key, version, lowest, Slice()).Encode().ToString();
+    end = begin;
+    size_t pos = sizeof(int32_t) + key.size() + sizeof(int32_t);
+    while (pos > sizeof(int32_t) && static_cast<unsigned char>(end[pos - 1]) == 0xff) {
+      end[--pos] = '\0';
+    }
+    if (pos == sizeof(int32_t)) {
+      // left to the data filter
+      return;
+    }
+    end[pos - 1] = static_cast<char>(static_cast<unsigned char>(end[pos - 1]) + 1);
+  } else {
+    // the shortest string greater than every key prefixed by begin
+    begin = BaseDataKey(key, version, Slice()).Encode().ToString();
+    end = begin;
+    while (!end.empty() && static_cast<unsigned char>(end.back()) == 0xff) {
+      end.pop_back();
+    }
+    if (end.empty()) {
+      return;
+    }
+    end.back() = static_cast<char>(static_cast<unsigned char>(end.back()) + 1);
+  }
+  batch->DeleteRange(cf, begin, end);
+}
+
+Status Redis::ReapExpiredKeys(uint64_t deadline_us, int64_t* reaped) {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  // the entries expired before now, the same as ParsedInternalValue::IsStale()
+  std::string upper = EncodeExpireIndexKey(Slice(), static_cast<int32_t>(unix_time));
+  rocksdb::Slice upper_bound(upper);
+  rocksdb::ReadOptions read_options;
+  read_options.iterate_upper_bound = &upper_bound;
+  read_options.fill_cache = false;
+
+  std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(read_options, ExpireIndexCf()));
+  int64_t handled = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    int32_t timestamp;
+    Slice key;
+    DecodeExpireIndexKey(iter->key(), &timestamp, &key);
+    {
+      ScopeRecordLock l(lock_mgr_, key);
+      rocksdb::WriteBatch batch;
+      Status s = ReapExpiredKey(key, timestamp, &batch);
+      if (!s.ok()) {
+        return s;
+      }
+      bool reaped_key = batch.Count() != 0;
+      batch.Delete(ExpireIndexCf(), iter->key());
+      s = db_->Write(default_write_options_, &batch);
+      if (!s.ok()) {
+        return s;
+      }
+      if (reaped_key) {
+        storage_->NotifyKeyReaped(key);
+      }
+    }
+    (*reaped)++;
+    if (++handled % kReapDeadlineCheckInterval == 0 && rocksdb::Env::Default()->NowMicros() >= deadline_us) {
+      break;
+    }
+  }
+  return iter->status();
+}
+
 Status Redis::SetMaxCacheStatisticKeys(size_t max_cache_statistic_keys) {
   statistics_store_->SetCapacity(max_cache_statistic_keys);
   return Status::OK();
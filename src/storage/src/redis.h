@@ -13,16 +13,25 @@
 #include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
+#include "rocksdb/write_batch.h"
 
 #include "src/lock_mgr.h"
 #include "src/lru_cache.h"
 #include "src/mutex_impl.h"
+#include "src/scan_cursor_store.h"
+#include "src/sst_size_tracker.h"
 #include "storage/storage.h"
 
 namespace storage {
 using Status = rocksdb::Status;
 using Slice = rocksdb::Slice;
 
+// Column family of the expire index, the keys with a ttl ordered by the time
+// they expire, see EncodeExpireIndexKey()
+inline const std::string kExpireIndexCf = "expire_cf";
+// The key of the expire index entry of key expiring at timestamp
+std::string EncodeExpireIndexKey(const Slice& key, int32_t timestamp);
+
 class Redis {
  public:
   Redis(Storage* storage, const DataType& type);
@@ -52,15 +61,28 @@ class Redis {
   virtual Status Persist(const Slice& key) = 0;
   virtual Status TTL(const Slice& key, int64_t* timestamp) = 0;
 
+  // Remove the keys whose ttl is due according to the expire index, until
+  // the deadline passed. *reaped is increased by the number of index entries
+  // handled
+  Status ReapExpiredKeys(uint64_t deadline_us, int64_t* reaped);
+
   Status SetMaxCacheStatisticKeys(size_t max_cache_statistic_keys);
   Status SetSmallCompactionThreshold(size_t small_compaction_threshold);
   void GetRocksDBInfo(std::string &info, const char *prefix);
+  // The size of the sst files on disk, O(1)
+  uint64_t GetTotalSstFilesSize() const { return sst_size_tracker_->total(); }
+  // The live and total size of the sst files of every column family, by name
+  void GetSstFilesSize(std::map<std::string, SstFilesSize>* sizes);
+  // Ingest the sst files under <path>/<column family>/ into the column
+  // families, all of them or none, see SstBuilder
+  Status IngestExternalFiles(const std::string& path);
 
  protected:
   Storage* const storage_;
   DataType type_;
   std::shared_ptr<LockMgr> lock_mgr_;
   rocksdb::DB* db_ = nullptr;
+  std::shared_ptr<SstSizeTracker> sst_size_tracker_;
 
   std::vector<rocksdb::ColumnFamilyHandle*> handles_;
   rocksdb::WriteOptions default_write_options_;
@@ -68,7 +90,27 @@ class Redis {
   rocksdb::CompactRangeOptions default_compact_range_options_;
 
   // For Scan
-  std::unique_ptr<LRUCache<std::string, std::string>> scan_cursors_store_;
+  std::unique_ptr<ScanCursorStore> scan_cursors_store_;
+
+  // Open the db with column_families into db_ and handles_, wrapped so the
+  // writes can be buffered by a BatchWriteScope
+  Status OpenDB(const rocksdb::DBOptions& db_options, const std::string& db_path,
+                const std::vector<rocksdb::ColumnFamilyDescriptor>& column_families);
+
+  // For the expire index, it is always the last column family
+  static rocksdb::ColumnFamilyOptions ExpireIndexCfOptions(const StorageOptions& storage_options);
+  rocksdb::ColumnFamilyHandle* ExpireIndexCf() { return handles_.back(); }
+  void AddExpireIndex(rocksdb::WriteBatch* batch, const Slice& key, int32_t timestamp);
+  // Put value of key into cf together with its expire index entry
+  Status PutWithExpireIndex(rocksdb::ColumnFamilyHandle* cf, const Slice& key, const Slice& value, int32_t timestamp);
+  // Add the removal of key to batch if it still expires at timestamp and is
+  // stale, invoker need to hold the record lock of key
+  virtual Status ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) = 0;
+  // The order of the keys of a data column family
+  enum class DataKeyOrder { kBytewise, kListsIndex, kZSetsScore };
+  // Range delete the data of key with version from cf ordered by order
+  static void DeleteDataRange(rocksdb::WriteBatch* batch, rocksdb::ColumnFamilyHandle* cf, const Slice& key,
+                              int32_t version, DataKeyOrder order);
 
   Status GetScanStartPoint(const Slice& key, const Slice& pattern, int64_t cursor, std::string* start_point);
   Status StoreScanNextPoint(const Slice& key, const Slice& pattern, int64_t cursor, const std::string& next_point);
@@ -5,6 +5,8 @@
 
 #include "src/redis_hashes.h"
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
 
 #include <fmt/core.h>
@@ -17,11 +19,30 @@
 
 namespace storage {
 
+static int32_t UnixTime() {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  return static_cast<int32_t>(unix_time);
+}
+
+// The fields alive of the inline hash, NotFound if none is
+static Status GetInlineFields(ParsedHashesMetaValue* parsed_hashes_meta_value, std::vector<InlineHashField>* fields) {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  Status s = DecodeInlineHash(parsed_hashes_meta_value->user_value(), static_cast<int32_t>(unix_time), fields);
+  if (s.ok() && fields->empty()) {
+    return Status::NotFound();
+  }
+  return s;
+}
+
 RedisHashes::RedisHashes(Storage* const s, const DataType& type) : Redis(s, type) {}
 
 Status RedisHashes::Open(const StorageOptions& storage_options, const std::string& db_path) {
   statistics_store_->SetCapacity(storage_options.statistics_max_size);
   small_compaction_threshold_ = storage_options.small_compaction_threshold;
+  inline_max_fields_ = storage_options.hash_max_inline_fields;
+  inline_max_value_ = storage_options.hash_max_inline_value;
 
   rocksdb::Options ops(storage_options.options);
   Status s = rocksdb::DB::Open(ops, db_path, &db_);
@@ -39,6 +60,7 @@ Status RedisHashes::Open(const StorageOptions& storage_options, const std::strin
 
   // Open
   rocksdb::DBOptions db_ops(storage_options.options);
+  db_ops.create_missing_column_families = true;
   rocksdb::ColumnFamilyOptions meta_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions data_cf_ops(storage_options.options);
   meta_cf_ops.compaction_filter_factory = std::make_shared<HashesMetaFilterFactory>();
@@ -61,7 +83,9 @@ Status RedisHashes::Open(const StorageOptions& storage_options, const std::strin
   column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, meta_cf_ops);
   // Data CF
   column_families.emplace_back("data_cf", data_cf_ops);
-  return rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
+  // Expire index CF
+  column_families.emplace_back(kExpireIndexCf, ExpireIndexCfOptions(storage_options));
+  return OpenDB(db_ops, db_path, column_families);
 }
 
 Status RedisHashes::CompactRange(const rocksdb::Slice* begin, const rocksdb::Slice* end, const ColumnFamilyType& type) {
@@ -217,14 +241,35 @@ Status RedisHashes::HDel(const Slice& key, const std::vector<std::string>& field
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
       *ret = 0;
       return Status::OK();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      *ret = 0;
+      return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* inline_fields) {
+        for (const auto& field : filtered_fields) {
+          auto iter = LowerBoundInlineField(inline_fields, field);
+          if (iter != inline_fields->end() && iter->field == field) {
+            inline_fields->erase(iter);
+            (*ret)++;
+          }
+        }
+        return Status::OK();
+      });
     } else {
       std::string data_value;
+      int32_t expire = 0;
+      int32_t expired_cnt = 0;
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       version = parsed_hashes_meta_value.version();
       for (const auto& field : filtered_fields) {
         HashesDataKey hashes_data_key(key, version, field);
-        s = db_->Get(read_options, handles_[1], hashes_data_key.Encode(), &data_value);
+        s = GetDataField(read_options, hashes_data_key.Encode(), expiring, &data_value, &expire);
         if (s.ok()) {
-          del_cnt++;
+          // an expired field is dropped too, but was not there to delete
+          if (FieldExpired(expire, now)) {
+            expired_cnt++;
+          } else {
+            del_cnt++;
+          }
           statistic++;
           batch.Delete(handles_[1], hashes_data_key.Encode());
         } else if (s.IsNotFound()) {
@@ -234,7 +279,7 @@ Status RedisHashes::HDel(const Slice& key, const std::vector<std::string>& field
         }
       }
       *ret = del_cnt;
-      parsed_hashes_meta_value.ModifyCount(-del_cnt);
+      parsed_hashes_meta_value.ModifyCount(-del_cnt - expired_cnt);
       batch.Put(handles_[0], key, meta_value);
     }
   } else if (s.IsNotFound()) {
@@ -267,10 +312,21 @@ Status RedisHashes::HGet(const Slice& key, const Slice& field, std::string* valu
       return Status::NotFound("Stale");
     } else if (parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      if (s.ok()) {
+        InlineHashField* inline_field = FindInlineField(&fields, field);
+        if (inline_field == nullptr) {
+          return Status::NotFound();
+        }
+        *value = inline_field->value;
+      }
     } else {
       version = parsed_hashes_meta_value.version();
       HashesDataKey data_key(key, version, field);
-      s = db_->Get(read_options, handles_[1], data_key.Encode(), value);
+      s = GetAliveDataField(read_options, data_key.Encode(), IsExpiringHashMeta(parsed_hashes_meta_value.user_value()),
+                            value);
     }
   }
   return s;
@@ -291,14 +347,25 @@ Status RedisHashes::HGetall(const Slice& key, std::vector<FieldValue>* fvs) {
       return Status::NotFound("Stale");
     } else if (parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      for (auto& field : fields) {
+        fvs->push_back({std::move(field.field), std::move(field.value)});
+      }
     } else {
       version = parsed_hashes_meta_value.version();
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.Encode();
+      Slice value;
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       auto iter = db_->NewIterator(read_options, handles_[1]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-        ParsedHashesDataKey parsed_hashes_data_key(iter->key());
-        fvs->push_back({parsed_hashes_data_key.field().ToString(), iter->value().ToString()});
+        if (AliveDataValue(iter->value(), expiring, now, &value)) {
+          ParsedHashesDataKey parsed_hashes_data_key(iter->key());
+          fvs->push_back({parsed_hashes_data_key.field().ToString(), value.ToString()});
+        }
       }
       delete iter;
     }
@@ -317,6 +384,30 @@ Status RedisHashes::HIncrby(const Slice& key, const Slice& field, int64_t value,
   std::string meta_value;
 
   Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (WritesInline(s, &meta_value)) {
+    return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* fields) {
+      int64_t ival = 0;
+      auto iter = LowerBoundInlineField(fields, field);
+      bool found = iter != fields->end() && Slice(iter->field) == field;
+      if (found) {
+        if (StrToInt64(iter->value.data(), iter->value.size(), &ival) == 0) {
+          return Status::Corruption("hash value is not an integer");
+        }
+        if ((value >= 0 && LLONG_MAX - value < ival) || (value < 0 && LLONG_MIN - value > ival)) {
+          return Status::InvalidArgument("Overflow");
+        }
+      }
+      char buf[32];
+      Int64ToStr(buf, 32, ival + value);
+      if (found) {
+        iter->value = buf;
+      } else {
+        fields->insert(iter, InlineHashField{field.ToString(), buf});
+      }
+      *ret = ival + value;
+      return Status::OK();
+    });
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
@@ -327,12 +418,19 @@ Status RedisHashes::HIncrby(const Slice& key, const Slice& field, int64_t value,
       HashesDataKey hashes_data_key(key, version, field);
       char buf[32];
       Int64ToStr(buf, 32, value);
-      batch.Put(handles_[1], hashes_data_key.Encode(), buf);
+      PutDataField(&batch, hashes_data_key.Encode(), buf, IsExpiringHashMeta(parsed_hashes_meta_value.user_value()));
       *ret = value;
     } else {
+      int32_t expire = 0;
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       version = parsed_hashes_meta_value.version();
       HashesDataKey hashes_data_key(key, version, field);
-      s = db_->Get(default_read_options_, handles_[1], hashes_data_key.Encode(), &old_value);
+      s = GetDataField(default_read_options_, hashes_data_key.Encode(), expiring, &old_value, &expire);
+      if (s.ok() && FieldExpired(expire, UnixTime())) {
+        // an expired field not dropped yet is counted already, it starts again
+        old_value = "0";
+        expire = 0;
+      }
       if (s.ok()) {
         int64_t ival = 0;
         if (StrToInt64(old_value.data(), old_value.size(), &ival) == 0) {
@@ -344,14 +442,14 @@ Status RedisHashes::HIncrby(const Slice& key, const Slice& field, int64_t value,
         *ret = ival + value;
         char buf[32];
         Int64ToStr(buf, 32, *ret);
-        batch.Put(handles_[1], hashes_data_key.Encode(), buf);
+        PutDataField(&batch, hashes_data_key.Encode(), buf, expiring, expire);
         statistic++;
       } else if (s.IsNotFound()) {
         char buf[32];
         Int64ToStr(buf, 32, value);
         parsed_hashes_meta_value.ModifyCount(1);
         batch.Put(handles_[0], key, meta_value);
-        batch.Put(handles_[1], hashes_data_key.Encode(), buf);
+        PutDataField(&batch, hashes_data_key.Encode(), buf, expiring);
         *ret = value;
       } else {
         return s;
@@ -393,6 +491,25 @@ Status RedisHashes::HIncrbyfloat(const Slice& key, const Slice& field, const Sli
   }
 
   Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (WritesInline(s, &meta_value)) {
+    return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* fields) {
+      auto iter = LowerBoundInlineField(fields, field);
+      if (iter != fields->end() && Slice(iter->field) == field) {
+        long double old_value;
+        if (StrToLongDouble(iter->value.data(), iter->value.size(), &old_value) == -1) {
+          return Status::Corruption("value is not a vaild float");
+        }
+        if (LongDoubleToStr(old_value + long_double_by, new_value) == -1) {
+          return Status::InvalidArgument("Overflow");
+        }
+        iter->value = *new_value;
+      } else {
+        LongDoubleToStr(long_double_by, new_value);
+        fields->insert(iter, InlineHashField{field.ToString(), *new_value});
+      }
+      return Status::OK();
+    });
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
@@ -403,11 +520,19 @@ Status RedisHashes::HIncrbyfloat(const Slice& key, const Slice& field, const Sli
       HashesDataKey hashes_data_key(key, version, field);
 
       LongDoubleToStr(long_double_by, new_value);
-      batch.Put(handles_[1], hashes_data_key.Encode(), *new_value);
+      PutDataField(&batch, hashes_data_key.Encode(), *new_value,
+                   IsExpiringHashMeta(parsed_hashes_meta_value.user_value()));
     } else {
+      int32_t expire = 0;
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       version = parsed_hashes_meta_value.version();
       HashesDataKey hashes_data_key(key, version, field);
-      s = db_->Get(default_read_options_, handles_[1], hashes_data_key.Encode(), &old_value_str);
+      s = GetDataField(default_read_options_, hashes_data_key.Encode(), expiring, &old_value_str, &expire);
+      if (s.ok() && FieldExpired(expire, UnixTime())) {
+        // an expired field not dropped yet is counted already, it starts again
+        old_value_str = "0";
+        expire = 0;
+      }
       if (s.ok()) {
         long double total;
         long double old_value;
@@ -419,13 +544,13 @@ Status RedisHashes::HIncrbyfloat(const Slice& key, const Slice& field, const Sli
         if (LongDoubleToStr(total, new_value) == -1) {
           return Status::InvalidArgument("Overflow");
         }
-        batch.Put(handles_[1], hashes_data_key.Encode(), *new_value);
+        PutDataField(&batch, hashes_data_key.Encode(), *new_value, expiring, expire);
         statistic++;
       } else if (s.IsNotFound()) {
         LongDoubleToStr(long_double_by, new_value);
         parsed_hashes_meta_value.ModifyCount(1);
         batch.Put(handles_[0], key, meta_value);
-        batch.Put(handles_[1], hashes_data_key.Encode(), *new_value);
+        PutDataField(&batch, hashes_data_key.Encode(), *new_value, expiring);
       } else {
         return s;
       }
@@ -463,14 +588,25 @@ Status RedisHashes::HKeys(const Slice& key, std::vector<std::string>* fields) {
       return Status::NotFound("Stale");
     } else if (parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> inline_fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &inline_fields);
+      for (auto& field : inline_fields) {
+        fields->push_back(std::move(field.field));
+      }
     } else {
       version = parsed_hashes_meta_value.version();
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.Encode();
+      Slice value;
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       auto iter = db_->NewIterator(read_options, handles_[1]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-        ParsedHashesDataKey parsed_hashes_data_key(iter->key());
-        fields->push_back(parsed_hashes_data_key.field().ToString());
+        if (AliveDataValue(iter->value(), expiring, now, &value)) {
+          ParsedHashesDataKey parsed_hashes_data_key(iter->key());
+          fields->push_back(parsed_hashes_data_key.field().ToString());
+        }
       }
       delete iter;
     }
@@ -489,7 +625,13 @@ Status RedisHashes::HLen(const Slice& key, int32_t* ret) {
       return Status::NotFound("Stale");
     } else if (parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      // its count includes the expired fields not dropped yet
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      *ret = static_cast<int32_t>(fields.size());
     } else {
+      // an expiring hash of data keys tells its count as is, like redis
       *ret = parsed_hashes_meta_value.count();
     }
   } else if (s.IsNotFound()) {
@@ -517,11 +659,27 @@ Status RedisHashes::HMGet(const Slice& key, const std::vector<std::string>& fiel
         vss->push_back({std::string(), Status::NotFound()});
       }
       return Status::NotFound(is_stale ? "Stale" : "");
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> inline_fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &inline_fields);
+      if (!s.ok() && !s.IsNotFound()) {
+        return s;
+      }
+      for (const auto& field : fields) {
+        InlineHashField* inline_field = FindInlineField(&inline_fields, field);
+        if (inline_field != nullptr) {
+          vss->push_back({inline_field->value, Status::OK()});
+        } else {
+          vss->push_back({std::string(), Status::NotFound()});
+        }
+      }
+      return s;
     } else {
       version = parsed_hashes_meta_value.version();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       for (const auto& field : fields) {
         HashesDataKey hashes_data_key(key, version, field);
-        s = db_->Get(read_options, handles_[1], hashes_data_key.Encode(), &value);
+        s = GetAliveDataField(read_options, hashes_data_key.Encode(), expiring, &value);
         if (s.ok()) {
           vss->push_back({value, Status::OK()});
         } else if (s.IsNotFound()) {
@@ -559,29 +717,46 @@ Status RedisHashes::HMSet(const Slice& key, const std::vector<FieldValue>& fvs)
   int32_t version = 0;
   std::string meta_value;
   Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (WritesInline(s, &meta_value)) {
+    return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* inline_fields) {
+      for (const auto& fv : filtered_fvs) {
+        auto iter = LowerBoundInlineField(inline_fields, fv.field);
+        if (iter != inline_fields->end() && iter->field == fv.field) {
+          iter->value = fv.value;
+          iter->expire = 0;
+        } else {
+          inline_fields->insert(iter, InlineHashField{fv.field, fv.value});
+        }
+      }
+      return Status::OK();
+    });
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
       version = parsed_hashes_meta_value.InitialMetaValue();
       parsed_hashes_meta_value.set_count(filtered_fvs.size());
       batch.Put(handles_[0], key, meta_value);
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       for (const auto& fv : filtered_fvs) {
         HashesDataKey hashes_data_key(key, version, fv.field);
-        batch.Put(handles_[1], hashes_data_key.Encode(), fv.value);
+        PutDataField(&batch, hashes_data_key.Encode(), fv.value, expiring);
       }
     } else {
       int32_t count = 0;
       std::string data_value;
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       version = parsed_hashes_meta_value.version();
       for (const auto& fv : filtered_fvs) {
+        // an expired field not dropped yet is counted already, and set anew
         HashesDataKey hashes_data_key(key, version, fv.field);
         s = db_->Get(default_read_options_, handles_[1], hashes_data_key.Encode(), &data_value);
         if (s.ok()) {
           statistic++;
-          batch.Put(handles_[1], hashes_data_key.Encode(), fv.value);
+          PutDataField(&batch, hashes_data_key.Encode(), fv.value, expiring);
         } else if (s.IsNotFound()) {
           count++;
-          batch.Put(handles_[1], hashes_data_key.Encode(), fv.value);
+          PutDataField(&batch, hashes_data_key.Encode(), fv.value, expiring);
         } else {
           return s;
         }
@@ -613,6 +788,21 @@ Status RedisHashes::HSet(const Slice& key, const Slice& field, const Slice& valu
   uint32_t statistic = 0;
   std::string meta_value;
   Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (WritesInline(s, &meta_value)) {
+    return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* fields) {
+      auto iter = LowerBoundInlineField(fields, field);
+      if (iter != fields->end() && Slice(iter->field) == field) {
+        // a field set again lives for ever, as in redis
+        iter->value = value.ToString();
+        iter->expire = 0;
+        *res = 0;
+      } else {
+        fields->insert(iter, InlineHashField{field.ToString(), value.ToString()});
+        *res = 1;
+      }
+      return Status::OK();
+    });
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
@@ -620,25 +810,28 @@ Status RedisHashes::HSet(const Slice& key, const Slice& field, const Slice& valu
       parsed_hashes_meta_value.set_count(1);
       batch.Put(handles_[0], key, meta_value);
       HashesDataKey data_key(key, version, field);
-      batch.Put(handles_[1], data_key.Encode(), value);
+      PutDataField(&batch, data_key.Encode(), value, IsExpiringHashMeta(parsed_hashes_meta_value.user_value()));
       *res = 1;
     } else {
+      int32_t expire = 0;
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       version = parsed_hashes_meta_value.version();
       std::string data_value;
       HashesDataKey hashes_data_key(key, version, field);
-      s = db_->Get(default_read_options_, handles_[1], hashes_data_key.Encode(), &data_value);
+      s = GetDataField(default_read_options_, hashes_data_key.Encode(), expiring, &data_value, &expire);
       if (s.ok()) {
-        *res = 0;
-        if (data_value == value.ToString()) {
+        // an expired field not dropped yet is counted already, but is new
+        *res = FieldExpired(expire, UnixTime()) ? 1 : 0;
+        if (expire == 0 && data_value == value.ToString()) {
           return Status::OK();
         } else {
-          batch.Put(handles_[1], hashes_data_key.Encode(), value);
+          PutDataField(&batch, hashes_data_key.Encode(), value, expiring);
           statistic++;
         }
       } else if (s.IsNotFound()) {
         parsed_hashes_meta_value.ModifyCount(1);
         batch.Put(handles_[0], key, meta_value);
-        batch.Put(handles_[1], hashes_data_key.Encode(), value);
+        PutDataField(&batch, hashes_data_key.Encode(), value, expiring);
         *res = 1;
       } else {
         return s;
@@ -668,6 +861,18 @@ Status RedisHashes::HSetnx(const Slice& key, const Slice& field, const Slice& va
   int32_t version = 0;
   std::string meta_value;
   Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (WritesInline(s, &meta_value)) {
+    return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* fields) {
+      auto iter = LowerBoundInlineField(fields, field);
+      if (iter != fields->end() && Slice(iter->field) == field) {
+        *ret = 0;
+      } else {
+        fields->insert(iter, InlineHashField{field.ToString(), value.ToString()});
+        *ret = 1;
+      }
+      return Status::OK();
+    });
+  }
   if (s.ok()) {
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
@@ -675,19 +880,25 @@ Status RedisHashes::HSetnx(const Slice& key, const Slice& field, const Slice& va
       parsed_hashes_meta_value.set_count(1);
       batch.Put(handles_[0], key, meta_value);
       HashesDataKey hashes_data_key(key, version, field);
-      batch.Put(handles_[1], hashes_data_key.Encode(), value);
+      PutDataField(&batch, hashes_data_key.Encode(), value, IsExpiringHashMeta(parsed_hashes_meta_value.user_value()));
       *ret = 1;
     } else {
+      int32_t expire = 0;
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       version = parsed_hashes_meta_value.version();
       HashesDataKey hashes_data_key(key, version, field);
       std::string data_value;
-      s = db_->Get(default_read_options_, handles_[1], hashes_data_key.Encode(), &data_value);
-      if (s.ok()) {
+      s = GetDataField(default_read_options_, hashes_data_key.Encode(), expiring, &data_value, &expire);
+      if (s.ok() && FieldExpired(expire, UnixTime())) {
+        // an expired field not dropped yet is counted already, and set anew
+        PutDataField(&batch, hashes_data_key.Encode(), value, expiring);
+        *ret = 1;
+      } else if (s.ok()) {
         *ret = 0;
       } else if (s.IsNotFound()) {
         parsed_hashes_meta_value.ModifyCount(1);
         batch.Put(handles_[0], key, meta_value);
-        batch.Put(handles_[1], hashes_data_key.Encode(), value);
+        PutDataField(&batch, hashes_data_key.Encode(), value, expiring);
         *ret = 1;
       } else {
         return s;
@@ -723,13 +934,24 @@ Status RedisHashes::HVals(const Slice& key, std::vector<std::string>* values) {
       return Status::NotFound("Stale");
     } else if (parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      for (auto& field : fields) {
+        values->push_back(std::move(field.value));
+      }
     } else {
       version = parsed_hashes_meta_value.version();
       HashesDataKey hashes_data_key(key, version, "");
       Slice prefix = hashes_data_key.Encode();
+      Slice value;
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       auto iter = db_->NewIterator(read_options, handles_[1]);
       for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-        values->push_back(iter->value().ToString());
+        if (AliveDataValue(iter->value(), expiring, now, &value)) {
+          values->push_back(value.ToString());
+        }
       }
       delete iter;
     }
@@ -771,13 +993,34 @@ Status RedisHashes::HScan(const Slice& key, int64_t cursor, const std::string& p
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
       *next_cursor = 0;
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      // a small hash is scanned whole at once, as redis does its listpacks
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      if (!s.ok()) {
+        return s;
+      }
+      for (auto& field : fields) {
+        if (StringMatch(pattern.data(), pattern.size(), field.field.data(), field.field.size(), 0) != 0) {
+          field_values->push_back({std::move(field.field), std::move(field.value)});
+        }
+      }
     } else {
       std::string sub_field;
       std::string start_point;
       int32_t version = parsed_hashes_meta_value.version();
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       s = GetScanStartPoint(key, pattern, cursor, &start_point);
+      // an evicted cursor is the number of fields visited before it, they
+      // are skipped again rather than restarting the scan, up to a bound
+      int64_t skip = 0;
       if (s.IsNotFound()) {
-        cursor = 0;
+        if (cursor <= ScanCursorStore::kMaxResumeWalk) {
+          skip = cursor;
+        } else {
+          cursor = 0;
+        }
         if (isTailWildcard(pattern)) {
           start_point = pattern.substr(0, pattern.size() - 1);
         }
@@ -790,12 +1033,17 @@ Status RedisHashes::HScan(const Slice& key, int64_t cursor, const std::string& p
       HashesDataKey hashes_start_data_key(key, version, start_point);
       std::string prefix = hashes_data_prefix.Encode().ToString();
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[1]);
-      for (iter->Seek(hashes_start_data_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
-           iter->Next()) {
+      iter->Seek(hashes_start_data_key.Encode());
+      for (; skip > 0 && iter->Valid() && iter->key().starts_with(prefix); skip--) {
+        iter->Next();
+      }
+      for (; iter->Valid() && rest > 0 && iter->key().starts_with(prefix); iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         std::string field = parsed_hashes_data_key.field().ToString();
-        if (StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
-          field_values->push_back({field, iter->value().ToString()});
+        Slice value;
+        if (AliveDataValue(iter->value(), expiring, now, &value) &&
+            StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
+          field_values->push_back({field, value.ToString()});
         }
         rest--;
       }
@@ -834,8 +1082,26 @@ Status RedisHashes::HScanx(const Slice& key, const std::string& start_field, con
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
       *next_field = "";
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      if (!s.ok()) {
+        return s;
+      }
+      auto iter = LowerBoundInlineField(&fields, start_field);
+      for (; iter != fields.end() && rest > 0; ++iter) {
+        if (StringMatch(pattern.data(), pattern.size(), iter->field.data(), iter->field.size(), 0) != 0) {
+          field_values->push_back({iter->field, iter->value});
+        }
+        rest--;
+      }
+      if (iter != fields.end()) {
+        *next_field = iter->field;
+      }
     } else {
       int32_t version = parsed_hashes_meta_value.version();
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       HashesDataKey hashes_data_prefix(key, version, Slice());
       HashesDataKey hashes_start_data_key(key, version, start_field);
       std::string prefix = hashes_data_prefix.Encode().ToString();
@@ -844,8 +1110,10 @@ Status RedisHashes::HScanx(const Slice& key, const std::string& start_field, con
            iter->Next()) {
         ParsedHashesDataKey parsed_hashes_data_key(iter->key());
         std::string field = parsed_hashes_data_key.field().ToString();
-        if (StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
-          field_values->push_back({field, iter->value().ToString()});
+        Slice value;
+        if (AliveDataValue(iter->value(), expiring, now, &value) &&
+            StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
+          field_values->push_back({field, value.ToString()});
         }
         rest--;
       }
@@ -890,8 +1158,29 @@ Status RedisHashes::PKHScanRange(const Slice& key, const Slice& field_start, con
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      if (!s.ok()) {
+        return s;
+      }
+      auto iter = start_no_limit ? fields.begin() : LowerBoundInlineField(&fields, field_start);
+      for (; iter != fields.end() && remain > 0; ++iter) {
+        if (!end_no_limit && iter->field.compare(field_end) > 0) {
+          break;
+        }
+        if (StringMatch(pattern.data(), pattern.size(), iter->field.data(), iter->field.size(), 0) != 0) {
+          field_values->push_back({iter->field, iter->value});
+        }
+        remain--;
+      }
+      if (iter != fields.end() && (end_no_limit || iter->field.compare(field_end) <= 0)) {
+        *next_field = iter->field;
+      }
     } else {
       int32_t version = parsed_hashes_meta_value.version();
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       HashesDataKey hashes_data_prefix(key, version, Slice());
       HashesDataKey hashes_start_data_key(key, version, field_start);
       std::string prefix = hashes_data_prefix.Encode().ToString();
@@ -903,8 +1192,10 @@ Status RedisHashes::PKHScanRange(const Slice& key, const Slice& field_start, con
         if (!end_no_limit && field.compare(field_end) > 0) {
           break;
         }
-        if (StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
-          field_values->push_back({field, iter->value().ToString()});
+        Slice value;
+        if (AliveDataValue(iter->value(), expiring, now, &value) &&
+            StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
+          field_values->push_back({field, value.ToString()});
         }
         remain--;
       }
@@ -948,8 +1239,34 @@ Status RedisHashes::PKHRScanRange(const Slice& key, const Slice& field_start, co
     ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
     if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
       return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &fields);
+      if (!s.ok()) {
+        return s;
+      }
+      // from the last field not after field_start
+      auto start = start_no_limit ? fields.end() : LowerBoundInlineField(&fields, field_start);
+      if (start != fields.end() && Slice(start->field) == field_start) {
+        ++start;
+      }
+      auto iter = std::make_reverse_iterator(start);
+      for (; iter != fields.rend() && remain > 0; ++iter) {
+        if (!end_no_limit && iter->field.compare(field_end) < 0) {
+          break;
+        }
+        if (StringMatch(pattern.data(), pattern.size(), iter->field.data(), iter->field.size(), 0) != 0) {
+          field_values->push_back({iter->field, iter->value});
+        }
+        remain--;
+      }
+      if (iter != fields.rend() && (end_no_limit || iter->field.compare(field_end) >= 0)) {
+        *next_field = iter->field;
+      }
     } else {
       int32_t version = parsed_hashes_meta_value.version();
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
       int32_t start_key_version = start_no_limit ? version + 1 : version;
       std::string start_key_field = start_no_limit ? "" : field_start.ToString();
       HashesDataKey hashes_data_prefix(key, version, Slice());
@@ -963,8 +1280,10 @@ Status RedisHashes::PKHRScanRange(const Slice& key, const Slice& field_start, co
         if (!end_no_limit && field.compare(field_end) < 0) {
           break;
         }
-        if (StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
-          field_values->push_back({field, iter->value().ToString()});
+        Slice value;
+        if (AliveDataValue(iter->value(), expiring, now, &value) &&
+            StringMatch(pattern.data(), pattern.size(), field.data(), field.size(), 0) != 0) {
+          field_values->push_back({field, value.ToString()});
         }
         remain--;
       }
@@ -1089,6 +1408,152 @@ Status RedisHashes::PKRScanRange(const Slice& key_start, const Slice& key_end, c
   return Status::OK();
 }
 
+Status RedisHashes::HExpire(const Slice& key, int32_t ttl, const std::vector<std::string>& fields,
+                            std::vector<int32_t>* rets) {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  int64_t timestamp = unix_time + ttl;
+  if (timestamp > INT32_MAX) {
+    return Status::InvalidArgument("invalid expire time");
+  }
+  return HExpireat(key, static_cast<int32_t>(timestamp), fields, rets);
+}
+
+Status RedisHashes::HExpireat(const Slice& key, int32_t timestamp, const std::vector<std::string>& fields,
+                              std::vector<int32_t>* rets) {
+  rets->assign(fields.size(), -2);
+  std::string meta_value;
+  ScopeRecordLock l(lock_mgr_, key);
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.ok()) {
+    ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
+    if (parsed_hashes_meta_value.IsStale()) {
+      return Status::NotFound("Stale");
+    } else if (parsed_hashes_meta_value.count() == 0) {
+      return Status::NotFound();
+    } else if (!IsInlineHashMeta(parsed_hashes_meta_value.user_value()) &&
+               (IsExpiringHashMeta(parsed_hashes_meta_value.user_value()) ||
+                parsed_hashes_meta_value.count() > static_cast<int32_t>(inline_max_fields_))) {
+      // a small hash of data keys is turned inline, a big one keeps the
+      // expires in its data values
+      return ExpireDataFields(key, timestamp, fields, &meta_value, rets);
+    }
+    int64_t unix_time;
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+    s = UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* inline_fields) {
+      for (size_t idx = 0; idx < fields.size(); ++idx) {
+        auto iter = LowerBoundInlineField(inline_fields, fields[idx]);
+        if (iter == inline_fields->end() || iter->field != fields[idx]) {
+          continue;
+        }
+        if (timestamp <= unix_time) {
+          inline_fields->erase(iter);
+          (*rets)[idx] = 2;
+        } else {
+          iter->expire = timestamp;
+          (*rets)[idx] = 1;
+        }
+      }
+      return Status::OK();
+    });
+  }
+  return s;
+}
+
+Status RedisHashes::HTTL(const Slice& key, const std::vector<std::string>& fields, std::vector<int64_t>* ttls) {
+  ttls->assign(fields.size(), -2);
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.ok()) {
+    ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
+    if (parsed_hashes_meta_value.IsStale()) {
+      return Status::NotFound("Stale");
+    } else if (parsed_hashes_meta_value.count() == 0) {
+      return Status::NotFound();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      std::vector<InlineHashField> inline_fields;
+      s = GetInlineFields(&parsed_hashes_meta_value, &inline_fields);
+      if (!s.ok()) {
+        return s;
+      }
+      int64_t unix_time;
+      rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+      for (size_t idx = 0; idx < fields.size(); ++idx) {
+        InlineHashField* inline_field = FindInlineField(&inline_fields, fields[idx]);
+        if (inline_field != nullptr) {
+          (*ttls)[idx] = inline_field->expire == 0 ? -1 : inline_field->expire - unix_time;
+        }
+      }
+    } else {
+      std::string data_value;
+      int32_t expire = 0;
+      int32_t now = UnixTime();
+      bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
+      int32_t version = parsed_hashes_meta_value.version();
+      for (size_t idx = 0; idx < fields.size(); ++idx) {
+        HashesDataKey hashes_data_key(key, version, fields[idx]);
+        s = GetDataField(default_read_options_, hashes_data_key.Encode(), expiring, &data_value, &expire);
+        if (s.ok() && !FieldExpired(expire, now)) {
+          (*ttls)[idx] = expire == 0 ? -1 : expire - now;
+        } else if (!s.ok() && !s.IsNotFound()) {
+          return s;
+        }
+      }
+      s = Status::OK();
+    }
+  }
+  return s;
+}
+
+Status RedisHashes::HPersist(const Slice& key, const std::vector<std::string>& fields, std::vector<int32_t>* rets) {
+  std::string meta_value;
+  ScopeRecordLock l(lock_mgr_, key);
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.ok()) {
+    ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
+    if (!parsed_hashes_meta_value.IsStale() && parsed_hashes_meta_value.count() != 0 &&
+        IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      rets->assign(fields.size(), -2);
+      return UpdateInlineHash(key, s, &meta_value, [&](std::vector<InlineHashField>* inline_fields) {
+        for (size_t idx = 0; idx < fields.size(); ++idx) {
+          InlineHashField* inline_field = FindInlineField(inline_fields, fields[idx]);
+          if (inline_field != nullptr) {
+            (*rets)[idx] = inline_field->expire == 0 ? -1 : 1;
+            inline_field->expire = 0;
+          }
+        }
+        return Status::OK();
+      });
+    } else if (!parsed_hashes_meta_value.IsStale() && parsed_hashes_meta_value.count() != 0 &&
+               IsExpiringHashMeta(parsed_hashes_meta_value.user_value())) {
+      rets->assign(fields.size(), -2);
+      rocksdb::WriteBatch batch;
+      std::string data_value;
+      int32_t expire = 0;
+      int32_t now = UnixTime();
+      int32_t version = parsed_hashes_meta_value.version();
+      for (size_t idx = 0; idx < fields.size(); ++idx) {
+        HashesDataKey hashes_data_key(key, version, fields[idx]);
+        s = GetDataField(default_read_options_, hashes_data_key.Encode(), true, &data_value, &expire);
+        if (s.ok() && !FieldExpired(expire, now)) {
+          (*rets)[idx] = expire == 0 ? -1 : 1;
+          if (expire != 0) {
+            PutDataField(&batch, hashes_data_key.Encode(), data_value, true);
+          }
+        } else if (!s.ok() && !s.IsNotFound()) {
+          return s;
+        }
+      }
+      return db_->Write(default_write_options_, &batch);
+    }
+  }
+  // nothing to persist in the other hashes, their fields are told as HTTL does
+  std::vector<int64_t> ttls;
+  s = HTTL(key, fields, &ttls);
+  rets->assign(ttls.begin(), ttls.end());
+  return s;
+}
+
 Status RedisHashes::Expire(const Slice& key, int32_t ttl) {
   std::string meta_value;
   ScopeRecordLock l(lock_mgr_, key);
@@ -1103,10 +1568,10 @@ Status RedisHashes::Expire(const Slice& key, int32_t ttl) {
 
     if (ttl > 0) {
       parsed_hashes_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_hashes_meta_value.timestamp());
     } else {
       parsed_hashes_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_hashes_meta_value.timestamp());
     }
   }
   return s;
@@ -1223,7 +1688,7 @@ Status RedisHashes::Expireat(const Slice& key, int32_t timestamp) {
       } else {
         parsed_hashes_meta_value.InitialMetaValue();
       }
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_hashes_meta_value.timestamp());
     }
   }
   return s;
@@ -1279,6 +1744,279 @@ Status RedisHashes::TTL(const Slice& key, int64_t* timestamp) {
   return s;
 }
 
+Status RedisHashes::ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) {
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedHashesMetaValue parsed_hashes_meta_value(&meta_value);
+  if (IsInlineHashMeta(parsed_hashes_meta_value.user_value()) && !parsed_hashes_meta_value.IsStale() &&
+      parsed_hashes_meta_value.count() != 0) {
+    // indexed at the earliest expire of its fields, drops the expired ones
+    // and is indexed again at the next one
+    int64_t unix_time;
+    rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+    std::vector<InlineHashField> fields;
+    s = DecodeInlineHash(parsed_hashes_meta_value.user_value(), 0, &fields);
+    if (!s.ok()) {
+      return s;
+    }
+    auto now = static_cast<int32_t>(unix_time);
+    size_t count = fields.size();
+    fields.erase(std::remove_if(fields.begin(), fields.end(),
+                                [now](const InlineHashField& field) { return field.IsExpired(now); }),
+                 fields.end());
+    if (fields.size() != count) {
+      PutInlineHash(key, parsed_hashes_meta_value.version(), parsed_hashes_meta_value.timestamp(), fields, batch);
+    }
+    return Status::OK();
+  }
+  if (IsExpiringHashMeta(parsed_hashes_meta_value.user_value()) && !parsed_hashes_meta_value.IsStale() &&
+      parsed_hashes_meta_value.count() != 0) {
+    // indexed at every expire of its fields, drops the expired ones
+    Slice value;
+    int32_t expire = 0;
+    int32_t expired_cnt = 0;
+    int32_t now = UnixTime();
+    HashesDataKey hashes_data_prefix(key, parsed_hashes_meta_value.version(), Slice());
+    std::string prefix = hashes_data_prefix.Encode().ToString();
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(default_read_options_, handles_[1]));
+    for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+      s = DecodeExpiringValue(iter->value(), &value, &expire);
+      if (!s.ok()) {
+        return s;
+      }
+      if (FieldExpired(expire, now)) {
+        batch->Delete(handles_[1], iter->key());
+        expired_cnt++;
+      }
+    }
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+    if (expired_cnt != 0) {
+      parsed_hashes_meta_value.ModifyCount(-expired_cnt);
+      batch->Put(handles_[0], key, meta_value);
+    }
+    return Status::OK();
+  }
+  // the ttl was changed or the key was recreated since it was indexed
+  if (parsed_hashes_meta_value.timestamp() != timestamp || !parsed_hashes_meta_value.IsStale()) {
+    return Status::OK();
+  }
+  int32_t version = parsed_hashes_meta_value.version();
+  int32_t count = parsed_hashes_meta_value.count();
+  parsed_hashes_meta_value.InitialMetaValue();
+  batch->Put(handles_[0], key, meta_value);
+  // the data of small collections are dropped by the data filter, do not
+  // wait for the compaction for big ones
+  if (count >= static_cast<int32_t>(small_compaction_threshold_)) {
+    DeleteDataRange(batch, handles_[1], key, version, DataKeyOrder::kBytewise);
+  }
+  return Status::OK();
+}
+
+bool RedisHashes::WritesInline(const Status& s, std::string* meta_value) {
+  if (s.IsNotFound()) {
+    return inline_max_fields_ > 0;
+  } else if (!s.ok()) {
+    return false;
+  }
+  ParsedHashesMetaValue parsed_hashes_meta_value(meta_value);
+  if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+    return true;
+  }
+  // a hash created again starts inline
+  return inline_max_fields_ > 0 && (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0);
+}
+
+bool RedisHashes::FitsInline(const std::vector<InlineHashField>& fields) {
+  if (fields.size() > inline_max_fields_) {
+    return false;
+  }
+  for (const auto& field : fields) {
+    if (field.field.size() > inline_max_value_ || field.value.size() > inline_max_value_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status RedisHashes::UpdateInlineHash(const Slice& key, const Status& get_status, std::string* meta_value,
+                                     const InlineHashUpdate& update) {
+  Status s;
+  int32_t version = 0;
+  int32_t timestamp = 0;
+  std::vector<InlineHashField> fields;
+  if (get_status.ok()) {
+    ParsedHashesMetaValue parsed_hashes_meta_value(meta_value);
+    if (parsed_hashes_meta_value.IsStale() || parsed_hashes_meta_value.count() == 0) {
+      version = parsed_hashes_meta_value.InitialMetaValue();
+    } else if (IsInlineHashMeta(parsed_hashes_meta_value.user_value())) {
+      int64_t unix_time;
+      rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+      version = parsed_hashes_meta_value.version();
+      timestamp = parsed_hashes_meta_value.timestamp();
+      s = DecodeInlineHash(parsed_hashes_meta_value.user_value(), static_cast<int32_t>(unix_time), &fields);
+    } else {
+      // a small hash of data keys turned inline, under a new version so
+      // the data filter drops its data keys
+      HashesDataKey hashes_data_prefix(key, parsed_hashes_meta_value.version(), Slice());
+      std::string prefix = hashes_data_prefix.Encode().ToString();
+      std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(default_read_options_, handles_[1]));
+      for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+        ParsedHashesDataKey parsed_hashes_data_key(iter->key());
+        fields.push_back({parsed_hashes_data_key.field().ToString(), iter->value().ToString()});
+      }
+      s = iter->status();
+      version = parsed_hashes_meta_value.UpdateVersion();
+      timestamp = parsed_hashes_meta_value.timestamp();
+    }
+  } else {
+    HashesMetaValue hashes_meta_value(Slice());
+    version = hashes_meta_value.UpdateVersion();
+  }
+  if (s.ok()) {
+    s = update(&fields);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  rocksdb::WriteBatch batch;
+  PutInlineHash(key, version, timestamp, fields, &batch);
+  return db_->Write(default_write_options_, &batch);
+}
+
+void RedisHashes::PutInlineHash(const Slice& key, int32_t version, int32_t timestamp,
+                                const std::vector<InlineHashField>& fields, rocksdb::WriteBatch* batch) {
+  int32_t field_expire = EarliestInlineFieldExpire(fields);
+  if (!FitsInline(fields)) {
+    // grown past the limits, or they were lowered, the hash goes to data
+    // keys, expiring ones if a field expires
+    bool expiring = field_expire != 0;
+    std::string user_value = ExpiringHashUserValue(static_cast<int32_t>(fields.size()));
+    if (!expiring) {
+      user_value.resize(sizeof(int32_t));
+    }
+    HashesMetaValue hashes_meta_value(user_value);
+    hashes_meta_value.set_version(version);
+    hashes_meta_value.set_timestamp(timestamp);
+    batch->Put(handles_[0], key, hashes_meta_value.Encode());
+    for (const auto& field : fields) {
+      HashesDataKey hashes_data_key(key, version, field.field);
+      PutDataField(batch, hashes_data_key.Encode(), field.value, expiring, field.expire);
+      AddExpireIndex(batch, key, field.expire);
+    }
+    return;
+  }
+  std::string user_value = EncodeInlineHash(fields);
+  HashesMetaValue hashes_meta_value(user_value);
+  hashes_meta_value.set_version(version);
+  hashes_meta_value.set_timestamp(timestamp);
+  batch->Put(handles_[0], key, hashes_meta_value.Encode());
+  AddExpireIndex(batch, key, field_expire);
+}
+
+Status RedisHashes::ExpireDataFields(const Slice& key, int32_t timestamp, const std::vector<std::string>& fields,
+                                     std::string* meta_value, std::vector<int32_t>* rets) {
+  ParsedHashesMetaValue parsed_hashes_meta_value(meta_value);
+  int32_t version = parsed_hashes_meta_value.version();
+  bool expiring = IsExpiringHashMeta(parsed_hashes_meta_value.user_value());
+  int32_t now = UnixTime();
+  int32_t expired_cnt = 0;
+  std::string data_value;
+  int32_t expire = 0;
+  std::vector<std::pair<std::string, std::string>> expiring_values;
+  std::unordered_set<std::string> dropped_fields;
+  for (size_t idx = 0; idx < fields.size(); ++idx) {
+    HashesDataKey hashes_data_key(key, version, fields[idx]);
+    Status s = GetDataField(default_read_options_, hashes_data_key.Encode(), expiring, &data_value, &expire);
+    if (s.IsNotFound() || (s.ok() && FieldExpired(expire, now)) || dropped_fields.count(fields[idx]) != 0) {
+      continue;
+    } else if (!s.ok()) {
+      return s;
+    }
+    if (timestamp <= now) {
+      dropped_fields.insert(fields[idx]);
+      expired_cnt++;
+      (*rets)[idx] = 2;
+    } else {
+      expiring_values.emplace_back(hashes_data_key.Encode().ToString(), data_value);
+      (*rets)[idx] = 1;
+    }
+  }
+  if (expired_cnt == 0 && expiring_values.empty()) {
+    return Status::OK();
+  }
+
+  rocksdb::WriteBatch batch;
+  if (!expiring) {
+    // every data value takes an expire, for ever but the ones set below
+    HashesDataKey hashes_data_prefix(key, version, Slice());
+    std::string prefix = hashes_data_prefix.Encode().ToString();
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(default_read_options_, handles_[1]));
+    for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+      batch.Put(handles_[1], iter->key(), EncodeExpiringValue(iter->value(), 0));
+    }
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+  }
+  for (const auto& field : dropped_fields) {
+    HashesDataKey hashes_data_key(key, version, field);
+    batch.Delete(handles_[1], hashes_data_key.Encode());
+  }
+  for (const auto& data_key_value : expiring_values) {
+    PutDataField(&batch, data_key_value.first, data_key_value.second, true, timestamp);
+  }
+  std::string user_value = ExpiringHashUserValue(parsed_hashes_meta_value.count() - expired_cnt);
+  HashesMetaValue hashes_meta_value(user_value);
+  hashes_meta_value.set_version(version);
+  hashes_meta_value.set_timestamp(parsed_hashes_meta_value.timestamp());
+  batch.Put(handles_[0], key, hashes_meta_value.Encode());
+  if (!expiring_values.empty()) {
+    AddExpireIndex(&batch, key, timestamp);
+  }
+  return db_->Write(default_write_options_, &batch);
+}
+
+Status RedisHashes::GetDataField(const rocksdb::ReadOptions& read_options, const Slice& data_key, bool expiring,
+                                 std::string* value, int32_t* expire) {
+  *expire = 0;
+  Status s = db_->Get(read_options, handles_[1], data_key, value);
+  if (s.ok() && expiring) {
+    Slice user_value;
+    s = DecodeExpiringValue(*value, &user_value, expire);
+    if (s.ok()) {
+      value->resize(user_value.size());
+    }
+  }
+  return s;
+}
+
+Status RedisHashes::GetAliveDataField(const rocksdb::ReadOptions& read_options, const Slice& data_key, bool expiring,
+                                      std::string* value) {
+  int32_t expire = 0;
+  Status s = GetDataField(read_options, data_key, expiring, value, &expire);
+  if (s.ok() && FieldExpired(expire, UnixTime())) {
+    value->clear();
+    return Status::NotFound();
+  }
+  return s;
+}
+
+void RedisHashes::PutDataField(rocksdb::WriteBatch* batch, const Slice& data_key, const Slice& value, bool expiring,
+                               int32_t expire) {
+  if (expiring) {
+    batch->Put(handles_[1], data_key, EncodeExpiringValue(value, expire));
+  } else {
+    batch->Put(handles_[1], data_key, value);
+  }
+}
+
 void RedisHashes::ScanDatabase() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
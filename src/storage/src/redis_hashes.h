@@ -6,10 +6,12 @@
 #ifndef SRC_REDIS_HASHES_H_
 #define SRC_REDIS_HASHES_H_
 
+#include <functional>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "src/hashes_inline_value_format.h"
 #include "src/redis.h"
 
 namespace storage {
@@ -55,6 +57,11 @@ class RedisHashes : public Redis {
                      std::vector<std::string>* keys, std::string* next_key);
   Status PKRScanRange(const Slice& key_start, const Slice& key_end, const Slice& pattern, int32_t limit,
                       std::vector<std::string>* keys, std::string* next_key);
+  Status HExpire(const Slice& key, int32_t ttl, const std::vector<std::string>& fields, std::vector<int32_t>* rets);
+  Status HExpireat(const Slice& key, int32_t timestamp, const std::vector<std::string>& fields,
+                   std::vector<int32_t>* rets);
+  Status HTTL(const Slice& key, const std::vector<std::string>& fields, std::vector<int64_t>* ttls);
+  Status HPersist(const Slice& key, const std::vector<std::string>& fields, std::vector<int32_t>* rets);
 
   // Keys Commands
   Status Expire(const Slice& key, int32_t ttl) override;
@@ -69,6 +76,41 @@ class RedisHashes : public Redis {
 
   // Iterate all data
   void ScanDatabase();
+
+ protected:
+  Status ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) override;
+
+ private:
+  using InlineHashUpdate = std::function<Status(std::vector<InlineHashField>* fields)>;
+
+  // Whether the hash of meta_value, got with s, is written inline
+  bool WritesInline(const Status& s, std::string* meta_value);
+  bool FitsInline(const std::vector<InlineHashField>& fields);
+  // Writes the hash of meta_value, got with get_status, inline with the
+  // alive fields update leaves, need the record lock
+  Status UpdateInlineHash(const Slice& key, const Status& get_status, std::string* meta_value,
+                          const InlineHashUpdate& update);
+  // Puts the fields inline, or in data keys of version when they no longer fit
+  void PutInlineHash(const Slice& key, int32_t version, int32_t timestamp, const std::vector<InlineHashField>& fields,
+                     rocksdb::WriteBatch* batch);
+
+  // Sets the expires of the fields of a big hash of data keys, turning it
+  // into an expiring one, need the record lock
+  Status ExpireDataFields(const Slice& key, int32_t timestamp, const std::vector<std::string>& fields,
+                          std::string* meta_value, std::vector<int32_t>* rets);
+  // The value of a field of a hash of data keys and its expire, 0 if it does
+  // not expire, OK even if it expired
+  Status GetDataField(const rocksdb::ReadOptions& read_options, const Slice& data_key, bool expiring,
+                      std::string* value, int32_t* expire);
+  // The same, NotFound if the field expired
+  Status GetAliveDataField(const rocksdb::ReadOptions& read_options, const Slice& data_key, bool expiring,
+                           std::string* value);
+  void PutDataField(rocksdb::WriteBatch* batch, const Slice& data_key, const Slice& value, bool expiring,
+                    int32_t expire = 0);
+
+  // the limits of the hashes kept inline, none is with 0 max fields
+  size_t inline_max_fields_ = 0;
+  size_t inline_max_value_ = 0;
 };
 
 }  //  namespace storage
@@ -45,6 +45,7 @@ Status RedisLists::Open(const StorageOptions& storage_options, const std::string
 
   // Open
   rocksdb::DBOptions db_ops(storage_options.options);
+  db_ops.create_missing_column_families = true;
   rocksdb::ColumnFamilyOptions meta_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions data_cf_ops(storage_options.options);
   meta_cf_ops.compaction_filter_factory = std::make_shared<ListsMetaFilterFactory>();
@@ -68,7 +69,9 @@ Status RedisLists::Open(const StorageOptions& storage_options, const std::string
   column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, meta_cf_ops);
   // Data CF
   column_families.emplace_back("data_cf", data_cf_ops);
-  return rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
+  // Expire index CF
+  column_families.emplace_back(kExpireIndexCf, ExpireIndexCfOptions(storage_options));
+  return OpenDB(db_ops, db_path, column_families);
 }
 
 Status RedisLists::CompactRange(const rocksdb::Slice* begin, const rocksdb::Slice* end, const ColumnFamilyType& type) {
@@ -316,7 +319,7 @@ Status RedisLists::LInsert(const Slice& key, const BeforeOrAfter& before_or_afte
         ListsDataKey lists_target_key(key, version, target_index);
         batch.Put(handles_[1], lists_target_key.Encode(), value);
         *ret = parsed_lists_meta_value.count();
-        return db_->Write(default_write_options_, &batch);
+        return WritePush(key, &batch);
       }
     }
   } else if (s.IsNotFound()) {
@@ -418,7 +421,7 @@ Status RedisLists::LPush(const Slice& key, const std::vector<std::string>& value
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return WritePush(key, &batch);
 }
 
 Status RedisLists::LPushx(const Slice& key, const std::vector<std::string>& values, uint64_t* len) {
@@ -445,7 +448,7 @@ Status RedisLists::LPushx(const Slice& key, const std::vector<std::string>& valu
       }
       batch.Put(handles_[0], key, meta_value);
       *len = parsed_lists_meta_value.count();
-      return db_->Write(default_write_options_, &batch);
+      return WritePush(key, &batch);
     }
   }
   return s;
@@ -842,7 +845,7 @@ Status RedisLists::RPoplpush(const Slice& source, const Slice& destination, std:
     return s;
   }
 
-  s = db_->Write(default_write_options_, &batch);
+  s = WritePush(destination, &batch);
   UpdateSpecificKeyStatistics(source.ToString(), statistic);
   if (s.ok()) {
     *element = target;
@@ -853,6 +856,7 @@ Status RedisLists::RPoplpush(const Slice& source, const Slice& destination, std:
 Status RedisLists::RPush(const Slice& key, const std::vector<std::string>& values, uint64_t* ret) {
   *ret = 0;
   rocksdb::WriteBatch batch;
+  ScopeRecordLock l(lock_mgr_, key);
 
   uint64_t index = 0;
   int32_t version = 0;
@@ -890,7 +894,7 @@ Status RedisLists::RPush(const Slice& key, const std::vector<std::string>& value
   } else {
     return s;
   }
-  return db_->Write(default_write_options_, &batch);
+  return WritePush(key, &batch);
 }
 
 Status RedisLists::RPushx(const Slice& key, const std::vector<std::string>& values, uint64_t* len) {
@@ -917,12 +921,20 @@ Status RedisLists::RPushx(const Slice& key, const std::vector<std::string>& valu
       }
       batch.Put(handles_[0], key, meta_value);
       *len = parsed_lists_meta_value.count();
-      return db_->Write(default_write_options_, &batch);
+      return WritePush(key, &batch);
     }
   }
   return s;
 }
 
+Status RedisLists::WritePush(const Slice& key, rocksdb::WriteBatch* batch) {
+  Status s = db_->Write(default_write_options_, batch);
+  if (s.ok()) {
+    storage_->NotifyListPush(key);
+  }
+  return s;
+}
+
 Status RedisLists::PKScanRange(const Slice& key_start, const Slice& key_end, const Slice& pattern, int32_t limit,
                                std::vector<std::string>* keys, std::string* next_key) {
   next_key->clear();
@@ -1043,10 +1055,10 @@ Status RedisLists::Expire(const Slice& key, int32_t ttl) {
 
     if (ttl > 0) {
       parsed_lists_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_lists_meta_value.timestamp());
     } else {
       parsed_lists_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_lists_meta_value.timestamp());
     }
   }
   return s;
@@ -1162,7 +1174,7 @@ Status RedisLists::Expireat(const Slice& key, int32_t timestamp) {
       } else {
         parsed_lists_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[0], key, meta_value);
+      return PutWithExpireIndex(handles_[0], key, meta_value, parsed_lists_meta_value.timestamp());
     }
   }
   return s;
@@ -1218,6 +1230,31 @@ Status RedisLists::TTL(const Slice& key, int64_t* timestamp) {
   return s;
 }
 
+Status RedisLists::ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) {
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedListsMetaValue parsed_lists_meta_value(&meta_value);
+  // the ttl was changed or the key was recreated since it was indexed
+  if (parsed_lists_meta_value.timestamp() != timestamp || !parsed_lists_meta_value.IsStale()) {
+    return Status::OK();
+  }
+  int32_t version = parsed_lists_meta_value.version();
+  uint64_t count = parsed_lists_meta_value.count();
+  parsed_lists_meta_value.InitialMetaValue();
+  batch->Put(handles_[0], key, meta_value);
+  // the data of small collections are dropped by the data filter, do not
+  // wait for the compaction for big ones
+  if (count >= static_cast<uint64_t>(small_compaction_threshold_)) {
+    DeleteDataRange(batch, handles_[1], key, version, DataKeyOrder::kListsIndex);
+  }
+  return Status::OK();
+}
+
 void RedisLists::ScanDatabase() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
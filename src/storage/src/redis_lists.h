@@ -63,6 +63,14 @@ class RedisLists : public Redis {
 
   // Iterate all data
   void ScanDatabase();
+
+ protected:
+  Status ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) override;
+
+ private:
+  // Write a batch that pushed elements into key, and tell the storage so the
+  // clients blocked on the key can be woken
+  Status WritePush(const Slice& key, rocksdb::WriteBatch* batch);
 };
 
 }  //  namespace storage
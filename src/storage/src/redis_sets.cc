@@ -6,7 +6,6 @@
 #include "src/redis_sets.h"
 
 #include <algorithm>
-#include <map>
 #include <memory>
 #include <random>
 
@@ -16,6 +15,7 @@
 #include "src/base_filter.h"
 #include "src/scope_record_lock.h"
 #include "src/scope_snapshot.h"
+#include "src/sets_sample_key_format.h"
 #include "storage/util.h"
 
 namespace storage {
@@ -48,29 +48,40 @@ rocksdb::Status RedisSets::Open(const StorageOptions& storage_options, const std
 
   // Open
   rocksdb::DBOptions db_ops(storage_options.options);
+  db_ops.create_missing_column_families = true;
   rocksdb::ColumnFamilyOptions meta_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions member_cf_ops(storage_options.options);
+  rocksdb::ColumnFamilyOptions sample_cf_ops(storage_options.options);
   meta_cf_ops.compaction_filter_factory = std::make_shared<SetsMetaFilterFactory>();
   member_cf_ops.compaction_filter_factory = std::make_shared<SetsMemberFilterFactory>(&db_, &handles_);
+  // the sampling index has the layout of the member keys
+  sample_cf_ops.compaction_filter_factory = std::make_shared<SetsMemberFilterFactory>(&db_, &handles_);
 
   // use the bloom filter policy to reduce disk reads
   rocksdb::BlockBasedTableOptions table_ops(storage_options.table_options);
   table_ops.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, true));
   rocksdb::BlockBasedTableOptions meta_cf_table_ops(table_ops);
   rocksdb::BlockBasedTableOptions member_cf_table_ops(table_ops);
+  rocksdb::BlockBasedTableOptions sample_cf_table_ops(table_ops);
   if (!storage_options.share_block_cache && storage_options.block_cache_size > 0) {
     meta_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
     member_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
+    sample_cf_table_ops.block_cache = rocksdb::NewLRUCache(storage_options.block_cache_size);
   }
   meta_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(meta_cf_table_ops));
   member_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(member_cf_table_ops));
+  sample_cf_ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(sample_cf_table_ops));
 
   std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
   // Meta CF
   column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, meta_cf_ops);
   // Member CF
   column_families.emplace_back("member_cf", member_cf_ops);
-  return rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
+  // Sample index CF
+  column_families.emplace_back("sample_cf", sample_cf_ops);
+  // Expire index CF
+  column_families.emplace_back(kExpireIndexCf, ExpireIndexCfOptions(storage_options));
+  return OpenDB(db_ops, db_path, column_families);
 }
 
 rocksdb::Status RedisSets::CompactRange(const rocksdb::Slice* begin, const rocksdb::Slice* end, const ColumnFamilyType& type) {
@@ -79,6 +90,7 @@ rocksdb::Status RedisSets::CompactRange(const rocksdb::Slice* begin, const rocks
   }
   if (type == kData || type == kMetaAndData) {
     db_->CompactRange(default_compact_range_options_, handles_[1], begin, end);
+    db_->CompactRange(default_compact_range_options_, handles_[2], begin, end);
   }
   return rocksdb::Status::OK();
 }
@@ -89,6 +101,8 @@ rocksdb::Status RedisSets::GetProperty(const std::string& property, uint64_t* ou
   *out = std::strtoull(value.c_str(), nullptr, 10);
   db_->GetProperty(handles_[1], property, &value);
   *out += std::strtoull(value.c_str(), nullptr, 10);
+  db_->GetProperty(handles_[2], property, &value);
+  *out += std::strtoull(value.c_str(), nullptr, 10);
   return rocksdb::Status::OK();
 }
 
@@ -219,9 +233,9 @@ rocksdb::Status RedisSets::SAdd(const Slice& key, const std::vector<std::string>
       version = parsed_sets_meta_value.InitialMetaValue();
       parsed_sets_meta_value.set_count(filtered_members.size());
       batch.Put(handles_[0], key, meta_value);
+      PutSampleMark(&batch, key, version);
       for (const auto& member : filtered_members) {
-        SetsMemberKey sets_member_key(key, version, member);
-        batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+        PutMember(&batch, key, version, member);
       }
       *ret = filtered_members.size();
     } else {
@@ -234,7 +248,7 @@ rocksdb::Status RedisSets::SAdd(const Slice& key, const std::vector<std::string>
         if (s.ok()) {
         } else if (s.IsNotFound()) {
           cnt++;
-          batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+          PutMember(&batch, key, version, member);
         } else {
           return s;
         }
@@ -253,9 +267,9 @@ rocksdb::Status RedisSets::SAdd(const Slice& key, const std::vector<std::string>
     SetsMetaValue sets_meta_value(Slice(str, sizeof(int32_t)));
     version = sets_meta_value.UpdateVersion();
     batch.Put(handles_[0], key, sets_meta_value.Encode());
+    PutSampleMark(&batch, key, version);
     for (const auto& member : filtered_members) {
-      SetsMemberKey sets_member_key(key, version, member);
-      batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+      PutMember(&batch, key, version, member);
     }
     *ret = filtered_members.size();
   } else {
@@ -282,345 +296,277 @@ rocksdb::Status RedisSets::SCard(const Slice& key, int32_t* ret) {
   return s;
 }
 
-rocksdb::Status RedisSets::SDiff(const std::vector<std::string>& keys, std::vector<std::string>* members) {
-  if (keys.empty()) {
-    return rocksdb::Status::Corruption("SDiff invalid parameter, no keys");
+/*
+ * The members of a version of a set are stored in their order under the
+ * prefix of that version, a SetsMemberCursor walks them so that the set
+ * operations are merges of the sorted members instead of point lookups.
+ */
+class SetsMemberCursor {
+ public:
+  SetsMemberCursor(rocksdb::DB* db, const rocksdb::ReadOptions& read_options, rocksdb::ColumnFamilyHandle* handle,
+                   const KeyVersion& key_version, int32_t size)
+      : size_(size), iter_(db->NewIterator(read_options, handle)) {
+    SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
+    prefix_ = sets_member_key.Encode().ToString();
+    iter_->Seek(prefix_);
+  }
+
+  int32_t size() const { return size_; }
+  bool Valid() const { return iter_->Valid() && iter_->key().starts_with(prefix_); }
+  Status status() const { return iter_->status(); }
+  void Next() { iter_->Next(); }
+  Slice member() const {
+    Slice key = iter_->key();
+    return Slice(key.data() + prefix_.size(), key.size() - prefix_.size());
+  }
+
+  // Move to the first member not less than target. A cursor over a set much
+  // larger than the others seeks at once, the others step a few members
+  // before they seek, a seek costs a lookup in every level.
+  void SkipTo(const Slice& target) {
+    for (int32_t step = 0; !seek_only_ && step < 8; step++) {
+      if (!Valid() || member().compare(target) >= 0) {
+        return;
+      }
+      iter_->Next();
+    }
+    if (!Valid() || member().compare(target) >= 0) {
+      return;
+    }
+    std::string seek_key(prefix_);
+    seek_key.append(target.data(), target.size());
+    iter_->Seek(seek_key);
   }
+  void set_seek_only(bool seek_only) { seek_only_ = seek_only; }
 
-  rocksdb::ReadOptions read_options;
-  const rocksdb::Snapshot* snapshot;
+ private:
+  std::string prefix_;
+  int32_t size_ = 0;
+  bool seek_only_ = false;
+  std::unique_ptr<rocksdb::Iterator> iter_;
+};
 
-  std::string meta_value;
-  int32_t version = 0;
-  ScopeSnapshot ss(db_, &snapshot);
-  read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
-  rocksdb::Status s;
+// a set this many times larger than the driver of a merge is sought into
+static const int32_t kSetsSeekSkew = 16;
 
-  for (uint32_t idx = 1; idx < keys.size(); ++idx) {
-    s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
+rocksdb::Status RedisSets::MergeSets(const rocksdb::ReadOptions& read_options, SetsOperation op,
+                                     const std::vector<std::string>& keys,
+                                     const std::function<Status(const Slice&)>& handle) {
+  std::string meta_value;
+  std::vector<std::unique_ptr<SetsMemberCursor>> cursors;
+  for (size_t idx = 0; idx < keys.size(); ++idx) {
+    Status s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
+    bool valid = false;
     if (s.ok()) {
       ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
       if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.count() != 0) {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.version()});
+        valid = true;
+        cursors.push_back(std::make_unique<SetsMemberCursor>(
+            db_, read_options, handles_[1], KeyVersion{keys[idx], parsed_sets_meta_value.version()},
+            parsed_sets_meta_value.count()));
       }
     } else if (!s.IsNotFound()) {
       return s;
     }
+    // an empty set leaves nothing to intersect, nothing to take the others from
+    if (!valid && (op == kSetsInter || (op == kSetsDiff && idx == 0))) {
+      return Status::OK();
+    }
+  }
+  if (cursors.empty()) {
+    return Status::OK();
   }
 
-  s = db_->Get(read_options, handles_[0], keys[0], &meta_value);
-  if (s.ok()) {
-    ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-    if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.count() != 0) {
-      bool found;
-      Slice prefix;
-      std::string member_value;
-      version = parsed_sets_meta_value.version();
-      SetsMemberKey sets_member_key(keys[0], version, Slice());
-      prefix = sets_member_key.Encode();
-      auto iter = db_->NewIterator(read_options, handles_[1]);
-      for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-        ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-        Slice member = parsed_sets_member_key.member();
-
-        found = false;
-        for (const auto& key_version : vaild_sets) {
-          SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-          s = db_->Get(read_options, handles_[1], sets_member_key.Encode(), &member_value);
-          if (s.ok()) {
-            found = true;
+  Status s;
+  if (op == kSetsUnion) {
+    // k-way merge, the cursor of the smallest member on the top
+    auto greater = [](const SetsMemberCursor* a, const SetsMemberCursor* b) {
+      return a->member().compare(b->member()) > 0;
+    };
+    std::vector<SetsMemberCursor*> heap;
+    for (const auto& cursor : cursors) {
+      if (cursor->Valid()) {
+        heap.push_back(cursor.get());
+      }
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+    std::string last;
+    bool first = true;
+    while (!heap.empty() && s.ok()) {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      SetsMemberCursor* cursor = heap.back();
+      Slice member = cursor->member();
+      if (first || member.compare(last) != 0) {
+        first = false;
+        last.assign(member.data(), member.size());
+        s = handle(member);
+      }
+      cursor->Next();
+      if (cursor->Valid()) {
+        std::push_heap(heap.begin(), heap.end(), greater);
+      } else {
+        heap.pop_back();
+      }
+    }
+  } else {
+    // the first set drives a difference, the smallest one an intersection
+    if (op == kSetsInter) {
+      std::sort(cursors.begin(), cursors.end(),
+                [](const auto& a, const auto& b) { return a->size() < b->size(); });
+    }
+    SetsMemberCursor* driver = cursors[0].get();
+    for (size_t idx = 1; idx < cursors.size(); ++idx) {
+      cursors[idx]->set_seek_only(cursors[idx]->size() / kSetsSeekSkew >= driver->size());
+    }
+    while (driver->Valid() && s.ok()) {
+      Slice member = driver->member();
+      bool found = false;
+      bool all = true;
+      SetsMemberCursor* ahead = nullptr;
+      for (size_t idx = 1; idx < cursors.size(); ++idx) {
+        SetsMemberCursor* cursor = cursors[idx].get();
+        cursor->SkipTo(member);
+        if (cursor->Valid() && cursor->member().compare(member) == 0) {
+          found = true;
+          if (op == kSetsDiff) {
             break;
-          } else if (!s.IsNotFound()) {
-            delete iter;
-            return s;
           }
+        } else if (op == kSetsInter) {
+          all = false;
+          ahead = cursor;
+          break;
         }
+      }
+      if (op == kSetsDiff) {
         if (!found) {
-          members->push_back(member.ToString());
+          s = handle(member);
         }
+        driver->Next();
+      } else if (all) {
+        s = handle(member);
+        driver->Next();
+      } else if (ahead->Valid()) {
+        // leap the driver to the member the other set is at
+        driver->SkipTo(ahead->member());
+      } else {
+        break;
       }
-      delete iter;
     }
-  } else if (!s.IsNotFound()) {
+  }
+  if (!s.ok()) {
     return s;
   }
-  return rocksdb::Status::OK();
-}
-
-rocksdb::Status RedisSets::SDiffstore(const Slice& destination, const std::vector<std::string>& keys, int32_t* ret) {
-  if (keys.empty()) {
-    return rocksdb::Status::Corruption("SDiffsotre invalid parameter, no keys");
+  for (const auto& cursor : cursors) {
+    if (!cursor->status().ok()) {
+      return cursor->status();
+    }
   }
+  return Status::OK();
+}
 
-  rocksdb::WriteBatch batch;
+rocksdb::Status RedisSets::MergeSetsStore(const Slice& destination, SetsOperation op,
+                                          const std::vector<std::string>& keys, int32_t* ret) {
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
 
   std::string meta_value;
   int32_t version = 0;
+  uint32_t statistic = 0;
   ScopeRecordLock l(lock_mgr_, destination);
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
-  rocksdb::Status s;
-
-  for (uint32_t idx = 1; idx < keys.size(); ++idx) {
-    s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
-    if (s.ok()) {
-      ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-      if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.count() != 0) {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.version()});
-      }
-    } else if (!s.IsNotFound()) {
-      return s;
-    }
-  }
-
-  std::vector<std::string> members;
-  s = db_->Get(read_options, handles_[0], keys[0], &meta_value);
-  if (s.ok()) {
-    ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-    if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.count() != 0) {
-      bool found;
-      std::string member_value;
-      version = parsed_sets_meta_value.version();
-      SetsMemberKey sets_member_key(keys[0], version, Slice());
-      Slice prefix = sets_member_key.Encode();
-      auto iter = db_->NewIterator(read_options, handles_[1]);
-      for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-        ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-        Slice member = parsed_sets_member_key.member();
-
-        found = false;
-        for (const auto& key_version : vaild_sets) {
-          SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-          s = db_->Get(read_options, handles_[1], sets_member_key.Encode(), &member_value);
-          if (s.ok()) {
-            found = true;
-            break;
-          } else if (!s.IsNotFound()) {
-            delete iter;
-            return s;
-          }
-        }
-        if (!found) {
-          members.push_back(member.ToString());
-        }
-      }
-      delete iter;
-    }
-  } else if (!s.IsNotFound()) {
-    return s;
-  }
 
-  uint32_t statistic = 0;
-  s = db_->Get(read_options, handles_[0], destination, &meta_value);
+  // The members are written under a new version of the destination, in
+  // batches of bounded size, and the meta value that makes them visible
+  // goes last
+  rocksdb::Status s = db_->Get(read_options, handles_[0], destination, &meta_value);
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     statistic = parsed_sets_meta_value.count();
     version = parsed_sets_meta_value.InitialMetaValue();
-    parsed_sets_meta_value.set_count(members.size());
-    batch.Put(handles_[0], destination, meta_value);
   } else if (s.IsNotFound()) {
     char str[4];
-    EncodeFixed32(str, members.size());
+    EncodeFixed32(str, 0);
     SetsMetaValue sets_meta_value(Slice(str, sizeof(int32_t)));
     version = sets_meta_value.UpdateVersion();
-    batch.Put(handles_[0], destination, sets_meta_value.Encode());
+    meta_value = sets_meta_value.Encode().ToString();
   } else {
     return s;
   }
-  for (const auto& member : members) {
-    SetsMemberKey sets_member_key(destination, version, member);
-    batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+
+  int32_t count = 0;
+  rocksdb::WriteBatch batch;
+  s = MergeSets(read_options, op, keys, [&](const Slice& member) {
+    PutMember(&batch, destination, version, member);
+    count++;
+    if (count % SETS_STORE_BATCH_COUNT != 0) {
+      return Status::OK();
+    }
+    Status ws = db_->Write(default_write_options_, &batch);
+    batch.Clear();
+    return ws;
+  });
+  if (!s.ok()) {
+    // drop the members written of a version that will not be used
+    rocksdb::WriteBatch drop_batch;
+    DeleteDataRange(&drop_batch, handles_[1], destination, version, DataKeyOrder::kBytewise);
+    DeleteDataRange(&drop_batch, handles_[2], destination, version, DataKeyOrder::kBytewise);
+    db_->Write(default_write_options_, &drop_batch);
+    return s;
   }
-  *ret = members.size();
+
+  ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
+  parsed_sets_meta_value.set_count(count);
+  batch.Put(handles_[0], destination, meta_value);
+  PutSampleMark(&batch, destination, version);
+  *ret = count;
   s = db_->Write(default_write_options_, &batch);
   UpdateSpecificKeyStatistics(destination.ToString(), statistic);
   return s;
 }
 
-rocksdb::Status RedisSets::SInter(const std::vector<std::string>& keys, std::vector<std::string>* members) {
+rocksdb::Status RedisSets::SDiff(const std::vector<std::string>& keys, std::vector<std::string>* members) {
   if (keys.empty()) {
-    return rocksdb::Status::Corruption("SInter invalid parameter, no keys");
+    return rocksdb::Status::Corruption("SDiff invalid parameter, no keys");
   }
 
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
-
-  std::string meta_value;
-  int32_t version = 0;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
-  rocksdb::Status s;
-
-  for (uint32_t idx = 1; idx < keys.size(); ++idx) {
-    s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
-    if (s.ok()) {
-      ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-      if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.count() == 0) {
-        return rocksdb::Status::OK();
-      } else {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.version()});
-      }
-    } else if (s.IsNotFound()) {
-      return rocksdb::Status::OK();
-    } else {
-      return s;
-    }
-  }
+  return MergeSets(read_options, kSetsDiff, keys, [members](const Slice& member) {
+    members->push_back(member.ToString());
+    return Status::OK();
+  });
+}
 
-  s = db_->Get(read_options, handles_[0], keys[0], &meta_value);
-  if (s.ok()) {
-    ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-    if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.count() == 0) {
-      return rocksdb::Status::OK();
-    } else {
-      bool reliable;
-      std::string member_value;
-      version = parsed_sets_meta_value.version();
-      SetsMemberKey sets_member_key(keys[0], version, Slice());
-      Slice prefix = sets_member_key.Encode();
-      auto iter = db_->NewIterator(read_options, handles_[1]);
-      for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-        ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-        Slice member = parsed_sets_member_key.member();
-
-        reliable = true;
-        for (const auto& key_version : vaild_sets) {
-          SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-          s = db_->Get(read_options, handles_[1], sets_member_key.Encode(), &member_value);
-          if (s.ok()) {
-            continue;
-          } else if (s.IsNotFound()) {
-            reliable = false;
-            break;
-          } else {
-            delete iter;
-            return s;
-          }
-        }
-        if (reliable) {
-          members->push_back(member.ToString());
-        }
-      }
-      delete iter;
-    }
-  } else if (s.IsNotFound()) {
-    return rocksdb::Status::OK();
-  } else {
-    return s;
+rocksdb::Status RedisSets::SDiffstore(const Slice& destination, const std::vector<std::string>& keys, int32_t* ret) {
+  if (keys.empty()) {
+    return rocksdb::Status::Corruption("SDiffsotre invalid parameter, no keys");
   }
-  return rocksdb::Status::OK();
+  return MergeSetsStore(destination, kSetsDiff, keys, ret);
 }
 
-rocksdb::Status RedisSets::SInterstore(const Slice& destination, const std::vector<std::string>& keys, int32_t* ret) {
+rocksdb::Status RedisSets::SInter(const std::vector<std::string>& keys, std::vector<std::string>* members) {
   if (keys.empty()) {
-    return rocksdb::Status::Corruption("SInterstore invalid parameter, no keys");
+    return rocksdb::Status::Corruption("SInter invalid parameter, no keys");
   }
 
-  rocksdb::WriteBatch batch;
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
-
-  std::string meta_value;
-  int32_t version = 0;
-  bool have_invalid_sets = false;
-  ScopeRecordLock l(lock_mgr_, destination);
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
-  rocksdb::Status s;
-
-  for (uint32_t idx = 1; idx < keys.size(); ++idx) {
-    s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
-    if (s.ok()) {
-      ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-      if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.count() == 0) {
-        have_invalid_sets = true;
-        break;
-      } else {
-        vaild_sets.push_back({keys[idx], parsed_sets_meta_value.version()});
-      }
-    } else if (s.IsNotFound()) {
-      have_invalid_sets = true;
-      break;
-    } else {
-      return s;
-    }
-  }
-
-  std::vector<std::string> members;
-  if (!have_invalid_sets) {
-    s = db_->Get(read_options, handles_[0], keys[0], &meta_value);
-    if (s.ok()) {
-      ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-      if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.count() == 0) {
-        have_invalid_sets = true;
-      } else {
-        bool reliable;
-        std::string member_value;
-        version = parsed_sets_meta_value.version();
-        SetsMemberKey sets_member_key(keys[0], version, Slice());
-        Slice prefix = sets_member_key.Encode();
-        auto iter = db_->NewIterator(read_options, handles_[1]);
-        for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-          ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-          Slice member = parsed_sets_member_key.member();
-
-          reliable = true;
-          for (const auto& key_version : vaild_sets) {
-            SetsMemberKey sets_member_key(key_version.key, key_version.version, member);
-            s = db_->Get(read_options, handles_[1], sets_member_key.Encode(), &member_value);
-            if (s.ok()) {
-              continue;
-            } else if (s.IsNotFound()) {
-              reliable = false;
-              break;
-            } else {
-              delete iter;
-              return s;
-            }
-          }
-          if (reliable) {
-            members.push_back(member.ToString());
-          }
-        }
-        delete iter;
-      }
-    } else if (s.IsNotFound()) {
-    } else {
-      return s;
-    }
-  }
+  return MergeSets(read_options, kSetsInter, keys, [members](const Slice& member) {
+    members->push_back(member.ToString());
+    return Status::OK();
+  });
+}
 
-  uint32_t statistic = 0;
-  s = db_->Get(read_options, handles_[0], destination, &meta_value);
-  if (s.ok()) {
-    ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-    statistic = parsed_sets_meta_value.count();
-    version = parsed_sets_meta_value.InitialMetaValue();
-    parsed_sets_meta_value.set_count(members.size());
-    batch.Put(handles_[0], destination, meta_value);
-  } else if (s.IsNotFound()) {
-    char str[4];
-    EncodeFixed32(str, members.size());
-    SetsMetaValue sets_meta_value(Slice(str, sizeof(int32_t)));
-    version = sets_meta_value.UpdateVersion();
-    batch.Put(handles_[0], destination, sets_meta_value.Encode());
-  } else {
-    return s;
-  }
-  for (const auto& member : members) {
-    SetsMemberKey sets_member_key(destination, version, member);
-    batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+rocksdb::Status RedisSets::SInterstore(const Slice& destination, const std::vector<std::string>& keys, int32_t* ret) {
+  if (keys.empty()) {
+    return rocksdb::Status::Corruption("SInterstore invalid parameter, no keys");
   }
-  *ret = members.size();
-  s = db_->Write(default_write_options_, &batch);
-  UpdateSpecificKeyStatistics(destination.ToString(), statistic);
-  return s;
+  return MergeSetsStore(destination, kSetsInter, keys, ret);
 }
 
 rocksdb::Status RedisSets::SIsmember(const Slice& key, const Slice& member, int32_t* ret) {
@@ -714,7 +660,7 @@ rocksdb::Status RedisSets::SMove(const Slice& source, const Slice& destination,
         *ret = 1;
         parsed_sets_meta_value.ModifyCount(-1);
         batch.Put(handles_[0], source, meta_value);
-        batch.Delete(handles_[1], sets_member_key.Encode());
+        DeleteMember(&batch, source, version, member);
         statistic++;
       } else if (s.IsNotFound()) {
         *ret = 0;
@@ -737,8 +683,8 @@ rocksdb::Status RedisSets::SMove(const Slice& source, const Slice& destination,
       version = parsed_sets_meta_value.InitialMetaValue();
       parsed_sets_meta_value.set_count(1);
       batch.Put(handles_[0], destination, meta_value);
-      SetsMemberKey sets_member_key(destination, version, member);
-      batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+      PutSampleMark(&batch, destination, version);
+      PutMember(&batch, destination, version, member);
     } else {
       std::string member_value;
       version = parsed_sets_meta_value.version();
@@ -747,7 +693,7 @@ rocksdb::Status RedisSets::SMove(const Slice& source, const Slice& destination,
       if (s.IsNotFound()) {
         parsed_sets_meta_value.ModifyCount(1);
         batch.Put(handles_[0], destination, meta_value);
-        batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+        PutMember(&batch, destination, version, member);
       } else if (!s.ok()) {
         return s;
       }
@@ -758,8 +704,8 @@ rocksdb::Status RedisSets::SMove(const Slice& source, const Slice& destination,
     SetsMetaValue sets_meta_value(Slice(str, sizeof(int32_t)));
     version = sets_meta_value.UpdateVersion();
     batch.Put(handles_[0], destination, sets_meta_value.Encode());
-    SetsMemberKey sets_member_key(destination, version, member);
-    batch.Put(handles_[1], sets_member_key.Encode(), Slice());
+    PutSampleMark(&batch, destination, version);
+    PutMember(&batch, destination, version, member);
   } else {
     return s;
   }
@@ -769,7 +715,7 @@ rocksdb::Status RedisSets::SMove(const Slice& source, const Slice& destination,
 }
 
 rocksdb::Status RedisSets::SPop(const Slice& key, std::vector<std::string>* members, bool* need_compact, int64_t cnt) {
-  std::default_random_engine engine;
+  std::mt19937_64 engine(pstd::NowMicros());
 
   std::string meta_value;
   rocksdb::WriteBatch batch;
@@ -785,68 +731,33 @@ rocksdb::Status RedisSets::SPop(const Slice& key, std::vector<std::string>* memb
       return Status::NotFound();
     } else {
       int32_t length = parsed_sets_meta_value.count();
+      int32_t version = parsed_sets_meta_value.version();
       if (length < cnt) {
-        int32_t size = parsed_sets_meta_value.count();
         int32_t cur_index = 0;
-        int32_t version = parsed_sets_meta_value.version();
         SetsMemberKey sets_member_key(key, version, Slice());
         auto iter = db_->NewIterator(default_read_options_, handles_[1]);
         for (iter->Seek(sets_member_key.Encode());
-            iter->Valid() && cur_index < size;
+            iter->Valid() && cur_index < length;
             iter->Next(), cur_index++) {
-
-            batch.Delete(handles_[1], iter->key());
-            ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-            members->push_back(parsed_sets_member_key.member().ToString());
-
+          ParsedSetsMemberKey parsed_sets_member_key(iter->key());
+          DeleteMember(&batch, key, version, parsed_sets_member_key.member());
+          members->push_back(parsed_sets_member_key.member().ToString());
         }
-
-        //parsed_sets_meta_value.ModifyCount(-cnt);
-        //batch.Put(handles_[0], key, meta_value);
         batch.Delete(handles_[0], key);
-        delete iter;   
-
+        delete iter;
       } else {
-        engine.seed(time(nullptr));
-        int32_t cur_index = 0;
-        int32_t size = parsed_sets_meta_value.count();
-        int32_t target_index = -1;
-        int32_t version = parsed_sets_meta_value.version();
-        std::unordered_set<int32_t> sets_index;
-        int32_t modnum = size;
-
-        for (int64_t cur_round = 0;
-            cur_round < cnt;
-            cur_round++) {
-          do {
-            target_index = engine() % modnum;
-          } while (sets_index.find(target_index) != sets_index.end());
-          sets_index.insert(target_index);
+        std::vector<std::string> popped;
+        s = DrawMembers(default_read_options_, key, version, length, cnt, true, &engine, &popped);
+        if (!s.ok()) {
+          return s;
         }
-
-        SetsMemberKey sets_member_key(key, version, Slice());
-        int64_t del_count = 0;
-        auto iter = db_->NewIterator(default_read_options_, handles_[1]);
-        for (iter->Seek(sets_member_key.Encode());
-            iter->Valid() && cur_index < size;
-            iter->Next(), cur_index++) {
-          if (del_count == cnt) {
-            break;
-          }
-          if (sets_index.find(cur_index) != sets_index.end()) {
-            del_count++;
-            batch.Delete(handles_[1], iter->key());
-            ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-            members->push_back(parsed_sets_member_key.member().ToString());
-          }
+        for (const auto& member : popped) {
+          DeleteMember(&batch, key, version, member);
         }
-
-        parsed_sets_meta_value.ModifyCount(-cnt);
+        parsed_sets_meta_value.ModifyCount(-static_cast<int32_t>(popped.size()));
         batch.Put(handles_[0], key, meta_value);
-        delete iter;
-
+        members->insert(members->end(), popped.begin(), popped.end());
       }
-      
     }
   } else {
     return s;
@@ -878,16 +789,16 @@ rocksdb::Status RedisSets::SRandmember(const Slice& key, int32_t count, std::vec
   }
 
   members->clear();
-  int64_t last_seed = pstd::NowMicros();
-  std::default_random_engine engine;
+  std::mt19937_64 engine(pstd::NowMicros());
 
+  // a read of the set as of one snapshot, the writers are not blocked
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot;
   std::string meta_value;
-  rocksdb::WriteBatch batch;
-  ScopeRecordLock l(lock_mgr_, key);
-  std::vector<int32_t> targets;
-  std::unordered_set<int32_t> unique;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
 
-  rocksdb::Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  rocksdb::Status s = db_->Get(read_options, handles_[0], key, &meta_value);
   if (s.ok()) {
     ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
     if (parsed_sets_meta_value.IsStale()) {
@@ -897,49 +808,220 @@ rocksdb::Status RedisSets::SRandmember(const Slice& key, int32_t count, std::vec
     } else {
       int32_t size = parsed_sets_meta_value.count();
       int32_t version = parsed_sets_meta_value.version();
-      if (count > 0) {
-        count = count <= size ? count : size;
-        while (targets.size() < static_cast<size_t>(count)) {
-          engine.seed(last_seed);
-          last_seed = engine();
-          uint32_t pos = last_seed % size;
-          if (unique.find(pos) == unique.end()) {
-            unique.insert(pos);
-            targets.push_back(pos);
-          }
-        }
-      } else {
-        count = -count;
-        while (targets.size() < static_cast<size_t>(count)) {
-          engine.seed(last_seed);
-          last_seed = engine();
-          targets.push_back(last_seed % size);
-        }
+      bool distinct = count > 0;
+      int64_t draws = distinct ? std::min(count, size) : -static_cast<int64_t>(count);
+      s = DrawMembers(read_options, key, version, size, draws, distinct, &engine, members);
+      if (!s.ok()) {
+        members->clear();
+        return s;
       }
-      std::sort(targets.begin(), targets.end());
+      std::shuffle(members->begin(), members->end(), engine);
+    }
+  }
+  return s;
+}
 
-      int32_t cur_index = 0;
-      int32_t idx = 0;
-      SetsMemberKey sets_member_key(key, version, Slice());
-      auto iter = db_->NewIterator(default_read_options_, handles_[1]);
-      for (iter->Seek(sets_member_key.Encode()); iter->Valid() && cur_index < size; iter->Next(), cur_index++) {
-        if (static_cast<size_t>(idx) >= targets.size()) {
-          break;
-        }
-        ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-        while (static_cast<size_t>(idx) < targets.size() && cur_index == targets[idx]) {
-          idx++;
-          members->push_back(parsed_sets_member_key.member().ToString());
-        }
+void RedisSets::PutMember(rocksdb::WriteBatch* batch, const Slice& key, int32_t version, const Slice& member) {
+  SetsMemberKey sets_member_key(key, version, member);
+  batch->Put(handles_[1], sets_member_key.Encode(), Slice());
+  batch->Put(handles_[2], EncodeSetsSampleKey(key, version, member), Slice());
+}
+
+void RedisSets::DeleteMember(rocksdb::WriteBatch* batch, const Slice& key, int32_t version, const Slice& member) {
+  SetsMemberKey sets_member_key(key, version, member);
+  batch->Delete(handles_[1], sets_member_key.Encode());
+  batch->Delete(handles_[2], EncodeSetsSampleKey(key, version, member));
+}
+
+void RedisSets::PutSampleMark(rocksdb::WriteBatch* batch, const Slice& key, int32_t version) {
+  batch->Put(handles_[2], EncodeSetsSampleMark(key, version), Slice());
+}
+
+Status RedisSets::BuildSampleIndex(const Slice& key, int32_t version) {
+  // reached from the reads, which may run in an EXEC or a script holding
+  // the stripes of other keys, waiting for this one out of their order
+  // could deadlock, the next draw indexes the set instead
+  TryScopeRecordLock l(lock_mgr_, key);
+  if (!l.locked()) {
+    return Status::OK();
+  }
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (!s.ok()) {
+    return s;
+  }
+  ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
+  if (parsed_sets_meta_value.IsStale() || parsed_sets_meta_value.version() != version) {
+    // the set was changed since it was read, its new version is indexed
+    return Status::OK();
+  }
+  std::string mark = EncodeSetsSampleMark(key, version);
+  std::string value;
+  s = db_->Get(default_read_options_, handles_[2], mark, &value);
+  if (s.ok()) {
+    return s;
+  } else if (!s.IsNotFound()) {
+    return s;
+  }
+
+  rocksdb::WriteBatch batch;
+  SetsMemberKey sets_member_key(key, version, Slice());
+  Slice prefix = sets_member_key.Encode();
+  auto iter = db_->NewIterator(default_read_options_, handles_[1]);
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    ParsedSetsMemberKey parsed_sets_member_key(iter->key());
+    batch.Put(handles_[2], EncodeSetsSampleKey(key, version, parsed_sets_member_key.member()), Slice());
+    if (batch.Count() >= 1024) {
+      s = db_->Write(default_write_options_, &batch);
+      if (!s.ok()) {
+        delete iter;
+        return s;
       }
+      batch.Clear();
+    }
+  }
+  s = iter->status();
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+  // the mark last, an index cut short is built again
+  PutSampleMark(&batch, key, version);
+  return db_->Write(default_write_options_, &batch);
+}
 
-      std::shuffle(members->begin(), members->end(), engine);
-      delete iter;
+Status RedisSets::SampleMembers(const rocksdb::ReadOptions& read_options, const Slice& key, int32_t version,
+                                int32_t size, int64_t count, bool distinct, std::mt19937_64* engine,
+                                std::vector<std::string>* members) {
+  std::string mark = EncodeSetsSampleMark(key, version);
+  std::string value;
+  Status s = db_->Get(read_options, handles_[2], mark, &value);
+  if (s.IsNotFound()) {
+    return Status::Incomplete("no sampling index");
+  } else if (!s.ok()) {
+    return s;
+  }
+
+  // The hash space is cut in buckets of about 4 members. A draw picks a
+  // bucket, then a slot of it, and takes the member in that slot if there
+  // is one, so every member has the same chance whatever its bucket holds,
+  // as long as no bucket has more members than slots.
+  uint64_t buckets = std::max<uint64_t>(size / 4, 1);
+  size_t slots = 32;
+  std::unordered_set<std::string> drawn;
+  std::vector<std::string> bucket_members;
+  int64_t attempts = 0;
+  int64_t max_attempts = count * 256 + 4096;
+  rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[2]);
+  while (static_cast<int64_t>(members->size()) < count) {
+    if (++attempts > max_attempts) {
+      break;
+    }
+    uint64_t bucket = (*engine)() % buckets;
+    auto begin = static_cast<uint64_t>((static_cast<unsigned __int128>(bucket) << 64) / buckets);
+    auto end = static_cast<uint64_t>((static_cast<unsigned __int128>(bucket + 1) << 64) / buckets);
+    bool last = bucket + 1 == buckets;
+
+    bucket_members.clear();
+    for (iter->Seek(EncodeSetsSampleSeekKey(key, version, begin));
+         iter->Valid() && iter->key().starts_with(mark); iter->Next()) {
+      ParsedSetsSampleKey parsed_sets_sample_key(iter->key());
+      if (!parsed_sets_sample_key.IsMember()) {
+        continue;
+      }
+      if (!last && parsed_sets_sample_key.hash() >= end) {
+        break;
+      }
+      bucket_members.push_back(parsed_sets_sample_key.member().ToString());
+    }
+    if (!iter->status().ok()) {
+      break;
+    }
+    if (bucket_members.size() > slots) {
+      // start again with as many slots as the largest bucket
+      slots = bucket_members.size();
+      members->clear();
+      drawn.clear();
+      continue;
+    }
+    size_t slot = (*engine)() % slots;
+    if (slot >= bucket_members.size()) {
+      continue;
+    }
+    if (distinct && !drawn.insert(bucket_members[slot]).second) {
+      continue;
+    }
+    members->push_back(bucket_members[slot]);
+  }
+  s = iter->status();
+  delete iter;
+  if (!s.ok()) {
+    return s;
+  }
+  if (static_cast<int64_t>(members->size()) < count) {
+    members->clear();
+    return Status::Incomplete("too many attempts");
+  }
+  return Status::OK();
+}
+
+Status RedisSets::ScanSampleMembers(const rocksdb::ReadOptions& read_options, const Slice& key, int32_t version,
+                                    int32_t size, int64_t count, bool distinct, std::mt19937_64* engine,
+                                    std::vector<std::string>* members) {
+  std::vector<int32_t> targets;
+  if (distinct) {
+    std::unordered_set<int32_t> unique;
+    while (static_cast<int64_t>(targets.size()) < count) {
+      auto pos = static_cast<int32_t>((*engine)() % size);
+      if (unique.insert(pos).second) {
+        targets.push_back(pos);
+      }
+    }
+  } else {
+    for (int64_t i = 0; i < count; i++) {
+      targets.push_back(static_cast<int32_t>((*engine)() % size));
     }
   }
+  std::sort(targets.begin(), targets.end());
+
+  int32_t cur_index = 0;
+  size_t idx = 0;
+  SetsMemberKey sets_member_key(key, version, Slice());
+  auto iter = db_->NewIterator(read_options, handles_[1]);
+  for (iter->Seek(sets_member_key.Encode()); iter->Valid() && cur_index < size; iter->Next(), cur_index++) {
+    if (idx >= targets.size()) {
+      break;
+    }
+    ParsedSetsMemberKey parsed_sets_member_key(iter->key());
+    while (idx < targets.size() && cur_index == targets[idx]) {
+      idx++;
+      members->push_back(parsed_sets_member_key.member().ToString());
+    }
+  }
+  Status s = iter->status();
+  delete iter;
   return s;
 }
 
+Status RedisSets::DrawMembers(const rocksdb::ReadOptions& read_options, const Slice& key, int32_t version,
+                              int32_t size, int64_t count, bool distinct, std::mt19937_64* engine,
+                              std::vector<std::string>* members) {
+  // a large part of the set is cheaper to take in one pass
+  if (distinct && count * 8 >= size) {
+    return ScanSampleMembers(read_options, key, version, size, count, distinct, engine, members);
+  }
+  Status s = SampleMembers(read_options, key, version, size, count, distinct, engine, members);
+  if (!s.IsIncomplete()) {
+    return s;
+  }
+  // index the set for the next draws, draw this one from the member cf
+  s = BuildSampleIndex(key, version);
+  if (!s.ok() && !s.IsNotFound()) {
+    return s;
+  }
+  return ScanSampleMembers(read_options, key, version, size, count, distinct, engine, members);
+}
+
 rocksdb::Status RedisSets::SRem(const Slice& key, const std::vector<std::string>& members, int32_t* ret) {
   *ret = 0;
   rocksdb::WriteBatch batch;
@@ -965,7 +1047,7 @@ rocksdb::Status RedisSets::SRem(const Slice& key, const std::vector<std::string>
         if (s.ok()) {
           cnt++;
           statistic++;
-          batch.Delete(handles_[1], sets_member_key.Encode());
+          DeleteMember(&batch, key, version, member);
         } else if (s.IsNotFound()) {
         } else {
           return s;
@@ -993,116 +1075,19 @@ rocksdb::Status RedisSets::SUnion(const std::vector<std::string>& keys, std::vec
 
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot;
-
-  std::string meta_value;
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
-  rocksdb::Status s;
-
-  for (const auto & key : keys) {
-    s = db_->Get(read_options, handles_[0], key, &meta_value);
-    if (s.ok()) {
-      ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-      if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.count() != 0) {
-        vaild_sets.push_back({key, parsed_sets_meta_value.version()});
-      }
-    } else if (!s.IsNotFound()) {
-      return s;
-    }
-  }
-
-  Slice prefix;
-  std::map<std::string, bool> result_flag;
-  for (const auto& key_version : vaild_sets) {
-    SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
-    prefix = sets_member_key.Encode();
-    auto iter = db_->NewIterator(read_options, handles_[1]);
-    for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-      ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-      std::string member = parsed_sets_member_key.member().ToString();
-      if (result_flag.find(member) == result_flag.end()) {
-        members->push_back(member);
-        result_flag[member] = true;
-      }
-    }
-    delete iter;
-  }
-  return rocksdb::Status::OK();
+  return MergeSets(read_options, kSetsUnion, keys, [members](const Slice& member) {
+    members->push_back(member.ToString());
+    return Status::OK();
+  });
 }
 
 rocksdb::Status RedisSets::SUnionstore(const Slice& destination, const std::vector<std::string>& keys, int32_t* ret) {
   if (keys.empty()) {
     return rocksdb::Status::Corruption("SUnionstore invalid parameter, no keys");
   }
-
-  rocksdb::WriteBatch batch;
-  rocksdb::ReadOptions read_options;
-  const rocksdb::Snapshot* snapshot;
-
-  std::string meta_value;
-  int32_t version = 0;
-  ScopeRecordLock l(lock_mgr_, destination);
-  ScopeSnapshot ss(db_, &snapshot);
-  read_options.snapshot = snapshot;
-  std::vector<KeyVersion> vaild_sets;
-  rocksdb::Status s;
-
-  for (const auto & key : keys) {
-    s = db_->Get(read_options, handles_[0], key, &meta_value);
-    if (s.ok()) {
-      ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-      if (!parsed_sets_meta_value.IsStale() && parsed_sets_meta_value.count() != 0) {
-        vaild_sets.push_back({key, parsed_sets_meta_value.version()});
-      }
-    } else if (!s.IsNotFound()) {
-      return s;
-    }
-  }
-
-  Slice prefix;
-  std::vector<std::string> members;
-  std::map<std::string, bool> result_flag;
-  for (const auto& key_version : vaild_sets) {
-    SetsMemberKey sets_member_key(key_version.key, key_version.version, Slice());
-    prefix = sets_member_key.Encode();
-    auto iter = db_->NewIterator(read_options, handles_[1]);
-    for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
-      ParsedSetsMemberKey parsed_sets_member_key(iter->key());
-      std::string member = parsed_sets_member_key.member().ToString();
-      if (result_flag.find(member) == result_flag.end()) {
-        members.push_back(member);
-        result_flag[member] = true;
-      }
-    }
-    delete iter;
-  }
-
-  uint32_t statistic = 0;
-  s = db_->Get(read_options, handles_[0], destination, &meta_value);
-  if (s.ok()) {
-    ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
-    statistic = parsed_sets_meta_value.count();
-    version = parsed_sets_meta_value.InitialMetaValue();
-    parsed_sets_meta_value.set_count(members.size());
-    batch.Put(handles_[0], destination, meta_value);
-  } else if (s.IsNotFound()) {
-    char str[4];
-    EncodeFixed32(str, members.size());
-    SetsMetaValue sets_meta_value(Slice(str, sizeof(int32_t)));
-    version = sets_meta_value.UpdateVersion();
-    batch.Put(handles_[0], destination, sets_meta_value.Encode());
-  } else {
-    return s;
-  }
-  for (const auto& member : members) {
-    SetsMemberKey sets_member_key(destination, version, member);
-    batch.Put(handles_[1], sets_member_key.Encode(), Slice());
-  }
-  *ret = members.size();
-  s = db_->Write(default_write_options_, &batch);
-  UpdateSpecificKeyStatistics(destination.ToString(), statistic);
-  return s;
+  return MergeSetsStore(destination, kSetsUnion, keys, ret);
 }
 
 rocksdb::Status RedisSets::SScan(const Slice& key, int64_t cursor, const std::string& pattern, int64_t count,
@@ -1133,8 +1118,15 @@ rocksdb::Status RedisSets::SScan(const Slice& key, int64_t cursor, const std::st
       std::string start_point;
       int32_t version = parsed_sets_meta_value.version();
       s = GetScanStartPoint(key, pattern, cursor, &start_point);
+      // an evicted cursor is the number of members visited before it, they
+      // are skipped again rather than restarting the scan, up to a bound
+      int64_t skip = 0;
       if (s.IsNotFound()) {
-        cursor = 0;
+        if (cursor <= ScanCursorStore::kMaxResumeWalk) {
+          skip = cursor;
+        } else {
+          cursor = 0;
+        }
         if (isTailWildcard(pattern)) {
           start_point = pattern.substr(0, pattern.size() - 1);
         }
@@ -1147,8 +1139,11 @@ rocksdb::Status RedisSets::SScan(const Slice& key, int64_t cursor, const std::st
       SetsMemberKey sets_member_key(key, version, start_point);
       std::string prefix = sets_member_prefix.Encode().ToString();
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[1]);
-      for (iter->Seek(sets_member_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
-           iter->Next()) {
+      iter->Seek(sets_member_key.Encode());
+      for (; skip > 0 && iter->Valid() && iter->key().starts_with(prefix); skip--) {
+        iter->Next();
+      }
+      for (; iter->Valid() && rest > 0 && iter->key().starts_with(prefix); iter->Next()) {
         ParsedSetsMemberKey parsed_sets_member_key(iter->key());
         std::string member = parsed_sets_member_key.member().ToString();
         if (StringMatch(pattern.data(), pattern.size(), member.data(), member.size(), 0) != 0) {
@@ -1294,10 +1289,10 @@ rocksdb::Status RedisSets::Expire(const Slice& key, int32_t ttl) {
 
     if (ttl > 0) {
       parsed_sets_meta_value.SetRelativeTimestamp(ttl);
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_sets_meta_value.timestamp());
     } else {
       parsed_sets_meta_value.InitialMetaValue();
-      s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+      s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_sets_meta_value.timestamp());
     }
   }
   return s;
@@ -1413,7 +1408,7 @@ rocksdb::Status RedisSets::Expireat(const Slice& key, int32_t timestamp) {
       } else {
         parsed_sets_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[0], key, meta_value);
+      return PutWithExpireIndex(handles_[0], key, meta_value, parsed_sets_meta_value.timestamp());
     }
   }
   return s;
@@ -1469,6 +1464,32 @@ rocksdb::Status RedisSets::TTL(const Slice& key, int64_t* timestamp) {
   return s;
 }
 
+Status RedisSets::ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) {
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedSetsMetaValue parsed_sets_meta_value(&meta_value);
+  // the ttl was changed or the key was recreated since it was indexed
+  if (parsed_sets_meta_value.timestamp() != timestamp || !parsed_sets_meta_value.IsStale()) {
+    return Status::OK();
+  }
+  int32_t version = parsed_sets_meta_value.version();
+  int32_t count = parsed_sets_meta_value.count();
+  parsed_sets_meta_value.InitialMetaValue();
+  batch->Put(handles_[0], key, meta_value);
+  // the data of small collections are dropped by the data filter, do not
+  // wait for the compaction for big ones
+  if (count >= static_cast<int32_t>(small_compaction_threshold_)) {
+    DeleteDataRange(batch, handles_[1], key, version, DataKeyOrder::kBytewise);
+    DeleteDataRange(batch, handles_[2], key, version, DataKeyOrder::kBytewise);
+  }
+  return Status::OK();
+}
+
 void RedisSets::ScanDatabase() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
@@ -6,6 +6,8 @@
 #ifndef SRC_REDIS_SETS_H_
 #define SRC_REDIS_SETS_H_
 
+#include <functional>
+#include <random>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -18,6 +20,8 @@
 
 #define SPOP_COMPACT_THRESHOLD_COUNT 500
 #define SPOP_COMPACT_THRESHOLD_DURATION (1000 * 1000)  // 1000ms
+// The members written in one batch by the STORE set operations
+#define SETS_STORE_BATCH_COUNT 1024
 
 namespace storage {
 
@@ -71,11 +75,43 @@ class RedisSets : public Redis {
   // Iterate all data
   void ScanDatabase();
 
+ protected:
+  Status ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) override;
+
  private:
   // For compact in time after multiple spop
   std::unique_ptr<LRUCache<std::string, size_t>> spop_counts_store_;
   Status ResetSpopCount(const std::string& key);
   Status AddAndGetSpopCount(const std::string& key, uint64_t* count);
+
+  enum SetsOperation { kSetsDiff, kSetsInter, kSetsUnion };
+  // Merge the sorted members of the sets of keys, every member of the result
+  // is passed to handle in order
+  Status MergeSets(const rocksdb::ReadOptions& read_options, SetsOperation op, const std::vector<std::string>& keys,
+                   const std::function<Status(const Slice&)>& handle);
+  Status MergeSetsStore(const Slice& destination, SetsOperation op, const std::vector<std::string>& keys,
+                        int32_t* ret);
+
+  // The members are written to the member cf and to the sampling index, see
+  // sets_sample_key_format.h, together
+  void PutMember(rocksdb::WriteBatch* batch, const Slice& key, int32_t version, const Slice& member);
+  void DeleteMember(rocksdb::WriteBatch* batch, const Slice& key, int32_t version, const Slice& member);
+  // A new version of a set has all its members in the sampling index
+  void PutSampleMark(rocksdb::WriteBatch* batch, const Slice& key, int32_t version);
+  // Index the members of a set written before the sampling index
+  Status BuildSampleIndex(const Slice& key, int32_t version);
+  // Draw count members, distinct or not, from a set of size members. The
+  // index is read bucket by bucket, a draw costs O(log n) whatever the size,
+  // Incomplete if the set has no complete index
+  Status SampleMembers(const rocksdb::ReadOptions& read_options, const Slice& key, int32_t version, int32_t size,
+                       int64_t count, bool distinct, std::mt19937_64* engine, std::vector<std::string>* members);
+  // Draw by the positions of the members in the member cf, O(n)
+  Status ScanSampleMembers(const rocksdb::ReadOptions& read_options, const Slice& key, int32_t version, int32_t size,
+                           int64_t count, bool distinct, std::mt19937_64* engine, std::vector<std::string>* members);
+  // Draw from the index, or, for a large part of the set or an old set,
+  // from the member cf
+  Status DrawMembers(const rocksdb::ReadOptions& read_options, const Slice& key, int32_t version, int32_t size,
+                     int64_t count, bool distinct, std::mt19937_64* engine, std::vector<std::string>* members);
 };
 
 }  //  namespace storage
@@ -34,7 +34,13 @@ Status RedisStrings::Open(const StorageOptions& storage_options, const std::stri
   table_ops.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, true));
   ops.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_ops));
 
-  return rocksdb::DB::Open(ops, db_path, &db_);
+  rocksdb::DBOptions db_ops(ops);
+  db_ops.create_missing_column_families = true;
+  std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
+  column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions(ops));
+  // Expire index CF
+  column_families.emplace_back(kExpireIndexCf, ExpireIndexCfOptions(storage_options));
+  return OpenDB(db_ops, db_path, column_families);
 }
 
 Status RedisStrings::CompactRange(const rocksdb::Slice* begin, const rocksdb::Slice* end,
@@ -642,7 +648,7 @@ Status RedisStrings::Setxx(const Slice& key, const Slice& value, int32_t* ret, c
     if (ttl > 0) {
       strings_value.SetRelativeTimestamp(ttl);
     }
-    return db_->Put(default_write_options_, key, strings_value.Encode());
+    return PutWithExpireIndex(handles_[0], key, strings_value.Encode(), strings_value.timestamp());
   }
 }
 
@@ -701,7 +707,7 @@ Status RedisStrings::Setex(const Slice& key, const Slice& value, int32_t ttl) {
     return s;
   }
   ScopeRecordLock l(lock_mgr_, key);
-  return db_->Put(default_write_options_, key, strings_value.Encode());
+  return PutWithExpireIndex(handles_[0], key, strings_value.Encode(), strings_value.timestamp());
 }
 
 Status RedisStrings::Setnx(const Slice& key, const Slice& value, int32_t* ret, const int32_t ttl) {
@@ -716,7 +722,7 @@ Status RedisStrings::Setnx(const Slice& key, const Slice& value, int32_t* ret, c
       if (ttl > 0) {
         strings_value.SetRelativeTimestamp(ttl);
       }
-      s = db_->Put(default_write_options_, key, strings_value.Encode());
+      s = PutWithExpireIndex(handles_[0], key, strings_value.Encode(), strings_value.timestamp());
       if (s.ok()) {
         *ret = 1;
       }
@@ -726,7 +732,7 @@ Status RedisStrings::Setnx(const Slice& key, const Slice& value, int32_t* ret, c
     if (ttl > 0) {
       strings_value.SetRelativeTimestamp(ttl);
     }
-    s = db_->Put(default_write_options_, key, strings_value.Encode());
+    s = PutWithExpireIndex(handles_[0], key, strings_value.Encode(), strings_value.timestamp());
     if (s.ok()) {
       *ret = 1;
     }
@@ -750,7 +756,7 @@ Status RedisStrings::Setvx(const Slice& key, const Slice& value, const Slice& ne
         if (ttl > 0) {
           strings_value.SetRelativeTimestamp(ttl);
         }
-        s = db_->Put(default_write_options_, key, strings_value.Encode());
+        s = PutWithExpireIndex(handles_[0], key, strings_value.Encode(), strings_value.timestamp());
         if (!s.ok()) {
           return s;
         }
@@ -1034,7 +1040,7 @@ Status RedisStrings::PKSetexAt(const Slice& key, const Slice& value, int32_t tim
   StringsValue strings_value(value);
   ScopeRecordLock l(lock_mgr_, key);
   strings_value.set_timestamp(timestamp);
-  return db_->Put(default_write_options_, key, strings_value.Encode());
+  return PutWithExpireIndex(handles_[0], key, strings_value.Encode(), strings_value.timestamp());
 }
 
 Status RedisStrings::PKScanRange(const Slice& key_start, const Slice& key_end, const Slice& pattern, int32_t limit,
@@ -1160,7 +1166,7 @@ Status RedisStrings::Expire(const Slice& key, int32_t ttl) {
     }
     if (ttl > 0) {
       parsed_strings_value.SetRelativeTimestamp(ttl);
-      return db_->Put(default_write_options_, key, value);
+      return PutWithExpireIndex(handles_[0], key, value, parsed_strings_value.timestamp());
     } else {
       return db_->Delete(default_write_options_, key);
     }
@@ -1270,7 +1276,7 @@ Status RedisStrings::Expireat(const Slice& key, int32_t timestamp) {
     } else {
       if (timestamp > 0) {
         parsed_strings_value.set_timestamp(timestamp);
-        return db_->Put(default_write_options_, key, value);
+        return PutWithExpireIndex(handles_[0], key, value, parsed_strings_value.timestamp());
       } else {
         return db_->Delete(default_write_options_, key);
       }
@@ -1325,6 +1331,21 @@ Status RedisStrings::TTL(const Slice& key, int64_t* timestamp) {
   return s;
 }
 
+Status RedisStrings::ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) {
+  std::string value;
+  Status s = db_->Get(default_read_options_, key, &value);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedStringsValue parsed_strings_value(&value);
+  if (parsed_strings_value.timestamp() == timestamp && parsed_strings_value.IsStale()) {
+    batch->Delete(key);
+  }
+  return Status::OK();
+}
+
 void RedisStrings::ScanDatabase() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
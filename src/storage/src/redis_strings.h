@@ -74,6 +74,9 @@ class RedisStrings : public Redis {
 
   // Iterate all data
   void ScanDatabase();
+
+ protected:
+  Status ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) override;
 };
 
 }  //  namespace storage
@@ -7,7 +7,6 @@
 
 #include <algorithm>
 #include <limits>
-#include <map>
 #include <memory>
 
 #include <glog/logging.h>
@@ -53,6 +52,7 @@ Status RedisZSets::Open(const StorageOptions& storage_options, const std::string
   }
 
   rocksdb::DBOptions db_ops(storage_options.options);
+  db_ops.create_missing_column_families = true;
   rocksdb::ColumnFamilyOptions meta_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions data_cf_ops(storage_options.options);
   rocksdb::ColumnFamilyOptions score_cf_ops(storage_options.options);
@@ -80,7 +80,9 @@ Status RedisZSets::Open(const StorageOptions& storage_options, const std::string
   column_families.emplace_back(rocksdb::kDefaultColumnFamilyName, meta_cf_ops);
   column_families.emplace_back("data_cf", data_cf_ops);
   column_families.emplace_back("score_cf", score_cf_ops);
-  return rocksdb::DB::Open(db_ops, db_path, column_families, &handles_, &db_);
+  // Expire index CF
+  column_families.emplace_back(kExpireIndexCf, ExpireIndexCfOptions(storage_options));
+  return OpenDB(db_ops, db_path, column_families);
 }
 
 Status RedisZSets::CompactRange(const rocksdb::Slice* begin, const rocksdb::Slice* end, const ColumnFamilyType& type) {
@@ -631,6 +633,64 @@ Status RedisZSets::ZRangebyscore(const Slice& key, double min, double max, bool
   return s;
 }
 
+Status RedisZSets::ZScanScoreRanges(const Slice& key, std::vector<std::pair<double, double>> ranges,
+                                    const ScoreMemberVisitor& visitor) {
+  std::sort(ranges.begin(), ranges.end());
+  std::vector<std::pair<double, double>> merged;
+  for (const auto& range : ranges) {
+    if (range.first > range.second) {
+      continue;
+    }
+    if (!merged.empty() && range.first <= merged.back().second) {
+      merged.back().second = std::max(merged.back().second, range.second);
+    } else {
+      merged.push_back(range);
+    }
+  }
+
+  rocksdb::ReadOptions read_options;
+  const rocksdb::Snapshot* snapshot = nullptr;
+
+  std::string meta_value;
+  ScopeSnapshot ss(db_, &snapshot);
+  read_options.snapshot = snapshot;
+  Status s = db_->Get(read_options, handles_[0], key, &meta_value);
+  if (s.ok()) {
+    ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
+    if (parsed_zsets_meta_value.IsStale()) {
+      return Status::NotFound("Stale");
+    } else if (parsed_zsets_meta_value.count() == 0) {
+      return Status::NotFound();
+    }
+    int32_t version = parsed_zsets_meta_value.version();
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(read_options, handles_[2]));
+    bool stop = false;
+    for (size_t idx = 0; idx < merged.size() && !stop; ++idx) {
+      ZSetsScoreKey zsets_score_key(key, version, merged[idx].first, Slice());
+      for (iter->Seek(zsets_score_key.Encode()); iter->Valid(); iter->Next()) {
+        ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
+        if (parsed_zsets_score_key.key() != key || parsed_zsets_score_key.version() != version) {
+          // past the last element of the zset
+          stop = true;
+          break;
+        }
+        if (parsed_zsets_score_key.score() > merged[idx].second) {
+          break;
+        }
+        if (!visitor(parsed_zsets_score_key.score(), parsed_zsets_score_key.member())) {
+          stop = true;
+          break;
+        }
+      }
+      if (!iter->Valid()) {
+        break;
+      }
+    }
+    s = iter->status();
+  }
+  return s;
+}
+
 Status RedisZSets::ZRank(const Slice& key, const Slice& member, int32_t* rank) {
   *rank = -1;
   rocksdb::ReadOptions read_options;
@@ -1028,135 +1088,100 @@ Status RedisZSets::ZScore(const Slice& key, const Slice& member, double* score)
   return s;
 }
 
-Status RedisZSets::ZUnionstore(const Slice& destination, const std::vector<std::string>& keys,
-                               const std::vector<double>& weights, const AGGREGATE agg, int32_t* ret) {
-  *ret = 0;
-  uint32_t statistic = 0;
-  rocksdb::WriteBatch batch;
-  rocksdb::ReadOptions read_options;
-  const rocksdb::Snapshot* snapshot = nullptr;
+/*
+ * The members of a version of a zset are stored in their order in the data
+ * cf, a ZSetsMemberCursor walks them with their weighted scores so that the
+ * zsets are merged as they are read.
+ */
+class ZSetsMemberCursor {
+ public:
+  ZSetsMemberCursor(rocksdb::DB* db, const rocksdb::ReadOptions& read_options, rocksdb::ColumnFamilyHandle* handle,
+                    const KeyVersion& key_version, int32_t size, size_t index, double weight)
+      : size_(size), index_(index), weight_(weight), iter_(db->NewIterator(read_options, handle)) {
+    ZSetsMemberKey zsets_member_key(key_version.key, key_version.version, Slice());
+    prefix_ = zsets_member_key.Encode().ToString();
+    iter_->Seek(prefix_);
+  }
 
-  int32_t version;
-  std::string meta_value;
-  ScoreMember sm;
-  ScopeSnapshot ss(db_, &snapshot);
-  read_options.snapshot = snapshot;
-  ScopeRecordLock l(lock_mgr_, destination);
-  std::map<std::string, double> member_score_map;
+  int32_t size() const { return size_; }
+  size_t index() const { return index_; }
+  bool Valid() const { return iter_->Valid() && iter_->key().starts_with(prefix_); }
+  Status status() const { return iter_->status(); }
+  void Next() { iter_->Next(); }
+  Slice member() const {
+    Slice key = iter_->key();
+    return Slice(key.data() + prefix_.size(), key.size() - prefix_.size());
+  }
+  double score() const {
+    uint64_t tmp = DecodeFixed64(iter_->value().data());
+    const void* ptr_tmp = reinterpret_cast<const void*>(&tmp);
+    return weight_ * *reinterpret_cast<const double*>(ptr_tmp);
+  }
 
-  Status s;
-  for (size_t idx = 0; idx < keys.size(); ++idx) {
-    s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
-    if (s.ok()) {
-      ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
-      if (!parsed_zsets_meta_value.IsStale() && parsed_zsets_meta_value.count() != 0) {
-        int32_t cur_index = 0;
-        int32_t stop_index = parsed_zsets_meta_value.count() - 1;
-        double score = 0;
-        double weight = idx < weights.size() ? weights[idx] : 1;
-        version = parsed_zsets_meta_value.version();
-        ZSetsScoreKey zsets_score_key(keys[idx], version, std::numeric_limits<double>::lowest(), Slice());
-        rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[2]);
-        for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index;
-             iter->Next(), ++cur_index) {
-          ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
-          sm.score = parsed_zsets_score_key.score();
-          sm.member = parsed_zsets_score_key.member().ToString();
-          if (member_score_map.find(sm.member) == member_score_map.end()) {
-            score = weight * sm.score;
-            member_score_map[sm.member] = (score == -0.0) ? 0 : score;
-          } else {
-            score = member_score_map[sm.member];
-            switch (agg) {
-              case SUM:
-                score += weight * sm.score;
-                break;
-              case MIN:
-                score = std::min(score, weight * sm.score);
-                break;
-              case MAX:
-                score = std::max(score, weight * sm.score);
-                break;
-            }
-            member_score_map[sm.member] = (score == -0.0) ? 0 : score;
-          }
-        }
-        delete iter;
+  // Move to the first member not less than target, by a few steps first
+  void SkipTo(const Slice& target) {
+    for (int32_t step = 0; step < 8; step++) {
+      if (!Valid() || member().compare(target) >= 0) {
+        return;
       }
-    } else if (!s.IsNotFound()) {
-      return s;
+      iter_->Next();
     }
+    if (!Valid() || member().compare(target) >= 0) {
+      return;
+    }
+    std::string seek_key(prefix_);
+    seek_key.append(target.data(), target.size());
+    iter_->Seek(seek_key);
   }
 
-  s = db_->Get(read_options, handles_[0], destination, &meta_value);
-  if (s.ok()) {
-    ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
-    statistic = parsed_zsets_meta_value.count();
-    version = parsed_zsets_meta_value.InitialMetaValue();
-    parsed_zsets_meta_value.set_count(member_score_map.size());
-    batch.Put(handles_[0], destination, meta_value);
-  } else {
-    char buf[4];
-    EncodeFixed32(buf, member_score_map.size());
-    ZSetsMetaValue zsets_meta_value(Slice(buf, sizeof(int32_t)));
-    version = zsets_meta_value.UpdateVersion();
-    batch.Put(handles_[0], destination, zsets_meta_value.Encode());
-  }
-
-  char score_buf[8];
-  for (const auto& sm : member_score_map) {
-    ZSetsMemberKey zsets_member_key(destination, version, sm.first);
-
-    const void* ptr_score = reinterpret_cast<const void*>(&sm.second);
-    EncodeFixed64(score_buf, *reinterpret_cast<const uint64_t*>(ptr_score));
-    batch.Put(handles_[1], zsets_member_key.Encode(), Slice(score_buf, sizeof(uint64_t)));
-
-    ZSetsScoreKey zsets_score_key(destination, version, sm.second, sm.first);
-    batch.Put(handles_[2], zsets_score_key.Encode(), Slice());
+ private:
+  std::string prefix_;
+  int32_t size_ = 0;
+  size_t index_ = 0;
+  double weight_ = 1;
+  std::unique_ptr<rocksdb::Iterator> iter_;
+};
+
+// the members of the destination written in one batch by ZUNIONSTORE and ZINTERSTORE
+static const int32_t kZSetsStoreBatchCount = 1024;
+
+static double AggregateScore(AGGREGATE agg, double score, double other) {
+  switch (agg) {
+    case SUM:
+      return score + other;
+    case MIN:
+      return std::min(score, other);
+    case MAX:
+      return std::max(score, other);
   }
-  *ret = member_score_map.size();
-  s = db_->Write(default_write_options_, &batch);
-  UpdateSpecificKeyStatistics(destination.ToString(), statistic);
-  return s;
+  return score;
 }
 
-Status RedisZSets::ZInterstore(const Slice& destination, const std::vector<std::string>& keys,
-                               const std::vector<double>& weights, const AGGREGATE agg, int32_t* ret) {
-  if (keys.empty()) {
-    return Status::Corruption("ZInterstore invalid parameter, no keys");
-  }
-
+Status RedisZSets::MergeZSetsStore(const Slice& destination, const std::vector<std::string>& keys,
+                                   const std::vector<double>& weights, AGGREGATE agg, bool intersect, int32_t* ret) {
   *ret = 0;
   uint32_t statistic = 0;
-  rocksdb::WriteBatch batch;
   rocksdb::ReadOptions read_options;
   const rocksdb::Snapshot* snapshot = nullptr;
+  ScopeRecordLock l(lock_mgr_, destination);
   ScopeSnapshot ss(db_, &snapshot);
   read_options.snapshot = snapshot;
-  ScopeRecordLock l(lock_mgr_, destination);
 
   std::string meta_value;
-  int32_t version = 0;
   bool have_invalid_zsets = false;
-  ScoreMember item;
-  std::vector<KeyVersion> vaild_zsets;
-  std::vector<ScoreMember> score_members;
-  std::vector<ScoreMember> final_score_members;
+  std::vector<std::unique_ptr<ZSetsMemberCursor>> cursors;
   Status s;
-
-  int32_t cur_index = 0;
-  int32_t stop_index = 0;
-  for (size_t idx = 0; idx < keys.size(); ++idx) {
+  for (size_t idx = 0; idx < keys.size() && !(intersect && have_invalid_zsets); ++idx) {
     s = db_->Get(read_options, handles_[0], keys[idx], &meta_value);
     if (s.ok()) {
       ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
       if (parsed_zsets_meta_value.IsStale() || parsed_zsets_meta_value.count() == 0) {
         have_invalid_zsets = true;
       } else {
-        vaild_zsets.push_back({keys[idx], parsed_zsets_meta_value.version()});
-        if (idx == 0) {
-          stop_index = parsed_zsets_meta_value.count() - 1;
-        }
+        double weight = idx < weights.size() ? weights[idx] : 1;
+        cursors.push_back(std::make_unique<ZSetsMemberCursor>(
+            db_, read_options, handles_[1], KeyVersion{keys[idx], parsed_zsets_meta_value.version()},
+            parsed_zsets_meta_value.count(), idx, weight));
       }
     } else if (s.IsNotFound()) {
       have_invalid_zsets = true;
@@ -1164,87 +1189,153 @@ Status RedisZSets::ZInterstore(const Slice& destination, const std::vector<std::
       return s;
     }
   }
-
-  if (!have_invalid_zsets) {
-    ZSetsScoreKey zsets_score_key(vaild_zsets[0].key, vaild_zsets[0].version, std::numeric_limits<double>::lowest(),
-                                  Slice());
-    rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[2]);
-    for (iter->Seek(zsets_score_key.Encode()); iter->Valid() && cur_index <= stop_index; iter->Next(), ++cur_index) {
-      ParsedZSetsScoreKey parsed_zsets_score_key(iter->key());
-      double score = parsed_zsets_score_key.score();
-      std::string member = parsed_zsets_score_key.member().ToString();
-      score_members.push_back({score, member});
-    }
-    delete iter;
-
-    std::string data_value;
-    for (const auto& sm : score_members) {
-      bool reliable = true;
-      item.member = sm.member;
-      item.score = sm.score * (!weights.empty() ? weights[0] : 1);
-      for (size_t idx = 1; idx < vaild_zsets.size(); ++idx) {
-        double weight = idx < weights.size() ? weights[idx] : 1;
-        ZSetsMemberKey zsets_member_key(vaild_zsets[idx].key, vaild_zsets[idx].version, item.member);
-        s = db_->Get(read_options, handles_[1], zsets_member_key.Encode(), &data_value);
-        if (s.ok()) {
-          uint64_t tmp = DecodeFixed64(data_value.data());
-          const void* ptr_tmp = reinterpret_cast<const void*>(&tmp);
-          double score = *reinterpret_cast<const double*>(ptr_tmp);
-          switch (agg) {
-            case SUM:
-              item.score += weight * score;
-              break;
-            case MIN:
-              item.score = std::min(item.score, weight * score);
-              break;
-            case MAX:
-              item.score = std::max(item.score, weight * score);
-              break;
-          }
-        } else if (s.IsNotFound()) {
-          reliable = false;
-          break;
-        } else {
-          return s;
-        }
-      }
-      if (reliable) {
-        final_score_members.push_back(item);
-      }
-    }
+  if (intersect && have_invalid_zsets) {
+    cursors.clear();
   }
 
+  // The members are written under a new version of the destination, in
+  // batches of bounded size, and the meta value that makes them visible
+  // goes last
+  int32_t version = 0;
   s = db_->Get(read_options, handles_[0], destination, &meta_value);
   if (s.ok()) {
     ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
     statistic = parsed_zsets_meta_value.count();
     version = parsed_zsets_meta_value.InitialMetaValue();
-    parsed_zsets_meta_value.set_count(final_score_members.size());
-    batch.Put(handles_[0], destination, meta_value);
-  } else {
+  } else if (s.IsNotFound()) {
     char buf[4];
-    EncodeFixed32(buf, final_score_members.size());
+    EncodeFixed32(buf, 0);
     ZSetsMetaValue zsets_meta_value(Slice(buf, sizeof(int32_t)));
     version = zsets_meta_value.UpdateVersion();
-    batch.Put(handles_[0], destination, zsets_meta_value.Encode());
+    meta_value = zsets_meta_value.Encode().ToString();
+  } else {
+    return s;
   }
-  char score_buf[8];
-  for (const auto& sm : final_score_members) {
-    ZSetsMemberKey zsets_member_key(destination, version, sm.member);
 
-    const void* ptr_score = reinterpret_cast<const void*>(&sm.score);
+  int32_t count = 0;
+  char score_buf[8];
+  rocksdb::WriteBatch batch;
+  auto put = [&](const Slice& member, double score) {
+    score = (score == -0.0) ? 0 : score;
+    ZSetsMemberKey zsets_member_key(destination, version, member);
+    const void* ptr_score = reinterpret_cast<const void*>(&score);
     EncodeFixed64(score_buf, *reinterpret_cast<const uint64_t*>(ptr_score));
     batch.Put(handles_[1], zsets_member_key.Encode(), Slice(score_buf, sizeof(uint64_t)));
-
-    ZSetsScoreKey zsets_score_key(destination, version, sm.score, sm.member);
+    ZSetsScoreKey zsets_score_key(destination, version, score, member);
     batch.Put(handles_[2], zsets_score_key.Encode(), Slice());
+    if (++count % kZSetsStoreBatchCount != 0) {
+      return Status::OK();
+    }
+    Status ws = db_->Write(default_write_options_, &batch);
+    batch.Clear();
+    return ws;
+  };
+
+  if (!intersect) {
+    // k-way merge, of the cursors at the same member the one of the first
+    // key on the top, so the scores are aggregated in the order of the keys
+    auto greater = [](const ZSetsMemberCursor* a, const ZSetsMemberCursor* b) {
+      int cmp = a->member().compare(b->member());
+      return cmp != 0 ? cmp > 0 : a->index() > b->index();
+    };
+    std::vector<ZSetsMemberCursor*> heap;
+    for (const auto& cursor : cursors) {
+      if (cursor->Valid()) {
+        heap.push_back(cursor.get());
+      }
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+    std::string member;
+    auto pop = [&]() {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      ZSetsMemberCursor* cursor = heap.back();
+      double score = cursor->score();
+      cursor->Next();
+      if (cursor->Valid()) {
+        std::push_heap(heap.begin(), heap.end(), greater);
+      } else {
+        heap.pop_back();
+      }
+      return score;
+    };
+    while (!heap.empty() && s.ok()) {
+      member = heap.front()->member().ToString();
+      double score = pop();
+      while (!heap.empty() && heap.front()->member().compare(member) == 0) {
+        score = AggregateScore(agg, score, pop());
+      }
+      s = put(member, score);
+    }
+  } else if (!cursors.empty()) {
+    // driven by the smallest zset, leapfrogging the others
+    std::vector<ZSetsMemberCursor*> order;
+    for (const auto& cursor : cursors) {
+      order.push_back(cursor.get());
+    }
+    std::sort(order.begin(), order.end(),
+              [](const ZSetsMemberCursor* a, const ZSetsMemberCursor* b) { return a->size() < b->size(); });
+    ZSetsMemberCursor* driver = order[0];
+    while (driver->Valid() && s.ok()) {
+      Slice member = driver->member();
+      ZSetsMemberCursor* ahead = nullptr;
+      for (size_t idx = 1; idx < order.size(); ++idx) {
+        order[idx]->SkipTo(member);
+        if (!order[idx]->Valid() || order[idx]->member().compare(member) != 0) {
+          ahead = order[idx];
+          break;
+        }
+      }
+      if (ahead == nullptr) {
+        // every cursor is at the member, aggregate in the order of the keys
+        double score = cursors[0]->score();
+        for (size_t idx = 1; idx < cursors.size(); ++idx) {
+          score = AggregateScore(agg, score, cursors[idx]->score());
+        }
+        s = put(member, score);
+        driver->Next();
+      } else if (ahead->Valid()) {
+        driver->SkipTo(ahead->member());
+      } else {
+        break;
+      }
+    }
   }
-  *ret = final_score_members.size();
+  for (const auto& cursor : cursors) {
+    if (s.ok() && !cursor->status().ok()) {
+      s = cursor->status();
+    }
+  }
+  if (!s.ok()) {
+    // drop the members written of a version that will not be used
+    rocksdb::WriteBatch drop_batch;
+    DeleteDataRange(&drop_batch, handles_[1], destination, version, DataKeyOrder::kBytewise);
+    DeleteDataRange(&drop_batch, handles_[2], destination, version, DataKeyOrder::kZSetsScore);
+    db_->Write(default_write_options_, &drop_batch);
+    return s;
+  }
+
+  ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
+  parsed_zsets_meta_value.set_count(count);
+  batch.Put(handles_[0], destination, meta_value);
+  *ret = count;
   s = db_->Write(default_write_options_, &batch);
   UpdateSpecificKeyStatistics(destination.ToString(), statistic);
   return s;
 }
 
+Status RedisZSets::ZUnionstore(const Slice& destination, const std::vector<std::string>& keys,
+                               const std::vector<double>& weights, const AGGREGATE agg, int32_t* ret) {
+  return MergeZSetsStore(destination, keys, weights, agg, false, ret);
+}
+
+Status RedisZSets::ZInterstore(const Slice& destination, const std::vector<std::string>& keys,
+                               const std::vector<double>& weights, const AGGREGATE agg, int32_t* ret) {
+  if (keys.empty()) {
+    return Status::Corruption("ZInterstore invalid parameter, no keys");
+  }
+  return MergeZSetsStore(destination, keys, weights, agg, true, ret);
+}
+
 Status RedisZSets::ZRangebylex(const Slice& key, const Slice& min, const Slice& max, bool left_close, bool right_close,
                                std::vector<std::string>* members) {
   members->clear();
@@ -1387,7 +1478,7 @@ Status RedisZSets::Expire(const Slice& key, int32_t ttl) {
     } else {
       parsed_zsets_meta_value.InitialMetaValue();
     }
-    s = db_->Put(default_write_options_, handles_[0], key, meta_value);
+    s = PutWithExpireIndex(handles_[0], key, meta_value, parsed_zsets_meta_value.timestamp());
   }
   return s;
 }
@@ -1502,7 +1593,7 @@ Status RedisZSets::Expireat(const Slice& key, int32_t timestamp) {
       } else {
         parsed_zsets_meta_value.InitialMetaValue();
       }
-      return db_->Put(default_write_options_, handles_[0], key, meta_value);
+      return PutWithExpireIndex(handles_[0], key, meta_value, parsed_zsets_meta_value.timestamp());
     }
   }
   return s;
@@ -1536,8 +1627,15 @@ Status RedisZSets::ZScan(const Slice& key, int64_t cursor, const std::string& pa
       std::string start_point;
       int32_t version = parsed_zsets_meta_value.version();
       s = GetScanStartPoint(key, pattern, cursor, &start_point);
+      // an evicted cursor is the number of members visited before it, they
+      // are skipped again rather than restarting the scan, up to a bound
+      int64_t skip = 0;
       if (s.IsNotFound()) {
-        cursor = 0;
+        if (cursor <= ScanCursorStore::kMaxResumeWalk) {
+          skip = cursor;
+        } else {
+          cursor = 0;
+        }
         if (isTailWildcard(pattern)) {
           start_point = pattern.substr(0, pattern.size() - 1);
         }
@@ -1550,8 +1648,11 @@ Status RedisZSets::ZScan(const Slice& key, int64_t cursor, const std::string& pa
       ZSetsMemberKey zsets_member_key(key, version, start_point);
       std::string prefix = zsets_member_prefix.Encode().ToString();
       rocksdb::Iterator* iter = db_->NewIterator(read_options, handles_[1]);
-      for (iter->Seek(zsets_member_key.Encode()); iter->Valid() && rest > 0 && iter->key().starts_with(prefix);
-           iter->Next()) {
+      iter->Seek(zsets_member_key.Encode());
+      for (; skip > 0 && iter->Valid() && iter->key().starts_with(prefix); skip--) {
+        iter->Next();
+      }
+      for (; iter->Valid() && rest > 0 && iter->key().starts_with(prefix); iter->Next()) {
         ParsedZSetsMemberKey parsed_zsets_member_key(iter->key());
         std::string member = parsed_zsets_member_key.member().ToString();
         if (StringMatch(pattern.data(), pattern.size(), member.data(), member.size(), 0) != 0) {
@@ -1736,6 +1837,32 @@ Status RedisZSets::TTL(const Slice& key, int64_t* timestamp) {
   return s;
 }
 
+Status RedisZSets::ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) {
+  std::string meta_value;
+  Status s = db_->Get(default_read_options_, handles_[0], key, &meta_value);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return s;
+  }
+  ParsedZSetsMetaValue parsed_zsets_meta_value(&meta_value);
+  // the ttl was changed or the key was recreated since it was indexed
+  if (parsed_zsets_meta_value.timestamp() != timestamp || !parsed_zsets_meta_value.IsStale()) {
+    return Status::OK();
+  }
+  int32_t version = parsed_zsets_meta_value.version();
+  int32_t count = parsed_zsets_meta_value.count();
+  parsed_zsets_meta_value.InitialMetaValue();
+  batch->Put(handles_[0], key, meta_value);
+  // the data of small collections are dropped by the data filter, do not
+  // wait for the compaction for big ones
+  if (count >= static_cast<int32_t>(small_compaction_threshold_)) {
+    DeleteDataRange(batch, handles_[1], key, version, DataKeyOrder::kBytewise);
+    DeleteDataRange(batch, handles_[2], key, version, DataKeyOrder::kZSetsScore);
+  }
+  return Status::OK();
+}
+
 void RedisZSets::ScanDatabase() {
   rocksdb::ReadOptions iterator_options;
   const rocksdb::Snapshot* snapshot;
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "src/custom_comparator.h"
@@ -37,6 +38,8 @@ class RedisZSets : public Redis {
   Status ZRange(const Slice& key, int32_t start, int32_t stop, std::vector<ScoreMember>* score_members);
   Status ZRangebyscore(const Slice& key, double min, double max, bool left_close, bool right_close, int64_t count,
                        int64_t offset, std::vector<ScoreMember>* score_members);
+  Status ZScanScoreRanges(const Slice& key, std::vector<std::pair<double, double>> ranges,
+                          const ScoreMemberVisitor& visitor);
   Status ZRank(const Slice& key, const Slice& member, int32_t* rank);
   Status ZRem(const Slice& key, const std::vector<std::string>& members, int32_t* ret);
   Status ZRemrangebyrank(const Slice& key, int32_t start, int32_t stop, int32_t* ret);
@@ -78,6 +81,15 @@ class RedisZSets : public Redis {
 
   // Iterate all data
   void ScanDatabase();
+
+ protected:
+  Status ReapExpiredKey(const Slice& key, int32_t timestamp, rocksdb::WriteBatch* batch) override;
+
+ private:
+  // Merge the zsets of keys, read in the order of their members, into
+  // destination, the union or the intersection
+  Status MergeZSetsStore(const Slice& destination, const std::vector<std::string>& keys,
+                         const std::vector<double>& weights, AGGREGATE agg, bool intersect, int32_t* ret);
 };
 
 }  // namespace storage
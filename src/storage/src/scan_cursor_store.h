@@ -0,0 +1,60 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_SCAN_CURSOR_STORE_H_
+#define SRC_SCAN_CURSOR_STORE_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "rocksdb/status.h"
+
+#include "src/lru_cache.h"
+
+namespace storage {
+
+/*
+ * ScanCursorStore keeps the point every scan cursor resumes at, under a key
+ * made of the scope of the scan (type, key, pattern) and the cursor. The
+ * keys are spread by their hash over LRU shards with a mutex each, so the
+ * concurrent scans seldom wait on each other or evict each other's cursors.
+ *
+ * A cursor is the number of entries the scan visited before it, so the scan
+ * of a cursor evicted walks that many entries again rather than restarting.
+ * Past kMaxResumeWalk entries the walk costs more than it saves, and the scan
+ * restarts from the beginning instead.
+ */
+class ScanCursorStore {
+ public:
+  static const size_t kShards = 16;
+  static const int64_t kMaxResumeWalk = 100 * 1000;
+
+  explicit ScanCursorStore(size_t capacity) {
+    for (auto& shard : shards_) {
+      shard = std::make_unique<LRUCache<std::string, std::string>>();
+      shard->SetCapacity((capacity + kShards - 1) / kShards);
+    }
+  }
+
+  rocksdb::Status Lookup(const std::string& cursor_key, std::string* point) {
+    return Shard(cursor_key)->Lookup(cursor_key, point);
+  }
+
+  rocksdb::Status Insert(const std::string& cursor_key, const std::string& point) {
+    return Shard(cursor_key)->Insert(cursor_key, point);
+  }
+
+ private:
+  LRUCache<std::string, std::string>* Shard(const std::string& cursor_key) {
+    return shards_[std::hash<std::string>()(cursor_key) % kShards].get();
+  }
+
+  std::unique_ptr<LRUCache<std::string, std::string>> shards_[kShards];
+};
+
+}  //  namespace storage
+#endif  //  SRC_SCAN_CURSOR_STORE_H_
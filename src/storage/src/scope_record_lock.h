@@ -19,6 +19,7 @@ namespace storage {
 
 using ScopeRecordLock = pstd::lock::ScopeRecordLock;
 using MultiScopeRecordLock = pstd::lock::MultiScopeRecordLock;
+using TryScopeRecordLock = pstd::lock::TryScopeRecordLock;
 
 }  // namespace storage
 #endif  // SRC_SCOPE_RECORD_LOCK_H_
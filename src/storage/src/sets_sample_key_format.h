@@ -0,0 +1,91 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_SETS_SAMPLE_KEY_FORMAT_H_
+#define SRC_SETS_SAMPLE_KEY_FORMAT_H_
+
+#include <string>
+
+#include "pstd/include/pstd_coding.h"
+#include "src/base_data_key_format.h"
+
+namespace storage {
+
+/*
+ * The sampling index of the sets, in the sample_cf of the sets db, has every
+ * member of a set under
+ *
+ *   | key_size | key | version | hash(member) | member |
+ *
+ * with the 8 bytes hash in big endian, so the members of a set are spread
+ * uniformly, in the order of their hash, over the 64 bit hash space, and
+ *
+ *   | key_size | key | version |
+ *
+ * once it has all the members of that version of the set. The layout is the
+ * one of the member keys, the stale versions are dropped by their filter.
+ */
+inline uint64_t SetsSampleHash(const Slice& member) {
+  // FNV-1a, then the finalizer of MurmurHash3 to spread the close members
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < member.size(); i++) {
+    h ^= static_cast<uint8_t>(member[i]);
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+inline void AppendSampleHash(std::string* dst, uint64_t hash) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    dst->push_back(static_cast<char>((hash >> shift) & 0xff));
+  }
+}
+
+// The key of the member in the sampling index
+inline std::string EncodeSetsSampleKey(const Slice& key, int32_t version, const Slice& member) {
+  std::string data;
+  data.reserve(sizeof(uint64_t) + member.size());
+  AppendSampleHash(&data, SetsSampleHash(member));
+  data.append(member.data(), member.size());
+  SetsMemberKey sample_key(key, version, data);
+  return sample_key.Encode().ToString();
+}
+
+// The key the members whose hash is at least hash start from
+inline std::string EncodeSetsSampleSeekKey(const Slice& key, int32_t version, uint64_t hash) {
+  std::string data;
+  AppendSampleHash(&data, hash);
+  SetsMemberKey sample_key(key, version, data);
+  return sample_key.Encode().ToString();
+}
+
+// The mark of a complete index, also the prefix of all its members
+inline std::string EncodeSetsSampleMark(const Slice& key, int32_t version) {
+  SetsMemberKey sample_key(key, version, Slice());
+  return sample_key.Encode().ToString();
+}
+
+class ParsedSetsSampleKey : public ParsedBaseDataKey {
+ public:
+  explicit ParsedSetsSampleKey(const Slice& key) : ParsedBaseDataKey(key) {}
+  // false for the mark
+  bool IsMember() const { return data_.size() >= sizeof(uint64_t); }
+  uint64_t hash() const {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); i++) {
+      hash = (hash << 8) | static_cast<uint8_t>(data_[i]);
+    }
+    return hash;
+  }
+  Slice member() const { return Slice(data_.data() + sizeof(uint64_t), data_.size() - sizeof(uint64_t)); }
+};
+
+}  //  namespace storage
+#endif  // SRC_SETS_SAMPLE_KEY_FORMAT_H_
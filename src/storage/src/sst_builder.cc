@@ -0,0 +1,484 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "storage/sst_builder.h"
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "rocksdb/env.h"
+#include "rocksdb/sst_file_reader.h"
+#include "rocksdb/sst_file_writer.h"
+#include "rocksdb/table.h"
+
+#include "src/coding.h"
+#include "src/redis.h"
+#include "src/base_data_key_format.h"
+#include "src/base_meta_value_format.h"
+#include "src/lists_data_key_format.h"
+#include "src/lists_meta_value_format.h"
+#include "src/sets_sample_key_format.h"
+#include "src/strings_value_format.h"
+#include "src/zsets_data_key_format.h"
+#include "storage/util.h"
+
+namespace storage {
+
+const rocksdb::Comparator* ListsDataKeyComparator();
+rocksdb::Comparator* ZSetsScoreKeyComparator();
+
+// The column families of the type dbs, in the order of SstBuilder::buffers_
+enum SstTargetIndex {
+  kSstStrings,
+  kSstStringsExpire,
+  kSstHashesMeta,
+  kSstHashesData,
+  kSstHashesExpire,
+  kSstListsMeta,
+  kSstListsData,
+  kSstListsExpire,
+  kSstSetsMeta,
+  kSstSetsMember,
+  kSstSetsSample,
+  kSstSetsExpire,
+  kSstZSetsMeta,
+  kSstZSetsData,
+  kSstZSetsScore,
+  kSstZSetsExpire,
+  kSstTargetNum
+};
+
+struct SstTarget {
+  std::string db;
+  std::string cf;
+  const rocksdb::Comparator* comparator;
+};
+
+static const std::vector<SstTarget>& SstTargets() {
+  static const std::vector<SstTarget> targets = {
+      {STRINGS_DB, rocksdb::kDefaultColumnFamilyName, rocksdb::BytewiseComparator()},
+      {STRINGS_DB, kExpireIndexCf, rocksdb::BytewiseComparator()},
+      {HASHES_DB, rocksdb::kDefaultColumnFamilyName, rocksdb::BytewiseComparator()},
+      {HASHES_DB, "data_cf", rocksdb::BytewiseComparator()},
+      {HASHES_DB, kExpireIndexCf, rocksdb::BytewiseComparator()},
+      {LISTS_DB, rocksdb::kDefaultColumnFamilyName, rocksdb::BytewiseComparator()},
+      {LISTS_DB, "data_cf", ListsDataKeyComparator()},
+      {LISTS_DB, kExpireIndexCf, rocksdb::BytewiseComparator()},
+      {SETS_DB, rocksdb::kDefaultColumnFamilyName, rocksdb::BytewiseComparator()},
+      {SETS_DB, "member_cf", rocksdb::BytewiseComparator()},
+      {SETS_DB, "sample_cf", rocksdb::BytewiseComparator()},
+      {SETS_DB, kExpireIndexCf, rocksdb::BytewiseComparator()},
+      {ZSETS_DB, rocksdb::kDefaultColumnFamilyName, rocksdb::BytewiseComparator()},
+      {ZSETS_DB, "data_cf", rocksdb::BytewiseComparator()},
+      {ZSETS_DB, "score_cf", ZSetsScoreKeyComparator()},
+      {ZSETS_DB, kExpireIndexCf, rocksdb::BytewiseComparator()}};
+  return targets;
+}
+
+static std::string AppendPath(const std::string& path, const std::string& name) {
+  return path.back() == '/' ? path + name : path + "/" + name;
+}
+
+static std::string SstFileName(uint64_t number) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%06lu.sst", static_cast<unsigned long>(number));
+  return buf;
+}
+
+SstBuilder::SstBuilder(const StorageOptions& storage_options, std::string path, size_t buffer_size)
+    : options_(storage_options.options),
+      table_options_(storage_options.table_options),
+      path_(std::move(path)),
+      buffer_size_(buffer_size),
+      buffers_(kSstTargetNum) {
+  int64_t unix_time;
+  rocksdb::Env::Default()->GetCurrentTime(&unix_time);
+  version_ = static_cast<int32_t>(unix_time);
+}
+
+SstBuilder::~SstBuilder() {
+  // the runs of an unfinished build are of no use
+  for (const auto& buffer : buffers_) {
+    for (const auto& run : buffer.runs) {
+      rocksdb::Env::Default()->DeleteFile(run);
+    }
+  }
+}
+
+rocksdb::Options SstBuilder::TargetOptions(size_t target) const {
+  rocksdb::Options options(options_);
+  options.comparator = SstTargets()[target].comparator;
+  options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options_));
+  return options;
+}
+
+Status SstBuilder::Add(size_t target, std::string key, std::string value) {
+  buffered_ += key.size() + value.size() + sizeof(std::pair<std::string, std::string>);
+  buffers_[target].entries.emplace_back(std::move(key), std::move(value));
+  if (buffered_ >= buffer_size_) {
+    return FlushRuns();
+  }
+  return Status::OK();
+}
+
+Status SstBuilder::AddExpireIndex(size_t target, const Slice& key, int32_t timestamp) {
+  if (timestamp <= 0) {
+    return Status::OK();
+  }
+  return Add(target, EncodeExpireIndexKey(key, timestamp), std::string());
+}
+
+Status SstBuilder::Set(const Slice& key, const Slice& value, int32_t ttl) {
+  if (finished_) {
+    return Status::NotSupported("the build is finished");
+  }
+  StringsValue strings_value(value);
+  if (ttl > 0) {
+    Status s = strings_value.SetRelativeTimestamp(ttl);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  keys_++;
+  Status s = AddExpireIndex(kSstStringsExpire, key, strings_value.timestamp());
+  if (!s.ok()) {
+    return s;
+  }
+  return Add(kSstStrings, key.ToString(), strings_value.Encode().ToString());
+}
+
+Status SstBuilder::HMSet(const Slice& key, const std::vector<FieldValue>& fvs, int32_t ttl) {
+  if (finished_) {
+    return Status::NotSupported("the build is finished");
+  }
+  // of the same fields the last one is kept
+  std::unordered_map<std::string_view, size_t> fields;
+  for (size_t i = 0; i < fvs.size(); i++) {
+    fields[fvs[i].field] = i;
+  }
+  if (fields.empty()) {
+    return Status::OK();
+  }
+
+  char str[4];
+  EncodeFixed32(str, static_cast<int32_t>(fields.size()));
+  HashesMetaValue hashes_meta_value(Slice(str, sizeof(int32_t)));
+  hashes_meta_value.set_version(version_);
+  if (ttl > 0) {
+    Status s = hashes_meta_value.SetRelativeTimestamp(ttl);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  keys_++;
+  Status s = AddExpireIndex(kSstHashesExpire, key, hashes_meta_value.timestamp());
+  if (s.ok()) {
+    s = Add(kSstHashesMeta, key.ToString(), hashes_meta_value.Encode().ToString());
+  }
+  for (auto iter = fields.begin(); s.ok() && iter != fields.end(); ++iter) {
+    const FieldValue& fv = fvs[iter->second];
+    HashesDataKey hashes_data_key(key, version_, fv.field);
+    s = Add(kSstHashesData, hashes_data_key.Encode().ToString(), fv.value);
+  }
+  return s;
+}
+
+Status SstBuilder::RPush(const Slice& key, const std::vector<std::string>& values, int32_t ttl) {
+  if (finished_) {
+    return Status::NotSupported("the build is finished");
+  }
+  if (values.empty()) {
+    return Status::OK();
+  }
+
+  char str[8];
+  EncodeFixed64(str, values.size());
+  ListsMetaValue lists_meta_value(Slice(str, sizeof(uint64_t)));
+  lists_meta_value.set_version(version_);
+  if (ttl > 0) {
+    Status s = lists_meta_value.SetRelativeTimestamp(ttl);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  keys_++;
+  Status s;
+  for (size_t i = 0; s.ok() && i < values.size(); i++) {
+    uint64_t index = lists_meta_value.right_index();
+    lists_meta_value.ModifyRightIndex(1);
+    ListsDataKey lists_data_key(key, version_, index);
+    s = Add(kSstListsData, lists_data_key.Encode().ToString(), values[i]);
+  }
+  if (s.ok()) {
+    s = AddExpireIndex(kSstListsExpire, key, lists_meta_value.timestamp());
+  }
+  if (s.ok()) {
+    s = Add(kSstListsMeta, key.ToString(), lists_meta_value.Encode().ToString());
+  }
+  return s;
+}
+
+Status SstBuilder::SAdd(const Slice& key, const std::vector<std::string>& members, int32_t ttl) {
+  if (finished_) {
+    return Status::NotSupported("the build is finished");
+  }
+  std::unordered_set<std::string_view> unique(members.begin(), members.end());
+  if (unique.empty()) {
+    return Status::OK();
+  }
+
+  char str[4];
+  EncodeFixed32(str, static_cast<int32_t>(unique.size()));
+  SetsMetaValue sets_meta_value(Slice(str, sizeof(int32_t)));
+  sets_meta_value.set_version(version_);
+  if (ttl > 0) {
+    Status s = sets_meta_value.SetRelativeTimestamp(ttl);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  keys_++;
+  Status s = AddExpireIndex(kSstSetsExpire, key, sets_meta_value.timestamp());
+  if (s.ok()) {
+    s = Add(kSstSetsMeta, key.ToString(), sets_meta_value.Encode().ToString());
+  }
+  if (s.ok()) {
+    s = Add(kSstSetsSample, EncodeSetsSampleMark(key, version_), std::string());
+  }
+  for (auto iter = unique.begin(); s.ok() && iter != unique.end(); ++iter) {
+    Slice member(iter->data(), iter->size());
+    SetsMemberKey sets_member_key(key, version_, member);
+    s = Add(kSstSetsMember, sets_member_key.Encode().ToString(), std::string());
+    if (s.ok()) {
+      s = Add(kSstSetsSample, EncodeSetsSampleKey(key, version_, member), std::string());
+    }
+  }
+  return s;
+}
+
+Status SstBuilder::ZAdd(const Slice& key, const std::vector<ScoreMember>& score_members, int32_t ttl) {
+  if (finished_) {
+    return Status::NotSupported("the build is finished");
+  }
+  // of the same members the last score is kept
+  std::unordered_map<std::string_view, size_t> members;
+  for (size_t i = 0; i < score_members.size(); i++) {
+    members[score_members[i].member] = i;
+  }
+  if (members.empty()) {
+    return Status::OK();
+  }
+
+  char str[4];
+  EncodeFixed32(str, static_cast<int32_t>(members.size()));
+  ZSetsMetaValue zsets_meta_value(Slice(str, sizeof(int32_t)));
+  zsets_meta_value.set_version(version_);
+  if (ttl > 0) {
+    Status s = zsets_meta_value.SetRelativeTimestamp(ttl);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  keys_++;
+  Status s = AddExpireIndex(kSstZSetsExpire, key, zsets_meta_value.timestamp());
+  if (s.ok()) {
+    s = Add(kSstZSetsMeta, key.ToString(), zsets_meta_value.Encode().ToString());
+  }
+  for (auto iter = members.begin(); s.ok() && iter != members.end(); ++iter) {
+    const ScoreMember& sm = score_members[iter->second];
+    ZSetsMemberKey zsets_member_key(key, version_, sm.member);
+    char score_buf[8];
+    const void* ptr_score = reinterpret_cast<const void*>(&sm.score);
+    EncodeFixed64(score_buf, *reinterpret_cast<const uint64_t*>(ptr_score));
+    s = Add(kSstZSetsData, zsets_member_key.Encode().ToString(), std::string(score_buf, sizeof(uint64_t)));
+    if (s.ok()) {
+      ZSetsScoreKey zsets_score_key(key, version_, sm.score, sm.member);
+      s = Add(kSstZSetsScore, zsets_score_key.Encode().ToString(), std::string());
+    }
+  }
+  return s;
+}
+
+Status SstBuilder::FlushRuns() {
+  std::string runs_path = AppendPath(path_, "runs");
+  mkpath(runs_path.c_str(), 0755);
+
+  // the column families are sorted and written in parallel
+  std::vector<std::thread> threads;
+  std::vector<Status> statuses(kSstTargetNum);
+  for (size_t target = 0; target < kSstTargetNum; target++) {
+    Buffer* buffer = &buffers_[target];
+    if (buffer->entries.empty()) {
+      continue;
+    }
+    buffer->runs.push_back(AppendPath(runs_path, SstFileName(next_file_number_++)));
+    threads.emplace_back([this, target, buffer, &statuses] { statuses[target] = WriteRun(target, buffer); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  buffered_ = 0;
+  for (const auto& s : statuses) {
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+Status SstBuilder::WriteRun(size_t target, Buffer* buffer) {
+  const rocksdb::Comparator* comparator = SstTargets()[target].comparator;
+  auto& entries = buffer->entries;
+  std::stable_sort(entries.begin(), entries.end(), [comparator](const auto& a, const auto& b) {
+    return comparator->Compare(a.first, b.first) < 0;
+  });
+
+  rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), TargetOptions(target));
+  Status s = writer.Open(buffer->runs.back());
+  for (size_t i = 0; s.ok() && i < entries.size(); i++) {
+    // of the equal keys the one added last is kept
+    if (i + 1 < entries.size() && comparator->Compare(entries[i].first, entries[i + 1].first) == 0) {
+      continue;
+    }
+    s = writer.Put(entries[i].first, entries[i].second);
+  }
+  if (s.ok()) {
+    s = writer.Finish();
+  }
+  std::vector<std::pair<std::string, std::string>>().swap(entries);
+  return s;
+}
+
+Status SstBuilder::Finish() {
+  if (finished_) {
+    return Status::NotSupported("the build is finished");
+  }
+  finished_ = true;
+  Status s = FlushRuns();
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<Status> statuses(kSstTargetNum);
+  for (size_t target = 0; target < kSstTargetNum; target++) {
+    Buffer* buffer = &buffers_[target];
+    if (buffer->runs.empty()) {
+      continue;
+    }
+    threads.emplace_back([this, target, buffer, &statuses] { statuses[target] = MergeRuns(target, buffer); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  rocksdb::Env::Default()->DeleteDir(AppendPath(path_, "runs"));
+  for (const auto& status : statuses) {
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status SstBuilder::MergeRuns(size_t target, Buffer* buffer) {
+  const SstTarget& sst_target = SstTargets()[target];
+  std::string dir = AppendPath(AppendPath(path_, sst_target.db), sst_target.cf);
+  mkpath(dir.c_str(), 0755);
+  rocksdb::Env* env = rocksdb::Env::Default();
+  uint64_t file_number = 0;
+
+  // a single run is sorted already
+  if (buffer->runs.size() == 1) {
+    Status s = env->RenameFile(buffer->runs[0], AppendPath(dir, SstFileName(file_number)));
+    buffer->runs.clear();
+    return s;
+  }
+
+  struct Cursor {
+    std::unique_ptr<rocksdb::SstFileReader> reader;
+    std::unique_ptr<rocksdb::Iterator> iter;
+    size_t run;
+  };
+  rocksdb::Options options = TargetOptions(target);
+  std::vector<Cursor> cursors(buffer->runs.size());
+  rocksdb::ReadOptions read_options;
+  read_options.fill_cache = false;
+  for (size_t run = 0; run < buffer->runs.size(); run++) {
+    cursors[run].reader = std::make_unique<rocksdb::SstFileReader>(options);
+    Status s = cursors[run].reader->Open(buffer->runs[run]);
+    if (!s.ok()) {
+      return s;
+    }
+    cursors[run].iter.reset(cursors[run].reader->NewIterator(read_options));
+    cursors[run].iter->SeekToFirst();
+    cursors[run].run = run;
+  }
+
+  // the smallest key on top, of the equal keys the one of the latest run
+  const rocksdb::Comparator* comparator = sst_target.comparator;
+  auto greater = [comparator](const Cursor* a, const Cursor* b) {
+    int ret = comparator->Compare(a->iter->key(), b->iter->key());
+    return ret != 0 ? ret > 0 : a->run < b->run;
+  };
+  std::priority_queue<Cursor*, std::vector<Cursor*>, decltype(greater)> heap(greater);
+  for (auto& cursor : cursors) {
+    if (cursor.iter->Valid()) {
+      heap.push(&cursor);
+    } else if (!cursor.iter->status().ok()) {
+      return cursor.iter->status();
+    }
+  }
+
+  rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), options);
+  bool opened = false;
+  bool written = false;
+  std::string last_key;
+  Status s;
+  while (s.ok() && !heap.empty()) {
+    Cursor* cursor = heap.top();
+    heap.pop();
+    Slice key = cursor->iter->key();
+    // the duplicates of the key written last are skipped
+    if (!written || comparator->Compare(key, last_key) != 0) {
+      if (!opened) {
+        s = writer.Open(AppendPath(dir, SstFileName(file_number++)));
+        opened = s.ok();
+      }
+      if (s.ok()) {
+        s = writer.Put(key, cursor->iter->value());
+        last_key.assign(key.data(), key.size());
+        written = true;
+      }
+      if (s.ok() && writer.FileSize() >= options.target_file_size_base) {
+        s = writer.Finish();
+        opened = false;
+      }
+    }
+    cursor->iter->Next();
+    if (cursor->iter->Valid()) {
+      heap.push(cursor);
+    } else if (!cursor->iter->status().ok()) {
+      s = cursor->iter->status();
+    }
+  }
+  if (s.ok() && opened) {
+    s = writer.Finish();
+  }
+  cursors.clear();
+  if (s.ok()) {
+    for (const auto& run : buffer->runs) {
+      env->DeleteFile(run);
+    }
+    buffer->runs.clear();
+  }
+  return s;
+}
+
+}  //  namespace storage
@@ -0,0 +1,82 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "src/sst_size_tracker.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "rocksdb/metadata.h"
+
+namespace storage {
+
+// The number of an sst file from its path, .../000123.sst
+static bool ParseFileNumber(const std::string& file_path, uint64_t* number) {
+  size_t begin = file_path.find_last_of('/');
+  begin = begin == std::string::npos ? 0 : begin + 1;
+  char* end = nullptr;
+  *number = strtoull(file_path.c_str() + begin, &end, 10);
+  return end != file_path.c_str() + begin && *end == '.';
+}
+
+void SstSizeTracker::Seed(rocksdb::DB* db) {
+  std::vector<rocksdb::LiveFileMetaData> files;
+  db->GetLiveFilesMetaData(&files);
+  for (const auto& file : files) {
+    AddFile(file.name, file.column_family_name, file.size);
+  }
+}
+
+void SstSizeTracker::OnTableFileCreated(const rocksdb::TableFileCreationInfo& info) {
+  // a failed or empty output is not kept
+  if (!info.status.ok() || info.file_size == 0) {
+    return;
+  }
+  AddFile(info.file_path, info.cf_name, info.file_size);
+}
+
+void SstSizeTracker::OnTableFileDeleted(const rocksdb::TableFileDeletionInfo& info) {
+  uint64_t number = 0;
+  if (!info.status.ok() || !ParseFileNumber(info.file_path, &number)) {
+    return;
+  }
+  std::lock_guard l(mu_);
+  auto iter = files_.find(number);
+  if (iter == files_.end()) {
+    return;
+  }
+  cf_size_[iter->second.cf_name] -= iter->second.size;
+  total_ -= iter->second.size;
+  files_.erase(iter);
+}
+
+void SstSizeTracker::OnExternalFileIngested(rocksdb::DB* db, const rocksdb::ExternalFileIngestionInfo& info) {
+  uint64_t size = 0;
+  if (!db->GetEnv()->GetFileSize(info.internal_file_path, &size).ok()) {
+    return;
+  }
+  AddFile(info.internal_file_path, info.cf_name, size);
+}
+
+void SstSizeTracker::AddFile(const std::string& file_path, const std::string& cf_name, uint64_t size) {
+  uint64_t number = 0;
+  if (!ParseFileNumber(file_path, &number)) {
+    return;
+  }
+  std::lock_guard l(mu_);
+  // Seed may see a file the listener was told about while the db opened
+  if (!files_.emplace(number, SstFile{cf_name, size}).second) {
+    return;
+  }
+  cf_size_[cf_name] += size;
+  total_ += size;
+}
+
+void SstSizeTracker::GetColumnFamilySize(std::map<std::string, uint64_t>* sizes) {
+  std::lock_guard l(mu_);
+  *sizes = cf_size_;
+}
+
+}  //  namespace storage
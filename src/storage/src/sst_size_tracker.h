@@ -0,0 +1,54 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef SRC_SST_SIZE_TRACKER_H_
+#define SRC_SST_SIZE_TRACKER_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rocksdb/db.h"
+#include "rocksdb/listener.h"
+
+namespace storage {
+
+/*
+ * SstSizeTracker keeps the size of the sst files of a db on disk, live or
+ * not yet deleted, from the files created by the flushes and compactions, the
+ * files ingested and the files deleted, so the size is known without listing the db directory.
+ */
+class SstSizeTracker : public rocksdb::EventListener {
+ public:
+  // Add the files of db that exist when it is opened
+  void Seed(rocksdb::DB* db);
+
+  void OnTableFileCreated(const rocksdb::TableFileCreationInfo& info) override;
+  void OnTableFileDeleted(const rocksdb::TableFileDeletionInfo& info) override;
+  void OnExternalFileIngested(rocksdb::DB* db, const rocksdb::ExternalFileIngestionInfo& info) override;
+
+  uint64_t total() const { return total_.load(); }
+  // The size of the files of every column family, by name
+  void GetColumnFamilySize(std::map<std::string, uint64_t>* sizes);
+
+ private:
+  struct SstFile {
+    std::string cf_name;
+    uint64_t size = 0;
+  };
+
+  void AddFile(const std::string& file_path, const std::string& cf_name, uint64_t size);
+
+  std::mutex mu_;
+  // keyed by file number
+  std::unordered_map<uint64_t, SstFile> files_;
+  std::map<std::string, uint64_t> cf_size_;
+  std::atomic<uint64_t> total_ = 0;
+};
+
+}  //  namespace storage
+#endif  //  SRC_SST_SIZE_TRACKER_H_
@@ -8,6 +8,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <utility>
 
 #include "src/lru_cache.h"
@@ -19,9 +20,17 @@
 #include "src/redis_sets.h"
 #include "src/redis_strings.h"
 #include "src/redis_zsets.h"
+#include "src/scan_cursor_store.h"
 
 namespace storage {
 
+// the expire reaper runs a cycle every kExpireCycleMs
+static const int kExpireCycleMs = 100;
+// the cursors kept for the scans of the keys, in all
+static const size_t kScanCursorCapacity = 16 * 1024;
+// the keys visited at a time to walk again to an evicted cursor
+static const int64_t kScanResumeStep = 1000;
+
 Status StorageOptions::ResetOptions(const OptionType& option_type,
                                     const std::unordered_map<std::string, std::string>& options_map) {
   std::unordered_map<std::string, MemberTypeInfo>& options_member_type_info = mutable_cf_options_member_type_info;
@@ -48,9 +57,11 @@ Status StorageOptions::ResetOptions(const OptionType& option_type,
   return Status::OK();
 }
 
-Storage::Storage() {
-  cursors_store_ = std::make_unique<LRUCache<std::string, std::string>>();
-  cursors_store_->SetCapacity(5000);
+Storage::Storage() : Storage(nullptr) {}
+
+Storage::Storage(std::shared_ptr<pstd::lock::LockMgr> lock_mgr)
+    : lock_mgr_(lock_mgr ? std::move(lock_mgr) : std::make_shared<pstd::lock::LockMgr>()) {
+  cursors_store_ = std::make_unique<ScanCursorStore>(kScanCursorCapacity);
 
   Status s = StartBGThread();
   if (!s.ok()) {
@@ -62,6 +73,14 @@ Storage::~Storage() {
   bg_tasks_should_exit_ = true;
   bg_tasks_cond_var_.notify_one();
 
+  if (expire_reaper_.joinable()) {
+    {
+      std::lock_guard l(expire_reaper_mutex_);
+      expire_reaper_cv_.notify_one();
+    }
+    expire_reaper_.join();
+  }
+
   if (is_opened_) {
     rocksdb::CancelAllBackgroundWork(strings_db_->GetDB(), true);
     rocksdb::CancelAllBackgroundWork(hashes_db_->GetDB(), true);
@@ -76,6 +95,17 @@ Storage::~Storage() {
   }
 }
 
+void Storage::NotifyListPush(const Slice& key) const {
+  if (!list_push_listener_) {
+    return;
+  }
+  // the pushed elements are not visible to the other threads before that
+  if (BatchWriteScope::RunAtCommit([listener = list_push_listener_, key = key.ToString()] { listener(key); })) {
+    return;
+  }
+  list_push_listener_(key);
+}
+
 static std::string AppendSubDirectory(const std::string& db_path, const std::string& sub_db) {
   if (db_path.back() == '/') {
     return db_path + sub_db;
@@ -117,16 +147,21 @@ Status Storage::Open(const StorageOptions& storage_options, const std::string& d
     LOG(FATAL) << "open zset db failed, " << s.ToString();
   }
   is_opened_.store(true);
+
+  active_expire_cpu_percent_ = storage_options.active_expire_cpu_percent;
+  expire_reaper_ = std::thread(&Storage::RunExpireReaper, this);
   return Status::OK();
 }
 
-Status Storage::GetStartKey(const DataType& dtype, int64_t cursor, std::string* start_key) {
-  std::string index_key = DataTypeTag[dtype] + std::to_string(cursor);
+Status Storage::GetStartKey(const DataType& dtype, int64_t cursor, const std::string& scope,
+                            std::string* start_key) {
+  std::string index_key = DataTypeTag[dtype] + scope + "_" + std::to_string(cursor);
   return cursors_store_->Lookup(index_key, start_key);
 }
 
-Status Storage::StoreCursorStartKey(const DataType& dtype, int64_t cursor, const std::string& next_key) {
-  std::string index_key = DataTypeTag[dtype] + std::to_string(cursor);
+Status Storage::StoreCursorStartKey(const DataType& dtype, int64_t cursor, const std::string& scope,
+                                    const std::string& next_key) {
+  std::string index_key = DataTypeTag[dtype] + scope + "_" + std::to_string(cursor);
   return cursors_store_->Insert(index_key, next_key);
 }
 
@@ -283,6 +318,24 @@ Status Storage::PKHRScanRange(const Slice& key, const Slice& field_start, const
   return hashes_db_->PKHRScanRange(key, field_start, field_end, pattern, limit, field_values, next_field);
 }
 
+Status Storage::HExpire(const Slice& key, int32_t ttl, const std::vector<std::string>& fields,
+                        std::vector<int32_t>* rets) {
+  return hashes_db_->HExpire(key, ttl, fields, rets);
+}
+
+Status Storage::HExpireat(const Slice& key, int32_t timestamp, const std::vector<std::string>& fields,
+                          std::vector<int32_t>* rets) {
+  return hashes_db_->HExpireat(key, timestamp, fields, rets);
+}
+
+Status Storage::HTTL(const Slice& key, const std::vector<std::string>& fields, std::vector<int64_t>* ttls) {
+  return hashes_db_->HTTL(key, fields, ttls);
+}
+
+Status Storage::HPersist(const Slice& key, const std::vector<std::string>& fields, std::vector<int32_t>* rets) {
+  return hashes_db_->HPersist(key, fields, rets);
+}
+
 // Sets Commands
 Status Storage::SAdd(const Slice& key, const std::vector<std::string>& members, int32_t* ret) {
   return sets_db_->SAdd(key, members, ret);
@@ -433,6 +486,11 @@ Status Storage::ZRangebyscore(const Slice& key, double min, double max, bool lef
   return zsets_db_->ZRangebyscore(key, min, max, left_close, right_close, count, offset, score_members);
 }
 
+Status Storage::ZScanScoreRanges(const Slice& key, std::vector<std::pair<double, double>> ranges,
+                                 const ScoreMemberVisitor& visitor) {
+  return zsets_db_->ZScanScoreRanges(key, std::move(ranges), visitor);
+}
+
 Status Storage::ZRank(const Slice& key, const Slice& member, int32_t* rank) {
   return zsets_db_->ZRank(key, member, rank);
 }
@@ -759,11 +817,26 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
   std::string prefix;
 
   prefix = isTailWildcard(pattern) ? pattern.substr(0, pattern.size() - 1) : "";
+  std::string scope = "pattern_" + pattern;
 
   if (cursor < 0) {
     return cursor_ret;
   } else {
-    Status s = GetStartKey(dtype, cursor, &start_key);
+    Status s = GetStartKey(dtype, cursor, scope, &start_key);
+    if (s.IsNotFound() && cursor > 0 && cursor <= ScanCursorStore::kMaxResumeWalk) {
+      // the cursor was evicted, it is the number of keys visited before it,
+      // walk them again to store it rather than restarting the scan
+      std::vector<std::string> skipped;
+      int64_t visited = 0;
+      while (visited < cursor) {
+        visited = Scan(dtype, visited, pattern, std::min(cursor - visited, kScanResumeStep), &skipped);
+        skipped.clear();
+        if (visited == 0) {
+          return cursor_ret;
+        }
+      }
+      s = GetStartKey(dtype, cursor, scope, &start_key);
+    }
     if (s.IsNotFound()) {
       // If want to scan all the databases, we start with the strings database
       start_key = (dtype == DataType::kAll ? DataTypeTag[kStrings] : DataTypeTag[dtype]) + prefix;
@@ -778,7 +851,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
       is_finish = strings_db_->Scan(start_key, pattern, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("k") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("k") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kStrings == dtype) {
@@ -786,7 +859,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("h") + prefix);
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("h") + prefix);
           break;
         }
       }
@@ -795,7 +868,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
       is_finish = hashes_db_->Scan(start_key, pattern, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("h") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("h") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kHashes == dtype) {
@@ -803,7 +876,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("s") + prefix);
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("s") + prefix);
           break;
         }
       }
@@ -812,7 +885,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
       is_finish = sets_db_->Scan(start_key, pattern, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("s") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("s") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kSets == dtype) {
@@ -820,7 +893,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("l") + prefix);
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("l") + prefix);
           break;
         }
       }
@@ -829,7 +902,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
       is_finish = lists_db_->Scan(start_key, pattern, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("l") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("l") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kLists == dtype) {
@@ -837,7 +910,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("z") + prefix);
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("z") + prefix);
           break;
         }
       }
@@ -846,7 +919,7 @@ int64_t Storage::Scan(const DataType& dtype, int64_t cursor, const std::string&
       is_finish = zsets_db_->Scan(start_key, pattern, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("z") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("z") + next_key);
         break;
       } else if (is_finish) {
         cursor_ret = 0;
@@ -866,13 +939,25 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
   std::string start_key;
   std::string next_key;
 
-  int64_t curtime;
-  rocksdb::Env::Default()->GetCurrentTime(&curtime);
+  std::string scope = "expire_" + std::to_string(min_ttl) + "_" + std::to_string(max_ttl);
 
   if (cursor < 0) {
     return cursor_ret;
   } else {
-    Status s = GetStartKey(dtype, cursor, &start_key);
+    Status s = GetStartKey(dtype, cursor, scope, &start_key);
+    if (s.IsNotFound() && cursor > 0 && cursor <= ScanCursorStore::kMaxResumeWalk) {
+      // the cursor was evicted, walk again the keys visited before it
+      std::vector<std::string> skipped;
+      int64_t visited = 0;
+      while (visited < cursor) {
+        visited = PKExpireScan(dtype, visited, min_ttl, max_ttl, std::min(cursor - visited, kScanResumeStep), &skipped);
+        skipped.clear();
+        if (visited == 0) {
+          return cursor_ret;
+        }
+      }
+      s = GetStartKey(dtype, cursor, scope, &start_key);
+    }
     if (s.IsNotFound()) {
       // If want to scan all the databases, we start with the strings database
       start_key = std::string(1, dtype == DataType::kAll ? DataTypeTag[kStrings] : DataTypeTag[dtype]);
@@ -880,6 +965,9 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
     }
   }
 
+  int64_t curtime;
+  rocksdb::Env::Default()->GetCurrentTime(&curtime);
+
   char key_type = start_key.at(0);
   start_key.erase(start_key.begin());
   switch (key_type) {
@@ -888,7 +976,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           strings_db_->PKExpireScan(start_key, curtime + min_ttl, curtime + max_ttl, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("k") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("k") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kStrings == dtype) {
@@ -896,7 +984,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("h"));
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("h"));
           break;
         }
       }
@@ -906,7 +994,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           hashes_db_->PKExpireScan(start_key, curtime + min_ttl, curtime + max_ttl, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("h") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("h") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kHashes == dtype) {
@@ -914,7 +1002,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("s"));
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("s"));
           break;
         }
       }
@@ -924,7 +1012,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           sets_db_->PKExpireScan(start_key, curtime + min_ttl, curtime + max_ttl, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("s") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("s") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kSets == dtype) {
@@ -932,7 +1020,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("l"));
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("l"));
           break;
         }
       }
@@ -942,7 +1030,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           lists_db_->PKExpireScan(start_key, curtime + min_ttl, curtime + max_ttl, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("l") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("l") + next_key);
         break;
       } else if (is_finish) {
         if (DataType::kLists == dtype) {
@@ -950,7 +1038,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           break;
         } else if (leftover_visits == 0) {
           cursor_ret = cursor + step_length;
-          StoreCursorStartKey(dtype, cursor_ret, std::string("z"));
+          StoreCursorStartKey(dtype, cursor_ret, scope, std::string("z"));
           break;
         }
       }
@@ -960,7 +1048,7 @@ int64_t Storage::PKExpireScan(const DataType& dtype, int64_t cursor, int32_t min
           zsets_db_->PKExpireScan(start_key, curtime + min_ttl, curtime + max_ttl, keys, &leftover_visits, &next_key);
       if ((leftover_visits == 0) && !is_finish) {
         cursor_ret = cursor + step_length;
-        StoreCursorStartKey(dtype, cursor_ret, std::string("z") + next_key);
+        StoreCursorStartKey(dtype, cursor_ret, scope, std::string("z") + next_key);
         break;
       } else if (is_finish) {
         cursor_ret = 0;
@@ -1232,6 +1320,23 @@ std::map<DataType, int64_t> Storage::TTL(const Slice& key, std::map<DataType, St
   return ret;
 }
 
+Status Storage::TTL(const DataType& data_type, const Slice& key, int64_t* ttl) {
+  switch (data_type) {
+    case DataType::kStrings:
+      return strings_db_->TTL(key, ttl);
+    case DataType::kHashes:
+      return hashes_db_->TTL(key, ttl);
+    case DataType::kLists:
+      return lists_db_->TTL(key, ttl);
+    case DataType::kSets:
+      return sets_db_->TTL(key, ttl);
+    case DataType::kZSets:
+      return zsets_db_->TTL(key, ttl);
+    default:
+      return Status::InvalidArgument("invalid data type");
+  }
+}
+
 Status Storage::GetType(const std::string& key, bool single, std::vector<std::string>& types) {
   types.clear();
 
@@ -1613,6 +1718,46 @@ Status Storage::SetSmallCompactionThreshold(uint32_t small_compaction_threshold)
   return Status::OK();
 }
 
+Status Storage::SetActiveExpireCpuPercent(int active_expire_cpu_percent) {
+  active_expire_cpu_percent_ = active_expire_cpu_percent;
+  return Status::OK();
+}
+
+int64_t Storage::ReapExpiredKeys(uint64_t budget_us) {
+  std::vector<Redis*> dbs = {strings_db_.get(), hashes_db_.get(), sets_db_.get(), lists_db_.get(), zsets_db_.get()};
+  uint64_t deadline_us = rocksdb::Env::Default()->NowMicros() + budget_us;
+  int64_t reaped = 0;
+  // start from a different type every cycle, so no type starves the others
+  // when the budget is used up
+  size_t start = expire_reaper_next_++ % dbs.size();
+  for (size_t i = 0; i < dbs.size(); i++) {
+    Redis* db = dbs[(start + i) % dbs.size()];
+    Status s = db->ReapExpiredKeys(deadline_us, &reaped);
+    if (!s.ok()) {
+      LOG(WARNING) << "reap expired keys failed, " << s.ToString();
+    }
+    if (rocksdb::Env::Default()->NowMicros() >= deadline_us) {
+      break;
+    }
+  }
+  return reaped;
+}
+
+void Storage::RunExpireReaper() {
+  while (!bg_tasks_should_exit_) {
+    {
+      std::unique_lock l(expire_reaper_mutex_);
+      expire_reaper_cv_.wait_for(l, std::chrono::milliseconds(kExpireCycleMs),
+                                 [this]() { return bg_tasks_should_exit_.load(); });
+    }
+    int percent = active_expire_cpu_percent_;
+    if (bg_tasks_should_exit_ || percent <= 0) {
+      continue;
+    }
+    ReapExpiredKeys(static_cast<uint64_t>(kExpireCycleMs) * 1000 * std::min(percent, 100) / 100);
+  }
+}
+
 std::string Storage::GetCurrentTaskType() {
   int type = current_task_type_;
   switch (type) {
@@ -1675,6 +1820,42 @@ uint64_t Storage::GetProperty(const std::string& db_type, const std::string& pro
   return result;
 }
 
+uint64_t Storage::GetTotalSstFilesSize() {
+  return strings_db_->GetTotalSstFilesSize() + hashes_db_->GetTotalSstFilesSize() +
+         lists_db_->GetTotalSstFilesSize() + zsets_db_->GetTotalSstFilesSize() + sets_db_->GetTotalSstFilesSize();
+}
+
+void Storage::GetSstFilesSize(std::map<std::string, SstFilesSize>* sizes) {
+  sizes->clear();
+  std::vector<std::pair<std::string, Redis*>> dbs = {{STRINGS_DB, strings_db_.get()},
+                                                     {HASHES_DB, hashes_db_.get()},
+                                                     {LISTS_DB, lists_db_.get()},
+                                                     {ZSETS_DB, zsets_db_.get()},
+                                                     {SETS_DB, sets_db_.get()}};
+  for (const auto& [type, db] : dbs) {
+    std::map<std::string, SstFilesSize> cf_sizes;
+    db->GetSstFilesSize(&cf_sizes);
+    for (const auto& [cf_name, size] : cf_sizes) {
+      (*sizes)[type + "_" + cf_name] = size;
+    }
+  }
+}
+
+Status Storage::IngestExternalFiles(const std::string& path) {
+  std::vector<std::pair<std::string, Redis*>> dbs = {{STRINGS_DB, strings_db_.get()},
+                                                     {HASHES_DB, hashes_db_.get()},
+                                                     {LISTS_DB, lists_db_.get()},
+                                                     {ZSETS_DB, zsets_db_.get()},
+                                                     {SETS_DB, sets_db_.get()}};
+  for (const auto& [type, db] : dbs) {
+    Status s = db->IngestExternalFiles(AppendSubDirectory(path, type));
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
 Status Storage::GetKeyNum(std::vector<KeyInfo>* key_infos) {
   KeyInfo key_info;
   // NOTE: keep the db order with string, hash, list, zset, set
@@ -0,0 +1,163 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "storage/backupable.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using storage::Slice;
+using storage::Status;
+
+class BackupableTest : public ::testing::Test {
+ public:
+  BackupableTest() = default;
+  ~BackupableTest() override = default;
+
+  void SetUp() override {
+    std::string path = "./db/backupable";
+    if (access(path.c_str(), F_OK) != 0) {
+      mkdir(path.c_str(), 0755);
+    }
+    storage_options.options.create_if_missing = true;
+    s = db.Open(storage_options, path);
+    storage::DeleteFiles(backup_path.c_str());
+  }
+
+  void TearDown() override {
+    std::string path = "./db/backupable";
+    storage::DeleteFiles(path.c_str());
+    storage::DeleteFiles(backup_path.c_str());
+  }
+
+  static void SetUpTestSuite() {}
+  static void TearDownTestSuite() {}
+
+  std::string backup_path = "./db/backupable_dump";
+  storage::StorageOptions storage_options;
+  storage::Storage db;
+  storage::Status s;
+};
+
+// The backup pinned at the sequence numbers has none of the writes after them
+TEST_F(BackupableTest, PinnedBackupTest) {
+  int32_t ret = 0;
+  for (int i = 0; i < 100; i++) {
+    s = db.Set("PINNED_STRING_KEY" + std::to_string(i), "VALUE");
+    ASSERT_TRUE(s.ok());
+  }
+  s = db.SAdd("PINNED_SET_KEY", {"MEMBER1", "MEMBER2"}, &ret);
+  ASSERT_TRUE(s.ok());
+
+  std::shared_ptr<storage::BackupEngine> engine;
+  s = storage::BackupEngine::Open(&db, engine);
+  ASSERT_TRUE(s.ok());
+  std::map<std::string, uint64_t> sequence_numbers = engine->LatestSequenceNumbers();
+  ASSERT_EQ(sequence_numbers.size(), 5);
+
+  // the writes after the pin, in the same wal files
+  s = db.Set("PINNED_STRING_KEY0", "NEW_VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.Set("PINNED_STRING_NEW_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+  s = db.SAdd("PINNED_SET_KEY", {"MEMBER3"}, &ret);
+  ASSERT_TRUE(s.ok());
+
+  s = engine->SetBackupContentAt(sequence_numbers);
+  ASSERT_TRUE(s.ok());
+  s = engine->CreateNewBackup(backup_path);
+  ASSERT_TRUE(s.ok());
+
+  storage::Storage backup;
+  s = backup.Open(storage_options, backup_path);
+  ASSERT_TRUE(s.ok());
+  std::string value;
+  s = backup.Get("PINNED_STRING_KEY0", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "VALUE");
+  s = backup.Get("PINNED_STRING_KEY99", &value);
+  ASSERT_TRUE(s.ok());
+  s = backup.Get("PINNED_STRING_NEW_KEY", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = backup.SCard("PINNED_SET_KEY", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 2);
+
+  // the db goes on
+  s = db.Get("PINNED_STRING_NEW_KEY", &value);
+  ASSERT_TRUE(s.ok());
+}
+
+static std::map<std::string, int> manifest_tags(const std::string& dir) {
+  std::map<std::string, int> tags;
+  std::ifstream in(dir + "/" + storage::BACKUP_MANIFEST);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string tag;
+    fields >> tag;
+    tags[tag]++;
+  }
+  return tags;
+}
+
+// Every backup has its manifest, an incremental one names its base
+TEST_F(BackupableTest, IncrementalBackupTest) {
+  mkdir(backup_path.c_str(), 0755);
+  mkdir((backup_path + "/base").c_str(), 0755);
+  mkdir((backup_path + "/incremental").c_str(), 0755);
+  s = db.Set("INCREMENTAL_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+
+  std::shared_ptr<storage::BackupEngine> engine;
+  s = storage::BackupEngine::Open(&db, engine);
+  ASSERT_TRUE(s.ok());
+  s = engine->SetBackupContent();
+  ASSERT_TRUE(s.ok());
+  engine->SetBackupMeta("binlog_offset", "100");
+  s = engine->CreateNewBackup(backup_path + "/base");
+  ASSERT_TRUE(s.ok());
+  std::map<std::string, int> tags = manifest_tags(backup_path + "/base");
+  ASSERT_EQ(tags["meta"], 1);
+  ASSERT_EQ(tags["db"], 5);
+  ASSERT_EQ(tags["base"], 0);
+  ASSERT_EQ(tags["copied_bytes"], 1);
+  ASSERT_GT(tags["file"], 0);
+
+  s = db.Set("INCREMENTAL_NEW_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+  s = storage::BackupEngine::Open(&db, engine);
+  ASSERT_TRUE(s.ok());
+  s = engine->SetBaseBackup(backup_path + "/none");
+  ASSERT_TRUE(s.IsNotFound());
+  s = engine->SetBaseBackup(backup_path + "/base");
+  ASSERT_TRUE(s.ok());
+  s = engine->SetBackupContent();
+  ASSERT_TRUE(s.ok());
+  s = engine->CreateNewBackup(backup_path + "/incremental");
+  ASSERT_TRUE(s.ok());
+  tags = manifest_tags(backup_path + "/incremental");
+  ASSERT_EQ(tags["base"], 1);
+
+  // the incremental backup is whole
+  storage::Storage backup;
+  s = backup.Open(storage_options, backup_path + "/incremental");
+  ASSERT_TRUE(s.ok());
+  std::string value;
+  s = backup.Get("INCREMENTAL_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  s = backup.Get("INCREMENTAL_NEW_KEY", &value);
+  ASSERT_TRUE(s.ok());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
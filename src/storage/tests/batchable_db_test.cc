@@ -0,0 +1,80 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "src/batchable_db.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using storage::Status;
+
+class BatchableDBTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    std::string path = "./db/batchable";
+    if (access(path.c_str(), F_OK) != 0) {
+      mkdir(path.c_str(), 0755);
+    }
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    rocksdb::DB* base = nullptr;
+    s = rocksdb::DB::Open(options, path, &base);
+    ASSERT_TRUE(s.ok());
+    db = std::make_unique<storage::BatchableDB>(base, std::vector<rocksdb::ColumnFamilyHandle*>{
+                                                          base->DefaultColumnFamily()});
+  }
+
+  void TearDown() override {
+    db.reset();
+    storage::DeleteFiles("./db/batchable");
+  }
+
+  std::string Get(const std::string& key) {
+    std::string value;
+    Status get_status = db->Get(rocksdb::ReadOptions(), key, &value);
+    return get_status.ok() ? value : "nil";
+  }
+
+  std::unique_ptr<storage::BatchableDB> db;
+  Status s;
+};
+
+// A range deletion in a scope is written after the buffer at the commit
+TEST_F(BatchableDBTest, DeleteRangeInScope) {
+  s = db->Put(rocksdb::WriteOptions(), "a1", "v1");
+  ASSERT_TRUE(s.ok());
+  {
+    storage::BatchWriteScope scope;
+    s = db->Put(rocksdb::WriteOptions(), "a2", "v2");
+    ASSERT_TRUE(s.ok());
+    s = db->Put(rocksdb::WriteOptions(), "b1", "v3");
+    ASSERT_TRUE(s.ok());
+    rocksdb::WriteBatch batch;
+    batch.DeleteRange(db->DefaultColumnFamily(), "a", "b");
+    s = db->Write(rocksdb::WriteOptions(), &batch);
+    ASSERT_TRUE(s.ok());
+    // nothing is written before the commit
+    ASSERT_EQ(Get("a1"), "v1");
+    s = scope.Commit();
+    ASSERT_TRUE(s.ok());
+  }
+  ASSERT_EQ(Get("a1"), "nil");
+  ASSERT_EQ(Get("a2"), "nil");
+  ASSERT_EQ(Get("b1"), "v3");
+
+  // a scope with only range deletions
+  {
+    storage::BatchWriteScope scope;
+    rocksdb::WriteBatch batch;
+    batch.DeleteRange(db->DefaultColumnFamily(), "b", "c");
+    s = db->Write(rocksdb::WriteOptions(), &batch);
+    ASSERT_TRUE(s.ok());
+    s = scope.Commit();
+    ASSERT_TRUE(s.ok());
+  }
+  ASSERT_EQ(Get("b1"), "nil");
+}
@@ -6,12 +6,14 @@
 #include <dirent.h>
 #include <gtest/gtest.h>
 #include <unistd.h>
+#include <climits>
 #include <iostream>
 #include <iterator>
 #include <thread>
 
 #include "storage/storage.h"
 #include "storage/util.h"
+#include "src/scan_cursor_store.h"
 
 using namespace storage;
 
@@ -1382,6 +1384,43 @@ TEST_F(HashesTest, HScanTest) {  // NOLINT
   ASSERT_TRUE(field_value_match(field_value_out, {}));
 }
 
+// HScan with a cursor not stored, as after it is evicted
+TEST_F(HashesTest, HScanResumeTest) {  // NOLINT
+  int64_t next_cursor = 0;
+  std::vector<FieldValue> field_value_out;
+  std::vector<FieldValue> field_value{{"a", "v"}, {"b", "v"}, {"c", "v"}, {"d", "v"},
+                                      {"e", "v"}, {"f", "v"}, {"g", "v"}, {"h", "v"}};
+  s = db.HMSet("HSCAN_RESUME_KEY", field_value);
+  ASSERT_TRUE(s.ok());
+
+  // the scan goes on after the fields visited before the cursor
+  s = db.HScan("HSCAN_RESUME_KEY", 3, "*", 3, &field_value_out, &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(next_cursor, 6);
+  ASSERT_TRUE(field_value_match(field_value_out, {{"d", "v"}, {"e", "v"}, {"f", "v"}}));
+
+  field_value_out.clear();
+  s = db.HScan("HSCAN_RESUME_KEY", next_cursor, "*", 3, &field_value_out, &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(next_cursor, 0);
+  ASSERT_TRUE(field_value_match(field_value_out, {{"g", "v"}, {"h", "v"}}));
+
+  // past the last field the scan is over
+  field_value_out.clear();
+  s = db.HScan("HSCAN_RESUME_KEY", 20, "*", 3, &field_value_out, &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(next_cursor, 0);
+  ASSERT_TRUE(field_value_out.empty());
+
+  // a cursor too far to skip again restarts the scan
+  field_value_out.clear();
+  s = db.HScan("HSCAN_RESUME_KEY", storage::ScanCursorStore::kMaxResumeWalk + 1, "*", 3, &field_value_out,
+               &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(next_cursor, 3);
+  ASSERT_TRUE(field_value_match(field_value_out, {{"a", "v"}, {"b", "v"}, {"c", "v"}}));
+}
+
 // HScanx
 TEST_F(HashesTest, HScanxTest) {
   std::string start_field;
@@ -2419,6 +2458,278 @@ TEST_F(HashesTest, PKHRScanRangeTest) {
   ASSERT_EQ(next_field, "i");
 }
 
+class HashesInlineTest : public ::testing::Test {
+ public:
+  HashesInlineTest() = default;
+  ~HashesInlineTest() override = default;
+
+  void SetUp() override {
+    std::string path = "./db/hashes_inline";
+    if (access(path.c_str(), F_OK) != 0) {
+      mkdir(path.c_str(), 0755);
+    }
+    storage_options.options.create_if_missing = true;
+    storage_options.hash_max_inline_fields = 4;
+    storage_options.hash_max_inline_value = 16;
+    s = db.Open(storage_options, path);
+  }
+
+  void TearDown() override {
+    std::string path = "./db/hashes_inline";
+    DeleteFiles(path.c_str());
+  }
+
+  static void SetUpTestSuite() {}
+  static void TearDownTestSuite() {}
+
+  StorageOptions storage_options;
+  storage::Storage db;
+  storage::Status s;
+};
+
+// Hashes kept in their meta value
+TEST_F(HashesInlineTest, InlineTest) {  // NOLINT
+  int32_t ret = 0;
+  int64_t int_ret = 0;
+  std::string value;
+  std::string next_field;
+  int64_t next_cursor = 0;
+  std::vector<FieldValue> field_values;
+  std::vector<std::string> fields;
+  std::vector<ValueStatus> vss;
+
+  // ***************** Group 1 Test *****************
+  s = db.HSet("GP1_INLINE_KEY", "c", "3", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  s = db.HMSet("GP1_INLINE_KEY", {{"a", "1"}, {"b", "2"}});
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("GP1_INLINE_KEY", "a", "11", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 0);
+  s = db.HSetnx("GP1_INLINE_KEY", "b", "22", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 0);
+  ASSERT_TRUE(size_match(&db, "GP1_INLINE_KEY", 3));
+  ASSERT_TRUE(field_value_match(&db, "GP1_INLINE_KEY", {{"a", "11"}, {"b", "2"}, {"c", "3"}}));
+
+  s = db.HGet("GP1_INLINE_KEY", "a", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "11");
+  s = db.HGet("GP1_INLINE_KEY", "d", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db.HExists("GP1_INLINE_KEY", "c");
+  ASSERT_TRUE(s.ok());
+  s = db.HMGet("GP1_INLINE_KEY", {"c", "d", "b"}, &vss);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(vss.size(), 3);
+  ASSERT_EQ(vss[0].value, "3");
+  ASSERT_TRUE(vss[1].status.IsNotFound());
+  ASSERT_EQ(vss[2].value, "2");
+
+  s = db.HIncrby("GP1_INLINE_KEY", "a", 5, &int_ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(int_ret, 16);
+  s = db.HIncrby("GP1_INLINE_KEY", "c", LLONG_MAX, &int_ret);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  s = db.HIncrbyfloat("GP1_INLINE_KEY", "b", "0.5", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "2.5");
+
+  // In the order of the fields
+  s = db.HKeys("GP1_INLINE_KEY", &fields);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(fields, std::vector<std::string>({"a", "b", "c"}));
+  s = db.HScanx("GP1_INLINE_KEY", "b", "*", 1, &field_values, &next_field);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(field_value_match(field_values, {{"b", "2.5"}}));
+  ASSERT_EQ(next_field, "c");
+  s = db.PKHScanRange("GP1_INLINE_KEY", "a", "b", "*", 10, &field_values, &next_field);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(field_value_match(field_values, {{"a", "16"}, {"b", "2.5"}}));
+  ASSERT_EQ(next_field, "");
+  s = db.PKHRScanRange("GP1_INLINE_KEY", "", "", "*", 2, &field_values, &next_field);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(field_value_match(field_values, {{"c", "3"}, {"b", "2.5"}}));
+  ASSERT_EQ(next_field, "a");
+  // A small hash is scanned at once
+  s = db.HScan("GP1_INLINE_KEY", 0, "*", 1, &field_values, &next_cursor);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(field_values.size(), 3);
+  ASSERT_EQ(next_cursor, 0);
+
+  s = db.HDel("GP1_INLINE_KEY", {"a", "c", "d"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 2);
+  s = db.HDel("GP1_INLINE_KEY", {"b"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  s = db.HLen("GP1_INLINE_KEY", &ret);
+  ASSERT_TRUE(s.IsNotFound());
+
+  // ***************** Group 2 Test *****************
+  // Grown past the limits, to data keys
+  s = db.HMSet("GP2_INLINE_KEY", {{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}});
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("GP2_INLINE_KEY", "e", "5", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(size_match(&db, "GP2_INLINE_KEY", 5));
+  ASSERT_TRUE(field_value_match(&db, "GP2_INLINE_KEY", {{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}, {"e", "5"}}));
+  s = db.HDel("GP2_INLINE_KEY", {"a"}, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(field_value_match(&db, "GP2_INLINE_KEY", {{"b", "2"}, {"c", "3"}, {"d", "4"}, {"e", "5"}}));
+
+  s = db.HSet("GP3_INLINE_KEY", "a", "a value longer than the limit", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("GP3_INLINE_KEY", "b", "2", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(field_value_match(&db, "GP3_INLINE_KEY", {{"a", "a value longer than the limit"}, {"b", "2"}}));
+
+  // Created again inline once deleted
+  std::map<storage::DataType, rocksdb::Status> type_status;
+  ASSERT_EQ(db.Del({"GP2_INLINE_KEY"}, &type_status), 1);
+  s = db.HSet("GP2_INLINE_KEY", "z", "26", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(size_match(&db, "GP2_INLINE_KEY", 1));
+  ASSERT_TRUE(field_value_match(&db, "GP2_INLINE_KEY", {{"z", "26"}}));
+}
+
+// Fields expire
+TEST_F(HashesInlineTest, FieldExpireTest) {  // NOLINT
+  int32_t ret = 0;
+  std::string value;
+  std::vector<int32_t> rets;
+  std::vector<int64_t> ttls;
+  std::map<storage::DataType, rocksdb::Status> type_status;
+
+  // ***************** Group 1 Test *****************
+  s = db.HMSet("GP1_FIELD_EXPIRE_KEY", {{"a", "1"}, {"b", "2"}, {"c", "3"}});
+  ASSERT_TRUE(s.ok());
+  s = db.HExpire("GP1_FIELD_EXPIRE_KEY", 1, {"a", "b", "d"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1, 1, -2}));
+  s = db.HTTL("GP1_FIELD_EXPIRE_KEY", {"a", "c", "d"}, &ttls);
+  ASSERT_TRUE(s.ok());
+  ASSERT_GE(ttls[0], 0);
+  ASSERT_LE(ttls[0], 1);
+  ASSERT_EQ(ttls[1], -1);
+  ASSERT_EQ(ttls[2], -2);
+  s = db.HPersist("GP1_FIELD_EXPIRE_KEY", {"b", "c", "d"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1, -1, -2}));
+
+  // Not due yet
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  s = db.HGet("GP1_FIELD_EXPIRE_KEY", "a", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_TRUE(size_match(&db, "GP1_FIELD_EXPIRE_KEY", 2));
+  ASSERT_TRUE(field_value_match(&db, "GP1_FIELD_EXPIRE_KEY", {{"b", "2"}, {"c", "3"}}));
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 1);
+  ASSERT_TRUE(field_value_match(&db, "GP1_FIELD_EXPIRE_KEY", {{"b", "2"}, {"c", "3"}}));
+
+  // A field set again lives for ever
+  s = db.HExpire("GP1_FIELD_EXPIRE_KEY", 100, {"b"}, &rets);
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("GP1_FIELD_EXPIRE_KEY", "b", "22", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.HTTL("GP1_FIELD_EXPIRE_KEY", {"b"}, &ttls);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ttls[0], -1);
+
+  // A ttl of 0 deletes the fields, and the hash with its last one
+  s = db.HExpire("GP1_FIELD_EXPIRE_KEY", 0, {"b", "c"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({2, 2}));
+  ASSERT_EQ(db.Exists({"GP1_FIELD_EXPIRE_KEY"}, &type_status), 0);
+  s = db.HTTL("GP1_FIELD_EXPIRE_KEY", {"b"}, &ttls);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_EQ(ttls[0], -2);
+
+  // ***************** Group 2 Test *****************
+  // The last field reaped deletes the hash
+  s = db.HSet("GP2_FIELD_EXPIRE_KEY", "a", "1", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.HExpire("GP2_FIELD_EXPIRE_KEY", 1, {"a"}, &rets);
+  ASSERT_TRUE(s.ok());
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 1);
+  ASSERT_EQ(db.Exists({"GP2_FIELD_EXPIRE_KEY"}, &type_status), 0);
+
+  // ***************** Group 3 Test *****************
+  // A hash with fields that expire goes to data keys past the limits
+  s = db.HSet("GP3_FIELD_EXPIRE_KEY", "a", "1", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.HExpire("GP3_FIELD_EXPIRE_KEY", 100, {"a"}, &rets);
+  ASSERT_TRUE(s.ok());
+  s = db.HMSet("GP3_FIELD_EXPIRE_KEY", {{"b", "2"}, {"c", "3"}, {"d", "4"}, {"e", "5"}});
+  ASSERT_TRUE(s.ok());
+  s = db.HTTL("GP3_FIELD_EXPIRE_KEY", {"a", "e"}, &ttls);
+  ASSERT_TRUE(s.ok());
+  ASSERT_GT(ttls[0], 0);
+  ASSERT_EQ(ttls[1], -1);
+  s = db.HPersist("GP3_FIELD_EXPIRE_KEY", {"a", "b", "f"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1, -1, -2}));
+  ASSERT_TRUE(field_value_match(&db, "GP3_FIELD_EXPIRE_KEY",
+                                {{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}, {"e", "5"}}));
+  s = db.HExpire("GP3_FIELD_EXPIRE_KEY", 100, {"a"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1}));
+  s = db.HTTL("GP3_FIELD_EXPIRE_KEY", {"a", "f"}, &ttls);
+  ASSERT_TRUE(s.ok());
+  ASSERT_GT(ttls[0], 0);
+  ASSERT_EQ(ttls[1], -2);
+
+  // ***************** Group 4 Test *****************
+  // The fields of a big hash of data keys expire
+  s = db.HMSet("GP4_FIELD_EXPIRE_KEY", {{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}, {"e", "5"}});
+  ASSERT_TRUE(s.ok());
+  s = db.HExpire("GP4_FIELD_EXPIRE_KEY", 1, {"a", "b", "z"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({1, 1, -2}));
+  int64_t ival = 0;
+  s = db.HIncrby("GP4_FIELD_EXPIRE_KEY", "c", 1, &ival);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ival, 4);
+  // a field set again lives for ever
+  s = db.HSet("GP4_FIELD_EXPIRE_KEY", "b", "22", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 0);
+  s = db.HTTL("GP4_FIELD_EXPIRE_KEY", {"a", "b", "c"}, &ttls);
+  ASSERT_TRUE(s.ok());
+  ASSERT_GE(ttls[0], 0);
+  ASSERT_EQ(ttls[1], -1);
+  ASSERT_EQ(ttls[2], -1);
+
+  // Not due yet
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  s = db.HGet("GP4_FIELD_EXPIRE_KEY", "a", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db.HTTL("GP4_FIELD_EXPIRE_KEY", {"a"}, &ttls);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ttls[0], -2);
+  ASSERT_TRUE(field_value_match(&db, "GP4_FIELD_EXPIRE_KEY", {{"b", "22"}, {"c", "4"}, {"d", "4"}, {"e", "5"}}));
+  // counted until dropped
+  ASSERT_TRUE(size_match(&db, "GP4_FIELD_EXPIRE_KEY", 5));
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 1);
+  ASSERT_TRUE(size_match(&db, "GP4_FIELD_EXPIRE_KEY", 4));
+  ASSERT_TRUE(field_value_match(&db, "GP4_FIELD_EXPIRE_KEY", {{"b", "22"}, {"c", "4"}, {"d", "4"}, {"e", "5"}}));
+
+  // A ttl of 0 deletes the fields
+  s = db.HExpire("GP4_FIELD_EXPIRE_KEY", 0, {"c", "c", "a"}, &rets);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(rets, std::vector<int32_t>({2, -2, -2}));
+  ASSERT_TRUE(size_match(&db, "GP4_FIELD_EXPIRE_KEY", 3));
+  s = db.HSet("GP4_FIELD_EXPIRE_KEY", "a", "1", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 1);
+  ASSERT_TRUE(field_value_match(&db, "GP4_FIELD_EXPIRE_KEY", {{"a", "1"}, {"b", "22"}, {"d", "4"}, {"e", "5"}}));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
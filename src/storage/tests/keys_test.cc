@@ -5,10 +5,12 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <limits>
 #include <thread>
 
 #include "storage/storage.h"
 #include "storage/util.h"
+#include "src/scan_cursor_store.h"
 
 // using namespace storage;
 using storage::DataType;
@@ -4869,6 +4871,44 @@ TEST_F(KeysTest, ScanCaseSingleTest) {  // NOLINT
   db.Compact(DataType::kAll, true);
 }
 
+// Scan with a cursor not stored, as after it is evicted
+TEST_F(KeysTest, ScanResumeTest) {  // NOLINT
+  int64_t cursor = 0;
+  std::vector<std::string> keys;
+  for (int i = 1; i <= 6; i++) {
+    s = db.Set("SCAN_RESUME_KEY" + std::to_string(i), "VALUE");
+    ASSERT_TRUE(s.ok());
+  }
+
+  // the scan goes on after the keys visited before the cursor
+  cursor = db.Scan(DataType::kStrings, 2, "SCAN_RESUME_KEY*", 2, &keys);
+  ASSERT_EQ(cursor, 4);
+  ASSERT_TRUE(key_match(keys, {"SCAN_RESUME_KEY3", "SCAN_RESUME_KEY4"}));
+
+  keys.clear();
+  cursor = db.Scan(DataType::kStrings, cursor, "SCAN_RESUME_KEY*", 2, &keys);
+  ASSERT_EQ(cursor, 0);
+  ASSERT_TRUE(key_match(keys, {"SCAN_RESUME_KEY5", "SCAN_RESUME_KEY6"}));
+
+  // of every type, the keys of all the types before it are walked again
+  keys.clear();
+  cursor = db.Scan(DataType::kAll, 5, "SCAN_RESUME_KEY*", 10, &keys);
+  ASSERT_EQ(cursor, 0);
+  ASSERT_TRUE(key_match(keys, {"SCAN_RESUME_KEY6"}));
+
+  // a cursor too far to walk again restarts the scan
+  keys.clear();
+  cursor = db.Scan(DataType::kStrings, storage::ScanCursorStore::kMaxResumeWalk + 1, "SCAN_RESUME_KEY*", 10, &keys);
+  ASSERT_EQ(cursor, 0);
+  ASSERT_TRUE(key_match(keys, {"SCAN_RESUME_KEY1", "SCAN_RESUME_KEY2", "SCAN_RESUME_KEY3", "SCAN_RESUME_KEY4",
+                               "SCAN_RESUME_KEY5", "SCAN_RESUME_KEY6"}));
+
+  std::map<storage::DataType, Status> type_status;
+  for (int i = 1; i <= 6; i++) {
+    db.Del({"SCAN_RESUME_KEY" + std::to_string(i)}, &type_status);
+  }
+}
+
 TEST_F(KeysTest, PKExpireScanCaseAllTest) {  // NOLINT
   int64_t cursor;
   int64_t next_cursor;
@@ -8016,6 +8056,208 @@ TEST_F(KeysTest, TTLTest) {
   }
 }
 
+// Reap expired keys by the expire index
+TEST_F(KeysTest, ReapExpiredKeysTest) {
+  int32_t ret;
+  std::map<storage::DataType, rocksdb::Status> type_status;
+
+  s = db.Setex("REAP_STRING_KEY", "VALUE", 1);
+  ASSERT_TRUE(s.ok());
+  s = db.HSet("REAP_HASH_KEY", "FIELD", "VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  ret = db.Expire("REAP_HASH_KEY", 1, &type_status);
+  ASSERT_EQ(ret, 1);
+
+  // The ttl is removed after it was indexed, the key must survive
+  s = db.Set("REAP_PERSIST_KEY", "VALUE");
+  ASSERT_TRUE(s.ok());
+  ret = db.Expire("REAP_PERSIST_KEY", 1, &type_status);
+  ASSERT_EQ(ret, 1);
+  ret = db.Persist("REAP_PERSIST_KEY", &type_status);
+  ASSERT_EQ(ret, 1);
+
+  // Not due yet
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 0);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 3);
+  // The index entries are consumed
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 0);
+
+  std::vector<storage::KeyInfo> key_infos;
+  s = db.GetKeyNum(&key_infos);
+  ASSERT_TRUE(s.ok());
+  // strings
+  ASSERT_EQ(key_infos[0].keys, 1);
+  ASSERT_EQ(key_infos[0].invaild_keys, 0);
+  // hashes, the emptied meta is left to the compaction
+  ASSERT_EQ(key_infos[1].keys, 0);
+
+  std::string value;
+  s = db.Get("REAP_PERSIST_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "VALUE");
+}
+
+// Reap expired collections big enough to have their data range deleted
+TEST_F(KeysTest, ReapExpiredBigKeysTest) {
+  int32_t ret;
+  std::map<storage::DataType, rocksdb::Status> type_status;
+  s = db.SetSmallCompactionThreshold(8);
+  ASSERT_TRUE(s.ok());
+
+  std::vector<storage::ScoreMember> score_members;
+  std::vector<std::string> values;
+  for (int32_t idx = 0; idx < 16; idx++) {
+    score_members.push_back({static_cast<double>(idx - 8), "MEMBER_" + std::to_string(idx)});
+    values.push_back("VALUE_" + std::to_string(idx));
+  }
+  // the lowest and highest scores are in the range too
+  score_members.push_back({-std::numeric_limits<double>::infinity(), "MEMBER_LOWEST"});
+  score_members.push_back({std::numeric_limits<double>::infinity(), "\xff\xff"});
+  s = db.ZAdd("REAP_ZSET_KEY", score_members, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 18);
+  uint64_t len;
+  s = db.RPush("REAP_LIST_KEY", values, &len);
+  ASSERT_TRUE(s.ok());
+  // the neighbours of the reaped keys must survive
+  s = db.ZAdd("REAP_ZSET_KEY_", score_members, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZAdd("REAP_ZSET_KE", score_members, &ret);
+  ASSERT_TRUE(s.ok());
+  ret = db.Expire("REAP_ZSET_KEY", 1, &type_status);
+  ASSERT_EQ(ret, 1);
+  ret = db.Expire("REAP_LIST_KEY", 1, &type_status);
+  ASSERT_EQ(ret, 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 2);
+  // The index entries are consumed, the reaper does not retry them
+  ASSERT_EQ(db.ReapExpiredKeys(1000000), 0);
+
+  s = db.ZCard("REAP_ZSET_KEY", &ret);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db.LLen("REAP_LIST_KEY", &len);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db.ZCard("REAP_ZSET_KEY_", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 18);
+  s = db.ZCard("REAP_ZSET_KE", &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 18);
+  std::vector<storage::ScoreMember> range;
+  s = db.ZRange("REAP_ZSET_KEY_", 0, -1, &range);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(range.size(), 18);
+
+  // The compaction does not trip over the range tombstones
+  s = db.Compact(DataType::kAll, true);
+  ASSERT_TRUE(s.ok());
+  s = db.ZRange("REAP_ZSET_KE", 0, -1, &range);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(range.size(), 18);
+  s = db.ZAdd("REAP_ZSET_KEY", {{1, "MEMBER"}}, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZRange("REAP_ZSET_KEY", 0, -1, &range);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(range.size(), 1);
+}
+
+// BatchWriteScope
+TEST_F(KeysTest, BatchWriteScopeTest) {  // NOLINT
+  int32_t int32_ret;
+  uint64_t uint64_ret;
+  std::string value;
+  std::vector<std::string> members;
+  std::vector<std::string> pushed;
+  db.SetListPushListener([&pushed](const Slice& key) { pushed.push_back(key.ToString()); });
+
+  // ***************** Group 1 Test *****************
+  // the writes are seen by the thread of the scope only, until the commit
+  {
+    storage::BatchWriteScope scope;
+    s = db.Set("GP1_BATCH_WRITE_SCOPE_STRING_KEY", "GP1_BATCH_WRITE_SCOPE_VALUE");
+    ASSERT_TRUE(s.ok());
+    s = db.SAdd("GP1_BATCH_WRITE_SCOPE_SET_KEY", {"a", "b"}, &int32_ret);
+    ASSERT_TRUE(s.ok());
+    s = db.SAdd("GP1_BATCH_WRITE_SCOPE_SET_KEY", {"b", "c"}, &int32_ret);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(int32_ret, 1);
+    s = db.RPush("GP1_BATCH_WRITE_SCOPE_LIST_KEY", {"a"}, &uint64_ret);
+    ASSERT_TRUE(s.ok());
+
+    s = db.Get("GP1_BATCH_WRITE_SCOPE_STRING_KEY", &value);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(value, "GP1_BATCH_WRITE_SCOPE_VALUE");
+    s = db.SMembers("GP1_BATCH_WRITE_SCOPE_SET_KEY", &members);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(members.size(), 3);
+
+    std::thread other([&]() {
+      std::string other_value;
+      ASSERT_TRUE(db.Get("GP1_BATCH_WRITE_SCOPE_STRING_KEY", &other_value).IsNotFound());
+    });
+    other.join();
+    ASSERT_TRUE(pushed.empty());
+
+    s = scope.Commit();
+    ASSERT_TRUE(s.ok());
+  }
+  s = db.Get("GP1_BATCH_WRITE_SCOPE_STRING_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "GP1_BATCH_WRITE_SCOPE_VALUE");
+  s = db.SCard("GP1_BATCH_WRITE_SCOPE_SET_KEY", &int32_ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(int32_ret, 3);
+  ASSERT_EQ(pushed, std::vector<std::string>({"GP1_BATCH_WRITE_SCOPE_LIST_KEY"}));
+
+  // ***************** Group 2 Test *****************
+  // nothing is written without the commit
+  pushed.clear();
+  {
+    storage::BatchWriteScope scope;
+    s = db.Set("GP2_BATCH_WRITE_SCOPE_STRING_KEY", "GP2_BATCH_WRITE_SCOPE_VALUE");
+    ASSERT_TRUE(s.ok());
+    s = db.LPush("GP2_BATCH_WRITE_SCOPE_LIST_KEY", {"a"}, &uint64_ret);
+    ASSERT_TRUE(s.ok());
+  }
+  s = db.Get("GP2_BATCH_WRITE_SCOPE_STRING_KEY", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db.LLen("GP2_BATCH_WRITE_SCOPE_LIST_KEY", &uint64_ret);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_TRUE(pushed.empty());
+
+  db.SetListPushListener(nullptr);
+}
+
+// SstFilesSize
+TEST_F(KeysTest, SstFilesSizeTest) {
+  int32_t ret = 0;
+  for (int i = 0; i < 100; i++) {
+    s = db.Set("SST_FILES_SIZE_STRING_KEY" + std::to_string(i), "SST_FILES_SIZE_VALUE");
+    ASSERT_TRUE(s.ok());
+    s = db.HSet("SST_FILES_SIZE_HASH_KEY", "FIELD" + std::to_string(i), "SST_FILES_SIZE_VALUE", &ret);
+    ASSERT_TRUE(s.ok());
+  }
+  s = db.Compact(DataType::kAll, true);
+  ASSERT_TRUE(s.ok());
+
+  // the files flushed and compacted are tracked by the listeners
+  uint64_t total = db.GetTotalSstFilesSize();
+  ASSERT_GT(total, 0);
+  std::map<std::string, storage::SstFilesSize> sizes;
+  db.GetSstFilesSize(&sizes);
+  uint64_t sum = 0;
+  for (const auto& [name, size] : sizes) {
+    ASSERT_LE(size.live, size.total);
+    sum += size.total;
+  }
+  ASSERT_EQ(sum, total);
+  ASSERT_GT(sizes["strings_default"].live, 0);
+  ASSERT_GT(sizes["hashes_data_cf"].live, 0);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -2698,6 +2698,33 @@ TEST_F(ListsTest, RPushxTest) {  // NOLINT
   ASSERT_TRUE(s.ok());
 }
 
+// ListPushListener
+TEST_F(ListsTest, ListPushListenerTest) {  // NOLINT
+  int64_t ret;
+  uint64_t num;
+  std::string element;
+  std::vector<std::string> pushed;
+  db.SetListPushListener([&pushed](const Slice& key) { pushed.push_back(key.ToString()); });
+
+  ASSERT_TRUE(db.LPush("LISTENER_KEY", {"a"}, &num).ok());
+  ASSERT_TRUE(db.RPush("LISTENER_KEY", {"b"}, &num).ok());
+  ASSERT_TRUE(db.LPushx("LISTENER_KEY", {"c"}, &num).ok());
+  ASSERT_TRUE(db.RPushx("LISTENER_KEY", {"d"}, &num).ok());
+  ASSERT_TRUE(db.LInsert("LISTENER_KEY", storage::Before, "a", "e", &ret).ok());
+  ASSERT_TRUE(db.RPoplpush("LISTENER_KEY", "LISTENER_DST_KEY", &element).ok());
+  ASSERT_EQ(pushed, std::vector<std::string>({"LISTENER_KEY", "LISTENER_KEY", "LISTENER_KEY", "LISTENER_KEY",
+                                              "LISTENER_KEY", "LISTENER_DST_KEY"}));
+
+  // nothing is pushed by pops or failed pushes
+  pushed.clear();
+  ASSERT_TRUE(db.LPop("LISTENER_KEY", &element).ok());
+  ASSERT_TRUE(db.RPop("LISTENER_KEY", &element).ok());
+  ASSERT_TRUE(db.LPushx("LISTENER_NO_KEY", {"a"}, &num).IsNotFound());
+  ASSERT_TRUE(pushed.empty());
+
+  db.SetListPushListener(nullptr);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
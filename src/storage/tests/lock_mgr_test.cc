@@ -6,7 +6,6 @@
 #include <thread>
 
 #include "src/lock_mgr.h"
-#include "src/mutex_impl.h"
 
 using namespace storage;
 
@@ -19,8 +18,7 @@ void Func(LockMgr* mgr, int id, const std::string& key) {
 }
 
 int main() {
-  std::shared_ptr<MutexFactory> factory = std::make_shared<MutexFactoryImpl>();
-  LockMgr mgr(1, 3, factory);
+  LockMgr mgr(1);
 
   std::thread t1(Func, &mgr, 1, "key_1");
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
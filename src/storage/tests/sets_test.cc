@@ -4,7 +4,9 @@
 //  of patent rights can be found in the PATENTS file in the same directory.
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <thread>
 
 #include "storage/storage.h"
@@ -727,6 +729,42 @@ TEST_F(SetsTest, SInterTest) {  // NOLINT
   s = db.SInter(gp5_keys, &gp5_members_out);
   ASSERT_TRUE(s.ok());
   ASSERT_TRUE(members_match(gp5_members_out, {"a", "c"}));
+
+  // ***************** Group 6 Test *****************
+  // key1 = {m0 ... m4999}
+  // key2 = {m0, m1000, m2000, m3000, m4000, x}
+  // key3 = {m0, m2, m4 ... m4998}
+  // SINTER key1 key2 key3 = {m0, m1000, m2000, m3000, m4000}
+  std::vector<std::string> gp6_members1;
+  std::vector<std::string> gp6_members3;
+  for (int32_t i = 0; i < 5000; i++) {
+    gp6_members1.push_back("m" + std::to_string(i));
+    if (i % 2 == 0) {
+      gp6_members3.push_back("m" + std::to_string(i));
+    }
+  }
+  std::vector<std::string> gp6_members2{"m0", "m1000", "m2000", "m3000", "m4000", "x"};
+  s = db.SAdd("GP6_SINTER_KEY1", gp6_members1, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 5000);
+  s = db.SAdd("GP6_SINTER_KEY2", gp6_members2, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 6);
+  s = db.SAdd("GP6_SINTER_KEY3", gp6_members3, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 2500);
+
+  std::vector<std::string> gp6_members_out;
+  std::vector<std::string> gp6_keys{"GP6_SINTER_KEY1", "GP6_SINTER_KEY2", "GP6_SINTER_KEY3"};
+  s = db.SInter(gp6_keys, &gp6_members_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(members_match(gp6_members_out, {"m0", "m1000", "m2000", "m3000", "m4000"}));
+
+  gp6_members_out.clear();
+  std::vector<std::string> gp6_diff_keys{"GP6_SINTER_KEY3", "GP6_SINTER_KEY2", "GP6_SINTER_KEY1"};
+  s = db.SDiff(gp6_diff_keys, &gp6_members_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp6_members_out.size(), 0);
 }
 
 // SInterstore
@@ -1430,6 +1468,34 @@ TEST_F(SetsTest, SPopTest) {  // NOLINT
   ASSERT_TRUE(size_match(&db, "GP7_SPOP_KEY", 0));
   ASSERT_TRUE(members_match(&db, "GP7_SPOP_KEY", {}));
   ASSERT_TRUE(members_match(gp7_out_all, gp7_members));
+
+  // ***************** Group 8 Test *****************
+  // Pop a few members of a large set at a time
+  std::vector<std::string> gp8_members;
+  for (int32_t i = 0; i < 5000; i++) {
+    gp8_members.push_back("gp8_" + std::to_string(i));
+  }
+  s = db.SAdd("GP8_SPOP_KEY", gp8_members, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 5000);
+
+  std::vector<std::string> gp8_out_all;
+  for (int32_t i = 0; i < 50; i++) {
+    members.clear();
+    s = db.SPop("GP8_SPOP_KEY", &members, 10);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(members.size(), 10);
+    gp8_out_all.insert(gp8_out_all.end(), members.begin(), members.end());
+  }
+  members.clear();
+  ASSERT_TRUE(members_uniquen(gp8_out_all));
+  ASSERT_TRUE(members_contains(gp8_out_all, gp8_members));
+  ASSERT_TRUE(size_match(&db, "GP8_SPOP_KEY", 4500));
+  for (const auto& member : gp8_out_all) {
+    s = db.SIsmember("GP8_SPOP_KEY", member, &ret);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(ret, 0);
+  }
 }
 
 // SRandmember
@@ -1537,6 +1603,55 @@ TEST_F(SetsTest, SRanmemberTest) {  // NOLINT
   ASSERT_TRUE(s.IsNotFound());
   ASSERT_EQ(gp3_out.size(), 0);
   ASSERT_TRUE(members_match(gp3_out, {}));
+
+  // ***************** Group 4 Test *****************
+  // A set large enough to be drawn from the sampling index
+  std::vector<std::string> gp4_members;
+  for (int32_t i = 0; i < 10000; i++) {
+    gp4_members.push_back("gp4_" + std::to_string(i));
+  }
+  s = db.SAdd("GP4_SRANDMEMBER_KEY", gp4_members, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 10000);
+  s = db.SRem("GP4_SRANDMEMBER_KEY", {"gp4_0", "gp4_1", "gp4_2"}, &ret);
+  ASSERT_TRUE(s.ok());
+  gp4_members.erase(gp4_members.begin(), gp4_members.begin() + 3);
+
+  std::vector<std::string> gp4_out;
+  s = db.SRandmember("GP4_SRANDMEMBER_KEY", 100, &gp4_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp4_out.size(), 100);
+  ASSERT_TRUE(members_uniquen(gp4_out));
+  ASSERT_TRUE(members_contains(gp4_out, gp4_members));
+
+  s = db.SRandmember("GP4_SRANDMEMBER_KEY", -300, &gp4_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp4_out.size(), 300);
+  ASSERT_TRUE(members_contains(gp4_out, gp4_members));
+
+  // ***************** Group 5 Test *****************
+  // Every member is drawn about as often as the others
+  std::vector<std::string> gp5_members;
+  for (int32_t i = 0; i < 200; i++) {
+    gp5_members.push_back("gp5_" + std::to_string(i));
+  }
+  s = db.SAdd("GP5_SRANDMEMBER_KEY", gp5_members, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 200);
+
+  std::vector<std::string> gp5_out;
+  s = db.SRandmember("GP5_SRANDMEMBER_KEY", -20000, &gp5_out);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp5_out.size(), 20000);
+  std::map<std::string, int32_t> gp5_counts;
+  for (const auto& member : gp5_out) {
+    gp5_counts[member]++;
+  }
+  ASSERT_EQ(gp5_counts.size(), 200);
+  for (const auto& member_count : gp5_counts) {
+    ASSERT_GE(member_count.second, 40);
+    ASSERT_LE(member_count.second, 200);
+  }
 }
 
 // SRem
@@ -1836,6 +1951,43 @@ TEST_F(SetsTest, SUnionstoreTest) {  // NOLINT
   ASSERT_EQ(ret, 3);
   ASSERT_TRUE(size_match(&db, "GP4_SUNIONSTORE_DESTINATION1", 3));
   ASSERT_TRUE(members_match(&db, "GP4_SUNIONSTORE_DESTINATION1", {"a", "x", "l"}));
+
+  // ***************** Group 5 Test *****************
+  // key1 = {m0, m2 ... m5998}
+  // key2 = {m0, m3 ... m5997}
+  // SUNIONSTORE key1 key1 key2, written in several batches
+  std::vector<std::string> gp5_members1;
+  std::vector<std::string> gp5_members2;
+  std::vector<std::string> gp5_union;
+  for (int32_t i = 0; i < 6000; i++) {
+    if (i % 2 == 0) {
+      gp5_members1.push_back("m" + std::to_string(i));
+    }
+    if (i % 3 == 0) {
+      gp5_members2.push_back("m" + std::to_string(i));
+    }
+    if (i % 2 == 0 || i % 3 == 0) {
+      gp5_union.push_back("m" + std::to_string(i));
+    }
+  }
+  s = db.SAdd("GP5_SUNIONSTORE_KEY1", gp5_members1, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 3000);
+  s = db.SAdd("GP5_SUNIONSTORE_KEY2", gp5_members2, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 2000);
+
+  std::vector<std::string> gp5_keys{"GP5_SUNIONSTORE_KEY1", "GP5_SUNIONSTORE_KEY2"};
+  s = db.SUnionstore("GP5_SUNIONSTORE_KEY1", gp5_keys, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 4000);
+  ASSERT_TRUE(size_match(&db, "GP5_SUNIONSTORE_KEY1", 4000));
+  std::vector<std::string> gp5_members_out;
+  s = db.SMembers("GP5_SUNIONSTORE_KEY1", &gp5_members_out);
+  ASSERT_TRUE(s.ok());
+  std::sort(gp5_members_out.begin(), gp5_members_out.end());
+  std::sort(gp5_union.begin(), gp5_union.end());
+  ASSERT_EQ(gp5_members_out, gp5_union);
 }
 
 // SScan
@@ -0,0 +1,178 @@
+//  Copyright (c) 2017-present, Qihoo, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+
+#include "storage/sst_builder.h"
+#include "storage/storage.h"
+#include "storage/util.h"
+
+using storage::DataType;
+using storage::FieldValue;
+using storage::ScoreMember;
+using storage::Slice;
+using storage::Status;
+
+class SstBuilderTest : public ::testing::Test {
+ public:
+  SstBuilderTest() = default;
+  ~SstBuilderTest() override = default;
+
+  void SetUp() override {
+    std::string path = "./db/sst_builder";
+    if (access(path.c_str(), F_OK) != 0) {
+      mkdir(path.c_str(), 0755);
+    }
+    storage_options.options.create_if_missing = true;
+    s = db.Open(storage_options, path);
+    storage::DeleteFiles(sst_path.c_str());
+  }
+
+  void TearDown() override {
+    std::string path = "./db/sst_builder";
+    storage::DeleteFiles(path.c_str());
+    storage::DeleteFiles(sst_path.c_str());
+  }
+
+  static void SetUpTestSuite() {}
+  static void TearDownTestSuite() {}
+
+  std::string sst_path = "./db/sst_builder_output";
+  storage::StorageOptions storage_options;
+  storage::Storage db;
+  storage::Status s;
+};
+
+// Build every type with a buffer small enough to merge many runs
+TEST_F(SstBuilderTest, BuildAndIngestTest) {
+  storage::SstBuilder builder(storage_options, sst_path, 4096);
+  for (int i = 0; i < 500; i++) {
+    s = builder.Set("SST_STRING_KEY" + std::to_string(i), "SST_VALUE" + std::to_string(i));
+    ASSERT_TRUE(s.ok());
+  }
+  // a string set again keeps the last value
+  s = builder.Set("SST_STRING_KEY7", "SST_NEW_VALUE");
+  ASSERT_TRUE(s.ok());
+  s = builder.Set("SST_STRING_TTL_KEY", "SST_VALUE", 100);
+  ASSERT_TRUE(s.ok());
+
+  std::vector<FieldValue> fvs;
+  std::vector<std::string> values;
+  std::vector<ScoreMember> score_members;
+  for (int i = 0; i < 300; i++) {
+    fvs.push_back({"FIELD" + std::to_string(i), "VALUE" + std::to_string(i)});
+    values.push_back("VALUE" + std::to_string(i));
+    score_members.push_back({static_cast<double>(300 - i), "MEMBER" + std::to_string(i)});
+  }
+  // of the same fields the last one is kept
+  fvs.push_back({"FIELD0", "NEW_VALUE"});
+  s = builder.HMSet("SST_HASH_KEY", fvs);
+  ASSERT_TRUE(s.ok());
+  s = builder.RPush("SST_LIST_KEY", values);
+  ASSERT_TRUE(s.ok());
+  s = builder.SAdd("SST_SET_KEY", values);
+  ASSERT_TRUE(s.ok());
+  s = builder.ZAdd("SST_ZSET_KEY", score_members);
+  ASSERT_TRUE(s.ok());
+  s = builder.Finish();
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(builder.keys(), 506);
+
+  s = db.IngestExternalFiles(sst_path);
+  ASSERT_TRUE(s.ok());
+
+  std::string value;
+  s = db.Get("SST_STRING_KEY0", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "SST_VALUE0");
+  s = db.Get("SST_STRING_KEY499", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "SST_VALUE499");
+  s = db.Get("SST_STRING_KEY7", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "SST_NEW_VALUE");
+
+  std::map<storage::DataType, Status> type_status;
+  std::map<storage::DataType, int64_t> type_ttl = db.TTL("SST_STRING_TTL_KEY", &type_status);
+  ASSERT_GT(type_ttl[DataType::kStrings], 0);
+  ASSERT_LE(type_ttl[DataType::kStrings], 100);
+
+  int32_t len = 0;
+  s = db.HLen("SST_HASH_KEY", &len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(len, 300);
+  s = db.HGet("SST_HASH_KEY", "FIELD0", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "NEW_VALUE");
+  s = db.HGet("SST_HASH_KEY", "FIELD299", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "VALUE299");
+
+  std::vector<std::string> range;
+  s = db.LRange("SST_LIST_KEY", 0, -1, &range);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(range, values);
+
+  s = db.SCard("SST_SET_KEY", &len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(len, 300);
+  s = db.SIsmember("SST_SET_KEY", "VALUE150", &len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(len, 1);
+
+  std::vector<ScoreMember> score_range;
+  s = db.ZRange("SST_ZSET_KEY", 0, 1, &score_range);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(score_range.size(), 2);
+  ASSERT_EQ(score_range[0].member, "MEMBER299");
+  ASSERT_EQ(score_range[1].member, "MEMBER298");
+  double score = 0;
+  s = db.ZScore("SST_ZSET_KEY", "MEMBER0", &score);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(score, 300);
+}
+
+// The keys ingested replace the ones in the db
+TEST_F(SstBuilderTest, IngestReplaceTest) {
+  int32_t ret = 0;
+  s = db.HSet("SST_REPLACE_KEY", "OLD_FIELD", "OLD_VALUE", &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.Set("SST_REPLACE_STRING_KEY", "OLD_VALUE");
+  ASSERT_TRUE(s.ok());
+  // the versions are in seconds, the build is newer than the key
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+  storage::SstBuilder builder(storage_options, sst_path);
+  s = builder.HMSet("SST_REPLACE_KEY", {{"NEW_FIELD", "NEW_VALUE"}});
+  ASSERT_TRUE(s.ok());
+  s = builder.Set("SST_REPLACE_STRING_KEY", "NEW_VALUE");
+  ASSERT_TRUE(s.ok());
+  s = builder.Finish();
+  ASSERT_TRUE(s.ok());
+  s = db.IngestExternalFiles(sst_path);
+  ASSERT_TRUE(s.ok());
+
+  std::vector<FieldValue> fvs;
+  s = db.HGetall("SST_REPLACE_KEY", &fvs);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(fvs.size(), 1);
+  ASSERT_EQ(fvs[0].field, "NEW_FIELD");
+  ASSERT_EQ(fvs[0].value, "NEW_VALUE");
+  std::string value;
+  s = db.Get("SST_REPLACE_STRING_KEY", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "NEW_VALUE");
+
+  // nothing is left to ingest
+  s = builder.Set("SST_REPLACE_STRING_KEY", "VALUE");
+  ASSERT_TRUE(s.IsNotSupported());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -3930,6 +3930,44 @@ TEST_F(ZSetsTest, ZUnionstoreTest) {  // NOLINT
   ASSERT_EQ(ret, 1);
   ASSERT_TRUE(size_match(&db, "GP11_ZUNIONSTORE_DESTINATION", 1));
   ASSERT_TRUE(score_members_match(&db, "GP11_ZUNIONSTORE_DESTINATION", {{0, "MM1"}}));
+
+  // ***************** Group 12 Test *****************
+  // {i, MM<i>} for even i below 6000     weight 1
+  // {2i, MM<i>} for i multiple of 3      weight 1
+  //
+  // {max, MM<i>} for i even or multiple of 3, written in several batches
+  //
+  std::vector<storage::ScoreMember> gp12_sm1;
+  std::vector<storage::ScoreMember> gp12_sm2;
+  for (int32_t i = 0; i < 6000; i++) {
+    if (i % 2 == 0) {
+      gp12_sm1.push_back({static_cast<double>(i), "MM" + std::to_string(i)});
+    }
+    if (i % 3 == 0) {
+      gp12_sm2.push_back({static_cast<double>(2 * i), "MM" + std::to_string(i)});
+    }
+  }
+  s = db.ZAdd("GP12_ZUNIONSTORE_SM1", gp12_sm1, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZAdd("GP12_ZUNIONSTORE_SM2", gp12_sm2, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZUnionstore("GP12_ZUNIONSTORE_SM1", {"GP12_ZUNIONSTORE_SM1", "GP12_ZUNIONSTORE_SM2"}, {1, 1}, storage::MAX,
+                     &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 4000);
+  ASSERT_TRUE(size_match(&db, "GP12_ZUNIONSTORE_SM1", 4000));
+  double gp12_score = 0;
+  s = db.ZScore("GP12_ZUNIONSTORE_SM1", "MM6", &gp12_score);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp12_score, 12);
+  s = db.ZScore("GP12_ZUNIONSTORE_SM1", "MM4", &gp12_score);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp12_score, 4);
+  s = db.ZScore("GP12_ZUNIONSTORE_SM1", "MM5997", &gp12_score);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(gp12_score, 11994);
+  s = db.ZScore("GP12_ZUNIONSTORE_SM1", "MM5", &gp12_score);
+  ASSERT_TRUE(s.IsNotFound());
 }
 
 // ZINTERSTORE
@@ -4158,6 +4196,29 @@ TEST_F(ZSetsTest, ZInterstoreTest) {  // NOLINT
   ASSERT_EQ(ret, 0);
   ASSERT_TRUE(size_match(&db, "GP10_ZINTERSTORE_DESTINATION", 0));
   ASSERT_TRUE(score_members_match(&db, "GP10_ZINTERSTORE_DESTINATION", {}));
+
+  // ***************** Group 11 Test *****************
+  // {i, MM<i>} for i below 5000                  weight 1
+  // {1, MM0} {1, MM2500} {1, MM4999} {1, MMX}    weight 2
+  //
+  // {2, MM0} {2502, MM2500} {5001, MM4999}
+  //
+  std::vector<storage::ScoreMember> gp11_sm1;
+  for (int32_t i = 0; i < 5000; i++) {
+    gp11_sm1.push_back({static_cast<double>(i), "MM" + std::to_string(i)});
+  }
+  std::vector<storage::ScoreMember> gp11_sm2{{1, "MM0"}, {1, "MM2500"}, {1, "MM4999"}, {1, "MMX"}};
+  s = db.ZAdd("GP11_ZINTERSTORE_SM1", gp11_sm1, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZAdd("GP11_ZINTERSTORE_SM2", gp11_sm2, &ret);
+  ASSERT_TRUE(s.ok());
+  s = db.ZInterstore("GP11_ZINTERSTORE_DESTINATION", {"GP11_ZINTERSTORE_SM1", "GP11_ZINTERSTORE_SM2"}, {1, 2},
+                     storage::SUM, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 3);
+  ASSERT_TRUE(size_match(&db, "GP11_ZINTERSTORE_DESTINATION", 3));
+  ASSERT_TRUE(score_members_match(&db, "GP11_ZINTERSTORE_DESTINATION",
+                                  {{2, "MM0"}, {2502, "MM2500"}, {5001, "MM4999"}}));
 }
 
 // ZRANGEBYLEX
@@ -5229,6 +5290,56 @@ TEST_F(ZSetsTest, ZScanTest) {  // NOLINT
   ASSERT_TRUE(score_members_match(score_member_out, {}));
 }
 
+// ZScanScoreRanges
+TEST_F(ZSetsTest, ZScanScoreRangesTest) {  // NOLINT
+  int32_t ret;
+  std::vector<storage::ScoreMember> gp1_sm;
+  for (int32_t i = 0; i < 100; i++) {
+    gp1_sm.push_back({static_cast<double>(i), "MM" + std::to_string(i)});
+  }
+  s = db.ZAdd("GP1_ZSCANSCORERANGES_KEY", gp1_sm, &ret);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(ret, 100);
+
+  // ***************** Group 1 Test *****************
+  // overlapping, adjacent, duplicated and unsorted ranges
+  std::vector<double> scores;
+  auto collect = [&scores](double score, const Slice& member) {
+    scores.push_back(score);
+    return true;
+  };
+  s = db.ZScanScoreRanges("GP1_ZSCANSCORERANGES_KEY", {{50, 60}, {10, 20}, {15, 25}, {25, 30}, {50, 60}, {98, 200}},
+                          collect);
+  ASSERT_TRUE(s.ok());
+  std::vector<double> expect;
+  for (int32_t i = 10; i <= 30; i++) {
+    expect.push_back(i);
+  }
+  for (int32_t i = 50; i <= 60; i++) {
+    expect.push_back(i);
+  }
+  expect.push_back(98);
+  expect.push_back(99);
+  ASSERT_EQ(scores, expect);
+
+  // ***************** Group 2 Test *****************
+  // the visitor stops the scan
+  scores.clear();
+  s = db.ZScanScoreRanges("GP1_ZSCANSCORERANGES_KEY", {{0, 10}, {20, 30}}, [&scores](double score, const Slice&) {
+    scores.push_back(score);
+    return scores.size() < 3;
+  });
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(scores, std::vector<double>({0, 1, 2}));
+
+  // ***************** Group 3 Test *****************
+  // not exist key
+  scores.clear();
+  s = db.ZScanScoreRanges("GP3_ZSCANSCORERANGES_KEY", {{0, 10}}, collect);
+  ASSERT_TRUE(s.IsNotFound());
+  ASSERT_TRUE(scores.empty());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
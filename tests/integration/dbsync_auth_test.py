@@ -0,0 +1,128 @@
+import socket
+import struct
+import time
+import redis
+
+# 测试全同步的DBSyncMeta和DBSyncFile请求只对已注册的slave开放:
+# 没有经过DBSync注册、或session id不一致的节点不能获取dump的文件列表和文件内容
+K_DB_SYNC_META = 7
+K_DB_SYNC_FILE = 8
+K_ERROR = 2
+K_PORT_SHIFT_REPL_SERVER = 2000
+
+
+def encode_varint(value):
+    value &= (1 << 64) - 1
+    out = b''
+    while True:
+        bits = value & 0x7f
+        value >>= 7
+        if value:
+            out += bytes([bits | 0x80])
+        else:
+            return out + bytes([bits])
+
+
+def field_varint(number, value):
+    return encode_varint(number << 3) + encode_varint(value)
+
+
+def field_bytes(number, data):
+    if isinstance(data, str):
+        data = data.encode()
+    return encode_varint((number << 3) | 2) + encode_varint(len(data)) + data
+
+
+def decode_fields(data):
+    fields = {}
+    pos = 0
+    while pos < len(data):
+        key, pos = decode_varint(data, pos)
+        number, wire_type = key >> 3, key & 7
+        if wire_type == 0:
+            value, pos = decode_varint(data, pos)
+        elif wire_type == 2:
+            length, pos = decode_varint(data, pos)
+            value = data[pos:pos + length]
+            pos += length
+        elif wire_type == 5:
+            value = data[pos:pos + 4]
+            pos += 4
+        else:
+            value = data[pos:pos + 8]
+            pos += 8
+        fields[number] = value
+    return fields
+
+
+def decode_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def node_and_slot(ip, port, db_name, slot_id):
+    node = field_bytes(1, ip) + field_varint(2, port)
+    slot = field_bytes(1, db_name) + field_varint(2, slot_id)
+    return field_bytes(1, node) + field_bytes(2, slot)
+
+
+def send_request(ip, port, request):
+    sock = socket.create_connection((ip, port + K_PORT_SHIFT_REPL_SERVER))
+    sock.sendall(struct.pack('>I', len(request)) + request)
+    header = b''
+    while len(header) < 4:
+        header += sock.recv(4 - len(header))
+    length = struct.unpack('>I', header)[0]
+    body = b''
+    while len(body) < length:
+        body += sock.recv(length - len(body))
+    sock.close()
+    return decode_fields(body)
+
+
+def test_dbsync_rejects_unregistered_node():
+    print("start test_dbsync_rejects_unregistered_node")
+    master_ip = '127.0.0.1'
+    master_port = 9221
+    slave_ip = '127.0.0.1'
+    slave_port = 9231
+
+    master = redis.Redis(host=master_ip, port=master_port, db=0)
+    slave = redis.Redis(host=slave_ip, port=slave_port, db=0)
+    master.set('dbsync_auth_key', 'value')
+    slave.slaveof(master_ip, master_port)
+    master.bgsave()
+    time.sleep(10)
+
+    # 一个从未发起DBSync的节点，以及冒用已注册slave的ip:port但session id不一致的节点
+    wrong_session = 1 << 30
+    for port in [19999, slave_port]:
+        meta = node_and_slot(slave_ip, port, 'db0', 0) + field_varint(3, wrong_session)
+        response = send_request(master_ip, master_port,
+                                field_varint(1, K_DB_SYNC_META) + field_bytes(8, meta))
+        assert response[2] == K_ERROR, f'Expected: DBSyncMeta from port {port} rejected, but got code {response[2]}'
+        meta_response = decode_fields(response[10])
+        assert meta_response.get(3) is None, f'Expected: no snapshot uuid given to port {port}'
+
+        files = node_and_slot(slave_ip, port, 'db0', 0) + field_bytes(3, 'any') + \
+            field_bytes(4, 'strings/CURRENT') + field_varint(5, 0) + field_varint(6, 4096) + \
+            field_varint(7, wrong_session)
+        response = send_request(master_ip, master_port,
+                                field_varint(1, K_DB_SYNC_FILE) + field_bytes(9, files))
+        assert response[2] == K_ERROR, f'Expected: DBSyncFile from port {port} rejected, but got code {response[2]}'
+        assert b'slave node' in response[3], f'Expected: rejected as an unknown slave node, but got {response[3]}'
+        file_response = decode_fields(response[11])
+        assert file_response[5] == b'', f'Expected: no data given to port {port}, but got {file_response[5]}'
+
+    slave.slaveof(b'no', b'one')
+    print("test_dbsync_rejects_unregistered_node OK [✓]")
+
+
+test_dbsync_rejects_unregistered_node()
@@ -134,3 +134,39 @@ start_server {tags {"repl"}} {
         }
     }
 }
+
+start_server {tags {"repl"}} {
+    start_server {} {
+        set master [srv -1 client]
+        set master_host [srv -1 host]
+        set master_port [srv -1 port]
+        set slave [srv 0 client]
+
+        test {Full sync from a pinned bgsave during concurrent INCRs} {
+            $master config set dump-pin-sequence yes
+            $master set counter 0
+            set rd [redis_deferring_client -1]
+            set rd2 [redis_deferring_client -1]
+            for {set j 0} {$j < 50000} {incr j} {
+                $rd incr counter
+                $rd2 incr counter
+            }
+            $rd flush
+            $rd2 flush
+            $slave slaveof $master_host $master_port
+            for {set j 0} {$j < 50000} {incr j} {
+                $rd read
+                $rd2 read
+            }
+            $rd close
+            $rd2 close
+            wait_for_condition 50 100 {
+                [s 0 master_link_status] eq {up} &&
+                [$slave get counter] eq [$master get counter]
+            } else {
+                fail "The slave lost or repeated INCRs of the full sync"
+            }
+            $master get counter
+        } {100000}
+    }
+}
@@ -195,6 +195,16 @@ proc ::redis::redis_multi_bulk_read {id fd} {
     return $l
 }
 
+# A RESP3 map, read as the flat list of its keys and values
+proc ::redis::redis_map_read {id fd} {
+    set count [redis_read_line $fd]
+    set l {}
+    for {set i 0} {$i < $count * 2} {incr i} {
+        lappend l [redis_read_reply $id $fd]
+    }
+    return $l
+}
+
 proc ::redis::redis_read_line fd {
     string trim [gets $fd]
 }
@@ -202,10 +212,15 @@ proc ::redis::redis_read_line fd {
 proc ::redis::redis_read_reply {id fd} {
     set type [read $fd 1]
     switch -exact -- $type {
+        , -
         : -
         + {redis_read_line $fd}
+        _ {redis_read_line $fd; return {}}
         - {return -code error [redis_read_line $fd]}
         $ {redis_bulk_read $fd}
+        % {redis_map_read $id $fd}
+        ~ -
+        > -
         * {redis_multi_bulk_read $id $fd}
         default {
             if {$type eq {}} {
@@ -27,7 +27,9 @@ set ::all_tests {
     # unit/sort
     # unit/expire
     # unit/other
-    # unit/multi
+    unit/multi
+    unit/sharding
+    unit/tracking
     # unit/quit
     # unit/aofrw
     # integration/replication
@@ -40,7 +42,7 @@ set ::all_tests {
     # integration/convert-zipmap-hash-on-load
     # unit/pubsub
     # unit/slowlog
-    # unit/scripting
+    unit/scripting
     unit/maxmemory
     # unit/introspection
     # unit/limits
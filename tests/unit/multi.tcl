@@ -57,20 +57,16 @@ start_server {tags {"multi"}} {
         list [r exists foo1] [r exists foo2]
     } {0 0}
 
+    # there is no maxmemory to refuse a write with, an admin command is
+    # refused while queueing instead
     test {EXEC fails if there are errors while queueing commands #2} {
-        set rd [redis_deferring_client]
         r del foo1 foo2
         r multi
         r set foo1 bar1
-        $rd config set maxmemory 1
-        assert  {[$rd read] eq {OK}}
-        catch {r lpush mylist myvalue}
-        $rd config set maxmemory 0
-        assert  {[$rd read] eq {OK}}
+        catch {r config get maxmemory}
         r set foo2 bar2
         catch {r exec} e
         assert_match {EXECABORT*} $e
-        $rd close
         list [r exists foo1] [r exists foo2]
     } {0 0}
 
@@ -111,11 +107,11 @@ start_server {tags {"multi"}} {
         r exec
     } {}
 
-    test {EXEC fail on WATCHed key modified by SORT with STORE even if the result is empty} {
+    test {EXEC fail on WATCHed key modified by SUNIONSTORE even if the result is empty} {
         r flushdb
-        r lpush foo bar
+        r sadd foo bar
         r watch foo
-        r sort emptylist store foo
+        r sunionstore foo emptyset
         r multi
         r ping
         r exec
@@ -252,58 +248,87 @@ start_server {tags {"multi"}} {
         r incr x
         r exec
     } {11}
+}
 
-    test {MULTI / EXEC is propagated correctly (single write command)} {
-        set repl [attach_to_replication_stream]
-        r multi
-        r set foo bar
-        r exec
-        assert_replication_stream $repl {
-            {select *}
-            {multi}
-            {set foo bar}
-            {exec}
+# A transaction reaches the slave as one exec binlog of the writes it made,
+# there is no replication stream to attach to, the slave is read instead
+start_server {tags {"multi repl"}} {
+    start_server {} {
+        test {Connect a slave to the main instance} {
+            r -1 slaveof [srv 0 host] [srv 0 port]
+            wait_for_condition 50 100 {
+                [s -1 role] eq {slave} &&
+                [string match {*master_link_status:up*} [r -1 info replication]]
+            } else {
+                fail "Can't turn the instance into a slave"
+            }
         }
-        close_replication_stream $repl
-    }
 
-    test {MULTI / EXEC is propagated correctly (empty transaction)} {
-        set repl [attach_to_replication_stream]
-        r multi
-        r exec
-        r set foo bar
-        assert_replication_stream $repl {
-            {select *}
-            {set foo bar}
+        test {MULTI / EXEC is propagated correctly (single write command)} {
+            r multi
+            r set foo bar
+            r exec
+            wait_for_condition 50 100 {
+                [r -1 get foo] eq {bar}
+            } else {
+                fail "Expected bar in foo, but value is '[r -1 get foo]'"
+            }
         }
-        close_replication_stream $repl
-    }
 
-    test {MULTI / EXEC is propagated correctly (read-only commands)} {
-        r set foo value1
-        set repl [attach_to_replication_stream]
-        r multi
-        r get foo
-        r exec
-        r set foo value2
-        assert_replication_stream $repl {
-            {select *}
-            {set foo value2}
+        test {MULTI / EXEC is propagated correctly (empty transaction)} {
+            r multi
+            r exec
+            r set foo bar2
+            wait_for_condition 50 100 {
+                [r -1 get foo] eq {bar2}
+            } else {
+                fail "Expected bar2 in foo, but value is '[r -1 get foo]'"
+            }
         }
-        close_replication_stream $repl
-    }
 
-    test {MULTI / EXEC is propagated correctly (write command, no effect)} {
-        r del bar foo bar
-        set repl [attach_to_replication_stream]
-        r multi
-        r del foo
-        r exec
-        assert_replication_stream $repl {
-            {select *}
-            {multi}
-            {exec}
+        test {MULTI / EXEC is propagated correctly (read-only commands)} {
+            r set foo value1
+            r multi
+            r get foo
+            r exec
+            r set foo value2
+            wait_for_condition 50 100 {
+                [r -1 get foo] eq {value2}
+            } else {
+                fail "Expected value2 in foo, but value is '[r -1 get foo]'"
+            }
+        }
+
+        test {MULTI / EXEC is propagated correctly (write command, no effect)} {
+            r del bar foo bar
+            r multi
+            r del foo
+            r exec
+            r set bar done
+            wait_for_condition 50 100 {
+                [r -1 get bar] eq {done}
+            } else {
+                fail "Expected done in bar, but value is '[r -1 get bar]'"
+            }
+            r -1 exists foo
+        } {0}
+
+        test {MULTI / EXEC is propagated correctly (several types)} {
+            r del foo mylist myset
+            r multi
+            r set foo bar
+            r lpush mylist a b c
+            r sadd myset x y
+            r incr counter
+            r exec
+            wait_for_condition 50 100 {
+                [r -1 get foo] eq [r get foo] &&
+                [r -1 lrange mylist 0 -1] eq [r lrange mylist 0 -1] &&
+                [lsort [r -1 smembers myset]] eq [lsort [r smembers myset]] &&
+                [r -1 get counter] eq [r get counter]
+            } else {
+                fail "Master-Slave desync after MULTI / EXEC writing several types."
+            }
         }
-        close_replication_stream $repl
     }
 }
@@ -100,6 +100,83 @@ start_server {tags {"protocol"}} {
     unset c
 }
 
+start_server {tags {"resp3"}} {
+    proc read_raw_lines {fd count} {
+        set lines {}
+        for {set i 0} {$i < $count} {incr i} {
+            lappend lines [string trim [gets $fd]]
+        }
+        return $lines
+    }
+
+    test "HELLO 3 switches the connection to RESP3" {
+        reconnect
+        set reply [r hello 3]
+        assert_equal 3 [dict get $reply proto]
+        dict get [r hello 2] proto
+    } {2}
+
+    test "RESP3 typed replies" {
+        reconnect
+        r del myhash myzset myset nokey
+        r hset myhash f v
+        r zadd myzset 1.5 a
+        r sadd myset x
+        r hello 3
+        set fd [r channel]
+        r write "*2\r\n\$7\r\nhgetall\r\n\$6\r\nmyhash\r\n"
+        r write "*3\r\n\$6\r\nzscore\r\n\$6\r\nmyzset\r\n\$1\r\na\r\n"
+        r write "*2\r\n\$3\r\nget\r\n\$5\r\nnokey\r\n"
+        r write "*2\r\n\$8\r\nsmembers\r\n\$5\r\nmyset\r\n"
+        r flush
+        assert_equal {%1 $1 f $1 v} [read_raw_lines $fd 5]
+        assert_equal {,1.5} [read_raw_lines $fd 1]
+        assert_equal {_} [read_raw_lines $fd 1]
+        assert_equal {~1 $1 x} [read_raw_lines $fd 3]
+        assert_equal {{a 1.5}} [r zrange myzset 0 -1 withscores]
+        r hgetall myhash
+    } {f v}
+
+    test "RESP3 null replies" {
+        reconnect
+        r del myhash myzset nokey
+        r hset myhash f v
+        r zadd myzset 1 a
+        r hello 3
+        set fd [r channel]
+        r write "*3\r\n\$4\r\nhget\r\n\$6\r\nmyhash\r\n\$7\r\nnofield\r\n"
+        r write "*4\r\n\$5\r\nhmget\r\n\$6\r\nmyhash\r\n\$1\r\nf\r\n\$7\r\nnofield\r\n"
+        r write "*3\r\n\$5\r\nzrank\r\n\$6\r\nmyzset\r\n\$8\r\nnomember\r\n"
+        r write "*3\r\n\$4\r\nmget\r\n\$6\r\nmyzset\r\n\$5\r\nnokey\r\n"
+        r flush
+        assert_equal {_} [read_raw_lines $fd 1]
+        assert_equal {*2 $1 v _} [read_raw_lines $fd 4]
+        assert_equal {_} [read_raw_lines $fd 1]
+        read_raw_lines $fd 3
+    } {*2 _ _}
+
+    test "RESP2 replies are unchanged" {
+        reconnect
+        set fd [r channel]
+        r write "*3\r\n\$6\r\nzscore\r\n\$6\r\nmyzset\r\n\$1\r\na\r\n"
+        r write "*2\r\n\$7\r\nhgetall\r\n\$6\r\nmyhash\r\n"
+        r flush
+        assert_equal {$3 1.5} [read_raw_lines $fd 2]
+        read_raw_lines $fd 5
+    } {*2 $1 f $1 v}
+
+    test "Pubsub messages are pushed to RESP3 connections" {
+        reconnect
+        r hello 3
+        set fd [r channel]
+        r write "*2\r\n\$9\r\nsubscribe\r\n\$7\r\nchannel\r\n"
+        r flush
+        set lines [read_raw_lines $fd 6]
+        reconnect
+        set lines
+    } {>3 $9 subscribe $7 channel :1}
+}
+
 start_server {tags {"regression"}} {
     test "Regression for a crash with blocking ops and pipelining" {
         set rd [redis_deferring_client]
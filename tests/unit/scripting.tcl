@@ -63,17 +63,17 @@ start_server {tags {"scripting"}} {
 
     test {EVAL - Redis integer -> Lua type conversion} {
         r eval {
-            local foo = redis.pcall('incr','x')
+            local foo = redis.pcall('incr',KEYS[1])
             return {type(foo),foo}
-        } 0
+        } 1 x
     } {number 1}
 
     test {EVAL - Redis bulk -> Lua type conversion} {
         r set mykey myval
         r eval {
-            local foo = redis.pcall('get','mykey')
+            local foo = redis.pcall('get',KEYS[1])
             return {type(foo),foo}
-        } 0
+        } 1 mykey
     } {string myval}
 
     test {EVAL - Redis multi bulk -> Lua type conversion} {
@@ -82,45 +82,47 @@ start_server {tags {"scripting"}} {
         r rpush mylist b
         r rpush mylist c
         r eval {
-            local foo = redis.pcall('lrange','mylist',0,-1)
+            local foo = redis.pcall('lrange',KEYS[1],0,-1)
             return {type(foo),foo[1],foo[2],foo[3],# foo}
-        } 0
+        } 1 mylist
     } {table a b c 3}
 
     test {EVAL - Redis status reply -> Lua type conversion} {
         r eval {
-            local foo = redis.pcall('set','mykey','myval')
+            local foo = redis.pcall('set',KEYS[1],'myval')
             return {type(foo),foo['ok']}
-        } 0
+        } 1 mykey
     } {table OK}
 
     test {EVAL - Redis error reply -> Lua type conversion} {
         r set mykey myval
         r eval {
-            local foo = redis.pcall('incr','mykey')
+            local foo = redis.pcall('incr',KEYS[1])
             return {type(foo),foo['err']}
-        } 0
+        } 1 mykey
     } {table {ERR value is not an integer or out of range}}
 
     test {EVAL - Redis nil bulk reply -> Lua type conversion} {
         r del mykey
         r eval {
-            local foo = redis.pcall('get','mykey')
+            local foo = redis.pcall('get',KEYS[1])
             return {type(foo),foo == false}
-        } 0
+        } 1 mykey
     } {boolean 1}
 
     test {EVAL - Is the Lua client using the currently selected DB?} {
         r set mykey "this is DB 9"
         r select 10
         r set mykey "this is DB 10"
-        r eval {return redis.pcall('get','mykey')} 0
+        r eval {return redis.pcall('get',KEYS[1])} 1 mykey
     } {this is DB 10}
 
+    # SELECT is an admin command, which scripts may not run
     test {EVAL - SELECT inside Lua should not affect the caller} {
         # here we DB 10 is selected
         r set mykey "original value"
-        r eval {return redis.pcall('select','9')} 0
+        catch {r eval {return redis.pcall('select','9')} 0} e
+        assert_match {*not allowed from scripts*} $e
         set res [r get mykey]
         r select 9
         set res
@@ -139,19 +141,19 @@ start_server {tags {"scripting"}} {
         } {*execution time*}
     }
 
+    # A script is replicated by its effects, so it may run random commands and
+    # write after them, only the admin commands are refused
     test {EVAL - Scripts can't run certain commands} {
         set e {}
-        catch {r eval {return redis.pcall('spop','x')} 0} e
+        catch {r eval {return redis.pcall('config','get','maxmemory')} 0} e
         set e
     } {*not allowed*}
 
-    test {EVAL - Scripts can't run certain commands} {
-        set e {}
-        catch {
-            r eval "redis.pcall('randomkey'); return redis.pcall('set','x','ciao')" 0
-        } e
-        set e
-    } {*not allowed after*}
+    test {EVAL - Scripts can write after random commands} {
+        r del myset
+        r sadd myset a
+        r eval "redis.pcall('spop',KEYS[1]); return redis.pcall('set',KEYS[2],'ciao')" 2 myset x
+    } {OK}
 
     test {EVAL - No arguments to redis.call/pcall is considered an error} {
         set e {}
@@ -184,74 +186,75 @@ start_server {tags {"scripting"}} {
         set e
     } {*against a key*}
 
-    test {EVAL - JSON numeric decoding} {
-        # We must return the table as a string because otherwise
-        # Redis converts floats to ints and we get 0 and 1023 instead
-        # of 0.0003 and 1023.2 as the parsed output.
-        r eval {return
-                 table.concat(
-                   cjson.decode(
-                    "[0.0, -5e3, -1, 0.3e-3, 1023.2, 0e10]"), " ")
-        } 0
-    } {0 -5000 -1 0.0003 1023.2 0}
-
-    test {EVAL - JSON string decoding} {
-        r eval {local decoded = cjson.decode('{"keya": "a", "keyb": "b"}')
-                return {decoded.keya, decoded.keyb}
-        } 0
-    } {a b}
-
-    test {EVAL - cmsgpack can pack double?} {
-        r eval {local encoded = cmsgpack.pack(0.1)
-                local h = ""
-                for i = 1, #encoded do
-                    h = h .. string.format("%02x",string.byte(encoded,i))
-                end
-                return h
-        } 0
-    } {cb3fb999999999999a}
-
-    test {EVAL - cmsgpack can pack negative int64?} {
-        r eval {local encoded = cmsgpack.pack(-1099511627776)
-                local h = ""
-                for i = 1, #encoded do
-                    h = h .. string.format("%02x",string.byte(encoded,i))
-                end
-                return h
-        } 0
-    } {d3ffffff0000000000}
-
-    test {EVAL - cmsgpack can pack and unpack circular references?} {
-        r eval {local a = {x=nil,y=5}
-                local b = {x=a}
-                a['x'] = b
-                local encoded = cmsgpack.pack(a)
-                local h = ""
-                -- cmsgpack encodes to a depth of 16, but can't encode
-                -- references, so the encoded object has a deep copy recusive
-                -- depth of 16.
-                for i = 1, #encoded do
-                    h = h .. string.format("%02x",string.byte(encoded,i))
-                end
-                -- when unpacked, re.x.x != re because the unpack creates
-                -- individual tables down to a depth of 16.
-                -- (that's why the encoded output is so large)
-                local re = cmsgpack.unpack(encoded)
-                assert(re)
-                assert(re.x)
-                assert(re.x.x.y == re.y)
-                assert(re.x.x.x.x.y == re.y)
-                assert(re.x.x.x.x.x.x.y == re.y)
-                assert(re.x.x.x.x.x.x.x.x.x.x.y == re.y)
-                -- maximum working depth:
-                assert(re.x.x.x.x.x.x.x.x.x.x.x.x.x.x.y == re.y)
-                -- now the last x would be b above and has no y
-                assert(re.x.x.x.x.x.x.x.x.x.x.x.x.x.x.x)
-                -- so, the final x.x is at the depth limit and was assigned nil
-                assert(re.x.x.x.x.x.x.x.x.x.x.x.x.x.x.x.x == nil)
-                return {h, re.x.x.x.x.x.x.x.x.y == re.y, re.y == 5}
-        } 0
-    } {82a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a178c0 1 1}
+    # cjson and cmsgpack are not built into the lua of pika, unlike bit
+#    test {EVAL - JSON numeric decoding} {
+#        # We must return the table as a string because otherwise
+#        # Redis converts floats to ints and we get 0 and 1023 instead
+#        # of 0.0003 and 1023.2 as the parsed output.
+#        r eval {return
+#                 table.concat(
+#                   cjson.decode(
+#                    "[0.0, -5e3, -1, 0.3e-3, 1023.2, 0e10]"), " ")
+#        } 0
+#    } {0 -5000 -1 0.0003 1023.2 0}
+
+#    test {EVAL - JSON string decoding} {
+#        r eval {local decoded = cjson.decode('{"keya": "a", "keyb": "b"}')
+#                return {decoded.keya, decoded.keyb}
+#        } 0
+#    } {a b}
+
+#    test {EVAL - cmsgpack can pack double?} {
+#        r eval {local encoded = cmsgpack.pack(0.1)
+#                local h = ""
+#                for i = 1, #encoded do
+#                    h = h .. string.format("%02x",string.byte(encoded,i))
+#                end
+#                return h
+#        } 0
+#    } {cb3fb999999999999a}
+
+#    test {EVAL - cmsgpack can pack negative int64?} {
+#        r eval {local encoded = cmsgpack.pack(-1099511627776)
+#                local h = ""
+#                for i = 1, #encoded do
+#                    h = h .. string.format("%02x",string.byte(encoded,i))
+#                end
+#                return h
+#        } 0
+#    } {d3ffffff0000000000}
+
+#    test {EVAL - cmsgpack can pack and unpack circular references?} {
+#        r eval {local a = {x=nil,y=5}
+#                local b = {x=a}
+#                a['x'] = b
+#                local encoded = cmsgpack.pack(a)
+#                local h = ""
+#                -- cmsgpack encodes to a depth of 16, but can't encode
+#                -- references, so the encoded object has a deep copy recusive
+#                -- depth of 16.
+#                for i = 1, #encoded do
+#                    h = h .. string.format("%02x",string.byte(encoded,i))
+#                end
+#                -- when unpacked, re.x.x != re because the unpack creates
+#                -- individual tables down to a depth of 16.
+#                -- (that's why the encoded output is so large)
+#                local re = cmsgpack.unpack(encoded)
+#                assert(re)
+#                assert(re.x)
+#                assert(re.x.x.y == re.y)
+#                assert(re.x.x.x.x.y == re.y)
+#                assert(re.x.x.x.x.x.x.y == re.y)
+#                assert(re.x.x.x.x.x.x.x.x.x.x.y == re.y)
+#                -- maximum working depth:
+#                assert(re.x.x.x.x.x.x.x.x.x.x.x.x.x.x.y == re.y)
+#                -- now the last x would be b above and has no y
+#                assert(re.x.x.x.x.x.x.x.x.x.x.x.x.x.x.x)
+#                -- so, the final x.x is at the depth limit and was assigned nil
+#                assert(re.x.x.x.x.x.x.x.x.x.x.x.x.x.x.x.x == nil)
+#                return {h, re.x.x.x.x.x.x.x.x.y == re.y, re.y == 5}
+#        } 0
+#    } {82a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a17882a17905a17881a178c0 1 1}
 
     test {EVAL - Numerical sanity check from bitop} {
         r eval {assert(0x7fffffff == 2147483647, "broken hex literals");
@@ -299,23 +302,24 @@ start_server {tags {"scripting"}} {
         r eval {return redis.call('smembers',KEYS[1])} 1 myset
     } {a aa aaa azz b c d e f g h i l m n o p q r s t u v z}
 
-    test "SORT is normally not alpha re-ordered for the scripting engine" {
-        r del myset
-        r sadd myset 1 2 3 4 10
-        r eval {return redis.call('sort',KEYS[1],'desc')} 1 myset
-    } {10 4 3 2 1}
-
-    test "SORT BY <constant> output gets ordered for scripting" {
-        r del myset
-        r sadd myset a b c d e f g h i l m n o p q r s t u v z aa aaa azz
-        r eval {return redis.call('sort',KEYS[1],'by','_')} 1 myset
-    } {a aa aaa azz b c d e f g h i l m n o p q r s t u v z}
-
-    test "SORT BY <constant> with GET gets ordered for scripting" {
-        r del myset
-        r sadd myset a b c
-        r eval {return redis.call('sort',KEYS[1],'by','_','get','#','get','_:*')} 1 myset
-    } {a {} b {} c {}}
+    # pika has no SORT
+#    test "SORT is normally not alpha re-ordered for the scripting engine" {
+#        r del myset
+#        r sadd myset 1 2 3 4 10
+#        r eval {return redis.call('sort',KEYS[1],'desc')} 1 myset
+#    } {10 4 3 2 1}
+
+#    test "SORT BY <constant> output gets ordered for scripting" {
+#        r del myset
+#        r sadd myset a b c d e f g h i l m n o p q r s t u v z aa aaa azz
+#        r eval {return redis.call('sort',KEYS[1],'by','_')} 1 myset
+#    } {a aa aaa azz b c d e f g h i l m n o p q r s t u v z}
+
+#    test "SORT BY <constant> with GET gets ordered for scripting" {
+#        r del myset
+#        r sadd myset a b c
+#        r eval {return redis.call('sort',KEYS[1],'by','_','get','#','get','_:*')} 1 myset
+#    } {a {} b {} c {}}
 
     test "redis.sha1hex() implementation" {
         list [r eval {return redis.sha1hex('')} 0] \
@@ -389,24 +393,25 @@ start_server {tags {"scripting"}} {
         r get x
     } {10000}
 
-    test {EVAL processes writes from AOF in read-only slaves} {
-        r flushall
-        r config set appendonly yes
-        r eval {redis.call("set",KEYS[1],"100")} 1 foo
-        r eval {redis.call("incr",KEYS[1])} 1 foo
-        r eval {redis.call("incr",KEYS[1])} 1 foo
-        wait_for_condition 50 100 {
-            [s aof_rewrite_in_progress] == 0
-        } else {
-            fail "AOF rewrite can't complete after CONFIG SET appendonly yes."
-        }
-        r config set slave-read-only yes
-        r slaveof 127.0.0.1 0
-        r debug loadaof
-        set res [r get foo]
-        r slaveof no one
-        set res
-    } {102}
+    # pika has no AOF
+#    test {EVAL processes writes from AOF in read-only slaves} {
+#        r flushall
+#        r config set appendonly yes
+#        r eval {redis.call("set",KEYS[1],"100")} 1 foo
+#        r eval {redis.call("incr",KEYS[1])} 1 foo
+#        r eval {redis.call("incr",KEYS[1])} 1 foo
+#        wait_for_condition 50 100 {
+#            [s aof_rewrite_in_progress] == 0
+#        } else {
+#            fail "AOF rewrite can't complete after CONFIG SET appendonly yes."
+#        }
+#        r config set slave-read-only yes
+#        r slaveof 127.0.0.1 0
+#        r debug loadaof
+#        set res [r get foo]
+#        r slaveof no one
+#        set res
+#    } {102}
 
     test {We can call scripts rewriting client->argv from Lua} {
         r del myset
@@ -423,28 +428,28 @@ start_server {tags {"scripting"}} {
         r eval {
             local i
             local x={}
-            redis.call('del','mylist')
+            redis.call('del',KEYS[1])
             for i=1,100 do
                 table.insert(x,i)
             end
-            redis.call('rpush','mylist',unpack(x))
-            return redis.call('lrange','mylist',0,-1)
-        } 0
+            redis.call('rpush',KEYS[1],unpack(x))
+            return redis.call('lrange',KEYS[1],0,-1)
+        } 1 mylist
     } {1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47 48 49 50 51 52 53 54 55 56 57 58 59 60 61 62 63 64 65 66 67 68 69 70 71 72 73 74 75 76 77 78 79 80 81 82 83 84 85 86 87 88 89 90 91 92 93 94 95 96 97 98 99 100}
 
     test {Number conversion precision test (issue #1118)} {
         r eval {
               local value = 9007199254740991
-              redis.call("set","foo",value)
-              return redis.call("get","foo")
-        } 0
+              redis.call("set",KEYS[1],value)
+              return redis.call("get",KEYS[1])
+        } 1 foo
     } {9007199254740991}
 
     test {String containing number precision test (regression of issue #1118)} {
         r eval {
-            redis.call("set", "key", "12039611435714932082")
-            return redis.call("get", "key")
-        } 0
+            redis.call("set", KEYS[1], "12039611435714932082")
+            return redis.call("get", KEYS[1])
+        } 1 key
     } {12039611435714932082}
 
     test {Verify negative arg count is error instead of crash (issue #1842)} {
@@ -455,30 +460,34 @@ start_server {tags {"scripting"}} {
     test {Correct handling of reused argv (issue #1939)} {
         r eval {
               for i = 0, 10 do
-                  redis.call('SET', 'a', '1')
-                  redis.call('MGET', 'a', 'b', 'c')
-                  redis.call('EXPIRE', 'a', 0)
-                  redis.call('GET', 'a')
-                  redis.call('MGET', 'a', 'b', 'c')
+                  redis.call('SET', KEYS[1], '1')
+                  redis.call('MGET', KEYS[1], KEYS[2], KEYS[3])
+                  redis.call('EXPIRE', KEYS[1], 0)
+                  redis.call('GET', KEYS[1])
+                  redis.call('MGET', KEYS[1], KEYS[2], KEYS[3])
               end
-        } 0
+        } 3 a b c
     }
 }
 
-# Start a new server since the last test in this stanza will kill the
-# instance at all.
 start_server {tags {"scripting"}} {
+    test {SCRIPT KILL with no script running} {
+        catch {r script kill} e
+        set e
+    } {NOTBUSY*}
+
+    # the other clients are not blocked by a timedout script, so no BUSY
     test {Timedout read-only scripts can be killed by SCRIPT KILL} {
         set rd [redis_deferring_client]
         r config set lua-time-limit 10
         $rd eval {while true do end} 0
         after 200
-        catch {r ping} e
-        assert_match {BUSY*} $e
-        r script kill
-        after 200 ; # Give some time to Lua to call the hook again...
         assert_equal [r ping] "PONG"
-    }
+        r script kill
+        catch {$rd read} e
+        $rd close
+        set e
+    } {*Script killed by user*}
 
     test {Timedout script link is still usable after Lua returns} {
         r config set lua-time-limit 10
@@ -489,31 +498,37 @@ start_server {tags {"scripting"}} {
     test {Timedout scripts that modified data can't be killed by SCRIPT KILL} {
         set rd [redis_deferring_client]
         r config set lua-time-limit 10
-        $rd eval {redis.call('set',KEYS[1],'y'); while true do end} 1 x
+        $rd eval {redis.call('set',KEYS[1],'y'); for i=1,300000000 do end return 1} 1 x
         after 200
-        catch {r ping} e
-        assert_match {BUSY*} $e
         catch {r script kill} e
         assert_match {UNKILLABLE*} $e
-        catch {r ping} e
-        assert_match {BUSY*} $e
-    }
-
-    # Note: keep this test at the end of this server stanza because it
-    # kills the server.
-    test {SHUTDOWN NOSAVE can kill a timedout script anyway} {
-        # The server sould be still unresponding to normal commands.
-        catch {r ping} e
-        assert_match {BUSY*} $e
-        catch {r shutdown nosave}
-        # Make sure the server was killed
-        catch {set rd [redis_deferring_client]} e
-        assert_match {*connection refused*} $e
-    }
+        assert_equal 1 [$rd read]
+        $rd close
+        r config set lua-time-limit 5000
+        r get x
+    } {y}
 }
 
+# A timedout script does not make the other clients BUSY, and SHUTDOWN
+# NOSAVE is not expected to stop it
+#start_server {tags {"scripting"}} {
+#    # Note: keep this test at the end of this server stanza because it
+#    # kills the server.
+#    test {SHUTDOWN NOSAVE can kill a timedout script anyway} {
+#        # The server sould be still unresponding to normal commands.
+#        catch {r ping} e
+#        assert_match {BUSY*} $e
+#        catch {r shutdown nosave}
+#        # Make sure the server was killed
+#        catch {set rd [redis_deferring_client]} e
+#        assert_match {*connection refused*} $e
+#    }
+#}
+
 start_server {tags {"scripting repl"}} {
     start_server {} {
+        # A script that fails writes nothing, so the first script leaves x
+        # alone, on the master as on the slave
         test {Before the slave connects we issue two EVAL commands} {
             # One with an error, but still executing a command.
             # SHA is: 67164fc43fa971f76fd1aaeeaf60c1c178d25876
@@ -523,7 +538,7 @@ start_server {tags {"scripting repl"}} {
             # One command is correct:
             # SHA is: 6f5ade10a69975e903c6d07b10ea44c6382381a5
             r eval {return redis.call('incr',KEYS[1])} 1 x
-        } {2}
+        } {1}
 
         test {Connect a slave to the main instance} {
             r -1 slaveof [srv 0 host] [srv 0 port]
@@ -542,13 +557,13 @@ start_server {tags {"scripting repl"}} {
                 r evalsha 67164fc43fa971f76fd1aaeeaf60c1c178d25876 1 x
             }
             r evalsha 6f5ade10a69975e903c6d07b10ea44c6382381a5 1 x
-        } {4}
+        } {2}
 
-        test {If EVALSHA was replicated as EVAL, 'x' should be '4'} {
+        test {If EVALSHA was replicated as EVAL, 'x' should be '2'} {
             wait_for_condition 50 100 {
-                [r -1 get x] eq {4}
+                [r -1 get x] eq {2}
             } else {
-                fail "Expected 4 in x, but value is '[r -1 get x]'"
+                fail "Expected 2 in x, but value is '[r -1 get x]'"
             }
         }
 
@@ -581,25 +596,22 @@ start_server {tags {"scripting repl"}} {
             }
         }
 
-        test {Lua scripts using SELECT are replicated correctly} {
+        # SELECT is refused in scripts, a script writes the keys of its db
+        test {Lua scripts writing several keys are replicated correctly} {
             r eval {
-                redis.call("set","foo1","bar1")
-                redis.call("select","10")
-                redis.call("incr","x")
-                redis.call("select","11")
-                redis.call("incr","z")
-            } 0
+                redis.call("set",KEYS[1],"bar1")
+                redis.call("incr",KEYS[2])
+                redis.call("incr",KEYS[3])
+            } 3 foo1 x z
             r eval {
-                redis.call("set","foo1","bar1")
-                redis.call("select","10")
-                redis.call("incr","x")
-                redis.call("select","11")
-                redis.call("incr","z")
-            } 0
+                redis.call("set",KEYS[1],"bar1")
+                redis.call("incr",KEYS[2])
+                redis.call("incr",KEYS[3])
+            } 3 foo1 x z
             wait_for_condition 50 100 {
-                [r -1 debug digest] eq [r debug digest]
+                [r -1 mget foo1 x z] eq [r mget foo1 x z]
             } else {
-                fail "Master-Slave desync after Lua script using SELECT."
+                fail "Master-Slave desync after Lua script writing several keys."
             }
         }
     }
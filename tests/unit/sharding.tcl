@@ -0,0 +1,72 @@
+start_server {tags {"sharding"} overrides {db-shard-num 4}} {
+    test {Single key commands run on the shard of their key} {
+        r flushdb
+        for {set i 0} {$i < 100} {incr i} {
+            r set key:$i $i
+            r lpush list:$i $i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal [r get key:$i] $i
+            assert_equal [r llen list:$i] 1
+        }
+        llength [r keys *]
+    } {200}
+
+    test {MSET, MGET, EXISTS and DEL span the shards} {
+        r flushdb
+        set args {}
+        set keys {}
+        for {set i 0} {$i < 50} {incr i} {
+            lappend args k$i v$i
+            lappend keys k$i
+        }
+        r mset {*}$args
+        set values [r mget {*}$keys nokey]
+        assert_equal [lindex $values 0] v0
+        assert_equal [lindex $values 49] v49
+        assert_equal [lindex $values 50] {}
+        assert_equal [r exists {*}$keys nokey] 50
+        assert_equal [r del {*}$keys nokey] 50
+        r exists {*}$keys
+    } {0}
+
+    test {KEYS and SCAN see the keys of every shard} {
+        r flushdb
+        for {set i 0} {$i < 200} {incr i} {
+            r set key:$i $i
+        }
+        assert_equal [llength [r keys *]] 200
+        set cur 0
+        set keys {}
+        while 1 {
+            set res [r scan $cur count 10]
+            set cur [lindex $res 0]
+            lappend keys {*}[lindex $res 1]
+            if {$cur == 0} break
+        }
+        llength [lsort -unique $keys]
+    } {200}
+
+    test {Keys with the same hash tag go to the same shard} {
+        r flushdb
+        r sadd {user1}:a x y
+        r sadd {user1}:b y z
+        r sunionstore {user1}:c {user1}:a {user1}:b
+        lsort [r smembers {user1}:c]
+    } {x y z}
+
+    test {Commands whose keys span shards are refused} {
+        set err {}
+        for {set i 0} {$i < 20 && $err eq {}} {incr i} {
+            r sadd a$i x
+            r sadd b$i y
+            catch {r sunionstore a$i a$i b$i} err
+            if {![string match *CROSSSLOT* $err]} {set err {}}
+        }
+        assert_match {*CROSSSLOT*} $err
+    }
+
+    test {PURGELOGSTO purges the binlog of every shard} {
+        r purgelogsto write2file0
+    } {OK}
+}
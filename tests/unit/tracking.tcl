@@ -0,0 +1,145 @@
+start_server {tags {"tracking"}} {
+    test {The keys read are told once when written} {
+        r flushdb
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on
+        assert_equal OK [$rd read]
+        $rd get key1
+        $rd read
+        r set key1 1
+        assert_equal {invalidate key1} [$rd read]
+        # read again to be told again
+        r set key1 2
+        $rd ping
+        assert_equal PONG [$rd read]
+        $rd get key1
+        assert_equal 2 [$rd read]
+        r del key1
+        set reply [$rd read]
+        $rd close
+        set reply
+    } {invalidate key1}
+
+    test {The writes of the client itself are not told with NOLOOP} {
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on noloop
+        $rd read
+        $rd get key2
+        $rd read
+        $rd set key2 v
+        assert_equal OK [$rd read]
+        $rd ping
+        set reply [$rd read]
+        $rd close
+        set reply
+    } {PONG}
+
+    test {BCAST tells every key written with the prefixes} {
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on bcast prefix a: prefix b:
+        $rd read
+        r set a:1 x
+        r set c:1 y
+        r set b:1 z
+        assert_equal {invalidate a:1} [$rd read]
+        assert_equal {invalidate b:1} [$rd read]
+        $rd close
+    }
+
+    test {PREFIX without BCAST is refused} {
+        catch {r client tracking on prefix a:} err
+        set err
+    } {*BCAST*}
+
+    test {The messages go to the connection redirected to} {
+        set rd [redis_deferring_client]
+        $rd client id
+        set id [$rd read]
+        $rd subscribe __redis__:invalidate
+        $rd read
+        r client tracking on redirect $id
+        r get key3
+        r set key3 v
+        assert_equal {message __redis__:invalidate key3} [$rd read]
+        r client tracking off
+        $rd close
+    }
+
+    test {The messages are not mixed into the replies of a pipelined client} {
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on bcast prefix pipe:
+        $rd read
+        for {set j 0} {$j < 1000} {incr j} {
+            $rd get pipe:key
+            r set pipe:key $j
+        }
+        set pushes 0
+        set replies 0
+        for {set j 0} {$j < 2000} {incr j} {
+            set reply [$rd read]
+            if {[lindex $reply 0] eq {invalidate}} {
+                assert_equal {invalidate pipe:key} $reply
+                incr pushes
+            } else {
+                assert {$reply eq {} || [string is integer $reply]}
+                incr replies
+            }
+        }
+        $rd close
+        list $pushes $replies
+    } {1000 1000}
+
+    test {FLUSHDB tells the clients to drop every key} {
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on
+        $rd read
+        $rd get key4
+        $rd read
+        r flushdb
+        set reply [$rd read]
+        $rd close
+        set reply
+    } {invalidate {}}
+
+    test {Keys past tracking-table-max-keys are told and dropped} {
+        r config set tracking-table-max-keys 1
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on
+        $rd read
+        $rd get key5
+        $rd read
+        $rd get key6
+        # one of the two keys is told, before or after the reply to the read
+        set replies [list [$rd read] [$rd read]]
+        r config set tracking-table-max-keys 1000000
+        $rd close
+        lsearch -inline -glob $replies {invalidate key*}
+    } {invalidate key*}
+
+    test {Keys removed by the expire reaper are told} {
+        set rd [redis_deferring_client]
+        $rd hello 3
+        $rd read
+        $rd client tracking on
+        $rd read
+        r set key7 v ex 1
+        $rd get key7
+        assert_equal v [$rd read]
+        # told without being read again
+        set reply [$rd read]
+        $rd close
+        set reply
+    } {invalidate key7}
+}
@@ -457,6 +457,87 @@ start_server {tags {"hash"}} {
         }
     }
 
+    test {HEXPIRE/HEXPIREAT/HTTL/HPERSIST - Wrong arguments} {
+        r del myhash
+        r hset myhash f1 v1
+        assert_error "*syntax*" {r hexpire myhash 100 FIELD 1 f1}
+        assert_error "*syntax*" {r hexpire myhash 100 FIELDS 2 f1}
+        assert_error "*syntax*" {r hexpire myhash 100 FIELDS 0 f1}
+        assert_error "*syntax*" {r hexpireat myhash 100 FIELDS -1 f1}
+        assert_error "*syntax*" {r httl myhash FIELDS 1 f1 f2}
+        assert_error "*syntax*" {r hpersist myhash FIELDS abc f1}
+        assert_error "*not an integer*" {r hexpire myhash abc FIELDS 1 f1}
+        assert_error "*invalid expire time*" {r hexpire myhash -1 FIELDS 1 f1}
+        assert_error "*invalid expire time*" {r hexpireat myhash -1 FIELDS 1 f1}
+        assert_error "*wrong number*" {r hexpire myhash 100 FIELDS}
+        assert_error "*wrong number*" {r httl myhash FIELDS 1}
+        r httl myhash FIELDS 1 f1
+    } {-1}
+
+    test {HEXPIRE/HTTL - Non existing key and fields} {
+        r del myhash
+        assert_equal {-2 -2} [r hexpire myhash 100 FIELDS 2 f1 f2]
+        assert_equal {-2} [r httl myhash FIELDS 1 f1]
+        r hset myhash f1 v1
+        list [r hexpire myhash 100 FIELDS 2 f1 nofield] [r hpersist myhash FIELDS 1 nofield]
+    } {{1 -2} -2}
+
+    test {HEXPIRE - Expired fields are gone from the replies} {
+        r del myhash
+        r hmset myhash f1 v1 f2 v2 f3 v3
+        assert_equal {1 1 -2} [r hexpire myhash 1 FIELDS 3 f1 f2 nofield]
+        assert_equal {-1} [r httl myhash FIELDS 1 f3]
+        after 2100
+        list [r hget myhash f1] [r hexists myhash f2] [r hstrlen myhash f1] [r hmget myhash f1 f2 f3] \
+             [r hkeys myhash] [r hvals myhash] [r hgetall myhash] [r httl myhash FIELDS 2 f1 f3] \
+             [r hexpire myhash 100 FIELDS 1 f1] [r hpersist myhash FIELDS 1 f2]
+    } {{} 0 0 {{} {} v3} f3 v3 {f3 v3} {-2 -1} -2 -2}
+
+    test {HEXPIRE - Expired fields are written again as new ones} {
+        r del myhash
+        r hmset myhash f1 v1 f2 2 f3 v3
+        r hexpire myhash 1 FIELDS 3 f1 f2 f3
+        after 2100
+        list [r hset myhash f1 v11] [r hincrby myhash f2 1] [r hsetnx myhash f3 v33] [r hdel myhash f1 f3] \
+             [r hgetall myhash] [r httl myhash FIELDS 1 f2]
+    } {1 1 1 2 {f2 1} -1}
+
+    test {HEXPIRE - A field set again or persisted lives for ever} {
+        r del myhash
+        r hmset myhash f1 v1 f2 v2 f3 3
+        assert_equal {1 1 1} [r hexpire myhash 100 FIELDS 3 f1 f2 f3]
+        r hset myhash f1 v11
+        assert_equal {1 -1 -2} [r hpersist myhash FIELDS 3 f2 f1 nofield]
+        # but one incremented keeps its expire
+        assert_equal 4 [r hincrby myhash f3 1]
+        set ttl [lindex [r httl myhash FIELDS 1 f3] 0]
+        assert {$ttl > 90 && $ttl <= 100}
+        r httl myhash FIELDS 2 f1 f2
+    } {-1 -1}
+
+    test {HEXPIRE - A ttl of 0 deletes the fields, and the hash with the last one} {
+        r del myhash
+        r hmset myhash f1 v1 f2 v2
+        assert_equal {2 -2} [r hexpire myhash 0 FIELDS 2 f1 nofield]
+        assert_equal 1 [r hlen myhash]
+        assert_equal {2} [r hexpireat myhash 1 FIELDS 1 f2]
+        list [r exists myhash] [r httl myhash FIELDS 1 f2]
+    } {0 -2}
+
+    test {HEXPIRE - Writes to a big hash with expiring fields go on} {
+        r del myhash
+        for {set i 0} {$i < 600} {incr i} {
+            r hset myhash f$i v$i
+        }
+        assert_equal {1} [r hexpire myhash 100 FIELDS 1 f0]
+        r hset myhash f600 v600
+        r hmset myhash f601 v601 f602 [string repeat x 2000]
+        r hincrby myhash counter 1
+        set ttl [lindex [r httl myhash FIELDS 1 f0] 0]
+        assert {$ttl > 90 && $ttl <= 100}
+        list [r hlen myhash] [r hstrlen myhash f602] [r hget myhash f0]
+    } {604 2000 v0}
+
 #    test {Stress test the hash ziplist -> hashtable encoding conversion} {
 #        r config set hash-max-ziplist-entries 32
 #        for {set j 0} {$j < 100} {incr j} {
@@ -468,3 +549,33 @@ start_server {tags {"hash"}} {
 #        }
 #    }
 }
+
+start_server {tags {"hash repl"}} {
+    start_server {} {
+        test {Connect a slave to the main instance} {
+            r -1 slaveof [srv 0 host] [srv 0 port]
+            wait_for_condition 50 100 {
+                [s -1 role] eq {slave} &&
+                [string match {*master_link_status:up*} [r -1 info replication]]
+            } else {
+                fail "Can't turn the instance into a slave"
+            }
+        }
+
+        test {HEXPIRE is propagated as HEXPIREAT with the same fields} {
+            r del myhash
+            r hmset myhash f1 v1 f2 v2 f3 v3
+            r hexpire myhash 100 FIELDS 2 f1 f2
+            r hpersist myhash FIELDS 1 f2
+            r hexpire myhash 0 FIELDS 1 f3
+            wait_for_condition 50 100 {
+                [r -1 hlen myhash] == 2 && [lindex [r -1 httl myhash FIELDS 1 f2] 0] == -1
+            } else {
+                fail "Field expires not propagated, [r -1 hgetall myhash]"
+            }
+            set ttl [lindex [r -1 httl myhash FIELDS 1 f1] 0]
+            assert {$ttl > 90 && $ttl <= 100}
+            r -1 hgetall myhash
+        } {f1 v1 f2 v2}
+    }
+}
@@ -98,165 +98,211 @@ start_server {
 #        assert_encoding linkedlist $key
     }
 
-#    foreach {type large} [array get largevalue] {
-#        test "BLPOP, BRPOP: single existing list - $type" {
-#            set rd [redis_deferring_client]
-#            create_$type blist "a b $large c d"
-#
-#            $rd blpop blist 1
-#            assert_equal {blist a} [$rd read]
-#            $rd brpop blist 1
-#            assert_equal {blist d} [$rd read]
-#
-#            $rd blpop blist 1
-#            assert_equal {blist b} [$rd read]
-#            $rd brpop blist 1
-#            assert_equal {blist c} [$rd read]
-#        }
-#
-#        test "BLPOP, BRPOP: multiple existing lists - $type" {
-#            set rd [redis_deferring_client]
-#            create_$type blist1 "a $large c"
-#            create_$type blist2 "d $large f"
-#
-#            $rd blpop blist1 blist2 1
-#            assert_equal {blist1 a} [$rd read]
-#            $rd brpop blist1 blist2 1
-#            assert_equal {blist1 c} [$rd read]
-#            assert_equal 1 [r llen blist1]
-#            assert_equal 3 [r llen blist2]
-#
-#            $rd blpop blist2 blist1 1
-#            assert_equal {blist2 d} [$rd read]
-#            $rd brpop blist2 blist1 1
-#            assert_equal {blist2 f} [$rd read]
-#            assert_equal 1 [r llen blist1]
-#            assert_equal 1 [r llen blist2]
-#        }
-#
-#        test "BLPOP, BRPOP: second list has an entry - $type" {
-#            set rd [redis_deferring_client]
-#            r del blist1
-#            create_$type blist2 "d $large f"
-#
-#            $rd blpop blist1 blist2 1
-#            assert_equal {blist2 d} [$rd read]
-#            $rd brpop blist1 blist2 1
-#            assert_equal {blist2 f} [$rd read]
-#            assert_equal 0 [r llen blist1]
-#            assert_equal 1 [r llen blist2]
-#        }
-#
-#        test "BRPOPLPUSH - $type" {
-#            r del target
-#
-#            set rd [redis_deferring_client]
-#            create_$type blist "a b $large c d"
-#
-#            $rd brpoplpush blist target 1
-#            assert_equal d [$rd read]
-#
-#            assert_equal d [r rpop target]
-#            assert_equal "a b $large c" [r lrange blist 0 -1]
-#        }
-#    }
-#
-#    test "BLPOP, LPUSH + DEL should not awake blocked client" {
-#        set rd [redis_deferring_client]
-#        r del list
-#
-#        $rd blpop list 0
-#        r multi
-#        r lpush list a
-#        r del list
-#        r exec
-#        r del list
-#        r lpush list b
-#        $rd read
-#    } {list b}
-#
-#    test "BLPOP, LPUSH + DEL + SET should not awake blocked client" {
-#        set rd [redis_deferring_client]
-#        r del list
-#
-#        $rd blpop list 0
-#        r multi
-#        r lpush list a
-#        r del list
-#        r set list foo
-#        r exec
-#        r del list
-#        r lpush list b
-#        $rd read
-#    } {list b}
+    foreach {type large} [array get largevalue] {
+        test "BLPOP, BRPOP: single existing list - $type" {
+            set rd [redis_deferring_client]
+            create_$type blist "a b $large c d"
+
+            $rd blpop blist 1
+            assert_equal {blist a} [$rd read]
+            $rd brpop blist 1
+            assert_equal {blist d} [$rd read]
+
+            $rd blpop blist 1
+            assert_equal {blist b} [$rd read]
+            $rd brpop blist 1
+            assert_equal {blist c} [$rd read]
+        }
+
+        test "BLPOP, BRPOP: multiple existing lists - $type" {
+            set rd [redis_deferring_client]
+            create_$type blist1 "a $large c"
+            create_$type blist2 "d $large f"
+
+            $rd blpop blist1 blist2 1
+            assert_equal {blist1 a} [$rd read]
+            $rd brpop blist1 blist2 1
+            assert_equal {blist1 c} [$rd read]
+            assert_equal 1 [r llen blist1]
+            assert_equal 3 [r llen blist2]
+
+            $rd blpop blist2 blist1 1
+            assert_equal {blist2 d} [$rd read]
+            $rd brpop blist2 blist1 1
+            assert_equal {blist2 f} [$rd read]
+            assert_equal 1 [r llen blist1]
+            assert_equal 1 [r llen blist2]
+        }
+
+        test "BLPOP, BRPOP: second list has an entry - $type" {
+            set rd [redis_deferring_client]
+            r del blist1
+            create_$type blist2 "d $large f"
+
+            $rd blpop blist1 blist2 1
+            assert_equal {blist2 d} [$rd read]
+            $rd brpop blist1 blist2 1
+            assert_equal {blist2 f} [$rd read]
+            assert_equal 0 [r llen blist1]
+            assert_equal 1 [r llen blist2]
+        }
+
+        test "BRPOPLPUSH - $type" {
+            r del target
+
+            set rd [redis_deferring_client]
+            create_$type blist "a b $large c d"
+
+            $rd brpoplpush blist target 1
+            assert_equal d [$rd read]
+
+            assert_equal d [r rpop target]
+            assert_equal "a b $large c" [r lrange blist 0 -1]
+        }
+    }
 #
-#    test "BLPOP with same key multiple times should work (issue #801)" {
-#        set rd [redis_deferring_client]
-#        r del list1 list2
-#
-#        # Data arriving after the BLPOP.
-#        $rd blpop list1 list2 list2 list1 0
-#        r lpush list1 a
-#        assert_equal [$rd read] {list1 a}
-#        $rd blpop list1 list2 list2 list1 0
-#        r lpush list2 b
-#        assert_equal [$rd read] {list2 b}
-#
-#        # Data already there.
-#        r lpush list1 a
-#        r lpush list2 b
-#        $rd blpop list1 list2 list2 list1 0
-#        assert_equal [$rd read] {list1 a}
-#        $rd blpop list1 list2 list2 list1 0
-#        assert_equal [$rd read] {list2 b}
-#    }
+    test "BLPOP, LPUSH + DEL should not awake blocked client" {
+        set rd [redis_deferring_client]
+        r del list
+
+        $rd blpop list 0
+        r multi
+        r lpush list a
+        r del list
+        r exec
+        r del list
+        r lpush list b
+        $rd read
+    } {list b}
+#
+    test "BLPOP, LPUSH + DEL + SET should not awake blocked client" {
+        set rd [redis_deferring_client]
+        r del list
+
+        $rd blpop list 0
+        r multi
+        r lpush list a
+        r del list
+        r set list foo
+        r exec
+        r del list
+        r lpush list b
+        $rd read
+    } {list b}
+#
+    test "BLPOP with same key multiple times should work (issue #801)" {
+        set rd [redis_deferring_client]
+        r del list1 list2
+
+        # Data arriving after the BLPOP.
+        $rd blpop list1 list2 list2 list1 0
+        r lpush list1 a
+        assert_equal [$rd read] {list1 a}
+        $rd blpop list1 list2 list2 list1 0
+        r lpush list2 b
+        assert_equal [$rd read] {list2 b}
+
+        # Data already there.
+        r lpush list1 a
+        r lpush list2 b
+        $rd blpop list1 list2 list2 list1 0
+        assert_equal [$rd read] {list1 a}
+        $rd blpop list1 list2 list2 list1 0
+        assert_equal [$rd read] {list2 b}
+    }
 #
-#    test "MULTI/EXEC is isolated from the point of view of BLPOP" {
-#        set rd [redis_deferring_client]
-#        r del list
-#        $rd blpop list 0
-#        r multi
-#        r lpush list a
-#        r lpush list b
-#        r lpush list c
-#        r exec
-#        $rd read
-#    } {list c}
+    test "MULTI/EXEC is isolated from the point of view of BLPOP" {
+        set rd [redis_deferring_client]
+        r del list
+        $rd blpop list 0
+        r multi
+        r lpush list a
+        r lpush list b
+        r lpush list c
+        r exec
+        $rd read
+    } {list c}
+#
+    test "BLPOP with variadic LPUSH" {
+        set rd [redis_deferring_client]
+        r del blist target
+        if {$::valgrind} {after 100}
+        $rd blpop blist 0
+        if {$::valgrind} {after 100}
+        assert_equal 2 [r lpush blist foo bar]
+        if {$::valgrind} {after 100}
+        assert_equal {blist bar} [$rd read]
+        assert_equal foo [lindex [r lrange blist 0 -1] 0]
+    }
 #
-#    test "BLPOP with variadic LPUSH" {
-#        set rd [redis_deferring_client]
-#        r del blist target
-#        if {$::valgrind} {after 100}
-#        $rd blpop blist 0
-#        if {$::valgrind} {after 100}
-#        assert_equal 2 [r lpush blist foo bar]
-#        if {$::valgrind} {after 100}
-#        assert_equal {blist bar} [$rd read]
-#        assert_equal foo [lindex [r lrange blist 0 -1] 0]
-#    }
+    test "BLPOP of a closed client does not take the pushed element" {
+        set rd [redis_deferring_client]
+        r del blist
+        $rd blpop blist 0
+        after 100
+        $rd close
+        # the worker of the client drops it when it sees the close
+        after 200
+        r lpush blist foo
+        after 100
+        assert_equal {foo} [r lrange blist 0 -1]
+    }
 #
-#    test "BRPOPLPUSH with zero timeout should block indefinitely" {
-#        set rd [redis_deferring_client]
-#        r del blist target
-#        $rd brpoplpush blist target 0
-#        after 1000
-#        r rpush blist foo
-#        assert_equal foo [$rd read]
-#        assert_equal {foo} [r lrange target 0 -1]
-#    }
+    test "BLPOP clients closed while a push is served lose no element" {
+        r del blist
+        set fds {}
+        for {set j 0} {$j < 20} {incr j} {
+            set fd [socket [srv 0 host] [srv 0 port]]
+            fconfigure $fd -translation binary
+            puts -nonewline $fd "*3\r\n\$5\r\nBLPOP\r\n\$5\r\nblist\r\n\$1\r\n0\r\n"
+            flush $fd
+            lappend fds $fd
+        }
+        after 100
+        # half of them close while the elements are pushed and served, they
+        # still read what was sent to them before the close
+        for {set j 0} {$j < 20} {incr j} {
+            if {$j % 2 == 0} {
+                close [lindex $fds $j] write
+            }
+            r rpush blist $j
+        }
+        after 200
+        set served 0
+        for {set j 0} {$j < 20} {incr j} {
+            set fd [lindex $fds $j]
+            if {$j % 2 != 0} {
+                fconfigure $fd -blocking 0
+            }
+            incr served [regexp -all {blist} [read $fd]]
+            close $fd
+        }
+        # an element is with a client or still in the list
+        expr {$served + [r llen blist]}
+    } {20}
+#
+    test "BRPOPLPUSH with zero timeout should block indefinitely" {
+        set rd [redis_deferring_client]
+        r del blist target
+        $rd brpoplpush blist target 0
+        after 1000
+        r rpush blist foo
+        assert_equal foo [$rd read]
+        assert_equal {foo} [r lrange target 0 -1]
+    }
 #
-#    test "BRPOPLPUSH with a client BLPOPing the target list" {
-#        set rd [redis_deferring_client]
-#        set rd2 [redis_deferring_client]
-#        r del blist target
-#        $rd2 blpop target 0
-#        $rd brpoplpush blist target 0
-#        after 1000
-#        r rpush blist foo
-#        assert_equal foo [$rd read]
-#        assert_equal {target foo} [$rd2 read]
-#        assert_equal 0 [r exists target]
-#    }
+    test "BRPOPLPUSH with a client BLPOPing the target list" {
+        set rd [redis_deferring_client]
+        set rd2 [redis_deferring_client]
+        r del blist target
+        $rd2 blpop target 0
+        $rd brpoplpush blist target 0
+        after 1000
+        r rpush blist foo
+        assert_equal foo [$rd read]
+        assert_equal {target foo} [$rd2 read]
+        assert_equal 0 [r exists target]
+    }
 #
 #    test "BRPOPLPUSH with wrong source type" {
 #        set rd [redis_deferring_client]
@@ -308,105 +354,105 @@ start_server {
 #        assert_equal {foo} [r lrange target2 0 -1]
 #    }
 #
-#    test "Linked BRPOPLPUSH" {
-#      set rd1 [redis_deferring_client]
-#      set rd2 [redis_deferring_client]
-#
-#      r del list1 list2 list3
-#
-#      $rd1 brpoplpush list1 list2 0
-#      $rd2 brpoplpush list2 list3 0
-#
-#      r rpush list1 foo
-#
-#      assert_equal {} [r lrange list1 0 -1]
-#      assert_equal {} [r lrange list2 0 -1]
-#      assert_equal {foo} [r lrange list3 0 -1]
-#    }
-#
-#    test "Circular BRPOPLPUSH" {
-#      set rd1 [redis_deferring_client]
-#      set rd2 [redis_deferring_client]
-#
-#      r del list1 list2
-#
-#      $rd1 brpoplpush list1 list2 0
-#      $rd2 brpoplpush list2 list1 0
-#
-#      r rpush list1 foo
-#
-#      assert_equal {foo} [r lrange list1 0 -1]
-#      assert_equal {} [r lrange list2 0 -1]
-#    }
-#
-#    test "Self-referential BRPOPLPUSH" {
-#      set rd [redis_deferring_client]
-#
-#      r del blist
+    test "Linked BRPOPLPUSH" {
+      set rd1 [redis_deferring_client]
+      set rd2 [redis_deferring_client]
+
+      r del list1 list2 list3
+
+      $rd1 brpoplpush list1 list2 0
+      $rd2 brpoplpush list2 list3 0
+
+      r rpush list1 foo
+
+      assert_equal {} [r lrange list1 0 -1]
+      assert_equal {} [r lrange list2 0 -1]
+      assert_equal {foo} [r lrange list3 0 -1]
+    }
 #
-#      $rd brpoplpush blist blist 0
+    test "Circular BRPOPLPUSH" {
+      set rd1 [redis_deferring_client]
+      set rd2 [redis_deferring_client]
+
+      r del list1 list2
+
+      $rd1 brpoplpush list1 list2 0
+      $rd2 brpoplpush list2 list1 0
+
+      r rpush list1 foo
+
+      assert_equal {foo} [r lrange list1 0 -1]
+      assert_equal {} [r lrange list2 0 -1]
+    }
 #
-#      r rpush blist foo
+    test "Self-referential BRPOPLPUSH" {
+      set rd [redis_deferring_client]
+
+      r del blist
+
+      $rd brpoplpush blist blist 0
+
+      r rpush blist foo
+
+      assert_equal {foo} [r lrange blist 0 -1]
+    }
 #
-#      assert_equal {foo} [r lrange blist 0 -1]
-#    }
+    test "BRPOPLPUSH inside a transaction" {
+        r del xlist target
+        r lpush xlist foo
+        r lpush xlist bar
+
+        r multi
+        r brpoplpush xlist target 0
+        r brpoplpush xlist target 0
+        r brpoplpush xlist target 0
+        r lrange xlist 0 -1
+        r lrange target 0 -1
+        r exec
+    } {foo bar {} {} {bar foo}}
+#
+    test "PUSH resulting from BRPOPLPUSH affect WATCH" {
+        set blocked_client [redis_deferring_client]
+        set watching_client [redis_deferring_client]
+        r del srclist dstlist somekey
+        r set somekey somevalue
+        $blocked_client brpoplpush srclist dstlist 0
+        $watching_client watch dstlist
+        $watching_client read
+        $watching_client multi
+        $watching_client read
+        $watching_client get somekey
+        $watching_client read
+        r lpush srclist element
+        $watching_client exec
+        $watching_client read
+    } {}
 #
-#    test "BRPOPLPUSH inside a transaction" {
-#        r del xlist target
-#        r lpush xlist foo
-#        r lpush xlist bar
-#
-#        r multi
-#        r brpoplpush xlist target 0
-#        r brpoplpush xlist target 0
-#        r brpoplpush xlist target 0
-#        r lrange xlist 0 -1
-#        r lrange target 0 -1
-#        r exec
-#    } {foo bar {} {} {bar foo}}
-#
-#    test "PUSH resulting from BRPOPLPUSH affect WATCH" {
-#        set blocked_client [redis_deferring_client]
-#        set watching_client [redis_deferring_client]
-#        r del srclist dstlist somekey
-#        r set somekey somevalue
-#        $blocked_client brpoplpush srclist dstlist 0
-#        $watching_client watch dstlist
-#        $watching_client read
-#        $watching_client multi
-#        $watching_client read
-#        $watching_client get somekey
-#        $watching_client read
-#        r lpush srclist element
-#        $watching_client exec
-#        $watching_client read
-#    } {}
-#
-#    test "BRPOPLPUSH does not affect WATCH while still blocked" {
-#        set blocked_client [redis_deferring_client]
-#        set watching_client [redis_deferring_client]
-#        r del srclist dstlist somekey
-#        r set somekey somevalue
-#        $blocked_client brpoplpush srclist dstlist 0
-#        $watching_client watch dstlist
-#        $watching_client read
-#        $watching_client multi
-#        $watching_client read
-#        $watching_client get somekey
-#        $watching_client read
-#        $watching_client exec
-#        # Blocked BLPOPLPUSH may create problems, unblock it.
-#        r lpush srclist element
-#        $watching_client read
-#    } {somevalue}
-#
-#    test {BRPOPLPUSH timeout} {
-#      set rd [redis_deferring_client]
-#
-#      $rd brpoplpush foo_list bar_list 1
-#      after 2000
-#      $rd read
-#    } {}
+    test "BRPOPLPUSH does not affect WATCH while still blocked" {
+        set blocked_client [redis_deferring_client]
+        set watching_client [redis_deferring_client]
+        r del srclist dstlist somekey
+        r set somekey somevalue
+        $blocked_client brpoplpush srclist dstlist 0
+        $watching_client watch dstlist
+        $watching_client read
+        $watching_client multi
+        $watching_client read
+        $watching_client get somekey
+        $watching_client read
+        $watching_client exec
+        # Blocked BLPOPLPUSH may create problems, unblock it.
+        r lpush srclist element
+        $watching_client read
+    } {somevalue}
+#
+    test {BRPOPLPUSH timeout} {
+      set rd [redis_deferring_client]
+
+      $rd brpoplpush foo_list bar_list 1
+      after 2000
+      $rd read
+    } {}
 #
 #    test "BLPOP when new key is moved into place" {
 #        set rd [redis_deferring_client]
@@ -431,38 +477,38 @@ start_server {
 #        $rd read
 #    } {foo aguacate}
 #
-#    foreach {pop} {BLPOP BRPOP} {
-#        test "$pop: with single empty list argument" {
-#            set rd [redis_deferring_client]
-#            r del blist1
-#            $rd $pop blist1 1
-#            r rpush blist1 foo
-#            assert_equal {blist1 foo} [$rd read]
-#            assert_equal 0 [r exists blist1]
-#        }
-#
-#        test "$pop: with negative timeout" {
-#            set rd [redis_deferring_client]
-#            $rd $pop blist1 -1
-#            assert_error "ERR*is negative*" {$rd read}
-#        }
-#
-#        test "$pop: with non-integer timeout" {
-#            set rd [redis_deferring_client]
-#            $rd $pop blist1 1.1
-#            assert_error "ERR*not an integer*" {$rd read}
-#        }
-#
-#        test "$pop: with zero timeout should block indefinitely" {
-#            # To test this, use a timeout of 0 and wait a second.
-#            # The blocking pop should still be waiting for a push.
-#            set rd [redis_deferring_client]
-#            $rd $pop blist1 0
-#            after 1000
-#            r rpush blist1 foo
-#            assert_equal {blist1 foo} [$rd read]
-#        }
-#
+    foreach {pop} {BLPOP BRPOP} {
+        test "$pop: with single empty list argument" {
+            set rd [redis_deferring_client]
+            r del blist1
+            $rd $pop blist1 1
+            r rpush blist1 foo
+            assert_equal {blist1 foo} [$rd read]
+            assert_equal 0 [r exists blist1]
+        }
+
+        test "$pop: with negative timeout" {
+            set rd [redis_deferring_client]
+            $rd $pop blist1 -1
+            assert_error "ERR*is negative*" {$rd read}
+        }
+
+        test "$pop: with non-integer timeout" {
+            set rd [redis_deferring_client]
+            $rd $pop blist1 1.1
+            assert_error "ERR*not an integer*" {$rd read}
+        }
+
+        test "$pop: with zero timeout should block indefinitely" {
+            # To test this, use a timeout of 0 and wait a second.
+            # The blocking pop should still be waiting for a push.
+            set rd [redis_deferring_client]
+            $rd $pop blist1 0
+            after 1000
+            r rpush blist1 foo
+            assert_equal {blist1 foo} [$rd read]
+        }
+
 #        test "$pop: second argument is not a list" {
 #            set rd [redis_deferring_client]
 #            r del blist1 blist2
@@ -470,42 +516,42 @@ start_server {
 #            $rd $pop blist1 blist2 1
 #            assert_error "WRONGTYPE*" {$rd read}
 #        }
+
+        test "$pop: timeout" {
+            set rd [redis_deferring_client]
+            r del blist1 blist2
+            $rd $pop blist1 blist2 1
+            assert_equal {} [$rd read]
+        }
+
+        test "$pop: arguments are empty" {
+            set rd [redis_deferring_client]
+            r del blist1 blist2
+
+            $rd $pop blist1 blist2 1
+            r rpush blist1 foo
+            assert_equal {blist1 foo} [$rd read]
+            assert_equal 0 [r exists blist1]
+            assert_equal 0 [r exists blist2]
+
+            $rd $pop blist1 blist2 1
+            r rpush blist2 foo
+            assert_equal {blist2 foo} [$rd read]
+            assert_equal 0 [r exists blist1]
+            assert_equal 0 [r exists blist2]
+        }
+    }
 #
-#        test "$pop: timeout" {
-#            set rd [redis_deferring_client]
-#            r del blist1 blist2
-#            $rd $pop blist1 blist2 1
-#            assert_equal {} [$rd read]
-#        }
-#
-#        test "$pop: arguments are empty" {
-#            set rd [redis_deferring_client]
-#            r del blist1 blist2
-#
-#            $rd $pop blist1 blist2 1
-#            r rpush blist1 foo
-#            assert_equal {blist1 foo} [$rd read]
-#            assert_equal 0 [r exists blist1]
-#            assert_equal 0 [r exists blist2]
-#
-#            $rd $pop blist1 blist2 1
-#            r rpush blist2 foo
-#            assert_equal {blist2 foo} [$rd read]
-#            assert_equal 0 [r exists blist1]
-#            assert_equal 0 [r exists blist2]
-#        }
-#    }
-#
-#    test {BLPOP inside a transaction} {
-#        r del xlist
-#        r lpush xlist foo
-#        r lpush xlist bar
-#        r multi
-#        r blpop xlist 0
-#        r blpop xlist 0
-#        r blpop xlist 0
-#        r exec
-#    } {{xlist bar} {xlist foo} {}}
+    test {BLPOP inside a transaction} {
+        r del xlist
+        r lpush xlist foo
+        r lpush xlist bar
+        r multi
+        r blpop xlist 0
+        r blpop xlist 0
+        r blpop xlist 0
+        r exec
+    } {{xlist bar} {xlist foo} {}}
 
     test {LPUSHX, RPUSHX - generic} {
         r del xlist
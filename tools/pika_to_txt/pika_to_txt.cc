@@ -3,10 +3,12 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include "algorithm"
 #include "chrono"
 #include "iostream"
 #include "unistd.h"
 
+#include "pstd/include/env.h"
 #include "storage/storage.h"
 
 #include "progress_thread.h"
@@ -14,8 +16,10 @@
 #include "write_thread.h"
 
 int32_t scan_batch_limit = 256;
+int32_t range_num = 1;
 std::string storage_db_path;
 std::string target_file;
+std::string format = "txt";
 
 using std::chrono::high_resolution_clock;
 
@@ -24,6 +28,8 @@ void PrintInfo(const std::time_t& now) {
   std::cout << "Blackwidow_db_path : " << storage_db_path << std::endl;
   std::cout << "Target_file_path : " << target_file << std::endl;
   std::cout << "Scan_batch_limit : " << scan_batch_limit << std::endl;
+  std::cout << "Range_num : " << range_num << std::endl;
+  std::cout << "Format : " << format << std::endl;
   std::cout << "Startup Time : " << asctime(localtime(&now));
   std::cout << "========================================================" << std::endl;
 }
@@ -31,13 +37,45 @@ void PrintInfo(const std::time_t& now) {
 void Usage() {
   std::cout << "Usage: " << std::endl;
   std::cout << "\tPika_To_Txt reads kv data from Blackwidow DB and write to file" << std::endl;
+  std::cout << "\tthe db should not be written meanwhile, export the dump of bgsave for a consistent snapshot"
+            << std::endl;
   std::cout << "\t-h    -- displays this help information and exits" << std::endl;
   std::cout << "\t-b    -- the upper limit for each scan, default = 256" << std::endl;
+  std::cout << "\t-n    -- the key ranges of each type scanned in parallel, default = 1" << std::endl;
+  std::cout << "\t-f    -- txt: the strings into one file read by txt_to_pika, default" << std::endl;
+  std::cout << "\t         resp: all types as gzip redis commands, a file of each range in the target directory"
+            << std::endl;
   std::cout << "\texample: ./pika_to_txt ./storage_db ./data.txt" << std::endl;
+  std::cout << "\texample: ./pika_to_txt ./dump/20230101 ./export -n 8 -f resp" << std::endl;
+}
+
+// Split the keys of type into range_num ranges at the smallest keys of the
+// sst files of its meta column family, "" stands for no bound
+std::vector<std::string> SplitKeys(storage::Storage* storage_db, const std::string& type) {
+  std::vector<std::string> keys;
+  std::vector<rocksdb::LiveFileMetaData> metadata;
+  storage_db->GetDBByType(type)->GetLiveFilesMetaData(&metadata);
+  for (const auto& file : metadata) {
+    if (file.column_family_name == rocksdb::kDefaultColumnFamilyName) {
+      keys.push_back(file.smallestkey);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::vector<std::string> splits = {""};
+  for (int32_t i = 1; i < range_num && !keys.empty(); i++) {
+    const std::string& key = keys[keys.size() * i / range_num];
+    if (!key.empty() && key > splits.back()) {
+      splits.push_back(key);
+    }
+  }
+  splits.emplace_back("");
+  return splits;
 }
 
 int main(int argc, char** argv) {
-  if (argc != 3 && argc != 5) {
+  if (argc < 3 || argc % 2 == 0) {
     Usage();
     exit(-1);
   }
@@ -45,14 +83,23 @@ int main(int argc, char** argv) {
   storage_db_path = std::string(argv[1]);
   target_file = std::string(argv[2]);
 
-  if (argc >= 5) {
-    if (std::string(argv[3]) == "-b") {
-      scan_batch_limit = atoi(argv[4]);
+  for (int i = 3; i < argc; i += 2) {
+    std::string opt = argv[i];
+    if (opt == "-b") {
+      scan_batch_limit = atoi(argv[i + 1]);
+    } else if (opt == "-n") {
+      range_num = atoi(argv[i + 1]);
+    } else if (opt == "-f") {
+      format = argv[i + 1];
     } else {
       Usage();
       exit(-1);
     }
   }
+  if (scan_batch_limit <= 0 || range_num <= 0 || (format != "txt" && format != "resp")) {
+    Usage();
+    exit(-1);
+  }
 
   std::chrono::system_clock::time_point start_time = std::chrono::system_clock::now();
   std::time_t now = std::chrono::system_clock::to_time_t(start_time);
@@ -74,25 +121,61 @@ int main(int argc, char** argv) {
 
   std::cout << "Start migrating data from Blackwidow db to " << target_file << "..." << std::endl;
 
-  auto write_thread = new WriteThread(target_file);
-  auto scan_thread = new ScanThread(write_thread, storage_db);
-  auto progress_thread = new ProgressThread(scan_thread);
+  WriteThread* write_thread = nullptr;
+  std::vector<std::pair<storage::DataType, std::string>> types = {{storage::DataType::kStrings, "strings"}};
+  if (format == "txt") {
+    write_thread = new WriteThread(target_file);
+  } else {
+    pstd::CreatePath(target_file);
+    types.insert(types.end(), {{storage::DataType::kHashes, "hashes"},
+                               {storage::DataType::kLists, "lists"},
+                               {storage::DataType::kSets, "sets"},
+                               {storage::DataType::kZSets, "zsets"}});
+  }
+
+  std::vector<ScanThread*> scan_threads;
+  for (const auto& [type, type_name] : types) {
+    std::vector<std::string> splits = SplitKeys(storage_db, type_name);
+    for (size_t i = 0; i + 1 < splits.size(); i++) {
+      std::string output_file;
+      if (write_thread == nullptr) {
+        output_file = target_file + "/" + type_name + "_" + std::to_string(i) + ".resp.gz";
+      }
+      scan_threads.push_back(new ScanThread(write_thread, storage_db, type, splits[i], splits[i + 1], output_file));
+    }
+  }
+  auto progress_thread = new ProgressThread(scan_threads);
 
-  write_thread->StartThread();
-  // wait for write thread open file success
-  sleep(1);
-  scan_thread->StartThread();
+  if (write_thread != nullptr) {
+    write_thread->StartThread();
+    // wait for write thread open file success
+    sleep(1);
+  }
+  for (auto scan_thread : scan_threads) {
+    scan_thread->StartThread();
+  }
   progress_thread->StartThread();
 
   progress_thread->JoinThread();
-  scan_thread->JoinThread();
-  write_thread->Stop();
-  write_thread->JoinThread();
+  bool ok = true;
+  for (auto scan_thread : scan_threads) {
+    scan_thread->JoinThread();
+    ok = scan_thread->ok() && ok;
+  }
+  if (write_thread != nullptr) {
+    write_thread->Stop();
+    write_thread->JoinThread();
+  }
 
   delete storage_db;
   delete write_thread;
-  delete scan_thread;
+  for (auto scan_thread : scan_threads) {
+    delete scan_thread;
+  }
   delete progress_thread;
+  if (!ok) {
+    std::cout << "Export failed, see the warnings above" << std::endl;
+  }
 
   std::chrono::system_clock::time_point end_time = std::chrono::system_clock::now();
   now = std::chrono::system_clock::to_time_t(end_time);
@@ -105,5 +188,5 @@ int main(int argc, char** argv) {
   std::cout << "Total Time Cost : " << hours << " hours " << minutes % 60 << " minutes " << seconds % 60 << " seconds "
             << std::endl;
 
-  return 0;
+  return ok ? 0 : -1;
 }
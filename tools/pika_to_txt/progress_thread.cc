@@ -5,17 +5,25 @@
 
 #include "progress_thread.h"
 
-ProgressThread::ProgressThread(ScanThread* scan_thread) : scan_thread_(scan_thread) {}
+#include <unistd.h>
+
+ProgressThread::ProgressThread(std::vector<ScanThread*> scan_threads) : scan_threads_(std::move(scan_threads)) {}
 
 void* ProgressThread::ThreadMain() {
   while (true) {
-    bool is_finish = scan_thread_->is_finish();
-    printf("\rstrings items: %5d", scan_thread_->scan_number());
+    bool is_finish = true;
+    int64_t scan_number = 0;
+    for (auto scan_thread : scan_threads_) {
+      is_finish = scan_thread->is_finish() && is_finish;
+      scan_number += scan_thread->scan_number();
+    }
+    printf("\ritems: %5lld", static_cast<long long>(scan_number));
     fflush(stdout);
     if (is_finish) {
       break;
     }
+    usleep(100000);
   }
-  printf("\nScan strings finished\n");
+  printf("\nScan finished\n");
   return nullptr;
 }
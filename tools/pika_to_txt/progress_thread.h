@@ -15,12 +15,12 @@
 
 class ProgressThread : public net::Thread {
  public:
-  ProgressThread(ScanThread* scan_thread);
+  ProgressThread(std::vector<ScanThread*> scan_threads);
 
  private:
   bool AllClassifyTreadFinish();
   virtual void* ThreadMain();
-  ScanThread* scan_thread_;
+  std::vector<ScanThread*> scan_threads_;
 };
 
 #endif  //  INCLUDE_PROGRESS_THREAD_H_
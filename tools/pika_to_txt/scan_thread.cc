@@ -5,37 +5,207 @@
 
 #include "scan_thread.h"
 
+#include "net/include/redis_cli.h"
+#include "pstd/include/pstd_string.h"
+#include "pstd/include/xdebug.h"
+
 extern int32_t scan_batch_limit;
 
+// the elements put into one command of a big key
+const size_t kElementsPerCommand = 512;
+
 bool ScanThread::is_finish() { return is_finish_; }
 
 int32_t ScanThread::scan_number() { return scan_number_; }
 
+static void AppendCommand(const net::RedisCmdArgsType& argv, std::string* data) {
+  std::string cmd;
+  net::SerializeRedisCommand(argv, &cmd);
+  data->append(cmd);
+}
+
+// Append the elements in commands of at most kElementsPerCommand elements,
+// each element takes step arguments
+static void AppendChunked(const std::string& name, const std::string& key, const std::vector<std::string>& args,
+                          size_t step, std::string* data) {
+  size_t chunk = kElementsPerCommand * step;
+  for (size_t i = 0; i < args.size(); i += chunk) {
+    net::RedisCmdArgsType argv = {name, key};
+    argv.insert(argv.end(), args.begin() + static_cast<int64_t>(i),
+                args.begin() + static_cast<int64_t>(std::min(i + chunk, args.size())));
+    AppendCommand(argv, data);
+  }
+}
+
+rocksdb::Status ScanThread::DumpFieldExpires(const std::string& key, const std::vector<std::string>& fields,
+                                             std::string* data) {
+  std::vector<int64_t> ttls;
+  rocksdb::Status s = storage_db_->HTTL(key, fields, &ttls);
+  if (!s.ok()) {
+    return s;
+  }
+  std::map<int64_t, std::vector<std::string>> timestamp_fields;
+  int64_t now = time(nullptr);
+  for (size_t i = 0; i < ttls.size(); i++) {
+    if (ttls[i] > 0) {
+      timestamp_fields[now + ttls[i]].push_back(fields[i]);
+    }
+  }
+  for (const auto& [timestamp, expire_fields] : timestamp_fields) {
+    for (size_t i = 0; i < expire_fields.size(); i += kElementsPerCommand) {
+      size_t end = std::min(i + kElementsPerCommand, expire_fields.size());
+      net::RedisCmdArgsType argv = {"HEXPIREAT", key, std::to_string(timestamp), "FIELDS", std::to_string(end - i)};
+      argv.insert(argv.end(), expire_fields.begin() + static_cast<int64_t>(i),
+                  expire_fields.begin() + static_cast<int64_t>(end));
+      AppendCommand(argv, data);
+    }
+  }
+  return s;
+}
+
+bool ScanThread::DumpKey(const std::string& key, const std::string* value, std::string* data) {
+  rocksdb::Status s;
+  std::vector<std::string> args;
+  switch (type_) {
+    case storage::DataType::kStrings:
+      AppendCommand({"SET", key, *value}, data);
+      break;
+    case storage::DataType::kHashes: {
+      std::vector<storage::FieldValue> fvs;
+      std::vector<std::string> fields;
+      s = storage_db_->HGetall(key, &fvs);
+      for (auto& fv : fvs) {
+        fields.push_back(fv.field);
+        args.push_back(std::move(fv.field));
+        args.push_back(std::move(fv.value));
+      }
+      AppendChunked("HMSET", key, args, 2, data);
+      if (s.ok()) {
+        s = DumpFieldExpires(key, fields, data);
+      }
+      break;
+    }
+    case storage::DataType::kLists:
+      s = storage_db_->LRange(key, 0, -1, &args);
+      AppendChunked("RPUSH", key, args, 1, data);
+      break;
+    case storage::DataType::kSets:
+      s = storage_db_->SMembers(key, &args);
+      AppendChunked("SADD", key, args, 1, data);
+      break;
+    case storage::DataType::kZSets: {
+      std::vector<storage::ScoreMember> score_members;
+      s = storage_db_->ZRange(key, 0, -1, &score_members);
+      for (auto& sm : score_members) {
+        char buf[32];
+        int len = pstd::d2string(buf, sizeof(buf), sm.score);
+        args.emplace_back(buf, len);
+        args.push_back(std::move(sm.member));
+      }
+      AppendChunked("ZADD", key, args, 2, data);
+      break;
+    }
+    default:
+      return false;
+  }
+  // the key expired or was deleted since it was scanned
+  if (s.IsNotFound()) {
+    return false;
+  }
+  if (!s.ok()) {
+    log_warn("read key %s failed, %s", key.c_str(), s.ToString().c_str());
+    ok_ = false;
+    return false;
+  }
+
+  int64_t ttl = -1;
+  s = storage_db_->TTL(type_, key, &ttl);
+  if (s.ok() && ttl > 0) {
+    AppendCommand({"EXPIRE", key, std::to_string(ttl)}, data);
+  }
+  return true;
+}
+
+bool ScanThread::Write(gzFile file, const std::string& data) {
+  if (data.empty()) {
+    return true;
+  }
+  if (gzwrite(file, data.data(), static_cast<unsigned>(data.size())) != static_cast<int>(data.size())) {
+    log_warn("write %s failed", output_file_.c_str());
+    ok_ = false;
+    return false;
+  }
+  return true;
+}
+
 void* ScanThread::ThreadMain() {
-  std::string key_start;
-  std::string key_end;
-  std::string pattern = "*";
+  gzFile file = nullptr;
+  if (!output_file_.empty()) {
+    file = gzopen(output_file_.c_str(), "wb");
+    if (file == nullptr) {
+      log_warn("open %s failed", output_file_.c_str());
+      ok_ = false;
+      is_finish_ = true;
+      return nullptr;
+    }
+  }
+
+  std::string key_start = key_start_;
   std::string next_key;
   std::vector<std::string> keys;
   std::vector<storage::KeyValue> kvs;
-
   do {
-    storage_db_->PKScanRange(storage::DataType::kStrings, key_start, key_end, "*", scan_batch_limit, &keys, &kvs,
-                                &next_key);
-    if (!kvs.empty()) {
-      scan_number_ += kvs.size();
-      std::string data;
+    kvs.clear();
+    // the range of PKScanRange is closed, key_end_ belongs to the next range
+    rocksdb::Status s = storage_db_->PKScanRange(type_, key_start, key_end_, "*", scan_batch_limit, &keys, &kvs,
+                                                 &next_key);
+    if (!s.ok()) {
+      log_warn("scan failed, %s", s.ToString().c_str());
+      ok_ = false;
+      break;
+    }
+    if (!key_end_.empty()) {
+      while (!kvs.empty() && kvs.back().key >= key_end_) {
+        kvs.pop_back();
+      }
+      while (!keys.empty() && keys.back() >= key_end_) {
+        keys.pop_back();
+      }
+      if (next_key >= key_end_) {
+        next_key.clear();
+      }
+    }
+
+    std::string data;
+    if (file == nullptr) {
       for (const auto& kv : kvs) {
         pstd::PutFixed32(&data, kv.key.size());
         data.append(kv.key);
         pstd::PutFixed32(&data, kv.value.size());
         data.append(kv.value);
       }
-      kvs.clear();
-      key_start = next_key;
-      write_thread_->Load(data);
+      scan_number_ += static_cast<int32_t>(kvs.size());
+      if (!data.empty()) {
+        write_thread_->Load(data);
+      }
+    } else {
+      for (const auto& kv : kvs) {
+        scan_number_ += DumpKey(kv.key, &kv.value, &data) ? 1 : 0;
+      }
+      for (const auto& key : keys) {
+        scan_number_ += DumpKey(key, nullptr, &data) ? 1 : 0;
+      }
+      if (!ok_ || !Write(file, data)) {
+        break;
+      }
     }
-  } while (strcmp(next_key.data(), "") != 0);
+    key_start = next_key;
+  } while (!next_key.empty());
+
+  if (file != nullptr && gzclose(file) != Z_OK) {
+    log_warn("close %s failed", output_file_.c_str());
+    ok_ = false;
+  }
   is_finish_ = true;
   return nullptr;
 }
@@ -6,28 +6,61 @@
 #ifndef INCLUDE_SCAN_THREAD_H_
 #define INCLUDE_SCAN_THREAD_H_
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+
 #include "iostream"
 #include "vector"
 
+#include <zlib.h>
+
 #include "storage/storage.h"
 #include "net/include/net_thread.h"
 #include "pstd/include/pstd_coding.h"
 
 #include "write_thread.h"
 
+/*
+ * ScanThread scans the keys of one type in [key_start, key_end), "" for no
+ * bound. Without an output file the strings are handed to the write thread in
+ * the txt format of txt_to_pika, otherwise the keys of the type are written as
+ * RESP commands into the gzip output file of the thread.
+ */
 class ScanThread : public net::Thread {
  public:
-  ScanThread(WriteThread* write_thread, storage::Storage* storage_db)
-      : is_finish_(false), scan_number_(0), write_thread_(write_thread), storage_db_(storage_db) {}
+  ScanThread(WriteThread* write_thread, storage::Storage* storage_db, storage::DataType type, std::string key_start,
+             std::string key_end, std::string output_file)
+      : is_finish_(false),
+        scan_number_(0),
+        write_thread_(write_thread),
+        storage_db_(storage_db),
+        type_(type),
+        key_start_(std::move(key_start)),
+        key_end_(std::move(key_end)),
+        output_file_(std::move(output_file)) {}
   bool is_finish();
   int32_t scan_number();
+  bool ok() { return ok_; }
 
  private:
   void* ThreadMain() override;
-  bool is_finish_;
-  int32_t scan_number_;
+  // Append the RESP commands which restore key to data
+  bool DumpKey(const std::string& key, const std::string* value, std::string* data);
+  // Append the HEXPIREAT commands which restore the expires of the fields of
+  // the hash key, as they are sent to the replicas
+  rocksdb::Status DumpFieldExpires(const std::string& key, const std::vector<std::string>& fields, std::string* data);
+  bool Write(gzFile file, const std::string& data);
+
+  std::atomic<bool> is_finish_;
+  std::atomic<int32_t> scan_number_;
+  bool ok_ = true;
   WriteThread* write_thread_;
   storage::Storage* storage_db_;
+  storage::DataType type_;
+  std::string key_start_;
+  std::string key_end_;
+  std::string output_file_;
 };
 
 #endif  //  INCLUDE_SCAN_THREAD_H_
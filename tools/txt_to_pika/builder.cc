@@ -0,0 +1,68 @@
+#include "builder.h"
+
+#include <utility>
+
+BuilderThread::BuilderThread(std::string output, int slot_num, size_t buffer_size, int ttl)
+    : output_(std::move(output)),
+      slot_num_(slot_num),
+      buffer_size_(buffer_size),
+      ttl_(ttl),
+      should_exit_(false),
+      ok_(true),
+      elements_(0) {}
+
+BuilderThread::~BuilderThread() = default;
+
+void BuilderThread::LoadRecord(uint32_t slot, std::string key, std::string value) {
+  std::unique_lock lock(record_mutex_);
+  wsignal_.wait(lock, [this] { return record_queue_.size() < 100000; });
+  record_queue_.push({slot, std::move(key), std::move(value)});
+  rsignal_.notify_one();
+}
+
+storage::SstBuilder* BuilderThread::GetBuilder(uint32_t slot) {
+  auto iter = builders_.find(slot);
+  if (iter != builders_.end()) {
+    return iter->second.get();
+  }
+  std::string path = slot_num_ > 1 ? output_ + "/" + std::to_string(slot) : output_;
+  auto builder = std::make_unique<storage::SstBuilder>(storage_options_, path, buffer_size_);
+  return builders_.emplace(slot, std::move(builder)).first->second.get();
+}
+
+void* BuilderThread::ThreadMain() {
+  log_info("Start builder thread...");
+
+  while (true) {
+    Record record;
+    {
+      std::unique_lock lock(record_mutex_);
+      rsignal_.wait(lock, [this] { return !record_queue_.empty() || should_exit_; });
+      if (record_queue_.empty()) {
+        break;
+      }
+      record = std::move(record_queue_.front());
+      record_queue_.pop();
+    }
+    wsignal_.notify_one();
+
+    rocksdb::Status s = GetBuilder(record.slot)->Set(record.key, record.value, ttl_ > 0 ? ttl_ : 0);
+    if (!s.ok()) {
+      log_warn("Build %s failed: %s", record.key.data(), s.ToString().data());
+      ok_ = false;
+      continue;
+    }
+    elements_++;
+  }
+
+  // the runs of every slot are merged into the files to ingest
+  for (auto& [slot, builder] : builders_) {
+    rocksdb::Status s = builder->Finish();
+    if (!s.ok()) {
+      log_warn("Finish the sst files of slot %u failed: %s", slot, s.ToString().data());
+      ok_ = false;
+    }
+  }
+  log_info("Builder thread complete");
+  return nullptr;
+}
@@ -0,0 +1,55 @@
+#ifndef BUILDER_H_
+#define BUILDER_H_
+
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+
+#include "net/include/bg_thread.h"
+#include "pstd/include/pstd_mutex.h"
+#include "pstd/include/xdebug.h"
+#include "storage/sst_builder.h"
+
+// BuilderThread builds the sst files of the slots dispatched to it instead of
+// sending the records to pika, they are loaded by BULKLOAD. With many slots
+// the files of a slot are under <output>/<slot id>
+class BuilderThread : public net::Thread {
+ public:
+  BuilderThread(std::string output, int slot_num, size_t buffer_size, int ttl);
+  virtual ~BuilderThread();
+  void LoadRecord(uint32_t slot, std::string key, std::string value);
+  void Stop() {
+    std::lock_guard l(record_mutex_);
+    should_exit_ = true;
+    rsignal_.notify_one();
+  }
+  int64_t elements() { return elements_; }
+  bool ok() { return ok_; }
+
+ private:
+  struct Record {
+    uint32_t slot;
+    std::string key;
+    std::string value;
+  };
+
+  pstd::CondVar rsignal_;
+  pstd::CondVar wsignal_;
+  pstd::Mutex record_mutex_;
+  std::queue<Record> record_queue_;
+  std::string output_;
+  int slot_num_;
+  size_t buffer_size_;
+  int ttl_;
+  bool should_exit_;
+  bool ok_;
+  int64_t elements_;
+  storage::StorageOptions storage_options_;
+  std::map<uint32_t, std::unique_ptr<storage::SstBuilder>> builders_;
+
+  storage::SstBuilder* GetBuilder(uint32_t slot);
+  virtual void* ThreadMain();
+};
+
+#endif
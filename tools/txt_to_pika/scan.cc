@@ -1,6 +1,8 @@
 #include "scan.h"
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <utility>
 
 ScanThread::~ScanThread() = default;
 
@@ -29,6 +31,15 @@ void ScanThread::ScanFile() {
     fout.read(value, value_len);
     str_value.append(value, value_len);
 
+    if (!builders_.empty()) {
+      index += key_len + value_len + sizeof(uint32_t) * 2;
+      delete[] key;
+      delete[] value;
+      DispatchRecord(std::move(str_key), std::move(str_value));
+      num_++;
+      continue;
+    }
+
     net::RedisCmdArgsType argv;
     if (ttl_ > 0) {
       argv.push_back("SETEX");
@@ -59,6 +70,23 @@ void ScanThread::DispatchCmd(const std::string& cmd) {
   thread_index_ = (thread_index_ + 1) % senders_.size();
 }
 
+// The part of the key hashed, the hash tag between the first '{' and the
+// next '}' if there is one, as pika distributes the keys
+static std::string HashKey(const std::string& key) {
+  auto beg = key.find('{');
+  if (beg == std::string::npos) {
+    return key;
+  }
+  auto end = key.find('}', beg + 1);
+  return end == std::string::npos ? key : key.substr(beg + 1, end - beg - 1);
+}
+
+void ScanThread::DispatchRecord(std::string key, std::string value) {
+  // the slot of the key, as pika distributes the keys
+  uint32_t slot = std::hash<std::string>()(HashKey(key)) % slot_num_;
+  builders_[slot % builders_.size()]->LoadRecord(slot, std::move(key), std::move(value));
+}
+
 void* ScanThread::ThreadMain() {
   ScanFile();
   log_info("Scan file complete");
@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "builder.h"
 #include "net/include/bg_thread.h"
 #include "sender.h"
 
@@ -12,18 +13,25 @@ class ScanThread : public net::Thread {
  public:
   ScanThread(std::string filename, std::vector<SenderThread*> senders, int ttl)
       : filename_(filename), num_(0), senders_(senders), thread_index_(0), ttl_(ttl) {}
+  // Build sst files of slot_num slots instead of sending the records
+  ScanThread(std::string filename, std::vector<BuilderThread*> builders, int slot_num)
+      : filename_(filename), num_(0), builders_(builders), thread_index_(0), ttl_(-1), slot_num_(slot_num) {}
 
   virtual ~ScanThread();
   int Num() { return num_; }
   void DispatchCmd(const std::string& cmd);
+  // The records of a slot always go to the same builder
+  void DispatchRecord(std::string key, std::string value);
 
  private:
   void ScanFile();
   std::string filename_;
   int num_;
   std::vector<SenderThread*> senders_;
+  std::vector<BuilderThread*> builders_;
   int thread_index_;
   int ttl_;
+  int slot_num_ = 1;
 
   void* ThreadMain();
 };
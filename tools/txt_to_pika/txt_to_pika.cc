@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include "scan.h"
@@ -9,6 +10,49 @@ void Usage() {
   std::cout << "Usage: " << std::endl;
   std::cout << "    ./txt_to_pika txt pika_ip pika_port -n [thread_num] -t [ttl] -p [password]" << std::endl;
   std::cout << "    example: ./txt_to_pika data.txt 127.0.0.1 9921 -n 10 -t 10 -p 123456" << std::endl;
+  std::cout << "    ./txt_to_pika txt -o sst_dir -s [slot_num] -n [thread_num] -t [ttl] -m [buffer_mb]" << std::endl;
+  std::cout << "    example: ./txt_to_pika data.txt -o ./sst -s 16 -n 8 -m 1024" << std::endl;
+  std::cout << "    then load sst_dir by BULKLOAD sst_dir on the pika whose db-shard-num is slot_num" << std::endl;
+}
+
+// Build the sst files of the records under output, the memory of buffer_mb
+// is shared by the slots of each builder thread
+int BuildSst(const std::string& filename, const std::string& output, int slot_num, int thread_num, int ttl,
+             int64_t buffer_mb) {
+  std::cout << "filename: " << filename << std::endl;
+  std::cout << "output: " << output << std::endl;
+  std::cout << "slot_num: " << slot_num << std::endl;
+  std::cout << "ttl: " << ttl << std::endl;
+  std::cout << "thread: " << thread_num << std::endl;
+  std::cout << "buffer_mb: " << buffer_mb << std::endl;
+
+  size_t slots_per_thread = (slot_num + thread_num - 1) / thread_num;
+  size_t buffer_size = std::max<size_t>((buffer_mb << 20) / thread_num / slots_per_thread, 1 << 20);
+  std::vector<BuilderThread*> builders;
+  builders.reserve(thread_num);
+  for (int i = 0; i < thread_num; i++) {
+    builders.push_back(new BuilderThread(output, slot_num, buffer_size, ttl));
+  }
+  auto scan_thread = new ScanThread(filename, builders, slot_num);
+  for (int i = 0; i < thread_num; i++) {
+    builders[i]->StartThread();
+  }
+  scan_thread->StartThread();
+  scan_thread->JoinThread();
+
+  bool ok = true;
+  int64_t records = 0;
+  for (int i = 0; i < thread_num; i++) {
+    builders[i]->Stop();
+    builders[i]->JoinThread();
+    records += builders[i]->elements();
+    ok = ok && builders[i]->ok();
+    delete builders[i];
+  }
+  std::cout << std::endl << "Total " << scan_thread->Num() << " records has been scaned" << std::endl;
+  std::cout << "Total " << records << " records has been built into " << output << std::endl;
+  delete scan_thread;
+  return ok ? 0 : -1;
 }
 
 int main(int argc, char** argv) {
@@ -17,6 +61,30 @@ int main(int argc, char** argv) {
     return 0;
   }
 
+  if (std::string(argv[2]) == "-o") {
+    int slot_num = 1;
+    int thread_num = 8;
+    int ttl = -1;
+    int64_t buffer_mb = 1024;
+    for (int index = 4; index + 1 < argc; index += 2) {
+      std::string flag = argv[index];
+      if (flag == "-s") {
+        slot_num = std::stoi(std::string(argv[index + 1]));
+      } else if (flag == "-n") {
+        thread_num = std::stoi(std::string(argv[index + 1]));
+      } else if (flag == "-t") {
+        ttl = std::stoi(std::string(argv[index + 1]));
+      } else if (flag == "-m") {
+        buffer_mb = std::stoll(std::string(argv[index + 1]));
+      }
+    }
+    if (slot_num <= 0 || thread_num <= 0 || buffer_mb <= 0) {
+      Usage();
+      return -1;
+    }
+    return BuildSst(std::string(argv[1]), std::string(argv[3]), slot_num, thread_num, ttl, buffer_mb);
+  }
+
   high_resolution_clock::time_point start = high_resolution_clock::now();
 
   std::string password;